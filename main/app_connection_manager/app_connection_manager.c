@@ -1,12 +1,18 @@
 #include "app_connection_manager.h"
 #include "bluetooth_comm_gatt.h"
 #include "wifi_comm.h"
+#include "rest_api.h"
+#include "weigh_log.h"
+#include "user_profiles.h"
+#include "log_utils.h"
+#include "resources.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "freertos/event_groups.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -21,8 +27,36 @@ static connection_status_t connection_status = {
 
 // Wi-Fi scanning variables
 static EventGroupHandle_t wifi_scan_event_group;
+static StaticEventGroup_t wifi_scan_event_group_buf;
 const int WIFI_SCAN_DONE_BIT = BIT0;
 
+// Reference-counted record shared by all subscribers of one publish
+typedef struct hub_record {
+    measurement_t      m;
+    uint32_t           refs;
+    struct hub_record *next_free;
+} hub_record_t;
+
+typedef struct {
+    const char        *name;
+    hub_sink_fn        fn;
+    void              *ctx;
+    QueueHandle_t      queue;       // Holds hub_record_t pointers
+    hub_drop_policy_t  policy;
+    uint32_t           kinds;
+    uint32_t           delivered;
+    uint32_t           dropped;
+} hub_subscriber_t;
+
+static hub_record_t      hub_pool[APP_HUB_POOL_SIZE];
+static hub_record_t     *hub_free_list = NULL;
+static portMUX_TYPE      hub_lock = portMUX_INITIALIZER_UNLOCKED;
+static hub_subscriber_t  hub_subs[APP_HUB_MAX_SUBSCRIBERS];
+static int               hub_sub_count = 0;
+static uint32_t          hub_seq = 0;
+static uint32_t          hub_pool_exhausted = 0;
+static bool              hub_ready = false;
+
 /* ------------------------- Private Functions ------------------------- */
 
 static void wifi_scan_event_handler(void* arg, esp_event_base_t event_base, 
@@ -46,17 +80,204 @@ static void wifi_scan_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
+/* ------------------------- Publish/Subscribe Hub ------------------------- */
+
+static hub_record_t *hub_record_alloc(void) {
+    taskENTER_CRITICAL(&hub_lock);
+    hub_record_t *rec = hub_free_list;
+    if (rec) {
+        hub_free_list = rec->next_free;
+    }
+    taskEXIT_CRITICAL(&hub_lock);
+    return rec;
+}
+
+static void hub_record_release(hub_record_t *rec) {
+    if (__atomic_sub_fetch(&rec->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    taskENTER_CRITICAL(&hub_lock);
+    rec->next_free = hub_free_list;
+    hub_free_list = rec;
+    taskEXIT_CRITICAL(&hub_lock);
+}
+
+static void hub_subscriber_task(void *arg) {
+    hub_subscriber_t *sub = (hub_subscriber_t *)arg;
+    hub_record_t *rec;
+
+    for (;;) {
+        if (xQueueReceive(sub->queue, &rec, portMAX_DELAY) == pdTRUE) {
+            sub->fn(&rec->m, sub->ctx);
+            sub->delivered++;
+            hub_record_release(rec);
+        }
+    }
+}
+
+static void hub_init(void) {
+    hub_free_list = NULL;
+    for (int i = APP_HUB_POOL_SIZE - 1; i >= 0; i--) {
+        hub_pool[i].refs = 0;
+        hub_pool[i].next_free = hub_free_list;
+        hub_free_list = &hub_pool[i];
+    }
+    hub_ready = true;
+}
+
+int app_connection_manager_subscribe(const char *name, hub_sink_fn fn, void *ctx,
+                                     uint8_t depth, hub_drop_policy_t policy,
+                                     uint32_t kinds, UBaseType_t priority) {
+    if (!fn || depth == 0 || depth > RES_HUB_QUEUE_DEPTH ||
+        hub_sub_count >= APP_HUB_MAX_SUBSCRIBERS) {
+        ESP_LOGE(TAG, "Cannot add subscriber %s", name ? name : "?");
+        return -1;
+    }
+
+    hub_subscriber_t *sub = &hub_subs[hub_sub_count];
+    sub->name   = name;
+    sub->fn     = fn;
+    sub->ctx    = ctx;
+    sub->policy = policy;
+    sub->kinds  = kinds;
+    sub->delivered = 0;
+    sub->dropped   = 0;
+    // Queue and task come from the subscriber's reserved slot
+    sub->queue  = res_queue_create(RES_QUEUE_HUB, hub_sub_count, depth, sizeof(hub_record_t *));
+    if (!sub->queue) {
+        ESP_LOGE(TAG, "No queue slot for %s", name);
+        return -1;
+    }
+    TaskHandle_t task = res_task_start(RES_TASK_HUB, hub_sub_count, hub_subscriber_task, name, sub);
+    if (!task) {
+        ESP_LOGE(TAG, "Failed to start %s task", name);
+        return -1;
+    }
+    // Sinks stay on the networking core; only their relative order changes
+    if (priority != RES_PRIO_HUB) {
+        vTaskPrioritySet(task, priority);
+    }
+
+    // Publishers only look at subscribers below hub_sub_count
+    __atomic_store_n(&hub_sub_count, hub_sub_count + 1, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "Subscriber %s added (depth %u, %s)", name, depth,
+             policy == HUB_DROP_OLDEST ? "drop-oldest" : "drop-newest");
+    return hub_sub_count - 1;
+}
+
+bool app_connection_manager_publish(const measurement_t *m) {
+    if (!m || !hub_ready) return false;
+
+    hub_record_t *rec = hub_record_alloc();
+    if (!rec) {
+        hub_pool_exhausted++;
+        return false;
+    }
+    rec->m = *m;
+    rec->m.seq = ++hub_seq;
+    rec->refs = 1;   // Publisher's reference, dropped below
+
+    int count = __atomic_load_n(&hub_sub_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        hub_subscriber_t *sub = &hub_subs[i];
+        if (!(sub->kinds & MEAS_KIND_BIT(m->kind))) continue;
+
+        __atomic_add_fetch(&rec->refs, 1, __ATOMIC_RELAXED);
+        if (xQueueSend(sub->queue, &rec, 0) == pdTRUE) continue;
+
+        if (sub->policy == HUB_DROP_OLDEST) {
+            hub_record_t *old;
+            if (xQueueReceive(sub->queue, &old, 0) == pdTRUE) {
+                hub_record_release(old);
+                sub->dropped++;
+            }
+            if (xQueueSend(sub->queue, &rec, 0) == pdTRUE) continue;
+        }
+        hub_record_release(rec);
+        sub->dropped++;
+    }
+
+    hub_record_release(rec);
+    return true;
+}
+
+int app_connection_manager_get_stats(hub_subscriber_stats_t *out, int max) {
+    int n = 0;
+    int count = __atomic_load_n(&hub_sub_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count && n < max; i++, n++) {
+        out[n].name      = hub_subs[i].name;
+        out[n].delivered = hub_subs[i].delivered;
+        out[n].dropped   = hub_subs[i].dropped;
+    }
+    return n;
+}
+
+/* ---------------------- Built-in Subscribers ---------------------- */
+
+// BLE: Weight Scale Measurement encoding happens in the GATT layer
+static void ble_sink(const measurement_t *m, void *ctx) {
+    if (m->kind != MEAS_KIND_LIVE && m->kind != MEAS_KIND_LOCKED) return;
+    wss_measurement_t w = {
+        .weight_g  = m->weight_g,
+        .timestamp = m->timestamp,
+        .user_id   = m->user_id,
+        .stable    = (m->kind == MEAS_KIND_LOCKED),
+    };
+    bluetooth_comm_gatt_submit_weight(&w);
+}
+
+// HTTPS: keep the latest record for the /weight handler to serialise
+static void https_sink(const measurement_t *m, void *ctx) {
+    rest_api_set_latest_measurement(m);
+}
+
+// Store: only locked weigh-ins go to flash
+static void store_sink(const measurement_t *m, void *ctx) {
+    weigh_log_append(m->weight_g, m->mono_us, m->user_id, NULL);
+}
+
+// Users: cluster update + body composition for identified weigh-ins
+static void users_sink(const measurement_t *m, void *ctx) {
+    if (m->user_id == USER_ID_UNKNOWN) return;
+
+    body_composition_t bc;
+    if (user_profiles_record(m->user_id, m->weight_g, m->mono_us, &bc) != ESP_OK) return;
+    if (bc.body_fat_percentage > 0.0f) {
+        LOG_ROW("Hub", "user %u: %.2f kg, fat %.1f%% (%.2f kg), lean %.2f kg",
+                (unsigned)m->user_id, m->weight_g / 1000.0f, bc.body_fat_percentage,
+                bc.fat_mass_kg, bc.lean_mass_kg);
+    }
+}
+
+// Log: weigh-in events in the tabular console format
+static void log_sink(const measurement_t *m, void *ctx) {
+    static const char *const names[MEAS_KIND_COUNT] = {
+        "LIVE", "WEIGHT_ADDED", "WEIGHT_LOCKED", "WEIGHT_REMOVED"
+    };
+    LOG_ROW("Hub", "#%-6" PRIu32 " %-14s %.2f g", m->seq,
+            m->kind < MEAS_KIND_COUNT ? names[m->kind] : "?", m->weight_g);
+}
+
 /* ------------------------- Public Functions ------------------------- */
 
 void app_connection_manager_init(void) {
-    // Initialize Wi-Fi
-    wifi_init();
-    
-    // Initialize Bluetooth
-    custom_gatt_init();
+    // Publish hub + per-transport subscribers
+    hub_init();
+    app_connection_manager_subscribe("hub_https", https_sink, NULL, 2, HUB_DROP_OLDEST,
+                                     MEAS_KIND_ALL, tskIDLE_PRIORITY + 2);
+    app_connection_manager_subscribe("hub_ble", ble_sink, NULL, 4, HUB_DROP_OLDEST,
+                                     MEAS_KIND_BIT(MEAS_KIND_LIVE) | MEAS_KIND_BIT(MEAS_KIND_LOCKED),
+                                     tskIDLE_PRIORITY + 2);
+    app_connection_manager_subscribe("hub_log", log_sink, NULL, 8, HUB_DROP_NEWEST,
+                                     MEAS_KIND_ALL & ~MEAS_KIND_BIT(MEAS_KIND_LIVE),
+                                     tskIDLE_PRIORITY + 1);
+    app_connection_manager_subscribe("hub_store", store_sink, NULL, 8, HUB_DROP_NEWEST,
+                                     MEAS_KIND_BIT(MEAS_KIND_LOCKED), tskIDLE_PRIORITY + 1);
+    app_connection_manager_subscribe("hub_users", users_sink, NULL, 4, HUB_DROP_NEWEST,
+                                     MEAS_KIND_BIT(MEAS_KIND_LOCKED), tskIDLE_PRIORITY + 1);
 
     // Create event group for Wi-Fi scanning
-    wifi_scan_event_group = xEventGroupCreate();
+    wifi_scan_event_group = xEventGroupCreateStatic(&wifi_scan_event_group_buf);
     
     // Register Wi-Fi scan event handler
     ESP_ERROR_CHECK(esp_event_handler_instance_register(
@@ -89,27 +310,6 @@ void app_connection_manager_set_bluetooth_status(bool connected) {
     ESP_LOGI(TAG, "Bluetooth %s", connected ? "connected" : "disconnected");
 }
 
-void app_connection_manager_send_data(const char *data) {
-    if (!data) {
-        ESP_LOGE(TAG, "Null data pointer");
-        return;
-    }
-
-    if (connection_status.wifi_connected) {
-        wifi_send_data(data);
-        ESP_LOGD(TAG, "Sent over Wi-Fi: %s", data);
-    }
-
-    if (connection_status.bluetooth_connected) {
-        bluetooth_comm_gatt_send_data((const uint8_t *)data, strlen(data));
-        ESP_LOGD(TAG, "Sent over Bluetooth: %s", data);
-    }
-
-    if (!connection_status.wifi_connected && !connection_status.bluetooth_connected) {
-        ESP_LOGW(TAG, "No active connections to send data");
-    }
-}
-
 /* ------------------------- Wi-Fi Functions ------------------------- */
 
 void app_connection_manager_start_wifi_scan(void) {
@@ -157,7 +357,7 @@ int app_connection_manager_get_scan_results(wifi_ap_info_t *results, int max_res
     }
 
     // Allocate temporary storage
-    wifi_ap_record_t *ap_records = malloc(sizeof(wifi_ap_record_t) * ap_count);
+    wifi_ap_record_t *ap_records = res_malloc(RES_HEAP_WIFI, sizeof(wifi_ap_record_t) * ap_count);
     if (!ap_records) {
         ESP_LOGE(TAG, "Failed to allocate memory for scan results");
         return 0;
@@ -188,7 +388,7 @@ int app_connection_manager_get_scan_results(wifi_ap_info_t *results, int max_res
     }
     ESP_LOGI(TAG, "----------------------------------");
 
-    free(ap_records);
+    res_free(ap_records);
     return result_count;
 }
 
@@ -3,7 +3,10 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
 #include "esp_wifi_types.h"  // Added for wifi_auth_mode_t
+#include "resources.h"
 
 typedef struct {
     bool wifi_connected;
@@ -18,11 +21,93 @@ typedef struct {
     wifi_auth_mode_t auth_mode;  // Authentication mode (using standard esp_wifi type)
 } wifi_ap_info_t;
 
+/* ----------------- Measurement Publish/Subscribe Hub ---------------- */
+
+// Record pool shared by all subscribers (one record per publish)
+#ifndef APP_HUB_POOL_SIZE
+#define APP_HUB_POOL_SIZE       32
+#endif
+
+// One reserved queue/task slot per subscriber (resources.h)
+#define APP_HUB_MAX_SUBSCRIBERS RES_HUB_SUBSCRIBERS
+
+typedef enum {
+    MEAS_KIND_LIVE = 0,     // Every filtered reading while weight is present
+    MEAS_KIND_ADDED,        // Weight placed (debounced)
+    MEAS_KIND_LOCKED,       // Stable result of a weigh-in
+    MEAS_KIND_REMOVED,      // Weight removed (debounced)
+    MEAS_KIND_COUNT
+} measurement_kind_t;
+
+#define MEAS_KIND_BIT(k)    (1u << (k))
+#define MEAS_KIND_ALL       ((1u << MEAS_KIND_COUNT) - 1u)
+
+// Binary measurement record as published by the weight pipeline
+typedef struct {
+    float    weight_g;      // Calibrated weight in grams
+    int64_t  mono_us;       // Capture time, monotonic domain (clock_map)
+    time_t   timestamp;     // Wall-clock time, 0 if unknown at capture
+    uint32_t seq;           // Assigned by the hub on publish
+    uint8_t  user_id;       // 0xFF if unknown
+    uint8_t  kind;          // measurement_kind_t
+} measurement_t;
+
+// What a subscriber does when its queue is full
+typedef enum {
+    HUB_DROP_NEWEST = 0,    // Keep what is queued, discard the new record
+    HUB_DROP_OLDEST,        // Evict the oldest queued record (latest-value sinks)
+} hub_drop_policy_t;
+
+/**
+ * @brief Subscriber callback; runs on the subscriber's own task.
+ *
+ * The record is shared with every other subscriber and is only valid for
+ * the duration of the call: encode it, don't keep the pointer.
+ */
+typedef void (*hub_sink_fn)(const measurement_t *m, void *ctx);
+
+typedef struct {
+    const char       *name;
+    uint32_t          delivered;
+    uint32_t          dropped;
+} hub_subscriber_stats_t;
+
 /**
- * @brief Initialize connection manager
+ * @brief Initialize connection manager: Wi-Fi scan support, the publish hub
+ *        and the built-in subscribers (HTTPS, BLE, log, store, users).
+ *        Call after wifi_comm_start() and custom_gatt_init().
  */
 void app_connection_manager_init(void);
 
+/**
+ * @brief Register a subscriber with its own task and bounded queue.
+ * @param name      Task name / stats label
+ * @param fn        Encoder/sink for each record
+ * @param ctx       Passed back to `fn`
+ * @param depth     Queue depth (records)
+ * @param policy    Drop policy when the queue is full
+ * @param kinds     Bitmask of MEAS_KIND_BIT() values to receive
+ * @param priority  Subscriber task priority (the task runs on RES_CORE_NET)
+ * @return Subscriber index, or -1 on failure
+ */
+int app_connection_manager_subscribe(const char *name, hub_sink_fn fn, void *ctx,
+                                     uint8_t depth, hub_drop_policy_t policy,
+                                     uint32_t kinds, UBaseType_t priority);
+
+/**
+ * @brief Publish a measurement to every interested subscriber.
+ *
+ * Never blocks: the record is placed in a pool once and a reference is
+ * queued per subscriber. Returns false if the pool was exhausted.
+ */
+bool app_connection_manager_publish(const measurement_t *m);
+
+/**
+ * @brief Copy per-subscriber delivery/drop counters.
+ * @return Number of entries written
+ */
+int app_connection_manager_get_stats(hub_subscriber_stats_t *out, int max);
+
 /**
  * @brief Update WiFi connection status
  * @param connected True if connected
@@ -36,12 +121,6 @@ void app_connection_manager_set_wifi_status(bool connected, const char *ssid);
  */
 void app_connection_manager_set_bluetooth_status(bool connected);
 
-/**
- * @brief Send data through active connections
- * @param data Null-terminated string to send
- */
-void app_connection_manager_send_data(const char *data);
-
 /* ----------------- Wi-Fi Scanning Functions ---------------- */
 
 /**
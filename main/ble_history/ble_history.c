@@ -0,0 +1,391 @@
+// File: main/ble_history/ble_history.c
+// ---------------------------------------------------------------------------
+// Bulk weigh-in history sync over BLE
+//   - Record Access Control Point (RACP) to request/count/abort transfers
+//   - Records streamed as packed notifications, MTU-sized
+//   - Flow control against the NimBLE msys mbuf pool
+//   - Resumable: "report records with seq ≥ N"
+// ---------------------------------------------------------------------------
+
+#include "ble_history.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "host/ble_hs.h"
+#include "host/ble_uuid.h"
+#include "host/ble_gatt.h"
+#include "host/ble_hs_mbuf.h"
+#include "os/os_mbuf.h"
+
+#include "bluetooth_comm_gatt.h"   // current_conn_handle
+#include "weigh_log.h"
+#include "log_utils.h"
+#include "resources.h"
+
+static const char *TAG = "BLE_HISTORY";
+
+// Largest ATT payload we ever build (MTU 515 → 512 bytes → 42 records)
+#define HISTORY_MAX_RECORDS_PER_PDU  (BLE_ATT_ATTR_MAX_LEN / BLE_HISTORY_RECORD_LEN)
+
+// Weigh-in History Service: 8a1f0001-6b3c-4e21-9d5a-2c7e5f4b3a10
+static const ble_uuid128_t history_service_uuid =
+    BLE_UUID128_INIT(0x10, 0x3a, 0x4b, 0x5f, 0x7e, 0x2c, 0x5a, 0x9d,
+                     0x21, 0x4e, 0x3c, 0x6b, 0x01, 0x00, 0x1f, 0x8a);
+
+// History Records characteristic: 8a1f0002-6b3c-4e21-9d5a-2c7e5f4b3a10
+static const ble_uuid128_t history_records_uuid =
+    BLE_UUID128_INIT(0x10, 0x3a, 0x4b, 0x5f, 0x7e, 0x2c, 0x5a, 0x9d,
+                     0x21, 0x4e, 0x3c, 0x6b, 0x02, 0x00, 0x1f, 0x8a);
+
+static uint16_t s_racp_handle = 0;
+static uint16_t s_records_handle = 0;
+
+// Client state
+static bool s_racp_indicate = false;
+static bool s_records_notify = false;
+
+// One RACP procedure at a time
+typedef struct {
+    uint8_t  op;
+    uint32_t from_seq;
+} history_request_t;
+
+_Static_assert(sizeof(history_request_t) <= 8, "history_request_t outgrew RES_QUEUE_BLE_HISTORY");
+
+static QueueHandle_t     s_requests = NULL;
+static TaskHandle_t      s_task = NULL;
+static volatile bool     s_busy = false;
+static volatile bool     s_abort = false;
+
+/* ----------------------------- Helpers ----------------------------- */
+
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static size_t encode_record(const weigh_log_record_t *r, uint8_t *p) {
+    float w = r->weight_g < 0.0f ? 0.0f : r->weight_g;
+    uint16_t w5 = (w >= 65535.0f * 5.0f) ? WSS_WEIGHT_UNSUCCESSFUL
+                                         : (uint16_t)((w + 2.5f) / 5.0f);
+    // Boot-relative stamps that could not be re-based go out as "unknown"
+    bool mono = (r->flags & WEIGH_LOG_FLAG_MONO) != 0;
+    put_le32(&p[0], r->seq);
+    put_le32(&p[4], mono ? 0 : r->timestamp);
+    put_le16(&p[8], w5);
+    p[10] = r->user_id;
+    p[11] = 0;   // Reserved on the wire
+    return BLE_HISTORY_RECORD_LEN;
+}
+
+// Wait for a TX completion (or a short timeout) when mbufs run low
+static void wait_for_tx_room(void) {
+    while (os_msys_num_free() <= BLE_HISTORY_MBUF_RESERVE && !s_abort &&
+           current_conn_handle != BLE_HS_CONN_HANDLE_NONE) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+    }
+}
+
+static void racp_indicate(const uint8_t *rsp, uint16_t len) {
+    uint16_t conn = current_conn_handle;
+    if (conn == BLE_HS_CONN_HANDLE_NONE || !s_racp_indicate) return;
+
+    struct os_mbuf *om = ble_hs_mbuf_from_flat(rsp, len);
+    if (!om) {
+        ESP_LOGE(TAG, "No mbuf for RACP response");
+        return;
+    }
+    int rc = ble_gatts_indicate_custom(conn, s_racp_handle, om);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "RACP indication failed; rc=%d", rc);
+    }
+}
+
+static void racp_respond(uint8_t req_op, uint8_t code) {
+    uint8_t rsp[4] = { RACP_OP_RESPONSE_CODE, RACP_OPERATOR_NULL, req_op, code };
+    racp_indicate(rsp, sizeof(rsp));
+}
+
+/* --------------------------- Sync task ---------------------------- */
+
+static void stream_records(uint32_t from_seq) {
+    static weigh_log_record_t recs[HISTORY_MAX_RECORDS_PER_PDU];
+    static uint8_t pdu[HISTORY_MAX_RECORDS_PER_PDU * BLE_HISTORY_RECORD_LEN];
+
+    if (weigh_log_count_from(from_seq) == 0) {
+        racp_respond(RACP_OP_REPORT_RECORDS, RACP_RSP_NO_RECORDS);
+        return;
+    }
+
+    int64_t  t0 = esp_timer_get_time();
+    uint32_t seq = from_seq;
+    uint32_t sent = 0;
+    uint32_t pdus = 0;
+    bool     failed = false;
+
+    while (!s_abort) {
+        uint16_t conn = current_conn_handle;
+        if (conn == BLE_HS_CONN_HANDLE_NONE) {
+            failed = true;
+            break;
+        }
+
+        // Fill each notification up to the negotiated MTU
+        int per_pdu = (ble_att_mtu(conn) - 3) / BLE_HISTORY_RECORD_LEN;
+        if (per_pdu < 1) per_pdu = 1;
+        if (per_pdu > HISTORY_MAX_RECORDS_PER_PDU) per_pdu = HISTORY_MAX_RECORDS_PER_PDU;
+
+        int n = weigh_log_read(seq, recs, per_pdu);
+        if (n <= 0) {
+            // 0: nothing valid left. A read error must not look like a
+            // complete sync to the client
+            failed = n < 0;
+            break;
+        }
+
+        uint16_t len = 0;
+        for (int i = 0; i < n; i++) {
+            len += encode_record(&recs[i], &pdu[len]);
+        }
+
+        int rc;
+        do {
+            wait_for_tx_room();
+            if (s_abort) break;
+            struct os_mbuf *om = ble_hs_mbuf_from_flat(pdu, len);
+            if (!om) {
+                rc = BLE_HS_ENOMEM;
+            } else {
+                // The stack consumes `om` whether or not the call succeeds
+                rc = ble_gatts_notify_custom(conn, s_records_handle, om);
+            }
+            if (rc == BLE_HS_ENOMEM) {
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(20));
+            }
+        } while (rc == BLE_HS_ENOMEM && current_conn_handle == conn);
+
+        if (s_abort) break;
+        if (rc != 0) {
+            ESP_LOGE(TAG, "History notify failed; rc=%d", rc);
+            failed = true;
+            break;
+        }
+
+        seq = recs[n - 1].seq + 1;
+        sent += (uint32_t)n;
+        pdus++;
+    }
+
+    int64_t dt_us = esp_timer_get_time() - t0;
+    uint32_t rps = dt_us > 0 ? (uint32_t)((uint64_t)sent * 1000000ull / (uint64_t)dt_us) : sent;
+    LOG_ROW(TAG, "Synced %" PRIu32 " records in %" PRIu32 " PDUs, %lld ms, %" PRIu32 " rec/s",
+            sent, pdus, (long long)(dt_us / 1000), rps);
+
+    if (s_abort) {
+        racp_respond(RACP_OP_ABORT, RACP_RSP_SUCCESS);
+    } else {
+        racp_respond(RACP_OP_REPORT_RECORDS, failed ? RACP_RSP_NOT_COMPLETED : RACP_RSP_SUCCESS);
+    }
+}
+
+static void ble_history_task(void *arg) {
+    (void)arg;
+    history_request_t req;
+
+    for (;;) {
+        if (xQueueReceive(s_requests, &req, portMAX_DELAY) != pdTRUE) continue;
+
+        s_abort = false;
+        if (req.op == RACP_OP_REPORT_NUM_RECORDS) {
+            uint32_t n = weigh_log_count_from(req.from_seq);
+            uint8_t rsp[4] = { RACP_OP_NUM_RECORDS_RSP, RACP_OPERATOR_NULL, 0, 0 };
+            put_le16(&rsp[2], n > 0xFFFF ? 0xFFFF : (uint16_t)n);
+            racp_indicate(rsp, sizeof(rsp));
+        } else if (req.op == RACP_OP_REPORT_RECORDS) {
+            stream_records(req.from_seq);
+        }
+        s_busy = false;
+    }
+}
+
+/* --------------------------- GATT access --------------------------- */
+
+// Parse operator + operand into a starting sequence number
+static uint8_t racp_parse_from(const uint8_t *buf, uint16_t len, uint32_t *from_seq) {
+    switch (buf[1]) {
+    case RACP_OPERATOR_ALL:
+        if (len != 2) return RACP_RSP_INVALID_OPERAND;
+        *from_seq = weigh_log_first_seq();
+        return RACP_RSP_SUCCESS;
+    case RACP_OPERATOR_LAST:
+        if (len != 2) return RACP_RSP_INVALID_OPERAND;
+        *from_seq = weigh_log_last_seq();
+        return RACP_RSP_SUCCESS;
+    case RACP_OPERATOR_GREATER_EQ:
+        // Filter type + 16-bit (standard) or 32-bit sequence number
+        if (len < 3 || buf[2] != RACP_FILTER_SEQ_NUMBER) return RACP_RSP_INVALID_OPERAND;
+        if (len == 5) {
+            *from_seq = (uint32_t)buf[3] | ((uint32_t)buf[4] << 8);
+        } else if (len == 7) {
+            *from_seq = (uint32_t)buf[3] | ((uint32_t)buf[4] << 8) |
+                        ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 24);
+        } else {
+            return RACP_RSP_INVALID_OPERAND;
+        }
+        return RACP_RSP_SUCCESS;
+    case RACP_OPERATOR_NULL:
+        return RACP_RSP_INVALID_OPERATOR;
+    default:
+        return RACP_RSP_OPERATOR_NOT_SUPP;
+    }
+}
+
+static int racp_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                          struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    uint8_t  buf[8];
+    uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+    if (len < 2 || len > sizeof(buf)) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+    os_mbuf_copydata(ctxt->om, 0, len, buf);
+
+    if (!s_racp_indicate) {
+        return BLE_ATT_ERR_CCCD_IMPROPERLY_CONFIGURED;
+    }
+
+    uint8_t op = buf[0];
+    if (op == RACP_OP_ABORT) {
+        if (buf[1] != RACP_OPERATOR_NULL || len != 2) {
+            racp_respond(op, RACP_RSP_INVALID_OPERATOR);
+        } else if (s_busy) {
+            s_abort = true;          // Sync task answers once it has stopped
+            xTaskNotifyGive(s_task);
+        } else {
+            racp_respond(op, RACP_RSP_SUCCESS);
+        }
+        return 0;
+    }
+
+    if (s_busy) {
+        return BLE_ATT_ERR_PROC_IN_PROGRESS;
+    }
+
+    if (op != RACP_OP_REPORT_RECORDS && op != RACP_OP_REPORT_NUM_RECORDS) {
+        racp_respond(op, RACP_RSP_OP_NOT_SUPPORTED);
+        return 0;
+    }
+    if (op == RACP_OP_REPORT_RECORDS && !s_records_notify) {
+        return BLE_ATT_ERR_CCCD_IMPROPERLY_CONFIGURED;
+    }
+
+    history_request_t req = { .op = op };
+    uint8_t status = racp_parse_from(buf, len, &req.from_seq);
+    if (status != RACP_RSP_SUCCESS) {
+        racp_respond(op, status);
+        return 0;
+    }
+
+    s_busy = true;
+    if (xQueueSend(s_requests, &req, 0) != pdTRUE) {
+        s_busy = false;
+        racp_respond(op, RACP_RSP_NOT_COMPLETED);
+    }
+    return 0;
+}
+
+static int records_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                             struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    // Notify-only; nothing to read or write
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
+static const struct ble_gatt_svc_def history_services[] = {
+    {
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = &history_service_uuid.u,
+        .characteristics = (struct ble_gatt_chr_def[]){
+            {
+                .uuid = BLE_UUID16_DECLARE(RACP_UUID16),
+                .access_cb = racp_access_cb,
+                .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_INDICATE,
+                .val_handle = &s_racp_handle,
+            },
+            {
+                .uuid = &history_records_uuid.u,
+                .access_cb = records_access_cb,
+                .flags = BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &s_records_handle,
+            },
+            { 0 } // End of characteristics.
+        },
+    },
+    { 0 } // End of services.
+};
+
+/* ----------------------------- Public ----------------------------- */
+
+void ble_history_on_gap_event(const struct ble_gap_event *event) {
+    switch (event->type) {
+    case BLE_GAP_EVENT_DISCONNECT:
+        s_racp_indicate = false;
+        s_records_notify = false;
+        if (s_busy) {
+            s_abort = true;
+        }
+        if (s_task) xTaskNotifyGive(s_task);
+        break;
+
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == s_racp_handle) {
+            s_racp_indicate = event->subscribe.cur_indicate;
+        } else if (event->subscribe.attr_handle == s_records_handle) {
+            s_records_notify = event->subscribe.cur_notify;
+        }
+        break;
+
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        // Each completed TX returns mbufs to the pool: let the streamer go on
+        if (s_task && event->notify_tx.attr_handle == s_records_handle) {
+            xTaskNotifyGive(s_task);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void ble_history_init(void) {
+    int rc = ble_gatts_count_cfg(history_services);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "ble_gatts_count_cfg() failed; rc=%d", rc);
+        return;
+    }
+    rc = ble_gatts_add_svcs(history_services);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "ble_gatts_add_svcs() failed; rc=%d", rc);
+        return;
+    }
+
+    s_requests = res_queue_create(RES_QUEUE_BLE_HISTORY, 0, 1, sizeof(history_request_t));
+    configASSERT(s_requests);
+    s_task = res_task_start(RES_TASK_BLE_HISTORY, 0, ble_history_task, NULL, NULL);
+}
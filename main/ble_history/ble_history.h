@@ -0,0 +1,69 @@
+// File: main/ble_history/ble_history.h
+#ifndef BLE_HISTORY_H
+#define BLE_HISTORY_H
+
+#include <stdint.h>
+#include "host/ble_gap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ---------------- Record Access Control Point (SIG 0x2A52) ---------------- */
+
+#define RACP_UUID16                 0x2A52
+
+// Op codes
+#define RACP_OP_REPORT_RECORDS      0x01
+#define RACP_OP_DELETE_RECORDS      0x02
+#define RACP_OP_ABORT               0x03
+#define RACP_OP_REPORT_NUM_RECORDS  0x04
+#define RACP_OP_NUM_RECORDS_RSP     0x05
+#define RACP_OP_RESPONSE_CODE       0x06
+
+// Operators
+#define RACP_OPERATOR_NULL          0x00
+#define RACP_OPERATOR_ALL           0x01
+#define RACP_OPERATOR_GREATER_EQ    0x03
+#define RACP_OPERATOR_LAST          0x06
+
+// Filter type for RACP_OPERATOR_GREATER_EQ: 32-bit record sequence number
+#define RACP_FILTER_SEQ_NUMBER      0x01
+
+// Response code values
+#define RACP_RSP_SUCCESS            0x01
+#define RACP_RSP_OP_NOT_SUPPORTED   0x02
+#define RACP_RSP_INVALID_OPERATOR   0x03
+#define RACP_RSP_OPERATOR_NOT_SUPP  0x04
+#define RACP_RSP_INVALID_OPERAND    0x05
+#define RACP_RSP_NO_RECORDS         0x06
+#define RACP_RSP_ABORT_FAILED       0x07
+#define RACP_RSP_NOT_COMPLETED      0x08
+
+/*
+ * History record on the wire (12 bytes, little-endian), packed back to back
+ * into each notification of the history characteristic:
+ *   seq u32 | unix time u32 (0 = unknown) | weight u16 (0.005 kg) |
+ *   user id u8 | flags u8 (reserved, 0)
+ */
+#define BLE_HISTORY_RECORD_LEN      12
+
+// Free msys mbufs kept back for other traffic while streaming
+#define BLE_HISTORY_MBUF_RESERVE    4
+
+/**
+ * @brief Register the weigh-in history service and start the sync task.
+ *        Call before the NimBLE host task is started.
+ */
+void ble_history_init(void);
+
+/**
+ * @brief Forward GAP events (disconnect, TX completion, subscriptions).
+ */
+void ble_history_on_gap_event(const struct ble_gap_event *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_HISTORY_H
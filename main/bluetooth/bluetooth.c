@@ -4,6 +4,8 @@
 #include "host/ble_hs.h" // Include the header for BLE host stack
 #include "services/gap/ble_svc_gap.h"
 #include "esp_log.h"
+#include "bluetooth_comm_gatt.h" // ble_gap_event(), WSS UUIDs
+#include <string.h>
 
  //static const char *TAG = "Bluetooth";
  static const char *TAG = "Bluetooth";
@@ -13,17 +15,33 @@ void ble_on_reset(int reason) {
     ESP_LOGI(TAG, "BLE stack reset; reason=%d", reason);
 }
 
-// Callback for BLE stack sync
-void ble_app_on_sync(void) {
-    ESP_LOGI(TAG, "BLE stack synced, starting advertising...");
+// Start connectable advertising, announcing the Weight Scale Service
+void start_advertising(void) {
+    struct ble_hs_adv_fields fields = {0};
+    static const ble_uuid16_t wss_uuid = BLE_UUID16_INIT(WSS_SERVICE_UUID16);
+    const char *name = ble_svc_gap_device_name();
+
+    fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+    fields.uuids16 = &wss_uuid;
+    fields.num_uuids16 = 1;
+    fields.uuids16_is_complete = 0;
+    fields.name = (const uint8_t *)name;
+    fields.name_len = strlen(name);
+    fields.name_is_complete = 1;
+
+    int rc = ble_gap_adv_set_fields(&fields);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Failed to set advertising data; rc=%d", rc);
+        return;
+    }
 
     // Set advertising parameters
     struct ble_gap_adv_params adv_params = {0};
     adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
     adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
 
-    // Start advertising
-    int rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER, &adv_params, NULL, NULL);
+    // Start advertising; connection events go to the GATT layer
+    rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER, &adv_params, ble_gap_event, NULL);
     if (rc != 0) {
         ESP_LOGE(TAG, "Failed to start advertising; rc=%d", rc); // Log the error code directly
     } else {
@@ -31,6 +49,12 @@ void ble_app_on_sync(void) {
     }
 }
 
+// Callback for BLE stack sync
+void ble_app_on_sync(void) {
+    ESP_LOGI(TAG, "BLE stack synced, starting advertising...");
+    start_advertising();
+}
+
 // NimBLE host task
 
 // BLE initialization
@@ -4,6 +4,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 // NimBLE headers
 #include "nimble/ble.h"
@@ -17,6 +18,7 @@
 #include "host/ble_hs_mbuf.h"  // For creating mbufs
 #include "bluetooth.h"
 #include "bluetooth_comm_gatt.h"
+#include "ble_history.h"
 
 // Logging tag
  static const char *TAG = "CUSTOM_GATT";
@@ -24,8 +26,11 @@
 // Global variable to track the current connection handle
 uint16_t current_conn_handle = BLE_HS_CONN_HANDLE_NONE;
 
-// Global variable for the characteristic handle
-uint16_t custom_chr_handle = 4; // Replace with dynamically obtained handle if possible
+// Global variable for the characteristic handle (filled in by the stack at registration)
+uint16_t custom_chr_handle = 0;
+
+// Weight Scale Service attribute handles (filled in by the stack at registration)
+static uint16_t wss_measurement_handle = 0;
 
 // Buffer to store data received from the client
 uint8_t received_data[128] = {0};
@@ -54,6 +59,32 @@ static const ble_uuid128_t custom_char_uuid =
                      0x12, 0x34,
                      0x56, 0x78);
 
+// Weight Scale Feature: timestamp + multiple users supported, 0.005 kg resolution
+#define WSS_FEATURES  (0x00000001u | 0x00000002u | (7u << 3))
+
+// Pending measurements, drained once per connection interval. Each entry
+// carries a sequence number so a flush removes exactly what it sent, even
+// when submit_weight replaced or shifted entries during the send.
+typedef struct {
+    wss_measurement_t m;
+    uint32_t          seq;
+} wss_pending_t;
+
+static wss_pending_t     wss_pending[WSS_PENDING_MAX];
+static int               wss_pending_count = 0;
+static uint32_t          wss_next_seq = 0;
+static portMUX_TYPE      wss_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t wss_flush_timer = NULL;
+
+// Link parameters of the current connection
+static uint32_t wss_conn_itvl_us   = 50000;   // Until the first connection event
+static uint16_t wss_att_mtu        = BLE_ATT_MTU_DFLT;
+static bool     wss_notify_enabled = false;
+static bool     wss_indicate_enabled = false;
+static bool     wss_indication_inflight = false;
+
+static void wss_flush(void *arg);
+
 // Access callback for the custom characteristic
 static int custom_access_cb(uint16_t conn_handle, uint16_t attr_handle,
                             struct ble_gatt_access_ctxt *ctxt, void *arg) {
@@ -84,6 +115,202 @@ static int custom_access_cb(uint16_t conn_handle, uint16_t attr_handle,
     }
 }
 
+/* ---------------------- Weight Scale Service ---------------------- */
+
+size_t wss_encode_measurement(const wss_measurement_t *m, uint8_t *buf, size_t len) {
+    if (!m || !buf) return 0;
+
+    uint8_t flags = 0;
+    bool has_time = false;
+    struct tm tm_utc;
+    if (m->timestamp > 0) {
+        gmtime_r(&m->timestamp, &tm_utc);
+        has_time = tm_utc.tm_year >= (2020 - 1900);
+    }
+    if (has_time)                          flags |= WSS_FLAG_TIMESTAMP;
+    if (m->user_id != WSS_USER_ID_UNKNOWN) flags |= WSS_FLAG_USER_ID;
+
+    size_t need = 3 + (has_time ? 7 : 0) + ((flags & WSS_FLAG_USER_ID) ? 1 : 0);
+    if (len < need) return 0;
+
+    // SI weight in units of 0.005 kg (5 g), little-endian
+    uint16_t w;
+    if (m->weight_g < 0.0f) {
+        w = 0;
+    } else if (m->weight_g >= 65535.0f * 5.0f) {
+        w = WSS_WEIGHT_UNSUCCESSFUL;
+    } else {
+        w = (uint16_t)((m->weight_g + 2.5f) / 5.0f);
+    }
+
+    size_t n = 0;
+    buf[n++] = flags;
+    buf[n++] = (uint8_t)(w & 0xFF);
+    buf[n++] = (uint8_t)(w >> 8);
+    if (has_time) {
+        uint16_t year = (uint16_t)(tm_utc.tm_year + 1900);
+        buf[n++] = (uint8_t)(year & 0xFF);
+        buf[n++] = (uint8_t)(year >> 8);
+        buf[n++] = (uint8_t)(tm_utc.tm_mon + 1);
+        buf[n++] = (uint8_t)tm_utc.tm_mday;
+        buf[n++] = (uint8_t)tm_utc.tm_hour;
+        buf[n++] = (uint8_t)tm_utc.tm_min;
+        buf[n++] = (uint8_t)tm_utc.tm_sec;
+    }
+    if (flags & WSS_FLAG_USER_ID) {
+        buf[n++] = m->user_id;
+    }
+    return n;
+}
+
+void bluetooth_comm_gatt_submit_weight(const wss_measurement_t *m) {
+    if (!m || current_conn_handle == BLE_HS_CONN_HANDLE_NONE) return;
+
+    bool arm = false;
+    taskENTER_CRITICAL(&wss_lock);
+    // A newer live reading supersedes one that has not gone out yet
+    // (a new sequence number, so a flush already sending the old one keeps it)
+    wss_pending_t e = { .m = *m, .seq = wss_next_seq++ };
+    if (!m->stable && wss_pending_count > 0 &&
+        !wss_pending[wss_pending_count - 1].m.stable) {
+        wss_pending[wss_pending_count - 1] = e;
+    } else if (wss_pending_count < WSS_PENDING_MAX) {
+        wss_pending[wss_pending_count++] = e;
+    } else if (m->stable) {
+        // Full: make room for the locked result by dropping the oldest entry
+        memmove(&wss_pending[0], &wss_pending[1],
+                sizeof(wss_pending[0]) * (WSS_PENDING_MAX - 1));
+        wss_pending[WSS_PENDING_MAX - 1] = e;
+    }
+    arm = wss_flush_timer && !esp_timer_is_active(wss_flush_timer);
+    taskEXIT_CRITICAL(&wss_lock);
+
+    if (arm) {
+        esp_timer_start_once(wss_flush_timer, wss_conn_itvl_us);
+    }
+}
+
+// Drain pending measurements into as few notifications/indications as fit the MTU
+static void wss_flush(void *arg) {
+    (void)arg;
+    if (current_conn_handle == BLE_HS_CONN_HANDLE_NONE) {
+        taskENTER_CRITICAL(&wss_lock);
+        wss_pending_count = 0;
+        taskEXIT_CRITICAL(&wss_lock);
+        return;
+    }
+
+    uint8_t  pdu[BLE_ATT_ATTR_MAX_LEN];
+    size_t   max_payload = wss_att_mtu > 3 ? (size_t)(wss_att_mtu - 3) : 20;
+    if (max_payload > sizeof(pdu)) max_payload = sizeof(pdu);
+
+    for (;;) {
+        wss_measurement_t batch[WSS_PENDING_MAX];
+        uint32_t batch_seq[WSS_PENDING_MAX];
+        int taken = 0;
+        bool stable_batch = false;
+
+        taskENTER_CRITICAL(&wss_lock);
+        if (wss_pending_count > 0) {
+            // A batch is either all locked results or all live readings
+            stable_batch = wss_pending[0].m.stable;
+            while (taken < wss_pending_count &&
+                   wss_pending[taken].m.stable == stable_batch &&
+                   (size_t)(taken + 1) * WSS_MEASUREMENT_MAX_LEN <= max_payload) {
+                batch[taken] = wss_pending[taken].m;
+                batch_seq[taken] = wss_pending[taken].seq;
+                taken++;
+            }
+        }
+        taskEXIT_CRITICAL(&wss_lock);
+
+        if (taken == 0) return;
+
+        bool use_indicate = stable_batch && wss_indicate_enabled;
+        if (use_indicate && wss_indication_inflight) {
+            // Wait for the confirmation of the previous indication
+            esp_timer_start_once(wss_flush_timer, wss_conn_itvl_us);
+            return;
+        }
+
+        size_t len = 0;
+        for (int i = 0; i < taken; i++) {
+            len += wss_encode_measurement(&batch[i], pdu + len, max_payload - len);
+        }
+
+        int rc = 0;
+        if (use_indicate || wss_notify_enabled) {
+            struct os_mbuf *om = ble_hs_mbuf_from_flat(pdu, len);
+            if (!om) {
+                // Out of mbufs: keep the batch and retry on the next interval
+                esp_timer_start_once(wss_flush_timer, wss_conn_itvl_us);
+                return;
+            }
+            if (use_indicate) {
+                rc = ble_gatts_indicate_custom(current_conn_handle, wss_measurement_handle, om);
+                if (rc == 0) wss_indication_inflight = true;
+            } else {
+                rc = ble_gatts_notify_custom(current_conn_handle, wss_measurement_handle, om);
+            }
+            if (rc != 0) {
+                ESP_LOGW(TAG, "Weight measurement send failed; rc=%d", rc);
+                esp_timer_start_once(wss_flush_timer, wss_conn_itvl_us);
+                return;
+            }
+        }
+
+        // Sent (or nobody subscribed): drop the sent entries by sequence
+        // number. A live reading replaced during the send has a new number
+        // and stays; entries shifted out by a full queue are simply gone.
+        taskENTER_CRITICAL(&wss_lock);
+        int kept = 0;
+        for (int i = 0; i < wss_pending_count; i++) {
+            bool sent = false;
+            for (int j = 0; j < taken && !sent; j++) {
+                sent = wss_pending[i].seq == batch_seq[j];
+            }
+            if (!sent) {
+                wss_pending[kept++] = wss_pending[i];
+            }
+        }
+        wss_pending_count = kept;
+        taskEXIT_CRITICAL(&wss_lock);
+
+        if (use_indicate) {
+            // Only one indication may be outstanding; continue after the ACK
+            if (wss_pending_count > 0) {
+                esp_timer_start_once(wss_flush_timer, wss_conn_itvl_us);
+            }
+            return;
+        }
+    }
+}
+
+// Refresh cached connection interval and MTU for the flush scheduler
+static void wss_update_link_params(uint16_t conn_handle) {
+    struct ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+        // conn_itvl is in units of 1.25 ms
+        wss_conn_itvl_us = (uint32_t)desc.conn_itvl * 1250u;
+    }
+    wss_att_mtu = ble_att_mtu(conn_handle);
+}
+
+static int wss_access_cb(uint16_t conn_handle, uint16_t attr_handle,
+                         struct ble_gatt_access_ctxt *ctxt, void *arg) {
+    uint16_t uuid = ble_uuid_u16(ctxt->chr->uuid);
+
+    if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR && uuid == WSS_FEATURE_UUID16) {
+        uint32_t features = WSS_FEATURES;
+        uint8_t  le[4] = {
+            (uint8_t)features, (uint8_t)(features >> 8),
+            (uint8_t)(features >> 16), (uint8_t)(features >> 24)
+        };
+        return os_mbuf_append(ctxt->om, le, sizeof(le)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+    return BLE_ATT_ERR_UNLIKELY;
+}
+
 // Define the custom GATT service and its characteristic
 static const struct ble_gatt_svc_def gatt_services[] = {
     {
@@ -99,6 +326,25 @@ static const struct ble_gatt_svc_def gatt_services[] = {
             { 0 } // End of characteristics.
         },
     },
+    {
+        // Weight Scale Service (SIG-assigned)
+        .type = BLE_GATT_SVC_TYPE_PRIMARY,
+        .uuid = BLE_UUID16_DECLARE(WSS_SERVICE_UUID16),
+        .characteristics = (struct ble_gatt_chr_def[]){
+            {
+                .uuid = BLE_UUID16_DECLARE(WSS_FEATURE_UUID16),
+                .access_cb = wss_access_cb,
+                .flags = BLE_GATT_CHR_F_READ,
+            },
+            {
+                .uuid = BLE_UUID16_DECLARE(WSS_MEASUREMENT_UUID16),
+                .access_cb = wss_access_cb,
+                .flags = BLE_GATT_CHR_F_INDICATE | BLE_GATT_CHR_F_NOTIFY,
+                .val_handle = &wss_measurement_handle,
+            },
+            { 0 } // End of characteristics.
+        },
+    },
     { 0 } // End of services.
 };
 
@@ -108,7 +354,12 @@ int ble_gap_event(struct ble_gap_event *event, void *arg) {
     case BLE_GAP_EVENT_CONNECT:
         if (event->connect.status == 0) {
             current_conn_handle = event->connect.conn_handle;
+            wss_update_link_params(current_conn_handle);
             ESP_LOGI(TAG, "Client connected; conn_handle=%d", current_conn_handle);
+
+            // Ask for the largest ATT MTU and LE data length the peer accepts
+            ble_gattc_exchange_mtu(current_conn_handle, NULL, NULL);
+            ble_gap_set_data_len(current_conn_handle, BLE_DATA_LEN_MAX_OCTETS, BLE_DATA_LEN_MAX_TIME_US);
         } else {
             ESP_LOGE(TAG, "Connection failed; status=%d", event->connect.status);
         }
@@ -117,19 +368,46 @@ int ble_gap_event(struct ble_gap_event *event, void *arg) {
     case BLE_GAP_EVENT_DISCONNECT:
         ESP_LOGI(TAG, "Client disconnected; conn_handle=%d", event->disconnect.conn.conn_handle);
         current_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        wss_notify_enabled = false;
+        wss_indicate_enabled = false;
+        wss_indication_inflight = false;
+        wss_att_mtu = BLE_ATT_MTU_DFLT;
         // Restart advertising after a disconnect.
-        {
-            struct ble_gap_adv_params adv_params = {0};
-            int rc = ble_gap_adv_start(BLE_OWN_ADDR_PUBLIC, NULL, BLE_HS_FOREVER, &adv_params, NULL, NULL);
-            if (rc != 0) {
-                ESP_LOGE(TAG, "Error restarting advertisement; rc=%d", rc);
-            }
+        start_advertising();
+        break;
+
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        if (event->conn_update.status == 0) {
+            wss_update_link_params(event->conn_update.conn_handle);
+        }
+        break;
+
+    case BLE_GAP_EVENT_MTU:
+        wss_att_mtu = event->mtu.value;
+        ESP_LOGI(TAG, "ATT MTU updated; mtu=%d", wss_att_mtu);
+        break;
+
+    case BLE_GAP_EVENT_SUBSCRIBE:
+        if (event->subscribe.attr_handle == wss_measurement_handle) {
+            wss_notify_enabled   = event->subscribe.cur_notify;
+            wss_indicate_enabled = event->subscribe.cur_indicate;
+        }
+        break;
+
+    case BLE_GAP_EVENT_NOTIFY_TX:
+        // Indication confirmed (EDONE) or timed out: allow the next one
+        if (event->notify_tx.indication &&
+            event->notify_tx.attr_handle == wss_measurement_handle &&
+            event->notify_tx.status != 0) {
+            wss_indication_inflight = false;
         }
         break;
 
     default:
         break;
     }
+
+    ble_history_on_gap_event(event);
     return 0;
 }
 
@@ -169,6 +447,11 @@ void set_notifications_enabled(bool enabled) {
     ESP_LOGI(TAG, "Notifications %s", enabled ? "enabled" : "disabled");
 }
 
+// Send raw bytes on the custom characteristic
+void bluetooth_comm_gatt_send_data(const uint8_t *data, size_t len) {
+    custom_send_notification(data, (uint16_t)len);
+}
+
 // Callback executed when the NimBLE host is synchronized
 
 // BLE host task
@@ -195,7 +478,16 @@ void custom_gatt_init(void) {
         ESP_LOGE(TAG, "ble_gatts_add_svcs() failed; rc=%d", rc);
         return;
     }
-    ESP_LOGI(TAG, "Assuming characteristic handle is %d", custom_chr_handle);
+    ble_history_init();
+    ble_att_set_preferred_mtu(BLE_ATT_MTU_MAX);
+
+    const esp_timer_create_args_t flush_args = {
+        .callback = wss_flush,
+        .name     = "wss_flush",
+    };
+    if (esp_timer_create(&flush_args, &wss_flush_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create weight measurement flush timer");
+    }
 
     // Start the BLE host task.
     nimble_port_freertos_init(ble_host_task);
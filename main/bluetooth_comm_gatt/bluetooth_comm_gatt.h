@@ -1,7 +1,11 @@
+
 #ifndef BLUETOOTH_COMM_GATT_H
 #define BLUETOOTH_COMM_GATT_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
 #include "nimble/ble.h"
 #include "host/ble_hs.h"
 #include "host/ble_gap.h"
@@ -12,9 +16,6 @@
 extern "C" {
 #endif
 
-// Logging tag
-static const char *TAG;
-
 // Global variable to track the current connection handle
 extern uint16_t current_conn_handle;
 
@@ -28,6 +29,63 @@ extern size_t received_data_len;
 // Enable or disable notifications (1 = enabled, 0 = disabled)
 #define ENABLE_NOTIFICATIONS 1
 
+/* ---------------- Weight Scale Service (Bluetooth SIG 0x181D) ---------------- */
+
+#define WSS_SERVICE_UUID16          0x181D
+#define WSS_MEASUREMENT_UUID16      0x2A9D   // Weight Measurement (indicate/notify)
+#define WSS_FEATURE_UUID16          0x2A9E   // Weight Scale Feature (read)
+
+// Weight Measurement flags field (WSS 1.0, Weight Measurement characteristic)
+#define WSS_FLAG_UNITS_IMPERIAL     0x01     // 0 = SI (kg), 1 = imperial (lb)
+#define WSS_FLAG_TIMESTAMP          0x02     // 7-byte Date Time follows weight
+#define WSS_FLAG_USER_ID            0x04     // 1-byte user index follows timestamp
+#define WSS_FLAG_BMI_HEIGHT         0x08     // BMI + height follow (not used)
+
+#define WSS_USER_ID_UNKNOWN         0xFF
+#define WSS_WEIGHT_UNSUCCESSFUL     0xFFFF   // "Measurement unsuccessful" marker
+
+// flags(1) + weight(2) + timestamp(7) + user id(1)
+#define WSS_MEASUREMENT_MAX_LEN     11
+
+// LE Data Length Extension request (max PDU payload and its airtime on 1M PHY)
+#define BLE_DATA_LEN_MAX_OCTETS     251
+#define BLE_DATA_LEN_MAX_TIME_US    2120
+
+// Measurements held back while waiting for the next connection event
+#define WSS_PENDING_MAX             16
+
+/**
+ * @brief One weigh-in as handed over by the weight manager.
+ *
+ * `stable` readings are the locked result of a weigh-in and are sent as
+ * indications (standard collectors subscribe to those); live readings are
+ * coalesced and sent as notifications when the client enabled them.
+ */
+typedef struct {
+    float    weight_g;    // Calibrated weight in grams
+    time_t   timestamp;   // Wall-clock time, 0 if not known
+    uint8_t  user_id;     // WSS user index or WSS_USER_ID_UNKNOWN
+    bool     stable;      // Locked result rather than a live reading
+} wss_measurement_t;
+
+/**
+ * @brief Encode a measurement in the Weight Measurement wire format.
+ * @param m    Measurement to encode
+ * @param buf  Output buffer
+ * @param len  Size of `buf` (≥ WSS_MEASUREMENT_MAX_LEN is always enough)
+ * @return Number of bytes written, 0 if `buf` is too small
+ */
+size_t wss_encode_measurement(const wss_measurement_t *m, uint8_t *buf, size_t len);
+
+/**
+ * @brief Queue a measurement for the Weight Measurement characteristic.
+ *
+ * Safe to call from any task. Live readings replace a not-yet-sent live
+ * reading; everything pending is flushed once per connection interval and
+ * packed into as few ATT PDUs as the negotiated MTU allows.
+ */
+void bluetooth_comm_gatt_submit_weight(const wss_measurement_t *m);
+
 
 // Function to initialize the custom GATT service
 void custom_gatt_init(void);
@@ -52,4 +110,4 @@ void bluetooth_comm_gatt_send_data(const uint8_t *data, size_t len);
 }
 #endif
 
-#endif // BLUETOOTH_COMM_GATT_H
\ No newline at end of file
+#endif // BLUETOOTH_COMM_GATT_H
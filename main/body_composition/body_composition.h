@@ -23,6 +23,14 @@ typedef struct {
     float lean_mass_kg;
 } body_composition_t;
 
-bool calculate_body_composition(const body_input_t *input, body_composition_t *output);
+/**
+ * @brief U.S. Navy circumference estimate applied to a measured weight.
+ *        Pure computation: results are stored by the caller (user_profiles).
+ * @param input      Body measurements of the person on the scale
+ * @param weight_kg  Locked weight of this weigh-in
+ * @param output     Body fat %, fat and lean mass
+ * @return false if the measurements are missing or out of the formula's domain
+ */
+bool calculate_body_composition(const body_input_t *input, float weight_kg, body_composition_t *output);
 
 #endif // BODY_COMPOSITION_H
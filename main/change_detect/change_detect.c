@@ -0,0 +1,68 @@
+#include "change_detect.h"
+#include <math.h>
+
+void change_detect_init(change_detect_t *cd) {
+    if (!cd) return;
+    cd->mean = 0.0f;
+    cd->var = CD_SIGMA_INIT_G * CD_SIGMA_INIT_G;
+    cd->g_pos = 0.0f;
+    cd->g_neg = 0.0f;
+    cd->k_sigma = CD_K_SIGMA;
+    cd->h_sigma = CD_H_SIGMA;
+    cd->primed = false;
+    cd->changes = 0;
+}
+
+void change_detect_set_params(change_detect_t *cd, float k_sigma, float h_sigma) {
+    if (!cd || !(k_sigma > 0.0f) || !(h_sigma > k_sigma)) return;
+    cd->k_sigma = k_sigma;
+    cd->h_sigma = h_sigma;
+}
+
+float change_detect_sigma(const change_detect_t *cd) {
+    if (!cd) return CD_SIGMA_INIT_G;
+    return fmaxf(sqrtf(cd->var), CD_SIGMA_MIN_G);
+}
+
+cd_event_t change_detect_update(change_detect_t *cd, float grams) {
+    if (!cd) return CD_EVENT_NONE;
+
+    if (!cd->primed) {
+        cd->mean = grams;
+        cd->primed = true;
+        return CD_EVENT_NONE;
+    }
+
+    float sigma = change_detect_sigma(cd);
+    float k = cd->k_sigma * sigma;
+    float h = cd->h_sigma * sigma;
+    float s = grams - cd->mean;
+
+    cd->g_pos = fmaxf(0.0f, cd->g_pos + s - k);
+    cd->g_neg = fmaxf(0.0f, cd->g_neg - s - k);
+
+    cd_event_t ev = CD_EVENT_NONE;
+    if (cd->g_pos > h) {
+        ev = CD_EVENT_UP;
+    } else if (cd->g_neg > h) {
+        ev = CD_EVENT_DOWN;
+    }
+
+    if (ev != CD_EVENT_NONE) {
+        // Restart from the new level; keep the noise estimate
+        cd->mean = grams;
+        cd->g_pos = 0.0f;
+        cd->g_neg = 0.0f;
+        cd->changes++;
+    } else {
+        // Learn the noise floor from samples within 3 sigma, and follow
+        // slow drift only while no change is building up
+        if (fabsf(s) < 3.0f * sigma) {
+            cd->var += CD_VAR_ALPHA * (s * s - cd->var);
+        }
+        if (cd->g_pos == 0.0f && cd->g_neg == 0.0f) {
+            cd->mean += CD_MEAN_ALPHA * s;
+        }
+    }
+    return ev;
+}
@@ -0,0 +1,68 @@
+#ifndef CHANGE_DETECT_H
+#define CHANGE_DETECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Default drift allowance k and alarm threshold h, in multiples of the
+// noise floor (change_detect_set_params() overrides them per instance)
+#ifndef CD_K_SIGMA
+#define CD_K_SIGMA          1.5f
+#endif
+#ifndef CD_H_SIGMA
+#define CD_H_SIGMA          5.0f
+#endif
+
+// Noise floor bounds and tracking rates (grams)
+#ifndef CD_SIGMA_INIT_G
+#define CD_SIGMA_INIT_G     5.0f    // Until enough quiet samples were seen
+#endif
+#ifndef CD_SIGMA_MIN_G
+#define CD_SIGMA_MIN_G      0.5f    // Never more sensitive than this
+#endif
+#define CD_MEAN_ALPHA       0.05f   // Reference mean tracking while in control
+#define CD_VAR_ALPHA        0.02f   // Noise variance tracking while in control
+
+typedef enum {
+    CD_EVENT_NONE = 0,
+    CD_EVENT_UP,        // Load increased (step on / item added)
+    CD_EVENT_DOWN       // Load decreased (step off / item removed)
+} cd_event_t;
+
+/*
+ * Two-sided CUSUM on calibrated weight. The reference mean follows drift
+ * only while both sums are at zero and the noise floor learns from samples
+ * within 3 sigma, so a change never leaks into its own baseline.
+ * O(1) per sample, no buffers.
+ */
+typedef struct {
+    float mean;         // Reference level (grams)
+    float var;          // Noise variance estimate (grams²)
+    float g_pos;        // Upward cumulative sum
+    float g_neg;        // Downward cumulative sum
+    float k_sigma;      // Drift allowance (multiples of the noise floor)
+    float h_sigma;      // Alarm threshold (multiples of the noise floor)
+    bool  primed;       // First sample seen
+    uint32_t changes;   // Change points detected since init
+} change_detect_t;
+
+void change_detect_init(change_detect_t *cd);
+
+// Retune k and h (in sigmas) without losing the learnt level and noise floor
+void change_detect_set_params(change_detect_t *cd, float k_sigma, float h_sigma);
+
+// Feed one sample in grams; returns the change point it completes, if any
+cd_event_t change_detect_update(change_detect_t *cd, float grams);
+
+// Current noise floor estimate (grams, ≥ CD_SIGMA_MIN_G)
+float change_detect_sigma(const change_detect_t *cd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHANGE_DETECT_H
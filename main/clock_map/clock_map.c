@@ -0,0 +1,142 @@
+// File: main/clock_map/clock_map.c
+// ---------------------------------------------------------------------------
+// Monotonic → wall-clock mapping
+//   - Boot counter in NVS qualifies monotonic stamps across reboots
+//   - One entry per boot, refreshed on every SNTP sync, newest first
+//   - Lookups are lock-free for readers of the current boot
+// ---------------------------------------------------------------------------
+
+#include "clock_map.h"
+
+#include <string.h>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "log_utils.h"
+
+static const char *TAG = "ClockMap";
+
+#define CLOCK_MAP_NVS_NS    "clockmap"
+#define CLOCK_MAP_KEY_BOOT  "boot"
+#define CLOCK_MAP_KEY_TABLE "table"
+
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+static clock_map_entry_t s_table[CLOCK_MAP_ENTRIES];   // [0] = newest
+static int               s_count = 0;
+static uint32_t          s_boot_id = 0;
+static volatile bool     s_synced = false;             // s_table[0] is this boot
+static int64_t           s_offset_us = 0;              // wall - mono for this boot
+
+static void save_table(void) {
+    nvs_handle_t h;
+    if (nvs_open(CLOCK_MAP_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+
+    clock_map_entry_t copy[CLOCK_MAP_ENTRIES];
+    int n;
+    taskENTER_CRITICAL(&s_lock);
+    n = s_count;
+    memcpy(copy, s_table, sizeof(copy));
+    taskEXIT_CRITICAL(&s_lock);
+
+    nvs_set_blob(h, CLOCK_MAP_KEY_TABLE, copy, (size_t)n * sizeof(copy[0]));
+    nvs_commit(h);
+    nvs_close(h);
+}
+
+esp_err_t clock_map_init(void) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(CLOCK_MAP_NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "NVS unavailable (%s), stamps stay boot-relative", esp_err_to_name(err));
+        return err;
+    }
+
+    uint32_t boot = 0;
+    nvs_get_u32(h, CLOCK_MAP_KEY_BOOT, &boot);
+    s_boot_id = boot + 1;
+    nvs_set_u32(h, CLOCK_MAP_KEY_BOOT, s_boot_id);
+
+    size_t len = sizeof(s_table);
+    if (nvs_get_blob(h, CLOCK_MAP_KEY_TABLE, s_table, &len) == ESP_OK) {
+        s_count = (int)(len / sizeof(s_table[0]));
+    }
+    nvs_commit(h);
+    nvs_close(h);
+
+    LOG_ROW(TAG, "Boot #%" PRIu32 ", %d earlier boot(s) mapped", s_boot_id, s_count);
+    return ESP_OK;
+}
+
+int64_t clock_map_mono_us(void) {
+    return esp_timer_get_time();
+}
+
+uint32_t clock_map_boot_id(void) {
+    return s_boot_id;
+}
+
+uint8_t clock_map_boot_tag(void) {
+    return (uint8_t)(s_boot_id & CLOCK_MAP_BOOT_TAG_MASK);
+}
+
+void clock_map_on_sync(void) {
+    struct timeval tv;
+    int64_t mono = esp_timer_get_time();
+    gettimeofday(&tv, NULL);
+
+    clock_map_entry_t e = {
+        .boot_id = s_boot_id,
+        .mono_us = mono,
+        .wall_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec,
+    };
+
+    taskENTER_CRITICAL(&s_lock);
+    if (s_count > 0 && s_table[0].boot_id == s_boot_id) {
+        s_table[0] = e;                 // Re-sync: latest mapping wins
+    } else {
+        int keep = s_count < CLOCK_MAP_ENTRIES ? s_count : CLOCK_MAP_ENTRIES - 1;
+        memmove(&s_table[1], &s_table[0], (size_t)keep * sizeof(s_table[0]));
+        s_table[0] = e;
+        s_count = keep + 1;
+    }
+    s_offset_us = e.wall_us - e.mono_us;
+    s_synced = true;
+    taskEXIT_CRITICAL(&s_lock);
+
+    save_table();
+}
+
+bool clock_map_wall_known(void) {
+    return s_synced;
+}
+
+time_t clock_map_to_wall(int64_t mono_us) {
+    if (!s_synced) return 0;
+    int64_t offset;
+    taskENTER_CRITICAL(&s_lock);
+    offset = s_offset_us;
+    taskEXIT_CRITICAL(&s_lock);
+    return (time_t)((mono_us + offset) / 1000000);
+}
+
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall) {
+    bool found = false;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < s_count; i++) {
+        // Tags repeat every CLOCK_MAP_BOOT_TAG_MASK + 1 boots and a stamp is
+        // taken as coming from the latest boot with its tag, so an entry
+        // further back than that belongs to another boot with the same tag
+        if (s_boot_id - s_table[i].boot_id > CLOCK_MAP_BOOT_TAG_MASK) continue;
+        if ((s_table[i].boot_id & CLOCK_MAP_BOOT_TAG_MASK) == boot_tag) {
+            if (wall) {
+                *wall = (time_t)((s_table[i].wall_us + (mono_us - s_table[i].mono_us)) / 1000000);
+            }
+            found = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return found;
+}
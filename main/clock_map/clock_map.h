@@ -0,0 +1,78 @@
+// File: main/clock_map/clock_map.h
+#ifndef CLOCK_MAP_H
+#define CLOCK_MAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every sample and event is stamped in one monotonic domain: microseconds
+ * since boot from esp_timer, qualified by a boot counter kept in NVS. Each
+ * SNTP sync records (boot, monotonic, wall) in a small persistent table,
+ * so anything stamped before the sync - in this boot or an earlier one
+ * that synced later - can be turned into wall-clock time when it is read.
+ */
+
+// Boots remembered in the mapping table
+#ifndef CLOCK_MAP_ENTRIES
+#define CLOCK_MAP_ENTRIES       8
+#endif
+
+// Stored records carry only the low bits of the boot counter
+#define CLOCK_MAP_BOOT_TAG_MASK 0x7F
+
+typedef struct {
+    uint32_t boot_id;   // Boot counter value
+    int64_t  mono_us;   // esp_timer time at the sync
+    int64_t  wall_us;   // Unix time at the sync (µs)
+} clock_map_entry_t;
+
+/**
+ * @brief Advance the boot counter and load the mapping table.
+ *        NVS must already be initialised. Never waits for SNTP.
+ */
+esp_err_t clock_map_init(void);
+
+/** @brief Monotonic time of this boot (µs since boot). */
+int64_t clock_map_mono_us(void);
+
+/** @brief Boot counter of this boot. */
+uint32_t clock_map_boot_id(void);
+
+/** @brief Boot counter reduced to CLOCK_MAP_BOOT_TAG_MASK for records. */
+uint8_t clock_map_boot_tag(void);
+
+/** @brief Record a mapping for this boot; called on every SNTP sync. */
+void clock_map_on_sync(void);
+
+/** @brief True once this boot has been mapped to wall-clock time. */
+bool clock_map_wall_known(void);
+
+/**
+ * @brief Wall-clock time for a monotonic stamp of this boot.
+ * @return Unix seconds, 0 while this boot has no mapping
+ */
+time_t clock_map_to_wall(int64_t mono_us);
+
+/**
+ * @brief Re-base a stamp from any remembered boot.
+ * @param boot_tag  Boot counter & CLOCK_MAP_BOOT_TAG_MASK
+ * @param mono_us   Monotonic stamp within that boot
+ * @param wall      Receives Unix seconds on success
+ * @return false if that boot never synced (or was forgotten), or its only
+ *         mapping is more than CLOCK_MAP_BOOT_TAG_MASK boots old and so
+ *         cannot be told apart from a later boot with the same tag
+ */
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLOCK_MAP_H
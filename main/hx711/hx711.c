@@ -2,9 +2,21 @@
 #include "driver/gpio.h"
 #include "rom/ets_sys.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
 #include <math.h>
 #include "moving_average.h"
 #include "kalman_filter.h"
+#include "median_filter.h"
+#include "change_detect.h"
+#include "scale_config.h"
+#include "esp_timer.h"
+#include "resources.h"
+#include "jitter_monitor.h"
+#include "esp_log.h"
+
+static const char *TAG = "HX711";
 
 
 // Add these helper macros at the top of the file (after includes)
@@ -20,19 +32,53 @@
 // Static variables
 static int s_ma_window = 0;
 static moving_avg_t s_ma;
-static float *s_ma_buf = NULL;
+static float s_ma_buf[HX711_MA_WINDOW_MAX];
 static bool s_use_kf = false;
 static KalmanFilter s_kf;
 
-// Step-aware boosting parameters
-#define STEP_THRESHOLD   1000.0f
-#define BOOSTED_Q        10.0f
-#define NORMAL_Q         0.5f
-#define BOOST_SAMPLES    5
-
+// Step-aware boosting; thresholds, Q levels and bounds live in scale_config
 static int s_boost_count = 0;
 static float s_last_output = 0.0f;
 
+// Change-point detection in calibrated units (hx711_set_calibration)
+static const calibration_t *s_calib = NULL;
+static change_detect_t      s_cd;
+static volatile uint32_t    s_change_seq = 0;
+static volatile cd_event_t  s_change_dir = CD_EVENT_NONE;
+
+// Live configuration: one lock-free reader, re-applied on version change
+static int      s_cfg_reader = -1;
+static uint32_t s_cfg_applied = UINT32_MAX;
+
+// Streaming median front end (hx711_read_median_rtos)
+static median_filter_t s_median;
+static float s_median_fbuf[2 * SCALE_CFG_MEDIAN_MAX];
+static int   s_median_ibuf[2 * SCALE_CFG_MEDIAN_MAX];
+static bool s_median_ready = false;
+
+// Data-ready handoff: the DOUT interrupt wakes the sampling task (and the
+// chip, in low-power mode); without it the task falls back to polling
+static TaskHandle_t     s_sample_task = NULL;
+static volatile bool    s_low_power = false;
+static bool             s_irq_ready = false;
+static volatile int64_t s_ready_us = 0;
+
+// SCK must not stay high for more than 60 µs or the HX711 powers down
+static portMUX_TYPE     s_sck_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Sensor health (hx711_read_raw_checked); the state is read lock-free
+static portMUX_TYPE            s_health_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile hx711_health_t s_health = HX711_HEALTH_OK;
+static hx711_health_stats_t    s_health_stats;
+static int                     s_timeout_run = 0;
+static int                     s_good_run = 0;
+static int                     s_same_run = 0;
+static int32_t                 s_prev_raw = 0;
+static int32_t                 s_last_good_raw = 0;
+static bool                    s_reseed = false;   // Filters start over at the next good sample
+
+static bool hx711_wait_dout(hx711_t *scale, uint32_t timeout_ms);
+
 // Helper function to get current moving average value
 static float get_moving_average_value(moving_avg_t *ma) {
     if (ma->count == 0) return 0.0f;
@@ -55,20 +101,17 @@ void hx711_init(hx711_t *scale,
     scale->mutex = NULL;
     scale->data_queue = NULL;
 
+    gpio_hold_dis(sck);     // Held high (powered down) through deep sleep
     gpio_reset_pin(sck);
     gpio_set_direction(sck, GPIO_MODE_OUTPUT);
     gpio_reset_pin(dout);
     gpio_set_direction(dout, GPIO_MODE_INPUT);
+    gpio_set_pull_mode(dout, GPIO_PULLUP_ONLY);   // Unplugged chip reads as never ready
 
-    // Moving-average setup
-    s_ma_window = ma_window;
-    if (ma_window > 0) {
-        s_ma_buf = malloc(sizeof(float) * ma_window);
-        if (s_ma_buf) {
-            moving_average_init(&s_ma, s_ma_buf, ma_window);
-        } else {
-            s_ma_window = 0;
-        }
+    // Moving-average setup (window clamped to the static buffer)
+    s_ma_window = min(ma_window, HX711_MA_WINDOW_MAX);
+    if (s_ma_window > 0) {
+        moving_average_init(&s_ma, s_ma_buf, s_ma_window);
     }
 
     // Kalman filter setup
@@ -80,9 +123,14 @@ void hx711_init(hx711_t *scale,
     // Reset boosting state
     s_boost_count = 0;
     s_last_output = 0.0f;
-
-    // Prime filters with one raw read
-    int32_t raw0 = hx711_read_raw(scale);
+    s_cfg_applied = UINT32_MAX;
+
+    // Prime filters with one raw read; without one they start over at the
+    // first sample that arrives. The chip may have just powered up (boot,
+    // deep-sleep wake), so the first conversion gets the settling time
+    int32_t raw0 = 0;
+    hx711_wait_dout(scale, HX711_READY_TIMEOUT_MS);
+    s_reseed = hx711_read_raw_checked(scale, &raw0) != ESP_OK;
     if (s_ma_window > 0) {
         moving_average_update(&s_ma, (float)raw0);
     }
@@ -97,6 +145,7 @@ void hx711_init(hx711_t *scale,
 }
 
 static QueueHandle_t hx711_q = NULL;
+static StaticSemaphore_t s_mutex_buf;
 
 void hx711_init_rtos(hx711_t *scale,
     gpio_num_t dout,
@@ -105,11 +154,10 @@ void hx711_init_rtos(hx711_t *scale,
     int ma_window,
     bool use_kf,
     float Q_init,
-    float R_init,
-    UBaseType_t task_priority)
+    float R_init)
 {
 // 1) Create one queue and assign it both to the static handle and to the scale
-hx711_q = xQueueCreate(8, sizeof(float));    // 8-element float queue
+hx711_q = res_queue_create(RES_QUEUE_SAMPLES, 0, 8, sizeof(float));    // 8-element float queue
 configASSERT(hx711_q);
 
 // 2) Initialize the core driver (filters, pins, etc.)
@@ -119,16 +167,117 @@ hx711_init(scale, dout, sck, gain, ma_window, use_kf, Q_init, R_init);
 scale->data_queue = hx711_q;
 
 // 4) Create mutex for raw access
-scale->mutex = xSemaphoreCreateMutex();
+scale->mutex = xSemaphoreCreateMutexStatic(&s_mutex_buf);
 configASSERT(scale->mutex);
 
-// 5) Launch the RTOS sampling task
-xTaskCreate(hx711_rtos_task,      // task function
-"HX711_Task",         // name
-4096,                 // stack size
-scale,                // parameter
-task_priority,        // priority
-NULL);                // no handle needed
+// Filter parameters follow live configuration (scale_config_init() first)
+if (s_cfg_reader < 0) {
+    s_cfg_reader = scale_config_register_reader("hx711");
+}
+
+// 5) Launch the RTOS sampling task from its reserved stack, pinned to the
+//    sampling core at the top application priority (resources.h)
+res_task_start(RES_TASK_HX711,      // static slot
+0,                    // instance
+hx711_rtos_task,      // task function
+NULL,                 // table name ("HX711_Task")
+scale);               // parameter
+}
+
+void hx711_set_kalman_model(hx711_t *scale, kalman_model_t model,
+                            float process_noise, float measurement_noise)
+{
+    if (scale->mutex) xSemaphoreTake(scale->mutex, portMAX_DELAY);
+    s_use_kf = true;
+    if (model == KALMAN_MODEL_CONST_VELOCITY) {
+        kalman_init_cv(&s_kf, process_noise, measurement_noise, s_last_output);
+    } else {
+        kalman_init_adaptive(&s_kf, process_noise, measurement_noise);
+        s_kf.x_est = s_last_output;
+    }
+    s_boost_count = 0;
+    s_cfg_applied = UINT32_MAX;   // Re-apply the configured bounds
+    if (scale->mutex) xSemaphoreGive(scale->mutex);
+}
+
+void hx711_set_calibration(hx711_t *scale, const calibration_t *calib)
+{
+    if (scale->mutex) xSemaphoreTake(scale->mutex, portMAX_DELAY);
+    s_calib = calib;
+    change_detect_init(&s_cd);
+    s_cfg_applied = UINT32_MAX;   // Re-apply the configured k and h
+    if (scale->mutex) xSemaphoreGive(scale->mutex);
+}
+
+uint32_t hx711_get_change_seq(cd_event_t *direction)
+{
+    uint32_t seq;
+    cd_event_t dir;
+    do {
+        seq = s_change_seq;
+        dir = s_change_dir;
+    } while (seq != s_change_seq);
+    if (direction) *direction = dir;
+    return seq;
+}
+
+float hx711_get_noise_floor(void)
+{
+    return s_calib ? change_detect_sigma(&s_cd) : 0.0f;
+}
+
+void hx711_save_state(hx711_t *scale, hx711_filter_state_t *out)
+{
+    if (scale->mutex) xSemaphoreTake(scale->mutex, portMAX_DELAY);
+    out->kf = s_kf;
+    out->kf.mutex = NULL;
+    out->cd = s_cd;
+    out->ma_window = (int16_t)s_ma_window;
+    if (s_ma_window > 0) {
+        memcpy(out->ma_buf, s_ma_buf, sizeof(out->ma_buf));
+        out->ma_sum = s_ma.sum;
+        out->ma_count = (int16_t)s_ma.count;
+        out->ma_index = (int16_t)s_ma.index;
+    }
+    out->use_kf = s_use_kf;
+    out->last_output = s_last_output;
+    out->last_raw = s_last_good_raw;
+    if (scale->mutex) xSemaphoreGive(scale->mutex);
+}
+
+bool hx711_restore_state(hx711_t *scale, const hx711_filter_state_t *in)
+{
+    if (in->ma_window != s_ma_window || in->use_kf != s_use_kf ||
+        (s_use_kf && in->kf.model != s_kf.model)) {
+        return false;
+    }
+    if (scale->mutex) xSemaphoreTake(scale->mutex, portMAX_DELAY);
+    if (s_use_kf) {
+        SemaphoreHandle_t kf_mutex = s_kf.mutex;
+        StaticSemaphore_t kf_mutex_buf = s_kf.mutex_buf;
+        s_kf = in->kf;
+        s_kf.mutex = kf_mutex;
+        s_kf.mutex_buf = kf_mutex_buf;
+    }
+    s_cd = in->cd;
+    if (s_ma_window > 0) {
+        memcpy(s_ma_buf, in->ma_buf, sizeof(s_ma_buf));
+        s_ma.sum = in->ma_sum;
+        s_ma.count = in->ma_count;
+        s_ma.index = in->ma_index;
+    }
+    s_last_output = in->last_output;
+    s_last_good_raw = in->last_raw;
+    s_boost_count = 0;
+    s_reseed = false;
+    if (scale->mutex) xSemaphoreGive(scale->mutex);
+    return true;
+}
+
+void hx711_power_down(hx711_t *scale)
+{
+    gpio_set_level(scale->sck_pin, 1);
+    ets_delay_us(100);
 }
 
 QueueHandle_t hx711_get_queue(void)
@@ -146,25 +295,123 @@ void hx711_deinit(hx711_t *scale)
         vSemaphoreDelete(scale->mutex);
         scale->mutex = NULL;
     }
-    if (scale->data_queue) {
-        vQueueDelete(scale->data_queue);
-        scale->data_queue = NULL;
-    }
+    // The sample queue lives in reserved storage and is reused by the
+    // next hx711_init_rtos(), so it is only detached here
+    scale->data_queue = NULL;
     if (s_ma_window > 0) {
         moving_average_deinit(&s_ma);
         s_ma_window = 0;
     }
+    if (s_median_ready) {
+        median_filter_deinit(&s_median);
+        s_median_ready = false;
+    }
 }
 
-int32_t hx711_read_raw(hx711_t *scale)
+/* ---------------------------- Sensor health ---------------------------- */
+
+const char *hx711_health_name(hx711_health_t state)
 {
-    // Wait for DOUT to go low (data ready)
+    switch (state) {
+        case HX711_HEALTH_OK:       return "ok";
+        case HX711_HEALTH_DEGRADED: return "degraded";
+        default:                    return "offline";
+    }
+}
+
+/** Fold one read outcome into the health state (see hx711.h) */
+static void health_record(esp_err_t outcome)
+{
+    taskENTER_CRITICAL(&s_health_lock);
+    hx711_health_t prev = s_health;
+    hx711_health_t next = prev;
+    switch (outcome) {
+        case ESP_OK:
+            s_timeout_run = 0;
+            if (prev == HX711_HEALTH_OFFLINE) {
+                s_good_run = 0;
+                next = HX711_HEALTH_DEGRADED;
+            } else if (prev == HX711_HEALTH_DEGRADED && ++s_good_run >= HX711_RECOVER_SAMPLES) {
+                next = HX711_HEALTH_OK;
+            }
+            break;
+        case ESP_ERR_TIMEOUT:
+            if (prev != HX711_HEALTH_OFFLINE) {
+                s_health_stats.timeouts++;   // Failed probes are counted as probes
+            }
+            s_good_run = 0;
+            next = ++s_timeout_run >= HX711_OFFLINE_TIMEOUTS ? HX711_HEALTH_OFFLINE
+                 : (prev == HX711_HEALTH_OFFLINE ? prev : HX711_HEALTH_DEGRADED);
+            break;
+        case ESP_ERR_INVALID_STATE:
+            s_health_stats.stuck++;
+            s_good_run = 0;
+            next = HX711_HEALTH_OFFLINE;
+            break;
+        default:    // Saturated: overload is not a dead sensor
+            s_health_stats.saturated++;
+            s_good_run = 0;
+            if (prev == HX711_HEALTH_OK) next = HX711_HEALTH_DEGRADED;
+            break;
+    }
+    if (next == HX711_HEALTH_OFFLINE && prev != HX711_HEALTH_OFFLINE) {
+        s_health_stats.offline_events++;
+        s_health_stats.next_probe_ms = HX711_PROBE_MIN_MS;
+    } else if (next != HX711_HEALTH_OFFLINE) {
+        s_health_stats.next_probe_ms = 0;
+    }
+    s_health = next;
+    taskEXIT_CRITICAL(&s_health_lock);
+
+    if (next != prev) {
+        if (prev == HX711_HEALTH_OFFLINE) {
+            s_reseed = true;    // Load and offset may have changed meanwhile
+        }
+        ESP_LOGW(TAG, "Sensor %s -> %s", hx711_health_name(prev), hx711_health_name(next));
+    }
+}
+
+hx711_health_t hx711_get_health(void)
+{
+    return s_health;
+}
+
+void hx711_get_health_stats(hx711_health_stats_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_health_lock);
+    *out = s_health_stats;
+    out->state = s_health;
+    taskEXIT_CRITICAL(&s_health_lock);
+}
+
+/* ------------------------------- Raw reads ------------------------------ */
+
+// Wait for DOUT low (data ready): spin ~1 ms (an 80 SPS conversion), then
+// yield a tick at a time until the deadline
+static bool hx711_wait_dout(hx711_t *scale, uint32_t timeout_ms)
+{
+    int64_t deadline = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    int spins = 0;
     while (gpio_get_level(scale->dout_pin) != 0) {
-        ets_delay_us(1);
+        if (esp_timer_get_time() >= deadline) {
+            return false;
+        }
+        if (++spins < 100) {
+            ets_delay_us(10);
+        } else {
+            vTaskDelay(1);
+        }
     }
+    return true;
+}
 
+// Clock out one conversion (DOUT must be low) and select the next gain
+static int32_t hx711_shift_in(hx711_t *scale)
+{
     // Clock out 24 bits
     uint32_t val = 0;
+    taskENTER_CRITICAL(&s_sck_lock);
     for (int i = 0; i < 24; i++) {
         gpio_set_level(scale->sck_pin, 1);
         ets_delay_us(1);
@@ -180,14 +427,51 @@ int32_t hx711_read_raw(hx711_t *scale)
         gpio_set_level(scale->sck_pin, 0);
         ets_delay_us(1);
     }
+    taskEXIT_CRITICAL(&s_sck_lock);
 
     // Sign-extend 24-bit to 32-bit
     return (val & 0x800000) ? (int32_t)(val | 0xFF000000) : (int32_t)val;
 }
 
+esp_err_t hx711_read_raw_checked(hx711_t *scale, int32_t *raw)
+{
+    esp_err_t outcome = ESP_OK;
+    int32_t val = 0;
+    if (!hx711_wait_dout(scale, HX711_READ_TIMEOUT_MS)) {
+        outcome = ESP_ERR_TIMEOUT;
+    } else {
+        val = hx711_shift_in(scale);
+        if (val == 0x7FFFFF || val == -0x800000) {
+            outcome = ESP_ERR_INVALID_RESPONSE;
+        } else if (val != s_prev_raw) {
+            s_same_run = 0;
+        } else if (++s_same_run >= HX711_STUCK_SAMPLES) {
+            // Stays flagged until the code changes, so a probe that reads
+            // the same dead value does not bring the sensor back
+            s_same_run = HX711_STUCK_SAMPLES;
+            outcome = ESP_ERR_INVALID_STATE;
+        }
+        s_prev_raw = val;
+    }
+
+    health_record(outcome);
+    if (outcome == ESP_OK) {
+        s_last_good_raw = val;
+        *raw = val;
+    }
+    return outcome;
+}
+
+int32_t hx711_read_raw(hx711_t *scale)
+{
+    int32_t raw = s_last_good_raw;
+    hx711_read_raw_checked(scale, &raw);
+    return raw;
+}
+
 int32_t hx711_read_raw_rtos(hx711_t *scale)
 {
-    int32_t raw_val = 0;
+    int32_t raw_val = s_last_good_raw;
     if (xSemaphoreTake(scale->mutex, pdMS_TO_TICKS(10))) {
         raw_val = hx711_read_raw(scale);
         xSemaphoreGive(scale->mutex);
@@ -195,42 +479,188 @@ int32_t hx711_read_raw_rtos(hx711_t *scale)
     return raw_val;
 }
 
-float hx711_read_filtered(hx711_t *scale)
+/**
+ * Offline re-probe: power-cycle the chip (SCK high > 60 µs), wait for its
+ * first conversion, discard it (taken at the reset gain) and read once.
+ * A good read brings the sensor back to DEGRADED. Caller holds the mutex.
+ */
+static bool hx711_probe(hx711_t *scale)
 {
-    // 1) Raw reading
-    int32_t raw = hx711_read_raw(scale);
-    float w = (float)raw;
+    hx711_power_down(scale);
+    gpio_set_level(scale->sck_pin, 0);
+
+    taskENTER_CRITICAL(&s_health_lock);
+    s_health_stats.probes++;
+    taskEXIT_CRITICAL(&s_health_lock);
+
+    int32_t raw;
+    if (hx711_wait_dout(scale, HX711_READY_TIMEOUT_MS)) {
+        hx711_shift_in(scale);
+        if (hx711_read_raw_checked(scale, &raw) == ESP_OK) {
+            return true;
+        }
+    } else {
+        health_record(ESP_ERR_TIMEOUT);
+    }
+    return false;
+}
 
-    // 2) Step-aware moving average
+/**
+ * Offline: sleep the current backoff, probe, and double the backoff if the
+ * chip is still silent. Used by both sampling tasks instead of reading.
+ */
+static void hx711_offline_step(hx711_t *scale)
+{
+    uint32_t wait_ms;
+    taskENTER_CRITICAL(&s_health_lock);
+    wait_ms = s_health_stats.next_probe_ms ? s_health_stats.next_probe_ms : HX711_PROBE_MIN_MS;
+    taskEXIT_CRITICAL(&s_health_lock);
+    vTaskDelay(pdMS_TO_TICKS(wait_ms));
+
+    bool back = false;
+    if (xSemaphoreTake(scale->mutex, portMAX_DELAY)) {   // Holders are bounded now
+        back = hx711_probe(scale);
+        xSemaphoreGive(scale->mutex);
+    }
+    if (!back) {
+        taskENTER_CRITICAL(&s_health_lock);
+        s_health_stats.next_probe_ms = min(wait_ms * 2, HX711_PROBE_MAX_MS);
+        taskEXIT_CRITICAL(&s_health_lock);
+    }
+}
+
+/**
+ * Step detection on the incoming sample. With a calibration this is a
+ * CUSUM change-point detector in grams whose sensitivity follows the
+ * measured noise floor; without one it falls back to the raw-count jump.
+ */
+static bool detect_step(float w, const scale_config_t *cfg)
+{
+    if (s_calib) {
+        cd_event_t ev = change_detect_update(&s_cd, calibration_convert(s_calib, (int32_t)w));
+        if (ev == CD_EVENT_NONE) {
+            return false;
+        }
+        s_change_dir = ev;
+        s_change_seq++;
+        return true;
+    }
+    return fabsf(w - s_last_output) > cfg->step_threshold_raw;
+}
+
+// Seconds since the previous filtered sample (for the two-state model)
+static float sample_dt(void)
+{
+    static int64_t last_us = 0;
+    int64_t now = esp_timer_get_time();
+    float dt = last_us ? (float)(now - last_us) * 1e-6f : 0.1f;
+    last_us = now;
+    return fminf(fmaxf(dt, 0.001f), 1.0f);
+}
+
+// Push a newly published configuration into the filter instances
+static void apply_config(const scale_config_t *cfg)
+{
+    if (cfg->version == s_cfg_applied) {
+        return;
+    }
+    change_detect_set_params(&s_cd, cfg->cd_k_sigma, cfg->cd_h_sigma);
+    if (s_use_kf && s_kf.model == KALMAN_MODEL_RANDOM_WALK) {
+        s_kf.Q_min = cfg->kf_q_min;
+        s_kf.Q_max = cfg->kf_q_max;
+        s_kf.R_min = cfg->kf_r_min;
+        s_kf.R_max = cfg->kf_r_max;
+        s_kf.threshold = cfg->kf_innov_threshold;
+    }
+    s_cfg_applied = cfg->version;
+}
+
+// Step-aware moving average + Kalman stage shared by both front ends
+static float apply_step_filters(float w, const scale_config_t *cfg)
+{
+    apply_config(cfg);
+
+    bool step = detect_step(w, cfg);
+    if (step) {
+        s_boost_count = cfg->boost_samples;
+    }
+
+    // Two-state tracker: follows steps by itself, no MA. A change point
+    // opens its process noise at once instead of waiting for the gate.
+    if (s_use_kf && s_kf.model == KALMAN_MODEL_CONST_VELOCITY) {
+        if (step) {
+            s_kf.q_scale = fmaxf(s_kf.q_scale, KALMAN_CV_Q_SCALE_UP);
+        } else if (s_boost_count > 0) {
+            s_boost_count--;
+        }
+        w = kalman_update_cv(&s_kf, w, sample_dt());
+        s_last_output = w;
+        return w;
+    }
+
+    // 1) Moving average restarts at the change point
     if (s_ma_window > 0) {
-        if (s_boost_count > 0 || fabsf(w - s_last_output) > STEP_THRESHOLD) {
+        if (step) {
             moving_average_reset(&s_ma, w);
         }
         w = moving_average_update(&s_ma, w);
     }
 
-    // 3) Step-aware Kalman
+    // 2) Kalman runs with boosted Q for boost_samples after a change point
     if (s_use_kf) {
-        if (s_boost_count > 0 || fabsf(w - s_last_output) > STEP_THRESHOLD) {
-            s_kf.Q = BOOSTED_Q;
-            s_boost_count = BOOST_SAMPLES;
-        } else if (s_boost_count == 1) {
-            s_kf.Q = NORMAL_Q;
-        }
         if (s_boost_count > 0) {
-            s_boost_count--;
+            s_kf.Q = cfg->kf_q_boosted;
+            if (--s_boost_count == 0) {
+                s_kf.Q = cfg->kf_q_normal;
+            }
         }
         w = kalman_update_adaptive(&s_kf, w);
     }
 
-    // 4) Track for next step detection
+    // 3) Track for the raw-count fallback detector
     s_last_output = w;
     return w;
 }
 
+// Start the filters over at w (first sample after offline / a failed prime)
+static void reseed_filters(float w)
+{
+    if (s_ma_window > 0) {
+        moving_average_reset(&s_ma, w);
+    }
+    if (s_use_kf) {
+        s_kf.x_est = w;
+        s_kf.v_est = 0.0f;
+    }
+    if (s_median_ready) {
+        median_filter_reset(&s_median, w);
+    }
+    s_boost_count = 0;
+    s_last_output = w;
+    s_reseed = false;
+}
+
+float hx711_read_filtered(hx711_t *scale)
+{
+    int32_t raw;
+    if (hx711_read_raw_checked(scale, &raw) != ESP_OK) {
+        return NAN;     // Faulted sample: dropped, never filtered
+    }
+    if (HX711_TRACE_RAW) {
+        printf("TRACE %" PRId32 "\n", raw);
+    }
+    if (s_reseed) {
+        reseed_filters((float)raw);
+    }
+    const scale_config_t *cfg = scale_config_acquire(s_cfg_reader);
+    float w = apply_step_filters((float)raw, cfg);
+    scale_config_release(s_cfg_reader);
+    return w;
+}
+
 float hx711_read_filtered_rtos(hx711_t *scale)
 {
-    float filtered_value = 0.0f;
+    float filtered_value = NAN;
     if (xSemaphoreTake(scale->mutex, pdMS_TO_TICKS(10))) {
         filtered_value = hx711_read_filtered(scale);
         xSemaphoreGive(scale->mutex);
@@ -238,74 +668,168 @@ float hx711_read_filtered_rtos(hx711_t *scale)
     return filtered_value;
 }
 
+static void hx711_dout_isr(void *arg)
+{
+    hx711_t *scale = (hx711_t *)arg;
+    BaseType_t hp_woken = pdFALSE;
+
+    // Level interrupt: mask it until the task re-arms for the next sample
+    gpio_intr_disable(scale->dout_pin);
+    s_ready_us = esp_timer_get_time();
+    if (s_sample_task) {
+        vTaskNotifyGiveFromISR(s_sample_task, &hp_woken);
+    }
+    portYIELD_FROM_ISR(hp_woken);
+}
+
+void hx711_set_low_power(hx711_t *scale, bool enable)
+{
+    // Takes effect once the sampling task has the DOUT interrupt
+    s_low_power = enable;
+}
+
+/** Install the DOUT-low interrupt; called from the sampling task so the
+ *  interrupt is allocated on (and serviced by) the sampling core */
+static void hx711_dout_irq_init(hx711_t *scale)
+{
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return;   // No interrupt: poll DOUT instead
+    }
+    gpio_set_intr_type(scale->dout_pin, GPIO_INTR_LOW_LEVEL);
+    gpio_intr_disable(scale->dout_pin);
+    if (gpio_isr_handler_add(scale->dout_pin, hx711_dout_isr, scale) == ESP_OK) {
+        s_irq_ready = true;
+    }
+}
+
+/**
+ * Block until the next conversion is ready. In low-power mode the task
+ * first sleeps HX711_IDLE_PERIOD_MS and DOUT is also a light-sleep wake
+ * source; the interrupt is armed only while waiting, otherwise a DOUT that
+ * stays low until the next read would wake the chip straight back up.
+ * @return esp_timer time of the data-ready interrupt, 0 if DOUT was
+ *         already low (ready time unknown), -1 on timeout
+ */
+static int64_t hx711_wait_ready(hx711_t *scale, bool low_power)
+{
+    if (low_power) {
+        vTaskDelay(pdMS_TO_TICKS(HX711_IDLE_PERIOD_MS));
+    }
+    if (gpio_get_level(scale->dout_pin) == 0) {
+        return 0;
+    }
+
+    ulTaskNotifyTake(pdTRUE, 0);
+    s_ready_us = 0;
+    if (low_power) {
+        gpio_wakeup_enable(scale->dout_pin, GPIO_INTR_LOW_LEVEL);
+    }
+    gpio_intr_enable(scale->dout_pin);   // Level-triggered: fires at once if DOUT just fell
+    uint32_t woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(HX711_READY_TIMEOUT_MS));
+    gpio_intr_disable(scale->dout_pin);
+    if (low_power) {
+        gpio_wakeup_disable(scale->dout_pin);
+    }
+    return woken ? s_ready_us : -1;
+}
+
 void hx711_rtos_task(void *pvParameters)
 {
     hx711_t *scale = (hx711_t *)pvParameters;
     float filtered_value;
-    
+
+    s_sample_task = xTaskGetCurrentTaskHandle();
+    hx711_dout_irq_init(scale);
+    jitter_monitor_reset();
+
     while (1) {
+        bool low_power = s_low_power && s_irq_ready;
+        int64_t ready_us = 0;
+
+        if (s_health == HX711_HEALTH_OFFLINE) {
+            jitter_monitor_pause();
+            hx711_offline_step(scale);
+            continue;
+        }
+
+        if (s_irq_ready) {
+            ready_us = hx711_wait_ready(scale, low_power);
+            if (ready_us < 0) {
+                jitter_monitor_timeout();
+                health_record(ESP_ERR_TIMEOUT);
+                continue;
+            }
+        }
+
         if (xSemaphoreTake(scale->mutex, pdMS_TO_TICKS(10))) {
+            int64_t read_us = esp_timer_get_time();
             filtered_value = hx711_read_filtered(scale);
             xSemaphoreGive(scale->mutex);
-            
+            if (isnan(filtered_value)) {
+                continue;   // Faulted sample (health_record has it)
+            }
+
+            // Jitter is tracked at full rate only; low-power pacing is
+            // deliberately slow and restarts the interval chain
+            if (low_power) {
+                jitter_monitor_pause();
+            } else {
+                jitter_monitor_record(ready_us, read_us);
+            }
+
             if (scale->data_queue) {
                 xQueueSend(scale->data_queue, &filtered_value, 0);
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(10)); // 100Hz sampling rate
+        if (!s_irq_ready) {
+            vTaskDelay(pdMS_TO_TICKS(10)); // Polling fallback
+        }
     }
 }
 
 
-// Median filter implementation with RTOS protection
+// Median front end: one raw read per call into a sliding-window median
 int32_t hx711_read_median_rtos(hx711_t *scale, uint8_t* current_sample_size) {
-    static uint8_t adaptive_window = MEDIAN_MIN_SAMPLES;
-    float filtered_value = 0.0f;
-    
+    float filtered_value = s_last_output;
+
+    if (current_sample_size) *current_sample_size = 0;
     if (xSemaphoreTake(scale->mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Dynamic window sizing
+        const scale_config_t *cfg = scale_config_acquire(s_cfg_reader);
+        if (!s_median_ready) {
+            s_median_ready = median_filter_init_with_storage(&s_median, s_median_fbuf,
+                                                             s_median_ibuf, SCALE_CFG_MEDIAN_MAX,
+                                                             cfg->median_min);
+        }
+
+        // Window follows the step detector: widen while boosted, then
+        // shrink back one sample at a time
+        int width = median_filter_get_width(&s_median);
         if (s_boost_count > 0) {
-            adaptive_window = min(MEDIAN_MAX_SAMPLES, 
-                                adaptive_window + MEDIAN_STEP_INCREASE);
+            width = min(cfg->median_max, width + cfg->median_step);
         } else {
-            adaptive_window = max(MEDIAN_MIN_SAMPLES,
-                                adaptive_window - 1); // Gradual reduction
-        }
-        
-        if (current_sample_size) *current_sample_size = adaptive_window;
-        
-        // Take samples with adaptive window
-        int32_t samples[adaptive_window];
-        for (uint8_t i = 0; i < adaptive_window; i++) {
-            samples[i] = hx711_read_raw(scale);
-            vTaskDelay(pdMS_TO_TICKS(1));
-        }
-        
-        // Cascaded median filtering
-        for (uint8_t i = 2; i < adaptive_window; i++) {
-            samples[i] = median3(samples[i-2], samples[i-1], samples[i]);
+            width = max(cfg->median_min, width - 1);
         }
-        filtered_value = (float)samples[adaptive_window-1];
-        
-        // Existing step-aware filters
-        if (s_ma_window > 0) {
-            if (fabsf(filtered_value - s_last_output) > STEP_THRESHOLD) {
-                moving_average_reset(&s_ma, filtered_value);
+        median_filter_set_width(&s_median, width);
+
+        int32_t raw;
+        if (hx711_read_raw_checked(scale, &raw) != ESP_OK) {
+            width = 0;      // Dropped: reported as window 0
+        } else {
+            if (s_reseed) {
+                reseed_filters((float)raw);
             }
-            filtered_value = moving_average_update(&s_ma, filtered_value);
+            filtered_value = s_median_ready ? median_filter_update(&s_median, (float)raw) : (float)raw;
+            filtered_value = apply_step_filters(filtered_value, cfg);
         }
-        
-        if (s_use_kf) {
-            // ... (existing Kalman logic)
-        }
-        
-        s_last_output = filtered_value;
+        if (current_sample_size) *current_sample_size = (uint8_t)width;
+
+        scale_config_release(s_cfg_reader);
         xSemaphoreGive(scale->mutex);
-        return (int32_t)filtered_value;
     }
-    return 0;
-
+    return (int32_t)filtered_value;
 }
+
 // RTOS Task for continuous median filtering
 void hx711_rtos_median_task(void *pvParameters) {
     hx711_t *scale = (hx711_t *)pvParameters;
@@ -313,15 +837,24 @@ void hx711_rtos_median_task(void *pvParameters) {
     const TickType_t xDelay = pdMS_TO_TICKS(10);
     
     for (;;) {
+        if (s_health == HX711_HEALTH_OFFLINE) {
+            hx711_offline_step(scale);
+            continue;
+        }
         int32_t val = hx711_read_median_rtos(scale, &current_window);
+        if (current_window == 0) {
+            vTaskDelay(xDelay);
+            continue;   // Faulted sample
+        }
         
         // Optional debug output
         #ifdef HX711_DEBUG
-        printf("Window: %d, Value: %d\n", current_window, val);
+        printf("Window: %d, Value: %" PRId32 "\n", current_window, val);
         #endif
         
         if (scale->data_queue) {
-            xQueueSend(scale->data_queue, &val, 0);
+            float out = (float)val;   // Queue carries floats
+            xQueueSend(scale->data_queue, &out, 0);
         }
         vTaskDelay(xDelay);
     }
@@ -4,9 +4,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "driver/gpio.h"
+#include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "kalman_filter.h"
+#include "calibration.h"
+#include "change_detect.h"
+
+// Largest moving-average window (statically reserved)
+#define HX711_MA_WINDOW_MAX 32
 
 typedef enum {
     HX711_GAIN_128 = 1,
@@ -40,8 +47,7 @@ void hx711_init_rtos( hx711_t     *scale,
     int          ma_window,
     bool         use_kf,
     float        Q_init,
-    float        R_init,
-    UBaseType_t  task_priority );
+    float        R_init );
 // Alternative RTOS initialization (with queue parameter)
 void hx711_init_rtos_with_queue(hx711_t *scale,
                                gpio_num_t dout,
@@ -51,29 +57,176 @@ void hx711_init_rtos_with_queue(hx711_t *scale,
                                bool use_kf,
                                float Q_init,
                                float R_init,
-                               UBaseType_t task_priority,
                                QueueHandle_t data_queue);
 
-// Median filter declaration (implementation in .c)
-// Add to existing HX711 RTOS functions
+// Median front end: one raw read per call into a sliding-window median
+// (O(log n) per sample), followed by the step-aware MA/Kalman stage.
+// *current_sample_size is 0 when the sample was dropped (busy or faulted)
 int32_t hx711_read_median_rtos(hx711_t *scale, uint8_t* current_sample_size);
 void hx711_rtos_median_task(void *pvParameters);  // New RTOS task for median filtering
 
 QueueHandle_t hx711_get_queue(void);
-// Add these near other #defines
-#define MEDIAN_MIN_SAMPLES  3    // Minimum median window size
-#define MEDIAN_MAX_SAMPLES  11   // Maximum during rapid changes
-#define MEDIAN_STEP_INCREASE 2   // Samples to add when step detected
+// Median window widths and the filter tuning come from scale_config
+
+/*
+ * Sensor health. Every read waits at most HX711_READ_TIMEOUT_MS for DOUT
+ * and is classified:
+ *   - timeout     DOUT never went low (unplugged: DOUT is pulled up)
+ *   - saturated   0x7FFFFF / 0x800000, input out of range (overload)
+ *   - stuck       the same code HX711_STUCK_SAMPLES times in a row, which
+ *                 a live 24-bit ADC never produces (dead chip, shorted DOUT)
+ * Faulted samples never reach the filters. Any fault makes the sensor
+ * DEGRADED until HX711_RECOVER_SAMPLES good ones in a row; a run of
+ * HX711_OFFLINE_TIMEOUTS timeouts or a stuck code makes it OFFLINE. Offline,
+ * the sampling task stops and re-probes (power cycle + one read) after
+ * HX711_PROBE_MIN_MS, doubling up to HX711_PROBE_MAX_MS; the first good
+ * probe reseeds the filters and returns to DEGRADED.
+ */
+#ifndef HX711_READ_TIMEOUT_MS
+#define HX711_READ_TIMEOUT_MS   150   // One 10 SPS conversion + margin
+#endif
+#ifndef HX711_STUCK_SAMPLES
+#define HX711_STUCK_SAMPLES     32
+#endif
+#ifndef HX711_RECOVER_SAMPLES
+#define HX711_RECOVER_SAMPLES   10
+#endif
+#ifndef HX711_OFFLINE_TIMEOUTS
+#define HX711_OFFLINE_TIMEOUTS  5
+#endif
+#ifndef HX711_PROBE_MIN_MS
+#define HX711_PROBE_MIN_MS      250
+#endif
+#ifndef HX711_PROBE_MAX_MS
+#define HX711_PROBE_MAX_MS      8000
+#endif
+
+typedef enum {
+    HX711_HEALTH_OK = 0,
+    HX711_HEALTH_DEGRADED,      // Recent faults, samples still flowing
+    HX711_HEALTH_OFFLINE        // No samples; re-probing with backoff
+} hx711_health_t;
+
+typedef struct {
+    hx711_health_t state;
+    uint32_t timeouts;          // Fault counters since boot
+    uint32_t saturated;
+    uint32_t stuck;
+    uint32_t offline_events;    // Transitions to OFFLINE
+    uint32_t probes;            // Re-probe attempts while offline
+    uint32_t next_probe_ms;     // Current backoff (0 unless offline)
+} hx711_health_stats_t;
 
 // Read functions
+/**
+ * One bounded read. ESP_ERR_TIMEOUT (no data ready in time),
+ * ESP_ERR_INVALID_RESPONSE (saturated) or ESP_ERR_INVALID_STATE (stuck)
+ * leave *raw untouched. Updates the health state.
+ */
+esp_err_t hx711_read_raw_checked(hx711_t *scale, int32_t *raw);
+// Raw reading; the last good one when the read faults (0 before any)
 int32_t hx711_read_raw(hx711_t *scale);
 float hx711_read_filtered(hx711_t *scale);
 void hx711_rtos_task(void *pvParameters);
 
-// RTOS read functions
+// RTOS read functions (last good raw / NAN when the sensor is busy or faulted)
 int32_t hx711_read_raw_rtos(hx711_t *scale);
 float hx711_read_filtered_rtos(hx711_t *scale);
 
+/** @brief Current health state (lock-free). */
+hx711_health_t hx711_get_health(void);
+
+/** @brief Health state and fault counters. */
+void hx711_get_health_stats(hx711_health_stats_t *out);
+
+/** @brief "ok", "degraded" or "offline". */
+const char *hx711_health_name(hx711_health_t state);
+
+/**
+ * Select the Kalman model used by the filtered read paths (enables the KF).
+ *  - KALMAN_MODEL_RANDOM_WALK: scalar filter with Q boosting after steps
+ *  - KALMAN_MODEL_CONST_VELOCITY: weight + rate tracker; process_noise is
+ *    the acceleration noise density in counts²/s³
+ * The estimate carries over from the current output.
+ */
+void hx711_set_kalman_model(hx711_t *scale, kalman_model_t model,
+                            float process_noise, float measurement_noise);
+
+/**
+ * Enable change-point detection in grams (replaces the raw-count step
+ * threshold). Change points reset the MA and boost the Kalman filter.
+ */
+void hx711_set_calibration(hx711_t *scale, const calibration_t *calib);
+
+/**
+ * Number of change points detected so far; consumers compare it with the
+ * value they saw last. `direction` (optional) receives the latest one.
+ */
+uint32_t hx711_get_change_seq(cd_event_t *direction);
+
+// Noise floor the detector is using (grams, 0 before calibration)
+float hx711_get_noise_floor(void);
+
+// Data-ready pacing; the idle period applies to low-power mode only
+#ifndef HX711_IDLE_PERIOD_MS
+#define HX711_IDLE_PERIOD_MS    100   // Sample period in low-power mode
+#endif
+#ifndef HX711_READY_TIMEOUT_MS
+#define HX711_READY_TIMEOUT_MS  500   // Give up waiting for DOUT after this
+#endif
+
+// 1: print every good conversion as "TRACE <raw>" on the console, for
+// recording tuning traces (tools/scale_tune)
+#ifndef HX711_TRACE_RAW
+#define HX711_TRACE_RAW         0
+#endif
+
+/**
+ * Switch the RTOS sampling task between full rate and low-power pacing.
+ * In both modes the task blocks on the DOUT-low (data ready) interrupt
+ * and reads as soon as it fires; at full rate it re-arms immediately,
+ * in low-power mode it first sleeps HX711_IDLE_PERIOD_MS and DOUT is also
+ * a light-sleep wake source, so the CPU can sleep until the next
+ * conversion is ready.
+ */
+void hx711_set_low_power(hx711_t *scale, bool enable);
+
+/*
+ * Filter state that survives deep sleep (kept in RTC memory by
+ * sleep_state): moving-average window, Kalman state and covariance,
+ * change-detector reference and noise floor, last output. Restoring it
+ * after the RTOS init and the model/calibration setters lets the first
+ * samples after a wake continue the old estimate instead of priming from
+ * a single read with default noise levels.
+ */
+typedef struct {
+    KalmanFilter    kf;                 // Mutex fields are not restored
+    change_detect_t cd;
+    float           ma_buf[HX711_MA_WINDOW_MAX];
+    float           ma_sum;
+    int16_t         ma_count;
+    int16_t         ma_index;
+    int16_t         ma_window;
+    bool            use_kf;
+    float           last_output;
+    int32_t         last_raw;
+} hx711_filter_state_t;
+
+/** @brief Snapshot the filter state (under the scale mutex when there is one). */
+void hx711_save_state(hx711_t *scale, hx711_filter_state_t *out);
+
+/**
+ * @brief Restore a snapshot. Refused (false) when the window, the Kalman
+ *        use or the Kalman model differ from the current setup.
+ */
+bool hx711_restore_state(hx711_t *scale, const hx711_filter_state_t *in);
+
+/**
+ * @brief Power the HX711 down: SCK high for more than 60 µs. The next
+ *        SCK low powers it up again (first conversion ~400 ms at 10 SPS).
+ */
+void hx711_power_down(hx711_t *scale);
+
 // Cleanup
 void hx711_deinit(hx711_t *scale);
 
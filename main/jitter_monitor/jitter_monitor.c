@@ -0,0 +1,148 @@
+// File: main/jitter_monitor/jitter_monitor.c
+// ---------------------------------------------------------------------------
+// Sampling jitter monitor
+//   - Inter-sample interval: min / mean / max and deviation histogram
+//   - Data-ready interrupt → read latency histogram
+//   - Late samples, skipped conversions and data-ready timeouts
+//   - Single writer (HX711 task, sampling core), readers on any core
+// ---------------------------------------------------------------------------
+
+#include "jitter_monitor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "log_utils.h"
+
+static const char *TAG = "Jitter";
+
+// One histogram as text: up to 10 digits per bin plus separators
+#define HIST_STR_MAX    (JITTER_BINS * 11)
+
+static portMUX_TYPE   s_lock = portMUX_INITIALIZER_UNLOCKED;
+static jitter_stats_t s_stats;
+static uint64_t       s_period_sum_us = 0;
+static int64_t        s_prev_read_us = 0;
+
+static void reset_locked(void) {
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_period_sum_us = 0;
+    s_prev_read_us = 0;
+}
+
+void jitter_monitor_reset(void) {
+    taskENTER_CRITICAL(&s_lock);
+    reset_locked();
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void jitter_monitor_record(int64_t ready_us, int64_t read_us) {
+    taskENTER_CRITICAL(&s_lock);
+    if (ready_us > 0 && read_us >= ready_us) {
+        uint32_t lat = (uint32_t)(read_us - ready_us);
+        s_stats.latency_hist[jitter_bin(lat)]++;
+        if (lat > s_stats.latency_max_us) s_stats.latency_max_us = lat;
+    } else {
+        s_stats.late++;
+    }
+
+    if (s_prev_read_us > 0 && read_us > s_prev_read_us) {
+        uint32_t period = (uint32_t)(read_us - s_prev_read_us);
+        uint32_t mean = s_stats.period_mean_us;
+
+        if (s_stats.samples >= JITTER_WARMUP && period > mean + mean / 2) {
+            // A whole conversion went by: count it, keep it out of the mean
+            s_stats.skipped++;
+        } else {
+            s_stats.samples++;
+            s_period_sum_us += period;
+            s_stats.period_mean_us = (uint32_t)(s_period_sum_us / s_stats.samples);
+            if (s_stats.period_min_us == 0 || period < s_stats.period_min_us) {
+                s_stats.period_min_us = period;
+            }
+            if (period > s_stats.period_max_us) s_stats.period_max_us = period;
+            if (s_stats.samples > JITTER_WARMUP) {
+                uint32_t dev = period > mean ? period - mean : mean - period;
+                s_stats.period_dev_hist[jitter_bin(dev)]++;
+            }
+        }
+    }
+    s_prev_read_us = read_us;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void jitter_monitor_timeout(void) {
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.timeouts++;
+    s_prev_read_us = 0;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void jitter_monitor_pause(void) {
+    taskENTER_CRITICAL(&s_lock);
+    s_prev_read_us = 0;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void jitter_monitor_get(jitter_stats_t *out) {
+    if (!out) return;
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// "a,b,c" of one histogram; returns chars written or -1
+static int hist_to_str(char *buf, size_t len, const uint32_t *hist) {
+    size_t n = 0;
+    for (int i = 0; i < JITTER_BINS; i++) {
+        int w = snprintf(buf + n, len - n, i ? ",%" PRIu32 : "%" PRIu32, hist[i]);
+        if (w < 0 || (size_t)w >= len - n) return -1;
+        n += (size_t)w;
+    }
+    return (int)n;
+}
+
+void jitter_monitor_log(void) {
+    jitter_stats_t st;
+    jitter_monitor_get(&st);
+
+    char dev[HIST_STR_MAX], lat[HIST_STR_MAX];
+    if (hist_to_str(dev, sizeof(dev), st.period_dev_hist) < 0) dev[0] = '\0';
+    if (hist_to_str(lat, sizeof(lat), st.latency_hist) < 0) lat[0] = '\0';
+
+    LOG_ROW(TAG, "n=%" PRIu32 " period min/mean/max=%" PRIu32 "/%" PRIu32 "/%" PRIu32
+            " us late=%" PRIu32 " skipped=%" PRIu32 " timeouts=%" PRIu32,
+            st.samples, st.period_min_us, st.period_mean_us, st.period_max_us,
+            st.late, st.skipped, st.timeouts);
+    LOG_ROW(TAG, "  period dev hist [%s]", dev);
+    LOG_ROW(TAG, "  latency hist [%s] max=%" PRIu32 " us", lat, st.latency_max_us);
+}
+
+int jitter_monitor_to_json(char *buf, size_t len) {
+    static const uint32_t edges[JITTER_BINS - 1] = JITTER_BIN_EDGES_US;
+    jitter_stats_t st;
+    jitter_monitor_get(&st);
+
+    char dev[HIST_STR_MAX], lat[HIST_STR_MAX], edg[80];
+    if (hist_to_str(dev, sizeof(dev), st.period_dev_hist) < 0 ||
+        hist_to_str(lat, sizeof(lat), st.latency_hist) < 0) {
+        return -1;
+    }
+    size_t n = 0;
+    for (int i = 0; i < JITTER_BINS - 1; i++) {
+        int w = snprintf(edg + n, sizeof(edg) - n, i ? ",%" PRIu32 : "%" PRIu32, edges[i]);
+        if (w < 0 || (size_t)w >= sizeof(edg) - n) return -1;
+        n += (size_t)w;
+    }
+
+    int w = snprintf(buf, len,
+                     "{\"samples\":%" PRIu32 ",\"period_us\":{\"min\":%" PRIu32 ",\"mean\":%" PRIu32
+                     ",\"max\":%" PRIu32 "},\"latency_max_us\":%" PRIu32 ",\"late\":%" PRIu32
+                     ",\"skipped\":%" PRIu32 ",\"timeouts\":%" PRIu32 ",\"bin_edges_us\":[%s]"
+                     ",\"period_dev_hist\":[%s],\"latency_hist\":[%s]}",
+                     st.samples, st.period_min_us, st.period_mean_us, st.period_max_us,
+                     st.latency_max_us, st.late, st.skipped, st.timeouts, edg, dev, lat);
+    return (w < 0 || (size_t)w >= len) ? -1 : w;
+}
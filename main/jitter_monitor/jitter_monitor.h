@@ -0,0 +1,89 @@
+// File: main/jitter_monitor/jitter_monitor.h
+#ifndef JITTER_MONITOR_H
+#define JITTER_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sampling jitter monitor.
+ *
+ * The HX711 task reports every sample it acquires: when DOUT signalled
+ * data ready (ISR timestamp) and when the read actually happened. From
+ * that the monitor keeps
+ *   - the inter-sample interval (min / mean / max) and a histogram of its
+ *     deviation from the mean period,
+ *   - a histogram of the data-ready → read latency (how long the task
+ *     took to run after the interrupt),
+ *   - counts of late samples (DOUT was already low when the task got
+ *     round to waiting, so the ready time is unknown), skipped
+ *     conversions (interval > 1.5 × mean) and data-ready timeouts.
+ * Reset it, load the HTTPS server, then read it back (GET /jitter).
+ */
+
+#define JITTER_BINS         10
+#define JITTER_WARMUP       8       // Intervals before the mean is trusted
+
+// Upper bin edges in µs; the last bin is everything above 20 ms
+#define JITTER_BIN_EDGES_US { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000 }
+
+typedef struct {
+    uint32_t samples;               // Intervals recorded
+    uint32_t period_min_us;
+    uint32_t period_mean_us;
+    uint32_t period_max_us;
+    uint32_t latency_max_us;        // Worst data-ready → read delay
+    uint32_t late;                  // Ready before the task was waiting
+    uint32_t skipped;               // Interval > 1.5 × mean period
+    uint32_t timeouts;              // No data ready within the timeout
+    uint32_t period_dev_hist[JITTER_BINS];  // |interval - mean|
+    uint32_t latency_hist[JITTER_BINS];     // Data ready → read
+} jitter_stats_t;
+
+/** @brief Histogram bin for a duration in µs (pure, host-testable). */
+static inline int jitter_bin(uint32_t us) {
+    static const uint32_t edges[JITTER_BINS - 1] = JITTER_BIN_EDGES_US;
+    int i = 0;
+    while (i < JITTER_BINS - 1 && us >= edges[i]) i++;
+    return i;
+}
+
+/** @brief Clear all counters and histograms. */
+void jitter_monitor_reset(void);
+
+/**
+ * @brief Record one acquired sample (sampling task only).
+ * @param ready_us  esp_timer time of the data-ready interrupt, 0 if DOUT
+ *                  was already low (late sample)
+ * @param read_us   esp_timer time the read started
+ */
+void jitter_monitor_record(int64_t ready_us, int64_t read_us);
+
+/** @brief Data ready did not arrive within the timeout. */
+void jitter_monitor_timeout(void);
+
+/** @brief Break the interval chain (sampling paused or changed pace). */
+void jitter_monitor_pause(void);
+
+/** @brief Consistent copy of the statistics. */
+void jitter_monitor_get(jitter_stats_t *out);
+
+/** @brief Print the statistics as LOG_ROW lines. */
+void jitter_monitor_log(void);
+
+/**
+ * @brief Statistics as a JSON object.
+ * @return Length written (excluding the terminator), or -1 if `len` is too small
+ */
+int jitter_monitor_to_json(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JITTER_MONITOR_H
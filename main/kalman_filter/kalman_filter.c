@@ -9,6 +9,13 @@ void kalman_init(KalmanFilter *kf, float process_noise, float measurement_noise)
     kf->Q = process_noise;
     kf->R = measurement_noise;
     kf->K = 0.0f;
+    kf->model = KALMAN_MODEL_RANDOM_WALK;
+    kf->v_est = 0.0f;
+    kf->P01 = 0.0f;
+    kf->P11 = 0.0f;
+    kf->q_accel = 0.0f;
+    kf->q_scale = 1.0f;
+    kf->nis = 0.0f;
     kf->mutex = NULL; // No mutex for basic version
 }
 
@@ -23,6 +30,16 @@ void kalman_init_adaptive(KalmanFilter *kf, float process_noise, float measureme
     kf->threshold = 10.0f;
 }
 
+// Constant-velocity initialization
+void kalman_init_cv(KalmanFilter *kf, float accel_noise, float measurement_noise, float initial) {
+    kalman_init(kf, 0.0f, measurement_noise);
+    kf->model = KALMAN_MODEL_CONST_VELOCITY;
+    kf->x_est = initial;
+    kf->P_est = measurement_noise;   // First estimate is one measurement
+    kf->P11 = measurement_noise;     // Rate unknown, same order of magnitude
+    kf->q_accel = accel_noise;
+}
+
 // RTOS initialization
 void kalman_init_rtos(KalmanFilter *kf, float process_noise, float measurement_noise, bool is_adaptive) {
     if (is_adaptive) {
@@ -30,7 +47,7 @@ void kalman_init_rtos(KalmanFilter *kf, float process_noise, float measurement_n
     } else {
         kalman_init(kf, process_noise, measurement_noise);
     }
-    kf->mutex = xSemaphoreCreateMutex();
+    kf->mutex = xSemaphoreCreateMutexStatic(&kf->mutex_buf);
 }
 
 // Standard update (non-thread-safe)
@@ -48,6 +65,42 @@ float kalman_update(KalmanFilter *kf, float measurement) {
     return kf->x_est;
 }
 
+// Constant-velocity update (non-thread-safe)
+float kalman_update_cv(KalmanFilter *kf, float measurement, float dt) {
+    if (!kf) return 0.0f;
+
+    // Predict: x = F x, P = F P F' + Q  (F = [1 dt; 0 1], white acceleration)
+    float q   = kf->q_accel * kf->q_scale;
+    float dt2 = dt * dt;
+    kf->x_est += kf->v_est * dt;
+    float P00 = kf->P_est + 2.0f * dt * kf->P01 + dt2 * kf->P11 + q * dt2 * dt / 3.0f;
+    float P01 = kf->P01 + dt * kf->P11 + q * dt2 / 2.0f;
+    float P11 = kf->P11 + q * dt;
+
+    // Update with H = [1 0]
+    float innovation = measurement - kf->x_est;
+    float S  = P00 + kf->R;
+    float K0 = P00 / S;
+    float K1 = P01 / S;
+    kf->x_est += K0 * innovation;
+    kf->v_est += K1 * innovation;
+    kf->P_est = (1.0f - K0) * P00;
+    kf->P01   = (1.0f - K0) * P01;
+    kf->P11   = P11 - K1 * P01;
+    kf->K = K0;
+
+    // Innovation-based adaptation: a gated innovation means the model is
+    // wrong (someone stepped on/off), so open up the process noise
+    kf->nis = innovation * innovation / S;
+    if (kf->nis > KALMAN_CV_NIS_GATE) {
+        kf->q_scale = fminf(kf->q_scale * KALMAN_CV_Q_SCALE_UP, KALMAN_CV_Q_SCALE_MAX);
+    } else {
+        kf->q_scale = fmaxf(kf->q_scale * KALMAN_CV_Q_SCALE_DECAY, 1.0f);
+    }
+
+    return kf->x_est;
+}
+
 // Adaptive update (non-thread-safe)
 float kalman_update_adaptive(KalmanFilter *kf, float measurement) {
     if (!kf) return 0.0f;
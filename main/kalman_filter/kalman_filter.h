@@ -9,10 +9,32 @@ extern "C" {
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
+// Process model, selectable per instance
+typedef enum {
+    KALMAN_MODEL_RANDOM_WALK = 0,   // Scalar: weight only (default)
+    KALMAN_MODEL_CONST_VELOCITY     // Two-state: weight + rate of change
+} kalman_model_t;
+
+// Constant-velocity model: innovation gate and process-noise scaling
+#ifndef KALMAN_CV_NIS_GATE
+#define KALMAN_CV_NIS_GATE      9.0f     // 3 sigma innovation → manoeuvre
+#endif
+#ifndef KALMAN_CV_Q_SCALE_MAX
+#define KALMAN_CV_Q_SCALE_MAX   1.0e8f   // Largest process-noise multiplier
+#endif
+#ifndef KALMAN_CV_Q_SCALE_UP
+#define KALMAN_CV_Q_SCALE_UP    100.0f   // Multiplier per gated innovation
+#endif
+#ifndef KALMAN_CV_Q_SCALE_DECAY
+#define KALMAN_CV_Q_SCALE_DECAY 0.5f     // Relax towards 1 when consistent
+#endif
+
 typedef struct {
+    kalman_model_t model;
+
     // Core Kalman variables
     float x_est;    // State estimate
-    float P_est;    // Estimate covariance
+    float P_est;    // Estimate covariance (P00 for the two-state model)
     float Q;        // Process noise
     float R;        // Measurement noise
     float K;        // Kalman gain
@@ -23,9 +45,18 @@ typedef struct {
     float R_min;
     float R_max;
     float threshold;
+
+    // Constant-velocity model (weight + rate)
+    float v_est;    // Rate estimate (units per second)
+    float P01;      // Weight/rate covariance
+    float P11;      // Rate variance
+    float q_accel;  // Base acceleration noise density
+    float q_scale;  // Innovation-driven multiplier on q_accel (≥ 1)
+    float nis;      // Last normalised innovation squared
     
     // RTOS protection
     SemaphoreHandle_t mutex;
+    StaticSemaphore_t mutex_buf;
 } KalmanFilter;
 
 // Basic initialization
@@ -37,9 +68,25 @@ void kalman_init_adaptive(KalmanFilter *kf, float process_noise, float measureme
 // RTOS initialization
 void kalman_init_rtos(KalmanFilter *kf, float process_noise, float measurement_noise, bool is_adaptive);
 
+/**
+ * Constant-velocity initialization.
+ * @param accel_noise        Acceleration noise density (units²/s³)
+ * @param measurement_noise  Measurement variance (units²)
+ * @param initial            Starting weight estimate
+ */
+void kalman_init_cv(KalmanFilter *kf, float accel_noise, float measurement_noise, float initial);
+
 // Standard update
 float kalman_update(KalmanFilter *kf, float measurement);
 
+/**
+ * Constant-velocity update with closed-form 2×2 covariance. A gated
+ * innovation (NIS > KALMAN_CV_NIS_GATE) scales the process noise up so a
+ * step is tracked within a few samples; consistent innovations relax it.
+ * @param dt  Seconds since the previous measurement
+ */
+float kalman_update_cv(KalmanFilter *kf, float measurement, float dt);
+
 // Adaptive update
 float kalman_update_adaptive(KalmanFilter *kf, float measurement);
 
@@ -6,10 +6,12 @@
 //   3) HX711 RTOS driver → queue
 //   4) Weight manager → timestamped logging (immediate)
 //   5) HTTPS server for remote weight access
+//   6) BLE Weight Scale + weigh-in history services, publish hub
 // ---------------------------------------------------------------------------
 
 #include <stdio.h>
 #include <inttypes.h>            // for PRId32
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
@@ -35,6 +37,23 @@
 // Calibration
 #include "calibration.h"
 
+// Storage + BLE
+#include "storage.h"
+#include "weigh_log.h"
+#include "bluetooth_comm_gatt.h"
+#include "app_connection_manager.h"
+#include "power_governor.h"
+#include "clock_map.h"
+#include "user_profiles.h"
+#include "scale_config.h"
+#include "resources.h"
+#include "jitter_monitor.h"
+#include "udp_telemetry.h"
+#include "mqtt_uplink.h"
+#include "web_assets.h"
+#include "sleep_state.h"
+#include "esp_timer.h"
+
 /* ---------- App-wide definitions ---------------------------------------- */
 #define WIFI_SSID           "Tori_2.44Ghz"
 #define WIFI_PASS           "Logarithmses900"
@@ -44,12 +63,44 @@
 #define HX711_SCK_PIN       GPIO_NUM_22
 #define HX711_GAIN          HX711_GAIN_128
 
-// Filters
+// Filters; tools/scale_tune writes main/scale_tune_config.h to override
+// them (its runtime fields go to scale_config)
+#if __has_include("scale_tune_config.h")
+#include "scale_tune_config.h"
+#endif
+#ifndef MA_WINDOW
 #define MA_WINDOW           8
+#endif
 #define USE_KF              true
+#ifndef KF_Q_INIT
 #define KF_Q_INIT           0.5f
+#endif
+#ifndef KF_R_INIT
 #define KF_R_INIT           1.0f
-static void *https_server = NULL;
+#endif
+#ifndef KF_MODEL
+#define KF_MODEL            KALMAN_MODEL_CONST_VELOCITY
+#endif
+#ifndef KF_CV_ACCEL_NOISE
+#define KF_CV_ACCEL_NOISE   1.0e3f   // counts²/s³
+#endif
+#ifndef KF_CV_MEAS_NOISE
+#define KF_CV_MEAS_NOISE    2500.0f  // counts², ~50 counts rms HX711 noise
+#endif
+
+// LAN telemetry: multicast weight/state frames (trusted networks only)
+#define UDP_TELEMETRY       true
+
+// Backend uplink: batched weigh-ins + rollups over MQTT (QoS1)
+#define MQTT_UPLINK         true
+#define MQTT_BROKER_URI     "mqtt://192.168.1.10:1883"
+
+// Battery builds: deep-sleep after CONFIG_DEEP_SLEEP_IDLE_S without a
+// weigh-in or TLS client, keeping calibration and filter state in RTC memory
+// (sleep_state.h). 0 keeps the scale awake (mains powered, dashboard and
+// uplink always up)
+#define DEEP_SLEEP_IDLE_S   CONFIG_DEEP_SLEEP_IDLE_S
+#define SLEEP_FLUSH_WAIT_MS 3000    // Longest wait for the uplink before sleeping
 
 // Calibration samples & weight
 #define CAL_SAMPLES         10
@@ -61,15 +112,70 @@ static const char *TAG = "app_main";
 hx711_t       g_scale;
 calibration_t g_calib;    // filled during app_main calibration step
 
-// Forward declaration for HTTPS server status check
-bool https_server_is_running(void);
+static sleep_state_t s_sleep;     // What survives the next deep sleep
+static sleep_wake_t  s_wake;
+
+#if DEEP_SLEEP_IDLE_S > 0
+// Hand the uplink what is waiting before the radio goes down. The acked
+// cursor is in NVS, so whatever is still unacknowledged goes out after
+// the next full start
+static void uplink_flush_before_sleep(void)
+{
+    if (!MQTT_UPLINK) return;
+    mqtt_uplink_flush();
+    for (int i = 0; i < SLEEP_FLUSH_WAIT_MS / 100; i++) {
+        mqtt_uplink_stats_t st;
+        mqtt_uplink_get_stats(&st);
+        if (!st.connected || st.backlog == 0) break;
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+#endif
 
 void app_main(void)
 {
     LOG_ROW(TAG, "=== Smart-Scale FW starting ===");
 
-    // 1) Basic tare + single-point calibration
-    {
+    // Static task/queue table + heap accounting (cJSON hooks) before any user
+    res_init();
+
+    // 1a) Deep-sleep wake: calibration and filter state from RTC memory. A
+    //     timer wake with nothing on the platform sleeps again right here
+    s_wake = sleep_state_restore(&s_sleep);
+    if (s_wake != SLEEP_WAKE_COLD) {
+        hx711_init(&g_scale,
+                   HX711_DOUT_PIN,
+                   HX711_SCK_PIN,
+                   HX711_GAIN,
+                   MA_WINDOW,
+                   USE_KF,
+                   KF_Q_INIT,
+                   KF_R_INIT);
+        if (KF_MODEL == KALMAN_MODEL_CONST_VELOCITY) {
+            hx711_set_kalman_model(&g_scale, KF_MODEL, KF_CV_ACCEL_NOISE, KF_CV_MEAS_NOISE);
+        }
+        hx711_restore_state(&g_scale, &s_sleep.filt);
+        g_calib = s_sleep.calib;
+
+        float w = sleep_state_check_weight(&g_scale, &g_calib, SLEEP_CHECK_SAMPLES);
+        LOG_ROW(TAG, "Wake (%s #%" PRIu32 "): %.1f g, %lld ms after start",
+                sleep_state_wake_name(s_wake), s_sleep.sleeps, w,
+                (long long)(esp_timer_get_time() / 1000));
+        hx711_save_state(&g_scale, &s_sleep.filt);   // Follows drift between checks
+        if (s_wake == SLEEP_WAKE_TIMER && w < s_sleep.wake_threshold_g) {
+            // Re-zero on a small, steady reading, or the drift of a few
+            // hours reaches the wake threshold and every check boots fully
+            if (sleep_state_auto_zero(&s_sleep, w)) {
+                LOG_ROW(TAG, "Auto-zero: %.1f g folded into the zero", w);
+            }
+            s_sleep.checks++;
+            sleep_state_enter(&g_scale, &s_sleep);   // Does not return
+        }
+        s_sleep.last_weight_g = w;
+    }
+
+    // 1b) Cold boot: basic tare + single-point calibration
+    if (s_wake == SLEEP_WAKE_COLD) {
         int32_t raw_buf[CAL_SAMPLES];
         int32_t zero_raw      = 0;
         int32_t raw_at_weight = 0;
@@ -89,6 +195,12 @@ void app_main(void)
             vTaskDelay(pdMS_TO_TICKS(100));
         }
 
+        if (hx711_get_health() != HX711_HEALTH_OK) {
+            // Reads are bounded: boot goes on and the sampling task keeps
+            // re-probing, but this calibration is meaningless
+            LOG_ROW(TAG, "HX711 not responding (%s), calibration invalid",
+                    hx711_health_name(hx711_get_health()));
+        }
         calibration_tare(&zero_raw, raw_buf, CAL_SAMPLES);
         LOG_ROW(TAG, "Tare complete, zero_raw = %" PRId32, zero_raw);
 
@@ -104,17 +216,28 @@ void app_main(void)
                             CAL_KNOWN_WEIGHT_G);
         LOG_ROW(TAG, "Calibration: slope=%.6f intercept=%.2f",
                 g_calib.slope, g_calib.intercept);
+        s_sleep.calib = g_calib;
+        s_sleep.zero_raw = zero_raw;
     }
 
     // 2) Bring up Wi-Fi
     wifi_comm_start(WIFI_SSID, WIFI_PASS);
 
-    // Wait for Wi-Fi to be connected (before SNTP)
+    // Boot counter + monotonic → wall mapping table (NVS is up now)
+    clock_map_init();
+
+    // Live thresholds / filter tuning; readers register from here on
+    scale_config_init();
+
+    // Wait for Wi-Fi to be connected (before SNTP). A deep-sleep wake does
+    // not wait: the weight comes first, the clock kept running in the RTC,
+    // SNTP polls once the link is up and the main loop starts HTTPS
     int retries = 0;
-    while (!wifi_is_connected() && retries++ < 20) {
+    int max_retries = (s_wake == SLEEP_WAKE_COLD) ? 20 : 0;
+    while (!wifi_is_connected() && retries++ < max_retries) {
         vTaskDelay(pdMS_TO_TICKS(500));
     }
-    if (!wifi_is_connected()) {
+    if (!wifi_is_connected() && s_wake == SLEEP_WAKE_COLD) {
         LOG_ROW(TAG, "Wi-Fi not connected, continuing without SNTP");
     } else {
         // 3) Start SNTP client
@@ -122,6 +245,27 @@ void app_main(void)
         sntp_sync_start();
     }
 
+    // Mount storage and open the weigh-in log before anything records to it
+    storage_init();         // SPIFFS or LittleFS, chosen in menuconfig
+    if (weigh_log_init() != ESP_OK) {
+        LOG_ROW(TAG, "Weigh-in log unavailable, history sync disabled");
+    }
+    user_profiles_init();   // Per-user clusters + body-composition history
+    web_assets_init();      // Dashboard (www partition), before the HTTPS server
+
+    // BLE: Weight Scale Service + history sync (NVS is up after Wi-Fi init)
+    custom_gatt_init();
+
+    // Publish hub: transports subscribe before the weight pipeline starts
+    app_connection_manager_init();
+    if (UDP_TELEMETRY) {
+        udp_telemetry_init(NULL);   // Multicast frames for LAN displays
+    }
+    if (MQTT_UPLINK) {
+        const mqtt_uplink_config_t up = { .uri = MQTT_BROKER_URI };
+        mqtt_uplink_init(&up);      // Drains the weigh-in log to the backend
+    }
+
     // 4) Start HX711 RTOS driver (creates hx711 queue internally)
     hx711_init_rtos(&g_scale,
                     HX711_DOUT_PIN,
@@ -130,10 +274,19 @@ void app_main(void)
                     MA_WINDOW,
                     USE_KF,
                     KF_Q_INIT,
-                    KF_R_INIT,
-                    5);  // task priority
+                    KF_R_INIT);  // Core/priority: scheduling plan in resources.h
+    hx711_set_calibration(&g_scale, &g_calib);   // Change points in grams
+    if (KF_MODEL == KALMAN_MODEL_CONST_VELOCITY) {
+        hx711_set_kalman_model(&g_scale, KF_MODEL, KF_CV_ACCEL_NOISE, KF_CV_MEAS_NOISE);
+    }
+    if (s_wake != SLEEP_WAKE_COLD && !hx711_restore_state(&g_scale, &s_sleep.filt)) {
+        LOG_ROW(TAG, "Filter setup changed, retained state dropped");
+    }
+
+    // DFS + automatic light sleep, HX711 DOUT as wake source while idle
+    power_governor_init(&g_scale);
 
-    // 5) Start the weight manager (will wait for SNTP internally)
+    // 5) Start the weight manager
     weight_manager_init(hx711_get_queue(), &g_calib);
 
     // 6) Start HTTPS server after network is up
@@ -144,15 +297,38 @@ void app_main(void)
         LOG_ROW(TAG, "Skipping HTTPS server start");
     }
 
+
     // Main loop - monitor system health
     for (;;) {
         static uint32_t counter = 0;
 
+#if DEEP_SLEEP_IDLE_S > 0
+        // Battery builds: deep sleep once nothing has happened for a while
+        static uint32_t idle_s = 0;
+        {
+            pg_stats_t pg;
+            power_governor_get_stats(&pg);
+            idle_s = (pg.mode == PG_MODE_IDLE) ? idle_s + 1 : 0;
+            if (idle_s >= DEEP_SLEEP_IDLE_S) {
+                s_sleep.wake_threshold_g = weight_manager_get_threshold();
+                s_sleep.last_weight_g = weight_manager_get_weight();
+                s_sleep.checks = 0;
+                hx711_save_state(&g_scale, &s_sleep.filt);
+                user_profiles_flush();
+                uplink_flush_before_sleep();
+                sleep_state_enter(&g_scale, &s_sleep);
+            }
+        }
+#endif
+
         // Periodic status report
         if (++counter % 60 == 0) {
             LOG_ROW(TAG, "System status - Wi-Fi: %s, HTTPS: %s",
                     wifi_is_connected() ? "connected" : "disconnected",
                     https_server_is_running() ? "running" : "stopped");
+            power_governor_log_stats();
+            res_log_report();
+            jitter_monitor_log();
 
             // Attempt to restart HTTPS server if needed
             if (wifi_is_connected() && !https_server_is_running()) {
@@ -164,11 +340,3 @@ void app_main(void)
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
 }
-
-/**
- * @brief Check if HTTPS server is running
- * @return true if server is running, false otherwise
- */
-bool https_server_is_running(void) {
-    return (https_server != NULL);
-}
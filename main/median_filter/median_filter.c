@@ -0,0 +1,195 @@
+#include "median_filter.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Items in each half of the window; heap[0] (the median) is in neither */
+#define MIN_CT(f)  (((f)->count - 1) / 2)
+#define MAX_CT(f)  ((f)->count / 2)
+
+/* true if the sample at heap slot i sorts before the one at slot j */
+static inline bool mm_less(const median_filter_t *f, int i, int j) {
+    return f->data[f->heap[i]] < f->data[f->heap[j]];
+}
+
+/* Swap heap slots i and j and keep the ring → heap index in step */
+static inline bool mm_exchange(median_filter_t *f, int i, int j) {
+    int t = f->heap[i];
+    f->heap[i] = f->heap[j];
+    f->heap[j] = t;
+    f->pos[f->heap[i]] = i;
+    f->pos[f->heap[j]] = j;
+    return true;
+}
+
+static inline bool mm_cmp_exchange(median_filter_t *f, int i, int j) {
+    return mm_less(f, i, j) && mm_exchange(f, i, j);
+}
+
+/* Restore the min-heap from slot i (a child of i / 2) downwards */
+static void min_sort_down(median_filter_t *f, int i) {
+    for (; i <= MIN_CT(f); i *= 2) {
+        if (i > 1 && i < MIN_CT(f) && mm_less(f, i + 1, i)) {
+            ++i;
+        }
+        if (!mm_cmp_exchange(f, i, i / 2)) {
+            break;
+        }
+    }
+}
+
+/* Restore the max-heap from slot i (a child of i / 2) downwards */
+static void max_sort_down(median_filter_t *f, int i) {
+    for (; i >= -MAX_CT(f); i *= 2) {
+        if (i < -1 && i > -MAX_CT(f) && mm_less(f, i, i - 1)) {
+            --i;
+        }
+        if (!mm_cmp_exchange(f, i / 2, i)) {
+            break;
+        }
+    }
+}
+
+/* Sift slot i up the min-heap; true if it reached the median slot */
+static bool min_sort_up(median_filter_t *f, int i) {
+    while (i > 0 && mm_cmp_exchange(f, i, i / 2)) {
+        i /= 2;
+    }
+    return i == 0;
+}
+
+/* Sift slot i up the max-heap; true if it reached the median slot */
+static bool max_sort_up(median_filter_t *f, int i) {
+    while (i < 0 && mm_cmp_exchange(f, i / 2, i)) {
+        i /= 2;
+    }
+    return i == 0;
+}
+
+/* Empty window of `width` slots: fill order median, max, min, max, ... */
+static void layout(median_filter_t *f, int width) {
+    f->width = width;
+    f->count = 0;
+    f->index = 0;
+    f->heap  = f->heap_buf + width / 2;
+    for (int i = width - 1; i >= 0; i--) {
+        f->pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+        f->heap[f->pos[i]] = i;
+    }
+}
+
+/* Push into the window only (no history) */
+static void insert(median_filter_t *f, float v) {
+    bool is_new = f->count < f->width;
+    int p = f->pos[f->index];
+    float old = f->data[f->index];
+
+    f->data[f->index] = v;
+    f->index = (f->index + 1) % f->width;
+    if (is_new) {
+        f->count++;
+    }
+
+    if (p > 0) {                            // Slot is in the upper half
+        if (!is_new && old < v) {
+            min_sort_down(f, p * 2);
+        } else if (min_sort_up(f, p)) {
+            max_sort_down(f, -1);
+        }
+    } else if (p < 0) {                     // Slot is in the lower half
+        if (!is_new && v < old) {
+            max_sort_down(f, p * 2);
+        } else if (max_sort_up(f, p)) {
+            min_sort_down(f, 1);
+        }
+    } else {                                // Slot is the median itself
+        if (MAX_CT(f)) max_sort_down(f, -1);
+        if (MIN_CT(f)) min_sort_down(f, 1);
+    }
+}
+
+bool median_filter_init_with_storage(median_filter_t *f, float *fbuf, int *ibuf,
+                                     int capacity, int width) {
+    if (!f || !fbuf || !ibuf || capacity <= 0) return false;
+    memset(f, 0, sizeof(*f));
+
+    f->data     = fbuf;
+    f->hist     = fbuf + capacity;
+    f->pos      = ibuf;
+    f->heap_buf = ibuf + capacity;
+    f->capacity = capacity;
+
+    if (width < 1) width = 1;
+    if (width > capacity) width = capacity;
+    layout(f, width);
+    return true;
+}
+
+bool median_filter_init(median_filter_t *f, int capacity, int width) {
+    if (!f || capacity <= 0) return false;
+
+    // One allocation: data, hist (floats) then pos, heap (ints)
+    size_t bytes = (size_t)capacity * (2 * sizeof(float) + 2 * sizeof(int));
+    float *block = malloc(bytes);
+    if (!block) return false;
+
+    median_filter_init_with_storage(f, block, (int *)(block + 2 * capacity), capacity, width);
+    f->owns_storage = true;
+    return true;
+}
+
+float median_filter_update(median_filter_t *f, float value) {
+    if (!f || !f->data) return value;
+
+    f->hist[f->hist_index] = value;
+    f->hist_index = (f->hist_index + 1) % f->capacity;
+    if (f->hist_count < f->capacity) {
+        f->hist_count++;
+    }
+
+    insert(f, value);
+    return median_filter_get(f);
+}
+
+float median_filter_get(const median_filter_t *f) {
+    if (!f || !f->data || f->count == 0) return 0.0f;
+
+    float v = f->data[f->heap[0]];
+    if ((f->count & 1) == 0) {
+        v = 0.5f * (v + f->data[f->heap[-1]]);
+    }
+    return v;
+}
+
+void median_filter_set_width(median_filter_t *f, int width) {
+    if (!f || !f->data) return;
+    if (width < 1) width = 1;
+    if (width > f->capacity) width = f->capacity;
+    if (width == f->width) return;
+
+    // Refill from the newest `width` samples, oldest first
+    layout(f, width);
+    int n = f->hist_count < width ? f->hist_count : width;
+    int start = f->hist_index - n;
+    if (start < 0) start += f->capacity;
+    for (int i = 0; i < n; i++) {
+        insert(f, f->hist[(start + i) % f->capacity]);
+    }
+}
+
+void median_filter_reset(median_filter_t *f, float init_value) {
+    if (!f || !f->data) return;
+    f->hist_index = 0;
+    f->hist_count = 0;
+    layout(f, f->width);
+    median_filter_update(f, init_value);
+}
+
+int median_filter_get_width(const median_filter_t *f) {
+    return f ? f->width : 0;
+}
+
+void median_filter_deinit(median_filter_t *f) {
+    if (!f) return;
+    if (f->owns_storage) free(f->data);
+    memset(f, 0, sizeof(*f));
+}
@@ -0,0 +1,64 @@
+#ifndef MEDIAN_FILTER_H
+#define MEDIAN_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/*
+ * Streaming sliding-window median ("mediator").
+ *
+ * The window is a ring of samples plus one heap array indexed around its
+ * middle: heap[0] is the median, heap[-1..] is a max-heap of the lower half
+ * and heap[1..] a min-heap of the upper half. Each new sample overwrites the
+ * oldest in place and sifts through one heap, so an update is O(log n) and
+ * never re-reads the sensor.
+ */
+typedef struct {
+    float *data;        // Ring of samples in the current window
+    int   *pos;         // Heap position of each ring slot
+    int   *heap;        // Points into heap_buf at the median slot
+    int   *heap_buf;    // Backing storage for the heap (capacity entries)
+    int    width;       // Current window length (≤ capacity)
+    int    count;       // Valid samples in the window (≤ width)
+    int    index;       // Next ring slot to overwrite
+
+    // Recent raw samples, used to refill the window when its width changes
+    float *hist;
+    int    hist_index;
+    int    hist_count;
+
+    int    capacity;    // Largest supported width
+    bool   owns_storage; // Storage came from median_filter_init()
+} median_filter_t;
+
+// Allocate storage for windows up to `capacity` samples, start at `width`
+bool median_filter_init(median_filter_t *f, int capacity, int width);
+
+// Same, on caller storage: `fbuf` and `ibuf` hold 2 × capacity entries each
+bool median_filter_init_with_storage(median_filter_t *f, float *fbuf, int *ibuf,
+                                     int capacity, int width);
+
+// Push a sample and return the median of the current window
+float median_filter_update(median_filter_t *f, float value);
+
+// Current median (0 when empty)
+float median_filter_get(const median_filter_t *f);
+
+// Change the window length; the window is refilled from recent samples
+void median_filter_set_width(median_filter_t *f, int width);
+
+// Forget history and seed the window with a single value
+void median_filter_reset(median_filter_t *f, float init_value);
+
+int median_filter_get_width(const median_filter_t *f);
+
+void median_filter_deinit(median_filter_t *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEDIAN_FILTER_H
@@ -30,7 +30,7 @@ void moving_average_init(moving_avg_t* filter, float* buffer, int size) {
 /* RTOS initialization (creates mutex) */
 void moving_average_init_rtos(moving_avg_t* filter, float* buffer, int size) {
     moving_average_init(filter, buffer, size);
-    filter->mutex = xSemaphoreCreateMutex();
+    filter->mutex = xSemaphoreCreateMutexStatic(&filter->mutex_buf);
 }
 
 /* Core moving average update (non-thread-safe) */
@@ -150,11 +150,8 @@ void moving_average_deinit(moving_avg_t* filter) {
         filter->mutex = NULL;
     }
     
-    // Free buffer if it exists
-    if (filter->buffer) {
-        free(filter->buffer);
-        filter->buffer = NULL;
-    }
+    // The buffer belongs to the caller (see moving_average_init)
+    filter->buffer = NULL;
     
     // Reset all fields
     filter->size = 0;
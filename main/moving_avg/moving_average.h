@@ -23,6 +23,7 @@ typedef struct {
     
     // RTOS additions
     SemaphoreHandle_t mutex; // Thread safety
+    StaticSemaphore_t mutex_buf;
 } moving_avg_t;
 
 // Original functions
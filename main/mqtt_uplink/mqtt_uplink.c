@@ -0,0 +1,468 @@
+// File: main/mqtt_uplink/mqtt_uplink.c
+// ---------------------------------------------------------------------------
+// MQTT uplink
+//   - Weigh-in log is the outbox; NVS keeps the acknowledged-seq cursor
+//   - Batched flushes: record count, record age or rollup due
+//   - Pipelined QoS1: several messages in flight, cursor follows PUBACKs
+//   - Periodic rollups (weigh-ins, heap, sampling health)
+//   - One task owns the cursor; the MQTT event handler only marks acks
+// ---------------------------------------------------------------------------
+
+#include "mqtt_uplink.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "nvs.h"
+#include "mqtt_client.h"
+
+#include "app_connection_manager.h"
+#include "jitter_monitor.h"
+#include "resources.h"
+#include "log_utils.h"
+
+static const char *TAG = "MqttUp";
+
+#define UPLINK_NVS_NS       "mqtt_up"
+#define UPLINK_NVS_KEY      "acked"
+#define UPLINK_EVENT_POLL_MS 1000   // Hub saw a weigh-in the log has not got yet
+#define UPLINK_EVENT_WAIT_US 5000000
+
+// One published weigh-in message, oldest first
+typedef struct {
+    int      msg_id;                // -1: nothing to send (torn slots), already acked
+    uint32_t last_seq;
+    uint16_t records;
+    bool     acked;
+    int64_t  sent_us;
+} inflight_t;
+
+static esp_mqtt_client_handle_t s_client = NULL;
+static TaskHandle_t   s_task = NULL;
+static portMUX_TYPE   s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static char           s_dev[9];
+static char           s_topic_batch[48];
+static char           s_topic_rollup[48];
+
+// Window (s_lock)
+static inflight_t     s_inflight[MQTT_UPLINK_INFLIGHT];
+static int            s_head = 0;
+static int            s_count = 0;
+
+// Task-owned cursor
+static uint32_t       s_acked_seq = 0;      // Everything ≤ this is at the broker
+static uint32_t       s_sent_seq = 0;       // Everything ≤ this has been published
+static uint32_t       s_saved_seq = 0;      // Cursor value in NVS
+static int64_t        s_oldest_us = 0;      // First seen unsent record, 0 = none
+
+static volatile bool    s_connected = false;
+static volatile bool    s_drain = false;    // Send until the log is empty
+static volatile bool    s_flush_req = false;
+static volatile int64_t s_event_us = 0;     // Last locked weight from the hub
+
+// Rollup window (s_lock)
+static int64_t        s_rollup_start_us = 0;
+static uint32_t       s_rollup_n = 0;
+static float          s_rollup_min = 0.0f;
+static float          s_rollup_max = 0.0f;
+static double         s_rollup_sum = 0.0;
+
+static mqtt_uplink_stats_t s_stats;
+
+/* ----------------------------- Encoding --------------------------------- */
+
+int mqtt_uplink_encode_batch(char *buf, size_t len, const char *dev,
+                             const weigh_log_record_t *recs, int n) {
+    int w = snprintf(buf, len, "{\"dev\":\"%s\",\"recs\":[", dev);
+    if (w < 0 || (size_t)w >= len) return -1;
+    size_t pos = (size_t)w;
+
+    for (int i = 0; i < n; i++) {
+        // Keep the tuple bounded whatever a corrupt-but-CRC-valid float says
+        float g = recs[i].weight_g;
+        if (!(g > -1.0e6f)) g = -1.0e6f;
+        if (g > 1.0e6f) g = 1.0e6f;
+        w = snprintf(buf + pos, len - pos, "%s[%" PRIu32 ",%" PRIu32 ",%.1f,%u,%u]",
+                     i ? "," : "", recs[i].seq, recs[i].timestamp, (double)g,
+                     (unsigned)recs[i].user_id, (unsigned)recs[i].flags);
+        if (w < 0 || (size_t)w >= len - pos) return -1;
+        pos += (size_t)w;
+    }
+    w = snprintf(buf + pos, len - pos, "]}");
+    if (w < 0 || (size_t)w >= len - pos) return -1;
+    return (int)(pos + (size_t)w);
+}
+
+/* ------------------------------ Cursor ---------------------------------- */
+
+static void cursor_load(void) {
+    nvs_handle_t h;
+    uint32_t v = 0;
+    if (nvs_open(UPLINK_NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        nvs_get_u32(h, UPLINK_NVS_KEY, &v);
+        nvs_close(h);
+    }
+
+    // A log that restarted below the cursor (file recreated) starts over
+    uint32_t last = weigh_log_last_seq();
+    if (last != 0 && v > last) {
+        LOG_ROW(TAG, "Cursor %" PRIu32 " beyond log end %" PRIu32 ", resetting", v, last);
+        v = 0;
+    }
+    s_acked_seq = s_sent_seq = s_saved_seq = v;
+}
+
+// Coalesced: one NVS write per step, not per PUBACK
+static void cursor_save(void) {
+    if (s_acked_seq == s_saved_seq) return;
+    nvs_handle_t h;
+    if (nvs_open(UPLINK_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    if (nvs_set_u32(h, UPLINK_NVS_KEY, s_acked_seq) == ESP_OK && nvs_commit(h) == ESP_OK) {
+        s_saved_seq = s_acked_seq;
+    }
+    nvs_close(h);
+}
+
+// Move the cursor over the acknowledged head of the window; re-send the
+// whole window if its oldest message has waited too long (the client's own
+// outbox expires messages, so a PUBACK may never come)
+static void collect_acks(int64_t now) {
+    taskENTER_CRITICAL(&s_lock);
+    while (s_count > 0 && s_inflight[s_head].acked) {
+        s_acked_seq = s_inflight[s_head].last_seq;
+        s_stats.records_acked += s_inflight[s_head].records;
+        s_head = (s_head + 1) % MQTT_UPLINK_INFLIGHT;
+        s_count--;
+    }
+    bool expired = s_count > 0 &&
+                   now - s_inflight[s_head].sent_us > (int64_t)MQTT_UPLINK_ACK_TIMEOUT_MS * 1000;
+    if (expired) {
+        s_count = 0;
+        s_stats.resends++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (expired) {
+        LOG_ROW(TAG, "No PUBACK within %d ms, re-sending from %" PRIu32,
+                MQTT_UPLINK_ACK_TIMEOUT_MS, s_acked_seq + 1);
+        s_sent_seq = s_acked_seq;
+        s_drain = true;
+    }
+}
+
+// Records the ring overwrote before they were sent
+static void skip_lost(void) {
+    uint32_t first = weigh_log_first_seq();
+    if (first == 0 || s_acked_seq + 1 >= first) return;
+
+    uint32_t lost = first - 1 - s_acked_seq;
+    LOG_ROW(TAG, "Log overwrote %" PRIu32 " unsent records", lost);
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.lost += lost;
+    s_count = 0;        // In-flight records are older still
+    taskEXIT_CRITICAL(&s_lock);
+    s_acked_seq = first - 1;
+    if (s_sent_seq < s_acked_seq) s_sent_seq = s_acked_seq;
+}
+
+/* ------------------------------ Publish --------------------------------- */
+
+// Publish the next batch after s_sent_seq into the window; false when the
+// client refused it
+static bool publish_batch(int64_t now) {
+    static weigh_log_record_t recs[MQTT_UPLINK_BATCH_RECORDS];
+    static char payload[MQTT_UPLINK_PAYLOAD_MAX];
+
+    uint32_t from = s_sent_seq + 1;
+    uint32_t last = weigh_log_last_seq();   // Before the read: appends may follow
+    int n = weigh_log_read(from, recs, MQTT_UPLINK_BATCH_RECORDS);
+    if (n < 0) {
+        // Storage error: nothing is lost yet, so do not step over it
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.read_errors++;
+        taskEXIT_CRITICAL(&s_lock);
+        return false;
+    }
+
+    inflight_t e = { .msg_id = -1, .sent_us = now };
+    if (n > 0) {
+        int len = mqtt_uplink_encode_batch(payload, sizeof(payload), s_dev, recs, n);
+        if (len < 0) return false;
+        e.msg_id = esp_mqtt_client_publish(s_client, s_topic_batch, payload, len, 1, 0);
+        if (e.msg_id < 0) {
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.publish_errors++;
+            taskEXIT_CRITICAL(&s_lock);
+            return false;
+        }
+        e.last_seq = recs[n - 1].seq;
+        e.records  = (uint16_t)n;
+    } else {
+        // Only torn slots up to the newest record: step over them in order
+        e.last_seq = last;
+        e.acked = true;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_inflight[(s_head + s_count) % MQTT_UPLINK_INFLIGHT] = e;
+    s_count++;
+    if (n > 0) s_stats.batches_sent++;
+    taskEXIT_CRITICAL(&s_lock);
+
+    s_sent_seq = e.last_seq;
+    return true;
+}
+
+static void publish_rollup(int64_t now) {
+    char payload[384];
+
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t n   = s_rollup_n;
+    float    mn  = s_rollup_min, mx = s_rollup_max;
+    double   sum = s_rollup_sum;
+    int64_t  start = s_rollup_start_us;
+    uint32_t lost = s_stats.lost;
+    taskEXIT_CRITICAL(&s_lock);
+
+    res_heap_stats_t heap;
+    res_heap_snapshot(&heap);
+    jitter_stats_t jit;
+    jitter_monitor_get(&jit);
+
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"dev\":\"%s\",\"period_s\":%" PRIu32 ",\"uptime_s\":%" PRIu32
+                       ",\"weighins\":%" PRIu32 ",\"min_g\":%.1f,\"max_g\":%.1f,\"mean_g\":%.1f"
+                       ",\"backlog\":%" PRIu32 ",\"lost\":%" PRIu32 ",\"heap_free\":%" PRIu32
+                       ",\"heap_min\":%" PRIu32 ",\"heap_largest\":%" PRIu32
+                       ",\"sample_timeouts\":%" PRIu32 ",\"latency_max_us\":%" PRIu32 "}",
+                       s_dev, (uint32_t)((now - start) / 1000000), (uint32_t)(now / 1000000),
+                       n, (double)mn, (double)mx, n ? sum / n : 0.0,
+                       weigh_log_count_from(s_acked_seq + 1), lost, heap.free_bytes,
+                       heap.min_free_bytes, heap.largest_block, jit.timeouts, jit.latency_max_us);
+    if (len < 0 || (size_t)len >= sizeof(payload)) return;
+
+    if (esp_mqtt_client_publish(s_client, s_topic_rollup, payload, len, 1, 0) < 0) {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.publish_errors++;
+        taskEXIT_CRITICAL(&s_lock);
+        return;     // Window stays open, retried next step
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_rollup_start_us = now;
+    s_rollup_n = 0;
+    s_rollup_sum = 0.0;
+    s_stats.rollups_sent++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/* -------------------------------- Task ---------------------------------- */
+
+// One pass: acks, cursor, then (connected only) rollup and batches
+static void uplink_step(void) {
+    int64_t now = esp_timer_get_time();
+
+    collect_acks(now);
+    skip_lost();
+    cursor_save();
+
+    uint32_t last = weigh_log_last_seq();
+    uint32_t unsent = last > s_sent_seq ? last - s_sent_seq : 0;
+    if (unsent > 0 && s_oldest_us == 0) {
+        s_oldest_us = now;
+        s_event_us = 0;
+    }
+    if (!s_connected) return;
+
+    bool rollup = now - s_rollup_start_us >= (int64_t)MQTT_UPLINK_ROLLUP_S * 1000000;
+    if (rollup) {
+        publish_rollup(now);
+    }
+
+    // Radio is awake for the rollup anyway: take the waiting records along
+    bool flush = s_flush_req || s_drain || rollup ||
+                 unsent >= MQTT_UPLINK_BATCH_MIN ||
+                 (unsent > 0 && now - s_oldest_us >= (int64_t)MQTT_UPLINK_MAX_AGE_S * 1000000);
+    if (!flush || unsent == 0) {
+        s_drain = false;
+        s_flush_req = false;
+        return;
+    }
+
+    while (s_sent_seq < last) {
+        taskENTER_CRITICAL(&s_lock);
+        bool room = s_count < MQTT_UPLINK_INFLIGHT;
+        taskEXIT_CRITICAL(&s_lock);
+        if (!room || !publish_batch(now)) break;
+    }
+
+    // Window full: PUBACKs wake us to continue the same flush
+    s_drain = s_sent_seq < last;
+    s_flush_req = false;
+    if (!s_drain) s_oldest_us = 0;
+}
+
+// Sleep until the earliest of: record age limit, rollup, ack timeout
+static TickType_t next_wait(void) {
+    int64_t now = esp_timer_get_time();
+    int64_t wait_us = s_rollup_start_us + (int64_t)MQTT_UPLINK_ROLLUP_S * 1000000 - now;
+
+    if (s_oldest_us) {
+        int64_t age_us = s_oldest_us + (int64_t)MQTT_UPLINK_MAX_AGE_S * 1000000 - now;
+        if (age_us < wait_us) wait_us = age_us;
+    }
+    taskENTER_CRITICAL(&s_lock);
+    if (s_count > 0) {
+        int64_t ack_us = s_inflight[s_head].sent_us +
+                         (int64_t)MQTT_UPLINK_ACK_TIMEOUT_MS * 1000 - now;
+        if (ack_us < wait_us) wait_us = ack_us;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    // The hub reports a weigh-in before the store subscriber has logged it
+    int64_t ev = s_event_us;
+    if (ev && s_oldest_us == 0) {
+        if (now - ev > UPLINK_EVENT_WAIT_US) {
+            s_event_us = 0;
+        } else if (wait_us > (int64_t)UPLINK_EVENT_POLL_MS * 1000) {
+            wait_us = (int64_t)UPLINK_EVENT_POLL_MS * 1000;
+        }
+    }
+
+    if (!s_connected && wait_us < 1000000) {
+        wait_us = 1000000;      // Nothing to send offline, just keep the cursor tidy
+    }
+    if (wait_us < 1000) wait_us = 1000;
+    return pdMS_TO_TICKS(wait_us / 1000);
+}
+
+static void uplink_task(void *arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, next_wait());
+        uplink_step();
+    }
+}
+
+/* --------------------------- Client + hub ------------------------------- */
+
+static void mqtt_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    esp_mqtt_event_handle_t ev = (esp_mqtt_event_handle_t)data;
+
+    switch ((esp_mqtt_event_id_t)id) {
+        case MQTT_EVENT_CONNECTED:
+            taskENTER_CRITICAL(&s_lock);
+            s_stats.connects++;
+            taskEXIT_CRITICAL(&s_lock);
+            s_connected = true;
+            s_drain = true;     // Drain whatever piled up while offline
+            LOG_ROW(TAG, "Connected, %" PRIu32 " records waiting",
+                    weigh_log_count_from(s_acked_seq + 1));
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            s_connected = false;
+            LOG_ROW(TAG, "Disconnected");
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            taskENTER_CRITICAL(&s_lock);
+            for (int i = 0; i < s_count; i++) {
+                inflight_t *e = &s_inflight[(s_head + i) % MQTT_UPLINK_INFLIGHT];
+                if (e->msg_id == ev->msg_id) {
+                    e->acked = true;
+                    break;
+                }
+            }
+            taskEXIT_CRITICAL(&s_lock);
+            break;
+        case MQTT_EVENT_ERROR:
+            LOG_ROW(TAG, "Client error (type %d)",
+                    ev->error_handle ? (int)ev->error_handle->error_type : -1);
+            return;
+        default:
+            return;
+    }
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+// Locked weights: rollup figures, and a nudge to look at the log
+static void uplink_sink(const measurement_t *m, void *ctx) {
+    taskENTER_CRITICAL(&s_lock);
+    if (s_rollup_n == 0 || m->weight_g < s_rollup_min) s_rollup_min = m->weight_g;
+    if (s_rollup_n == 0 || m->weight_g > s_rollup_max) s_rollup_max = m->weight_g;
+    s_rollup_sum += m->weight_g;
+    s_rollup_n++;
+    taskEXIT_CRITICAL(&s_lock);
+
+    s_event_us = esp_timer_get_time();
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+/* ------------------------------ Public ---------------------------------- */
+
+esp_err_t mqtt_uplink_init(const mqtt_uplink_config_t *cfg) {
+    if (s_client) return ESP_OK;
+    if (!cfg || !cfg->uri) return ESP_ERR_INVALID_ARG;
+
+    uint8_t mac[6] = { 0 };
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_dev, sizeof(s_dev), "%02x%02x%02x%02x", mac[2], mac[3], mac[4], mac[5]);
+    snprintf(s_topic_batch, sizeof(s_topic_batch), "%s/%s/weighins",
+             MQTT_UPLINK_TOPIC_PREFIX, s_dev);
+    snprintf(s_topic_rollup, sizeof(s_topic_rollup), "%s/%s/rollup",
+             MQTT_UPLINK_TOPIC_PREFIX, s_dev);
+
+    cursor_load();
+    s_rollup_start_us = esp_timer_get_time();
+
+    const esp_mqtt_client_config_t mcfg = {
+        .broker.address.uri                 = cfg->uri,
+        .broker.verification.certificate    = cfg->cert_pem,
+        .credentials.username               = cfg->username,
+        .credentials.authentication.password = cfg->password,
+        .session.keepalive                  = MQTT_UPLINK_KEEPALIVE_S,
+        .task.priority                      = RES_PRIO_NET,
+    };
+    s_client = esp_mqtt_client_init(&mcfg);
+    if (!s_client) {
+        LOG_ROW(TAG, "Client init failed");
+        return ESP_FAIL;
+    }
+
+    s_task = res_task_start(RES_TASK_MQTT_UPLINK, 0, uplink_task, NULL, NULL);
+    if (app_connection_manager_subscribe("hub_mqtt", uplink_sink, NULL, 4, HUB_DROP_NEWEST,
+                                         MEAS_KIND_BIT(MEAS_KIND_LOCKED), RES_PRIO_HUB) < 0) {
+        LOG_ROW(TAG, "No hub slot, rollups will miss weigh-ins");
+    }
+
+    ESP_ERROR_CHECK(esp_mqtt_client_register_event(s_client, ESP_EVENT_ANY_ID,
+                                                   mqtt_event_handler, NULL));
+    esp_err_t err = esp_mqtt_client_start(s_client);
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "Client start failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    LOG_ROW(TAG, "Uplink %s as %s, cursor %" PRIu32 ", %" PRIu32 " records waiting",
+            cfg->uri, s_dev, s_acked_seq, weigh_log_count_from(s_acked_seq + 1));
+    return ESP_OK;
+}
+
+void mqtt_uplink_flush(void) {
+    s_flush_req = true;
+    if (s_task) xTaskNotifyGive(s_task);
+}
+
+void mqtt_uplink_get_stats(mqtt_uplink_stats_t *out) {
+    if (!out) return;
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+    out->connected = s_connected;
+    out->acked_seq = s_acked_seq;
+    out->backlog   = weigh_log_count_from(s_acked_seq + 1);
+}
@@ -0,0 +1,122 @@
+// File: main/mqtt_uplink/mqtt_uplink.h
+#ifndef MQTT_UPLINK_H
+#define MQTT_UPLINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "weigh_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * MQTT uplink to the backend.
+ *
+ * Weigh-ins are not published one by one. The weigh-in log on flash is the
+ * outbox: every locked weight is already appended there, and the uplink
+ * only keeps a cursor (highest acknowledged seq, in NVS) into it. A flush
+ * happens when MQTT_UPLINK_BATCH_MIN records are waiting, when the oldest
+ * of them is MQTT_UPLINK_MAX_AGE_S old, or when a rollup is due, so the
+ * radio carries one burst per batch instead of one packet per event.
+ *
+ * A flush publishes up to MQTT_UPLINK_BATCH_RECORDS records per message at
+ * QoS1 and keeps up to MQTT_UPLINK_INFLIGHT messages unacknowledged
+ * (pipelined, no round trip per message). The cursor only moves over a
+ * contiguous run of PUBACKs, so after a reboot or an outage the upload
+ * resumes from the first record the broker did not confirm. The outbox is
+ * bounded by WEIGH_LOG_CAPACITY: records overwritten before they could be
+ * sent are counted as lost. Delivery is at-least-once; the backend
+ * de-duplicates on (dev, seq).
+ *
+ * Topics and payloads (JSON):
+ *   <prefix>/<dev>/weighins
+ *     {"dev":"a1b2c3d4","recs":[[seq,time,grams,user,flags],...]}
+ *     time is Unix seconds, or seconds since boot when flags has
+ *     WEIGH_LOG_FLAG_MONO; user 255 = unknown
+ *   <prefix>/<dev>/rollup
+ *     {"dev":..,"period_s":..,"uptime_s":..,"weighins":..,"min_g":..,
+ *      "max_g":..,"mean_g":..,"backlog":..,"lost":..,"heap_free":..,
+ *      "heap_min":..,"heap_largest":..,"sample_timeouts":..,
+ *      "latency_max_us":..}
+ * Rollups live in RAM only: one missed while offline is folded into the
+ * next one (period_s grows).
+ */
+
+#ifndef MQTT_UPLINK_TOPIC_PREFIX
+#define MQTT_UPLINK_TOPIC_PREFIX    "scale"
+#endif
+#ifndef MQTT_UPLINK_BATCH_RECORDS
+#define MQTT_UPLINK_BATCH_RECORDS   16      // Records per message
+#endif
+#ifndef MQTT_UPLINK_BATCH_MIN
+#define MQTT_UPLINK_BATCH_MIN       8       // Waiting records that force a flush
+#endif
+#ifndef MQTT_UPLINK_MAX_AGE_S
+#define MQTT_UPLINK_MAX_AGE_S       900     // Longest a record waits for company
+#endif
+#ifndef MQTT_UPLINK_INFLIGHT
+#define MQTT_UPLINK_INFLIGHT        4       // Unacknowledged messages
+#endif
+#ifndef MQTT_UPLINK_ACK_TIMEOUT_MS
+#define MQTT_UPLINK_ACK_TIMEOUT_MS  30000   // Re-send from the cursor after this
+#endif
+#ifndef MQTT_UPLINK_ROLLUP_S
+#define MQTT_UPLINK_ROLLUP_S        3600
+#endif
+#ifndef MQTT_UPLINK_KEEPALIVE_S
+#define MQTT_UPLINK_KEEPALIVE_S     300     // Few pings between batches
+#endif
+
+// Worst-case record tuple "[4294967295,4294967295,-2147483.6,255,255]," is 43 chars
+#define MQTT_UPLINK_PAYLOAD_MAX     (64 + 44 * MQTT_UPLINK_BATCH_RECORDS)
+
+typedef struct {
+    const char *uri;            // "mqtt://host:1883" or "mqtts://host:8883"
+    const char *username;       // NULL for none
+    const char *password;
+    const char *cert_pem;       // Broker CA for mqtts, NULL otherwise
+} mqtt_uplink_config_t;
+
+typedef struct {
+    bool     connected;
+    uint32_t acked_seq;         // Cursor: every record ≤ this was acknowledged
+    uint32_t backlog;           // Records in the log after the cursor
+    uint32_t batches_sent;      // Weigh-in messages published
+    uint32_t records_acked;
+    uint32_t rollups_sent;
+    uint32_t resends;           // Ack timeouts (window re-sent from the cursor)
+    uint32_t lost;              // Overwritten in the log before upload
+    uint32_t publish_errors;    // esp_mqtt_client_publish() refused
+    uint32_t read_errors;       // Log unreadable, batch retried later
+    uint32_t connects;
+} mqtt_uplink_stats_t;
+
+/**
+ * @brief Weigh-in batch payload (pure, host-testable).
+ * @return Length written (excluding the terminator), or -1 if `len` is too small
+ */
+int mqtt_uplink_encode_batch(char *buf, size_t len, const char *dev,
+                             const weigh_log_record_t *recs, int n);
+
+/**
+ * @brief Start the uplink task and the MQTT client, register the hub
+ *        subscriber. Call after app_connection_manager_init() and
+ *        weigh_log_init(); the client connects once Wi-Fi is up and
+ *        reconnects on its own.
+ */
+esp_err_t mqtt_uplink_init(const mqtt_uplink_config_t *cfg);
+
+/** @brief Publish whatever is waiting now (e.g. before a planned reboot). */
+void mqtt_uplink_flush(void);
+
+/** @brief Counters and cursor. */
+void mqtt_uplink_get_stats(mqtt_uplink_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_UPLINK_H
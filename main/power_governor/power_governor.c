@@ -0,0 +1,212 @@
+// File: main/power_governor/power_governor.c
+// ---------------------------------------------------------------------------
+// Power governor
+//   - DFS between PG_CPU_MIN_MHZ and PG_CPU_MAX_MHZ with automatic light
+//     sleep (tickless idle) whenever no PM lock is held
+//   - HX711 DOUT wakes the chip from light sleep while nobody is on the scale
+//   - Wi-Fi stays associated in DTIM modem sleep (required with BLE coexist)
+//   - CPU boosted only while measuring or serving TLS sessions
+//   - Time-in-mode counters as an energy proxy
+// ---------------------------------------------------------------------------
+
+#include "power_governor.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "wifi_power_management.h"  // for wifi_modem_sleep()
+#include "log_utils.h"
+
+static const char *TAG = "PowerGov";
+
+static SemaphoreHandle_t    s_lock = NULL;
+static StaticSemaphore_t    s_lock_buf;
+static esp_pm_lock_handle_t s_cpu_lock = NULL;      // ESP_PM_CPU_FREQ_MAX
+static esp_pm_lock_handle_t s_awake_lock = NULL;    // ESP_PM_NO_LIGHT_SLEEP
+static esp_timer_handle_t   s_linger_timer = NULL;
+static hx711_t             *s_scale = NULL;
+
+static bool      s_measuring = false;
+static uint32_t  s_tls_sessions = 0;
+static bool      s_tls_linger = false;
+static pg_mode_t s_mode = PG_MODE_IDLE;
+static int64_t   s_mode_since_us = 0;
+static uint64_t  s_time_us[PG_MODE_COUNT];
+static uint32_t  s_transitions = 0;
+
+static const char *const s_mode_names[PG_MODE_COUNT] = { "idle", "tls", "measuring" };
+static const uint16_t    s_mode_ma[PG_MODE_COUNT] = {
+    PG_EST_IDLE_MA, PG_EST_TLS_MA, PG_EST_MEASURING_MA
+};
+
+/** Move the PM locks from `from` to `to`; caller holds s_lock */
+static void apply_locks(pg_mode_t from, pg_mode_t to) {
+    bool cpu_before   = (from != PG_MODE_IDLE);
+    bool cpu_after    = (to != PG_MODE_IDLE);
+    bool awake_before = (from == PG_MODE_MEASURING);
+    bool awake_after  = (to == PG_MODE_MEASURING);
+
+    if (cpu_after && !cpu_before)     esp_pm_lock_acquire(s_cpu_lock);
+    if (awake_after && !awake_before) esp_pm_lock_acquire(s_awake_lock);
+    if (!awake_after && awake_before) esp_pm_lock_release(s_awake_lock);
+    if (!cpu_after && cpu_before)     esp_pm_lock_release(s_cpu_lock);
+
+    // Only pace the HX711 for light sleep when nothing needs fast samples
+    if (s_scale) {
+        hx711_set_low_power(s_scale, to == PG_MODE_IDLE);
+    }
+}
+
+/** Re-evaluate the mode after an input changed; caller holds s_lock */
+static void update_mode(void) {
+    pg_mode_t next = power_governor_select(s_measuring, s_tls_sessions, s_tls_linger);
+    if (next == s_mode) return;
+
+    int64_t now = esp_timer_get_time();
+    s_time_us[s_mode] += (uint64_t)(now - s_mode_since_us);
+    s_mode_since_us = now;
+
+    apply_locks(s_mode, next);
+    s_mode = next;
+    s_transitions++;
+}
+
+static void linger_expired(void *arg) {
+    (void)arg;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_tls_linger = false;
+    update_mode();
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t power_governor_init(hx711_t *scale) {
+    if (s_lock) return ESP_OK;
+
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "pg_cpu", &s_cpu_lock);
+    if (err == ESP_OK) {
+        err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pg_awake", &s_awake_lock);
+    }
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "PM locks unavailable (%s), CONFIG_PM_ENABLE off?", esp_err_to_name(err));
+        return err;
+    }
+
+    const esp_timer_create_args_t targs = {
+        .callback = linger_expired,
+        .name     = "pg_linger",
+    };
+    err = esp_timer_create(&targs, &s_linger_timer);
+    if (err != ESP_OK) return err;
+
+    // HX711 DOUT low = conversion ready; the HX711 driver arms the pin as a
+    // GPIO wake source only while its task is waiting for data
+    s_scale = scale;
+    esp_sleep_enable_gpio_wakeup();
+
+    esp_pm_config_t pm = {
+        .max_freq_mhz       = PG_CPU_MAX_MHZ,
+        .min_freq_mhz       = PG_CPU_MIN_MHZ,
+        .light_sleep_enable = true,
+    };
+    err = esp_pm_configure(&pm);
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Wi-Fi wakes for every DTIM beacon and stays associated
+    wifi_modem_sleep();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_mode = PG_MODE_IDLE;
+    s_mode_since_us = esp_timer_get_time();
+    apply_locks(PG_MODE_IDLE, PG_MODE_IDLE);
+    update_mode();
+    xSemaphoreGive(s_lock);
+
+    LOG_ROW(TAG, "DFS %d-%d MHz, auto light sleep, DOUT wake on GPIO %d",
+            PG_CPU_MIN_MHZ, PG_CPU_MAX_MHZ, scale ? (int)scale->dout_pin : -1);
+    return ESP_OK;
+}
+
+void power_governor_set_measuring(bool measuring) {
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_measuring = measuring;
+    update_mode();
+    xSemaphoreGive(s_lock);
+}
+
+/** Boost for PG_TLS_LINGER_MS from now; caller holds s_lock */
+static void start_linger(void) {
+    s_tls_linger = true;
+    esp_timer_stop(s_linger_timer);
+    esp_timer_start_once(s_linger_timer, (uint64_t)PG_TLS_LINGER_MS * 1000);
+}
+
+void power_governor_tls_handshake(void) {
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // No matching end call: a failed handshake lets the linger run out
+    start_linger();
+    update_mode();
+    xSemaphoreGive(s_lock);
+}
+
+void power_governor_tls_begin(void) {
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_tls_sessions++;
+    update_mode();
+    xSemaphoreGive(s_lock);
+}
+
+void power_governor_tls_end(void) {
+    if (!s_lock) return;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_tls_sessions > 0) {
+        s_tls_sessions--;
+    }
+    if (s_tls_sessions == 0) {
+        start_linger();
+    }
+    update_mode();
+    xSemaphoreGive(s_lock);
+}
+
+void power_governor_get_stats(pg_stats_t *out) {
+    if (!out) return;
+    *out = (pg_stats_t){ 0 };
+    if (!s_lock) return;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int m = 0; m < PG_MODE_COUNT; m++) {
+        out->time_us[m] = s_time_us[m];
+    }
+    out->time_us[s_mode] += (uint64_t)(esp_timer_get_time() - s_mode_since_us);
+    out->transitions = s_transitions;
+    out->mode = s_mode;
+    xSemaphoreGive(s_lock);
+
+    uint64_t charge = 0;
+    for (int m = 0; m < PG_MODE_COUNT; m++) {
+        charge += out->time_us[m] / 1000 * s_mode_ma[m];   // mA·ms
+    }
+    out->est_charge_mAs = (uint32_t)(charge / 1000);
+}
+
+void power_governor_log_stats(void) {
+    pg_stats_t st;
+    power_governor_get_stats(&st);
+    LOG_ROW(TAG, "mode=%s %s=%" PRIu32 "s %s=%" PRIu32 "s %s=%" PRIu32 "s switches=%" PRIu32 " est=%" PRIu32 "mAs",
+            s_mode_names[st.mode],
+            s_mode_names[PG_MODE_IDLE],      (uint32_t)(st.time_us[PG_MODE_IDLE] / 1000000),
+            s_mode_names[PG_MODE_TLS],       (uint32_t)(st.time_us[PG_MODE_TLS] / 1000000),
+            s_mode_names[PG_MODE_MEASURING], (uint32_t)(st.time_us[PG_MODE_MEASURING] / 1000000),
+            st.transitions, st.est_charge_mAs);
+}
@@ -0,0 +1,109 @@
+// File: main/power_governor/power_governor.h
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "hx711.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CPU frequency limits for dynamic frequency scaling (MHz)
+#ifndef PG_CPU_MAX_MHZ
+#define PG_CPU_MAX_MHZ          CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#endif
+
+#ifndef PG_CPU_MIN_MHZ
+#define PG_CPU_MIN_MHZ          40      // XTAL frequency, lowest DFS step
+#endif
+
+// Keep the CPU boosted this long after the last TLS session closes, so a
+// client polling /weight does its next handshake at full speed
+#ifndef PG_TLS_LINGER_MS
+#define PG_TLS_LINGER_MS        5000
+#endif
+
+// Typical supply current per mode (mA), used for the energy estimate only
+#define PG_EST_IDLE_MA          3       // Light sleep between samples, DTIM modem sleep
+#define PG_EST_TLS_MA           40      // CPU at max, radio mostly in modem sleep
+#define PG_EST_MEASURING_MA     50      // CPU at max, no light sleep
+
+/**
+ * @brief Governor modes, lowest power first.
+ *
+ * IDLE       No PM locks: automatic light sleep between HX711 samples,
+ *            wake on HX711 DOUT (data ready) or the next timer.
+ * TLS        CPU held at PG_CPU_MAX_MHZ while TLS sessions are open;
+ *            light sleep is still allowed between packets.
+ * MEASURING  CPU at PG_CPU_MAX_MHZ and light sleep disabled, so the
+ *            sample stream has no wake-up latency while someone is on.
+ */
+typedef enum {
+    PG_MODE_IDLE = 0,
+    PG_MODE_TLS,
+    PG_MODE_MEASURING,
+    PG_MODE_COUNT
+} pg_mode_t;
+
+/** Time spent in each mode since boot (energy proxy) */
+typedef struct {
+    uint64_t time_us[PG_MODE_COUNT];  // Accumulated, including the current mode
+    uint32_t transitions;             // Mode changes since boot
+    uint32_t est_charge_mAs;          // Σ time × PG_EST_*_MA
+    pg_mode_t mode;                   // Current mode
+} pg_stats_t;
+
+/**
+ * @brief Mode selected for a given activity state.
+ *
+ * Pure function with no IDF dependencies, so the policy can be exercised
+ * off-target with the same code the firmware runs.
+ */
+static inline pg_mode_t power_governor_select(bool measuring, uint32_t tls_sessions, bool tls_linger) {
+    if (measuring) return PG_MODE_MEASURING;
+    if (tls_sessions > 0 || tls_linger) return PG_MODE_TLS;
+    return PG_MODE_IDLE;
+}
+
+/**
+ * @brief Configure DFS + automatic light sleep, create the PM locks and
+ *        arm HX711 DOUT as a light-sleep wake source.
+ *        Call once after hx711_init_rtos() and wifi_comm_start().
+ * @param scale  HX711 whose sampling task is switched to low-power mode
+ */
+esp_err_t power_governor_init(hx711_t *scale);
+
+/**
+ * @brief Report whether a weigh-in is in progress (weight manager state
+ *        left / returned to "no weight").
+ */
+void power_governor_set_measuring(bool measuring);
+
+/**
+ * @brief A client started a TLS handshake (ClientHello received).
+ *
+ * Boosts the CPU before the key exchange; the boost ends with the linger
+ * unless power_governor_tls_begin() follows.
+ */
+void power_governor_tls_handshake(void);
+
+/** @brief A TLS session was created (handshake done, requests follow). */
+void power_governor_tls_begin(void);
+
+/** @brief A TLS session closed; the boost lingers for PG_TLS_LINGER_MS. */
+void power_governor_tls_end(void);
+
+/** @brief Snapshot of the time-in-mode counters. */
+void power_governor_get_stats(pg_stats_t *out);
+
+/** @brief Print the time-in-mode counters as a LOG_ROW line. */
+void power_governor_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_GOVERNOR_H
@@ -0,0 +1,296 @@
+// File: main/resources/resources.c
+// ---------------------------------------------------------------------------
+// Static memory plan
+//   - Stacks, TCBs and queue storage for every long-lived object reserved
+//     in .bss from the RES_TASKS / RES_QUEUES tables
+//   - Idempotent start: a slot runs at most one task
+//   - Remaining heap users go through res_malloc() (and the cJSON/mbedTLS
+//     hooks) with a small header, so usage is known per subsystem
+//   - Largest-free-block tracking as the fragmentation metric
+// ---------------------------------------------------------------------------
+
+#include "resources.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+#include "log_utils.h"
+
+static const char *TAG = "Resources";
+
+/* ----------------------------- Tasks ------------------------------------ */
+
+typedef struct {
+    const char   *name;
+    uint32_t      stack_bytes;
+    uint8_t       count;
+    UBaseType_t   priority;
+    BaseType_t    core;
+    StackType_t  *stacks;       // count × stack_bytes
+    StaticTask_t *tcbs;
+    TaskHandle_t *handles;
+} res_task_desc_t;
+
+#define RES_TASK_STORAGE(id, name, stack, n, prio, core) \
+    static StackType_t  s_stack_##id[n][(stack) / sizeof(StackType_t)]; \
+    static StaticTask_t s_tcb_##id[n]; \
+    static TaskHandle_t s_task_##id[n];
+RES_TASKS(RES_TASK_STORAGE)
+#undef RES_TASK_STORAGE
+
+#define RES_TASK_DESC(id, nm, stack, n, prio, core) \
+    [id] = { nm, stack, n, prio, core, &s_stack_##id[0][0], s_tcb_##id, s_task_##id },
+static const res_task_desc_t s_tasks[RES_TASK_COUNT] = {
+    RES_TASKS(RES_TASK_DESC)
+};
+#undef RES_TASK_DESC
+
+/* ----------------------------- Queues ----------------------------------- */
+
+typedef struct {
+    uint32_t       length;
+    uint32_t       item_size;
+    uint8_t        count;
+    uint8_t       *storage;     // count × length × item_size
+    StaticQueue_t *qcbs;
+    QueueHandle_t *handles;
+} res_queue_desc_t;
+
+#define RES_QUEUE_STORAGE(id, len, item, n) \
+    static uint8_t       s_qbuf_##id[n][(len) * (item)]; \
+    static StaticQueue_t s_qcb_##id[n]; \
+    static QueueHandle_t s_queue_##id[n];
+RES_QUEUES(RES_QUEUE_STORAGE)
+#undef RES_QUEUE_STORAGE
+
+#define RES_QUEUE_DESC(id, len, item, n) \
+    [id] = { len, item, n, &s_qbuf_##id[0][0], s_qcb_##id, s_queue_##id },
+static const res_queue_desc_t s_queues[RES_QUEUE_COUNT] = {
+    RES_QUEUES(RES_QUEUE_DESC)
+};
+#undef RES_QUEUE_DESC
+
+static StaticSemaphore_t s_table_lock_buf;
+static SemaphoreHandle_t s_table_lock = NULL;
+
+/* ------------------------------ Heap ------------------------------------ */
+
+#define RES_ALLOC_MAGIC 0xA11Cu
+
+// Prepended to every accounted block; keeps the caller's 8-byte alignment
+typedef struct {
+    uint32_t size;
+    uint16_t owner;
+    uint16_t magic;
+} res_alloc_hdr_t;
+
+static const char *const s_owner_names[RES_HEAP_COUNT] = {
+    "json", "tls", "http", "wifi", "storage"
+};
+
+static portMUX_TYPE           s_heap_lock = portMUX_INITIALIZER_UNLOCKED;
+static res_heap_owner_stats_t s_owner[RES_HEAP_COUNT];
+static uint32_t               s_min_largest = UINT32_MAX;
+
+static void table_lock(void) {
+    if (!s_table_lock) {
+        // First use may precede res_init(); creation is idempotent enough
+        // here because app_main() is the only task at that point
+        s_table_lock = xSemaphoreCreateMutexStatic(&s_table_lock_buf);
+    }
+    xSemaphoreTake(s_table_lock, portMAX_DELAY);
+}
+
+static void table_unlock(void) {
+    xSemaphoreGive(s_table_lock);
+}
+
+static void *accounted_alloc(res_heap_t owner, size_t size, uint32_t caps, bool zero) {
+    if (owner >= RES_HEAP_COUNT || size > UINT32_MAX - sizeof(res_alloc_hdr_t)) {
+        return NULL;
+    }
+    size_t total = sizeof(res_alloc_hdr_t) + size;
+    res_alloc_hdr_t *h = zero ? heap_caps_calloc(1, total, caps) : heap_caps_malloc(total, caps);
+
+    taskENTER_CRITICAL(&s_heap_lock);
+    if (h) {
+        s_owner[owner].bytes += (uint32_t)size;
+        s_owner[owner].allocs++;
+        if (s_owner[owner].bytes > s_owner[owner].peak) {
+            s_owner[owner].peak = s_owner[owner].bytes;
+        }
+    } else {
+        s_owner[owner].failures++;
+    }
+    taskEXIT_CRITICAL(&s_heap_lock);
+
+    if (!h) return NULL;
+    h->size  = (uint32_t)size;
+    h->owner = (uint16_t)owner;
+    h->magic = RES_ALLOC_MAGIC;
+    return h + 1;
+}
+
+void *res_malloc(res_heap_t owner, size_t size) {
+    return accounted_alloc(owner, size, MALLOC_CAP_8BIT, false);
+}
+
+void *res_calloc(res_heap_t owner, size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    return accounted_alloc(owner, n * size, MALLOC_CAP_8BIT, true);
+}
+
+void res_free(void *ptr) {
+    if (!ptr) return;
+    res_alloc_hdr_t *h = (res_alloc_hdr_t *)ptr - 1;
+    configASSERT(h->magic == RES_ALLOC_MAGIC && h->owner < RES_HEAP_COUNT);
+
+    taskENTER_CRITICAL(&s_heap_lock);
+    s_owner[h->owner].bytes -= h->size;
+    taskEXIT_CRITICAL(&s_heap_lock);
+
+    h->magic = 0;
+    heap_caps_free(h);
+}
+
+static void *json_malloc(size_t size) {
+    return res_malloc(RES_HEAP_JSON, size);
+}
+
+// mbedTLS allocator hooks (CONFIG_MBEDTLS_CUSTOM_MEM_ALLOC); internal RAM
+// as with the default CONFIG_MBEDTLS_INTERNAL_MEM_ALLOC
+void *esp_mbedtls_mem_calloc(size_t n, size_t size) {
+    if (size && n > SIZE_MAX / size) return NULL;
+    return accounted_alloc(RES_HEAP_TLS, n * size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, true);
+}
+
+void esp_mbedtls_mem_free(void *ptr) {
+    res_free(ptr);
+}
+
+/* ----------------------------- Public ----------------------------------- */
+
+void res_init(void) {
+    table_lock();
+    table_unlock();
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_malloc,
+        .free_fn   = res_free,
+    };
+    cJSON_InitHooks(&hooks);
+}
+
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name,
+                            void *arg) {
+    if (id >= RES_TASK_COUNT || instance < 0 || instance >= s_tasks[id].count) {
+        LOG_ROW(TAG, "No task slot %d/%d", (int)id, instance);
+        return NULL;
+    }
+    const res_task_desc_t *d = &s_tasks[id];
+
+    table_lock();
+    TaskHandle_t h = d->handles[instance];
+    if (!h) {
+        StackType_t *stack = d->stacks + (size_t)instance * (d->stack_bytes / sizeof(StackType_t));
+        h = xTaskCreateStaticPinnedToCore(fn, name ? name : d->name, d->stack_bytes, arg,
+                                          d->priority, stack, &d->tcbs[instance], d->core);
+        d->handles[instance] = h;
+    }
+    table_unlock();
+    return h;
+}
+
+void res_task_stop(res_task_t id, int instance) {
+    if (id >= RES_TASK_COUNT || instance < 0 || instance >= s_tasks[id].count) return;
+    const res_task_desc_t *d = &s_tasks[id];
+
+    table_lock();
+    TaskHandle_t h = d->handles[instance];
+    d->handles[instance] = NULL;
+    if (h) {
+        vTaskDelete(h);
+        vTaskDelay(2);   // Let the idle task unlink the TCB before the slot is reused
+    }
+    table_unlock();
+}
+
+void res_task_exit(res_task_t id, int instance) {
+    if (id < RES_TASK_COUNT && instance >= 0 && instance < s_tasks[id].count) {
+        table_lock();
+        s_tasks[id].handles[instance] = NULL;
+        table_unlock();
+    }
+    vTaskDelete(NULL);
+}
+
+QueueHandle_t res_queue_create(res_queue_t id, int instance, UBaseType_t length, UBaseType_t item_size) {
+    if (id >= RES_QUEUE_COUNT || instance < 0 || instance >= s_queues[id].count ||
+        length == 0 || length > s_queues[id].length || item_size > s_queues[id].item_size) {
+        LOG_ROW(TAG, "Queue %d/%d: %u × %u B exceeds its reservation",
+                (int)id, instance, (unsigned)length, (unsigned)item_size);
+        return NULL;
+    }
+    const res_queue_desc_t *d = &s_queues[id];
+
+    table_lock();
+    QueueHandle_t q = d->handles[instance];
+    if (!q) {
+        uint8_t *storage = d->storage + (size_t)instance * d->length * d->item_size;
+        q = xQueueCreateStatic(length, item_size, storage, &d->qcbs[instance]);
+        d->handles[instance] = q;
+    }
+    table_unlock();
+    return q;
+}
+
+void res_heap_snapshot(res_heap_stats_t *out) {
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+
+    out->free_bytes     = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    out->min_free_bytes = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    out->largest_block  = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    out->fragmentation_pct = out->free_bytes
+        ? (uint8_t)(100u - (uint32_t)((uint64_t)out->largest_block * 100u / out->free_bytes))
+        : 0;
+
+    taskENTER_CRITICAL(&s_heap_lock);
+    if (out->largest_block < s_min_largest) {
+        s_min_largest = out->largest_block;
+    }
+    out->min_largest_block = s_min_largest;
+    memcpy(out->owner, s_owner, sizeof(s_owner));
+    taskEXIT_CRITICAL(&s_heap_lock);
+}
+
+void res_log_report(void) {
+    res_heap_stats_t st;
+    res_heap_snapshot(&st);
+
+    LOG_ROW(TAG, "heap free=%" PRIu32 " min=%" PRIu32 " largest=%" PRIu32 " (low %" PRIu32 ") frag=%u%%",
+            st.free_bytes, st.min_free_bytes, st.largest_block, st.min_largest_block,
+            (unsigned)st.fragmentation_pct);
+    for (int i = 0; i < RES_HEAP_COUNT; i++) {
+        const res_heap_owner_stats_t *o = &st.owner[i];
+        if (o->allocs == 0 && o->failures == 0) continue;
+        LOG_ROW(TAG, "  %-8s now=%" PRIu32 " peak=%" PRIu32 " allocs=%" PRIu32 " fail=%" PRIu32,
+                s_owner_names[i], o->bytes, o->peak, o->allocs, o->failures);
+    }
+
+    table_lock();
+    for (int id = 0; id < RES_TASK_COUNT; id++) {
+        const res_task_desc_t *d = &s_tasks[id];
+        for (int i = 0; i < d->count; i++) {
+            if (!d->handles[i]) continue;
+            LOG_ROW(TAG, "  %-14s core %d prio %u stack free %u / %" PRIu32,
+                    pcTaskGetName(d->handles[i]), (int)d->core,
+                    (unsigned)uxTaskPriorityGet(d->handles[i]),
+                    (unsigned)uxTaskGetStackHighWaterMark(d->handles[i]), d->stack_bytes);
+        }
+    }
+    table_unlock();
+}
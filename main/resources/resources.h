@@ -0,0 +1,157 @@
+// File: main/resources/resources.h
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Static memory plan.
+ *
+ * Every long-lived task and queue has its stack / storage reserved here at
+ * link time, so the heap only ever sees short-lived buffers (JSON, TLS
+ * records, scan results) and the map file shows the full budget. Starting
+ * an entry that is already running returns the running instance instead
+ * of creating a second one.
+ *
+ * Stack sizes are in bytes (ESP-IDF FreeRTOS counts stack depth in bytes).
+ */
+
+/*
+ * Scheduling plan.
+ *
+ * Core 1 (APP CPU) belongs to acquisition: the HX711 task runs there at the
+ * top application priority, woken by the DOUT data-ready interrupt (which
+ * is installed from that task, so it is serviced on core 1 too), and the
+ * weight manager sits just below it. Nothing else is pinned to core 1;
+ * Wi-Fi, lwIP, esp_timer, NimBLE and the timer service are pinned to
+ * core 0 in sdkconfig, as are the HTTPS server, TLS, BLE history, the hub
+ * sinks (logging, storage) and every other task in the table below. A TLS
+ * handshake can then only delay other networking work, never a sample.
+ */
+#define RES_CORE_NET            0
+#define RES_CORE_SENSE          1
+
+#define RES_PRIO_SAMPLING       10  // Above every other application task
+#define RES_PRIO_FILTER         9   // Weight manager (state machine, lock)
+#define RES_PRIO_HTTPS          5   // HTTPS server task and httpd (workers one below)
+#define RES_PRIO_NET            4   // Wi-Fi helpers, BLE history, MQTT uplink
+#define RES_PRIO_HUB            2   // Default for hub subscribers
+
+// Publish-hub subscriber tasks/queues (one pair per subscriber)
+#define RES_HUB_SUBSCRIBERS     8
+#define RES_HUB_QUEUE_DEPTH     8
+
+// HTTP async workers (rest_api): blocking handlers, one request each
+#define RES_HTTP_WORKERS        2
+
+//        id                       name             stack  instances            priority           core
+#define RES_TASKS(X) \
+        X(RES_TASK_HX711,          "HX711_Task",    4096,  1,                   RES_PRIO_SAMPLING, RES_CORE_SENSE) \
+        X(RES_TASK_WEIGHT_MANAGER, "WeightManager", 4096,  1,                   RES_PRIO_FILTER,   RES_CORE_SENSE) \
+        X(RES_TASK_HUB,            "hub",           3072,  RES_HUB_SUBSCRIBERS, RES_PRIO_HUB,      RES_CORE_NET) \
+        X(RES_TASK_BLE_HISTORY,    "ble_history",   4096,  1,                   RES_PRIO_NET,      RES_CORE_NET) \
+        X(RES_TASK_WIFI_SCAN,      "wifi_scan",     4096,  1,                   RES_PRIO_NET,      RES_CORE_NET) \
+        X(RES_TASK_WIFI_CONN,      "wifi_conn",     4096,  1,                   RES_PRIO_NET,      RES_CORE_NET) \
+        X(RES_TASK_HTTPS_SERVER,   "https_server",  8192,  1,                   RES_PRIO_HTTPS,    RES_CORE_NET) \
+        X(RES_TASK_HTTPS_MONITOR,  "https_monitor", 4096,  1,                   RES_PRIO_HTTPS - 1, RES_CORE_NET) \
+        X(RES_TASK_MQTT_UPLINK,    "mqtt_uplink",   4096,  1,                   RES_PRIO_NET,      RES_CORE_NET) \
+        X(RES_TASK_HTTP_WORKER,    "http_worker",   6144,  RES_HTTP_WORKERS,    RES_PRIO_HTTPS - 1, RES_CORE_NET)
+
+//        id                       length               max item size    instances
+#define RES_QUEUES(X) \
+        X(RES_QUEUE_SAMPLES,       8,                   sizeof(float),   1) \
+        X(RES_QUEUE_HUB,           RES_HUB_QUEUE_DEPTH, sizeof(void *),  RES_HUB_SUBSCRIBERS) \
+        X(RES_QUEUE_BLE_HISTORY,   1,                   8,               1) \
+        X(RES_QUEUE_HTTP_ASYNC,    RES_HTTP_WORKERS,    2 * sizeof(void *), 1)
+
+typedef enum {
+#define RES_ENUM(id, ...) id,
+    RES_TASKS(RES_ENUM)
+#undef RES_ENUM
+    RES_TASK_COUNT
+} res_task_t;
+
+typedef enum {
+#define RES_ENUM(id, ...) id,
+    RES_QUEUES(RES_ENUM)
+#undef RES_ENUM
+    RES_QUEUE_COUNT
+} res_queue_t;
+
+// Heap owners for the allocations that remain dynamic
+typedef enum {
+    RES_HEAP_JSON = 0,      // cJSON (via cJSON_InitHooks)
+    RES_HEAP_TLS,           // mbedTLS (CONFIG_MBEDTLS_CUSTOM_MEM_ALLOC)
+    RES_HEAP_HTTP,          // Request bodies
+    RES_HEAP_WIFI,          // Scan result lists
+    RES_HEAP_STORAGE,       // File read buffers
+    RES_HEAP_COUNT
+} res_heap_t;
+
+typedef struct {
+    uint32_t bytes;         // Currently allocated
+    uint32_t peak;          // Highest `bytes` seen
+    uint32_t allocs;        // Successful allocations since boot
+    uint32_t failures;      // Allocations that returned NULL
+} res_heap_owner_stats_t;
+
+typedef struct {
+    uint32_t free_bytes;        // Free 8-bit capable heap now
+    uint32_t min_free_bytes;    // Low-water mark since boot
+    uint32_t largest_block;     // Largest allocatable block now
+    uint32_t min_largest_block; // Smallest largest-block seen by snapshots
+    uint8_t  fragmentation_pct; // 100 - largest / free
+    res_heap_owner_stats_t owner[RES_HEAP_COUNT];
+} res_heap_stats_t;
+
+/** @brief Install the cJSON hooks. Call first thing in app_main(). */
+void res_init(void);
+
+/**
+ * @brief Start a task from its statically reserved slot, with the priority
+ *        and core the scheduling plan assigns to it.
+ * @param instance  Slot index for pooled entries (0 otherwise)
+ * @param name      Task name, NULL for the table default
+ * @return The task handle; the already running task if the slot is in use
+ */
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name,
+                            void *arg);
+
+/** @brief Delete a task started with res_task_start() and free its slot. */
+void res_task_stop(res_task_t id, int instance);
+
+/** @brief End the calling task and free its slot (instead of vTaskDelete(NULL)). */
+void res_task_exit(res_task_t id, int instance);
+
+/**
+ * @brief Create (or return) a queue in its statically reserved storage.
+ * @return NULL if `length` / `item_size` exceed the reservation
+ */
+QueueHandle_t res_queue_create(res_queue_t id, int instance, UBaseType_t length, UBaseType_t item_size);
+
+/** @brief Accounted allocation; free with res_free(). */
+void *res_malloc(res_heap_t owner, size_t size);
+void *res_calloc(res_heap_t owner, size_t n, size_t size);
+void  res_free(void *ptr);
+
+/** @brief Heap totals, fragmentation and per-owner counters. */
+void res_heap_snapshot(res_heap_stats_t *out);
+
+/** @brief LOG_ROW report: heap, per-owner usage and static task stack headroom. */
+void res_log_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESOURCES_H
@@ -1,44 +1,115 @@
 // File: rest_api.c
+// ---------------------------------------------------------------------------
+// HTTP API
+//   - Static route table, registered on the single HTTPS server
+//   - Blocking handlers run on a small worker pool (async request API)
+//   - 503 + Retry-After when the pool is busy, never an unbounded queue
+//   - Chunked /history from the weigh-in log, server-sent /stream
+//   - /users: profile enrolment, removal and per-user history
+//   - Everything else falls through to the web dashboard (web_assets)
+// ---------------------------------------------------------------------------
+
 #include "rest_api.h"
-#include "esp_http_server.h"
 #include "esp_log.h"
 #include "cJSON.h"
-#include "weight_manager.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "resources.h"
+#include "scale_config.h"
+#include "weigh_log.h"
+#include "user_profiles.h"
+#include "jitter_monitor.h"
+#include "web_assets.h"
+#include "storage.h"
+#include "hx711.h"
 #include "esp_timer.h"
 #include "esp_system.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
 
 static const char *TAG = "REST_API";
-static httpd_handle_t server_handle = NULL;
 
-// GET /weight → { "weight_g": <float> }
+typedef struct {
+    const char     *uri;
+    httpd_method_t  method;
+    esp_err_t     (*handler)(httpd_req_t *req);
+    bool            async;      // May block: run on a worker
+    bool            stream;     // Open-ended: also needs a stream slot
+} rest_route_t;
+
+// What a worker receives: the detached request and the handler to run
+typedef struct {
+    httpd_req_t *req;
+    esp_err_t  (*fn)(httpd_req_t *req);
+} rest_job_t;
+
+_Static_assert(sizeof(rest_job_t) <= 2 * sizeof(void *), "rest_job_t outgrew RES_QUEUE_HTTP_ASYNC");
+
+static QueueHandle_t     s_jobs = NULL;
+static SemaphoreHandle_t s_idle = NULL;         // Free workers
+static StaticSemaphore_t s_idle_buf;
+static SemaphoreHandle_t s_stream_slots = NULL; // Streams that may still open
+static StaticSemaphore_t s_stream_slots_buf;
+
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+static measurement_t     s_latest;              // Last published measurement
+static bool              s_latest_valid = false;
+static TaskHandle_t      s_streamers[RES_HTTP_WORKERS];
+static rest_api_stats_t  s_stats;
+
+static void stats_add(uint32_t *field) {
+    taskENTER_CRITICAL(&s_lock);
+    (*field)++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static bool latest_get(measurement_t *m) {
+    taskENTER_CRITICAL(&s_lock);
+    *m = s_latest;
+    bool valid = s_latest_valid;
+    taskEXIT_CRITICAL(&s_lock);
+    return valid;
+}
+
+static int measurement_json(char *buf, size_t len, const measurement_t *m) {
+    int w = snprintf(buf, len,
+                     "{\"weight\":%.2f,\"stable\":%s,\"seq\":%" PRIu32 ",\"ts\":%lld}",
+                     m->weight_g, m->kind == MEAS_KIND_LOCKED ? "true" : "false",
+                     m->seq, (long long)m->timestamp);
+    return (w < 0 || (size_t)w >= len) ? -1 : w;
+}
+
+// GET /weight → { "weight": <g>, "stable": <bool>, "seq": <n>, "ts": <unix> }
 static esp_err_t get_weight_handler(httpd_req_t *req)
 {
-    float weight = weight_manager_get_weight();
-    cJSON *root = cJSON_CreateObject();
-    if (!root) {
-        ESP_LOGE(TAG, "JSON create failed");
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
-    }
-    cJSON_AddNumberToObject(root, "weight_g", weight);
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    if (!json_str) {
-        ESP_LOGE(TAG, "JSON print failed");
+    measurement_t m;
+    char json[96];
+    int len;
+    if (!latest_get(&m) || (len = measurement_json(json, sizeof(json), &m)) < 0) {
         httpd_resp_send_500(req);
-        return ESP_FAIL;
+        return ESP_OK;
     }
     httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, json_str, strlen(json_str));
-    free(json_str);
+    httpd_resp_send(req, json, len);
     return ESP_OK;
 }
 
-// POST /config → accept { "threshold": <float> }, respond 204
+// POST /config → accept any subset of the scale_config fields (plus the
+// legacy "threshold" = wake_threshold_g); the merged object is validated
+// as a whole and published, 204 on success, 400 with the reason otherwise
 static esp_err_t post_config_handler(httpd_req_t *req)
 {
     int len = req->content_len;
-    char *buf = malloc(len + 1);
+    if (len <= 0 || len > 1024) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad length");
+        return ESP_FAIL;
+    }
+    char *buf = res_malloc(RES_HEAP_HTTP, len + 1);
     if (!buf) {
         ESP_LOGE(TAG, "malloc failed");
         httpd_resp_send_500(req);
@@ -46,43 +117,66 @@ static esp_err_t post_config_handler(httpd_req_t *req)
     }
     int ret = httpd_req_recv(req, buf, len);
     if (ret <= 0) {
-        free(buf);
+        res_free(buf);
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
     buf[ret] = 0;
     cJSON *json = cJSON_Parse(buf);
-    free(buf);
+    res_free(buf);
     if (!json) {
         ESP_LOGW(TAG, "Invalid JSON");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
-    cJSON *jthr = cJSON_GetObjectItem(json, "threshold");
-    if (cJSON_IsNumber(jthr)) {
-        weight_manager_set_threshold(jthr->valuedouble);
-    } else {
-        ESP_LOGW(TAG, "Missing threshold field");
-        cJSON_Delete(json);
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing 'threshold'");
-        return ESP_FAIL;
+
+    scale_config_t cfg;
+    scale_config_snapshot(&cfg);
+    int applied = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, json) {
+        if (!cJSON_IsNumber(item)) continue;
+        const char *name = strcmp(item->string, "threshold") == 0 ? "wake_threshold_g" : item->string;
+        if (scale_config_set_field(&cfg, name, item->valuedouble)) {
+            applied++;
+        }
     }
     cJSON_Delete(json);
+    if (applied == 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No known configuration field");
+        return ESP_FAIL;
+    }
+
+    const char *why = NULL;
+    esp_err_t err = scale_config_publish(&cfg, true, &why);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, why ? why : "Invalid configuration");
+        return ESP_FAIL;
+    } else if (err == ESP_ERR_TIMEOUT) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
     httpd_resp_set_status(req, "204 No Content");
     httpd_resp_send(req, NULL, 0);
     return ESP_OK;
 }
 
-// GET /config → { "threshold": <float> }
+// GET /config → { "version": <n>, "threshold": <float>, <field>: <value>, ... }
 static esp_err_t get_config_handler(httpd_req_t *req)
 {
-    float threshold = weight_manager_get_threshold();
+    scale_config_t cfg;
+    scale_config_snapshot(&cfg);
     cJSON *root = cJSON_CreateObject();
     if (!root) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
-    cJSON_AddNumberToObject(root, "threshold", threshold);
+    cJSON_AddNumberToObject(root, "version", cfg.version);
+    cJSON_AddNumberToObject(root, "threshold", cfg.wake_threshold_g);
+    for (size_t i = 0; i < scale_config_field_count; i++) {
+        cJSON_AddNumberToObject(root, scale_config_fields[i].name,
+                                scale_config_get_field(&cfg, &scale_config_fields[i]));
+    }
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     if (!json_str) {
@@ -91,22 +185,67 @@ static esp_err_t get_config_handler(httpd_req_t *req)
     }
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json_str, strlen(json_str));
-    free(json_str);
+    cJSON_free(json_str);
     return ESP_OK;
 }
 
-// GET /health → { "uptime_s": <float>, "free_heap": <uint32> }
+// GET /health → { "uptime_s", "free_heap", "min_free_heap", "largest_block",
+//                 "sensor": {...}, "http": {...}, "www": {...}, "storage": {...} }
 static esp_err_t get_health_handler(httpd_req_t *req)
 {
     uint64_t uptime_us = esp_timer_get_time();
-    uint32_t free_heap = esp_get_free_heap_size();
+    res_heap_stats_t heap;
+    res_heap_snapshot(&heap);
+    rest_api_stats_t st;
+    rest_api_get_stats(&st);
+
     cJSON *root = cJSON_CreateObject();
     if (!root) {
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
     cJSON_AddNumberToObject(root, "uptime_s", uptime_us / 1e6);
-    cJSON_AddNumberToObject(root, "free_heap", free_heap);
+    cJSON_AddNumberToObject(root, "free_heap", heap.free_bytes);
+    cJSON_AddNumberToObject(root, "min_free_heap", heap.min_free_bytes);
+    cJSON_AddNumberToObject(root, "largest_block", heap.largest_block);
+    hx711_health_stats_t hs;
+    hx711_get_health_stats(&hs);
+    cJSON *sensor = cJSON_AddObjectToObject(root, "sensor");
+    if (sensor) {
+        cJSON_AddStringToObject(sensor, "state", hx711_health_name(hs.state));
+        cJSON_AddNumberToObject(sensor, "timeouts", hs.timeouts);
+        cJSON_AddNumberToObject(sensor, "saturated", hs.saturated);
+        cJSON_AddNumberToObject(sensor, "stuck", hs.stuck);
+        cJSON_AddNumberToObject(sensor, "offline_events", hs.offline_events);
+        cJSON_AddNumberToObject(sensor, "probes", hs.probes);
+    }
+    cJSON *http = cJSON_AddObjectToObject(root, "http");
+    if (http) {
+        cJSON_AddNumberToObject(http, "requests", st.requests);
+        cJSON_AddNumberToObject(http, "async", st.async_runs);
+        cJSON_AddNumberToObject(http, "busy", st.busy);
+        cJSON_AddNumberToObject(http, "streams", st.streams_open);
+    }
+    web_assets_stats_t www;
+    web_assets_get_stats(&www);
+    cJSON *web = cJSON_AddObjectToObject(root, "www");
+    if (web) {
+        cJSON_AddNumberToObject(web, "requests", www.requests);
+        cJSON_AddNumberToObject(web, "not_modified", www.not_modified);
+        cJSON_AddNumberToObject(web, "bytes", www.bytes);
+    }
+    storage_stats_t sto;
+    storage_get_stats(&sto);
+    cJSON *fs = cJSON_AddObjectToObject(root, "storage");
+    if (fs) {
+        cJSON_AddStringToObject(fs, "backend", sto.backend);
+        cJSON_AddNumberToObject(fs, "total", sto.total_bytes);
+        cJSON_AddNumberToObject(fs, "used", sto.used_bytes);
+        cJSON_AddNumberToObject(fs, "writes", sto.writes);
+        cJSON_AddNumberToObject(fs, "syncs", sto.syncs);
+        cJSON_AddNumberToObject(fs, "errors", sto.errors);
+        cJSON_AddNumberToObject(fs, "write_us_max", sto.write_us_max);
+    }
     char *json_str = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
     if (!json_str) {
@@ -115,66 +254,518 @@ static esp_err_t get_health_handler(httpd_req_t *req)
     }
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, json_str, strlen(json_str));
-    free(json_str);
+    cJSON_free(json_str);
     return ESP_OK;
 }
 
-// URI registration
-static const httpd_uri_t weight_uri = {
-    .uri      = "/weight",
-    .method   = HTTP_GET,
-    .handler  = get_weight_handler,
-    .user_ctx = NULL
-};
-static const httpd_uri_t config_post_uri = {
-    .uri      = "/config",
-    .method   = HTTP_POST,
-    .handler  = post_config_handler,
-    .user_ctx = NULL
-};
-static const httpd_uri_t config_get_uri = {
-    .uri      = "/config",
-    .method   = HTTP_GET,
-    .handler  = get_config_handler,
-    .user_ctx = NULL
-};
-static const httpd_uri_t health_uri = {
-    .uri      = "/health",
-    .method   = HTTP_GET,
-    .handler  = get_health_handler,
-    .user_ctx = NULL
+// GET /jitter → sampling interval / latency histograms; ?reset=1 clears
+// them first, so a load test can start from zero
+static esp_err_t get_jitter_handler(httpd_req_t *req)
+{
+    char query[16], val[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "reset", val, sizeof(val)) == ESP_OK &&
+        val[0] == '1') {
+        jitter_monitor_reset();
+    }
+
+    char json[512];
+    int len = jitter_monitor_to_json(json, sizeof(json));
+    if (len < 0) {
+        httpd_resp_send_500(req);
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json, len);
+    return ESP_OK;
+}
+
+static uint32_t query_u32(const char *query, const char *key, uint32_t def)
+{
+    char val[12];
+    if (!query || httpd_query_key_value(query, key, val, sizeof(val)) != ESP_OK) return def;
+    return (uint32_t)strtoul(val, NULL, 10);
+}
+
+// GET /history?from=<seq>&max=<n> → {"recs":[[seq,time,grams,user,flags],...],"next":<seq>}
+// Same tuples as the MQTT uplink; resume with from=<next>
+static esp_err_t get_history_handler(httpd_req_t *req)
+{
+    char query[48];
+    bool have_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    uint32_t seq = query_u32(have_query ? query : NULL, "from", 0);
+    uint32_t max = query_u32(have_query ? query : NULL, "max", WEIGH_LOG_CAPACITY);
+    if (seq < weigh_log_first_seq()) seq = weigh_log_first_seq();
+
+    weigh_log_record_t recs[REST_HISTORY_CHUNK];
+    char chunk[REST_HISTORY_CHUNK * 44 + 16];
+
+    httpd_resp_set_type(req, "application/json");
+    if (httpd_resp_sendstr_chunk(req, "{\"recs\":[") != ESP_OK) return ESP_FAIL;
+
+    uint32_t sent = 0;
+    while (sent < max) {
+        int want = max - sent < REST_HISTORY_CHUNK ? (int)(max - sent) : REST_HISTORY_CHUNK;
+        int n = weigh_log_read(seq, recs, want);
+        if (n <= 0) break;
+
+        size_t pos = 0;
+        for (int i = 0; i < n; i++) {
+            float g = recs[i].weight_g;
+            if (!(g > -1.0e6f)) g = -1.0e6f;    // Bounded tuple length
+            if (g > 1.0e6f) g = 1.0e6f;
+            int w = snprintf(chunk + pos, sizeof(chunk) - pos, "%s[%" PRIu32 ",%" PRIu32 ",%.1f,%u,%u]",
+                             sent + i ? "," : "", recs[i].seq, recs[i].timestamp,
+                             (double)g, (unsigned)recs[i].user_id,
+                             (unsigned)recs[i].flags);
+            if (w < 0 || (size_t)w >= sizeof(chunk) - pos) break;
+            pos += (size_t)w;
+        }
+        if (httpd_resp_send_chunk(req, chunk, pos) != ESP_OK) return ESP_FAIL;   // Client left
+        sent += (uint32_t)n;
+        seq = recs[n - 1].seq + 1;
+    }
+
+    int w = snprintf(chunk, sizeof(chunk), "],\"next\":%" PRIu32 "}", seq);
+    httpd_resp_send_chunk(req, chunk, w);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* ------------------------------ /users ------------------------------ */
+
+// "/users[/]" → -1 with *history false; "/users/<id>[/history]" → id;
+// anything else → -2. The query string is ignored.
+static int users_path(const char *uri, bool *history)
+{
+    *history = false;
+    const char *p = uri + strlen("/users");
+    if (*p == '/') p++;
+    if (*p == '\0' || *p == '?') return -1;
+    if (p[-1] != '/' || *p < '0' || *p > '9') return -2;
+
+    char *end;
+    unsigned long id = strtoul(p, &end, 10);
+    if (id >= USER_PROFILES_MAX) return -2;
+    if (strncmp(end, "/history", 8) == 0) {
+        *history = true;
+        end += 8;
+    }
+    return (*end == '\0' || *end == '?') ? (int)id : -2;
+}
+
+static cJSON *user_json(uint8_t id, const user_profile_t *u)
+{
+    cJSON *o = cJSON_CreateObject();
+    if (!o) return NULL;
+    cJSON_AddNumberToObject(o, "id", id);
+    cJSON_AddStringToObject(o, "name", u->name);
+    cJSON_AddStringToObject(o, "gender", u->body.gender == GENDER_FEMALE ? "female" : "male");
+    cJSON_AddNumberToObject(o, "age", u->body.age);
+    cJSON_AddNumberToObject(o, "height_cm", u->body.height_cm);
+    cJSON_AddNumberToObject(o, "neck_cm", u->body.neck_cm);
+    cJSON_AddNumberToObject(o, "waist_cm", u->body.waist_cm);
+    cJSON_AddNumberToObject(o, "hip_cm", u->body.hip_cm);
+    cJSON_AddNumberToObject(o, "weight_hint_g", u->weight_hint_g);
+    cJSON_AddNumberToObject(o, "weigh_ins", u->count);
+    cJSON_AddNumberToObject(o, "mean_g", u->mean_g);
+    cJSON_AddNumberToObject(o, "sigma_g", sqrtf(u->var_g2));
+    cJSON_AddNumberToObject(o, "last_seq", u->hist_seq);
+    return o;
+}
+
+static esp_err_t send_json(httpd_req_t *req, cJSON *root)
+{
+    char *json_str = root ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (!json_str) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json_str, strlen(json_str));
+    cJSON_free(json_str);
+    return ESP_OK;
+}
+
+// GET /users/<id>/history?from=<seq>&max=<n>
+//   → {"recs":[[seq,time,grams,body_fat_x100,flags,match_x10],...],"next":<seq>}
+// body_fat_x100 is 65535 when unknown; resume with from=<next>
+static esp_err_t user_history_handler(httpd_req_t *req, uint8_t id)
+{
+    char query[48];
+    bool have_query = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK;
+    uint32_t seq = query_u32(have_query ? query : NULL, "from", 0);
+    uint32_t max = query_u32(have_query ? query : NULL, "max", USER_HISTORY_CAPACITY);
+
+    user_history_record_t recs[REST_HISTORY_CHUNK];
+    char chunk[REST_HISTORY_CHUNK * 52 + 16];
+
+    httpd_resp_set_type(req, "application/json");
+    if (httpd_resp_sendstr_chunk(req, "{\"recs\":[") != ESP_OK) return ESP_FAIL;
+
+    uint32_t sent = 0;
+    while (sent < max) {
+        int want = max - sent < REST_HISTORY_CHUNK ? (int)(max - sent) : REST_HISTORY_CHUNK;
+        int n = user_profiles_read_history(id, seq, recs, want);
+        if (n <= 0) break;
+
+        size_t pos = 0;
+        for (int i = 0; i < n; i++) {
+            float g = recs[i].weight_g;
+            if (!(g > -1.0e6f)) g = -1.0e6f;    // Bounded tuple length
+            if (g > 1.0e6f) g = 1.0e6f;
+            int w = snprintf(chunk + pos, sizeof(chunk) - pos, "%s[%" PRIu32 ",%" PRIu32 ",%.1f,%u,%u,%u]",
+                             sent + i ? "," : "", recs[i].seq, recs[i].timestamp, (double)g,
+                             (unsigned)recs[i].body_fat_x100, (unsigned)recs[i].flags,
+                             (unsigned)recs[i].match_x10);
+            if (w < 0 || (size_t)w >= sizeof(chunk) - pos) break;
+            pos += (size_t)w;
+        }
+        if (httpd_resp_send_chunk(req, chunk, pos) != ESP_OK) return ESP_FAIL;   // Client left
+        sent += (uint32_t)n;
+        seq = recs[n - 1].seq + 1;
+    }
+
+    int w = snprintf(chunk, sizeof(chunk), "],\"next\":%" PRIu32 "}", seq);
+    httpd_resp_send_chunk(req, chunk, w);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// GET /users → {"users":[<profile>,...]}; GET /users/<id> → <profile>;
+// GET /users/<id>/history → see user_history_handler
+static esp_err_t get_users_handler(httpd_req_t *req)
+{
+    bool history;
+    int id = users_path(req->uri, &history);
+    user_profile_t u;
+
+    if (id == -2) {
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+    if (id >= 0) {
+        if (!user_profiles_get((uint8_t)id, &u)) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such user");
+            return ESP_OK;
+        }
+        return history ? user_history_handler(req, (uint8_t)id) : send_json(req, user_json((uint8_t)id, &u));
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *list = root ? cJSON_AddArrayToObject(root, "users") : NULL;
+    for (int i = 0; list && i < USER_PROFILES_MAX; i++) {
+        if (user_profiles_get((uint8_t)i, &u)) {
+            cJSON_AddItemToArray(list, user_json((uint8_t)i, &u));
+        }
+    }
+    return send_json(req, root);
+}
+
+static void json_number(const cJSON *obj, const char *key, float *out)
+{
+    const cJSON *item = cJSON_GetObjectItem(obj, key);
+    if (cJSON_IsNumber(item)) *out = (float)item->valuedouble;
+}
+
+// POST /users/<id> → create or update a profile from any subset of
+// {"name","gender":"male"|"female","age","height_cm","neck_cm","waist_cm",
+//  "hip_cm","weight_hint_g"}; unspecified fields keep their value.
+// 204 on success, 400 with the reason otherwise
+static esp_err_t post_user_handler(httpd_req_t *req)
+{
+    bool history;
+    int id = users_path(req->uri, &history);
+    if (id < 0 || history) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected /users/<id>");
+        return ESP_FAIL;
+    }
+
+    int len = req->content_len;
+    char buf[256];
+    if (len <= 0 || len >= (int)sizeof(buf)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Bad length");
+        return ESP_FAIL;
+    }
+    int ret = httpd_req_recv(req, buf, len);
+    if (ret <= 0) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    buf[ret] = 0;
+    cJSON *json = cJSON_Parse(buf);
+    if (!cJSON_IsObject(json)) {
+        cJSON_Delete(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    user_profile_t u;
+    if (!user_profiles_get((uint8_t)id, &u)) {
+        memset(&u, 0, sizeof(u));
+    }
+    const cJSON *item = cJSON_GetObjectItem(json, "name");
+    if (cJSON_IsString(item)) {
+        strlcpy(u.name, item->valuestring, sizeof(u.name));
+    }
+    item = cJSON_GetObjectItem(json, "gender");
+    if (cJSON_IsString(item)) {
+        u.body.gender = strcmp(item->valuestring, "female") == 0 ? GENDER_FEMALE : GENDER_MALE;
+    }
+    item = cJSON_GetObjectItem(json, "age");
+    if (cJSON_IsNumber(item)) {
+        u.body.age = item->valueint;
+    }
+    json_number(json, "height_cm", &u.body.height_cm);
+    json_number(json, "neck_cm", &u.body.neck_cm);
+    json_number(json, "waist_cm", &u.body.waist_cm);
+    json_number(json, "hip_cm", &u.body.hip_cm);
+    json_number(json, "weight_hint_g", &u.weight_hint_g);
+    cJSON_Delete(json);
+
+    if (u.body.age < 0 || u.body.age > 150 || u.body.height_cm < 0.0f || u.body.neck_cm < 0.0f ||
+        u.body.waist_cm < 0.0f || u.body.hip_cm < 0.0f || !(u.weight_hint_g >= 0.0f)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Out of range");
+        return ESP_FAIL;
+    }
+    if (user_profiles_set((uint8_t)id, u.name, &u.body, u.weight_hint_g) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_status(req, "204 No Content");
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
+
+// DELETE /users/<id> → remove the profile and its history, 204 / 404
+static esp_err_t delete_user_handler(httpd_req_t *req)
+{
+    bool history;
+    int id = users_path(req->uri, &history);
+    user_profile_t u;
+    if (id < 0 || history || !user_profiles_get((uint8_t)id, &u)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No such user");
+        return ESP_OK;
+    }
+    if (user_profiles_delete((uint8_t)id) != ESP_OK) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_status(req, "204 No Content");
+    httpd_resp_send(req, NULL, 0);
+    return ESP_OK;
+}
+
+// GET /stream → text/event-stream, one "data:" event per new measurement,
+// at most REST_STREAM_HZ; a comment line keeps idle connections alive
+static esp_err_t get_stream_handler(httpd_req_t *req)
+{
+    int slot = -1;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < RES_HTTP_WORKERS; i++) {
+        if (!s_streamers[i]) {
+            s_streamers[i] = xTaskGetCurrentTaskHandle();
+            slot = i;
+            break;
+        }
+    }
+    s_stats.streams_open++;
+    taskEXIT_CRITICAL(&s_lock);
+
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    int64_t  start = esp_timer_get_time();
+    int64_t  last_tx = 0;
+    uint32_t last_seq = 0;
+    esp_err_t err = httpd_resp_sendstr_chunk(req, "retry: 2000\n\n");
+
+    while (err == ESP_OK && esp_timer_get_time() - start < (int64_t)REST_STREAM_MAX_S * 1000000) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));   // New measurement or keep-alive check
+
+        int64_t now = esp_timer_get_time();
+        measurement_t m;
+        if (latest_get(&m) && m.seq != last_seq) {
+            char ev[112];
+            char json[96];
+            int len = measurement_json(json, sizeof(json), &m);
+            if (len > 0) {
+                len = snprintf(ev, sizeof(ev), "data: %s\n\n", json);
+                err = httpd_resp_send_chunk(req, ev, len);
+                last_seq = m.seq;
+                last_tx = now;
+                vTaskDelay(pdMS_TO_TICKS(1000 / REST_STREAM_HZ));   // Rate cap
+            }
+        } else if (now - last_tx >= (int64_t)REST_STREAM_KEEPALIVE_S * 1000000) {
+            err = httpd_resp_sendstr_chunk(req, ": ka\n\n");
+            last_tx = now;
+        }
+    }
+    if (err == ESP_OK) {
+        httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    if (slot >= 0) s_streamers[slot] = NULL;
+    s_stats.streams_open--;
+    taskEXIT_CRITICAL(&s_lock);
+    xSemaphoreGive(s_stream_slots);     // Taken in route_dispatch
+    return ESP_OK;
+}
+
+// Route table
+static const rest_route_t s_routes[] = {
+    { "/weight",   HTTP_GET,    get_weight_handler,  false, false },
+    { "/config",   HTTP_GET,    get_config_handler,  false, false },
+    { "/config",   HTTP_POST,   post_config_handler, true,  false },   // Waits for config readers
+    { "/health",   HTTP_GET,    get_health_handler,  false, false },
+    { "/jitter",   HTTP_GET,    get_jitter_handler,  false, false },
+    { "/history",  HTTP_GET,    get_history_handler, true,  false },   // Flash reads
+    { "/stream",   HTTP_GET,    get_stream_handler,  true,  true  },
+    { "/users/?*", HTTP_GET,    get_users_handler,   true,  false },   // Flash reads (history)
+    { "/users/*",  HTTP_POST,   post_user_handler,   true,  false },   // NVS write
+    { "/users/*",  HTTP_DELETE, delete_user_handler, true,  false },   // NVS write, file removal
+    { "/*",        HTTP_GET,    web_assets_handler,  false, false },   // Last: matches any path
 };
+#define ROUTE_COUNT (sizeof(s_routes) / sizeof(s_routes[0]))
+
+// Spare handler slots for routes other modules add to the same server
+#define REST_SPARE_URI_HANDLERS 4
+
+static void send_busy(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", "1");
+    httpd_resp_sendstr(req, "Busy");
+}
+
+/* ----------------------------- Workers ------------------------------ */
+
+static void http_worker_task(void *arg)
+{
+    rest_job_t job;
+    for (;;) {
+        if (xQueueReceive(s_jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+
+        job.fn(job.req);
+        // Idle before the socket is handed back: the client's next request
+        // on it must find this worker free (the job queue holds one per worker)
+        xSemaphoreGive(s_idle);
+        httpd_req_async_handler_complete(job.req);
+    }
+}
 
-esp_err_t rest_server_start(void)
+// Runs on the httpd task: quick routes inline, the rest to a worker
+static esp_err_t route_dispatch(httpd_req_t *req)
 {
-    if (server_handle) {
-        ESP_LOGW(TAG, "Server already running");
-        return ESP_ERR_INVALID_STATE;
+    const rest_route_t *route = (const rest_route_t *)req->user_ctx;
+    stats_add(&s_stats.requests);
+    if (!route->async) {
+        return route->handler(req);
     }
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port      = 80;
-    config.max_uri_handlers = 8;
-    config.ctrl_port        = 0;
 
-    esp_err_t ret = httpd_start(&server_handle, &config);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "httpd_start failed: %s", esp_err_to_name(ret));
-        return ret;
+    if (route->stream && xSemaphoreTake(s_stream_slots, 0) != pdTRUE) {
+        stats_add(&s_stats.busy);
+        send_busy(req);
+        return ESP_OK;
     }
-    httpd_register_uri_handler(server_handle, &weight_uri);
-    httpd_register_uri_handler(server_handle, &config_post_uri);
-    httpd_register_uri_handler(server_handle, &config_get_uri);
-    httpd_register_uri_handler(server_handle, &health_uri);
+    esp_err_t err = rest_api_offload(req, route->handler);
+    if (err == ESP_OK) return ESP_OK;
 
-    ESP_LOGI(TAG, "REST server started on port %d", config.server_port);
+    if (route->stream) xSemaphoreGive(s_stream_slots);
+    if (err == ESP_ERR_TIMEOUT) {
+        stats_add(&s_stats.busy);
+        send_busy(req);
+    } else {
+        httpd_resp_send_500(req);
+    }
     return ESP_OK;
 }
 
-void rest_server_stop(void)
+/* ------------------------------ Public ------------------------------ */
+
+esp_err_t rest_api_offload(httpd_req_t *req, esp_err_t (*fn)(httpd_req_t *req))
 {
-    if (server_handle) {
-        httpd_stop(server_handle);
-        server_handle = NULL;
-        ESP_LOGI(TAG, "REST server stopped");
+    if (!s_idle || xSemaphoreTake(s_idle, 0) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
     }
+    rest_job_t job = { .fn = fn };
+    esp_err_t err = httpd_req_async_handler_begin(req, &job.req);
+    if (err == ESP_OK && xQueueSend(s_jobs, &job, 0) != pdTRUE) {
+        httpd_req_async_handler_complete(job.req);   // Cannot happen: one slot per worker
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        xSemaphoreGive(s_idle);
+        return err;
+    }
+    stats_add(&s_stats.async_runs);
+    return ESP_OK;
+}
+
+void rest_api_tune(httpd_config_t *cfg)
+{
+    cfg->max_open_sockets    = REST_MAX_SOCKETS;
+    cfg->backlog_conn        = 2;
+    cfg->lru_purge_enable    = true;    // Oldest idle keep-alive client makes room
+    cfg->max_uri_handlers    = ROUTE_COUNT + REST_SPARE_URI_HANDLERS;
+    cfg->uri_match_fn        = httpd_uri_match_wildcard;    // For the "/*" fallback
+    cfg->recv_wait_timeout   = 5;
+    cfg->send_wait_timeout   = 5;
+    // TCP keep-alive: reclaim sockets (and stream workers) of vanished peers
+    cfg->keep_alive_enable   = true;
+    cfg->keep_alive_idle     = 10;
+    cfg->keep_alive_interval = 5;
+    cfg->keep_alive_count    = 3;
+}
+
+esp_err_t rest_api_register(httpd_handle_t server)
+{
+    if (!s_jobs) {
+        s_jobs = res_queue_create(RES_QUEUE_HTTP_ASYNC, 0, RES_HTTP_WORKERS, sizeof(rest_job_t));
+        s_idle = xSemaphoreCreateCountingStatic(RES_HTTP_WORKERS, RES_HTTP_WORKERS, &s_idle_buf);
+        s_stream_slots = xSemaphoreCreateCountingStatic(RES_HTTP_WORKERS - 1, RES_HTTP_WORKERS - 1,
+                                                        &s_stream_slots_buf);
+        if (!s_jobs || !s_idle || !s_stream_slots) return ESP_ERR_NO_MEM;
+        for (int i = 0; i < RES_HTTP_WORKERS; i++) {
+            res_task_start(RES_TASK_HTTP_WORKER, i, http_worker_task, NULL, NULL);
+        }
+    }
+
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+        const httpd_uri_t uri = {
+            .uri      = s_routes[i].uri,
+            .method   = s_routes[i].method,
+            .handler  = route_dispatch,
+            .user_ctx = (void *)&s_routes[i],
+        };
+        esp_err_t err = httpd_register_uri_handler(server, &uri);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Route %s: %s", s_routes[i].uri, esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "%d routes, %d async workers", (int)ROUTE_COUNT, RES_HTTP_WORKERS);
+    return ESP_OK;
+}
+
+void rest_api_set_latest_measurement(const measurement_t *m)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_latest = *m;
+    s_latest_valid = true;
+    TaskHandle_t wake[RES_HTTP_WORKERS];
+    memcpy(wake, s_streamers, sizeof(wake));
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < RES_HTTP_WORKERS; i++) {
+        if (wake[i]) xTaskNotifyGive(wake[i]);
+    }
+}
+
+void rest_api_get_stats(rest_api_stats_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
 }
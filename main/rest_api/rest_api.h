@@ -2,18 +2,94 @@
 #ifndef REST_API_H
 #define REST_API_H
 
+#include <stdint.h>
 #include "esp_err.h"
+#include "esp_http_server.h"
+#include "app_connection_manager.h"   // measurement_t
 
-/**
- * @brief  Starts the RESTful HTTP server. Call after Wi‑Fi is connected.
+/*
+ * HTTP API of the scale, served by the one HTTPS server in wifi_comm.
  *
- * @return ESP_OK on success, esp_err_t on failure.
+ * All endpoints live in a static route table:
+ *   GET  /weight    Latest published measurement
+ *   GET  /config    Live configuration          POST /config  update
+ *   GET  /health    Uptime, heap, load cell health, HTTP counters
+ *   GET  /jitter    Sampling jitter (?reset=1)
+ *   GET  /history   Weigh-in log (?from=<seq>&max=<n>), chunked JSON
+ *   GET  /stream    Server-sent events, one per measurement
+ *   GET  /users     Profiles                    GET  /users/<id>
+ *   POST /users/<id>    Create / update a profile (name, body, weight hint)
+ *   DELETE /users/<id>  Remove a profile and its history
+ *   GET  /users/<id>/history   Per-user weigh-ins (?from=<seq>&max=<n>)
+ *   GET  anything else: the web dashboard (web_assets)
+ * Quick handlers answer on the httpd task. Handlers that can block (flash
+ * reads, a config publish waiting for readers, an open-ended stream) are
+ * handed to RES_HTTP_WORKERS worker tasks with the async request API, so a
+ * slow client never holds up the others. When every worker is busy the
+ * request gets 503 + Retry-After instead of queueing behind them; streams
+ * may occupy all workers but one.
+ */
+
+// Open connections. Each is a TLS session (mbedTLS buffers are allocated
+// per record with CONFIG_MBEDTLS_DYNAMIC_BUFFER, ~20 KB while busy), and
+// lwIP has CONFIG_LWIP_MAX_SOCKETS = 10: listener + control socket + 4
+// clients leaves room for MQTT, UDP telemetry and SNTP
+#ifndef REST_MAX_SOCKETS
+#define REST_MAX_SOCKETS        4
+#endif
+
+// Streams: live-rate cap, idle keep-alive comment, and maximum duration
+// (EventSource clients reconnect on their own)
+#ifndef REST_STREAM_HZ
+#define REST_STREAM_HZ          10
+#endif
+#ifndef REST_STREAM_KEEPALIVE_S
+#define REST_STREAM_KEEPALIVE_S 15
+#endif
+#ifndef REST_STREAM_MAX_S
+#define REST_STREAM_MAX_S       300
+#endif
+
+// Records per /history chunk (one weigh_log_read per chunk)
+#ifndef REST_HISTORY_CHUNK
+#define REST_HISTORY_CHUNK      16
+#endif
+
+typedef struct {
+    uint32_t requests;          // Every routed request
+    uint32_t async_runs;        // Handed to a worker
+    uint32_t busy;              // Refused with 503 (no worker / stream slot)
+    uint32_t streams_open;
+} rest_api_stats_t;
+
+/**
+ * @brief Apply the socket / keep-alive / handler limits the API is sized
+ *        for (RAM budget: one TLS session per socket). Call on the config
+ *        before starting the server.
  */
-esp_err_t rest_server_start(void);
+void rest_api_tune(httpd_config_t *cfg);
 
 /**
- * @brief  Stops the RESTful HTTP server and frees resources.
+ * @brief Register every route on a started server and start the workers
+ *        (once; later calls only register the routes).
  */
-void     rest_server_stop(void);
+esp_err_t rest_api_register(httpd_handle_t server);
+
+/**
+ * @brief Store the latest measurement (GET /weight) and wake the open
+ *        streams. Called from the connection manager's HTTPS subscriber.
+ */
+void rest_api_set_latest_measurement(const measurement_t *m);
+
+/**
+ * @brief Finish @p req on an HTTP worker: detaches it (async request API)
+ *        and queues fn(req). For handlers outside the route table.
+ * @return ESP_OK when queued, ESP_ERR_TIMEOUT when every worker is busy
+ *         (the caller still owns req and must answer it).
+ */
+esp_err_t rest_api_offload(httpd_req_t *req, esp_err_t (*fn)(httpd_req_t *req));
+
+/** @brief Counters since boot. */
+void rest_api_get_stats(rest_api_stats_t *out);
 
-#endif // REST_API_H
\ No newline at end of file
+#endif // REST_API_H
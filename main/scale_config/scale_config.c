@@ -0,0 +1,299 @@
+// File: main/scale_config/scale_config.c
+// ---------------------------------------------------------------------------
+// Live scale configuration
+//   - Immutable versioned objects in a small static slot pool
+//   - Publish = validate whole object, copy to a free slot, pointer store
+//   - Readers announce the version they start from; a slot is reused only
+//     when it is older than every announced version (grace period)
+//   - Persisted as one NVS blob, re-validated on load
+// ---------------------------------------------------------------------------
+
+#include "scale_config.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "log_utils.h"
+
+static const char *TAG = "ScaleCfg";
+
+#define SCALE_CFG_NVS_NS    "scalecfg"
+#define SCALE_CFG_NVS_KEY   "cfg"
+
+static const scale_config_t s_defaults = {
+    .version            = 0,
+    .wake_threshold_g   = 20.0f,
+    .sleep_threshold_g  = 10.0f,
+    .debounce_count     = 3,
+    .stable_count       = 10,
+    .stable_tolerance_g = 50.0f,
+    .step_threshold_raw = 1000.0f,
+    .kf_q_normal        = 0.5f,
+    .kf_q_boosted       = 10.0f,
+    .boost_samples      = 5,
+    .kf_q_min           = 0.001f,
+    .kf_q_max           = 0.1f,
+    .kf_r_min           = 0.5f,
+    .kf_r_max           = 5.0f,
+    .kf_innov_threshold = 10.0f,
+    .cd_k_sigma         = 1.5f,
+    .cd_h_sigma         = 5.0f,
+    .median_min         = 3,
+    .median_max         = SCALE_CFG_MEDIAN_MAX,
+    .median_step        = 2,
+};
+
+#define FIELD(n, t) { #n, t, (uint16_t)offsetof(scale_config_t, n) }
+const scale_config_field_t scale_config_fields[] = {
+    FIELD(wake_threshold_g,   SCALE_CFG_FLOAT),
+    FIELD(sleep_threshold_g,  SCALE_CFG_FLOAT),
+    FIELD(debounce_count,     SCALE_CFG_U8),
+    FIELD(stable_count,       SCALE_CFG_U8),
+    FIELD(stable_tolerance_g, SCALE_CFG_FLOAT),
+    FIELD(step_threshold_raw, SCALE_CFG_FLOAT),
+    FIELD(kf_q_normal,        SCALE_CFG_FLOAT),
+    FIELD(kf_q_boosted,       SCALE_CFG_FLOAT),
+    FIELD(boost_samples,      SCALE_CFG_U8),
+    FIELD(kf_q_min,           SCALE_CFG_FLOAT),
+    FIELD(kf_q_max,           SCALE_CFG_FLOAT),
+    FIELD(kf_r_min,           SCALE_CFG_FLOAT),
+    FIELD(kf_r_max,           SCALE_CFG_FLOAT),
+    FIELD(kf_innov_threshold, SCALE_CFG_FLOAT),
+    FIELD(cd_k_sigma,         SCALE_CFG_FLOAT),
+    FIELD(cd_h_sigma,         SCALE_CFG_FLOAT),
+    FIELD(median_min,         SCALE_CFG_U8),
+    FIELD(median_max,         SCALE_CFG_U8),
+    FIELD(median_step,        SCALE_CFG_U8),
+};
+#undef FIELD
+const size_t scale_config_field_count = sizeof(scale_config_fields) / sizeof(scale_config_fields[0]);
+
+static scale_config_t     s_slots[SCALE_CONFIG_SLOTS];
+static scale_config_t    *s_current = NULL;     // Published object
+static uint32_t           s_version = 0;        // Version of s_current
+static uint32_t           s_seen[SCALE_CONFIG_MAX_READERS];   // 0 = quiescent
+static int                s_reader_count = 0;
+static SemaphoreHandle_t  s_write_lock = NULL;
+static StaticSemaphore_t  s_write_lock_buf;
+
+/** Oldest version an active reader may still hold */
+static uint32_t oldest_in_use(void) {
+    uint32_t oldest = UINT32_MAX;
+    int n = __atomic_load_n(&s_reader_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        uint32_t v = __atomic_load_n(&s_seen[i], __ATOMIC_SEQ_CST);
+        if (v != 0 && v < oldest) {
+            oldest = v;
+        }
+    }
+    return oldest;
+}
+
+/** Slot no reader can reach any more; caller holds s_write_lock */
+static scale_config_t *free_slot(void) {
+    uint32_t oldest = oldest_in_use();
+    for (int i = 0; i < SCALE_CONFIG_SLOTS; i++) {
+        scale_config_t *s = &s_slots[i];
+        if (s != s_current && (s->version == 0 || s->version < oldest)) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static bool finite_pos(float v) {
+    return isfinite(v) && v > 0.0f;
+}
+
+esp_err_t scale_config_validate(const scale_config_t *c, const char **why) {
+    const char *err = NULL;
+
+    if (!c) {
+        err = "missing";
+    } else if (!finite_pos(c->sleep_threshold_g) || !finite_pos(c->wake_threshold_g) ||
+               c->wake_threshold_g > 200000.0f) {
+        err = "thresholds must be positive";
+    } else if (c->sleep_threshold_g >= c->wake_threshold_g) {
+        err = "sleep_threshold_g must be below wake_threshold_g";
+    } else if (c->debounce_count < 1 || c->debounce_count > 50) {
+        err = "debounce_count out of 1..50";
+    } else if (c->stable_count < 2 || c->stable_count > SCALE_CFG_STABLE_COUNT_MAX) {
+        err = "stable_count out of range";
+    } else if (!finite_pos(c->stable_tolerance_g)) {
+        err = "stable_tolerance_g must be positive";
+    } else if (!finite_pos(c->step_threshold_raw)) {
+        err = "step_threshold_raw must be positive";
+    } else if (!finite_pos(c->kf_q_normal) || !isfinite(c->kf_q_boosted) ||
+               c->kf_q_boosted < c->kf_q_normal) {
+        err = "kf_q_boosted must be at least kf_q_normal";
+    } else if (!finite_pos(c->kf_q_min) || !isfinite(c->kf_q_max) || c->kf_q_max < c->kf_q_min ||
+               !finite_pos(c->kf_r_min) || !isfinite(c->kf_r_max) || c->kf_r_max < c->kf_r_min) {
+        err = "Kalman bounds must be positive with min <= max";
+    } else if (!finite_pos(c->kf_innov_threshold)) {
+        err = "kf_innov_threshold must be positive";
+    } else if (!finite_pos(c->cd_k_sigma) || !isfinite(c->cd_h_sigma) ||
+               c->cd_h_sigma <= c->cd_k_sigma) {
+        err = "cd_h_sigma must exceed cd_k_sigma";
+    } else if (c->median_min < 1 || c->median_min > c->median_max ||
+               c->median_max > SCALE_CFG_MEDIAN_MAX || c->median_step < 1) {
+        err = "median window out of range";
+    }
+
+    if (why) *why = err;
+    return err ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+static esp_err_t save_nvs(const scale_config_t *c) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(SCALE_CFG_NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, SCALE_CFG_NVS_KEY, c, sizeof(*c));
+    if (err == ESP_OK) {
+        err = nvs_commit(h);
+    }
+    nvs_close(h);
+    return err;
+}
+
+esp_err_t scale_config_init(void) {
+    if (s_write_lock) return ESP_OK;
+    s_write_lock = xSemaphoreCreateMutexStatic(&s_write_lock_buf);
+    if (!s_write_lock) return ESP_ERR_NO_MEM;
+
+    s_slots[0] = s_defaults;
+    s_slots[0].version = 1;
+    s_version = 1;
+    __atomic_store_n(&s_current, &s_slots[0], __ATOMIC_SEQ_CST);
+
+    scale_config_t stored;
+    size_t len = sizeof(stored);
+    nvs_handle_t h;
+    if (nvs_open(SCALE_CFG_NVS_NS, NVS_READONLY, &h) == ESP_OK) {
+        esp_err_t err = nvs_get_blob(h, SCALE_CFG_NVS_KEY, &stored, &len);
+        nvs_close(h);
+        const char *why = NULL;
+        if (err == ESP_OK && len == sizeof(stored)) {
+            if (scale_config_publish(&stored, false, &why) == ESP_OK) {
+                LOG_ROW(TAG, "Loaded from NVS (wake %.1f g, sleep %.1f g)",
+                        stored.wake_threshold_g, stored.sleep_threshold_g);
+                return ESP_OK;
+            }
+            LOG_ROW(TAG, "Stored configuration rejected: %s", why ? why : "?");
+        } else if (err == ESP_OK) {
+            LOG_ROW(TAG, "Stored configuration has another layout, using defaults");
+        }
+    }
+    LOG_ROW(TAG, "Using defaults");
+    return ESP_OK;
+}
+
+const scale_config_t *scale_config_defaults(void) {
+    return &s_defaults;
+}
+
+esp_err_t scale_config_publish(const scale_config_t *cfg, bool persist, const char **why) {
+    esp_err_t err = scale_config_validate(cfg, why);
+    if (err != ESP_OK) return err;
+    if (!s_write_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+
+    // Wait out the grace period of whichever old slot frees up first
+    scale_config_t *slot = free_slot();
+    for (TickType_t waited = 0; !slot && waited < pdMS_TO_TICKS(SCALE_CONFIG_GRACE_MS); waited++) {
+        vTaskDelay(1);
+        slot = free_slot();
+    }
+    if (!slot) {
+        xSemaphoreGive(s_write_lock);
+        if (why) *why = "readers still hold older versions";
+        return ESP_ERR_TIMEOUT;
+    }
+
+    *slot = *cfg;
+    slot->version = s_version + 1;
+
+    // Pointer first, then version: a reader that announces the new
+    // version is guaranteed to load the new pointer
+    __atomic_store_n(&s_current, slot, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_version, slot->version, __ATOMIC_SEQ_CST);
+
+    if (persist) {
+        err = save_nvs(slot);
+        if (err != ESP_OK) {
+            LOG_ROW(TAG, "v%" PRIu32 " published but not saved: %s", slot->version, esp_err_to_name(err));
+        }
+    }
+    LOG_ROW(TAG, "v%" PRIu32 " published%s", slot->version, persist ? " and saved" : "");
+    xSemaphoreGive(s_write_lock);
+    return err;
+}
+
+void scale_config_snapshot(scale_config_t *out) {
+    if (!out) return;
+    if (!s_write_lock) {
+        *out = s_defaults;
+        return;
+    }
+    // The writer lock keeps the current slot from being recycled meanwhile
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    *out = *s_current;
+    xSemaphoreGive(s_write_lock);
+}
+
+int scale_config_register_reader(const char *name) {
+    if (!s_write_lock) return -1;
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    int id = -1;
+    if (s_reader_count < SCALE_CONFIG_MAX_READERS) {
+        id = s_reader_count;
+        s_seen[id] = 0;
+        __atomic_store_n(&s_reader_count, id + 1, __ATOMIC_RELEASE);
+    }
+    xSemaphoreGive(s_write_lock);
+    if (id < 0) {
+        LOG_ROW(TAG, "No reader slot for %s", name ? name : "?");
+    }
+    return id;
+}
+
+const scale_config_t *scale_config_acquire(int reader) {
+    if (reader < 0 || reader >= SCALE_CONFIG_MAX_READERS) {
+        return &s_defaults;
+    }
+    uint32_t v = __atomic_load_n(&s_version, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_seen[reader], v, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&s_current, __ATOMIC_SEQ_CST);
+}
+
+void scale_config_release(int reader) {
+    if (reader < 0 || reader >= SCALE_CONFIG_MAX_READERS) return;
+    __atomic_store_n(&s_seen[reader], 0, __ATOMIC_RELEASE);
+}
+
+bool scale_config_set_field(scale_config_t *cfg, const char *name, double value) {
+    if (!cfg || !name) return false;
+    for (size_t i = 0; i < scale_config_field_count; i++) {
+        const scale_config_field_t *f = &scale_config_fields[i];
+        if (strcmp(f->name, name) != 0) continue;
+
+        uint8_t *p = (uint8_t *)cfg + f->offset;
+        if (f->type == SCALE_CFG_FLOAT) {
+            *(float *)p = (float)value;
+        } else {
+            if (!(value >= 0.0 && value <= 255.0)) return false;
+            *p = (uint8_t)value;
+        }
+        return true;
+    }
+    return false;
+}
+
+double scale_config_get_field(const scale_config_t *cfg, const scale_config_field_t *field) {
+    const uint8_t *p = (const uint8_t *)cfg + field->offset;
+    return field->type == SCALE_CFG_FLOAT ? (double)*(const float *)p : (double)*p;
+}
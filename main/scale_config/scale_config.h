@@ -0,0 +1,141 @@
+// File: main/scale_config/scale_config.h
+#ifndef SCALE_CONFIG_H
+#define SCALE_CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Live configuration for the sampling and weight-manager tasks.
+ *
+ * The whole parameter set is one immutable, versioned object. A writer
+ * validates a complete candidate, copies it into a free slot and publishes
+ * it with a single pointer store; readers take the current pointer at the
+ * top of each iteration and drop it before they block again (RCU with
+ * per-reader grace periods). Readers never lock, and a slot is only reused
+ * once every active reader has moved past the version it held.
+ */
+
+// Largest stable-lock window (weight manager ring size)
+#define SCALE_CFG_STABLE_COUNT_MAX  32
+
+// Largest median window (median filter capacity)
+#define SCALE_CFG_MEDIAN_MAX        11
+
+// Lock-free readers that can hold a configuration at the same time
+#ifndef SCALE_CONFIG_MAX_READERS
+#define SCALE_CONFIG_MAX_READERS    4
+#endif
+
+// Published objects kept in flight (current + ones readers may still hold)
+#ifndef SCALE_CONFIG_SLOTS
+#define SCALE_CONFIG_SLOTS          3
+#endif
+
+// Longest a publish waits for readers to release an old slot
+#ifndef SCALE_CONFIG_GRACE_MS
+#define SCALE_CONFIG_GRACE_MS       1000
+#endif
+
+typedef struct {
+    uint32_t version;               // Assigned on publish, starts at 1
+
+    // Weight manager (grams unless noted)
+    float    wake_threshold_g;      // Weight placed at or above this
+    float    sleep_threshold_g;     // Weight removed at or below this
+    uint8_t  debounce_count;        // Readings to confirm a transition
+    uint8_t  stable_count;          // Readings that must agree to lock
+    float    stable_tolerance_g;    // Max spread across those readings
+
+    // Step-aware filters (raw counts unless noted)
+    float    step_threshold_raw;    // Step detector before calibration
+    float    kf_q_normal;           // Kalman Q outside a step
+    float    kf_q_boosted;          // Kalman Q right after a step
+    uint8_t  boost_samples;         // Samples the boost lasts
+    float    kf_q_min, kf_q_max;    // Adaptive Kalman bounds
+    float    kf_r_min, kf_r_max;
+    float    kf_innov_threshold;    // Adaptive Kalman innovation threshold
+    float    cd_k_sigma;            // CUSUM drift allowance (noise sigmas)
+    float    cd_h_sigma;            // CUSUM alarm threshold (noise sigmas)
+    uint8_t  median_min;            // Median window at rest
+    uint8_t  median_max;            // Median window during steps
+    uint8_t  median_step;           // Widening per step sample
+} scale_config_t;
+
+/** Field types for name-based access (JSON/console binding) */
+typedef enum {
+    SCALE_CFG_FLOAT,
+    SCALE_CFG_U8,
+} scale_config_type_t;
+
+typedef struct {
+    const char          *name;
+    scale_config_type_t  type;
+    uint16_t             offset;
+} scale_config_field_t;
+
+extern const scale_config_field_t scale_config_fields[];
+extern const size_t               scale_config_field_count;
+
+/**
+ * @brief Publish the defaults, then replace them with the copy saved in NVS
+ *        if it is still valid. NVS must already be initialised.
+ */
+esp_err_t scale_config_init(void);
+
+/** @brief Built-in defaults (never reclaimed, valid forever). */
+const scale_config_t *scale_config_defaults(void);
+
+/**
+ * @brief Check a complete candidate.
+ * @param why  Optional: receives a static description of the first problem
+ */
+esp_err_t scale_config_validate(const scale_config_t *cfg, const char **why);
+
+/**
+ * @brief Validate and publish a new configuration.
+ *        Writers are serialised; readers are never blocked.
+ * @param persist  Also store it in NVS
+ * @return ESP_ERR_INVALID_ARG if validation fails, ESP_ERR_TIMEOUT if a
+ *         reader held on to every spare slot for SCALE_CONFIG_GRACE_MS
+ */
+esp_err_t scale_config_publish(const scale_config_t *cfg, bool persist, const char **why);
+
+/** @brief Copy of the current configuration, for read-modify-publish. */
+void scale_config_snapshot(scale_config_t *out);
+
+/**
+ * @brief Register a reader task.
+ * @return Reader id for acquire/release, -1 if the table is full
+ */
+int scale_config_register_reader(const char *name);
+
+/**
+ * @brief Current configuration for reader `reader`, lock-free.
+ *
+ * The pointer stays valid until scale_config_release() (or the next
+ * acquire by the same reader). An unregistered reader (-1) gets the
+ * defaults. Do not nest acquires of the same reader.
+ */
+const scale_config_t *scale_config_acquire(int reader);
+
+/** @brief Quiescent point: the reader holds no configuration pointer. */
+void scale_config_release(int reader);
+
+/** @brief Set a field by name; the result still has to be validated. */
+bool scale_config_set_field(scale_config_t *cfg, const char *name, double value);
+
+/** @brief Read a field through its descriptor. */
+double scale_config_get_field(const scale_config_t *cfg, const scale_config_field_t *field);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCALE_CONFIG_H
@@ -0,0 +1,119 @@
+// File: main/sleep_state/sleep_state.c
+// ---------------------------------------------------------------------------
+// Deep sleep with retained measurement state
+//   - Calibration, zero, thresholds and HX711 filter snapshot in RTC memory
+//   - CRC + layout magic: a changed firmware or a corrupted block boots cold
+//   - HX711 powered down (SCK held high) while asleep
+//   - Timer and button wake sources
+// ---------------------------------------------------------------------------
+
+#include "sleep_state.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+#include <math.h>
+#include <stddef.h>
+
+static const char *TAG = "SLEEP_STATE";
+
+// Changes whenever sleep_state_t changes size, so an OTA with a different
+// layout cannot restore a misread block
+#define SLEEP_RTC_MAGIC     (0x534C0000u | (uint32_t)(sizeof(sleep_state_t) & 0xFFFF))
+
+typedef struct {
+    uint32_t      magic;
+    sleep_state_t st;
+    uint32_t      crc;          // esp_rom_crc32_le over magic + st
+} sleep_rtc_t;
+
+static RTC_DATA_ATTR sleep_rtc_t s_rtc;
+
+static uint32_t rtc_crc(const sleep_rtc_t *r)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)r, offsetof(sleep_rtc_t, crc));
+}
+
+const char *sleep_state_wake_name(sleep_wake_t wake)
+{
+    switch (wake) {
+        case SLEEP_WAKE_TIMER:  return "timer";
+        case SLEEP_WAKE_BUTTON: return "button";
+        default:                return "cold";
+    }
+}
+
+sleep_wake_t sleep_state_restore(sleep_state_t *out)
+{
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        return SLEEP_WAKE_COLD;     // RTC memory is not retained across these
+    }
+    if (s_rtc.magic != SLEEP_RTC_MAGIC || s_rtc.crc != rtc_crc(&s_rtc)) {
+        ESP_LOGW(TAG, "Retained state invalid, cold start");
+        return SLEEP_WAKE_COLD;
+    }
+    *out = s_rtc.st;
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0 ? SLEEP_WAKE_BUTTON
+                                                                 : SLEEP_WAKE_TIMER;
+}
+
+float sleep_state_check_weight(hx711_t *scale, const calibration_t *calib, int samples)
+{
+    float w = NAN;
+    // The first conversion after power-up takes the settling time; each
+    // read is bounded by HX711_READ_TIMEOUT_MS, the first by a few of them
+    for (int i = 0, misses = 0; i < samples && misses < 4; ) {
+        float f = hx711_read_filtered(scale);
+        if (isnan(f)) {
+            misses++;
+            continue;
+        }
+        w = calibration_convert(calib, (int32_t)f);
+        i++;
+    }
+    return w;
+}
+
+bool sleep_state_auto_zero(sleep_state_t *st, float w)
+{
+    bool zero = fabsf(w) <= SLEEP_AUTOZERO_MAX_G &&
+                fabsf(w - st->last_weight_g) <= SLEEP_AUTOZERO_STEP_G;
+    if (zero) {
+        st->calib.intercept -= w;
+        if (st->calib.slope != 0.0f) {
+            st->zero_raw += (int32_t)lroundf(w / st->calib.slope);
+        }
+        w = 0.0f;
+    }
+    st->last_weight_g = w;
+    return zero;
+}
+
+void sleep_state_enter(hx711_t *scale, sleep_state_t *st)
+{
+    if (scale->mutex) {
+        xSemaphoreTake(scale->mutex, portMAX_DELAY);   // Sampling stops here for good
+    }
+    st->sleeps++;
+    s_rtc.magic = SLEEP_RTC_MAGIC;
+    s_rtc.st = *st;
+    s_rtc.crc = rtc_crc(&s_rtc);
+
+    // HX711 off until the next wake (~1 µA instead of ~1.5 mA)
+    hx711_power_down(scale);
+    gpio_hold_en(scale->sck_pin);
+    gpio_deep_sleep_hold_en();
+
+    esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_POLL_S * 1000000ULL);
+    if (SLEEP_WAKE_GPIO >= 0) {
+        rtc_gpio_pullup_en(SLEEP_WAKE_GPIO);
+        rtc_gpio_pulldown_dis(SLEEP_WAKE_GPIO);
+        esp_sleep_enable_ext0_wakeup(SLEEP_WAKE_GPIO, 0);
+    }
+    ESP_LOGI(TAG, "Deep sleep #%u (%.1f g, %u quiet checks)",
+             (unsigned)st->sleeps, st->last_weight_g, (unsigned)st->checks);
+    esp_deep_sleep_start();
+}
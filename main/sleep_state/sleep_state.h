@@ -0,0 +1,101 @@
+// File: main/sleep_state/sleep_state.h
+#ifndef SLEEP_STATE_H
+#define SLEEP_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "calibration.h"
+#include "hx711.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deep sleep between uses, with the measurement state in RTC slow memory.
+ *
+ * Before sleeping the calibration, the zero, the wake threshold, the last
+ * weight and the HX711 filter snapshot are written to an RTC_DATA_ATTR
+ * block (CRC-checked), the HX711 is powered down with SCK held high, and
+ * two wake sources are armed:
+ *   - a timer every SLEEP_POLL_S: app_main restores the filters, reads
+ *     SLEEP_CHECK_SAMPLES conversions and, below the wake threshold, goes
+ *     straight back to sleep without starting Wi-Fi;
+ *   - the wake button (ext0, active low) for an immediate full start.
+ * A warm start skips the tare / known-weight calibration and continues the
+ * saved filter estimate, so the first weight comes a few conversions after
+ * the HX711 has settled. A cold boot (power-on, reset, firmware update)
+ * finds no valid block and calibrates as before.
+ */
+
+#ifndef SLEEP_POLL_S
+#define SLEEP_POLL_S            3       // Timer wake period while asleep
+#endif
+#ifndef SLEEP_CHECK_SAMPLES
+#define SLEEP_CHECK_SAMPLES     3       // Conversions per timer check
+#endif
+#ifndef SLEEP_AUTOZERO_MAX_G
+#define SLEEP_AUTOZERO_MAX_G    8.0f    // Quiet check this close to zero: re-zero
+#endif
+#ifndef SLEEP_AUTOZERO_STEP_G
+#define SLEEP_AUTOZERO_STEP_G   4.0f    // ...if it moved this little since the last check
+#endif
+#ifndef SLEEP_WAKE_GPIO
+#define SLEEP_WAKE_GPIO         GPIO_NUM_0   // RTC GPIO (BOOT button); -1: timer only
+#endif
+
+typedef enum {
+    SLEEP_WAKE_COLD = 0,        // Not a deep-sleep wake, or no valid state
+    SLEEP_WAKE_TIMER,           // Periodic platform check
+    SLEEP_WAKE_BUTTON
+} sleep_wake_t;
+
+typedef struct {
+    calibration_t        calib;
+    int32_t              zero_raw;
+    float                wake_threshold_g;
+    float                last_weight_g;
+    uint32_t             sleeps;            // Deep sleeps since the last cold boot
+    uint32_t             checks;            // Timer wakes that went back to sleep
+    hx711_filter_state_t filt;
+} sleep_state_t;
+
+/**
+ * @brief Copy the retained state out of RTC memory.
+ * @return How the chip woke up; SLEEP_WAKE_COLD (and *out untouched) when
+ *         there is nothing valid to restore.
+ */
+sleep_wake_t sleep_state_restore(sleep_state_t *out);
+
+/**
+ * @brief Read up to @p samples filtered conversions from an HX711 set up
+ *        with hx711_init() (no task) and return the calibrated weight.
+ *        NAN if the sensor gave nothing usable.
+ */
+float sleep_state_check_weight(hx711_t *scale, const calibration_t *calib, int samples);
+
+/**
+ * @brief Auto-zero on a quiet timer check: when @p w is within
+ *        SLEEP_AUTOZERO_MAX_G of zero and within SLEEP_AUTOZERO_STEP_G of
+ *        the previous check, fold it into st->calib.intercept, so a slow
+ *        zero drift never adds up to the wake threshold. Records the
+ *        (re-zeroed) weight as st->last_weight_g.
+ * @return true when the zero moved.
+ */
+bool sleep_state_auto_zero(sleep_state_t *st, float w);
+
+/**
+ * @brief Save @p st to RTC memory, power the HX711 down and deep-sleep.
+ *        Does not return.
+ */
+void sleep_state_enter(hx711_t *scale, sleep_state_t *st);
+
+/** @brief "cold", "timer" or "button". */
+const char *sleep_state_wake_name(sleep_wake_t wake);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SLEEP_STATE_H
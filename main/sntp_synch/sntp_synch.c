@@ -4,11 +4,13 @@
 #include "esp_sntp.h"
 #include "freertos/event_groups.h"
 #include "log_utils.h"
+#include "clock_map.h"
 #include <sys/time.h>
 #include <time.h>
 
 static const char *TAG = "sntp_sync";
 static EventGroupHandle_t s_time_event = NULL;
+static StaticEventGroup_t s_time_event_buf;
 #define TIME_SYNC_BIT BIT0
 
 /**
@@ -28,6 +30,9 @@ static void time_sync_notification_cb(struct timeval *tv)
     strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &timeinfo);
     LOG_ROW(TAG, "→ System time set to %s", buf);
 
+    // Map this boot's monotonic clock so earlier stamps can be re-based
+    clock_map_on_sync();
+
     xEventGroupSetBits(s_time_event, TIME_SYNC_BIT);
 }
 
@@ -37,7 +42,7 @@ void sntp_sync_start(void)
         // Already started, do nothing
         return;
     }
-    s_time_event = xEventGroupCreate();
+    s_time_event = xEventGroupCreateStatic(&s_time_event_buf);
     LOG_ROW(TAG, "Starting SNTP client, polling pool.ntp.org");
 
     // Initialize SNTP operating mode and callback
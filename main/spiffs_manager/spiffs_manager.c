@@ -1,11 +1,11 @@
 #include "spiffs_manager.h"
-#include "esp_spiffs.h"
+#include "storage.h"
 #include "esp_log.h"
-#include "esp_sntp.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "time.h"
 #include "cJSON.h"
+#include "resources.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
 #include <stdio.h>
@@ -13,61 +13,7 @@
 #include <string.h>
 
 #define TAG "SPIFFS_MANAGER"
-#define JSON_FILE_PATH "/spiffs/time_log.json"
-#define SNTP_SERVER "pool.ntp.org"
-
-// ──────────────────────────────────────────────
-// SNTP Initialization
-// ──────────────────────────────────────────────
-
-static void initialize_sntp(void) {
-    sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    sntp_setservername(0, SNTP_SERVER);
-    sntp_init();
-}
-
-static void obtain_time(void) {
-    initialize_sntp();
-    time_t now;
-    struct tm timeinfo = {0};
-    int retry = 0;
-    const int retry_count = 10;
-
-    while (timeinfo.tm_year < (2020 - 1900) && ++retry < retry_count) {
-        ESP_LOGI(TAG, "Waiting for NTP sync... (%d/%d)", retry, retry_count);
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        time(&now);
-        localtime_r(&now, &timeinfo);
-    }
-
-    if (timeinfo.tm_year >= (2020 - 1900)) {
-        ESP_LOGI(TAG, "Time synced: %s", asctime(&timeinfo));
-    } else {
-        ESP_LOGW(TAG, "Time sync failed.");
-    }
-}
-
-// ──────────────────────────────────────────────
-// SPIFFS Initialization
-// ──────────────────────────────────────────────
-
-void spiffs_init(void) {
-    esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
-        .partition_label = NULL,
-        .max_files = 5,
-        .format_if_mount_failed = true
-    };
-
-    esp_err_t ret = esp_vfs_spiffs_register(&conf);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to mount SPIFFS (%s)", esp_err_to_name(ret));
-        return;
-    }
-
-    ESP_LOGI(TAG, "SPIFFS mounted successfully");
-    obtain_time();
-}
+#define JSON_FILE_NAME "time_log.json"    // On the storage partition (storage.h)
 
 // ──────────────────────────────────────────────
 // Timestamp Helper
@@ -94,20 +40,15 @@ static void time_logging_task(void *arg) {
     while (1) {
         // Step 1: Load existing JSON from file
         cJSON *root = NULL;
-        FILE *file = fopen(JSON_FILE_PATH, "r");
-        if (file) {
-            fseek(file, 0, SEEK_END);
-            long size = ftell(file);
-            rewind(file);
-
-            char *buffer = malloc(size + 1);
-            if (buffer) {
-                fread(buffer, 1, size, file);
-                buffer[size] = '\0';
+        size_t size;
+        if (storage_size(JSON_FILE_NAME, &size) == ESP_OK) {
+            char *buffer = res_malloc(RES_HEAP_STORAGE, size + 1);
+            size_t got;
+            if (buffer && storage_read_range(JSON_FILE_NAME, 0, buffer, size, &got) == ESP_OK) {
+                buffer[got] = '\0';
                 root = cJSON_Parse(buffer);
-                free(buffer);
             }
-            fclose(file);
+            res_free(buffer);
         }
 
         if (!root) {
@@ -126,17 +67,13 @@ static void time_logging_task(void *arg) {
             cJSON_AddItemToArray(array, cJSON_CreateString(timestamp));
             ESP_LOGI(TAG, "Logged time: %s", timestamp);
 
-            // Step 3: Save updated JSON to file
+            // Step 3: Swap in the updated JSON (a reset keeps the old file)
             char *json_str = cJSON_Print(root);
             if (json_str) {
-                FILE *out = fopen(JSON_FILE_PATH, "w");
-                if (out) {
-                    fprintf(out, "%s", json_str);
-                    fclose(out);
-                } else {
-                    ESP_LOGE(TAG, "Failed to open %s for writing", JSON_FILE_PATH);
+                if (storage_replace(JSON_FILE_NAME, json_str, strlen(json_str)) != ESP_OK) {
+                    ESP_LOGE(TAG, "Failed to write %s", JSON_FILE_NAME);
                 }
-                free(json_str);
+                cJSON_free(json_str);
             }
         } else {
             ESP_LOGW(TAG, "System time not yet valid");
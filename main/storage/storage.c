@@ -0,0 +1,318 @@
+// File: main/storage/storage.c
+// ---------------------------------------------------------------------------
+// Data partition access (see storage.h)
+//   - SPIFFS or LittleFS on "storage", chosen by CONFIG_STORAGE_BACKEND_*
+//   - Path calls open, act and close; handles for slot rings
+//   - Atomic replace via "<name>.tmp" + rename, recovered at mount
+//   - Write counters and worst write latency for /health
+// ---------------------------------------------------------------------------
+
+#include "storage.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "log_utils.h"
+
+#if CONFIG_STORAGE_BACKEND_LITTLEFS
+#include "esp_littlefs.h"
+#define BACKEND_NAME    "littlefs"
+#else
+#include "esp_spiffs.h"
+#define BACKEND_NAME    "spiffs"
+#endif
+
+#define TMP_SUFFIX      ".tmp"
+
+static const char *TAG = "Storage";
+
+static bool            s_mounted = false;
+static storage_stats_t s_stats = { .backend = BACKEND_NAME };
+static portMUX_TYPE    s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int full_path(const char *name, char *buf, size_t len)
+{
+    if (strlen(name) > STORAGE_NAME_MAX) {
+        return -1;
+    }
+    snprintf(buf, len, STORAGE_BASE_PATH "/%s", name);
+    return 0;
+}
+
+static void count_write(int64_t start_us, bool synced, bool ok)
+{
+    uint32_t us = (uint32_t)(esp_timer_get_time() - start_us);
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.writes++;
+    s_stats.syncs += synced;
+    s_stats.errors += !ok;
+    if (us > s_stats.write_us_max) {
+        s_stats.write_us_max = us;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+static bool write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static esp_err_t read_fd(int fd, size_t offset, void *buf, size_t len, size_t *got)
+{
+    *got = 0;
+    if (lseek(fd, (off_t)offset, SEEK_SET) < 0) {
+        return ESP_FAIL;
+    }
+    while (*got < len) {
+        ssize_t n = read(fd, (uint8_t *)buf + *got, len - *got);
+        if (n < 0) {
+            return ESP_FAIL;
+        }
+        if (n == 0) {
+            break;
+        }
+        *got += (size_t)n;
+    }
+    return ESP_OK;
+}
+
+/* ------------------------------ Mounting -------------------------------- */
+
+static esp_err_t mount(void)
+{
+#if CONFIG_STORAGE_BACKEND_LITTLEFS
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = STORAGE_BASE_PATH,
+        .partition_label = STORAGE_PARTITION,
+        .format_if_mount_failed = true,
+    };
+    return esp_vfs_littlefs_register(&conf);
+#else
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = STORAGE_BASE_PATH,
+        .partition_label = STORAGE_PARTITION,  // Not the first spiffs partition any more (www)
+        .max_files = STORAGE_MAX_FILES,
+        .format_if_mount_failed = true,
+    };
+    return esp_vfs_spiffs_register(&conf);
+#endif
+}
+
+static void refresh_usage(void)
+{
+    size_t total = 0, used = 0;
+#if CONFIG_STORAGE_BACKEND_LITTLEFS
+    esp_littlefs_info(STORAGE_PARTITION, &total, &used);
+#else
+    esp_spiffs_info(STORAGE_PARTITION, &total, &used);
+#endif
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.total_bytes = total;
+    s_stats.used_bytes = used;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+// A reset inside storage_replace() leaves "<name>.tmp" behind: complete
+// the swap if the target is gone, otherwise the old file is intact
+static void recover_replaces(void)
+{
+    DIR *dir = opendir(STORAGE_BASE_PATH);
+    if (!dir) {
+        return;
+    }
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        size_t n = strlen(e->d_name);
+        if (n <= strlen(TMP_SUFFIX) || strcmp(e->d_name + n - strlen(TMP_SUFFIX), TMP_SUFFIX) != 0) {
+            continue;
+        }
+        char tmp[64], target[64];
+        snprintf(tmp, sizeof(tmp), STORAGE_BASE_PATH "/%s", e->d_name);
+        snprintf(target, sizeof(target), "%.*s", (int)(strlen(tmp) - strlen(TMP_SUFFIX)), tmp);
+        struct stat st;
+        if (stat(target, &st) != 0) {
+            rename(tmp, target);
+            LOG_ROW(TAG, "Completed replace of %s", target);
+        } else {
+            unlink(tmp);
+        }
+    }
+    closedir(dir);
+}
+
+esp_err_t storage_init(void)
+{
+    if (s_mounted) {
+        return ESP_OK;
+    }
+    esp_err_t err = mount();
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "Mount of %s (%s) failed: %s", STORAGE_PARTITION, BACKEND_NAME,
+                esp_err_to_name(err));
+        return err;
+    }
+    s_mounted = true;
+    recover_replaces();
+    refresh_usage();
+    LOG_ROW(TAG, "%s mounted, %u of %u bytes used", BACKEND_NAME,
+            (unsigned)s_stats.used_bytes, (unsigned)s_stats.total_bytes);
+    return ESP_OK;
+}
+
+/* ------------------------------ Path calls ------------------------------ */
+
+esp_err_t storage_append(const char *name, const void *data, size_t len, storage_sync_t sync)
+{
+    char path[64];
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t start = esp_timer_get_time();
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) {
+        count_write(start, false, false);
+        return ESP_FAIL;
+    }
+    bool ok = write_all(fd, data, len) && (sync == STORAGE_SYNC_NONE || fsync(fd) == 0);
+    ok = close(fd) == 0 && ok;
+    count_write(start, sync != STORAGE_SYNC_NONE, ok);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t storage_read_range(const char *name, size_t offset, void *buf, size_t len, size_t *got)
+{
+    char path[64];
+    *got = 0;
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+    esp_err_t err = read_fd(fd, offset, buf, len, got);
+    close(fd);
+    return err;
+}
+
+esp_err_t storage_replace(const char *name, const void *data, size_t len)
+{
+    char path[64], tmp[64];
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(tmp, sizeof(tmp), "%s" TMP_SUFFIX, path);
+    int64_t start = esp_timer_get_time();
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        count_write(start, false, false);
+        return ESP_FAIL;
+    }
+    bool ok = write_all(fd, data, len) && fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok) {
+#if !CONFIG_STORAGE_BACKEND_LITTLEFS
+        unlink(path);           // SPIFFS: no rename onto an existing name
+#endif
+        ok = rename(tmp, path) == 0;
+    }
+    if (!ok) {
+        unlink(tmp);
+    }
+    count_write(start, true, ok);
+    refresh_usage();
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t storage_size(const char *name, size_t *size)
+{
+    char path[64];
+    struct stat st;
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (stat(path, &st) != 0) {
+        return errno == ENOENT ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+    *size = (size_t)st.st_size;
+    return ESP_OK;
+}
+
+esp_err_t storage_remove(const char *name)
+{
+    char path[64];
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (unlink(path) != 0) {
+        return errno == ENOENT ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+    refresh_usage();
+    return ESP_OK;
+}
+
+/* -------------------------------- Handles -------------------------------- */
+
+esp_err_t storage_open(const char *name, storage_file_t *f)
+{
+    char path[64];
+    f->fd = -1;
+    if (full_path(name, path, sizeof(path)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    f->fd = open(path, O_RDWR | O_CREAT, 0666);
+    return f->fd >= 0 ? ESP_OK : ESP_FAIL;
+}
+
+void storage_close(storage_file_t *f)
+{
+    if (f->fd >= 0) {
+        close(f->fd);
+        f->fd = -1;
+    }
+}
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got)
+{
+    *got = 0;
+    return f->fd < 0 ? ESP_ERR_INVALID_STATE : read_fd(f->fd, offset, buf, len, got);
+}
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync)
+{
+    if (f->fd < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t start = esp_timer_get_time();
+    bool ok = lseek(f->fd, (off_t)offset, SEEK_SET) >= 0 && write_all(f->fd, data, len) &&
+              (sync == STORAGE_SYNC_NONE || fsync(f->fd) == 0);
+    count_write(start, sync != STORAGE_SYNC_NONE, ok);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+void storage_get_stats(storage_stats_t *out)
+{
+    if (s_mounted) {
+        refresh_usage();
+    }
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
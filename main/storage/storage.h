@@ -0,0 +1,111 @@
+// File: main/storage/storage.h
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The "storage" data partition behind one small file interface.
+ *
+ * The filesystem is a build choice (menuconfig → Scale storage):
+ *   SPIFFS    flat namespace; appends slow down as the partition fills,
+ *             because free pages come from garbage collection
+ *   LittleFS  copy-on-write with wear levelling; power-loss safe metadata
+ *             and a write cost that stays flat with fill level
+ * Switching backends reformats the partition on the first boot (the
+ * weigh-in log and user histories start empty; profiles live in NVS).
+ *
+ * Files are named relative to the mount point ("weighins.bin"). Writers
+ * pick a sync policy per call: STORAGE_SYNC_DATA returns only after the
+ * bytes are on flash; STORAGE_SYNC_NONE leaves them in the filesystem
+ * cache until the file is closed.
+ *
+ * storage_replace() swaps a whole file atomically: the new content is
+ * written to "<name>.tmp" and synced, then renamed over the target.
+ * SPIFFS cannot rename onto an existing file, so there the target is
+ * removed first and storage_init() completes a replace cut short by a
+ * reset (a lone .tmp is moved into place; one next to its target is
+ * dropped).
+ *
+ * Ring logs that rewrite fixed slots keep a handle (storage_open) and use
+ * storage_read_at / storage_write_at. Callers serialise access to a file.
+ */
+
+#define STORAGE_BASE_PATH   "/spiffs"       // Kept for both backends
+#define STORAGE_PARTITION   "storage"
+
+#ifndef STORAGE_MAX_FILES
+#define STORAGE_MAX_FILES   CONFIG_STORAGE_MAX_FILES
+#endif
+
+// Longest name below the mount point (SPIFFS_OBJ_NAME_LEN is 32 with
+// the leading '/' and the terminator; ".tmp" must still fit)
+#define STORAGE_NAME_MAX    24
+
+typedef enum {
+    STORAGE_SYNC_NONE = 0,  // Flushed on close / cache eviction
+    STORAGE_SYNC_DATA,      // fsync before returning
+} storage_sync_t;
+
+typedef struct {
+    int fd;                 // -1 when closed
+} storage_file_t;
+
+typedef struct {
+    const char *backend;    // "spiffs" or "littlefs"
+    size_t   total_bytes;
+    size_t   used_bytes;
+    uint32_t writes;        // Appends, slot writes and replaces
+    uint32_t syncs;
+    uint32_t errors;
+    uint32_t write_us_max;  // Slowest write (incl. sync) since boot
+} storage_stats_t;
+
+/** @brief Mount the partition (formatting it if unreadable) and finish
+ *         any interrupted replace. */
+esp_err_t storage_init(void);
+
+/** @brief Append @p len bytes to @p name, creating it. */
+esp_err_t storage_append(const char *name, const void *data, size_t len, storage_sync_t sync);
+
+/**
+ * @brief Read up to @p len bytes from @p offset.
+ * @param got  Bytes read (short at end of file)
+ * @return ESP_ERR_NOT_FOUND when the file does not exist
+ */
+esp_err_t storage_read_range(const char *name, size_t offset, void *buf, size_t len, size_t *got);
+
+/** @brief Replace the whole content of @p name atomically (always synced). */
+esp_err_t storage_replace(const char *name, const void *data, size_t len);
+
+/** @brief File size in bytes; ESP_ERR_NOT_FOUND if it does not exist. */
+esp_err_t storage_size(const char *name, size_t *size);
+
+esp_err_t storage_remove(const char *name);
+
+/** @brief Open @p name for reading and writing, creating it if missing. */
+esp_err_t storage_open(const char *name, storage_file_t *f);
+
+void storage_close(storage_file_t *f);
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got);
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync);
+
+/** @brief Usage and write counters (for /health). */
+void storage_get_stats(storage_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STORAGE_H
@@ -0,0 +1,290 @@
+// File: main/udp_telemetry/udp_telemetry.c
+// ---------------------------------------------------------------------------
+// UDP multicast telemetry
+//   - Hub subscriber: measurements → fixed 32-byte frames
+//   - Live frames rate limited, state frames (added/locked/removed) at once
+//   - Heartbeat repeats the last frame while idle
+//   - Socket follows the station: opened on GOT_IP, closed on disconnect
+//   - Non-blocking sends; the hub task never waits on lwIP
+// ---------------------------------------------------------------------------
+
+#include "udp_telemetry.h"
+
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_event.h"
+#include "esp_wifi.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "log_utils.h"
+
+static const char *TAG = "UdpTlm";
+
+static udp_telemetry_config_t s_cfg;
+static char                   s_group[16];
+static struct sockaddr_in     s_dest;
+static int                    s_sock = -1;
+static uint32_t               s_device_id = 0;
+static volatile uint16_t      s_live_hz = UDP_TLM_LIVE_HZ;
+
+static SemaphoreHandle_t      s_lock = NULL;     // Socket, last frame, counters
+static StaticSemaphore_t      s_lock_buf;
+static esp_timer_handle_t     s_heartbeat = NULL;
+static esp_event_handler_instance_t s_ip_handler = NULL;
+static esp_event_handler_instance_t s_disc_handler = NULL;
+
+static measurement_t          s_last;            // Latest reading (sent or not)
+static uint8_t                s_last_flags = 0;
+static uint32_t               s_frame_seq = 0;
+static int64_t                s_last_live_us = 0;
+static int64_t                s_last_send_us = 0;
+static udp_telemetry_stats_t  s_stats;
+
+/* ----------------------------- Encoding --------------------------------- */
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+void udp_telemetry_encode(uint8_t *out, const measurement_t *m, uint8_t kind,
+                          uint32_t device_id, uint32_t frame_seq, uint8_t flags,
+                          uint16_t live_hz) {
+    float cg = m->weight_g * 100.0f;
+    int32_t weight_cg = cg >= 0.0f ? (int32_t)(cg + 0.5f) : (int32_t)(cg - 0.5f);
+
+    if (m->timestamp > 0) {
+        flags |= UDP_TLM_FLAG_TIME_VALID;
+    }
+    put_u16(out + 0, UDP_TLM_MAGIC);
+    out[2] = UDP_TLM_VERSION;
+    out[3] = kind;
+    put_u32(out + 4,  device_id);
+    put_u32(out + 8,  frame_seq);
+    put_u32(out + 12, m->seq);
+    put_u32(out + 16, (uint32_t)weight_cg);
+    put_u32(out + 20, (uint32_t)(m->mono_us / 1000));
+    put_u32(out + 24, m->timestamp > 0 ? (uint32_t)m->timestamp : 0);
+    out[28] = m->user_id;
+    out[29] = flags;
+    put_u16(out + 30, live_hz);
+}
+
+static uint8_t flags_for(const measurement_t *m) {
+    uint8_t flags = 0;
+    if (m->kind == MEAS_KIND_LOCKED) flags |= UDP_TLM_FLAG_STABLE;
+    if (m->kind != MEAS_KIND_REMOVED) flags |= UDP_TLM_FLAG_PRESENT;
+    return flags;
+}
+
+/* ------------------------------ Socket ---------------------------------- */
+
+// Caller holds s_lock
+static void send_frame_locked(const measurement_t *m, uint8_t kind, uint8_t flags) {
+    if (s_sock < 0) return;
+
+    uint8_t frame[UDP_TLM_FRAME_LEN];
+    udp_telemetry_encode(frame, m, kind, s_device_id, ++s_frame_seq, flags, s_live_hz);
+    int sent = sendto(s_sock, frame, sizeof(frame), MSG_DONTWAIT,
+                      (const struct sockaddr *)&s_dest, sizeof(s_dest));
+    if (sent == (int)sizeof(frame)) {
+        s_stats.frames_sent++;
+    } else {
+        s_stats.send_errors++;
+    }
+    s_last_send_us = esp_timer_get_time();
+}
+
+static void socket_close(void) {
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_sock >= 0) {
+        close(s_sock);
+        s_sock = -1;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+static void socket_open(const esp_ip4_addr_t *ifaddr) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        LOG_ROW(TAG, "socket() failed: errno %d", errno);
+        return;
+    }
+
+    uint8_t ttl = s_cfg.ttl;
+    struct in_addr iface = { .s_addr = ifaddr ? ifaddr->addr : htonl(INADDR_ANY) };
+    if (setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0) {
+        LOG_ROW(TAG, "Multicast options failed: errno %d", errno);
+        close(sock);
+        return;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_sock >= 0) {
+        close(s_sock);
+    }
+    s_sock = sock;
+    xSemaphoreGive(s_lock);
+
+    LOG_ROW(TAG, "Multicasting to %s:%u (live %u Hz)", s_group, (unsigned)s_cfg.port,
+            (unsigned)s_live_hz);
+}
+
+static void net_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data) {
+    if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        const ip_event_got_ip_t *event = (const ip_event_got_ip_t *)data;
+        socket_open(&event->ip_info.ip);
+    } else if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        socket_close();
+    }
+}
+
+/* --------------------------- Hub + heartbeat ---------------------------- */
+
+static void udp_sink(const measurement_t *m, void *ctx) {
+    int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    s_last = *m;
+    s_last_flags = flags_for(m);
+
+    bool send = true;
+    if (m->kind == MEAS_KIND_LIVE) {
+        uint16_t hz = s_live_hz;
+        if (hz == 0 || (s_last_live_us && now - s_last_live_us < 1000000 / hz)) {
+            s_stats.live_skipped++;
+            send = false;
+        } else {
+            s_last_live_us = now;
+        }
+    }
+    if (send) {
+        send_frame_locked(m, m->kind, s_last_flags);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+// esp_timer task: never wait for the hub task, just try again next period
+static void heartbeat_cb(void *arg) {
+    if (xSemaphoreTake(s_lock, 0) != pdTRUE) return;
+    if (esp_timer_get_time() - s_last_send_us >= (int64_t)UDP_TLM_HEARTBEAT_MS * 1000) {
+        send_frame_locked(&s_last, UDP_TLM_KIND_HEARTBEAT, s_last_flags);
+        s_stats.heartbeats++;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+/* ----------------------------- Public ----------------------------------- */
+
+// Undo a partial init: handlers first so no GOT_IP reopens the socket
+static void teardown(void) {
+    if (s_ip_handler) {
+        esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, s_ip_handler);
+        s_ip_handler = NULL;
+    }
+    if (s_disc_handler) {
+        esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, s_disc_handler);
+        s_disc_handler = NULL;
+    }
+    if (s_heartbeat) {
+        esp_timer_stop(s_heartbeat);
+        esp_timer_delete(s_heartbeat);
+        s_heartbeat = NULL;
+    }
+    socket_close();
+    vSemaphoreDelete(s_lock);
+    s_lock = NULL;
+}
+
+esp_err_t udp_telemetry_init(const udp_telemetry_config_t *cfg) {
+    if (s_lock) return ESP_OK;
+
+    s_cfg = (udp_telemetry_config_t){
+        .group   = UDP_TLM_GROUP,
+        .port    = UDP_TLM_PORT,
+        .live_hz = UDP_TLM_LIVE_HZ,
+        .ttl     = UDP_TLM_TTL,
+    };
+    if (cfg) {
+        s_cfg = *cfg;
+        if (!s_cfg.group) s_cfg.group = UDP_TLM_GROUP;
+    }
+    strlcpy(s_group, s_cfg.group, sizeof(s_group));
+
+    memset(&s_dest, 0, sizeof(s_dest));
+    s_dest.sin_family = AF_INET;
+    s_dest.sin_port   = htons(s_cfg.port);
+    if (inet_aton(s_group, &s_dest.sin_addr) == 0 ||
+        !IN_MULTICAST(ntohl(s_dest.sin_addr.s_addr))) {
+        LOG_ROW(TAG, "Not a multicast group: %s", s_group);
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_live_hz = s_cfg.live_hz;
+
+    uint8_t mac[6] = { 0 };
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    s_device_id = (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+
+    memset(&s_last, 0, sizeof(s_last));
+    s_last.user_id = 0xFF;
+    s_last.kind = MEAS_KIND_REMOVED;
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+
+    const esp_timer_create_args_t targs = {
+        .callback = heartbeat_cb,
+        .name     = "udp_tlm_hb",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&targs, &s_heartbeat));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(s_heartbeat, (uint64_t)UDP_TLM_HEARTBEAT_MS * 1000));
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, net_event_handler, NULL, &s_ip_handler));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, net_event_handler, NULL, &s_disc_handler));
+
+    // Latest value matters, not history: drop the oldest on overflow.
+    // On failure no subscriber task exists, but a GOT_IP may already have
+    // opened the socket; undo everything so init can be retried
+    if (app_connection_manager_subscribe("hub_udp", udp_sink, NULL, 2, HUB_DROP_OLDEST,
+                                         MEAS_KIND_ALL, RES_PRIO_HUB) < 0) {
+        LOG_ROW(TAG, "No hub subscriber slot");
+        teardown();
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Already associated (init after GOT_IP): open now
+    esp_netif_ip_info_t ip;
+    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (netif && esp_netif_get_ip_info(netif, &ip) == ESP_OK && ip.ip.addr != 0) {
+        socket_open(&ip.ip);
+    }
+    return ESP_OK;
+}
+
+void udp_telemetry_set_rate(uint16_t live_hz) {
+    s_live_hz = live_hz;
+}
+
+void udp_telemetry_get_stats(udp_telemetry_stats_t *out) {
+    if (!out) return;
+    if (!s_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,107 @@
+// File: main/udp_telemetry/udp_telemetry.h
+#ifndef UDP_TELEMETRY_H
+#define UDP_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "app_connection_manager.h"   // measurement_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * UDP multicast telemetry for LAN displays.
+ *
+ * One hub subscriber turns measurements into fixed 32-byte frames and
+ * sends each to a multicast group, so any number of displays on a trusted
+ * LAN cost one packet per update (no TLS session per screen). Live
+ * readings are rate limited; added / locked / removed frames go out at
+ * once, and a heartbeat repeats the last frame while nothing changes so a
+ * display can tell an idle scale from a dead one. Frames are unencrypted
+ * and unauthenticated: enable this only on networks you trust.
+ *
+ * Frame layout (little-endian, UDP_TLM_FRAME_LEN bytes):
+ *   off  size  field
+ *     0     2  magic       UDP_TLM_MAGIC ("WS")
+ *     2     1  version     UDP_TLM_VERSION
+ *     3     1  kind        measurement_kind_t, or UDP_TLM_KIND_HEARTBEAT
+ *     4     4  device_id   Low four bytes of the station MAC
+ *     8     4  frame_seq   Per-device frame counter (gaps = lost frames)
+ *    12     4  meas_seq    Hub sequence of the measurement
+ *    16     4  weight_cg   Weight in centigrams (signed)
+ *    20     4  uptime_ms   Capture time since boot
+ *    24     4  time_s      Wall-clock capture time (Unix), 0 if unknown
+ *    28     1  user_id     0xFF if unknown
+ *    29     1  flags       UDP_TLM_FLAG_*
+ *    30     2  live_hz     Current live-frame rate (0 = state frames only)
+ */
+
+#define UDP_TLM_MAGIC           0x5357u   // "WS"
+#define UDP_TLM_VERSION         1
+#define UDP_TLM_FRAME_LEN       32
+#define UDP_TLM_KIND_HEARTBEAT  0x80
+
+#define UDP_TLM_FLAG_STABLE     0x01      // Locked (stable) weight
+#define UDP_TLM_FLAG_PRESENT    0x02      // Someone is on the scale
+#define UDP_TLM_FLAG_TIME_VALID 0x04      // time_s is set
+
+#ifndef UDP_TLM_GROUP
+#define UDP_TLM_GROUP           "239.255.83.87"
+#endif
+#ifndef UDP_TLM_PORT
+#define UDP_TLM_PORT            45087
+#endif
+#ifndef UDP_TLM_LIVE_HZ
+#define UDP_TLM_LIVE_HZ         5         // Default live-frame rate
+#endif
+#ifndef UDP_TLM_HEARTBEAT_MS
+#define UDP_TLM_HEARTBEAT_MS    1000      // Repeat the last frame when idle
+#endif
+#ifndef UDP_TLM_TTL
+#define UDP_TLM_TTL             1         // Stay on the local segment
+#endif
+
+typedef struct {
+    const char *group;          // Multicast group (dotted quad)
+    uint16_t    port;
+    uint16_t    live_hz;        // 0 = state frames and heartbeats only
+    uint8_t     ttl;
+} udp_telemetry_config_t;
+
+typedef struct {
+    uint32_t frames_sent;
+    uint32_t send_errors;       // sendto() failures (no route, buffers full)
+    uint32_t live_skipped;      // Live readings dropped by the rate limit
+    uint32_t heartbeats;
+} udp_telemetry_stats_t;
+
+/**
+ * @brief Fill a frame (pure, no IDF dependencies).
+ * @param out  UDP_TLM_FRAME_LEN bytes
+ */
+void udp_telemetry_encode(uint8_t *out, const measurement_t *m, uint8_t kind,
+                          uint32_t device_id, uint32_t frame_seq, uint8_t flags,
+                          uint16_t live_hz);
+
+/**
+ * @brief Register the hub subscriber and the Wi-Fi/IP handlers. The socket
+ *        opens on every IP_EVENT_STA_GOT_IP and closes on disconnect.
+ *        Call after app_connection_manager_init().
+ * @param cfg  NULL for the UDP_TLM_* defaults
+ */
+esp_err_t udp_telemetry_init(const udp_telemetry_config_t *cfg);
+
+/** @brief Change the live-frame rate at runtime (0 = state frames only). */
+void udp_telemetry_set_rate(uint16_t live_hz);
+
+/** @brief Counters since boot. */
+void udp_telemetry_get_stats(udp_telemetry_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_TELEMETRY_H
@@ -0,0 +1,332 @@
+// File: main/user_profiles/user_profiles.c
+// ---------------------------------------------------------------------------
+// User profiles
+//   - Up to USER_PROFILES_MAX people per scale, persisted as one NVS blob
+//   - Each locked weigh-in goes to the nearest recent-weight cluster
+//   - Running mean/variance per user in O(1) (windowed Welford), kept
+//     in RAM and written back every USER_SAVE_EVERY weigh-ins
+//   - Body composition from the locked weight, appended to a per-user
+//     fixed-slot history ring instead of rewriting a JSON document
+// ---------------------------------------------------------------------------
+
+#include "user_profiles.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "nvs.h"
+#include "esp_rom_crc.h"
+#include "clock_map.h"
+#include "weigh_log.h"    // for WEIGH_LOG_FLAG_*
+#include "storage.h"
+#include "log_utils.h"
+
+static const char *TAG = "Users";
+
+#define USER_NVS_NS         "users"
+#define USER_NVS_KEY        "profiles"
+
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buf;
+static user_profile_t    s_users[USER_PROFILES_MAX];
+static uint32_t          s_unsaved = 0;     // Weigh-ins since the last save
+
+static uint16_t record_crc(const user_history_record_t *r) {
+    return esp_rom_crc16_le(0, (const uint8_t *)r, offsetof(user_history_record_t, crc));
+}
+
+static void history_path(uint8_t id, char *buf, size_t len) {
+    snprintf(buf, len, USER_HISTORY_FILE, (unsigned)id);
+}
+
+static size_t slot_offset(uint32_t seq) {
+    return (size_t)((seq - 1) % USER_HISTORY_CAPACITY) * sizeof(user_history_record_t);
+}
+
+/** Persist all slots; caller holds s_lock */
+static esp_err_t save_profiles(void) {
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(USER_NVS_NS, NVS_READWRITE, &h);
+    if (err != ESP_OK) return err;
+    err = nvs_set_blob(h, USER_NVS_KEY, s_users, sizeof(s_users));
+    if (err == ESP_OK) {
+        err = nvs_commit(h);
+    }
+    nvs_close(h);
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "Saving profiles failed: %s", esp_err_to_name(err));
+    } else {
+        s_unsaved = 0;
+    }
+    return err;
+}
+
+/** Cluster centre and spread used for matching; false if nothing to match */
+static bool cluster_of(const user_profile_t *u, float *mean, float *sigma) {
+    if (!u->in_use) return false;
+    if (u->count == 0) {
+        if (u->weight_hint_g <= 0.0f) return false;
+        *mean  = u->weight_hint_g;
+        *sigma = USER_HINT_SIGMA_G;
+        return true;
+    }
+    *mean  = u->mean_g;
+    *sigma = fmaxf(sqrtf(u->var_g2), USER_MIN_SIGMA_G);
+    return true;
+}
+
+/** Windowed Welford step: exact up to USER_STATS_WINDOW, then 1/N forgetting */
+static void cluster_update(user_profile_t *u, float w) {
+    uint32_t k = u->count < USER_STATS_WINDOW ? u->count + 1 : USER_STATS_WINDOW;
+    float delta = w - u->mean_g;
+    u->mean_g += delta / (float)k;
+    u->var_g2 += (delta * (w - u->mean_g) - u->var_g2) / (float)k;
+    u->count++;
+}
+
+/**
+ * Bring a profile loaded from NVS up to date with its history: records
+ * written after the last save follow hist_seq in their slots. Caller
+ * holds s_lock (or runs before anyone else can).
+ */
+static int replay_unsaved(uint8_t id) {
+    user_profile_t *u = &s_users[id];
+    char path[32];
+    history_path(id, path, sizeof(path));
+
+    storage_file_t f;
+    if (storage_open(path, &f) != ESP_OK) return 0;
+    int n = 0;
+    for (;;) {
+        user_history_record_t r;
+        size_t got;
+        uint32_t seq = u->hist_seq + 1;
+        if (storage_read_at(&f, slot_offset(seq), &r, sizeof(r), &got) != ESP_OK ||
+            got != sizeof(r) || r.seq != seq || r.crc != record_crc(&r)) {
+            break;
+        }
+        cluster_update(u, r.weight_g);
+        u->hist_seq = seq;
+        n++;
+    }
+    storage_close(&f);
+    return n;
+}
+
+esp_err_t user_profiles_init(void) {
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+        if (!s_lock) return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_users, 0, sizeof(s_users));
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(USER_NVS_NS, NVS_READONLY, &h);
+    if (err == ESP_OK) {
+        size_t len = sizeof(s_users);
+        if (nvs_get_blob(h, USER_NVS_KEY, s_users, &len) != ESP_OK || len != sizeof(s_users)) {
+            memset(s_users, 0, sizeof(s_users));   // Absent or from another layout
+        }
+        nvs_close(h);
+    }
+
+    int n = 0, replayed = 0;
+    for (int i = 0; i < USER_PROFILES_MAX; i++) {
+        if (!s_users[i].in_use) continue;
+        n++;
+        replayed += replay_unsaved((uint8_t)i);
+    }
+    if (replayed > 0) {
+        save_profiles();
+    }
+    LOG_ROW(TAG, "%d profile(s) loaded, %d unsaved weigh-in(s) replayed", n, replayed);
+    return ESP_OK;
+}
+
+esp_err_t user_profiles_set(uint8_t id, const char *name, const body_input_t *body, float weight_hint_g) {
+    if (id >= USER_PROFILES_MAX || !s_lock) return ESP_ERR_INVALID_ARG;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    user_profile_t *u = &s_users[id];
+    if (!u->in_use) {
+        memset(u, 0, sizeof(*u));
+        u->in_use = true;
+    }
+    strlcpy(u->name, name ? name : "", sizeof(u->name));
+    if (body) {
+        u->body = *body;
+    }
+    u->weight_hint_g = weight_hint_g;
+    esp_err_t err = save_profiles();
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t user_profiles_delete(uint8_t id) {
+    if (id >= USER_PROFILES_MAX || !s_lock) return ESP_ERR_INVALID_ARG;
+
+    char path[32];
+    history_path(id, path, sizeof(path));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    memset(&s_users[id], 0, sizeof(s_users[id]));
+    storage_remove(path);
+    esp_err_t err = save_profiles();
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+bool user_profiles_get(uint8_t id, user_profile_t *out) {
+    if (id >= USER_PROFILES_MAX || !s_lock || !out) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_users[id];
+    xSemaphoreGive(s_lock);
+    return out->in_use;
+}
+
+uint8_t user_profiles_identify(float weight_g) {
+    if (!s_lock) return USER_ID_UNKNOWN;
+
+    uint8_t best = USER_ID_UNKNOWN;
+    float d_best = INFINITY, d_second = INFINITY;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < USER_PROFILES_MAX; i++) {
+        float mean, sigma;
+        if (!cluster_of(&s_users[i], &mean, &sigma)) continue;
+        float d = fabsf(weight_g - mean) / sigma;
+        if (d < d_best) {
+            d_second = d_best;
+            d_best = d;
+            best = (uint8_t)i;
+        } else if (d < d_second) {
+            d_second = d;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (d_best > USER_MATCH_SIGMA) return USER_ID_UNKNOWN;
+    if (d_second <= USER_MATCH_SIGMA && d_second - d_best < USER_AMBIGUITY_SIGMA) {
+        return USER_ID_UNKNOWN;   // Two people of similar weight: let the app decide
+    }
+    return best;
+}
+
+esp_err_t user_profiles_record(uint8_t id, float weight_g, int64_t mono_us, body_composition_t *bc_out) {
+    if (id >= USER_PROFILES_MAX || !s_lock) return ESP_ERR_NOT_FOUND;
+
+    user_history_record_t r = {
+        .weight_g      = weight_g,
+        .body_fat_x100 = USER_BODY_FAT_NONE,
+    };
+    time_t wall = clock_map_to_wall(mono_us);
+    if (wall > 0) {
+        r.timestamp = (uint32_t)wall;
+    } else {
+        r.timestamp = (uint32_t)(mono_us / 1000000);
+        r.flags = WEIGH_LOG_FLAG_MONO | clock_map_boot_tag();
+    }
+
+    char path[32];
+    history_path(id, path, sizeof(path));
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    user_profile_t *u = &s_users[id];
+    if (!u->in_use) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    float mean, sigma;
+    if (cluster_of(u, &mean, &sigma)) {
+        float d = fabsf(weight_g - mean) / sigma * 10.0f;
+        r.match_x10 = d > 255.0f ? 255 : (uint8_t)d;
+    }
+    cluster_update(u, weight_g);
+
+    body_composition_t bc = { 0 };
+    bool have_bc = calculate_body_composition(&u->body, weight_g / 1000.0f, &bc);
+    if (have_bc) {
+        r.body_fat_x100 = (uint16_t)lroundf(bc.body_fat_percentage * 100.0f);
+    }
+
+    r.seq = u->hist_seq + 1;
+    r.crc = record_crc(&r);
+
+    storage_file_t f;
+    esp_err_t err = storage_open(path, &f);
+    if (err == ESP_OK) {
+        err = storage_write_at(&f, slot_offset(r.seq), &r, sizeof(r), STORAGE_SYNC_DATA);
+        storage_close(&f);
+    }
+    if (err == ESP_OK) {
+        u->hist_seq = r.seq;
+    }
+    // The cluster moved even if the history write failed; a reset before
+    // the write-back is covered by replay_unsaved() for written records
+    if (++s_unsaved >= USER_SAVE_EVERY) {
+        save_profiles();
+    }
+    xSemaphoreGive(s_lock);
+
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "History append failed for user %u", (unsigned)id);
+    }
+    if (bc_out) {
+        *bc_out = have_bc ? bc : (body_composition_t){ 0 };
+    }
+    return err;
+}
+
+esp_err_t user_profiles_flush(void) {
+    if (!s_lock) return ESP_ERR_INVALID_STATE;
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_unsaved > 0) {
+        err = save_profiles();
+    }
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+int user_profiles_read_history(uint8_t id, uint32_t from_seq, user_history_record_t *out, int max) {
+    if (id >= USER_PROFILES_MAX || !s_lock || !out || max <= 0) return 0;
+
+    char path[32];
+    history_path(id, path, sizeof(path));
+
+    int n = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    uint32_t last = s_users[id].in_use ? s_users[id].hist_seq : 0;
+    uint32_t first = last > USER_HISTORY_CAPACITY ? last - USER_HISTORY_CAPACITY + 1 : 1;
+    storage_file_t f;
+    if (last && storage_open(path, &f) == ESP_OK) {
+        for (uint32_t seq = from_seq < first ? first : from_seq; seq <= last && n < max; seq++) {
+            size_t got;
+            if (storage_read_at(&f, slot_offset(seq), &out[n], sizeof(out[0]), &got) != ESP_OK ||
+                got != sizeof(out[0])) {
+                break;
+            }
+            if (out[n].seq == seq && out[n].crc == record_crc(&out[n])) {
+                n++;
+            }
+        }
+        storage_close(&f);
+    }
+    xSemaphoreGive(s_lock);
+
+    for (int i = 0; i < n; i++) {
+        time_t wall;
+        if ((out[i].flags & WEIGH_LOG_FLAG_MONO) &&
+            clock_map_resolve(out[i].flags & WEIGH_LOG_FLAG_BOOT_MASK,
+                              (int64_t)out[i].timestamp * 1000000, &wall)) {
+            out[i].timestamp = (uint32_t)wall;
+            out[i].flags &= (uint8_t)~(WEIGH_LOG_FLAG_MONO | WEIGH_LOG_FLAG_BOOT_MASK);
+        }
+    }
+    return n;
+}
@@ -0,0 +1,148 @@
+// File: main/user_profiles/user_profiles.h
+#ifndef USER_PROFILES_H
+#define USER_PROFILES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_err.h"
+#include "body_composition.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Profiles per household; the slot index is the WSS user index
+#ifndef USER_PROFILES_MAX
+#define USER_PROFILES_MAX       8
+#endif
+
+#define USER_ID_UNKNOWN         0xFF
+
+// Per-user history ring on the storage partition ("user<N>.bin")
+#ifndef USER_HISTORY_FILE
+#define USER_HISTORY_FILE       "user%u.bin"
+#endif
+
+#ifndef USER_HISTORY_CAPACITY
+#define USER_HISTORY_CAPACITY   256
+#endif
+
+// Running statistics follow the last ~N weigh-ins (exact Welford below N,
+// exponential forgetting with weight 1/N after that)
+#ifndef USER_STATS_WINDOW
+#define USER_STATS_WINDOW       20
+#endif
+
+// Weigh-ins between write-backs of the profile blob. Profile changes are
+// saved at once; after a reset, init replays the history records newer
+// than the saved blob, so statistics and the history position survive
+#ifndef USER_SAVE_EVERY
+#define USER_SAVE_EVERY         8
+#endif
+
+// Identification: a weigh-in belongs to a user when it lies within
+// USER_MATCH_SIGMA standard deviations of that user's recent mean. The
+// deviation is floored at USER_MIN_SIGMA_G (day-to-day variation), and a
+// user with no weigh-ins yet is matched against the weight hint set with
+// the profile using USER_HINT_SIGMA_G.
+#ifndef USER_MATCH_SIGMA
+#define USER_MATCH_SIGMA        3.0f
+#endif
+
+#ifndef USER_MIN_SIGMA_G
+#define USER_MIN_SIGMA_G        700.0f
+#endif
+
+#ifndef USER_HINT_SIGMA_G
+#define USER_HINT_SIGMA_G       3000.0f
+#endif
+
+// Two candidates closer than this (in sigmas) are ambiguous → unknown
+#ifndef USER_AMBIGUITY_SIGMA
+#define USER_AMBIGUITY_SIGMA    1.0f
+#endif
+
+typedef struct {
+    bool         in_use;
+    char         name[16];
+    body_input_t body;          // Zero height/waist/neck → no body composition
+    float        weight_hint_g; // Expected weight before the first weigh-in, 0 if none
+
+    // Recent-weight cluster, updated in O(1) per weigh-in
+    uint32_t     count;         // Weigh-ins attributed to this user
+    float        mean_g;
+    float        var_g2;
+
+    uint32_t     hist_seq;      // Newest history record (0 = none)
+} user_profile_t;
+
+// Body-fat fields when no composition could be computed
+#define USER_BODY_FAT_NONE      0xFFFF
+
+/**
+ * @brief One history record (20 bytes on flash).
+ *
+ * Fat and lean mass follow from weight and body fat, so only the
+ * percentage is stored. Timestamps use the weigh_log convention: Unix
+ * seconds, or seconds since boot with WEIGH_LOG_FLAG_MONO | boot tag.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;             // Per-user sequence number (0 = empty slot)
+    uint32_t timestamp;
+    float    weight_g;
+    uint16_t body_fat_x100;   // Body fat in 0.01 %, USER_BODY_FAT_NONE if unknown
+    uint8_t  flags;           // WEIGH_LOG_FLAG_*
+    uint8_t  match_x10;       // Distance to the user's cluster in 0.1 sigma
+    uint16_t crc;             // CRC-16 over the preceding 18 bytes
+} user_history_record_t;
+
+/** @brief Load profiles from NVS. NVS must already be initialised. */
+esp_err_t user_profiles_init(void);
+
+/**
+ * @brief Create or replace a profile. Existing statistics and history are
+ *        kept when only the body measurements or name change.
+ * @param id             Slot / WSS user index (< USER_PROFILES_MAX)
+ * @param weight_hint_g  Approximate weight for first-time identification, 0 if unknown
+ */
+esp_err_t user_profiles_set(uint8_t id, const char *name, const body_input_t *body, float weight_hint_g);
+
+/** @brief Remove a profile and its history. */
+esp_err_t user_profiles_delete(uint8_t id);
+
+/** @brief Copy a profile; false if the slot is empty. */
+bool user_profiles_get(uint8_t id, user_profile_t *out);
+
+/**
+ * @brief Nearest user for a locked weight.
+ * @return User id, or USER_ID_UNKNOWN when no cluster (or more than one) fits
+ */
+uint8_t user_profiles_identify(float weight_g);
+
+/**
+ * @brief Attribute a locked weigh-in to a user: update the cluster,
+ *        compute body composition from this weight and append it to the
+ *        user's history.
+ * @param id       User from user_profiles_identify()
+ * @param mono_us  Capture time in the monotonic domain (clock_map_mono_us)
+ * @param bc_out   Optional: receives the body composition
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND for an unknown user
+ */
+esp_err_t user_profiles_record(uint8_t id, float weight_g, int64_t mono_us, body_composition_t *bc_out);
+
+/** @brief Write back weigh-ins not yet saved (before deep sleep). */
+esp_err_t user_profiles_flush(void);
+
+/**
+ * @brief Read up to `max` history records of a user starting at `from_seq`,
+ *        with boot-relative stamps re-based where possible.
+ * @return Number of records copied
+ */
+int user_profiles_read_history(uint8_t id, uint32_t from_seq, user_history_record_t *out, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // USER_PROFILES_H
@@ -0,0 +1,351 @@
+// File: main/web_assets/web_assets.c
+// ---------------------------------------------------------------------------
+// Web dashboard
+//   - Read-only "www" SPIFFS partition staged by tools/www_pack.py
+//   - Manifest loaded once, binary-searched per request
+//   - Precompressed bodies picked by Accept-Encoding (br > gzip > identity),
+//     gzip when identity is not stored and nothing stored is accepted
+//   - Content-hash ETags: If-None-Match → 304 without opening a file
+//   - Immutable caching for fingerprinted assets, revalidation for pages
+// ---------------------------------------------------------------------------
+
+#include "web_assets.h"
+#include "rest_api.h"
+#include "resources.h"
+#include "esp_spiffs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+static const char *TAG = "WEB_ASSETS";
+
+#define MANIFEST_PATH   WEB_ASSETS_BASE "/manifest"
+#define ID_LEN          16
+
+// Stored encodings (manifest "bgi")
+#define ENC_BR          0x01
+#define ENC_GZIP        0x02
+#define ENC_IDENTITY    0x04
+
+typedef struct {
+    const char *path;           // URL path, points into the manifest text
+    const char *mime;
+    char        id[ID_LEN + 1];
+    uint8_t     encs;           // ENC_* stored
+    bool        immutable;
+    uint32_t    size;           // Original (identity) size
+} web_asset_t;
+
+static web_asset_t      *s_assets = NULL;
+static size_t            s_count = 0;
+static char             *s_text = NULL;     // Manifest, parsed in place
+static portMUX_TYPE      s_lock = portMUX_INITIALIZER_UNLOCKED;
+static web_assets_stats_t s_stats;
+
+static void stats_add(uint32_t *field, uint32_t n) {
+    taskENTER_CRITICAL(&s_lock);
+    *field += n;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/* ----------------------------- Manifest ------------------------------ */
+
+static int asset_cmp(const void *a, const void *b)
+{
+    return strcmp(((const web_asset_t *)a)->path, ((const web_asset_t *)b)->path);
+}
+
+// "<id> <encs> <cache> <size> <mime> <path>" → entry; false on a bad line
+static bool parse_line(char *line, web_asset_t *a)
+{
+    char *save = NULL;
+    char *id    = strtok_r(line, " ", &save);
+    char *encs  = strtok_r(NULL, " ", &save);
+    char *cache = strtok_r(NULL, " ", &save);
+    char *size  = strtok_r(NULL, " ", &save);
+    char *mime  = strtok_r(NULL, " ", &save);
+    char *path  = strtok_r(NULL, "", &save);
+    if (!path || strlen(id) != ID_LEN || path[0] != '/') return false;
+
+    memcpy(a->id, id, ID_LEN + 1);
+    a->encs = (strchr(encs, 'b') ? ENC_BR : 0) |
+              (strchr(encs, 'g') ? ENC_GZIP : 0) |
+              (strchr(encs, 'i') ? ENC_IDENTITY : 0);
+    a->immutable = cache[0] == 'i';
+    a->size = (uint32_t)strtoul(size, NULL, 10);
+    a->mime = mime;
+    a->path = path;
+    return a->encs != 0;
+}
+
+static esp_err_t load_manifest(void)
+{
+    struct stat st;
+    if (stat(MANIFEST_PATH, &st) != 0 || st.st_size <= 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FILE *f = fopen(MANIFEST_PATH, "r");
+    if (!f) return ESP_ERR_NOT_FOUND;
+
+    s_text = res_malloc(RES_HEAP_STORAGE, st.st_size + 1);
+    if (!s_text) {
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t len = fread(s_text, 1, st.st_size, f);
+    fclose(f);
+    s_text[len] = '\0';
+
+    size_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s_text[i] == '\n') lines++;
+    }
+    if (lines > WEB_ASSETS_MAX) {
+        ESP_LOGW(TAG, "Manifest has %u entries, serving the first %d", (unsigned)lines, WEB_ASSETS_MAX);
+        lines = WEB_ASSETS_MAX;
+    }
+    s_assets = res_malloc(RES_HEAP_STORAGE, (lines ? lines : 1) * sizeof(web_asset_t));
+    if (!s_assets) {
+        res_free(s_text);
+        s_text = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    bool sorted = true;
+    char *save = NULL;
+    for (char *line = strtok_r(s_text, "\n", &save); line && s_count < lines;
+         line = strtok_r(NULL, "\n", &save)) {
+        if (!parse_line(line, &s_assets[s_count])) {
+            ESP_LOGW(TAG, "Bad manifest line %u", (unsigned)s_count + 1);
+            continue;
+        }
+        if (s_count && strcmp(s_assets[s_count - 1].path, s_assets[s_count].path) > 0) {
+            sorted = false;
+        }
+        s_count++;
+    }
+    if (!sorted) {
+        qsort(s_assets, s_count, sizeof(web_asset_t), asset_cmp);   // Hand-edited manifest
+    }
+    return ESP_OK;
+}
+
+static const web_asset_t *find(const char *path)
+{
+    web_asset_t key = { .path = path };
+    return s_count ? bsearch(&key, s_assets, s_count, sizeof(web_asset_t), asset_cmp) : NULL;
+}
+
+// Exact path, then the export's clean URLs: /x → /x.html, /x/ → /x/index.html
+static const web_asset_t *resolve(const char *uri)
+{
+    char path[128];
+    size_t n = strcspn(uri, "?#");
+    if (n == 0 || n >= sizeof(path) - sizeof("index.html")) return NULL;
+    memcpy(path, uri, n);
+    path[n] = '\0';
+
+    const web_asset_t *a = find(path);
+    if (a) return a;
+
+    if (path[n - 1] == '/') {
+        strcpy(path + n, "index.html");
+        return find(path);
+    }
+    const char *last = strrchr(path, '/');
+    if (!strchr(last, '.')) {
+        strcpy(path + n, ".html");
+        return find(path);
+    }
+    return NULL;
+}
+
+/* ----------------------------- Negotiation ---------------------------- */
+
+// Whether a coding token is acceptable in an Accept-Encoding value ("*"
+// counts, ";q=0" excludes)
+static bool accepts(const char *hdr, const char *coding)
+{
+    size_t clen = strlen(coding);
+    const char *p = hdr;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        const char *tok = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') p++;
+        size_t tlen = (size_t)(p - tok);
+        bool match = (tlen == clen && strncasecmp(tok, coding, clen) == 0) ||
+                     (tlen == 1 && tok[0] == '*');
+
+        bool zero = false;
+        while (*p && *p != ',') {
+            if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+                zero = strtod(p + 2, NULL) <= 0.0;
+            }
+            p++;
+        }
+        if (match && !zero) return true;
+    }
+    return false;
+}
+
+static uint8_t pick_encoding(httpd_req_t *req, const web_asset_t *a)
+{
+    char hdr[96] = "";
+    if (httpd_req_get_hdr_value_str(req, "Accept-Encoding", hdr, sizeof(hdr)) != ESP_OK) {
+        // No header: any coding is acceptable; a truncated one is read as far as it goes
+        if (httpd_req_get_hdr_value_len(req, "Accept-Encoding") == 0) {
+            return (a->encs & ENC_IDENTITY) ? ENC_IDENTITY : (a->encs & ENC_GZIP) ? ENC_GZIP : ENC_BR;
+        }
+    }
+    if ((a->encs & ENC_BR) && accepts(hdr, "br")) return ENC_BR;
+    if ((a->encs & ENC_GZIP) && accepts(hdr, "gzip")) return ENC_GZIP;
+    if (a->encs & ENC_IDENTITY) return ENC_IDENTITY;   // Always acceptable in practice
+    // Stored compressed only (www_pack.py drops identity when gzip pays):
+    // send gzip, labelled, rather than a 406 no browser would recover from
+    return (a->encs & ENC_GZIP) ? ENC_GZIP : ENC_BR;
+}
+
+static const char *enc_suffix(uint8_t enc)
+{
+    return enc == ENC_BR ? ".br" : enc == ENC_GZIP ? ".gz" : "";
+}
+
+// Strong validator per stored representation: "<id>", "<id>-br", "<id>-gz"
+static void make_etag(char *buf, size_t len, const web_asset_t *a, uint8_t enc)
+{
+    snprintf(buf, len, "\"%s%s\"", a->id, enc == ENC_BR ? "-br" : enc == ENC_GZIP ? "-gz" : "");
+}
+
+static bool not_modified(httpd_req_t *req, const char *etag)
+{
+    char inm[128];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) != ESP_OK) {
+        return false;
+    }
+    // Weak comparison (RFC 9110 13.1.2): a W/ prefix does not matter
+    return strstr(inm, etag) != NULL || strcmp(inm, "*") == 0;
+}
+
+/* ------------------------------- Bodies ------------------------------- */
+
+// Headers + body for one resolved asset; runs on the httpd task or a worker
+static esp_err_t send_asset(httpd_req_t *req, const web_asset_t *a, uint8_t enc)
+{
+    char file[sizeof(WEB_ASSETS_BASE) + ID_LEN + 8];
+    snprintf(file, sizeof(file), WEB_ASSETS_BASE "/%s%s", a->id, enc_suffix(enc));
+    FILE *f = fopen(file, "rb");
+    char *buf = f ? res_malloc(RES_HEAP_HTTP, WEB_ASSETS_CHUNK) : NULL;
+    if (!buf) {
+        ESP_LOGE(TAG, "%s: %s", a->path, f ? "no memory" : "missing file");
+        if (f) fclose(f);
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    char etag[ID_LEN + 8];
+    make_etag(etag, sizeof(etag), a, enc);
+    httpd_resp_set_type(req, a->mime);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", a->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if (enc != ENC_IDENTITY) {
+        httpd_resp_set_hdr(req, "Content-Encoding", enc == ENC_BR ? "br" : "gzip");
+    }
+
+    esp_err_t err = ESP_OK;
+    uint32_t sent = 0;
+    size_t n;
+    while (err == ESP_OK && (n = fread(buf, 1, WEB_ASSETS_CHUNK, f)) > 0) {
+        err = httpd_resp_send_chunk(req, buf, n);
+        sent += n;
+    }
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    fclose(f);
+    res_free(buf);
+
+    stats_add(&s_stats.bodies, 1);
+    stats_add(&s_stats.bytes, sent);
+    return err;
+}
+
+// Worker side of a large body: negotiate again on the detached request
+static esp_err_t send_async(httpd_req_t *req)
+{
+    const web_asset_t *a = resolve(req->uri);
+    if (!a) {
+        httpd_resp_send_500(req);   // Cannot happen: resolved before offloading
+        return ESP_FAIL;
+    }
+    return send_asset(req, a, pick_encoding(req, a));
+}
+
+/* ------------------------------- Public ------------------------------- */
+
+esp_err_t web_assets_handler(httpd_req_t *req)
+{
+    stats_add(&s_stats.requests, 1);
+
+    const web_asset_t *a = resolve(req->uri);
+    if (!a) {
+        stats_add(&s_stats.not_found, 1);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+        return ESP_OK;
+    }
+    uint8_t enc = pick_encoding(req, a);
+
+    char etag[ID_LEN + 8];
+    make_etag(etag, sizeof(etag), a, enc);
+    if (not_modified(req, etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_set_hdr(req, "Cache-Control", a->immutable ? "public, max-age=31536000, immutable" : "no-cache");
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+        httpd_resp_send(req, NULL, 0);
+        stats_add(&s_stats.not_modified, 1);
+        return ESP_OK;
+    }
+
+    // Large bodies (the JS bundle) on a worker, so /weight and /stream keep
+    // going while it downloads; inline when none is free
+    if (a->size > WEB_ASSETS_INLINE_MAX && rest_api_offload(req, send_async) == ESP_OK) {
+        return ESP_OK;
+    }
+    return send_asset(req, a, enc);
+}
+
+esp_err_t web_assets_init(void)
+{
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = WEB_ASSETS_BASE,
+        .partition_label = WEB_ASSETS_PARTITION,
+        .max_files = RES_HTTP_WORKERS + 1,      // Workers + the httpd task
+        .format_if_mount_failed = false         // Image comes from the build
+    };
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No dashboard partition (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = load_manifest();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "No dashboard manifest (%s)", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "Dashboard: %u assets", (unsigned)s_count);
+    return ESP_OK;
+}
+
+void web_assets_get_stats(web_assets_stats_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,80 @@
+// File: main/web_assets/web_assets.h
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Web dashboard served from the "www" SPIFFS partition.
+ *
+ * tools/www_pack.py stages the web export at build time: every file is
+ * stored precompressed (brotli and/or gzip, identity only where
+ * compression does not pay) under its content hash, plus a manifest that
+ * maps URL paths to hashes, encodings and MIME types. At runtime nothing
+ * is compressed or hashed:
+ *   - the manifest is loaded once, sorted, and looked up by binary search;
+ *   - the encoding is picked from Accept-Encoding (br > gzip > identity)
+ *     and sent as stored, with Content-Encoding and Vary; an asset with
+ *     no identity copy goes out as gzip even to a client that did not
+ *     list it, never as a 406;
+ *   - the content hash is the strong ETag, so If-None-Match answers 304
+ *     straight from the manifest without touching the file;
+ *   - fingerprinted assets get Cache-Control: immutable (no request at all
+ *     on a repeat load), pages get no-cache (one 304 per load);
+ *   - bodies go out in WEB_ASSETS_CHUNK pieces read straight from flash
+ *     into one buffer; large ones on an HTTP worker (rest_api), or inline
+ *     when none is free, since browsers do not retry sub-resources.
+ */
+
+#ifndef WEB_ASSETS_BASE
+#define WEB_ASSETS_BASE         "/www"
+#endif
+#ifndef WEB_ASSETS_PARTITION
+#define WEB_ASSETS_PARTITION    "www"
+#endif
+#ifndef WEB_ASSETS_CHUNK
+#define WEB_ASSETS_CHUNK        4096    // 16 SPIFFS pages per read
+#endif
+#ifndef WEB_ASSETS_INLINE_MAX
+#define WEB_ASSETS_INLINE_MAX   8192    // Smaller bodies never leave the httpd task
+#endif
+#ifndef WEB_ASSETS_MAX
+#define WEB_ASSETS_MAX          256     // Manifest entries
+#endif
+
+typedef struct {
+    uint32_t requests;
+    uint32_t not_modified;      // 304s
+    uint32_t bodies;            // 200s
+    uint32_t bytes;             // Body bytes sent (as stored, i.e. compressed)
+    uint32_t not_found;
+} web_assets_stats_t;
+
+/**
+ * @brief Mount the www partition read-only and load its manifest.
+ *        Without a partition image the dashboard is just absent (404s).
+ */
+esp_err_t web_assets_init(void);
+
+/**
+ * @brief GET handler for every path the API routes do not claim
+ *        (last wildcard entry of the rest_api route table).
+ */
+esp_err_t web_assets_handler(httpd_req_t *req);
+
+/** @brief Counters since boot. */
+void web_assets_get_stats(web_assets_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WEB_ASSETS_H
@@ -0,0 +1,185 @@
+// File: main/weigh_log/weigh_log.c
+// ---------------------------------------------------------------------------
+// Persistent weigh-in log
+//   - Fixed-size binary records in a ring of WEIGH_LOG_CAPACITY slots
+//   - Slot index derived from the sequence number → O(1) append and seek
+//   - CRC per record, so a torn write only loses that record
+//   - Each append synced to flash before it is acknowledged
+// ---------------------------------------------------------------------------
+
+#include "weigh_log.h"
+
+#include <string.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_rom_crc.h"
+#include "clock_map.h"
+#include "storage.h"
+#include "log_utils.h"
+
+static const char *TAG = "WeighLog";
+
+static storage_file_t    s_file = { .fd = -1 };
+static SemaphoreHandle_t s_lock = NULL;
+static StaticSemaphore_t s_lock_buf;
+static uint32_t          s_first_seq = 0;   // Oldest retained record
+static uint32_t          s_last_seq  = 0;   // Newest record
+
+static uint16_t record_crc(const weigh_log_record_t *r) {
+    return esp_rom_crc16_le(0, (const uint8_t *)r, offsetof(weigh_log_record_t, crc));
+}
+
+static size_t slot_offset(uint32_t seq) {
+    return (size_t)((seq - 1) % WEIGH_LOG_CAPACITY) * sizeof(weigh_log_record_t);
+}
+
+esp_err_t weigh_log_init(void) {
+    if (s_file.fd >= 0) {
+        return ESP_OK;
+    }
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+        if (!s_lock) return ESP_ERR_NO_MEM;
+    }
+
+    if (storage_open(WEIGH_LOG_FILE, &s_file) != ESP_OK) {
+        LOG_ROW(TAG, "Cannot open %s", WEIGH_LOG_FILE);
+        return ESP_FAIL;
+    }
+
+    // Recover the newest sequence number from the slots on flash
+    weigh_log_record_t chunk[16];
+    uint32_t max_seq = 0;
+    size_t offset = 0, got;
+    while (storage_read_at(&s_file, offset, chunk, sizeof(chunk), &got) == ESP_OK && got > 0) {
+        for (size_t i = 0; i < got / sizeof(chunk[0]); i++) {
+            const weigh_log_record_t *r = &chunk[i];
+            if (r->seq != 0 && r->crc == record_crc(r) && r->seq > max_seq) {
+                max_seq = r->seq;
+            }
+        }
+        offset += got;
+    }
+
+    s_last_seq  = max_seq;
+    s_first_seq = (max_seq == 0) ? 0
+                : (max_seq > WEIGH_LOG_CAPACITY ? max_seq - WEIGH_LOG_CAPACITY + 1 : 1);
+
+    LOG_ROW(TAG, "Opened, records %" PRIu32 "..%" PRIu32, s_first_seq, s_last_seq);
+    return ESP_OK;
+}
+
+esp_err_t weigh_log_append(float weight_g, int64_t mono_us, uint8_t user_id, uint32_t *seq_out) {
+    if (s_file.fd < 0) return ESP_ERR_INVALID_STATE;
+
+    weigh_log_record_t r = {
+        .weight_g  = weight_g,
+        .user_id   = user_id,
+        .flags     = 0,
+    };
+
+    // Store wall-clock time when known, otherwise a boot-relative stamp
+    // that weigh_log_read() re-bases once this boot has been mapped
+    time_t wall = clock_map_to_wall(mono_us);
+    if (wall > 0) {
+        r.timestamp = (uint32_t)wall;
+    } else {
+        r.timestamp = (uint32_t)(mono_us / 1000000);
+        r.flags = WEIGH_LOG_FLAG_MONO | clock_map_boot_tag();
+    }
+
+    esp_err_t err = ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    r.seq = s_last_seq + 1;
+    r.crc = record_crc(&r);
+
+    if (storage_write_at(&s_file, slot_offset(r.seq), &r, sizeof(r), STORAGE_SYNC_DATA) != ESP_OK) {
+        err = ESP_FAIL;
+    } else {
+        s_last_seq = r.seq;
+        if (s_first_seq == 0) {
+            s_first_seq = 1;
+        } else if (s_last_seq - s_first_seq >= WEIGH_LOG_CAPACITY) {
+            s_first_seq = s_last_seq - WEIGH_LOG_CAPACITY + 1;
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    if (err != ESP_OK) {
+        LOG_ROW(TAG, "Append failed");
+    } else if (seq_out) {
+        *seq_out = r.seq;
+    }
+    return err;
+}
+
+int weigh_log_read(uint32_t from_seq, weigh_log_record_t *out, int max) {
+    if (!out || max <= 0) return 0;
+    if (s_file.fd < 0) return -1;
+
+    int n = 0;
+    bool failed = false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_last_seq != 0 && from_seq <= s_last_seq) {
+        uint32_t seq = from_seq < s_first_seq ? s_first_seq : from_seq;
+        while (n < max && seq <= s_last_seq) {
+            // Consecutive slots are contiguous until the ring wraps
+            uint32_t run = WEIGH_LOG_CAPACITY - (seq - 1) % WEIGH_LOG_CAPACITY;
+            uint32_t want = s_last_seq - seq + 1;
+            if (want > run) want = run;
+            if (want > (uint32_t)(max - n)) want = (uint32_t)(max - n);
+
+            size_t got;
+            if (storage_read_at(&s_file, slot_offset(seq), &out[n], want * sizeof(out[0]), &got) != ESP_OK) {
+                failed = true;
+                break;
+            }
+            got /= sizeof(out[0]);
+
+            // Drop slots that fail validation (torn write) but keep going
+            int base = n;
+            for (size_t i = 0; i < got; i++) {
+                const weigh_log_record_t *r = &out[base + i];
+                if (r->seq == seq + i && r->crc == record_crc(r)) {
+                    out[n++] = *r;
+                }
+            }
+            seq += (uint32_t)got;
+            if (got < want) {
+                failed = true;      // Every slot up to s_last_seq is written
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(s_lock);
+    if (n == 0 && failed) return -1;
+
+    // Lazy re-base of boot-relative stamps (copies only, flash unchanged)
+    for (int i = 0; i < n; i++) {
+        time_t wall;
+        if ((out[i].flags & WEIGH_LOG_FLAG_MONO) &&
+            clock_map_resolve(out[i].flags & WEIGH_LOG_FLAG_BOOT_MASK,
+                              (int64_t)out[i].timestamp * 1000000, &wall)) {
+            out[i].timestamp = (uint32_t)wall;
+            out[i].flags &= (uint8_t)~(WEIGH_LOG_FLAG_MONO | WEIGH_LOG_FLAG_BOOT_MASK);
+        }
+    }
+    return n;
+}
+
+uint32_t weigh_log_first_seq(void) {
+    return s_first_seq;
+}
+
+uint32_t weigh_log_last_seq(void) {
+    return s_last_seq;
+}
+
+uint32_t weigh_log_count_from(uint32_t from_seq) {
+    uint32_t first = s_first_seq, last = s_last_seq;
+    if (last == 0 || from_seq > last) return 0;
+    if (from_seq < first) from_seq = first;
+    return last - from_seq + 1;
+}
@@ -0,0 +1,85 @@
+// File: main/weigh_log/weigh_log.h
+#ifndef WEIGH_LOG_H
+#define WEIGH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Weigh-in log file on the "storage" partition (storage.h name)
+#ifndef WEIGH_LOG_FILE
+#define WEIGH_LOG_FILE      "weighins.bin"
+#endif
+
+// Number of record slots; the oldest record is overwritten when full
+#ifndef WEIGH_LOG_CAPACITY
+#define WEIGH_LOG_CAPACITY  1024
+#endif
+
+// Record flags: a weigh-in taken before this boot had wall-clock time
+// stores seconds since boot plus the boot tag (see clock_map.h)
+#define WEIGH_LOG_FLAG_MONO      0x80
+#define WEIGH_LOG_FLAG_BOOT_MASK 0x7F
+
+/**
+ * @brief One stored weigh-in (16 bytes on flash).
+ *
+ * `seq` starts at 1 and increases by one per record for the life of the
+ * log, so clients can resume a sync from the last sequence they saw.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t seq;        // Record sequence number (0 = empty slot)
+    uint32_t timestamp;  // Unix seconds, or seconds since boot with FLAG_MONO
+    float    weight_g;   // Locked weight in grams
+    uint8_t  user_id;    // WSS user index, 0xFF if unknown
+    uint8_t  flags;      // WEIGH_LOG_FLAG_*
+    uint16_t crc;        // CRC-16 over the preceding 14 bytes
+} weigh_log_record_t;
+
+/**
+ * @brief Open (or create) the log and recover the sequence range.
+ *        storage_init() must have run.
+ */
+esp_err_t weigh_log_init(void);
+
+/**
+ * @brief Append a weigh-in.
+ * @param weight_g   Locked weight in grams
+ * @param mono_us    Capture time in the monotonic domain (clock_map_mono_us)
+ * @param user_id    WSS user index or 0xFF
+ * @param seq_out    Optional: receives the assigned sequence number
+ */
+esp_err_t weigh_log_append(float weight_g, int64_t mono_us, uint8_t user_id, uint32_t *seq_out);
+
+/**
+ * @brief Read up to `max` consecutive records starting at `from_seq`.
+ *
+ * Sequence numbers older than the oldest retained record are clamped to it.
+ * Boot-relative stamps are re-based to Unix time in the returned copies
+ * when a mapping for their boot is known; the rest keep FLAG_MONO.
+ * Slots that fail validation (torn writes) are skipped, so 0 means no
+ * valid record is left from `from_seq` on.
+ * @return Number of records copied to `out`, or -1 if the log could not
+ *         be read before any record was copied (retry from `from_seq`)
+ */
+int weigh_log_read(uint32_t from_seq, weigh_log_record_t *out, int max);
+
+/** @brief Oldest retained sequence number (0 if the log is empty). */
+uint32_t weigh_log_first_seq(void);
+
+/** @brief Newest sequence number (0 if the log is empty). */
+uint32_t weigh_log_last_seq(void);
+
+/** @brief Number of records with seq ≥ `from_seq`. */
+uint32_t weigh_log_count_from(uint32_t from_seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WEIGH_LOG_H
@@ -4,8 +4,10 @@
 // Features:
 //   - Proper handling of weight removal/replacement
 //   - Debounced state transitions
-//   - SNTP-aware timestamping
-//   - Configurable thresholds
+//   - Monotonic timestamps, mapped to wall-clock time once SNTP lands
+//   - Thresholds from the live configuration (scale_config), lock-free
+//   - Stable-weight lock, published as binary records to the connection hub
+//   - Follows the HX711 health: no locks while degraded, ERROR while offline
 // ---------------------------------------------------------------------------
 
 #include "weight_manager.h"
@@ -18,49 +20,128 @@
 #include <time.h>
 #include <math.h>
 
-#include "sntp_synch.h"   // for sntp_time_available()
-#include "esp_sntp.h"
+#include "clock_map.h"    // for clock_map_mono_us(), clock_map_to_wall()
 #include "log_utils.h"    // for LOG_ROW()
 #include "calibration.h"  // for calibration_convert()
+#include "app_connection_manager.h"  // for app_connection_manager_publish()
+#include "power_governor.h"          // for power_governor_set_measuring()
+#include "hx711.h"                   // for hx711_get_change_seq(), hx711_get_health()
+#include "user_profiles.h"           // for user_profiles_identify()
+#include "scale_config.h"            // for scale_config_acquire()
+#include "resources.h"               // for res_task_start()
 
-// Configuration
-#define WM_DEBOUNCE_COUNT      3    // Number of consecutive readings for state change
-#define WM_WAKE_THRESHOLD_G    20.0f  // Weight threshold to detect placement (grams)
-#define WM_SLEEP_THRESHOLD_G   10.0f  // Weight threshold to detect removal (grams)
-#define WM_SNTP_TIMEOUT_MS     5000   // Max wait for SNTP sync
+// Configuration (thresholds, debounce and lock window: scale_config_t)
 #define WM_MEASURE_INTERVAL_MS 100    // Time between measurements when active
+#define WM_SAMPLE_TIMEOUT_MS   1000   // No sample for this long: check the sensor
 
 typedef enum {
     WM_STATE_NO_WEIGHT = 0,    // Waiting for weight to be placed
     WM_STATE_DEBOUNCE_ADD,     // Detected possible weight addition
     WM_STATE_MEASURING,        // Actively measuring stable weight
     WM_STATE_DEBOUNCE_REMOVE,  // Detected possible weight removal
-    WM_STATE_ERROR             // Error condition
+    WM_STATE_ERROR             // Sensor offline: no readings until it recovers
 } wm_state_t;
 
 static QueueHandle_t  wm_queue = NULL;
 static calibration_t *wm_calib = NULL;
 static wm_state_t    current_state = WM_STATE_NO_WEIGHT;
+static float         wm_last_weight = 0.0f;
+static int           wm_cfg_reader = -1;
+
+// Stable-weight lock: ring of the most recent readings while measuring
+static float wm_stable_buf[SCALE_CFG_STABLE_COUNT_MAX];
+static int   wm_stable_len = 0;
+static int   wm_stable_idx = 0;
+static bool  wm_locked = false;
 
 /** Log timestamped weight event */
 static void log_weight_event(const char *event, float weight) {
-    time_t now = time(NULL);
+    int64_t mono = clock_map_mono_us();
+    time_t now = clock_map_to_wall(mono);
     struct tm timeinfo;
     char timestamp[32];
     
-    localtime_r(&now, &timeinfo);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    if (now > 0) {
+        localtime_r(&now, &timeinfo);
+        strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    } else {
+        // No wall clock yet: boot-relative, re-based later by readers
+        snprintf(timestamp, sizeof(timestamp), "boot+%lld.%03lds",
+                 (long long)(mono / 1000000), (long)((mono / 1000) % 1000));
+    }
     
     LOG_ROW("WeightManager", "%-12s | %s | %.2f g", event, timestamp, weight);
 }
 
-/** Handle state transitions with debouncing */
-static wm_state_t handle_state_transition(wm_state_t current, float weight, int *debounce_count) {
+/** Publish a binary record to every transport; never blocks on them */
+static void publish_weight(float weight, measurement_kind_t kind) {
+    int64_t mono = clock_map_mono_us();
+    measurement_t m = {
+        .weight_g  = weight,
+        .mono_us   = mono,
+        .timestamp = clock_map_to_wall(mono),
+        // Only a locked weight is reliable enough to tell people apart
+        .user_id   = (kind == MEAS_KIND_LOCKED) ? user_profiles_identify(weight) : USER_ID_UNKNOWN,
+        .kind      = kind,
+    };
+    app_connection_manager_publish(&m);
+}
+
+/** Feed the lock window; returns true once per weigh-in when readings settle */
+static bool update_stable_lock(float weight, const scale_config_t *cfg) {
+    int count = cfg->stable_count;
+    wm_stable_buf[wm_stable_idx] = weight;
+    wm_stable_idx = (wm_stable_idx + 1) % count;
+    if (wm_stable_len < count) {
+        wm_stable_len++;
+        return false;
+    }
+
+    float lo = wm_stable_buf[0], hi = wm_stable_buf[0];
+    for (int i = 1; i < count; i++) {
+        lo = fminf(lo, wm_stable_buf[i]);
+        hi = fmaxf(hi, wm_stable_buf[i]);
+    }
+    if (hi - lo > cfg->stable_tolerance_g) {
+        wm_locked = false;   // Load moved again: allow a fresh lock
+        return false;
+    }
+    if (wm_locked) {
+        return false;
+    }
+    wm_locked = true;
+    return true;
+}
+
+static void reset_stable_lock(void) {
+    wm_stable_len = 0;
+    wm_stable_idx = 0;
+    wm_locked = false;
+}
+
+/**
+ * Handle state transitions with debouncing. A change point in the matching
+ * direction (`change`) confirms a transition without waiting for
+ * cfg->debounce_count readings.
+ */
+static wm_state_t handle_state_transition(wm_state_t current, float weight, int *debounce_count,
+                                          cd_event_t change, const scale_config_t *cfg) {
+    if (change == CD_EVENT_UP && weight >= cfg->wake_threshold_g &&
+        (current == WM_STATE_NO_WEIGHT || current == WM_STATE_DEBOUNCE_ADD)) {
+        log_weight_event("WEIGHT_ADDED", weight);
+        return WM_STATE_MEASURING;
+    }
+    if (change == CD_EVENT_DOWN && weight <= cfg->sleep_threshold_g &&
+        (current == WM_STATE_MEASURING || current == WM_STATE_DEBOUNCE_REMOVE)) {
+        log_weight_event("WEIGHT_REMOVED", weight);
+        return WM_STATE_NO_WEIGHT;
+    }
+
     switch(current) {
         case WM_STATE_NO_WEIGHT:
-            if (weight >= WM_WAKE_THRESHOLD_G) {
+            if (weight >= cfg->wake_threshold_g) {
                 (*debounce_count)++;
-                if (*debounce_count >= WM_DEBOUNCE_COUNT) {
+                if (*debounce_count >= cfg->debounce_count) {
                     log_weight_event("WEIGHT_ADDED", weight);
                     return WM_STATE_MEASURING;
                 }
@@ -69,9 +150,9 @@ static wm_state_t handle_state_transition(wm_state_t current, float weight, int
             break;
             
         case WM_STATE_DEBOUNCE_ADD:
-            if (weight >= WM_WAKE_THRESHOLD_G) {
+            if (weight >= cfg->wake_threshold_g) {
                 (*debounce_count)++;
-                if (*debounce_count >= WM_DEBOUNCE_COUNT) {
+                if (*debounce_count >= cfg->debounce_count) {
                     log_weight_event("WEIGHT_ADDED", weight);
                     return WM_STATE_MEASURING;
                 }
@@ -82,9 +163,9 @@ static wm_state_t handle_state_transition(wm_state_t current, float weight, int
             break;
             
         case WM_STATE_MEASURING:
-            if (weight <= WM_SLEEP_THRESHOLD_G) {
+            if (weight <= cfg->sleep_threshold_g) {
                 (*debounce_count)++;
-                if (*debounce_count >= WM_DEBOUNCE_COUNT) {
+                if (*debounce_count >= cfg->debounce_count) {
                     log_weight_event("WEIGHT_REMOVED", weight);
                     return WM_STATE_NO_WEIGHT;
                 }
@@ -93,9 +174,9 @@ static wm_state_t handle_state_transition(wm_state_t current, float weight, int
             break;
             
         case WM_STATE_DEBOUNCE_REMOVE:
-            if (weight <= WM_SLEEP_THRESHOLD_G) {
+            if (weight <= cfg->sleep_threshold_g) {
                 (*debounce_count)++;
-                if (*debounce_count >= WM_DEBOUNCE_COUNT) {
+                if (*debounce_count >= cfg->debounce_count) {
                     log_weight_event("WEIGHT_REMOVED", weight);
                     return WM_STATE_NO_WEIGHT;
                 }
@@ -107,11 +188,7 @@ static wm_state_t handle_state_transition(wm_state_t current, float weight, int
             
         case WM_STATE_ERROR:
         default:
-            // Attempt recovery after error
-            if (fabs(weight) < 1000.0f) {  // Sanity check
-                *debounce_count = 0;
-                return WM_STATE_NO_WEIGHT;
-            }
+            // Left by the task once the sensor is healthy again
             break;
     }
     return current;
@@ -120,62 +197,134 @@ static wm_state_t handle_state_transition(wm_state_t current, float weight, int
 static void weight_manager_task(void *arg) {
     (void)arg;
     
-    // Wait for SNTP sync if available
-    if (!sntp_time_available(pdMS_TO_TICKS(WM_SNTP_TIMEOUT_MS))) {
-        LOG_ROW("WeightManager", "SNTP not synced, using local time");
-    }
-    
     // State machine variables
     int debounce_count = 0;
     float raw_count = 0.0f;
     float current_weight = 0.0f;
     TickType_t last_measure_time = xTaskGetTickCount();
+    uint8_t stable_count = 0;
+
+    // Change points from the HX711 driver; one stays pending for a few
+    // readings because the filtered weight crosses the thresholds later
+    uint32_t seen_change_seq = hx711_get_change_seq(NULL);
+    cd_event_t pending_change = CD_EVENT_NONE;
+    int pending_age = 0;
     
     for (;;) {
-        // Get new measurement
-        if (xQueueReceive(wm_queue, &raw_count, portMAX_DELAY) == pdTRUE) {
+        // Get new measurement; silence means the sensor may be offline
+        bool got = xQueueReceive(wm_queue, &raw_count, pdMS_TO_TICKS(WM_SAMPLE_TIMEOUT_MS)) == pdTRUE;
+        hx711_health_t health = hx711_get_health();
+
+        if (health == HX711_HEALTH_OFFLINE && current_state != WM_STATE_ERROR) {
+            // Whatever was on the platform is unknown now; nothing is
+            // published as removed, the next weigh-in starts from scratch
+            log_weight_event("SENSOR_OFFLINE", current_weight);
+            if (current_state != WM_STATE_NO_WEIGHT) {
+                power_governor_set_measuring(false);
+            }
+            reset_stable_lock();
+            current_state = WM_STATE_ERROR;
+            debounce_count = 0;
+            pending_change = CD_EVENT_NONE;
+        } else if (current_state == WM_STATE_ERROR && health == HX711_HEALTH_OK) {
+            log_weight_event("SENSOR_OK", current_weight);
+            current_state = WM_STATE_NO_WEIGHT;
+            seen_change_seq = hx711_get_change_seq(NULL);   // Reseed steps are not weigh-ins
+        }
+
+        if (got && current_state != WM_STATE_ERROR) {
             current_weight = calibration_convert(wm_calib, (int32_t)raw_count);
+            wm_last_weight = current_weight;
+
+            // Held until the end of this reading; a new version takes
+            // effect with the next one
+            const scale_config_t *cfg = scale_config_acquire(wm_cfg_reader);
+            if (cfg->stable_count != stable_count) {
+                stable_count = cfg->stable_count;
+                reset_stable_lock();   // Lock window was resized
+            }
             
+            cd_event_t dir;
+            uint32_t change_seq = hx711_get_change_seq(&dir);
+            if (change_seq != seen_change_seq) {
+                seen_change_seq = change_seq;
+                pending_change = dir;
+                pending_age = 0;
+                if (current_state == WM_STATE_MEASURING) {
+                    reset_stable_lock();   // Load moved: lock again once settled
+                }
+            } else if (pending_change != CD_EVENT_NONE && ++pending_age >= cfg->debounce_count) {
+                pending_change = CD_EVENT_NONE;
+            }
+
             // Handle state transition
-            wm_state_t new_state = handle_state_transition(current_state, current_weight, &debounce_count);
+            wm_state_t new_state = handle_state_transition(current_state, current_weight,
+                                                           &debounce_count, pending_change, cfg);
             
             // State-specific processing
             if (new_state != current_state) {
+                if (new_state == WM_STATE_NO_WEIGHT) {
+                    reset_stable_lock();
+                    if (current_state == WM_STATE_DEBOUNCE_REMOVE ||
+                        current_state == WM_STATE_MEASURING) {
+                        publish_weight(current_weight, MEAS_KIND_REMOVED);
+                    }
+                } else if (new_state == WM_STATE_MEASURING &&
+                           current_state != WM_STATE_DEBOUNCE_REMOVE) {
+                    publish_weight(current_weight, MEAS_KIND_ADDED);
+                }
+                if (current_state == WM_STATE_NO_WEIGHT || new_state == WM_STATE_NO_WEIGHT) {
+                    power_governor_set_measuring(new_state != WM_STATE_NO_WEIGHT);
+                }
                 current_state = new_state;
                 debounce_count = 0;
+                pending_change = CD_EVENT_NONE;
             }
             
-            // Log measurements when in measuring state
+            // Log measurements when in measuring state; a degraded sensor
+            // (dropped samples, overload) gives live readings but no lock
             if (current_state == WM_STATE_MEASURING) {
+                if (health != HX711_HEALTH_OK) {
+                    reset_stable_lock();
+                    publish_weight(current_weight, MEAS_KIND_LIVE);
+                } else if (update_stable_lock(current_weight, cfg)) {
+                    log_weight_event("WEIGHT_LOCKED", current_weight);
+                    publish_weight(current_weight, MEAS_KIND_LOCKED);
+                } else {
+                    publish_weight(current_weight, MEAS_KIND_LIVE);
+                }
                 if (xTaskGetTickCount() - last_measure_time >= pdMS_TO_TICKS(WM_MEASURE_INTERVAL_MS)) {
                     LOG_ROW("WeightManager", "Weight: %.2f g", current_weight);
                     last_measure_time = xTaskGetTickCount();
                 }
             }
+            scale_config_release(wm_cfg_reader);
         }
     }
 }
 
 void weight_manager_init(QueueHandle_t hx711_queue, calibration_t *calib) {
     if (!wm_queue) {
-        wm_queue = hx711_queue ? hx711_queue : xQueueCreate(8, sizeof(float));
+        wm_queue = hx711_queue ? hx711_queue
+                               : res_queue_create(RES_QUEUE_SAMPLES, 0, 8, sizeof(float));
         configASSERT(wm_queue);
         
         wm_calib = calib;
         current_state = WM_STATE_NO_WEIGHT;
+        wm_cfg_reader = scale_config_register_reader("weight_manager");
         
-        xTaskCreatePinnedToCore(
+        res_task_start(
+            RES_TASK_WEIGHT_MANAGER,
+            0,
             weight_manager_task,
-            "WeightManager",
-            4096,
-            NULL,
-            tskIDLE_PRIORITY + 2,
             NULL,
-            1  // Run on core 1
+            NULL   // Sampling core, just below the HX711 task (resources.h)
         );
         
+        scale_config_t cfg;
+        scale_config_snapshot(&cfg);
         LOG_ROW("WeightManager", "Initialized (Wake: %.1fg, Sleep: %.1fg)", 
-               WM_WAKE_THRESHOLD_G, WM_SLEEP_THRESHOLD_G);
+               cfg.wake_threshold_g, cfg.sleep_threshold_g);
     }
 }
 
@@ -185,4 +334,26 @@ QueueHandle_t weight_manager_get_queue(void) {
 
 wm_state_t weight_manager_get_state(void) {
     return current_state;
-}
\ No newline at end of file
+}
+
+float weight_manager_get_weight(void) {
+    return wm_last_weight;
+}
+
+esp_err_t weight_manager_set_threshold(float wake_threshold_g) {
+    scale_config_t cfg;
+    const char *why = NULL;
+    scale_config_snapshot(&cfg);
+    cfg.wake_threshold_g = wake_threshold_g;
+    esp_err_t err = scale_config_publish(&cfg, true, &why);
+    if (err != ESP_OK) {
+        LOG_ROW("WeightManager", "Threshold %.1f g rejected: %s", wake_threshold_g, why ? why : esp_err_to_name(err));
+    }
+    return err;
+}
+
+float weight_manager_get_threshold(void) {
+    scale_config_t cfg;
+    scale_config_snapshot(&cfg);
+    return cfg.wake_threshold_g;
+}
@@ -5,20 +5,15 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "esp_err.h"
 #include "calibration.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Weight Manager thresholds (grams)
-#ifndef WM_WAKE_THRESHOLD_G
-#define WM_WAKE_THRESHOLD_G     200.0f
-#endif
-
-#ifndef WM_SLEEP_THRESHOLD_G
-#define WM_SLEEP_THRESHOLD_G    10.0f
-#endif
+// Wake/sleep thresholds, debounce and the lock window are runtime
+// settings (scale_config_t), not compile-time macros
 
 // Active timeout in milliseconds
 #ifndef WM_ACTIVE_TIMEOUT_MS
@@ -44,12 +39,25 @@ extern "C" {
  * @param calib        Pointer to calibration_t struct for conversion
  *
  * Spawns a FreeRTOS task that:
- *  - Sleeps (no output) until weight ≥ WM_WAKE_THRESHOLD_G
+ *  - Sleeps (no output) until weight ≥ wake_threshold_g
  *  - On wake, prints weights and runs for WM_ACTIVE_TIMEOUT_MS
- *  - Returns to sleep on weight removal (< WM_SLEEP_THRESHOLD_G) or timeout
+ *  - Returns to sleep on weight removal (≤ sleep_threshold_g) or timeout
+ * Call after scale_config_init().
  */
 void weight_manager_init(QueueHandle_t hx711_queue, calibration_t *calib);
 
+/** @brief Latest calibrated weight seen by the manager (grams). */
+float weight_manager_get_weight(void);
+
+/**
+ * @brief Change the wake threshold: publishes and saves a new configuration.
+ * @return ESP_ERR_INVALID_ARG if the result fails validation
+ */
+esp_err_t weight_manager_set_threshold(float wake_threshold_g);
+
+/** @brief Current wake threshold (grams). */
+float weight_manager_get_threshold(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,11 +1,13 @@
 // File: main/wifi/wifi_comm.c
 // -----------------------------------------------------------------------------
-// Robust Wi-Fi STA implementation for ESP-IDF v5.4.1 with HTTPS JSON endpoint
+// Robust Wi-Fi STA implementation for ESP-IDF v5.4.1 with the HTTPS server
+// (routes in rest_api)
 // -----------------------------------------------------------------------------
 
 #include "wifi_comm.h"
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "esp_err.h"
 #include "esp_wifi.h"
@@ -27,8 +29,11 @@
 #include "hx711.h"            // for hx711_get_queue()
 #include "weight_manager.h"   // for weight_manager_init()
 #include "calibration.h"      // for calibration_t and g_calib
-#include "sntp_synch.h"       // for sntp_sync_start(), sntp_time_available()
+#include "sntp_synch.h"       // for sntp_sync_start()
 #include "log_utils.h"        // for LOG_ROW()
+#include "power_governor.h"   // for power_governor_tls_handshake/begin/end()
+#include "resources.h"        // for res_task_start()
+#include "rest_api.h"         // Route table, async workers
 
 extern calibration_t g_calib;    // from main.c
 
@@ -39,16 +44,15 @@ extern calibration_t g_calib;    // from main.c
 static const char *TAG = "wifi_comm";
 static EventGroupHandle_t s_wifi_event_group;
 static EventGroupHandle_t https_server_events;
-static TaskHandle_t        https_server_task_handle;
+static StaticEventGroup_t s_wifi_event_group_buf;
+static StaticEventGroup_t https_server_events_buf;
 
 static char s_target_ssid[32];
 static char s_target_pass[64];
 static bool s_scan_successful = false;
 static httpd_handle_t https_server = NULL;
 
-// HTTPS server task config
-#define HTTPS_SERVER_TASK_STACK_SIZE 8192
-#define HTTPS_SERVER_TASK_PRIORITY   5
+// HTTPS server tasks: stacks, cores and priorities are in resources.h
 #define SERVER_RESTART_DELAY_MS      5000
 
 // Server control bits
@@ -68,7 +72,28 @@ static void     wifi_scan_task(void *arg);
 static void     wifi_connect_task(void *arg);
 static void     https_server_monitor(void *arg);
 static void     start_https_server_task(void *pvParameters);
-static esp_err_t weight_get_handler(httpd_req_t *req);
+/** Keep the CPU boosted while TLS sessions are open */
+static void https_session_cb(esp_https_server_user_cb_arg_t *arg)
+{
+    if (arg->user_cb_state == HTTPD_SSL_USER_CB_SESS_CREATE) {
+        power_governor_tls_begin();
+    } else if (arg->user_cb_state == HTTPD_SSL_USER_CB_SESS_CLOSE) {
+        power_governor_tls_end();
+    }
+}
+
+
+/**
+ * Boost from the ClientHello on: the session callback above only fires
+ * once the handshake, the expensive part, is already done
+ */
+static int https_client_hello_cb(mbedtls_ssl_context *ssl)
+{
+    (void)ssl;
+    power_governor_tls_handshake();
+    return 0;   // Keep the configured certificate
+}
+
 static void     start_https_server(void);
 static void     stop_https_server(void);
 
@@ -94,8 +119,10 @@ esp_err_t wifi_comm_start(const char *ssid, const char *password)
         IP_EVENT, IP_EVENT_STA_GOT_IP, wifi_event_handler, NULL, NULL));
 
     // Create event groups
-    s_wifi_event_group    = xEventGroupCreate();
-    https_server_events   = xEventGroupCreate();
+    s_wifi_event_group    = xEventGroupCreateStatic(&s_wifi_event_group_buf);
+    if (!https_server_events) {
+        https_server_events = xEventGroupCreateStatic(&https_server_events_buf);
+    }
 
     // Start Wi-Fi
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
@@ -108,10 +135,11 @@ esp_err_t wifi_comm_start(const char *ssid, const char *password)
                         portMAX_DELAY);
 
     // Launch scan, connect, and HTTPS server tasks
-    xTaskCreatePinnedToCore(wifi_scan_task, "wifi_scan", 4096, NULL, 4, NULL, 1);
-    xTaskCreatePinnedToCore(wifi_connect_task, "wifi_conn", 4096, NULL, 4, NULL, 1);
-    xTaskCreate(https_server_monitor,    "https_monitor", 4096, NULL, HTTPS_SERVER_TASK_PRIORITY-1, NULL);
-    xTaskCreate(start_https_server_task, "https_server",  HTTPS_SERVER_TASK_STACK_SIZE, NULL, HTTPS_SERVER_TASK_PRIORITY, &https_server_task_handle);
+    // Core and priority come from the scheduling plan (resources.h)
+    res_task_start(RES_TASK_WIFI_SCAN, 0, wifi_scan_task, NULL, NULL);
+    res_task_start(RES_TASK_WIFI_CONN, 0, wifi_connect_task, NULL, NULL);
+    res_task_start(RES_TASK_HTTPS_MONITOR, 0, https_server_monitor, NULL, NULL);
+    res_task_start(RES_TASK_HTTPS_SERVER, 0, start_https_server_task, NULL, NULL);
 
     return ESP_OK;
 }
@@ -144,17 +172,11 @@ static void wifi_event_handler(void *arg, esp_event_base_t base,
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) data;
         LOG_ROW(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
 
-        // SNTP sync
+        // SNTP sync runs in the background; samples are stamped in the
+        // monotonic domain and mapped to wall-clock time when it lands
         sntp_sync_start();
-        if (sntp_time_available(pdMS_TO_TICKS(10000))) {
-            LOG_ROW(TAG, "SNTP time synchronised");
-        } else {
-            LOG_ROW(TAG, "SNTP sync timeout, continuing");
-        }
-
-        // Modem-sleep power save
-        esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
 
+        // Modem sleep is configured by the power governor
         // Start HTTPS server and weight manager
         start_https_server();
         weight_manager_init(hx711_get_queue(), &g_calib);
@@ -185,7 +207,7 @@ static void wifi_scan_task(void *arg)
     ESP_ERROR_CHECK(esp_wifi_scan_get_ap_num(&ap_count));
     if (ap_count == 0) {
         LOG_ROW(TAG, "Target SSID not found");
-        vTaskDelete(NULL);
+        res_task_exit(RES_TASK_WIFI_SCAN, 0);
     }
 
     wifi_ap_record_t ap;
@@ -194,7 +216,7 @@ static void wifi_scan_task(void *arg)
         LOG_ROW(TAG, "Found '%s', RSSI %d", s_target_ssid, ap.rssi);
         s_scan_successful = true;
     }
-    vTaskDelete(NULL);
+    res_task_exit(RES_TASK_WIFI_SCAN, 0);
 }
 
 static void wifi_connect_task(void *arg)
@@ -215,21 +237,7 @@ static void wifi_connect_task(void *arg)
 
     xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT,
                         pdFALSE, pdTRUE, portMAX_DELAY);
-    vTaskDelete(NULL);
-}
-
-static esp_err_t weight_get_handler(httpd_req_t *req)
-{
-    float weight;
-    if (xQueueReceive(hx711_get_queue(), &weight, 0) == pdPASS) {
-        char json[64];
-        int len = snprintf(json, sizeof(json), "{\"weight\":%.2f}", weight);
-        httpd_resp_set_type(req, "application/json");
-        httpd_resp_send(req, json, len);
-    } else {
-        httpd_resp_send_500(req);
-    }
-    return ESP_OK;
+    res_task_exit(RES_TASK_WIFI_CONN, 0);
 }
 
 static void https_server_monitor(void *arg)
@@ -311,12 +319,15 @@ static void start_https_server_task(void *pvParameters)
         conf.prvtkey_len = server_private_key_len;
         conf.httpd.server_port      = 8095;
         conf.httpd.stack_size       = 10240;
-        conf.httpd.lru_purge_enable = true;
-        conf.httpd.max_open_sockets = 6;
         conf.httpd.ctrl_port        = 32768;
+        rest_api_tune(&conf.httpd);                       // Sockets, keep-alive, handlers
+        conf.httpd.core_id          = RES_CORE_NET;       // Keep TLS off the sampling core
+        conf.httpd.task_priority    = RES_PRIO_HTTPS;
         conf.transport_mode         = HTTPD_SSL_TRANSPORT_SECURE;
         conf.port_insecure          = 0;
         conf.session_tickets        = false;
+        conf.user_cb                = https_session_cb;
+        conf.cert_select_cb         = https_client_hello_cb;   // CONFIG_ESP_TLS_SERVER_CERT_SELECT_HOOK
 
         esp_err_t ret = httpd_ssl_start(&https_server, &conf);
         if (ret != ESP_OK) {
@@ -325,14 +336,12 @@ static void start_https_server_task(void *pvParameters)
             continue;
         }
 
-        // 5) Register URI handler
-        httpd_uri_t uri = {
-            .uri      = "/weight",
-            .method   = HTTP_GET,
-            .handler  = weight_get_handler,
-            .user_ctx = NULL
-        };
-        httpd_register_uri_handler(https_server, &uri);
+        // 5) Every endpoint comes from the rest_api route table
+        if (rest_api_register(https_server) != ESP_OK) {
+            stop_https_server();
+            xEventGroupSetBits(https_server_events, SERVER_ERROR_BIT);
+            continue;
+        }
 
         ESP_LOGI(TAG, "✅ HTTPS server started on port %d", conf.httpd.server_port);
 
@@ -344,6 +353,11 @@ static void start_https_server_task(void *pvParameters)
     }
 }
 
+bool https_server_is_running(void)
+{
+    return https_server != NULL;
+}
+
 bool wifi_is_connected(void)
 {
     return (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
@@ -352,6 +366,13 @@ bool wifi_is_connected(void)
 void wifi_comm_stop(void)
 {
     stop_https_server();
+
+    // Tasks first: they block on the event groups deleted below
+    res_task_stop(RES_TASK_HTTPS_SERVER, 0);
+    res_task_stop(RES_TASK_HTTPS_MONITOR, 0);
+    res_task_stop(RES_TASK_WIFI_CONN, 0);
+    res_task_stop(RES_TASK_WIFI_SCAN, 0);
+
     esp_wifi_disconnect();
     esp_wifi_stop();
     esp_wifi_deinit();
@@ -364,52 +385,27 @@ void wifi_comm_stop(void)
         vEventGroupDelete(https_server_events);
         https_server_events = NULL;
     }
-    if (https_server_task_handle) {
-        vTaskDelete(https_server_task_handle);
-        https_server_task_handle = NULL;
-    }
 }
 
 void init_https_server(void) {
     // Create event group for server control if it doesn't exist
     if (https_server_events == NULL) {
-        https_server_events = xEventGroupCreate();
-        if (https_server_events == NULL) {
-            ESP_LOGE(TAG, "Failed to create HTTPS server event group");
-            return;
-        }
+        https_server_events = xEventGroupCreateStatic(&https_server_events_buf);
     }
 
-    // Create server monitor task if it doesn't exist
-    if (https_server_task_handle == NULL) {
-        BaseType_t ret = xTaskCreate(
-            start_https_server_task,
-            "https_server",
-            HTTPS_SERVER_TASK_STACK_SIZE,
-            NULL,
-            HTTPS_SERVER_TASK_PRIORITY,
-            &https_server_task_handle
-        );
-
-        if (ret != pdPASS) {
-            ESP_LOGE(TAG, "Failed to create HTTPS server task");
-            vEventGroupDelete(https_server_events);
-            https_server_events = NULL;
-            return;
-        }
+    // Server and monitor tasks each own one reserved slot, so calling this
+    // again (e.g. from a restart check) never adds a second instance
+    if (!res_task_start(RES_TASK_HTTPS_SERVER, 0, start_https_server_task, NULL, NULL)) {
+        ESP_LOGE(TAG, "Failed to create HTTPS server task");
+        return;
     }
-
-    // Create server monitor task
-    TaskHandle_t monitor_handle;
-    if (xTaskCreate(
-            https_server_monitor,
-            "https_monitor",
-            8192,
-            NULL,
-            HTTPS_SERVER_TASK_PRIORITY-1,
-            &monitor_handle) != pdPASS) {
+    if (!res_task_start(RES_TASK_HTTPS_MONITOR, 0, https_server_monitor, NULL, NULL)) {
         ESP_LOGE(TAG, "Failed to create HTTPS monitor task");
     }
 
+    if (!https_server) {
+        start_https_server();
+    }
+
     ESP_LOGI(TAG, "HTTPS server components initialized");
-}
\ No newline at end of file
+}
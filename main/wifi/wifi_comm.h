@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "esp_err.h"
+#include "app_connection_manager.h"   // measurement_t
 /**
  * @brief Initialise Wi‑Fi in STA mode, scan for APs, connect to the given
  *        SSID/password, and (optionally) start the TCP‑echo server.
@@ -26,8 +27,15 @@ bool wifi_is_connected(void);
  */
 int wifi_send_data(const char *data, size_t len);
 
+/**
+ * @brief Start the HTTPS server (the only HTTP server; routes in rest_api).
+ *        Safe to call again: restarts it only if it is not running.
+ */
 void init_https_server(void);
 
+/** @brief True while the HTTPS server instance is up. */
+bool https_server_is_running(void);
+
 void wifi_comm_stop(void);
 
 #endif /* WIFI_COMM_H */
@@ -15,9 +15,8 @@
 // Tag for logging
 static const char *TAG = "Wi-Fi Power Management";
 
-// Global BLE connection handle.
-// This should be maintained by your BLE module.
-uint16_t current_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+// Global BLE connection handle, maintained by bluetooth_comm_gatt.c
+extern uint16_t current_conn_handle;
 
 // Define BLE connection update parameters for low-power operation.
 // Note: Use the structure 'ble_gap_upd_params' as required by ble_gap_update_params().
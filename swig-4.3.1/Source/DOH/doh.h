@@ -37,6 +37,7 @@
 
 #define DohCheck           DOH_NAMESPACE(Check)
 #define DohIntern          DOH_NAMESPACE(Intern)
+#define DohInternKey       DOH_NAMESPACE(InternKey)
 #define DohDelete          DOH_NAMESPACE(Delete)
 #define DohCopy            DOH_NAMESPACE(Copy)
 #define DohClear           DOH_NAMESPACE(Clear)
@@ -180,6 +181,7 @@ extern void *DohCalloc(size_t n, size_t size);
 
 extern int DohCheck(const DOH *ptr);	/* Check if a DOH object */
 extern void DohIntern(DOH *);	/* Intern an object      */
+extern DOH *DohInternKey(const char *name);	/* Interned String used for key 'name' */
 
 /* Basic object methods.  Common to most objects */
 
@@ -374,10 +376,19 @@ extern void DohMemoryDebug(void);
 #define Clear              DohClear
 #define Str                DohStr
 #define Dump               DohDump
-#define Getattr            DohGetattr
-#define Setattr            DohSetattr
-#define Delattr            DohDelattr
-#define Checkattr          DohCheckattr
+
+/* Keys given as string literals are interned once per call site rather than
+   looked up by name on every call (GCC and compatible compilers). */
+#if defined(__GNUC__) && !defined(DOH_NO_KEY_CACHE)
+#define DohKey(k)          (__builtin_constant_p(k) ? __extension__ ({ static DOH *doh_key_ = 0; doh_key_ ? doh_key_ : (doh_key_ = DohInternKey((const char *) (k))); }) : (const DOH *) (k))
+#else
+#define DohKey(k)          (k)
+#endif
+
+#define Getattr(o,k)       DohGetattr(o,DohKey(k))
+#define Setattr(o,k,v)     DohSetattr(o,DohKey(k),v)
+#define Delattr(o,k)       DohDelattr(o,DohKey(k))
+#define Checkattr(o,k,v)   DohCheckattr(o,DohKey(k),v)
 #define Hashval            DohHashval
 #define Getitem            DohGetitem
 #define Setitem            DohSetitem
@@ -414,20 +425,20 @@ extern void DohMemoryDebug(void);
 /* #define StringEqual        DohStringEqual */
 
 #define vPrintf            DohvPrintf
-#define GetInt             DohGetInt
-#define GetDouble          DohGetDouble
-#define GetChar            DohGetChar
-#define GetVoid            DohGetVoid
-#define GetFlagAttr        DohGetFlagAttr
-#define GetFlag            DohGetFlag
-#define SetInt             DohSetInt
-#define SetDouble          DohSetDouble
-#define SetChar            DohSetattr
-#define SetVoid            DohSetVoid
-#define SetFlagAttr        DohSetFlagAttr
-#define SetFlag            DohSetFlag
-#define UnsetFlag(o,n)     DohSetFlagAttr(o,n,NULL)
-#define ClearFlag(o,n)     DohSetFlagAttr(o,n,"")
+#define GetInt(o,k)        DohGetInt(o,DohKey(k))
+#define GetDouble(o,k)     DohGetDouble(o,DohKey(k))
+#define GetChar(o,k)       DohGetChar(o,DohKey(k))
+#define GetVoid(o,k)       DohGetVoid(o,DohKey(k))
+#define GetFlagAttr(o,k)   DohGetFlagAttr(o,DohKey(k))
+#define GetFlag(o,k)       DohGetFlag(o,DohKey(k))
+#define SetInt(o,k,v)      DohSetInt(o,DohKey(k),v)
+#define SetDouble(o,k,v)   DohSetDouble(o,DohKey(k),v)
+#define SetChar(o,k,v)     DohSetattr(o,DohKey(k),v)
+#define SetVoid(o,k,v)     DohSetVoid(o,DohKey(k),v)
+#define SetFlagAttr(o,k,a) DohSetFlagAttr(o,DohKey(k),a)
+#define SetFlag(o,k)       DohSetFlag(o,DohKey(k))
+#define UnsetFlag(o,k)     DohSetFlagAttr(o,DohKey(k),NULL)
+#define ClearFlag(o,k)     DohSetFlagAttr(o,DohKey(k),"")
 #define Readline           DohReadline
 #define Replace            DohReplace
 #define Chop               DohChop
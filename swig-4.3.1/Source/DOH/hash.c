@@ -15,90 +15,242 @@
 
 extern DohObjInfo DohHashType;
 
-/* Hash node */
-typedef struct HashNode {
+/* Hash entry.  Entries are kept in insertion order, which is also the
+   iteration order.  A deleted entry has key == 0 until the table is next
+   compacted. */
+typedef struct HashEntry {
   DOH *key;
   DOH *object;
-  struct HashNode *next;
-} HashNode;
+} HashEntry;
+
+/* Hash object.  The first HASH_INLINE_SIZE entries live in the object
+   itself, later ones in one block holding the entries followed by the
+   cached hash value of each key.  Up to HASH_SMALL_MAX entries a lookup
+   is a linear scan of the hash values; bigger tables add an open
+   addressing index (linear probing) of entry positions. */
+
+#define HASH_INLINE_SIZE 4
+#define HASH_SMALL_MAX   8
 
-/* Hash object */
 typedef struct Hash {
   DOH *file;
   int line;
-  HashNode **hashtable;
-  int hashsize;
-  int nitems;
+  int nitems;			/* Live entries */
+  int nused;			/* Entries in use, including deleted ones */
+  int capacity;			/* Size of entries */
+  HashEntry *entries;
+  unsigned int *hashvals;	/* Hashval() of each entry's key */
+  int *index;			/* Entry position + 1 per slot, 0 if empty.  Null in small mode */
+  int indexbits;		/* log2 of the index size */
+  HashEntry inline_entries[HASH_INLINE_SIZE];
+  unsigned int inline_hashvals[HASH_INLINE_SIZE];
 } Hash;
 
-/* Key interning structure */
+/* Key interning structure.  Every C string used as a key maps to one
+   interned String, so keys given as C strings compare by pointer in the
+   tables.  The interned keys are found through an open addressing table
+   (linear probing, at most half full). */
 typedef struct KeyValue {
   char *cstr;
   DOH *sstr;
-  struct KeyValue *left;
-  struct KeyValue *right;
+  unsigned int chash;		/* key_hash(cstr) */
 } KeyValue;
 
-static KeyValue *root = 0;
+#define KEYS_INIT_BITS 10
+
+static KeyValue **keys = 0;
+static int keys_bits = 0;
+static int keys_count = 0;
 static int max_expand = 1;
 
+/* FNV-1a */
+static unsigned int key_hash(const char *c) {
+  unsigned int h = 2166136261u;
+  while (*c) {
+    h ^= (unsigned char) *(c++);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static void keys_insert(KeyValue *kv) {
+  unsigned int mask = (1u << keys_bits) - 1;
+  unsigned int slot = kv->chash & mask;
+  while (keys[slot])
+    slot = (slot + 1) & mask;
+  keys[slot] = kv;
+}
+
 /* Find or create a key in the interned key table */
 static DOH *find_key(DOH *doh_c) {
-  char *c = (char *) doh_c;
-  KeyValue *r, *s;
-  int d = 0;
-  /* OK, sure, we use a binary tree for maintaining interned
-     symbols.  Then we use their hash values for accessing secondary
-     hash tables. */
-  r = root;
-  s = 0;
-  while (r) {
-    s = r;
-    d = strcmp(r->cstr, c);
-    if (d == 0)
-      return r->sstr;
-    if (d < 0)
-      r = r->left;
-    else
-      r = r->right;
+  const char *c = (const char *) doh_c;
+  unsigned int h = key_hash(c);
+  unsigned int mask = (1u << keys_bits) - 1;
+  unsigned int slot = h & mask;
+  KeyValue *kv;
+
+  if (keys) {
+    while ((kv = keys[slot]) != 0) {
+      if (kv->chash == h && strcmp(kv->cstr, c) == 0)
+	return kv->sstr;
+      slot = (slot + 1) & mask;
+    }
   }
   /*  fprintf(stderr,"Interning '%s'\n", c); */
-  r = (KeyValue *) DohMalloc(sizeof(KeyValue));
-  r->cstr = (char *) DohMalloc(strlen(c) + 1);
-  strcpy(r->cstr, c);
-  r->sstr = NewString(c);
-  DohIntern(r->sstr);
-  r->left = 0;
-  r->right = 0;
-  if (!s) {
-    root = r;
+  if (2 * (keys_count + 1) > (1 << keys_bits)) {
+    KeyValue **old = keys;
+    int i, oldsize = old ? 1 << keys_bits : 0;
+    keys_bits = old ? keys_bits + 1 : KEYS_INIT_BITS;
+    keys = (KeyValue **) DohCalloc((size_t)1 << keys_bits, sizeof(KeyValue *));
+    for (i = 0; i < oldsize; i++) {
+      if (old[i])
+	keys_insert(old[i]);
+    }
+    DohFree(old);
+  }
+  kv = (KeyValue *) DohMalloc(sizeof(KeyValue));
+  kv->cstr = (char *) DohMalloc(strlen(c) + 1);
+  strcpy(kv->cstr, c);
+  kv->sstr = NewString(c);
+  DohIntern(kv->sstr);
+  kv->chash = h;
+  keys_insert(kv);
+  keys_count++;
+  return kv->sstr;
+}
+
+/* -----------------------------------------------------------------------------
+ * DohInternKey()
+ *
+ * Return the interned String for a key given as a C string.
+ * ----------------------------------------------------------------------------- */
+
+DOH *DohInternKey(const char *name) {
+  return find_key((DOH *) name);
+}
+
+/* Index slot for a hash value (Fibonacci hashing spreads weak hashes) */
+#define HASH_SLOT(h, hv) ((unsigned int)((hv) * 2654435769u) >> (32 - (h)->indexbits))
+
+/* Does entry e (whose key has the same hash value) hold key k?  Keys of
+   different types never match. */
+static int key_matches(const HashEntry *e, DOH *k) {
+  DohBase *ek = (DohBase *) e->key;
+  DohObjInfo *k_type;
+  if (ek == (DohBase *) k)
+    return 1;
+  if (!ek)
+    return 0;
+  k_type = ((DohBase *) k)->type;
+  if (ek->type != k_type)
+    return 0;
+  return k_type->doh_equal ? k_type->doh_equal(k, ek) : (k_type->doh_cmp(k, ek) == 0);
+}
+
+/* Position of the entry for key k, or -1 */
+static int find_entry(Hash *h, DOH *k, unsigned int hv) {
+  int i;
+  if (!h->index) {
+    for (i = 0; i < h->nused; i++) {
+      if (h->hashvals[i] == hv && key_matches(&h->entries[i], k))
+	return i;
+    }
   } else {
-    if (d < 0)
-      s->left = r;
-    else
-      s->right = r;
+    unsigned int mask = (1u << h->indexbits) - 1;
+    unsigned int slot = HASH_SLOT(h, hv);
+    while ((i = h->index[slot]) != 0) {
+      if (h->hashvals[i - 1] == hv && key_matches(&h->entries[i - 1], k))
+	return i - 1;
+      slot = (slot + 1) & mask;
+    }
   }
-  return r->sstr;
+  return -1;
 }
 
-#define HASH_INIT_SIZE   7
+static void index_insert(Hash *h, int pos) {
+  unsigned int mask = (1u << h->indexbits) - 1;
+  unsigned int slot = HASH_SLOT(h, h->hashvals[pos]);
+  while (h->index[slot])
+    slot = (slot + 1) & mask;
+  h->index[slot] = pos + 1;
+}
+
+/* Entry block for a table of the given capacity */
+static void new_entries(Hash *h, int capacity) {
+  if (capacity == HASH_INLINE_SIZE) {
+    h->entries = h->inline_entries;
+    h->hashvals = h->inline_hashvals;
+  } else {
+    h->entries = (HashEntry *) DohMalloc(capacity * (sizeof(HashEntry) + sizeof(unsigned int)));
+    h->hashvals = (unsigned int *) (h->entries + capacity);
+  }
+  h->capacity = capacity;
+}
+
+/* Compact the live entries into a table of the given capacity and
+   rebuild the index (at most half full) if the table is too big for a
+   linear scan */
+static void rebuild(Hash *h, int capacity) {
+  HashEntry *old = h->entries;
+  unsigned int *oldhv = h->hashvals;
+  int i, n = 0;
+
+  if (capacity != h->capacity)
+    new_entries(h, capacity);
+  for (i = 0; i < h->nused; i++) {
+    if (old[i].key) {
+      h->entries[n] = old[i];
+      h->hashvals[n] = oldhv[i];
+      n++;
+    }
+  }
+  if (old != h->entries && old != h->inline_entries)
+    DohFree(old);
+  h->nused = n;
+
+  if (capacity > HASH_SMALL_MAX) {
+    int bits = 1;
+    while ((1 << bits) < 2 * capacity)
+      bits++;
+    if (bits != h->indexbits || !h->index) {
+      DohFree(h->index);
+      h->index = (int *) DohMalloc(sizeof(int) << bits);
+      h->indexbits = bits;
+    }
+    memset(h->index, 0, sizeof(int) << bits);
+    for (i = 0; i < n; i++)
+      index_insert(h, i);
+  } else if (h->index) {
+    DohFree(h->index);
+    h->index = 0;
+    h->indexbits = 0;
+  }
+}
 
-/* Create a new hash node */
-static HashNode *NewNode(DOH *k, void *obj) {
-  HashNode *hn = (HashNode *) DohMalloc(sizeof(HashNode));
-  hn->key = k;
-  Incref(hn->key);
-  hn->object = obj;
+/* Append a new entry, growing the table (or dropping deleted entries)
+   when it is full */
+static void add_entry(Hash *h, DOH *k, DOH *obj, unsigned int hv) {
+  HashEntry *e;
+  if (h->nused == h->capacity)
+    rebuild(h, 2 * h->nitems < h->capacity ? h->capacity : 2 * h->capacity);
+  e = &h->entries[h->nused];
+  e->key = k;
+  Incref(k);
+  e->object = obj;
   Incref(obj);
-  hn->next = 0;
-  return hn;
+  h->hashvals[h->nused] = hv;
+  if (h->index)
+    index_insert(h, h->nused);
+  h->nused++;
+  h->nitems++;
 }
 
-/* Delete a hash node */
-static void DelNode(HashNode *hn) {
-  Delete(hn->key);
-  Delete(hn->object);
-  DohFree(hn);
+/* Release the key and object of an entry */
+static void clear_entry(HashEntry *e) {
+  Delete(e->key);
+  Delete(e->object);
+  e->key = 0;
+  e->object = 0;
 }
 
 /* -----------------------------------------------------------------------------
@@ -109,20 +261,18 @@ static void DelNode(HashNode *hn) {
 
 static void DelHash(DOH *ho) {
   Hash *h = (Hash *) ObjData(ho);
-  HashNode *n, *next;
   int i;
 
-  for (i = 0; i < h->hashsize; i++) {
-    n = h->hashtable[i];
-    while (n) {
-      next = n->next;
-      DelNode(n);
-      n = next;
-    }
+  for (i = 0; i < h->nused; i++) {
+    if (h->entries[i].key)
+      clear_entry(&h->entries[i]);
   }
-  DohFree(h->hashtable);
-  h->hashtable = 0;
-  h->hashsize = 0;
+  if (h->entries != h->inline_entries)
+    DohFree(h->entries);
+  DohFree(h->index);
+  h->entries = 0;
+  h->hashvals = 0;
+  h->index = 0;
   DohFree(h);
 }
 
@@ -135,63 +285,18 @@ static void DelHash(DOH *ho) {
 
 static void Hash_clear(DOH *ho) {
   Hash *h = (Hash *) ObjData(ho);
-  HashNode *n, *next;
   int i;
 
-  for (i = 0; i < h->hashsize; i++) {
-    n = h->hashtable[i];
-    while (n) {
-      next = n->next;
-      DelNode(n);
-      n = next;
-    }
-    h->hashtable[i] = 0;
+  for (i = 0; i < h->nused; i++) {
+    if (h->entries[i].key)
+      clear_entry(&h->entries[i]);
   }
+  if (h->index)
+    memset(h->index, 0, sizeof(int) << h->indexbits);
+  h->nused = 0;
   h->nitems = 0;
 }
 
-/* resize the hash table */
-static void resize(Hash *h) {
-  HashNode *n, *next, **table;
-  int oldsize, newsize;
-  int i, p, hv;
-
-  if (h->nitems < 2 * h->hashsize)
-    return;
-
-  /* Too big. We have to rescale everything now */
-  oldsize = h->hashsize;
-
-  /* Calculate a new size */
-  newsize = 2 * oldsize + 1;
-  p = 3;
-  while (p < (newsize >> 1)) {
-    if (((newsize / p) * p) == newsize) {
-      newsize += 2;
-      p = 3;
-      continue;
-    }
-    p = p + 2;
-  }
-
-  table = (HashNode **) DohCalloc(newsize, sizeof(HashNode *));
-
-  /* Walk down the old set of nodes and re-place */
-  h->hashsize = newsize;
-  for (i = 0; i < oldsize; i++) {
-    n = h->hashtable[i];
-    while (n) {
-      hv = Hashval(n->key) % newsize;
-      next = n->next;
-      n->next = table[hv];
-      table[hv] = n;
-      n = next;
-    }
-  }
-  DohFree(h->hashtable);
-  h->hashtable = table;
-}
-
 /* -----------------------------------------------------------------------------
  * Hash_setattr()
  *
@@ -200,8 +305,9 @@ static void resize(Hash *h) {
  * ----------------------------------------------------------------------------- */
 
 static int Hash_setattr(DOH *ho, DOH *k, DOH *obj) {
-  int hv;
-  HashNode *n, *prev;
+  unsigned int hv;
+  int i;
+  HashEntry *e;
   Hash *h = (Hash *) ObjData(ho);
 
   if (!obj) {
@@ -213,33 +319,22 @@ static int Hash_setattr(DOH *ho, DOH *k, DOH *obj) {
     obj = NewString((char *) obj);
     Decref(obj);
   }
-  hv = (Hashval(k)) % h->hashsize;
-  n = h->hashtable[hv];
-  prev = 0;
-  while (n) {
-    if (Cmp(n->key, k) == 0) {
-      /* Node already exists.  Just replace its contents */
-      if (n->object == obj) {
-	/* Whoa. Same object.  Do nothing */
-	return 1;
-      }
-      Delete(n->object);
-      n->object = obj;
-      Incref(obj);
-      return 1;			/* Return 1 to indicate a replacement */
-    } else {
-      prev = n;
-      n = n->next;
+  hv = (unsigned int) Hashval(k);
+  i = find_entry(h, k, hv);
+  if (i >= 0) {
+    /* Entry already exists.  Just replace its contents */
+    e = &h->entries[i];
+    if (e->object == obj) {
+      /* Whoa. Same object.  Do nothing */
+      return 1;
     }
+    Delete(e->object);
+    e->object = obj;
+    Incref(obj);
+    return 1;			/* Return 1 to indicate a replacement */
   }
   /* Add this to the table */
-  n = NewNode(k, obj);
-  if (prev)
-    prev->next = n;
-  else
-    h->hashtable[hv] = n;
-  h->nitems++;
-  resize(h);
+  add_entry(h, k, obj, hv);
   return 0;
 }
 
@@ -248,32 +343,12 @@ static int Hash_setattr(DOH *ho, DOH *k, DOH *obj) {
  *
  * Get an attribute from the hash table. Returns 0 if it doesn't exist.
  * ----------------------------------------------------------------------------- */
-typedef int (*binop) (DOH *obj1, DOH *obj2);
-
 
 static DOH *Hash_getattr(DOH *h, DOH *k) {
-  DOH *obj = 0;
   Hash *ho = (Hash *) ObjData(h);
   DOH *ko = DohCheck(k) ? k : find_key(k);
-  int hv = Hashval(ko) % ho->hashsize;
-  DohObjInfo *k_type = ((DohBase*)ko)->type;
-  HashNode *n = ho->hashtable[hv];
-  if (k_type->doh_equal) {
-    binop equal = k_type->doh_equal;
-    while (n) {
-      DohBase *nk = (DohBase *)n->key;
-      if ((k_type == nk->type) && equal(ko, nk)) obj = n->object;
-      n = n->next;
-    }
-  } else {
-    binop cmp = k_type->doh_cmp;
-    while (n) {
-      DohBase *nk = (DohBase *)n->key;
-      if ((k_type == nk->type) && (cmp(ko, nk) == 0)) obj = n->object;
-      n = n->next;
-    }
-  }
-  return obj;
+  int i = find_entry(ho, ko, (unsigned int) Hashval(ko));
+  return i >= 0 ? ho->entries[i].object : 0;
 }
 
 /* -----------------------------------------------------------------------------
@@ -283,81 +358,76 @@ static DOH *Hash_getattr(DOH *h, DOH *k) {
  * ----------------------------------------------------------------------------- */
 
 static int Hash_delattr(DOH *ho, DOH *k) {
-  HashNode *n, *prev;
-  int hv;
+  int i;
   Hash *h = (Hash *) ObjData(ho);
 
   if (!DohCheck(k))
     k = find_key(k);
-  hv = Hashval(k) % h->hashsize;
-  n = h->hashtable[hv];
-  prev = 0;
-  while (n) {
-    if (Cmp(n->key, k) == 0) {
-      /* Found it, kill it */
-
-      if (prev) {
-	prev->next = n->next;
-      } else {
-	h->hashtable[hv] = n->next;
-      }
-      DelNode(n);
-      h->nitems--;
-      return 1;
-    }
-    prev = n;
-    n = n->next;
+  i = find_entry(h, k, (unsigned int) Hashval(k));
+  if (i < 0)
+    return 0;
+
+  /* Found it, kill it.  The entry stays as a hole (so positions held by
+     iterators and the index remain valid) until the table is compacted */
+  clear_entry(&h->entries[i]);
+  h->nitems--;
+  if (!h->index) {
+    while (h->nused > 0 && !h->entries[h->nused - 1].key)
+      h->nused--;
   }
-  return 0;
+  return 1;
 }
 
-static DohIterator Hash_firstiter(DOH *ho) {
-  DohIterator iter;
-  Hash *h = (Hash *) ObjData(ho);
-  iter.object = ho;
-  iter._current = 0;
-  iter.item = 0;
-  iter.key = 0;
-  iter._index = 0;		/* Index in hash table */
-  while ((iter._index < h->hashsize) && !h->hashtable[iter._index])
-    iter._index++;
-
-  if (iter._index >= h->hashsize) {
-    return iter;
-  }
-  iter._current = h->hashtable[iter._index];
-  iter.item = ((HashNode *) iter._current)->object;
-  iter.key = ((HashNode *) iter._current)->key;
-
-  /* Actually save the next slot in the hash.  This makes it possible to
-     delete the item being iterated over without trashing the universe */
-  iter._current = ((HashNode *) iter._current)->next;
-  return iter;
+/* Iteration walks the entries in insertion order.  The iterator holds the
+   next live entry: _index is its position and _current its key.  Deleting
+   the item being iterated over (or any other but the next) is safe, and
+   when adding an item compacts the table the next entry is found again
+   by its key, as entries only ever move towards the front. */
+
+/* Position of the first live entry at or after pos */
+static int next_live(Hash *h, int pos) {
+  while (pos < h->nused && !h->entries[pos].key)
+    pos++;
+  return pos;
 }
 
 static DohIterator Hash_nextiter(DohIterator iter) {
   Hash *h = (Hash *) ObjData(iter.object);
+  int i = iter._index;
+
   if (!iter._current) {
-    iter._index++;
-    while ((iter._index < h->hashsize) && !h->hashtable[iter._index]) {
-      iter._index++;
-    }
-    if (iter._index >= h->hashsize) {
-      iter.item = 0;
-      iter.key = 0;
-      iter._current = 0;
-      return iter;
-    }
-    iter._current = h->hashtable[iter._index];
+    i = next_live(h, i);	/* Items added after the end was reached */
+  } else if (i >= h->nused || h->entries[i].key != iter._current) {
+    /* Moved by a compaction, or deleted: then carry on from its position */
+    int j = i < h->nused ? i : h->nused;
+    while (--j >= 0 && h->entries[j].key != iter._current);
+    i = j >= 0 ? j : next_live(h, i);
   }
-  iter.key = ((HashNode *) iter._current)->key;
-  iter.item = ((HashNode *) iter._current)->object;
-
-  /* Store the next node to iterator on */
-  iter._current = ((HashNode *) iter._current)->next;
+  if (i >= h->nused) {
+    iter.item = 0;
+    iter.key = 0;
+    iter._current = 0;
+    iter._index = h->nused;
+    return iter;
+  }
+  iter.key = h->entries[i].key;
+  iter.item = h->entries[i].object;
+  iter._index = next_live(h, i + 1);
+  iter._current = iter._index < h->nused ? h->entries[iter._index].key : 0;
   return iter;
 }
 
+static DohIterator Hash_firstiter(DOH *ho) {
+  DohIterator iter;
+  Hash *h = (Hash *) ObjData(ho);
+  iter.object = ho;
+  iter.item = 0;
+  iter.key = 0;
+  iter._index = next_live(h, 0);
+  iter._current = iter._index < h->nused ? h->entries[iter._index].key : 0;
+  return Hash_nextiter(iter);
+}
+
 /* -----------------------------------------------------------------------------
  * Hash_keys()
  *
@@ -403,7 +473,7 @@ int DohGetMaxHashExpand(void) {
 
 static DOH *Hash_str(DOH *ho) {
   int i, j;
-  HashNode *n;
+  HashEntry *e;
   DOH *s;
   static int expanded = 0;
   static const char *tab = "  ";
@@ -417,28 +487,23 @@ static DOH *Hash_str(DOH *ho) {
   if (expanded >= max_expand) {
     /* replace each hash attribute with a '.' */
     Printf(s, "Hash(%p) {", ho);
-    for (i = 0; i < h->hashsize; i++) {
-      n = h->hashtable[i];
-      while (n) {
-	Putc('.', s);
-	n = n->next;
-      }
+    for (i = 0; i < h->nitems; i++) {
+      Putc('.', s);
     }
     Putc('}', s);
     return s;
   }
   ObjSetMark(ho, 1);
   Printf(s, "Hash(%p) {\n", ho);
-  for (i = 0; i < h->hashsize; i++) {
-    n = h->hashtable[i];
-    while (n) {
-      for (j = 0; j < expanded + 1; j++)
-	Printf(s, tab);
-      expanded += 1;
-      Printf(s, "'%s' : %s, \n", n->key, n->object);
-      expanded -= 1;
-      n = n->next;
-    }
+  for (i = 0; i < h->nused; i++) {
+    e = &h->entries[i];
+    if (!e->key)
+      continue;
+    for (j = 0; j < expanded + 1; j++)
+      Printf(s, tab);
+    expanded += 1;
+    Printf(s, "'%s' : %s, \n", e->key, e->object);
+    expanded -= 1;
   }
   for (j = 0; j < expanded; j++)
     Printf(s, tab);
@@ -466,36 +531,39 @@ static int Hash_len(DOH *ho) {
 
 static DOH *CopyHash(DOH *ho) {
   Hash *h, *nh;
-  HashNode *n;
-  DOH *nho;
+  HashEntry *e;
+  int i, capacity;
 
-  int i;
   h = (Hash *) ObjData(ho);
   nh = (Hash *) DohMalloc(sizeof(Hash));
-  nh->hashsize = h->hashsize;
-  nh->hashtable = (HashNode **) DohMalloc(nh->hashsize * sizeof(HashNode *));
-  for (i = 0; i < nh->hashsize; i++) {
-    nh->hashtable[i] = 0;
+  capacity = HASH_INLINE_SIZE;
+  while (capacity < h->nitems)
+    capacity *= 2;
+  new_entries(nh, capacity);
+  nh->index = 0;
+  nh->indexbits = 0;
+  nh->nused = 0;
+  for (i = 0; i < h->nused; i++) {
+    e = &h->entries[i];
+    if (e->key) {
+      nh->entries[nh->nused] = *e;
+      nh->hashvals[nh->nused] = h->hashvals[i];
+      Incref(e->key);
+      Incref(e->object);
+      nh->nused++;
+    }
   }
-  nh->nitems = 0;
+  nh->nitems = nh->nused;
+  if (capacity > HASH_SMALL_MAX)
+    rebuild(nh, capacity);
   nh->line = h->line;
   nh->file = h->file;
   if (nh->file)
     Incref(nh->file);
 
-  nho = DohObjMalloc(&DohHashType, nh);
-  for (i = 0; i < h->hashsize; i++) {
-    n = h->hashtable[i];
-    while (n) {
-      Hash_setattr(nho, n->key, n->object);
-      n = n->next;
-    }
-  }
-  return nho;
+  return DohObjMalloc(&DohHashType, nh);
 }
 
-
-
 static void Hash_setfile(DOH *ho, DOH *file) {
   DOH *fo;
   Hash *h = (Hash *) ObjData(ho);
@@ -570,14 +638,12 @@ DohObjInfo DohHashType = {
 
 DOH *DohNewHash(void) {
   Hash *h;
-  int i;
   h = (Hash *) DohMalloc(sizeof(Hash));
-  h->hashsize = HASH_INIT_SIZE;
-  h->hashtable = (HashNode **) DohMalloc(h->hashsize * sizeof(HashNode *));
-  for (i = 0; i < h->hashsize; i++) {
-    h->hashtable[i] = 0;
-  }
+  new_entries(h, HASH_INLINE_SIZE);
+  h->nused = 0;
   h->nitems = 0;
+  h->index = 0;
+  h->indexbits = 0;
   h->file = 0;
   h->line = 0;
   return DohObjMalloc(&DohHashType, h);
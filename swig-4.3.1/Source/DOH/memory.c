@@ -40,10 +40,43 @@ typedef struct pool {
   struct pool *next;		/* Next pool */
 } Pool;
 
+typedef struct {
+  char *pbeg;			/* Beg of pool */
+  char *pend;			/* End of pool */
+} PoolRange;
+
 static DohBase *FreeList = 0;	/* List of free objects */
 static Pool *Pools = 0;
 static int pools_initialized = 0;
 
+/* Address ranges of all pools, sorted by start address, for DohCheck() */
+static PoolRange *PoolRanges = 0;
+static int NumPools = 0;
+static int MaxPools = 0;
+static char *PoolsBeg = 0;	/* Lowest pool start */
+static char *PoolsEnd = 0;	/* Highest pool end */
+
+/* ----------------------------------------------------------------------
+ * AddPoolRange() - Enter a new pool into the sorted range table
+ * ---------------------------------------------------------------------- */
+
+static void AddPoolRange(Pool *p) {
+  int i;
+  if (NumPools == MaxPools) {
+    MaxPools = MaxPools ? MaxPools * 2 : 8;
+    PoolRanges = (PoolRange *) DohRealloc(PoolRanges, MaxPools * sizeof(PoolRange));
+  }
+  for (i = NumPools; i > 0 && PoolRanges[i - 1].pbeg > p->pbeg; i--)
+    PoolRanges[i] = PoolRanges[i - 1];
+  PoolRanges[i].pbeg = p->pbeg;
+  PoolRanges[i].pend = p->pend;
+  NumPools++;
+  if (!PoolsBeg || p->pbeg < PoolsBeg)
+    PoolsBeg = p->pbeg;
+  if (p->pend > PoolsEnd)
+    PoolsEnd = p->pend;
+}
+
 /* ----------------------------------------------------------------------
  * CreatePool() - Create a new memory pool 
  * ---------------------------------------------------------------------- */
@@ -59,6 +92,7 @@ static void CreatePool(void) {
   p->pend = p->pbeg + p->blen;
   p->next = Pools;
   Pools = p;
+  AddPoolRange(p);
 }
 
 /* ----------------------------------------------------------------------
@@ -78,24 +112,33 @@ static void InitPools(void) {
  * DohCheck()
  *
  * Returns 1 if an arbitrary pointer is a DOH object.
+ *
+ * Pointers outside the span of all pools (string literals, malloc'd
+ * strings) are rejected with two comparisons; others are located by a
+ * binary search of the pool ranges, so the cost does not grow with the
+ * number of pools a large input allocates.
  * ---------------------------------------------------------------------- */
 
 int DohCheck(const DOH *ptr) {
-  Pool *p = Pools;
   char *cptr = (char *) ptr;
-  while (p) {
-    if ((cptr >= p->pbeg) && (cptr < p->pend)) {
+  PoolRange *r = PoolRanges;
+  int n = NumPools;
+  if ((cptr < PoolsBeg) || (cptr >= PoolsEnd))
+    return 0;
+  /* Last pool starting at or below ptr. The trip count depends only on
+     the number of pools, and the select compiles without a branch. */
+  while (n > 1) {
+    int half = n / 2;
+    r = (r[half].pbeg <= cptr) ? r + half : r;
+    n -= half;
+  }
+  if (cptr < r->pend) {
 #ifdef DOH_DEBUG_MEMORY_POOLS
-      DohBase *b = (DohBase *) ptr;
-      int DOH_object_already_deleted = b->type == 0;
-      assert(!DOH_object_already_deleted);
+    DohBase *b = (DohBase *) ptr;
+    int DOH_object_already_deleted = b->type == 0;
+    assert(!DOH_object_already_deleted);
 #endif
-      return 1;
-    }
-    /*
-       pptr = (char *) p->ptr;
-       if ((cptr >= pptr) && (cptr < (pptr+(p->current*sizeof(DohBase))))) return 1; */
-    p = p->next;
+    return 1;
   }
   return 0;
 }
@@ -13,6 +13,7 @@
  * ----------------------------------------------------------------------------- */
 
 #include "dohint.h"
+#include <stdint.h>
 
 extern DohObjInfo DohStringType;
 
@@ -173,38 +174,49 @@ static int String_equal(DOH *so1, DOH *so2) {
 
 /* -----------------------------------------------------------------------------
  * String_hash() - Compute string hash value
+ *
+ * The whole string is hashed, 8 bytes at a time: each word goes through an
+ * xxHash64 style round (multiply, rotate, multiply) and the result through
+ * the murmur3 64-bit finalizer, folded to 31 bits.  Mangled template types
+ * and qualified names often share long prefixes, so every byte counts.
  * ----------------------------------------------------------------------------- */
 
+#define HASH_P1 0x9E3779B185EBCA87ULL
+#define HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define HASH_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
 static int String_hash(DOH *so) {
   String *s = (String *) ObjData(so);
   if (s->hashkey >= 0) {
     return s->hashkey;
   } else {
-    /* We use the djb2 hash function: https://theartincode.stanis.me/008-djb2/
-     *
-     * One difference is we use initial seed 0.  It seems the usual seed value
-     * is intended to help spread out hash values, which is beneficial if
-     * linear probing is used but DOH Hash uses a chain of buckets instead, and
-     * grouped hash values are probably more cache friendly.  In tests using
-     * 0 seems slightly faster anyway.
-     */
-    const char *c = s->str;
-    unsigned int len = s->len > 50 ? 50 : s->len;
-    unsigned int h = 0;
-    unsigned int mlen = len >> 2;
-    unsigned int i = mlen;
-    for (; i; --i) {
-      h = h + (h << 5) + *(c++);
-      h = h + (h << 5) + *(c++);
-      h = h + (h << 5) + *(c++);
-      h = h + (h << 5) + *(c++);
+    const unsigned char *c = (const unsigned char *) s->str;
+    size_t len = (size_t) s->len;
+    uint64_t h = HASH_P1 ^ (len * HASH_P2);
+    uint64_t w;
+    for (; len >= 8; len -= 8, c += 8) {
+      memcpy(&w, c, 8);
+      h ^= HASH_ROTL(w * HASH_P2, 31) * HASH_P1;
+      h = HASH_ROTL(h, 27) * HASH_P1;
     }
-    for (i = len - (mlen << 2); i; --i) {
-      h = h + (h << 5) + *(c++);
+    if (len > 0) {
+      w = 0;
+      if (s->len >= 8) {
+	/* Last 8 bytes, overlapping the previous word */
+	memcpy(&w, c + len - 8, 8);
+      } else {
+	memcpy(&w, c, len);
+      }
+      h ^= HASH_ROTL(w * HASH_P2, 31) * HASH_P1;
+      h = HASH_ROTL(h, 27) * HASH_P1;
     }
-    h &= 0x7fffffff;
-    s->hashkey = (int)h;
-    return h;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    s->hashkey = (int) ((h ^ (h >> 32)) & 0x7fffffff);
+    return s->hashkey;
   }
 }
 
@@ -1191,7 +1203,7 @@ DOHString *DohNewString(const DOHString_or_char *so) {
 DOHString *DohNewStringEmpty(void) {
   int max = INIT_MAXSIZE;
   String *str = (String *) DohMalloc(sizeof(String));
-  str->hashkey = 0;
+  str->hashkey = -1;
   str->sp = 0;
   str->line = 0;
   str->file = 0;
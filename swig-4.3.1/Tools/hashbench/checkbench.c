@@ -0,0 +1,87 @@
+/* -----------------------------------------------------------------------------
+ * This file is part of SWIG, which is licensed as a whole under version 3
+ * (or any later version) of the GNU General Public License. Some additional
+ * terms also apply to certain portions of SWIG. The full details of the SWIG
+ * license and copyrights can be found in the LICENSE and COPYRIGHT files
+ * included with the SWIG source code as distributed by the SWIG developers
+ * and at https://www.swig.org/legal.html.
+ *
+ * checkbench.c
+ *
+ *     Microbenchmark of DohCheck() as the number of object pools grows.
+ *
+ *     Allocates the given number of objects, then times DohCheck() on
+ *     objects spread over all pools, on string literals and on malloc'd
+ *     strings (the char * arguments DOH functions also accept). Build with
+ *     a small pool size to get many pools from a modest object count:
+ *
+ *       cc -O2 -DDOH_POOL_SIZE=65536 -I../../Source/DOH -I../../Source/Include \
+ *          -o checkbench checkbench.c $(ls ../../Source/DOH/[a-z]*.c)
+ *
+ *     Run: ./checkbench objects [rounds]
+ * ----------------------------------------------------------------------------- */
+
+#include "doh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NPROBE 4096
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double time_check(const DOH **probe, int rounds, int expect) {
+  volatile int sink = 0;
+  double t0 = now_ns();
+  int r, i;
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < NPROBE; i++)
+      sink += DohCheck(probe[i]);
+  }
+  if (sink != expect * rounds * NPROBE) {
+    fprintf(stderr, "DohCheck gave the wrong answer\n");
+    exit(1);
+  }
+  return (now_ns() - t0) / ((double) rounds * NPROBE);
+}
+
+int main(int argc, char **argv) {
+  static const char *literals[] = { "name", "type", "sym:name", "feature:immutable", "decl", "kind" };
+  const DOH **probe;
+  DOH **objs;
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 2000;
+  int i;
+  double t_obj, t_lit, t_heap;
+
+  if (n < 1) {
+    fprintf(stderr, "usage: checkbench objects [rounds]\n");
+    return 2;
+  }
+  objs = (DOH **) malloc(n * sizeof(DOH *));
+  for (i = 0; i < n; i++)
+    objs[i] = NewVoid(0, 0);
+  probe = (const DOH **) malloc(NPROBE * sizeof(DOH *));
+
+  srand(1);
+  for (i = 0; i < NPROBE; i++)
+    probe[i] = objs[(int) ((double) rand() / ((double) RAND_MAX + 1) * n)];
+  t_obj = time_check(probe, rounds, 1);
+
+  for (i = 0; i < NPROBE; i++)
+    probe[i] = literals[i % (int) (sizeof(literals) / sizeof(literals[0]))];
+  t_lit = time_check(probe, rounds, 0);
+
+  for (i = 0; i < NPROBE; i++)
+    probe[i] = strdup(literals[i % (int) (sizeof(literals) / sizeof(literals[0]))]);
+  t_heap = time_check(probe, rounds, 0);
+
+  printf("%d objects: DohCheck object %5.2f ns  literal %5.2f ns  malloc'd string %5.2f ns\n", n, t_obj, t_lit, t_heap);
+  return 0;
+}
@@ -0,0 +1,220 @@
+/* -----------------------------------------------------------------------------
+ * This file is part of SWIG, which is licensed as a whole under version 3
+ * (or any later version) of the GNU General Public License. Some additional
+ * terms also apply to certain portions of SWIG. The full details of the SWIG
+ * license and copyrights can be found in the LICENSE and COPYRIGHT files
+ * included with the SWIG source code as distributed by the SWIG developers
+ * and at https://www.swig.org/legal.html.
+ *
+ * hashbench.c
+ *
+ *     Microbenchmark of DOH string hashing and Hash lookups on real keys.
+ *
+ *     Keys are read one per line, for example the typemap and symbol table
+ *     keys SWIG itself uses for an interface:
+ *
+ *       swig -python -c++ -debug-typemap -debug-symbols example.i | \
+ *         sed -n "s/^ *'\([^']*\)' : .*$/\1/p; s/^\([^ ].*\) -$/\1/p" > keys.txt
+ *
+ *     Reports, for the DOH string hash and for the previous one (djb2 over
+ *     the first 50 characters) as a reference:
+ *       - keys sharing a hash value
+ *       - chain length in a chained table of the old layout (about 2 keys
+ *         per bucket) and probe length in an open addressing table at most
+ *         half full (the current Hash index)
+ *     then times hashing (new String per key) and Getattr on one Hash
+ *     holding every key, with keys that are equal but not the stored
+ *     objects.
+ *
+ *     Build from this directory against the DOH sources:
+ *
+ *       cc -O2 -I../../Source/DOH -I../../Source/Include -o hashbench \
+ *          hashbench.c $(ls ../../Source/DOH/[a-z]*.c)
+ *
+ *     Run: ./hashbench keys.txt [rounds]
+ * ----------------------------------------------------------------------------- */
+
+#include "doh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* The SWIG 4.3 String hash: djb2, seed 0, first 50 characters */
+static unsigned int djb2_50(const char *c, int len) {
+  unsigned int h = 0;
+  int i;
+  if (len > 50)
+    len = 50;
+  for (i = 0; i < len; i++)
+    h = h + (h << 5) + (unsigned char) c[i];
+  return h & 0x7fffffff;
+}
+
+static int cmp_uint(const void *a, const void *b) {
+  unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+  return (x > y) - (x < y);
+}
+
+/* Collision and table statistics for one set of hash values */
+static void report(const char *name, unsigned int *hv, int n) {
+  unsigned int *sorted = (unsigned int *) malloc(n * sizeof(unsigned int));
+  int i, run = 1, maxrun = 1, distinct = 1;
+  int buckets, bits, size, *table;
+  double chained = 0, probes = 0;
+  int maxchain = 0, maxprobe = 0;
+  int *chain;
+
+  memcpy(sorted, hv, n * sizeof(unsigned int));
+  qsort(sorted, n, sizeof(unsigned int), cmp_uint);
+  for (i = 1; i < n; i++) {
+    if (sorted[i] == sorted[i - 1]) {
+      if (++run > maxrun)
+	maxrun = run;
+    } else {
+      run = 1;
+      distinct++;
+    }
+  }
+
+  /* Old layout: an odd bucket count of at least n/2 (resize() kept
+     nitems < 2 * hashsize), chains walked in full on a lookup */
+  buckets = n / 2 | 1;
+  chain = (int *) calloc(buckets, sizeof(int));
+  for (i = 0; i < n; i++)
+    chain[hv[i] % buckets]++;
+  for (i = 0; i < buckets; i++) {
+    chained += (double) chain[i] * chain[i];
+    if (chain[i] > maxchain)
+      maxchain = chain[i];
+  }
+
+  /* Current layout: linear probing, Fibonacci hashed, at most half full */
+  for (bits = 1; (1 << bits) < 2 * n; bits++) {
+  }
+  size = 1 << bits;
+  table = (int *) calloc(size, sizeof(int));
+  for (i = 0; i < n; i++) {
+    unsigned int slot = (unsigned int) (hv[i] * 2654435769u) >> (32 - bits);
+    int p = 1;
+    while (table[slot]) {
+      slot = (slot + 1) & (size - 1);
+      p++;
+    }
+    table[slot] = 1;
+    probes += p;
+    if (p > maxprobe)
+      maxprobe = p;
+  }
+
+  printf("%-10s distinct %6d / %d  most keys on one value %3d  chain mean %5.2f max %3d  probe mean %5.2f max %3d\n",
+	 name, distinct, n, maxrun, chained / n, maxchain, probes / n, maxprobe);
+  free(sorted);
+  free(chain);
+  free(table);
+}
+
+int main(int argc, char **argv) {
+  FILE *f;
+  char line[4096];
+  DOH *seen, *table, *keys, *probe;
+  unsigned int *hv_doh, *hv_old;
+  int n, i, r, rounds = argc > 2 ? atoi(argv[2]) : 20;
+  long total_len = 0;
+  double t0, t_hash, t_old, t_get, t_miss;
+  volatile unsigned int sink = 0;
+
+  if (argc < 2 || !(f = fopen(argv[1], "r"))) {
+    fprintf(stderr, "usage: hashbench keys.txt [rounds]\n");
+    return 2;
+  }
+  seen = NewHash();
+  keys = NewList();
+  while (fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = 0;
+    if (line[0] && !Getattr(seen, line)) {
+      Setattr(seen, line, "1");
+      Append(keys, line);
+      total_len += (long) strlen(line);
+    }
+  }
+  fclose(f);
+  n = Len(keys);
+  if (n < 2) {
+    fprintf(stderr, "need at least 2 distinct keys\n");
+    return 1;
+  }
+  printf("%d distinct keys, mean length %.1f\n", n, (double) total_len / n);
+
+  hv_doh = (unsigned int *) malloc(n * sizeof(unsigned int));
+  hv_old = (unsigned int *) malloc(n * sizeof(unsigned int));
+  for (i = 0; i < n; i++) {
+    DOH *k = Getitem(keys, i);
+    hv_doh[i] = (unsigned int) Hashval(k);
+    hv_old[i] = djb2_50(Char(k), Len(k));
+  }
+  report("DOH", hv_doh, n);
+  report("djb2-50", hv_old, n);
+
+  /* Hashing: a new String per key, so nothing is cached */
+  t0 = now_ns();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < n; i++) {
+      DOH *s = NewString(Char(Getitem(keys, i)));
+      sink += (unsigned int) Hashval(s);
+      Delete(s);
+    }
+  }
+  t_hash = (now_ns() - t0) / ((double) rounds * n);
+  t0 = now_ns();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < n; i++) {
+      DOH *s = NewString(Char(Getitem(keys, i)));
+      sink += djb2_50(Char(s), Len(s));
+      Delete(s);
+    }
+  }
+  t_old = (now_ns() - t0) / ((double) rounds * n);
+
+  /* Lookups with equal keys that are not the stored objects (hash values
+     already cached), then misses (keys with a suffix added) */
+  table = NewHash();
+  probe = NewList();
+  for (i = 0; i < n; i++) {
+    DOH *k = NewString(Char(Getitem(keys, i)));
+    Setattr(table, k, k);
+    Delete(k);
+    k = NewString(Char(Getitem(keys, i)));
+    Hashval(k);
+    Append(probe, k);
+    Delete(k);
+  }
+  t0 = now_ns();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < n; i++)
+      sink += Getattr(table, Getitem(probe, i)) != 0;
+  }
+  t_get = (now_ns() - t0) / ((double) rounds * n);
+  for (i = 0; i < n; i++) {
+    DOH *k = NewStringf("%s *", Char(Getitem(keys, i)));
+    Hashval(k);
+    Setitem(probe, i, k);
+  }
+  t0 = now_ns();
+  for (r = 0; r < rounds; r++) {
+    for (i = 0; i < n; i++)
+      sink += Getattr(table, Getitem(probe, i)) != 0;
+  }
+  t_miss = (now_ns() - t0) / ((double) rounds * n);
+
+  printf("hash (new String + Hashval) %7.1f ns/key   djb2-50 on the same Strings %7.1f ns/key\n", t_hash, t_old);
+  printf("Getattr hit  %7.1f ns   Getattr miss %7.1f ns   (%d rounds, check %u)\n", t_get, t_miss, rounds, sink);
+  return 0;
+}
@@ -0,0 +1,424 @@
+/* -----------------------------------------------------------------------------
+ * This file is part of SWIG, which is licensed as a whole under version 3
+ * (or any later version) of the GNU General Public License. Some additional
+ * terms also apply to certain portions of SWIG. The full details of the SWIG
+ * license and copyrights can be found in the LICENSE and COPYRIGHT files
+ * included with the SWIG source code as distributed by the SWIG developers
+ * and at https://www.swig.org/legal.html.
+ *
+ * hashcheck.c
+ *
+ *     Randomised model check of the DOH Hash (Source/DOH/hash.c).
+ *
+ *     Runs random Setattr/Delattr/Getattr/Copy/Clear operations on one Hash
+ *     and on a model of it (entries in insertion order), with keys given as
+ *     C strings or as fresh String objects that are deleted straight after
+ *     use.  After every operation the table itself is checked:
+ *       - live entries, holes and nused/nitems agree; small tables have no
+ *         trailing hole and no index; the inline block is used exactly when
+ *         the capacity is HASH_INLINE_SIZE
+ *       - every cached hash value is Hashval() of its key
+ *       - the index (bigger tables) holds every used position once, is at
+ *         most half full and finds every live key where it is
+ *     and the iteration order, Keys() and Copy() match the model.
+ *
+ *     Some iterations mutate the table between First() and each Next():
+ *     deleting the current item, other items, adding items (which may make
+ *     add_entry() compact the table under the iterator), replacing values.
+ *     Items are returned in insertion order, only while live, and every
+ *     item live from First() to the end is returned exactly once, unless
+ *     the item the iterator was about to return was deleted.
+ *
+ *     hash.c is compiled into this file to reach the table internals:
+ *
+ *       cc -g -O1 -fsanitize=address,undefined -I../../Source/DOH \
+ *          -I../../Source/Include -o hashcheck hashcheck.c \
+ *          $(ls ../../Source/DOH/[a-z]*.c | grep -v /hash.c)
+ *
+ *     Run: ./hashcheck [operations] [seed]
+ * ----------------------------------------------------------------------------- */
+
+#include "../../Source/DOH/hash.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NKEYS     40		/* Distinct key names */
+#define MAXENTRY  (1 << 22)	/* Model entries, deleted ones included */
+
+/* Model entry: one per insertion, so a key deleted and added again is a
+   new entry at the end.  The Hash stores "<id>.<version>" as the value. */
+typedef struct {
+  int key;
+  int version;
+  int live;
+} Model;
+
+static Model *model;
+static int nmodel;
+static int current[NKEYS];	/* Live entry of each key, or -1 */
+static int nlive;
+static char names[NKEYS][16];
+static unsigned long long rng;
+static long failures;
+
+#define FAIL(...) do { \
+    fprintf(stderr, "hashcheck: "); \
+    fprintf(stderr, __VA_ARGS__); \
+    fputc('\n', stderr); \
+    if (++failures > 20) \
+      exit(1); \
+  } while (0)
+
+static unsigned int rnd(unsigned int n) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return (unsigned int) (rng >> 11) % n;
+}
+
+/* A key as callers pass it: a C string (interned by the Hash) or a String
+   of its own, deleted by the caller after the call */
+static DOH *new_key(int k) {
+  return rnd(2) ? (DOH *) names[k] : NewString(names[k]);
+}
+
+static void free_key(DOH *key) {
+  if (DohCheck(key))
+    Delete(key);
+}
+
+static DOH *new_value(int id) {
+  return NewStringf("%d.%d", id, model[id].version);
+}
+
+/* Model entry id of a value, -1 if it does not parse */
+static int value_id(DOH *value, int *version) {
+  int id;
+  if (!value || sscanf(Char(value), "%d.%d", &id, version) != 2 || id < 0 || id >= nmodel)
+    return -1;
+  return id;
+}
+
+static int key_index(DOH *key) {
+  int k;
+  for (k = 0; k < NKEYS; k++) {
+    if (Strcmp(key, names[k]) == 0)
+      return k;
+  }
+  return -1;
+}
+
+/* -----------------------------------------------------------------------------
+ * Operations on the Hash and the model
+ * ----------------------------------------------------------------------------- */
+
+static void op_set(DOH *h, int k) {
+  DOH *key = new_key(k), *value;
+  int id = current[k], replaced;
+  if (id >= 0) {
+    model[id].version++;
+  } else {
+    if (nmodel == MAXENTRY) {
+      fprintf(stderr, "hashcheck: model full\n");
+      exit(2);
+    }
+    id = nmodel++;
+    model[id].key = k;
+    model[id].version = 0;
+    model[id].live = 1;
+    current[k] = id;
+    nlive++;
+  }
+  value = new_value(id);
+  replaced = Setattr(h, key, value);
+  if (replaced != (model[id].version > 0))
+    FAIL("Setattr(%s) returned %d", names[k], replaced);
+  Delete(value);
+  free_key(key);
+}
+
+static void op_del(DOH *h, int k) {
+  DOH *key = new_key(k);
+  int deleted = Delattr(h, key);
+  if (deleted != (current[k] >= 0))
+    FAIL("Delattr(%s) returned %d", names[k], deleted);
+  if (current[k] >= 0) {
+    model[current[k]].live = 0;
+    current[k] = -1;
+    nlive--;
+  }
+  free_key(key);
+}
+
+static void op_get(DOH *h, int k) {
+  DOH *key = new_key(k);
+  DOH *value = Getattr(h, key);
+  int id = current[k], version;
+  if (id < 0) {
+    if (value)
+      FAIL("Getattr(%s) found a deleted key", names[k]);
+  } else if (value_id(value, &version) != id || version != model[id].version) {
+    FAIL("Getattr(%s) = %s, expected %d.%d", names[k], value ? Char(value) : "null", id, model[id].version);
+  }
+  free_key(key);
+}
+
+static void op_clear(DOH *h) {
+  int k;
+  Clear(h);
+  for (k = 0; k < NKEYS; k++) {
+    if (current[k] >= 0)
+      model[current[k]].live = 0;
+    current[k] = -1;
+  }
+  nlive = 0;
+}
+
+/* -----------------------------------------------------------------------------
+ * Table invariants
+ * ----------------------------------------------------------------------------- */
+
+static void check_table(DOH *ho, int nitems, const char *what) {
+  Hash *h = (Hash *) ObjData(ho);
+  int i, live = 0, slots = 0;
+  char *seen;
+
+  if (h->nitems != nitems)
+    FAIL("%s: nitems %d, expected %d", what, h->nitems, nitems);
+  if (h->nitems < 0 || h->nitems > h->nused || h->nused > h->capacity)
+    FAIL("%s: nitems %d, nused %d, capacity %d", what, h->nitems, h->nused, h->capacity);
+  if (h->capacity < HASH_INLINE_SIZE || (h->capacity & (h->capacity - 1)))
+    FAIL("%s: capacity %d", what, h->capacity);
+  if ((h->entries == h->inline_entries) != (h->capacity == HASH_INLINE_SIZE) ||
+      (h->hashvals == h->inline_hashvals) != (h->capacity == HASH_INLINE_SIZE))
+    FAIL("%s: inline block with capacity %d", what, h->capacity);
+  for (i = 0; i < h->nused; i++) {
+    HashEntry *e = &h->entries[i];
+    if (!e->key) {
+      if (e->object)
+	FAIL("%s: hole %d has an object", what, i);
+      continue;
+    }
+    live++;
+    if (h->hashvals[i] != (unsigned int) Hashval(e->key))
+      FAIL("%s: stale hash value at %d", what, i);
+    if (find_entry(h, e->key, h->hashvals[i]) != i)
+      FAIL("%s: '%s' at %d not found there", what, Char(e->key), i);
+  }
+  if (live != h->nitems)
+    FAIL("%s: %d live entries, nitems %d", what, live, h->nitems);
+
+  if (h->capacity <= HASH_SMALL_MAX) {
+    if (h->index || h->indexbits)
+      FAIL("%s: index on a table of %d", what, h->capacity);
+    if (h->nused > 0 && !h->entries[h->nused - 1].key)
+      FAIL("%s: trailing hole in a small table", what);
+    return;
+  }
+  if (!h->index || (1 << h->indexbits) < 2 * h->capacity) {
+    FAIL("%s: index of %d bits for capacity %d", what, h->indexbits, h->capacity);
+    return;
+  }
+  seen = (char *) calloc(h->nused + 1, 1);
+  for (i = 0; i < 1 << h->indexbits; i++) {
+    int pos = h->index[i];
+    if (!pos)
+      continue;
+    slots++;
+    if (pos > h->nused || seen[pos])
+      FAIL("%s: index slot %d holds position %d", what, i, pos - 1);
+    else
+      seen[pos] = 1;
+  }
+  if (slots != h->nused)
+    FAIL("%s: index holds %d positions, nused %d", what, slots, h->nused);
+  free(seen);
+}
+
+/* Iteration, Keys() and a Copy() against the model, without mutation */
+static void check_order(DOH *h, const char *what) {
+  Iterator it;
+  DOH *keys = Keys(h), *copy = Copy(h);
+  int id = 0, n = 0, version;
+
+  for (it = First(h); it.key; it = Next(it), n++) {
+    while (id < nmodel && !model[id].live)
+      id++;
+    if (id == nmodel || value_id(it.item, &version) != id || version != model[id].version ||
+	key_index(it.key) != model[id].key) {
+      FAIL("%s: item %d is '%s' = %s, expected entry %d", what, n, Char(it.key), Char(it.item), id);
+      break;
+    }
+    if (Strcmp(Getitem(keys, n), it.key) != 0)
+      FAIL("%s: Keys()[%d] is '%s', iteration '%s'", what, n, Char(Getitem(keys, n)), Char(it.key));
+    if (Getattr(copy, it.key) != it.item)
+      FAIL("%s: copy lost '%s'", what, Char(it.key));
+    id++;
+  }
+  if (n != nlive || Len(keys) != nlive || Len(copy) != nlive)
+    FAIL("%s: %d iterated, %d keys, %d copied, model %d", what, n, Len(keys), Len(copy), nlive);
+  if (((Hash *) ObjData(copy))->nused != nlive)
+    FAIL("%s: copy has holes", what);
+  check_table(copy, nlive, "copy");
+  Delete(keys);
+  Delete(copy);
+}
+
+/* -----------------------------------------------------------------------------
+ * Iteration with the table changing under it
+ * ----------------------------------------------------------------------------- */
+
+static long iterations, mutating, compactions, weak;
+static char visited[MAXENTRY], live_at_first[MAXENTRY];
+
+static void check_mutating_iteration(DOH *h) {
+  Iterator it;
+  int first_end = nmodel, last = -1, id, version, k, exact = 1;
+  int ops = rnd(4) == 0 ? 0 : 1 + rnd(4);
+  Hash *t = (Hash *) ObjData(h);
+
+  for (id = 0; id < nmodel; id++)
+    live_at_first[id] = (char) model[id].live;
+  for (it = First(h); it.key; it = Next(it)) {
+    int i, n = rnd(ops + 1);
+    id = value_id(it.item, &version);
+    if (id < 0 || !model[id].live || version != model[id].version || key_index(it.key) != model[id].key) {
+      FAIL("iteration returned '%s' = %s, not a live entry", Char(it.key), Char(it.item));
+      break;
+    }
+    if (id <= last) {
+      FAIL("iteration returned entry %d after %d", id, last);
+      break;
+    }
+    visited[id] = 1;
+    last = id;
+
+    for (i = 0; i < n; i++) {
+      int nused = t->nused, nitems = t->nitems, next;
+      switch (rnd(6)) {
+      case 0:			/* The current item */
+	op_del(h, model[id].key);
+	break;
+      case 1:			/* Any item; note if it is the one Next() returns */
+	k = rnd(NKEYS);
+	for (next = last + 1; next < nmodel && !model[next].live; next++);
+	if (current[k] >= 0 && current[k] == next)
+	  exact = 0;
+	op_del(h, k);
+	break;
+      case 2:
+      case 3:			/* New item or new value */
+	op_set(h, rnd(NKEYS));
+	break;
+      case 4:
+	op_set(h, model[id].key);
+	break;
+      default:
+	op_get(h, rnd(NKEYS));
+	break;
+      }
+      if (t->nused < nused && t->nitems >= nitems)
+	compactions++;
+      check_table(h, nlive, "during iteration");
+    }
+  }
+
+  /* Items live from First() to now were all returned */
+  for (id = 0; id < first_end; id++) {
+    if (live_at_first[id] && model[id].live && !visited[id] && exact)
+      FAIL("iteration skipped entry %d ('%s')", id, names[model[id].key]);
+  }
+  memset(visited, 0, nmodel);
+  iterations++;
+  mutating += ops > 0;
+  weak += !exact;
+}
+
+/* The case that needs the iterator to find its place again: a full table
+   of n items is iterated up to item `at`, which is deleted along with
+   `holes` items before it; adding an item then makes add_entry() compact
+   (in place, or growing).  Iteration must carry on with item at + 1. */
+static void check_compaction_after_delattr(int n, int at, int holes) {
+  DOH *h = NewHash();
+  Iterator it;
+  int i, expect;
+
+  for (i = 0; i < n; i++)
+    Setattr(h, names[i], names[i]);
+  for (it = First(h), i = 0; i < at; i++)
+    it = Next(it);
+  Delattr(h, it.key);
+  for (i = 0; i < holes; i++)
+    Delattr(h, names[at - 1 - i]);
+  Setattr(h, names[n], names[n]);
+  if (((Hash *) ObjData(h))->nused != n - holes)
+    FAIL("compaction %d/%d/%d: add_entry() did not compact", n, at, holes);
+  for (it = Next(it), expect = at + 1; it.key && expect <= n; it = Next(it), expect++) {
+    if (Strcmp(it.key, names[expect]) != 0)
+      break;
+  }
+  if (expect != n + 1 || it.key)
+    FAIL("compaction %d/%d/%d: expected '%s', iteration gave '%s'", n, at, holes,
+	 expect <= n ? names[expect] : "the end", it.key ? Char(it.key) : "the end");
+  Delete(h);
+}
+
+int main(int argc, char **argv) {
+  long steps = argc > 1 ? atol(argv[1]) : 1000000;
+  unsigned long long seed = argc > 2 ? strtoull(argv[2], 0, 0) : 1;
+  DOH *h;
+  long s;
+  int k;
+
+  if (steps < 1) {
+    fprintf(stderr, "usage: hashcheck [operations] [seed]\n");
+    return 2;
+  }
+  rng = seed * 0x9E3779B97F4A7C15ull + 1;
+  model = (Model *) calloc(MAXENTRY, sizeof(Model));
+  for (k = 0; k < NKEYS; k++) {
+    sprintf(names[k], "k%d", k);
+    current[k] = -1;
+  }
+  /* Capacities 4 (inline), 8 (biggest small table) and 16, 32 (indexed);
+     few holes grow the table, many compact it in place */
+  for (k = HASH_INLINE_SIZE; k <= 32; k *= 2) {
+    check_compaction_after_delattr(k, 1, 0);
+    check_compaction_after_delattr(k, k / 2, 0);
+    check_compaction_after_delattr(k, k - 2, k - 2);
+  }
+
+  h = NewHash();
+
+  for (s = 0; s < steps && nmodel < MAXENTRY - 1024; s++) {
+    /* Drift between small tables and indexed ones */
+    int target = (s / 5000) % 2 ? NKEYS : 6;
+    unsigned int r = rnd(100);
+    k = rnd(NKEYS);
+    if (r < 40 && (nlive < target || current[k] >= 0))
+      op_set(h, k);
+    else if (r < 70 && nlive > target / 2)
+      op_del(h, k);
+    else if (r < 95)
+      op_get(h, k);
+    else if (r < 99)
+      check_mutating_iteration(h);
+    else if (rnd(50) == 0)
+      op_clear(h);
+    else
+      check_order(h, "order");
+    check_table(h, nlive, "after operation");
+  }
+  check_order(h, "end");
+  Delete(h);
+
+  printf("%ld operations, %ld iterations (%ld mutating, %ld with the next item deleted), "
+	 "%ld compactions under an iterator\n", s, iterations, mutating, weak, compactions);
+  if (failures) {
+    printf("%ld failure(s)\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
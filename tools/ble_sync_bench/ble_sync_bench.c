@@ -0,0 +1,505 @@
+// File: tools/ble_sync_bench/ble_sync_bench.c
+// ---------------------------------------------------------------------------
+// BLE history sync throughput on a loopback link model
+//   - ble_history.c and weigh_log.c compiled in unchanged; NimBLE, the
+//     controller and the flash file are stand-ins on a virtual clock
+//   - msys pools as in sdkconfig (12 x 256 B, 24 x 320 B); a notification
+//     holds its blocks until the link has sent its last fragment
+//   - Link: one connection event per interval. The central polls with an
+//     empty PDU and the scale answers with one data PDU of up to the LE
+//     data length, until the next exchange would overrun the interval
+//     (or --pdus-per-event, the central's limit)
+//   - The receiver decodes every notification and checks that records
+//     arrive once, in order and with the stored contents
+//   - Scenarios: MTU / data length / PHY / interval matrix, resume from
+//     seq >= N, abort, a storage read failure (NOT COMPLETED) and torn
+//     newest slots (skipped, the sync still completes)
+//
+//   make -C tools/ble_sync_bench
+//   tools/ble_sync_bench/ble_sync_bench [--records 1024] [--read-us 400]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "ble_history.c"
+#include "clock_map.h"
+#include "storage.h"
+
+#define CONN_HANDLE         1
+#define TX_QUEUE_MAX        64
+
+// msys pools (CONFIG_BT_NIMBLE_MSYS_1/2_BLOCK_COUNT / _SIZE)
+#define MSYS_POOLS          2
+static const int k_msys_count[MSYS_POOLS] = { 12, 24 };
+static const int k_msys_size[MSYS_POOLS]  = { 256, 320 };
+
+// os_mbuf header (16) + packet header (8) + leading space the host keeps
+// for the HCI ACL, L2CAP and ATT headers (12)
+#define MBUF_FIRST_OVERHEAD 36
+#define MBUF_NEXT_OVERHEAD  16
+
+// LL timing on air: preamble + access address + header + CRC, T_IFS
+#define LL_IFS_US           150
+
+typedef struct {
+    const char *name;
+    uint16_t    mtu;            // ATT MTU
+    uint16_t    data_len;       // LE data length (LL payload octets)
+    int         phy;            // 1 or 2 (Mbit/s)
+    int         interval_us;    // Connection interval
+} link_cfg_t;
+
+typedef struct {
+    struct os_mbuf *om;
+    int             bytes_left; // L2CAP frame bytes not yet on air
+} tx_packet_t;
+
+// Link and host state
+static link_cfg_t   s_link;
+static int          s_pdus_per_event;   // 0: only the interval limits an event
+static int64_t      s_now_us;
+static int64_t      s_next_event_us;
+static bool         s_notified;
+static int          s_msys_free[MSYS_POOLS];
+static tx_packet_t  s_txq[TX_QUEUE_MAX];
+static int          s_txq_head, s_txq_count;
+static uint64_t     s_ll_pdus;
+
+// Receiver
+static uint32_t     s_expect_seq;
+static uint32_t     s_received;
+static uint32_t     s_errors;
+static uint32_t     s_notifications;
+static int64_t      s_last_rx_us;
+static int          s_racp_op, s_racp_code;
+static uint32_t     s_abort_after;      // Write RACP abort after this many records
+
+// Flash stand-in
+static uint8_t     *s_file;
+static size_t       s_file_len;
+static int          s_read_us = 400;    // Per storage_read_at call
+static uint32_t     s_fail_seq;         // Reads covering this slot fail
+
+/* ------------------------------ Records -------------------------------- */
+
+#define WALL_BASE   1700000000u
+
+static float record_weight(uint32_t seq) {
+    return 40000.0f + (float)(seq * 37u % 60000u);
+}
+
+/* --------------------------- Link simulation ---------------------------- */
+
+static int pdu_air_us(int payload) {
+    // 1M: 1 preamble + 4 AA + 2 header + payload + 3 CRC, 8 us per octet;
+    // 2M: 2 preamble, 4 us per octet
+    return s_link.phy == 2 ? (11 + payload) * 4 : (10 + payload) * 8;
+}
+
+static void deliver(const struct os_mbuf *om) {
+    s_notifications++;
+    for (int off = 0; off + BLE_HISTORY_RECORD_LEN <= om->om_len; off += BLE_HISTORY_RECORD_LEN) {
+        const uint8_t *p = om->om_data + off;
+        uint32_t seq = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        uint32_t ts  = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+        uint16_t w5  = (uint16_t)(p[8] | p[9] << 8);
+        uint16_t want_w5 = (uint16_t)((record_weight(seq) + 2.5f) / 5.0f);
+        if (seq != s_expect_seq || ts != WALL_BASE + seq || w5 != want_w5 || p[10] != seq % 4) {
+            if (s_errors++ < 5) {
+                fprintf(stderr, "bad record: seq %u (expected %u) ts %u w5 %u\n",
+                        seq, s_expect_seq, ts, w5);
+            }
+        }
+        s_expect_seq = seq + 1;
+        s_received++;
+    }
+    s_last_rx_us = s_now_us;
+    if (s_abort_after && s_received >= s_abort_after && !s_abort) {
+        // What racp_access_cb does for RACP_OP_ABORT during a transfer
+        s_abort = true;
+        xTaskNotifyGive(s_task);
+    }
+}
+
+// One connection event at s_now_us
+static void connection_event(void) {
+    int used = 0, pdus = 0;
+    while (s_txq_count > 0 && (s_pdus_per_event == 0 || pdus < s_pdus_per_event)) {
+        tx_packet_t *t = &s_txq[s_txq_head];
+        int frag = t->bytes_left < s_link.data_len ? t->bytes_left : s_link.data_len;
+        int exchange = pdu_air_us(0) + LL_IFS_US + pdu_air_us(frag) + LL_IFS_US;
+        if (used + exchange > s_link.interval_us - LL_IFS_US) {
+            break;
+        }
+        used += exchange;
+        pdus++;
+        s_ll_pdus++;
+        t->bytes_left -= frag;
+        if (t->bytes_left == 0) {
+            struct os_mbuf *om = t->om;
+            s_txq_head = (s_txq_head + 1) % TX_QUEUE_MAX;
+            s_txq_count--;
+            deliver(om);
+            os_mbuf_free_chain(om);
+            struct ble_gap_event ev = { .type = BLE_GAP_EVENT_NOTIFY_TX };
+            ev.notify_tx.conn_handle = CONN_HANDLE;
+            ev.notify_tx.attr_handle = s_records_handle;
+            ble_history_on_gap_event(&ev);
+        }
+    }
+}
+
+// Run the link up to `until`, or until the sync task has been notified
+static void advance(int64_t until, bool stop_on_notify) {
+    if (s_link.interval_us == 0) {
+        return;     // Log setup, before the connection exists
+    }
+    while (s_next_event_us <= until && !(stop_on_notify && s_notified)) {
+        s_now_us = s_next_event_us;
+        connection_event();
+        s_next_event_us += s_link.interval_us;
+    }
+    if (!(stop_on_notify && s_notified) && until > s_now_us) {
+        s_now_us = until;
+    }
+}
+
+/* ----------------------- NimBLE / FreeRTOS stand-ins --------------------- */
+
+uint16_t current_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    s_notified = true;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    if (!s_notified) {
+        advance(s_now_us + (int64_t)wait * 1000, true);
+    }
+    uint32_t was = s_notified;
+    s_notified = false;
+    return was;
+}
+
+int64_t esp_timer_get_time(void) {
+    return s_now_us;
+}
+
+int os_msys_num_free(void) {
+    int n = 0;
+    for (int i = 0; i < MSYS_POOLS; i++) n += s_msys_free[i];
+    return n;
+}
+
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len) {
+    // Smallest pool whose block holds the whole packet, else a chain of
+    // the largest blocks (os_msys_get_pkthdr)
+    uint8_t take[MSYS_POOLS] = { 0 };
+    int pool = -1;
+    for (int i = 0; i < MSYS_POOLS && pool < 0; i++) {
+        if (len + MBUF_FIRST_OVERHEAD <= k_msys_size[i]) pool = i;
+    }
+    if (pool >= 0) {
+        take[pool] = 1;
+    } else {
+        pool = MSYS_POOLS - 1;
+        int left = len - (k_msys_size[pool] - MBUF_FIRST_OVERHEAD);
+        take[pool] = 1;
+        while (left > 0) {
+            take[pool]++;
+            left -= k_msys_size[pool] - MBUF_NEXT_OVERHEAD;
+        }
+    }
+    for (int i = 0; i < MSYS_POOLS; i++) {
+        if (s_msys_free[i] < take[i]) return NULL;
+    }
+    struct os_mbuf *om = calloc(1, sizeof(*om));
+    om->om_data = malloc(len ? len : 1);
+    memcpy(om->om_data, buf, len);
+    om->om_len = len;
+    for (int i = 0; i < MSYS_POOLS; i++) {
+        s_msys_free[i] -= take[i];
+        om->om_blocks[i] = take[i];
+    }
+    return om;
+}
+
+void os_mbuf_free_chain(struct os_mbuf *om) {
+    if (!om) return;
+    for (int i = 0; i < MSYS_POOLS; i++) s_msys_free[i] += om->om_blocks[i];
+    free(om->om_data);
+    free(om);
+}
+
+int os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst) {
+    if (off + len > om->om_len) return -1;
+    memcpy(dst, om->om_data + off, (size_t)len);
+    return 0;
+}
+
+int ble_gatts_notify_custom(uint16_t conn, uint16_t attr_handle, struct os_mbuf *om) {
+    if (conn != CONN_HANDLE || attr_handle != s_records_handle || s_txq_count == TX_QUEUE_MAX) {
+        os_mbuf_free_chain(om);
+        return BLE_HS_ENOMEM;
+    }
+    tx_packet_t *t = &s_txq[(s_txq_head + s_txq_count++) % TX_QUEUE_MAX];
+    t->om = om;
+    t->bytes_left = om->om_len + 3 + 4;     // ATT opcode + handle, L2CAP header
+    return 0;
+}
+
+int ble_gatts_indicate_custom(uint16_t conn, uint16_t attr_handle, struct os_mbuf *om) {
+    // RACP responses only; their airtime is not modelled
+    if (attr_handle == s_racp_handle && om->om_len == 4 && om->om_data[0] == RACP_OP_RESPONSE_CODE) {
+        s_racp_op = om->om_data[2];
+        s_racp_code = om->om_data[3];
+    }
+    os_mbuf_free_chain(om);
+    return 0;
+}
+
+uint16_t ble_att_mtu(uint16_t conn_handle) {
+    return s_link.mtu;
+}
+
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs) { return 0; }
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *defs) { return 0; }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) { return pdTRUE; }
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) { return pdFALSE; }
+
+QueueHandle_t res_queue_create(res_queue_t id, int instance, UBaseType_t length, UBaseType_t item_size) {
+    return (QueueHandle_t)&s_requests;
+}
+
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name, void *arg) {
+    return (TaskHandle_t)&s_task;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len) {
+    crc = (uint16_t)~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+    }
+    return (uint16_t)~crc;
+}
+
+/* ----------------------- weigh_log dependencies -------------------------- */
+
+// Appends happen at mono_us = seq seconds with the clock already mapped,
+// so every record carries WALL_BASE + seq
+time_t clock_map_to_wall(int64_t mono_us) {
+    return (time_t)(WALL_BASE + mono_us / 1000000);
+}
+
+uint8_t clock_map_boot_tag(void) {
+    return 1;
+}
+
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall) {
+    return false;
+}
+
+esp_err_t storage_open(const char *name, storage_file_t *f) {
+    f->fd = 3;
+    return ESP_OK;
+}
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got) {
+    *got = 0;
+    advance(s_now_us + s_read_us, false);
+    if (s_fail_seq) {
+        size_t slot = (size_t)((s_fail_seq - 1) % WEIGH_LOG_CAPACITY) * sizeof(weigh_log_record_t);
+        if (slot >= offset && slot < offset + len) return ESP_FAIL;
+    }
+    if (offset >= s_file_len) return ESP_OK;
+    *got = len < s_file_len - offset ? len : s_file_len - offset;
+    memcpy(buf, s_file + offset, *got);
+    return ESP_OK;
+}
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync) {
+    if (offset + len > s_file_len) {
+        s_file = realloc(s_file, offset + len);
+        memset(s_file + s_file_len, 0, offset + len - s_file_len);
+        s_file_len = offset + len;
+    }
+    memcpy(s_file + offset, data, len);
+    return ESP_OK;
+}
+
+/* ------------------------------- Runs ------------------------------------ */
+
+typedef struct {
+    uint32_t records;
+    int64_t  us;            // Request to last record received
+    uint64_t ll_pdus;
+    uint32_t notifications;
+    int      racp_op, racp_code;
+} run_result_t;
+
+static run_result_t run_sync(const link_cfg_t *link, uint32_t from_seq) {
+    s_link = *link;
+    s_now_us = 0;
+    s_next_event_us = link->interval_us;
+    s_notified = false;
+    for (int i = 0; i < MSYS_POOLS; i++) s_msys_free[i] = k_msys_count[i];
+    s_txq_head = s_txq_count = 0;
+    s_ll_pdus = 0;
+    s_expect_seq = from_seq < weigh_log_first_seq() ? weigh_log_first_seq() : from_seq;
+    s_received = s_notifications = 0;
+    s_last_rx_us = 0;
+    s_racp_op = s_racp_code = -1;
+
+    current_conn_handle = CONN_HANDLE;
+    s_records_notify = true;
+    s_racp_indicate = true;
+    s_abort = false;
+    s_busy = true;
+    stream_records(from_seq);
+    s_busy = false;
+
+    // Let the link drain what was queued before the response
+    while (s_txq_count > 0) {
+        advance(s_next_event_us, false);
+    }
+
+    run_result_t r = {
+        .records = s_received, .us = s_last_rx_us, .ll_pdus = s_ll_pdus,
+        .notifications = s_notifications, .racp_op = s_racp_op, .racp_code = s_racp_code,
+    };
+    return r;
+}
+
+static int s_failures;
+
+static void expect(bool ok, const char *what) {
+    printf("  %-58s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) s_failures++;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: ble_sync_bench [--records N] [--read-us US] [--pdus-per-event N]\n"
+            "  --records N         weigh-ins in the log (default %d, the log capacity)\n"
+            "  --read-us US        cost of one flash read (default 400)\n"
+            "  --pdus-per-event N  central's limit per connection event (default: none)\n",
+            WEIGH_LOG_CAPACITY);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint32_t records = WEIGH_LOG_CAPACITY;
+    static const struct option opts[] = {
+        { "records", required_argument, NULL, 'n' },
+        { "read-us", required_argument, NULL, 'r' },
+        { "pdus-per-event", required_argument, NULL, 'p' },
+        { "help", no_argument, NULL, 'h' },
+        { 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "n:r:p:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'n': records = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'r': s_read_us = atoi(optarg); break;
+        case 'p': s_pdus_per_event = atoi(optarg); break;
+        default:  usage();
+        }
+    }
+    if (records < 100) {
+        fprintf(stderr, "--records must be at least 100\n");
+        return 2;
+    }
+
+    s_records_handle = 20;
+    s_racp_handle = 22;
+    s_task = (TaskHandle_t)&s_task;
+    if (weigh_log_init() != ESP_OK) return 1;
+    for (uint32_t seq = 1; seq <= records; seq++) {
+        weigh_log_append(record_weight(seq), (int64_t)seq * 1000000, (uint8_t)(seq % 4), NULL);
+    }
+    uint32_t first = weigh_log_first_seq(), last = weigh_log_last_seq();
+    uint32_t held = last - first + 1;
+
+    printf("History sync of %u records (seq %u..%u), flash read %d us, %s\n\n",
+           held, first, last, s_read_us,
+           s_pdus_per_event ? "PDU limit per event set" : "events limited by the interval only");
+    printf("  %-22s  MTU  DLE  PHY  interval  rec/PDU  LL PDUs   time     records/s\n", "");
+
+    static const link_cfg_t links[] = {
+        { "defaults",             23,  27, 1, 30000 },
+        { "MTU only",            256,  27, 1, 30000 },
+        { "MTU + DLE",           256, 251, 1, 30000 },
+        { "MTU + DLE, 15 ms",    256, 251, 1, 15000 },
+        { "MTU + DLE, 7.5 ms",   256, 251, 1,  7500 },
+        { "MTU + DLE, 2M PHY",   256, 251, 2, 30000 },
+        { "MTU 515 + DLE, 2M",   515, 251, 2, 30000 },
+    };
+    bool all_complete = true;
+    for (size_t i = 0; i < sizeof(links) / sizeof(links[0]); i++) {
+        const link_cfg_t *l = &links[i];
+        run_result_t r = run_sync(l, first);
+        int per_pdu = (l->mtu - 3) / BLE_HISTORY_RECORD_LEN;
+        if (per_pdu > HISTORY_MAX_RECORDS_PER_PDU) per_pdu = HISTORY_MAX_RECORDS_PER_PDU;
+        printf("  %-22s  %3u  %3u  %dM   %5.1f ms  %5d   %7llu  %6.2f s  %8.0f\n",
+               l->name, l->mtu, l->data_len, l->phy, l->interval_us / 1000.0, per_pdu,
+               (unsigned long long)r.ll_pdus, r.us / 1e6, r.us > 0 ? r.records * 1e6 / r.us : 0.0);
+        all_complete &= r.records == held && r.racp_code == RACP_RSP_SUCCESS;
+    }
+
+    printf("\nChecks (MTU 256, DLE 251, 1M, 30 ms)\n");
+    const link_cfg_t *ref = &links[2];
+    expect(all_complete && s_errors == 0, "every sync delivers each record once, in order");
+
+    run_result_t r = run_sync(ref, last - 99);
+    expect(r.records == 100 && r.racp_code == RACP_RSP_SUCCESS && s_errors == 0,
+           "resume from seq >= last-99 sends 100 records");
+
+    r = run_sync(ref, last + 1);
+    expect(r.records == 0 && r.racp_code == RACP_RSP_NO_RECORDS, "resume past the end answers NO RECORDS");
+
+    s_abort_after = held / 2;
+    r = run_sync(ref, first);
+    s_abort_after = 0;
+    expect(r.records >= held / 2 && r.records < held &&
+           r.racp_op == RACP_OP_ABORT && r.racp_code == RACP_RSP_SUCCESS,
+           "abort mid-sync stops the stream and confirms the abort");
+
+    s_fail_seq = first + held / 2;
+    r = run_sync(ref, first);
+    s_fail_seq = 0;
+    expect(r.records < held && r.racp_op == RACP_OP_REPORT_RECORDS &&
+           r.racp_code == RACP_RSP_NOT_COMPLETED,
+           "flash read failure mid-sync answers NOT COMPLETED");
+
+    r = run_sync(ref, first);
+    expect(r.records == held && r.racp_code == RACP_RSP_SUCCESS && s_errors == 0,
+           "a retry after the failure completes");
+
+    // Power lost mid-write: the newest slots fail their CRC
+    enum { TORN = 5 };
+    for (uint32_t seq = last - TORN + 1; seq <= last; seq++) {
+        s_file[(size_t)((seq - 1) % WEIGH_LOG_CAPACITY) * sizeof(weigh_log_record_t) + 8] ^= 0x5a;
+    }
+    r = run_sync(ref, first);
+    expect(r.records == held - TORN && r.racp_code == RACP_RSP_SUCCESS && s_errors == 0,
+           "torn newest slots are skipped and the sync completes");
+    r = run_sync(ref, last - TORN + 1);
+    expect(r.records == 0 && r.racp_code == RACP_RSP_SUCCESS,
+           "a resume into the torn tail completes with no records");
+    for (uint32_t seq = last - TORN + 1; seq <= last; seq++) {
+        s_file[(size_t)((seq - 1) % WEIGH_LOG_CAPACITY) * sizeof(weigh_log_record_t) + 8] ^= 0x5a;
+    }
+
+    printf("\n%s\n", s_failures ? "FAILED" : "All checks passed");
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,2 @@
+#include "host_idf.h"
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
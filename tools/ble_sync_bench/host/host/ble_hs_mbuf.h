@@ -0,0 +1 @@
+#include "nimble_host.h"
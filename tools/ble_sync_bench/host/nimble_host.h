@@ -0,0 +1,112 @@
+// File: tools/ble_sync_bench/host/nimble_host.h
+// ---------------------------------------------------------------------------
+// The part of the NimBLE host API that ble_history.c and
+// bluetooth_comm_gatt.h use, for the loopback bench. Every NimBLE header
+// under host/ includes this one; the functions are implemented by
+// ble_sync_bench.c on top of its link model.
+// ---------------------------------------------------------------------------
+#ifndef NIMBLE_HOST_H
+#define NIMBLE_HOST_H
+
+#include "host_idf.h"
+
+/* FreeRTOS task notifications (not in tools/scale_tune/host) */
+void xTaskNotifyGive(TaskHandle_t task);
+
+/* os/os_mbuf.h: a flat packet plus the msys blocks it holds */
+struct os_mbuf {
+    uint8_t *om_data;
+    uint16_t om_len;
+    uint8_t  om_blocks[2];      // Blocks taken from each msys pool
+};
+#define OS_MBUF_PKTLEN(om)      ((om)->om_len)
+int  os_mbuf_append(struct os_mbuf *om, const void *data, uint16_t len);
+int  os_mbuf_copydata(const struct os_mbuf *om, int off, int len, void *dst);
+void os_mbuf_free_chain(struct os_mbuf *om);
+int  os_msys_num_free(void);
+
+/* host/ble_hs_mbuf.h */
+struct os_mbuf *ble_hs_mbuf_from_flat(const void *buf, uint16_t len);
+
+/* host/ble_uuid.h */
+typedef struct { uint8_t type; } ble_uuid_t;
+typedef struct { ble_uuid_t u; uint16_t value; } ble_uuid16_t;
+typedef struct { ble_uuid_t u; uint8_t value[16]; } ble_uuid128_t;
+#define BLE_UUID_TYPE_16        16
+#define BLE_UUID_TYPE_128       128
+#define BLE_UUID16_INIT(v)      { .u = { .type = BLE_UUID_TYPE_16 }, .value = (v) }
+#define BLE_UUID128_INIT(...)   { .u = { .type = BLE_UUID_TYPE_128 }, .value = { __VA_ARGS__ } }
+#define BLE_UUID16_DECLARE(v)   ((const ble_uuid_t *)(&(ble_uuid16_t)BLE_UUID16_INIT(v)))
+uint16_t ble_uuid_u16(const ble_uuid_t *uuid);
+
+/* host/ble_gatt.h */
+struct ble_gatt_access_ctxt;
+typedef int ble_gatt_access_fn(uint16_t conn_handle, uint16_t attr_handle,
+                               struct ble_gatt_access_ctxt *ctxt, void *arg);
+struct ble_gatt_chr_def {
+    const ble_uuid_t   *uuid;
+    ble_gatt_access_fn *access_cb;
+    void               *arg;
+    void               *descriptors;
+    uint16_t            flags;
+    uint8_t             min_key_size;
+    uint16_t           *val_handle;
+};
+struct ble_gatt_svc_def {
+    uint8_t                         type;
+    const ble_uuid_t               *uuid;
+    const struct ble_gatt_svc_def **includes;
+    const struct ble_gatt_chr_def  *characteristics;
+};
+struct ble_gatt_access_ctxt {
+    uint8_t         op;
+    struct os_mbuf *om;
+    const struct ble_gatt_chr_def *chr;
+};
+#define BLE_GATT_SVC_TYPE_PRIMARY   1
+#define BLE_GATT_ACCESS_OP_READ_CHR 0
+#define BLE_GATT_ACCESS_OP_WRITE_CHR 1
+#define BLE_GATT_CHR_F_READ         0x0002
+#define BLE_GATT_CHR_F_WRITE        0x0008
+#define BLE_GATT_CHR_F_NOTIFY       0x0010
+#define BLE_GATT_CHR_F_INDICATE     0x0020
+int ble_gatts_count_cfg(const struct ble_gatt_svc_def *defs);
+int ble_gatts_add_svcs(const struct ble_gatt_svc_def *defs);
+int ble_gatts_notify_custom(uint16_t conn, uint16_t attr_handle, struct os_mbuf *om);
+int ble_gatts_indicate_custom(uint16_t conn, uint16_t attr_handle, struct os_mbuf *om);
+
+/* host/ble_gap.h */
+struct ble_gap_event {
+    uint8_t type;
+    union {
+        struct {
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t  reason;
+            uint8_t  prev_notify:1, cur_notify:1, prev_indicate:1, cur_indicate:1;
+        } subscribe;
+        struct {
+            int      status;
+            uint16_t conn_handle;
+            uint16_t attr_handle;
+            uint8_t  indication:1;
+        } notify_tx;
+    };
+};
+#define BLE_GAP_EVENT_DISCONNECT    1
+#define BLE_GAP_EVENT_NOTIFY_TX     13
+#define BLE_GAP_EVENT_SUBSCRIBE     14
+
+/* host/ble_hs.h */
+#define BLE_HS_CONN_HANDLE_NONE     0xffff
+#define BLE_HS_ENOMEM               6
+#define BLE_ATT_MTU_DFLT            23
+#define BLE_ATT_ATTR_MAX_LEN        512
+#define BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN      0x0d
+#define BLE_ATT_ERR_UNLIKELY                    0x0e
+#define BLE_ATT_ERR_INSUFFICIENT_RES            0x11
+#define BLE_ATT_ERR_CCCD_IMPROPERLY_CONFIGURED  0xfd
+#define BLE_ATT_ERR_PROC_IN_PROGRESS            0xfe
+uint16_t ble_att_mtu(uint16_t conn_handle);
+
+#endif // NIMBLE_HOST_H
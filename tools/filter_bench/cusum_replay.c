@@ -0,0 +1,120 @@
+// File: tools/filter_bench/cusum_replay.c
+// ---------------------------------------------------------------------------
+// Step detection: CUSUM change points vs the fixed raw-count threshold
+//   - change_detect.c fed calibrated grams, as hx711.c does once
+//     hx711_set_calibration() has run
+//   - Reference: the 1000-count STEP_THRESHOLD between consecutive raw
+//     conversions (the fallback before calibration), compared generously
+//     against the previous raw sample rather than the filtered output
+//   - Each run: QUIET_SAMPLES with the platform empty, then a step held
+//     for STEP_SAMPLES; Gaussian noise in counts
+//   - Latency in samples from the step to the first detection, missed
+//     steps, and false alarms per run in the quiet stretch
+//
+//   make -C tools/filter_bench cusum_replay
+//   tools/filter_bench/cusum_replay [--runs 200] [--counts-per-g 18] [--noise 50]
+// ---------------------------------------------------------------------------
+
+#include "change_detect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+
+#define QUIET_SAMPLES   500
+#define STEP_SAMPLES    100
+#define STEP_THRESHOLD  1000.0f     // hx711.c fallback, raw counts
+
+static uint64_t s_rng;
+
+static double gauss(void) {
+    s_rng = s_rng * 6364136223846793005ull + 1442695040888963407ull;
+    double u = ((s_rng >> 11) + 1.0) / 9007199254740994.0;
+    s_rng = s_rng * 6364136223846793005ull + 1442695040888963407ull;
+    double v = (s_rng >> 11) / 9007199254740992.0;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+typedef struct {
+    double latency_sum;
+    int    detected;
+    int    false_alarms;
+} detect_stats_t;
+
+static void report(const char *name, const detect_stats_t *s, int runs) {
+    if (s->detected) {
+        printf("  %-8s latency %5.2f samples  missed %3d/%d  false alarms/run %.3f",
+               name, s->latency_sum / s->detected, runs - s->detected, runs,
+               (double)s->false_alarms / runs);
+    } else {
+        printf("  %-8s latency     -           missed %3d/%d  false alarms/run %.3f",
+               name, runs, runs, (double)s->false_alarms / runs);
+    }
+}
+
+int main(int argc, char **argv) {
+    int runs = 200;
+    double cpg = 18.0, noise = 50.0;
+    static const struct option opts[] = {
+        { "runs", required_argument, NULL, 'r' },
+        { "counts-per-g", required_argument, NULL, 'c' },
+        { "noise", required_argument, NULL, 'n' },
+        { "help", no_argument, NULL, 'h' },
+        { 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "r:c:n:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'r': runs = atoi(optarg); break;
+        case 'c': cpg = atof(optarg); break;
+        case 'n': noise = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: cusum_replay [--runs N] [--counts-per-g X] [--noise COUNTS]\n");
+            return 2;
+        }
+    }
+    if (runs < 1 || cpg <= 0) return 2;
+
+    printf("%.0f counts/g, %.0f-count rms noise (%.1f g), %d runs of %d quiet + %d loaded samples\n",
+           cpg, noise, noise / cpg, runs, QUIET_SAMPLES, STEP_SAMPLES);
+
+    static const double steps_g[] = { 5, 10, 20, 50, 100, 1000, 70000, -20, -70000 };
+    for (size_t k = 0; k < sizeof(steps_g) / sizeof(steps_g[0]); k++) {
+        detect_stats_t cd = { 0 }, thr = { 0 };
+        for (int r = 0; r < runs; r++) {
+            s_rng = (uint64_t)r * 7919 + k + 1;
+            change_detect_t det;
+            change_detect_init(&det);
+            // Negative steps start loaded and step off
+            double base = steps_g[k] < 0 ? -steps_g[k] * cpg : 0.0;
+            double last = base;
+            int cd_at = -1, thr_at = -1;
+            for (int i = 0; i < QUIET_SAMPLES + STEP_SAMPLES; i++) {
+                double truth = i >= QUIET_SAMPLES ? base + steps_g[k] * cpg : base;
+                double raw = truth + noise * gauss();
+                cd_event_t ev = change_detect_update(&det, (float)(raw / cpg));
+                bool over = fabs(raw - last) > STEP_THRESHOLD;
+                last = raw;
+                // The first sample only primes the detector
+                if (i == 0) continue;
+                bool want = steps_g[k] > 0 ? ev == CD_EVENT_UP : ev == CD_EVENT_DOWN;
+                if (i < QUIET_SAMPLES) {
+                    cd.false_alarms += ev != CD_EVENT_NONE;
+                    thr.false_alarms += over;
+                } else {
+                    if (want && cd_at < 0) cd_at = i - QUIET_SAMPLES;
+                    if (over && thr_at < 0) thr_at = i - QUIET_SAMPLES;
+                }
+            }
+            if (cd_at >= 0) { cd.detected++; cd.latency_sum += cd_at; }
+            if (thr_at >= 0) { thr.detected++; thr.latency_sum += thr_at; }
+        }
+        printf("\n%+8.0f g\n", steps_g[k]);
+        report("CUSUM", &cd, runs);
+        printf("\n");
+        report("1000-ct", &thr, runs);
+        printf("\n");
+    }
+    return 0;
+}
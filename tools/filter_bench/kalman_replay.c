@@ -0,0 +1,199 @@
+// File: tools/filter_bench/kalman_replay.c
+// ---------------------------------------------------------------------------
+// Step response of the Kalman stages on synthetic weigh-ins
+//   - boost, re-armed  MA + scalar Kalman with the fixed 1000-count step
+//                      test and Q boost as first written: the boost was
+//                      reloaded on every boosted sample, so one step kept
+//                      the MA resetting for good
+//   - boost, expiring  the same with the boost running out after
+//                      BOOST_SAMPLES, as hx711.c does today on the
+//                      random-walk path before calibration
+//   - const velocity   kalman_update_cv() with main.c's KF_CV_* noise
+//   - Load steps from 0 to STEP_COUNTS at 10 and 80 SPS with Gaussian
+//     noise, optionally with a decaying 2 Hz sway after the step
+//   - Per filter: time until the output stays within +-SETTLE_BAND of the
+//     load, overshoot, and rms error once settled (from 8 s on)
+//
+//   make -C tools/filter_bench kalman_replay
+//   tools/filter_bench/kalman_replay [--trials 50] [--noise 50]
+// ---------------------------------------------------------------------------
+
+#include "kalman_filter.h"
+#include "moving_average.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+
+#define STEP_COUNTS     1.3e6       // ~72 kg at 18 counts/g
+#define SETTLE_BAND     500.0
+#define STEP_AT_S       1.0
+#define RUN_S           12.0
+#define STEADY_FROM_S   8.0
+
+// main.c / hx711.c constants
+#define MA_WINDOW       8
+#define KF_Q_INIT       0.5f
+#define KF_R_INIT       1.0f
+#define KF_CV_ACCEL     1.0e3f
+#define STEP_THRESHOLD  1000.0f
+#define BOOSTED_Q       10.0f
+#define NORMAL_Q        0.5f
+#define BOOST_SAMPLES   5
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t s) { }
+
+typedef enum { F_BOOST_REARMED, F_BOOST_EXPIRING, F_CV, F_COUNT } filter_id_t;
+
+static const char *const k_names[F_COUNT] = { "boost, re-armed", "boost, expiring", "const velocity" };
+
+typedef struct {
+    moving_avg_t ma;
+    float        ma_buf[MA_WINDOW];
+    KalmanFilter kf;
+    int          boost;
+    float        last;
+    bool         rearm;
+} boost_chain_t;
+
+static void boost_init(boost_chain_t *b, bool rearm) {
+    moving_average_init(&b->ma, b->ma_buf, MA_WINDOW);
+    kalman_init_adaptive(&b->kf, KF_Q_INIT, KF_R_INIT);
+    b->boost = 0;
+    b->last = 0;
+    b->rearm = rearm;
+}
+
+static float boost_update(boost_chain_t *b, float w) {
+    bool step = fabsf(w - b->last) > STEP_THRESHOLD;
+    if (b->rearm) {
+        // Every test saw boost > 0 as a step, so the boost never ran out
+        step |= b->boost > 0;
+    }
+    if (step) {
+        moving_average_reset(&b->ma, w);
+        b->boost = BOOST_SAMPLES;
+    }
+    w = moving_average_update(&b->ma, w);
+    if (b->boost > 0) {
+        b->kf.Q = BOOSTED_Q;
+        if (--b->boost == 0) b->kf.Q = NORMAL_Q;
+    }
+    w = kalman_update_adaptive(&b->kf, w);
+    b->last = w;
+    return w;
+}
+
+static uint64_t s_rng;
+
+static double gauss(void) {
+    s_rng = s_rng * 6364136223846793005ull + 1442695040888963407ull;
+    double u = ((s_rng >> 11) + 1.0) / 9007199254740994.0;
+    s_rng = s_rng * 6364136223846793005ull + 1442695040888963407ull;
+    double v = (s_rng >> 11) / 9007199254740992.0;
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+typedef struct {
+    double settle_s, overshoot_pct, rms;
+} response_t;
+
+static void run(float sps, bool sway, int trials, double noise, response_t out[F_COUNT]) {
+    const float dt = 1.0f / sps;
+    const int n = (int)(sps * RUN_S);
+
+    for (int f = 0; f < F_COUNT; f++) out[f] = (response_t){ 0 };
+    for (int t = 0; t < trials; t++) {
+        s_rng = (uint64_t)t + 1;
+        boost_chain_t rearmed, expiring;
+        boost_init(&rearmed, true);
+        boost_init(&expiring, false);
+        KalmanFilter cv;
+        kalman_init_cv(&cv, KF_CV_ACCEL, (float)(noise * noise), 0.0f);
+
+        double last_out[F_COUNT], peak[F_COUNT] = { 0 }, se[F_COUNT] = { 0 };
+        int steady = 0;
+        for (int f = 0; f < F_COUNT; f++) last_out[f] = STEP_AT_S;
+        for (int i = 0; i < n; i++) {
+            double ts = i * (double)dt;
+            double load = ts >= STEP_AT_S ? STEP_COUNTS : 0.0;
+            double z = load + noise * gauss();
+            if (sway && ts >= STEP_AT_S) {
+                z += 0.03 * STEP_COUNTS * exp(-(ts - STEP_AT_S) / 0.6) * sin(2.0 * M_PI * 2.0 * (ts - STEP_AT_S));
+            }
+            float y[F_COUNT] = {
+                boost_update(&rearmed, (float)z),
+                boost_update(&expiring, (float)z),
+                kalman_update_cv(&cv, (float)z, dt),
+            };
+            if (ts < STEP_AT_S) continue;
+            for (int f = 0; f < F_COUNT; f++) {
+                double e = y[f] - STEP_COUNTS;
+                if (fabs(e) > SETTLE_BAND) last_out[f] = ts + dt;
+                if (e > peak[f]) peak[f] = e;
+                if (ts >= STEADY_FROM_S) se[f] += e * e;
+            }
+            if (ts >= STEADY_FROM_S) steady++;
+        }
+        for (int f = 0; f < F_COUNT; f++) {
+            out[f].settle_s += last_out[f] - STEP_AT_S;
+            out[f].overshoot_pct += peak[f] / STEP_COUNTS * 100.0;
+            out[f].rms += sqrt(se[f] / steady);
+        }
+    }
+    for (int f = 0; f < F_COUNT; f++) {
+        out[f].settle_s /= trials;
+        out[f].overshoot_pct /= trials;
+        out[f].rms /= trials;
+    }
+}
+
+int main(int argc, char **argv) {
+    int trials = 50;
+    double noise = 50.0;
+    static const struct option opts[] = {
+        { "trials", required_argument, NULL, 't' },
+        { "noise", required_argument, NULL, 'n' },
+        { "help", no_argument, NULL, 'h' },
+        { 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "t:n:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 't': trials = atoi(optarg); break;
+        case 'n': noise = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: kalman_replay [--trials N] [--noise COUNTS]\n");
+            return 2;
+        }
+    }
+    if (trials < 1) trials = 1;
+
+    printf("%.0f-count step, %.0f-count rms noise, %d trials, settle band +-%.0f counts\n",
+           STEP_COUNTS, noise, trials, SETTLE_BAND);
+    printf("  %-16s", "");
+    for (int f = 0; f < F_COUNT; f++) printf("  %-24s", k_names[f]);
+    printf("\n  %-16s", "");
+    for (int f = 0; f < F_COUNT; f++) printf("  %-24s", "settle  overshoot  rms");
+    printf("\n");
+
+    static const float rates[] = { 10.0f, 80.0f };
+    for (int r = 0; r < 2; r++) {
+        for (int sway = 0; sway < 2; sway++) {
+            response_t res[F_COUNT];
+            run(rates[r], sway, trials, noise, res);
+            char label[32];
+            snprintf(label, sizeof(label), "%2.0f Hz %s", rates[r], sway ? "step+sway" : "step");
+            printf("  %-16s", label);
+            for (int f = 0; f < F_COUNT; f++) {
+                printf("  %5.2f s  %6.2f%%  %5.1f", res[f].settle_s, res[f].overshoot_pct, res[f].rms);
+            }
+            printf("\n");
+        }
+    }
+    return 0;
+}
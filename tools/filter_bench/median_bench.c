@@ -0,0 +1,163 @@
+// File: tools/filter_bench/median_bench.c
+// ---------------------------------------------------------------------------
+// Streaming sliding median vs the burst median3 cascade it replaced
+//   - Correctness: median_filter_update() against a sort of the last
+//     `width` samples, widths 1..MEDIAN_CAP changing every few hundred
+//     samples (the window refills from the raw history)
+//   - Speed and spike rejection on a constant load with uniform noise and
+//     impulsive spikes: the streaming filter gives one output per
+//     conversion, the cascade one per burst of `width` conversions
+//
+//   make -C tools/filter_bench median_bench
+//   tools/filter_bench/median_bench [--samples 1000000] [--spike-pct 2]
+// ---------------------------------------------------------------------------
+
+#include "median_filter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <getopt.h>
+
+#define MEDIAN_CAP      11          // SCALE_CFG_MEDIAN_MAX (scale_config.h)
+#define LOAD            100000.0f   // Raw counts
+#define NOISE           10.0f       // Uniform +-NOISE counts
+#define SPIKE           5000.0f     // Impulse height, either sign
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static float median3(float a, float b, float c) {
+    if (a > b) { float t = a; a = b; b = t; }
+    if (b > c) { float t = b; b = c; c = t; }
+    if (a > b) { float t = a; a = b; b = t; }
+    return b;
+}
+
+// The removed hx711_read_median_rtos: median3 slid over one burst, the
+// last value is the output
+static float cascade(float *burst, int width) {
+    for (int k = 2; k < width; k++) {
+        burst[k] = median3(burst[k - 2], burst[k - 1], burst[k]);
+    }
+    return burst[width - 1];
+}
+
+static int cmp_float(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Median of the last min(n, width) samples; even counts average the middle two
+static float reference(const float *hist, int n, int width) {
+    float t[MEDIAN_CAP];
+    int k = n < width ? n : width;
+    memcpy(t, hist + n - k, (size_t)k * sizeof(float));
+    qsort(t, (size_t)k, sizeof(float), cmp_float);
+    return (k & 1) ? t[k / 2] : 0.5f * (t[k / 2 - 1] + t[k / 2]);
+}
+
+static int check_against_sort(int n) {
+    float *hist = malloc((size_t)n * sizeof(float));
+    median_filter_t f;
+    int bad = 0;
+
+    srand(1);
+    median_filter_init(&f, MEDIAN_CAP, 5);
+    for (int i = 0; i < n; i++) {
+        if (i % 997 == 0) {
+            median_filter_set_width(&f, 1 + rand() % MEDIAN_CAP);
+        }
+        hist[i] = (float)(rand() % 1000);
+        float got = median_filter_update(&f, hist[i]);
+        float want = reference(hist, i + 1, median_filter_get_width(&f));
+        if (fabsf(got - want) > 1e-3f && bad++ < 5) {
+            fprintf(stderr, "sample %d width %d: median %g, expected %g\n",
+                    i, median_filter_get_width(&f), got, want);
+        }
+    }
+    median_filter_deinit(&f);
+    free(hist);
+    return bad;
+}
+
+int main(int argc, char **argv) {
+    int n = 1000000;
+    double spike_pct = 2.0;
+    static const struct option opts[] = {
+        { "samples", required_argument, NULL, 'n' },
+        { "spike-pct", required_argument, NULL, 's' },
+        { "help", no_argument, NULL, 'h' },
+        { 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "n:s:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'n': n = atoi(optarg); break;
+        case 's': spike_pct = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: median_bench [--samples N] [--spike-pct P]\n");
+            return 2;
+        }
+    }
+    if (n < 1000) n = 1000;
+
+    int bad = check_against_sort(200000);
+    printf("Against a sorted window, widths 1-%d with changes: %d mismatches\n\n", MEDIAN_CAP, bad);
+
+    float *x = malloc((size_t)n * sizeof(float));
+    srand(2);
+    for (int i = 0; i < n; i++) {
+        x[i] = LOAD + NOISE * ((rand() % 2001) - 1000) / 1000.0f;
+        if (rand() < spike_pct / 100.0 * RAND_MAX) {
+            x[i] += (rand() & 1) ? SPIKE : -SPIKE;
+        }
+    }
+
+    printf("%d conversions, %.1f%% spikes of +-%.0f counts\n", n, spike_pct, SPIKE);
+    printf("  width  streaming ns/sample  rms err  max err  |  cascade ns/output  rms err  max err\n");
+    volatile float sink = 0;
+    for (int w = 3; w <= MEDIAN_CAP; w += 4) {
+        median_filter_t f;
+        median_filter_init(&f, MEDIAN_CAP, w);
+        double se = 0, max = 0;
+        double t0 = now_ns();
+        for (int i = 0; i < n; i++) {
+            float m = median_filter_update(&f, x[i]);
+            sink += m;
+            if (i >= w) {
+                double e = fabs(m - LOAD);
+                se += e * e;
+                if (e > max) max = e;
+            }
+        }
+        double t_stream = (now_ns() - t0) / n;
+        double rms_stream = sqrt(se / (n - w)), max_stream = max;
+        median_filter_deinit(&f);
+
+        float burst[MEDIAN_CAP];
+        int outs = 0;
+        se = max = 0;
+        t0 = now_ns();
+        for (int i = 0; i + w <= n; i += w) {
+            memcpy(burst, &x[i], (size_t)w * sizeof(float));
+            float m = cascade(burst, w);
+            sink += m;
+            double e = fabs(m - LOAD);
+            se += e * e;
+            if (e > max) max = e;
+            outs++;
+        }
+        double t_casc = (now_ns() - t0) / outs;
+        printf("  %5d  %19.1f  %7.1f  %7.0f  |  %17.1f  %7.1f  %7.0f\n",
+               w, t_stream, rms_stream, max_stream, t_casc, sqrt(se / outs), max);
+    }
+    printf("\nThe cascade needs `width` conversions per output, the streaming median one.\n");
+    free(x);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,332 @@
+// File: tools/host_checks/config_check.c
+// ---------------------------------------------------------------------------
+// Live configuration slot reuse and grace period
+//   - scale_config.c compiled in unchanged and reset between cases; NVS is
+//     one in-memory blob, vTaskDelay() advances a virtual tick and lets a
+//     scheduled reader release while a publish waits out its grace period
+//   - A reader holding an old version keeps its slot (and every newer one)
+//     from being reused: publishes fill the spare slots, then wait exactly
+//     SCALE_CONFIG_GRACE_MS and fail with ESP_ERR_TIMEOUT
+//   - A release or re-acquire during the wait ends it on that tick
+//   - Random acquire/release/publish interleavings across all readers:
+//     a held object must never change under its reader
+//   - Persist and reload, rejected and foreign-layout blobs, validation
+//
+//   make -C tools/host_checks config_check
+//   tools/host_checks/config_check [--steps 200000] [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "scale_config.c"
+
+#define READERS     SCALE_CONFIG_MAX_READERS
+
+/* --------------------------- Host stand-ins ----------------------------- */
+
+static TickType_t s_tick;
+static TickType_t s_release_at;     // Tick at which s_release_reader lets go
+static int        s_release_reader = -1;
+
+static uint8_t    s_blob[2 * sizeof(scale_config_t)];
+static size_t     s_blob_len;       // 0 = no key
+static bool       s_nvs_fail;
+
+static int        s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+uint32_t esp_log_timestamp(void) { return s_tick; }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+
+void vTaskDelay(TickType_t ticks) {
+    s_tick += ticks;
+    if (s_release_reader >= 0 && s_tick >= s_release_at) {
+        scale_config_release(s_release_reader);
+        s_release_reader = -1;
+    }
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h) {
+    if (s_nvs_fail) return ESP_FAIL;
+    *h = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t h) { }
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len) {
+    if (s_blob_len == 0) return ESP_ERR_NOT_FOUND;
+    if (*len < s_blob_len) return ESP_ERR_INVALID_SIZE;
+    memcpy(out, s_blob, s_blob_len);
+    *len = s_blob_len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len) {
+    if (len > sizeof(s_blob)) return ESP_ERR_INVALID_SIZE;
+    memcpy(s_blob, val, len);
+    s_blob_len = len;
+    return ESP_OK;
+}
+
+/** Fresh boot: module statics back to zero, NVS kept */
+static void reboot(void) {
+    memset(s_slots, 0, sizeof(s_slots));
+    memset(s_seen, 0, sizeof(s_seen));
+    s_current = NULL;
+    s_version = 0;
+    s_reader_count = 0;
+    s_write_lock = NULL;
+    s_release_reader = -1;
+    CHECK(scale_config_init() == ESP_OK, "init failed");
+}
+
+static scale_config_t with_wake(float wake_g) {
+    scale_config_t c;
+    scale_config_snapshot(&c);
+    c.wake_threshold_g = wake_g;
+    return c;
+}
+
+/* ------------------------------- Cases ---------------------------------- */
+
+static void check_grace(void) {
+    s_blob_len = 0;
+    reboot();
+    int r = scale_config_register_reader("held");
+    const scale_config_t *held = scale_config_acquire(r);
+    CHECK(held->version == 1 && held->wake_threshold_g == 20.0f, "defaults not at v1");
+
+    // Two spare slots: both publishes go through without waiting
+    TickType_t t0 = s_tick;
+    scale_config_t c = with_wake(30.0f);
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish v2");
+    c = with_wake(40.0f);
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish v3");
+    CHECK(s_tick == t0, "publish into a spare slot waited %u ticks", (unsigned)(s_tick - t0));
+
+    // v1 pins every slot: the third waits the whole grace period
+    const char *why = NULL;
+    c = with_wake(50.0f);
+    t0 = s_tick;
+    esp_err_t err = scale_config_publish(&c, false, &why);
+    CHECK(err == ESP_ERR_TIMEOUT, "publish with every slot pinned returned %d", err);
+    CHECK(s_tick - t0 == SCALE_CONFIG_GRACE_MS, "timed out after %u ticks", (unsigned)(s_tick - t0));
+    CHECK(why && strstr(why, "readers"), "timeout reason missing");
+    CHECK(held->version == 1 && held->wake_threshold_g == 20.0f, "held v1 changed");
+    CHECK(s_version == 3, "failed publish bumped the version to %u", (unsigned)s_version);
+    printf("pinned       2 spare publishes in 0 ticks, 3rd timed out after %u ticks\n",
+           (unsigned)(s_tick - t0));
+
+    // The reader quiesces 250 ticks into the wait
+    s_release_reader = r;
+    s_release_at = s_tick + 250;
+    t0 = s_tick;
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish after release");
+    CHECK(s_tick - t0 == 250, "release at 250 ended the wait after %u ticks", (unsigned)(s_tick - t0));
+    held = scale_config_acquire(r);
+    CHECK(held->version == 4 && held->wake_threshold_g == 50.0f, "reader did not see v4");
+    CHECK(held == &s_slots[0], "v4 did not reuse the v1 slot");
+    printf("release      wait ended on the release tick (%u), v4 reused the v1 slot\n",
+           (unsigned)(s_tick - t0));
+
+    // A reader that moves on to the current version frees the older slots
+    c = with_wake(60.0f);
+    t0 = s_tick;
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish v5");
+    c = with_wake(70.0f);
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish v6");
+    CHECK(s_tick == t0, "v2/v3 slots older than the held v4 were not reused");
+    c = with_wake(80.0f);
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_ERR_TIMEOUT, "v7 should wait out v4");
+    scale_config_release(r);
+    const scale_config_t *now = scale_config_acquire(r);
+    CHECK(now->version == 6, "re-acquire saw v%u", (unsigned)now->version);
+    t0 = s_tick;
+    CHECK(scale_config_publish(&c, false, NULL) == ESP_OK, "publish after re-acquire");
+    CHECK(s_tick == t0, "re-acquired reader still pinned an old slot");
+    CHECK(now->version == 6 && now->wake_threshold_g == 70.0f, "re-acquired object changed");
+    scale_config_release(r);
+}
+
+static void check_interleavings(long steps, unsigned seed) {
+    s_blob_len = 0;
+    reboot();
+    srand(seed);
+    int id[READERS];
+    const scale_config_t *held[READERS] = { 0 };
+    scale_config_t copy[READERS];
+    for (int i = 0; i < READERS; i++) {
+        id[i] = scale_config_register_reader("stress");
+    }
+
+    long publishes = 0, timeouts = 0, waited = 0;
+    for (long n = 0; n < steps; n++) {
+        int r = rand() % (READERS + 1);
+        if (r == READERS) {
+            // Writer; a random reader may quiesce part-way through the wait
+            int who = rand() % READERS;
+            if (held[who] && rand() % 2) {
+                s_release_reader = id[who];
+                s_release_at = s_tick + 1 + rand() % (2 * SCALE_CONFIG_GRACE_MS);
+            }
+            scale_config_t c = with_wake(20.0f + (float)(n % 1000));
+            TickType_t t0 = s_tick;
+            esp_err_t err = scale_config_publish(&c, false, NULL);
+            waited += s_tick - t0;
+            if (err == ESP_OK) {
+                publishes++;
+            } else {
+                CHECK(err == ESP_ERR_TIMEOUT, "publish returned %d", err);
+                timeouts++;
+            }
+            if (s_release_reader < 0 && held[who] && s_seen[id[who]] == 0) {
+                held[who] = NULL;
+            }
+            s_release_reader = -1;
+        } else if (held[r]) {
+            CHECK(memcmp(held[r], &copy[r], sizeof(copy[r])) == 0,
+                  "reader %d: v%u changed while held", r, (unsigned)copy[r].version);
+            scale_config_release(id[r]);
+            held[r] = NULL;
+        } else {
+            held[r] = scale_config_acquire(id[r]);
+            copy[r] = *held[r];
+            CHECK(copy[r].version == s_version, "acquired v%u, current v%u",
+                  (unsigned)copy[r].version, (unsigned)s_version);
+        }
+        for (int i = 0; i < READERS; i++) {
+            CHECK(!held[i] || memcmp(held[i], &copy[i], sizeof(copy[i])) == 0,
+                  "reader %d: v%u overwritten", i, (unsigned)copy[i].version);
+        }
+        if (s_failures > 10) break;
+    }
+    printf("interleaved  %ld steps, %d readers: %ld published, %ld timed out, %.1f ticks waited per publish\n",
+           steps, READERS, publishes, timeouts,
+           publishes + timeouts ? (double)waited / (double)(publishes + timeouts) : 0.0);
+}
+
+static void check_persist(void) {
+    s_blob_len = 0;
+    reboot();
+    scale_config_t c = with_wake(35.0f);
+    c.median_max = 9;
+    CHECK(scale_config_publish(&c, true, NULL) == ESP_OK, "persisting publish");
+    CHECK(s_blob_len == sizeof(scale_config_t), "blob not written");
+
+    reboot();
+    const scale_config_t *cur = scale_config_acquire(-1);
+    CHECK(cur == scale_config_defaults(), "unregistered reader did not get the defaults");
+    scale_config_snapshot(&c);
+    CHECK(c.version == 2 && c.wake_threshold_g == 35.0f && c.median_max == 9,
+          "reload gave v%u wake %.1f", (unsigned)c.version, c.wake_threshold_g);
+
+    // A stored object that no longer validates is dropped
+    scale_config_t bad = c;
+    bad.sleep_threshold_g = bad.wake_threshold_g;
+    nvs_set_blob(1, SCALE_CFG_NVS_KEY, &bad, sizeof(bad));
+    reboot();
+    scale_config_snapshot(&c);
+    CHECK(c.version == 1 && c.wake_threshold_g == 20.0f, "invalid blob was loaded");
+
+    // So is a blob from an older layout
+    nvs_set_blob(1, SCALE_CFG_NVS_KEY, &bad, sizeof(bad) - 4);
+    reboot();
+    scale_config_snapshot(&c);
+    CHECK(c.version == 1, "short blob was loaded");
+
+    // And a failed save still publishes
+    s_nvs_fail = true;
+    c = with_wake(45.0f);
+    CHECK(scale_config_publish(&c, true, NULL) == ESP_FAIL, "save failure not reported");
+    scale_config_snapshot(&c);
+    CHECK(c.version == 2 && c.wake_threshold_g == 45.0f, "unsaved object not published");
+    s_nvs_fail = false;
+
+    // Reader table
+    for (int i = 0; i < READERS; i++) {
+        CHECK(scale_config_register_reader("r") == i, "reader %d not registered", i);
+    }
+    CHECK(scale_config_register_reader("extra") == -1, "reader table overflowed");
+    printf("persist      reload, invalid and short blobs, failed save, reader table ok\n");
+}
+
+static void check_validate(void) {
+    static const struct { const char *field; double value; } bad[] = {
+        { "sleep_threshold_g",  20.0 },     // == wake
+        { "wake_threshold_g",   -1.0 },
+        { "debounce_count",     0.0 },
+        { "stable_count",       SCALE_CFG_STABLE_COUNT_MAX + 1 },
+        { "stable_tolerance_g", 0.0 },
+        { "kf_q_boosted",       0.1 },      // < kf_q_normal
+        { "kf_q_max",           0.0001 },   // < kf_q_min
+        { "kf_r_min",           0.0 },
+        { "cd_h_sigma",         1.0 },      // <= cd_k_sigma
+        { "median_max",         SCALE_CFG_MEDIAN_MAX + 1 },
+        { "median_min",         0.0 },
+        { "median_step",        0.0 },
+    };
+    const scale_config_t *def = scale_config_defaults();
+    const char *why = NULL;
+    CHECK(scale_config_validate(def, &why) == ESP_OK, "defaults rejected: %s", why);
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        scale_config_t c = *def;
+        CHECK(scale_config_set_field(&c, bad[i].field, bad[i].value), "no field %s", bad[i].field);
+        why = NULL;
+        CHECK(scale_config_validate(&c, &why) == ESP_ERR_INVALID_ARG && why,
+              "%s = %g accepted", bad[i].field, bad[i].value);
+    }
+    scale_config_t c = *def;
+    CHECK(!scale_config_set_field(&c, "debounce_count", 256.0), "u8 overflow accepted");
+    CHECK(!scale_config_set_field(&c, "no_such_field", 1.0), "unknown field accepted");
+    printf("validate     %zu invalid candidates rejected\n", sizeof(bad) / sizeof(bad[0]));
+}
+
+int main(int argc, char **argv) {
+    long steps = 200000;
+    unsigned seed = 1;
+    static const struct option opts[] = {
+        { "steps", required_argument, NULL, 'n' },
+        { "seed",  required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n': steps = atol(optarg); break;
+        case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [--steps N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("%d slots, %d readers, %d ms grace\n", SCALE_CONFIG_SLOTS, READERS, SCALE_CONFIG_GRACE_MS);
+    check_grace();
+    check_interleavings(steps, seed);
+    check_persist();
+    check_validate();
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
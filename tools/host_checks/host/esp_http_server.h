@@ -0,0 +1 @@
+#include "http_host.h"
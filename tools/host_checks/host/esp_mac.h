@@ -0,0 +1 @@
+#include "mqtt_host.h"
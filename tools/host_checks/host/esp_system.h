@@ -0,0 +1 @@
+#include "rest_host.h"
@@ -0,0 +1 @@
+#include "res_host.h"
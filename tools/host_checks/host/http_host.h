@@ -0,0 +1,106 @@
+// File: tools/host_checks/host/http_host.h
+// ---------------------------------------------------------------------------
+// A fake esp_http_server and esp_spiffs for web_assets_check.c (which
+// implements them): the request carries the client's headers in, and the
+// response is captured the way the client would see it. httpd_bench
+// implements the same API over sockets and threads, which is why the
+// route, config and async request parts are here too.
+// ---------------------------------------------------------------------------
+#ifndef HTTP_HOST_H
+#define HTTP_HOST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/types.h>
+#include "host_idf.h"
+
+/* esp_http_server.h */
+#define ESP_ERR_HTTPD_RESULT_TRUNC  0xb006
+#define HTTPD_RESP_USE_STRLEN       -1
+
+typedef void *httpd_handle_t;
+typedef enum { HTTPD_400_BAD_REQUEST, HTTPD_404_NOT_FOUND, HTTPD_500_INTERNAL_SERVER_ERROR } httpd_err_code_t;
+typedef enum { HTTP_DELETE, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT } httpd_method_t;
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match,
+                                       size_t match_upto);
+
+typedef struct httpd_config {
+    uint16_t    max_open_sockets;
+    uint16_t    max_uri_handlers;
+    uint16_t    backlog_conn;
+    bool        lru_purge_enable;
+    uint16_t    recv_wait_timeout;
+    uint16_t    send_wait_timeout;
+    bool        keep_alive_enable;
+    int         keep_alive_idle;
+    int         keep_alive_interval;
+    int         keep_alive_count;
+    httpd_uri_match_func_t uri_match_fn;
+} httpd_config_t;
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int         method;
+    char        uri[513];
+    size_t      content_len;
+    void       *aux;                // Server's session
+    void       *user_ctx;           // From the matched httpd_uri_t
+    const char *accept_encoding;    // NULL: header absent
+    const char *if_none_match;
+
+    int         status;             // 200 unless set
+    char        type[48];
+    char        hdrs[512];          // "Name: value\n" per header
+    char       *body;
+    size_t      body_len;
+    int         chunks;             // httpd_resp_send_chunk calls with data
+    bool        done;               // Response complete
+} httpd_req_t;
+
+typedef struct httpd_uri {
+    const char     *uri;
+    httpd_method_t  method;
+    esp_err_t     (*handler)(httpd_req_t *req);
+    void           *user_ctx;
+} httpd_uri_t;
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t len);
+size_t    httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field);
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len);
+esp_err_t httpd_resp_send_500(httpd_req_t *req);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t err, const char *msg);
+int       httpd_req_recv(httpd_req_t *req, char *buf, size_t len);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t len);
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t len);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+bool      httpd_uri_match_wildcard(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out);
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r);
+
+// Inline in esp_http_server.h as well
+static inline esp_err_t httpd_resp_sendstr(httpd_req_t *r, const char *str) {
+    return httpd_resp_send(r, str, str ? (ssize_t)strlen(str) : 0);
+}
+static inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str) {
+    return httpd_resp_send_chunk(r, str, str ? (ssize_t)strlen(str) : 0);
+}
+static inline esp_err_t httpd_resp_send_404(httpd_req_t *r) {
+    return httpd_resp_send_err(r, HTTPD_404_NOT_FOUND, NULL);
+}
+
+/* esp_spiffs.h */
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    size_t      max_files;
+    bool        format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+
+#endif
@@ -0,0 +1,83 @@
+// File: tools/host_checks/host/mqtt_host.h
+// ---------------------------------------------------------------------------
+// esp-mqtt client, esp_mac, the NVS u32 accessors and CRC-16 for the host
+// builds of mqtt_uplink.c and weigh_log.c. Each program implements them:
+// mqtt_uplink_check.c with an in-process broker, tools/scale_fleet over a
+// socket.
+// ---------------------------------------------------------------------------
+#ifndef MQTT_HOST_H
+#define MQTT_HOST_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "host_idf.h"
+
+/* esp_err.h */
+#define ESP_ERROR_CHECK(x) do { if ((x) != ESP_OK) abort(); } while (0)
+
+/* freertos/task.h */
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+/* esp_event.h */
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+#define ESP_EVENT_ANY_ID    -1
+
+/* esp_mac.h */
+typedef enum { ESP_MAC_WIFI_STA } esp_mac_type_t;
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+/* nvs.h */
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out);
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t value);
+
+/* esp_rom_crc.h */
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+/* mqtt_client.h */
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    int error_type;
+} esp_mqtt_error_codes_t;
+
+typedef struct {
+    esp_mqtt_event_id_t       event_id;
+    esp_mqtt_client_handle_t  client;
+    int                       msg_id;
+    esp_mqtt_error_codes_t   *error_handle;
+} esp_mqtt_event_t;
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+typedef struct {
+    struct {
+        struct { const char *uri; } address;
+        struct { const char *certificate; } verification;
+    } broker;
+    struct {
+        const char *username;
+        struct { const char *password; } authentication;
+    } credentials;
+    struct { int keepalive; } session;
+    struct { int priority; } task;
+} esp_mqtt_client_config_t;
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config);
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *arg);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client);
+int       esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                                  int len, int qos, int retain);
+
+#endif // MQTT_HOST_H
@@ -0,0 +1,43 @@
+// File: tools/host_checks/host/res_host.h
+// ---------------------------------------------------------------------------
+// Static task/queue creation, heap_caps and the cJSON hooks on top of the
+// scale_tune host layer, for resources_check.c (which implements them).
+// ---------------------------------------------------------------------------
+#ifndef RES_HOST_H
+#define RES_HOST_H
+
+#include "host_idf.h"
+
+/* freertos/task.h, freertos/queue.h (static creation) */
+typedef uint8_t StackType_t;        // ESP-IDF counts stack depth in bytes
+typedef struct { int reserved[24]; } StaticTask_t;
+typedef struct { int reserved[20]; } StaticQueue_t;
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_bytes,
+                                           void *arg, UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core);
+void         vTaskDelete(TaskHandle_t task);
+char        *pcTaskGetName(TaskHandle_t task);
+UBaseType_t  uxTaskPriorityGet(TaskHandle_t task);
+UBaseType_t  uxTaskGetStackHighWaterMark(TaskHandle_t task);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *qcb);
+
+/* esp_heap_caps.h */
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+void  *heap_caps_malloc(size_t size, uint32_t caps);
+void  *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void   heap_caps_free(void *ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/* cJSON.h (hooks only) */
+typedef struct cJSON_Hooks {
+    void *(*malloc_fn)(size_t size);
+    void  (*free_fn)(void *ptr);
+} cJSON_Hooks;
+void cJSON_InitHooks(cJSON_Hooks *hooks);
+
+#endif // RES_HOST_H
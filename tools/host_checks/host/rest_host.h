@@ -0,0 +1,49 @@
+// File: tools/host_checks/host/rest_host.h
+// ---------------------------------------------------------------------------
+// The rest of what rest_api.c compiles against: the cJSON subset it uses,
+// counting semaphores, task notifications and newlib's strlcpy. Implemented
+// by httpd_bench (threads) and tools/scale_fleet (one poll loop).
+// ---------------------------------------------------------------------------
+#ifndef REST_HOST_H
+#define REST_HOST_H
+
+#include "res_host.h"
+#include "http_host.h"
+
+/* freertos/task.h, freertos/semphr.h */
+BaseType_t        xTaskNotifyGive(TaskHandle_t task);
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial,
+                                                 StaticSemaphore_t *buf);
+
+/* string.h (newlib) */
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+/* cJSON.h */
+#define cJSON_Invalid   0
+typedef struct cJSON {
+    struct cJSON *next, *prev, *child;
+    int     type;
+    char   *valuestring;
+    int     valueint;
+    double  valuedouble;
+    char   *string;
+} cJSON;
+
+cJSON *cJSON_Parse(const char *value);
+cJSON *cJSON_CreateObject(void);
+cJSON *cJSON_AddObjectToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name);
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number);
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string);
+bool   cJSON_AddItemToArray(cJSON *array, cJSON *item);
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *name);
+bool   cJSON_IsNumber(const cJSON *item);
+bool   cJSON_IsString(const cJSON *item);
+bool   cJSON_IsObject(const cJSON *item);
+char  *cJSON_PrintUnformatted(const cJSON *item);
+void   cJSON_Delete(cJSON *item);
+void   cJSON_free(void *object);
+#define cJSON_ArrayForEach(element, array) \
+    for (element = (array) ? (array)->child : NULL; element; element = element->next)
+
+#endif // REST_HOST_H
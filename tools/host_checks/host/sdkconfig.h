@@ -0,0 +1,2 @@
+// Host build: no Kconfig values are needed by the modules under test
+#pragma once
@@ -0,0 +1,245 @@
+// File: tools/host_checks/jitter_check.c
+// ---------------------------------------------------------------------------
+// Sampling jitter monitor on synthetic HX711 sample streams
+//   - jitter_monitor.c compiled in unchanged
+//   - Bin edges: every edge and the microsecond below it
+//   - Exact streams with known answers: one latency per bin at a fixed
+//     period, alternating period deviation, late samples, a skipped
+//     conversion after warm-up, and timeouts/pauses breaking the chain
+//   - A 10 and 80 SPS run, idle and with TLS-handshake bursts delaying the
+//     sampling task, printed as the histograms GET /jitter would show
+//   - JSON: read back against jitter_monitor_get(), exact-size buffer,
+//     and the longest object possible still fits GET /jitter's buffer
+//
+//   make -C tools/host_checks jitter_check
+//   tools/host_checks/jitter_check [--seconds 600] [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "jitter_monitor.c"
+
+#define REST_JITTER_BUF     512     // rest_api.c get_jitter_handler()
+
+static const uint32_t s_edges[JITTER_BINS - 1] = JITTER_BIN_EDGES_US;
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+uint32_t esp_log_timestamp(void) { return 0; }
+
+static uint32_t hist_sum(const uint32_t *h) {
+    uint32_t n = 0;
+    for (int i = 0; i < JITTER_BINS; i++) n += h[i];
+    return n;
+}
+
+static void print_hist(const char *label, const uint32_t *h) {
+    printf("  %-8s", label);
+    for (int i = 0; i < JITTER_BINS; i++) printf(" %7u", (unsigned)h[i]);
+    printf("\n");
+}
+
+/* ------------------------------- Cases ---------------------------------- */
+
+static void check_bins(void) {
+    CHECK(jitter_bin(0) == 0, "0 us not in bin 0");
+    for (int i = 0; i < JITTER_BINS - 1; i++) {
+        CHECK(jitter_bin(s_edges[i] - 1) == i, "%u us in bin %d", (unsigned)s_edges[i] - 1, jitter_bin(s_edges[i] - 1));
+        CHECK(jitter_bin(s_edges[i]) == i + 1, "%u us in bin %d", (unsigned)s_edges[i], jitter_bin(s_edges[i]));
+    }
+    CHECK(jitter_bin(UINT32_MAX) == JITTER_BINS - 1, "UINT32_MAX not in the last bin");
+}
+
+static void check_exact(void) {
+    // One latency per bin, reads exactly on the period
+    static const uint32_t lat[JITTER_BINS] = { 10, 60, 150, 400, 900, 1500, 3000, 8000, 15000, 30000 };
+    const int n = 100 * JITTER_BINS;
+    const int64_t period = 100000;
+    jitter_monitor_reset();
+    int64_t t = 1000000;
+    for (int i = 0; i < n; i++, t += period) {
+        jitter_monitor_record(t - lat[i % JITTER_BINS], t);
+    }
+    jitter_stats_t st;
+    jitter_monitor_get(&st);
+    CHECK(st.samples == (uint32_t)n - 1, "%u intervals for %d reads", (unsigned)st.samples, n);
+    CHECK(st.period_min_us == period && st.period_mean_us == period && st.period_max_us == period,
+          "period %u/%u/%u", (unsigned)st.period_min_us, (unsigned)st.period_mean_us, (unsigned)st.period_max_us);
+    for (int i = 0; i < JITTER_BINS; i++) {
+        CHECK(st.latency_hist[i] == (uint32_t)n / JITTER_BINS, "latency bin %d: %u", i, (unsigned)st.latency_hist[i]);
+    }
+    CHECK(st.latency_max_us == 30000, "latency max %u", (unsigned)st.latency_max_us);
+    CHECK(st.period_dev_hist[0] == (uint32_t)n - 1 - JITTER_WARMUP, "dev bin 0: %u", (unsigned)st.period_dev_hist[0]);
+    CHECK(hist_sum(st.period_dev_hist) == st.samples - JITTER_WARMUP, "dev hist total");
+    CHECK(st.late == 0 && st.skipped == 0 && st.timeouts == 0, "spurious late/skipped/timeouts");
+
+    // ±300 us around the period lands in the 200..500 bin; late samples
+    // count but still advance the interval chain
+    jitter_monitor_reset();
+    t = 1000000;
+    for (int i = 0; i < 200; i++) {
+        t += period + (i % 2 ? 300 : -300);
+        jitter_monitor_record(i % 10 == 3 ? 0 : t - 40, t);
+    }
+    jitter_monitor_get(&st);
+    CHECK(st.samples == 199 && st.late == 20, "alternating: %u intervals, %u late", (unsigned)st.samples, (unsigned)st.late);
+    CHECK(st.period_dev_hist[jitter_bin(300)] == 199 - JITTER_WARMUP, "alternating: dev bin %d holds %u",
+          jitter_bin(300), (unsigned)st.period_dev_hist[jitter_bin(300)]);
+    CHECK(st.latency_hist[0] == 180, "alternating: latency bin 0 holds %u", (unsigned)st.latency_hist[0]);
+
+    // A missed conversion after warm-up is counted and kept out of the mean;
+    // timeouts and pauses break the chain so the gap is not an interval
+    jitter_monitor_reset();
+    t = 1000000;
+    for (int i = 0; i < 50; i++, t += period) {
+        if (i == 20) t += period;                   // Skipped
+        if (i == 30) jitter_monitor_timeout();
+        if (i == 40) jitter_monitor_pause();
+        if (i == 30 || i == 40) t += 7 * period;    // Gap the chain must not see
+        jitter_monitor_record(t - 40, t);
+    }
+    jitter_monitor_get(&st);
+    CHECK(st.skipped == 1 && st.timeouts == 1, "skipped %u timeouts %u", (unsigned)st.skipped, (unsigned)st.timeouts);
+    CHECK(st.samples == 49 - 1 - 2, "%u intervals around a skip and two breaks", (unsigned)st.samples);
+    CHECK(st.period_mean_us == period && st.period_max_us == period, "gap leaked into the period: mean %u max %u",
+          (unsigned)st.period_mean_us, (unsigned)st.period_max_us);
+    printf("exact        bins, fixed period, +-300 us, late, skipped, timeout and pause ok\n");
+}
+
+/** Gaussian-ish: sum of three uniforms */
+static double noise(double sigma) {
+    double s = 0;
+    for (int i = 0; i < 3; i++) s += (double)rand() / RAND_MAX - 0.5;
+    return s * 2.0 * sigma;
+}
+
+static void run_stream(int sps, bool tls, int seconds) {
+    const double period = 1e6 / sps;
+    jitter_monitor_reset();
+    int64_t busy_until = 0;
+    int delayed = 0;
+    double ready = 1e6;
+    for (long i = 0; i < (long)seconds * sps; i++) {
+        ready += period + noise(period * 2e-4);     // Converter clock wander
+        int64_t ready_us = (int64_t)ready;
+        // Interrupt → task switch on an idle sampling core
+        int64_t read_us = ready_us + 25 + rand() % 40;
+        // A handshake on core 0 holds a shared lock (flash, heap) now and
+        // then; the sampling task waits for it
+        if (tls && rand() % (4 * sps) == 0) {
+            busy_until = ready_us + 1500 + rand() % 4000;
+        }
+        if (read_us < busy_until) {
+            read_us = busy_until;
+            delayed++;
+        }
+        jitter_monitor_record(ready_us, read_us);
+    }
+    jitter_stats_t st;
+    jitter_monitor_get(&st);
+    printf("%2d SPS %-4s  n=%u period %u/%u/%u us, latency max %u us, %d delayed, skipped %u\n",
+           sps, tls ? "TLS" : "idle", (unsigned)st.samples, (unsigned)st.period_min_us,
+           (unsigned)st.period_mean_us, (unsigned)st.period_max_us, (unsigned)st.latency_max_us,
+           delayed, (unsigned)st.skipped);
+    print_hist("dev", st.period_dev_hist);
+    print_hist("latency", st.latency_hist);
+
+    CHECK(st.samples == (uint32_t)((long)seconds * sps - 1), "intervals lost");
+    CHECK(st.skipped == 0, "delays of a few ms counted as skipped conversions");
+    uint32_t slow = 0;
+    for (int i = jitter_bin(1000); i < JITTER_BINS; i++) slow += st.latency_hist[i];
+    if (tls) {
+        CHECK(slow > 0 && slow <= (uint32_t)delayed, "%u slow reads for %d delayed", (unsigned)slow, delayed);
+    } else {
+        CHECK(slow == 0 && st.latency_hist[0] + st.latency_hist[1] == st.samples + 1, "idle reads left bins 0-1");
+    }
+}
+
+static void check_json(void) {
+    char buf[1024];
+    jitter_stats_t st;
+    jitter_monitor_get(&st);
+    int n = jitter_monitor_to_json(buf, sizeof(buf));
+    CHECK(n > 0, "to_json failed");
+    unsigned samples, pmin, pmean, pmax, lmax, late, skipped, timeouts;
+    int got = sscanf(buf, "{\"samples\":%u,\"period_us\":{\"min\":%u,\"mean\":%u,\"max\":%u},"
+                     "\"latency_max_us\":%u,\"late\":%u,\"skipped\":%u,\"timeouts\":%u",
+                     &samples, &pmin, &pmean, &pmax, &lmax, &late, &skipped, &timeouts);
+    CHECK(got == 8 && samples == st.samples && pmin == st.period_min_us && pmean == st.period_mean_us &&
+          pmax == st.period_max_us && lmax == st.latency_max_us && late == st.late &&
+          skipped == st.skipped && timeouts == st.timeouts, "JSON scalars differ from the stats");
+    const char *h = strstr(buf, "\"latency_hist\":[");
+    for (int i = 0; h && i < JITTER_BINS; i++) {
+        h = strpbrk(h, "[,") + 1;
+        CHECK(strtoul(h, NULL, 10) == st.latency_hist[i], "latency_hist[%d] in JSON", i);
+    }
+    CHECK(jitter_monitor_to_json(buf, (size_t)n + 1) == n, "exact-size buffer refused");
+    CHECK(jitter_monitor_to_json(buf, (size_t)n) == -1, "short buffer not reported");
+
+    // Longest possible object: every scalar at its widest, and each
+    // histogram's total (bounded by the interval count) spread evenly,
+    // which gives the most digits
+    jitter_stats_t wide = { 0 };
+    wide.samples = wide.period_min_us = wide.period_mean_us = wide.period_max_us = UINT32_MAX;
+    wide.latency_max_us = wide.late = wide.skipped = wide.timeouts = UINT32_MAX;
+    for (int i = 0; i < JITTER_BINS; i++) {
+        wide.period_dev_hist[i] = wide.latency_hist[i] = UINT32_MAX / JITTER_BINS;
+    }
+    s_stats = wide;
+    n = jitter_monitor_to_json(buf, sizeof(buf));
+    CHECK(n > 0 && n < REST_JITTER_BUF, "longest JSON is %d bytes, GET /jitter has %d", n, REST_JITTER_BUF);
+    printf("json         read back ok, longest object %d of %d bytes\n", n, REST_JITTER_BUF);
+    jitter_monitor_reset();
+}
+
+int main(int argc, char **argv) {
+    int seconds = 600;
+    unsigned seed = 1;
+    static const struct option opts[] = {
+        { "seconds", required_argument, NULL, 't' },
+        { "seed",    required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 't': seconds = atoi(optarg); break;
+        case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [--seconds N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 2) seconds = 2;
+    srand(seed);
+
+    check_bins();
+    check_exact();
+    printf("bin edges (us) ");
+    for (int i = 0; i < JITTER_BINS - 1; i++) printf(" %u", (unsigned)s_edges[i]);
+    printf("\n");
+    run_stream(10, false, seconds);
+    run_stream(10, true, seconds);
+    run_stream(80, false, seconds);
+    run_stream(80, true, seconds);
+    check_json();
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,497 @@
+// File: tools/host_checks/mqtt_uplink_check.c
+// ---------------------------------------------------------------------------
+// MQTT uplink against the real weigh-in log and an in-process broker
+//   - mqtt_uplink.c and weigh_log.c compiled in unchanged; the log file is
+//     a byte buffer, NVS one u32, time a virtual clock, and uplink_step()
+//     is called where the task would wake
+//   - The broker decodes every weigh-in message and counts deliveries per
+//     seq; PUBACKs are sent, held back or lost by the test
+//   - Offline backlog drained in order, and the cursor (NVS) restored
+//     after a reboot
+//   - collect_acks: out-of-order PUBACKs hold the cursor, a lost PUBACK
+//     window is re-sent from the cursor after MQTT_UPLINK_ACK_TIMEOUT_MS
+//   - skip_lost: records the ring overwrote while offline are counted
+//   - cursor_load: a cursor past the log end (log recreated) starts over
+//   - publish_batch: torn slots skipped inside a batch, a batch of torn
+//     slots only stepped over unsent, a log read failure (-1) retried
+//     without moving the cursor, a refused publish counted
+//
+//   make -C tools/host_checks mqtt_uplink_check
+//   tools/host_checks/mqtt_uplink_check
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_uplink.c"
+#include "clock_map.h"
+#include "storage.h"
+
+#define MAX_SEQ             4096
+#define MAX_UNACKED         64
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+/* ---------------------------- Fake platform ----------------------------- */
+
+static int64_t  s_now_us;
+static uint8_t *s_log;            // weighins.bin
+static size_t   s_log_len;
+static bool     s_read_fails;
+static uint32_t s_nvs_cursor;
+static bool     s_nvs_set;
+static int      s_nvs_writes;
+
+// Broker
+static esp_event_handler_t s_handler;
+static bool     s_refuse;               // esp_mqtt_client_publish() returns -1
+static int      s_next_msg_id = 1;
+static int      s_unacked[MAX_UNACKED]; // Weigh-in msg_ids awaiting a PUBACK
+static int      s_n_unacked;
+static uint16_t s_delivered[MAX_SEQ + 1];
+static uint32_t s_last_delivered;       // Highest seq seen
+static int      s_out_of_order;         // A seq below its predecessor in one message
+static int      s_messages;
+static int      s_rollups;
+
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "error"; }
+int64_t esp_timer_get_time(void) { return s_now_us; }
+uint32_t esp_log_timestamp(void) { return (uint32_t)(s_now_us / 1000); }
+BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdTRUE; }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+    static const uint8_t k_mac[6] = { 0x24, 0x0a, 0xa1, 0xb2, 0xc3, 0xd4 };
+    memcpy(mac, k_mac, sizeof(k_mac));
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h) { *h = 1; return ESP_OK; }
+void nvs_close(nvs_handle_t h) { }
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out) {
+    if (!s_nvs_set) return ESP_ERR_NOT_FOUND;
+    *out = s_nvs_cursor;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t value) {
+    s_nvs_cursor = value;
+    s_nvs_set = true;
+    s_nvs_writes++;
+    return ESP_OK;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len) {
+    crc = (uint16_t)~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+    }
+    return (uint16_t)~crc;
+}
+
+// Every record is stamped with a mapped wall clock
+time_t clock_map_to_wall(int64_t mono_us) { return (time_t)(1700000000 + mono_us / 1000000); }
+uint8_t clock_map_boot_tag(void) { return 1; }
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall) { return false; }
+
+esp_err_t storage_open(const char *name, storage_file_t *f) {
+    f->fd = 3;
+    return ESP_OK;
+}
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got) {
+    *got = 0;
+    if (s_read_fails) return ESP_FAIL;
+    if (offset >= s_log_len) return ESP_OK;
+    *got = len < s_log_len - offset ? len : s_log_len - offset;
+    memcpy(buf, s_log + offset, *got);
+    return ESP_OK;
+}
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync) {
+    if (offset + len > s_log_len) {
+        s_log = realloc(s_log, offset + len);
+        memset(s_log + s_log_len, 0, offset + len - s_log_len);
+        s_log_len = offset + len;
+    }
+    memcpy(s_log + offset, data, len);
+    return ESP_OK;
+}
+
+void res_heap_snapshot(res_heap_stats_t *out) { memset(out, 0, sizeof(*out)); }
+void jitter_monitor_get(jitter_stats_t *out) { memset(out, 0, sizeof(*out)); }
+
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name, void *arg) {
+    return NULL;        // uplink_step() is driven by the checks
+}
+
+int app_connection_manager_subscribe(const char *name, hub_sink_fn sink, void *ctx, uint8_t depth,
+                                     hub_drop_policy_t policy, uint32_t kinds, UBaseType_t prio) {
+    return 0;
+}
+
+/* ------------------------------- Broker --------------------------------- */
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config) {
+    static int client;
+    CHECK(config->session.keepalive == MQTT_UPLINK_KEEPALIVE_S, "keepalive %d", config->session.keepalive);
+    return (esp_mqtt_client_handle_t)&client;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *arg) {
+    s_handler = handler;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client) { return ESP_OK; }
+
+// {"dev":"a1b2c3d4","recs":[[seq,time,grams,user,flags],...]}
+static void broker_decode(const char *payload) {
+    const char *p = strstr(payload, "\"recs\":[");
+    CHECK(strncmp(payload, "{\"dev\":\"a1b2c3d4\"", 17) == 0 && p, "payload %.40s", payload);
+    if (!p) return;
+    p += 8;
+    uint32_t prev = 0;
+    while (*p == '[') {
+        char *end;
+        uint32_t seq = (uint32_t)strtoul(p + 1, &end, 10);
+        CHECK(seq >= 1 && seq <= MAX_SEQ, "seq %u", (unsigned)seq);
+        if (seq >= 1 && seq <= MAX_SEQ) s_delivered[seq]++;
+        if (seq <= prev) s_out_of_order++;
+        if (seq > s_last_delivered) s_last_delivered = seq;
+        prev = seq;
+        p = strchr(end, ']');
+        if (!p) break;
+        p += (p[1] == ',') ? 2 : 1;
+    }
+    CHECK(p && strcmp(p, "]}") == 0, "payload tail %s", p ? p : "(none)");
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain) {
+    if (s_refuse) return -1;
+    CHECK(qos == 1 && (int)strlen(data) == len, "qos %d, len %d", qos, len);
+    int id = s_next_msg_id++;
+    if (strcmp(topic, "scale/a1b2c3d4/rollup") == 0) {
+        s_rollups++;
+        return id;
+    }
+    CHECK(strcmp(topic, "scale/a1b2c3d4/weighins") == 0, "topic %s", topic);
+    broker_decode(data);
+    s_messages++;
+    if (s_n_unacked < MAX_UNACKED) s_unacked[s_n_unacked++] = id;
+    return id;
+}
+
+static void client_event(esp_mqtt_event_id_t id, int msg_id) {
+    esp_mqtt_event_t ev = { .event_id = id, .msg_id = msg_id };
+    s_handler(NULL, "MQTT_EVENTS", id, &ev);
+}
+
+// PUBACK the unacknowledged messages; newest first to exercise ordering
+static void broker_ack(bool reverse) {
+    for (int i = 0; i < s_n_unacked; i++) {
+        client_event(MQTT_EVENT_PUBLISHED, s_unacked[reverse ? s_n_unacked - 1 - i : i]);
+    }
+    s_n_unacked = 0;
+}
+
+// The broker lost the PUBACKs (or the client's outbox expired them)
+static void broker_drop_acks(void) {
+    s_n_unacked = 0;
+}
+
+static void broker_reset(void) {
+    memset(s_delivered, 0, sizeof(s_delivered));
+    s_last_delivered = 0;
+    s_out_of_order = 0;
+    s_messages = 0;
+    s_n_unacked = 0;
+}
+
+/* ------------------------------- Device --------------------------------- */
+
+static void append(int n) {
+    for (int i = 0; i < n; i++) {
+        s_now_us += 1000000;
+        uint32_t seq;
+        weigh_log_append(60000.0f + (float)(weigh_log_last_seq() % 100), s_now_us, 0, &seq);
+    }
+}
+
+// A reboot: RAM state lost, log file and NVS kept
+static void boot(void) {
+    s_client = NULL;
+    s_head = s_count = 0;
+    s_acked_seq = s_sent_seq = s_saved_seq = 0;
+    s_oldest_us = 0;
+    s_connected = s_drain = s_flush_req = false;
+    s_event_us = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    memset(s_inflight, 0, sizeof(s_inflight));
+    // weigh_log.c's RAM state is what its init recovers from the file
+    CHECK(weigh_log_init() == ESP_OK, "weigh_log_init");
+    const mqtt_uplink_config_t cfg = { .uri = "mqtt://broker.local:1883" };
+    CHECK(mqtt_uplink_init(&cfg) == ESP_OK, "mqtt_uplink_init");
+}
+
+// Where the task would wake: step, PUBACK everything, repeat until idle
+static int drain(bool reverse_acks) {
+    int steps = 0;
+    do {
+        s_now_us += 10000;
+        uplink_step();
+        broker_ack(reverse_acks);
+        steps++;
+    } while ((s_drain || s_count > 0) && steps < 1000);
+    s_now_us += 10000;
+    uplink_step();          // Collect the last PUBACKs, save the cursor
+    return steps;
+}
+
+static void torn(uint32_t seq) {
+    s_log[(size_t)((seq - 1) % WEIGH_LOG_CAPACITY) * sizeof(weigh_log_record_t) + 8] ^= 0x5a;
+}
+
+static int delivered_range(uint32_t from, uint32_t to, int *dups) {
+    int missing = 0;
+    *dups = 0;
+    for (uint32_t s = from; s <= to; s++) {
+        if (s_delivered[s] == 0) missing++;
+        if (s_delivered[s] > 1) (*dups)++;
+    }
+    return missing;
+}
+
+/* ------------------------------- Checks --------------------------------- */
+
+static void check_offline_backlog(void) {
+    int dups;
+    boot();
+    append(300);
+    uplink_step();
+    CHECK(s_messages == 0, "published %d messages while offline", s_messages);
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    int steps = drain(false);
+    int missing = delivered_range(1, 300, &dups);
+    printf("offline backlog: 300 records in %d messages over %d steps, %d missing, %d duplicated, "
+           "cursor %u (NVS %u, %d writes)\n", s_messages, steps, missing, dups,
+           (unsigned)s_acked_seq, (unsigned)s_nvs_cursor, s_nvs_writes);
+    CHECK(missing == 0 && dups == 0 && s_out_of_order == 0, "%d missing, %d dups", missing, dups);
+    CHECK(s_messages == (300 + MQTT_UPLINK_BATCH_RECORDS - 1) / MQTT_UPLINK_BATCH_RECORDS,
+          "%d messages", s_messages);
+    CHECK(s_acked_seq == 300 && s_nvs_cursor == 300 && s_stats.records_acked == 300,
+          "cursor %u, NVS %u", (unsigned)s_acked_seq, (unsigned)s_nvs_cursor);
+    CHECK(s_nvs_writes < s_messages, "%d NVS writes for %d PUBACKs", s_nvs_writes, s_messages);
+
+    // Reboot with the cursor in NVS: only what came after it goes out
+    broker_reset();
+    append(40);
+    boot();
+    CHECK(s_acked_seq == 300, "cursor restored as %u", (unsigned)s_acked_seq);
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    drain(false);
+    missing = delivered_range(301, 340, &dups);
+    printf("reboot: cursor 300 restored, %d of 40 new records sent, %d duplicated, none re-sent\n",
+           40 - missing, dups);
+    CHECK(missing == 0 && dups == 0 && s_delivered[300] == 0, "resume after reboot");
+}
+
+static void check_ack_order(void) {
+    boot();
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    uint32_t base = s_acked_seq;
+    append(2 * MQTT_UPLINK_BATCH_RECORDS);
+    s_now_us += 10000;
+    uplink_step();
+    CHECK(s_n_unacked == 2, "%d messages in flight", s_n_unacked);
+    client_event(MQTT_EVENT_PUBLISHED, s_unacked[1]);       // Second one first
+    s_now_us += 10000;
+    uplink_step();
+    CHECK(s_acked_seq == base, "cursor moved to %u over a gap", (unsigned)s_acked_seq);
+    client_event(MQTT_EVENT_PUBLISHED, s_unacked[0]);
+    s_n_unacked = 0;
+    s_now_us += 10000;
+    uplink_step();
+    CHECK(s_acked_seq == base + 2 * MQTT_UPLINK_BATCH_RECORDS, "cursor %u after both PUBACKs",
+          (unsigned)s_acked_seq);
+    printf("PUBACKs out of order: cursor held at %u until the gap closed, then %u\n",
+           (unsigned)base, (unsigned)s_acked_seq);
+}
+
+static void check_ack_timeout(void) {
+    int dups;
+    boot();
+    broker_reset();
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    uint32_t base = s_acked_seq;
+    append(MQTT_UPLINK_INFLIGHT * MQTT_UPLINK_BATCH_RECORDS + 8);
+    s_now_us += 10000;
+    uplink_step();
+    int first = s_messages;
+    CHECK(first == MQTT_UPLINK_INFLIGHT, "window of %d messages", first);
+    broker_drop_acks();
+
+    // Just inside the timeout nothing happens, just past it the window goes again
+    s_now_us += (int64_t)MQTT_UPLINK_ACK_TIMEOUT_MS * 1000 - 20000;
+    uplink_step();
+    CHECK(s_stats.resends == 0 && s_messages == first, "re-sent before the timeout");
+    s_now_us += 40000;
+    uplink_step();
+    CHECK(s_stats.resends == 1, "%u resends", (unsigned)s_stats.resends);
+    // Same step: the window goes out again from the cursor
+    CHECK(s_messages == 2 * first && s_delivered[base + 1] == 2 && s_acked_seq == base,
+          "not re-sent from the cursor: %d messages, seq %u seen %d times", s_messages,
+          (unsigned)base + 1, s_delivered[base + 1]);
+    drain(false);
+    uint32_t last = weigh_log_last_seq();
+    int missing = delivered_range(base + 1, last, &dups);
+    printf("lost PUBACK window: re-sent from %u after %d ms, %d of %u records delivered twice, "
+           "%d missing\n", (unsigned)base + 1, MQTT_UPLINK_ACK_TIMEOUT_MS, dups,
+           (unsigned)(last - base), missing);
+    CHECK(missing == 0 && s_acked_seq == last, "cursor %u of %u", (unsigned)s_acked_seq, (unsigned)last);
+    CHECK(dups == MQTT_UPLINK_INFLIGHT * MQTT_UPLINK_BATCH_RECORDS, "%d duplicates", dups);
+}
+
+static void check_lost(void) {
+    int dups;
+    boot();
+    broker_reset();
+    uint32_t base = s_acked_seq;
+    append(WEIGH_LOG_CAPACITY + 76);
+    uplink_step();
+    uint32_t first = weigh_log_first_seq(), last = weigh_log_last_seq();
+    printf("offline past the ring: %u records appended, %u lost, cursor moved to %u\n",
+           (unsigned)(last - base), (unsigned)s_stats.lost, (unsigned)s_acked_seq);
+    CHECK(s_stats.lost == 76 && s_acked_seq == first - 1, "lost %u, cursor %u, first %u",
+          (unsigned)s_stats.lost, (unsigned)s_acked_seq, (unsigned)first);
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    drain(false);
+    int missing = delivered_range(first, last, &dups);
+    CHECK(missing == 0 && dups == 0 && s_acked_seq == last, "%d missing after loss", missing);
+    CHECK(delivered_range(base + 1, first - 1, &dups) == (int)(first - 1 - base), "overwritten sent");
+}
+
+static void check_cursor_reset(void) {
+    int dups;
+    boot();
+    uint32_t last = weigh_log_last_seq();
+    s_nvs_cursor = last + 5000;                 // Log recreated below the cursor
+    boot();
+    CHECK(s_acked_seq == 0 && s_sent_seq == 0, "cursor %u past log end %u kept",
+          (unsigned)s_acked_seq, (unsigned)last);
+    broker_reset();
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    drain(false);
+    uint32_t first = weigh_log_first_seq();
+    int missing = delivered_range(first, last, &dups);
+    printf("cursor %u past log end %u: reset, %u retained records sent again\n",
+           (unsigned)last + 5000, (unsigned)last, (unsigned)(last - first + 1));
+    CHECK(missing == 0 && s_acked_seq == last, "%d missing after reset", missing);
+
+    // A cursor at the log end is kept
+    s_nvs_cursor = last;
+    boot();
+    CHECK(s_acked_seq == last, "cursor at the log end reset to %u", (unsigned)s_acked_seq);
+}
+
+static void check_torn_and_errors(void) {
+    int dups;
+    boot();
+    broker_reset();
+    client_event(MQTT_EVENT_CONNECTED, 0);
+    uint32_t base = s_acked_seq;
+
+    // One torn slot inside a batch: skipped, its neighbours go out
+    append(MQTT_UPLINK_BATCH_RECORDS);
+    torn(base + 3);
+    drain(false);
+    int missing = delivered_range(base + 1, base + MQTT_UPLINK_BATCH_RECORDS, &dups);
+    CHECK(missing == 1 && s_delivered[base + 3] == 0, "%d missing around a torn slot", missing);
+    CHECK(s_acked_seq == base + MQTT_UPLINK_BATCH_RECORDS, "cursor %u", (unsigned)s_acked_seq);
+
+    // Only torn slots up to the newest: stepped over without a message
+    base = s_acked_seq;
+    append(MQTT_UPLINK_BATCH_MIN);
+    for (uint32_t s = base + 1; s <= base + MQTT_UPLINK_BATCH_MIN; s++) torn(s);
+    int before = s_messages;
+    drain(false);
+    CHECK(s_messages == before, "published %d messages of torn slots", s_messages - before);
+    CHECK(s_acked_seq == base + MQTT_UPLINK_BATCH_MIN && s_stats.read_errors == 0,
+          "cursor %u over torn slots, %u read errors", (unsigned)s_acked_seq,
+          (unsigned)s_stats.read_errors);
+    printf("torn slots: one skipped inside a batch, a run of %d stepped over with no message\n",
+           MQTT_UPLINK_BATCH_MIN);
+
+    // Read failure: counted, cursor kept, nothing skipped once it clears
+    base = s_acked_seq;
+    append(MQTT_UPLINK_BATCH_MIN);
+    s_read_fails = true;
+    before = s_messages;
+    for (int i = 0; i < 5; i++) {
+        s_now_us += 10000;
+        s_flush_req = true;
+        uplink_step();
+    }
+    uint32_t errors = s_stats.read_errors;
+    CHECK(errors >= 5 && s_messages == before && s_acked_seq == base && s_sent_seq == base,
+          "read failure: %u errors, %d messages, cursor %u, sent %u", (unsigned)errors,
+          s_messages - before, (unsigned)s_acked_seq, (unsigned)s_sent_seq);
+    s_read_fails = false;
+    drain(false);
+    missing = delivered_range(base + 1, base + MQTT_UPLINK_BATCH_MIN, &dups);
+    CHECK(missing == 0 && s_acked_seq == base + MQTT_UPLINK_BATCH_MIN, "%d missing after the read failure",
+          missing);
+    printf("log read failure: %u read errors, cursor held at %u, all %d records sent once it cleared\n",
+           (unsigned)errors, (unsigned)base, MQTT_UPLINK_BATCH_MIN);
+
+    // Client refuses the publish: counted, retried on the next flush
+    base = s_acked_seq;
+    append(MQTT_UPLINK_BATCH_MIN);
+    s_refuse = true;
+    s_now_us += 10000;
+    uplink_step();
+    CHECK(s_stats.publish_errors >= 1 && s_sent_seq == base, "refused publish: %u errors, sent %u",
+          (unsigned)s_stats.publish_errors, (unsigned)s_sent_seq);
+    s_refuse = false;
+    s_flush_req = true;
+    drain(false);
+    CHECK(delivered_range(base + 1, base + MQTT_UPLINK_BATCH_MIN, &dups) == 0, "refused batch never sent");
+    printf("refused publish: %u publish errors, batch sent on the next flush\n",
+           (unsigned)s_stats.publish_errors);
+}
+
+int main(int argc, char **argv) {
+    check_offline_backlog();
+    check_ack_order();
+    check_ack_timeout();
+    check_lost();
+    check_cursor_reset();
+    check_torn_and_errors();
+    free(s_log);
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,352 @@
+// File: tools/host_checks/resources_check.c
+// ---------------------------------------------------------------------------
+// Static memory plan and heap accounting
+//   - resources.c compiled in unchanged; task and queue creation record
+//     what they were given, heap_caps is a first-fit arena of 16-byte
+//     granules so free size, low-water mark and largest block are real
+//   - Task starts are idempotent per slot, pooled instances get disjoint
+//     stacks inside their reservation with the table's priority and core,
+//     and stop/exit free the slot for the next start
+//   - Queues beyond their reserved length or item size are refused
+//   - Random alloc/free through every owner (including the cJSON and
+//     mbedTLS hooks) must match an independent per-owner ledger, and the
+//     snapshot's fragmentation must match the arena
+//
+//   make -C tools/host_checks resources_check
+//   tools/host_checks/resources_check [--steps 200000] [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "resources.c"
+
+#define ARENA_BYTES     (128 * 1024)
+#define GRANULE         16
+#define GRANULES        (ARENA_BYTES / GRANULE)
+#define LIVE_MAX        256
+
+/* --------------------------- Host stand-ins ----------------------------- */
+
+struct host_task {
+    TaskFunction_t fn;
+    const char    *name;
+    uint32_t       stack_bytes;
+    UBaseType_t    priority;
+    StackType_t   *stack;
+    BaseType_t     core;
+    bool           alive;
+};
+
+static struct host_task s_created[64];
+static int              s_ncreated;
+static int              s_deleted_self;
+static int              s_queues_created;
+
+static _Alignas(16) uint8_t s_arena[ARENA_BYTES];
+static uint16_t s_run[GRANULES];        // Granules in the block starting here, 0 = free
+static size_t   s_arena_min_free = ARENA_BYTES;
+static cJSON_Hooks s_json_hooks;
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+uint32_t esp_log_timestamp(void) { return 0; }
+void vTaskDelay(TickType_t ticks) { }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_bytes,
+                                           void *arg, UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core) {
+    if (s_ncreated == (int)(sizeof(s_created) / sizeof(s_created[0]))) return NULL;
+    s_created[s_ncreated] = (struct host_task){ fn, name, stack_bytes, priority, stack, core, true };
+    return &s_created[s_ncreated++];
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task) {
+        s_deleted_self++;
+        return;
+    }
+    struct host_task *t = task;
+    CHECK(t->alive, "task %s deleted twice", t->name);
+    t->alive = false;
+}
+
+char *pcTaskGetName(TaskHandle_t task) { return (char *)((struct host_task *)task)->name; }
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) { return ((struct host_task *)task)->priority; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return ((struct host_task *)task)->stack_bytes / 2; }
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *qcb) {
+    s_queues_created++;
+    return qcb;
+}
+
+void cJSON_InitHooks(cJSON_Hooks *hooks) { s_json_hooks = *hooks; }
+
+static size_t arena_free(void) {
+    size_t n = 0;
+    for (int i = 0; i < GRANULES; i += s_run[i] ? s_run[i] : 1) {
+        if (!s_run[i]) n++;
+    }
+    return n * GRANULE;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    size_t need = (size + GRANULE - 1) / GRANULE;
+    if (need == 0 || need > GRANULES) return NULL;
+    for (int i = 0; i < GRANULES; ) {
+        if (s_run[i]) {
+            i += s_run[i];
+            continue;
+        }
+        int j = i;
+        while (j < GRANULES && !s_run[j] && (size_t)(j - i) < need) j++;
+        if ((size_t)(j - i) == need) {
+            s_run[i] = (uint16_t)need;
+            for (int k = i + 1; k < j; k++) s_run[k] = 0xffff;    // Interior
+            size_t f = arena_free();
+            if (f < s_arena_min_free) s_arena_min_free = f;
+            return &s_arena[(size_t)i * GRANULE];
+        }
+        i = j;
+        while (i < GRANULES && s_run[i] == 0xffff) i++;
+    }
+    return NULL;
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    void *p = heap_caps_malloc(n * size, caps);
+    if (p) memset(p, 0, n * size);
+    return p;
+}
+
+void heap_caps_free(void *ptr) {
+    size_t i = (size_t)((uint8_t *)ptr - s_arena) / GRANULE;
+    CHECK(i < GRANULES && s_run[i] && s_run[i] != 0xffff, "bad free %p", ptr);
+    uint16_t n = s_run[i];
+    for (size_t k = i; k < i + n; k++) s_run[k] = 0;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) { return arena_free(); }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return s_arena_min_free; }
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    size_t best = 0, run = 0;
+    for (int i = 0; i < GRANULES; i++) {
+        run = s_run[i] ? 0 : run + 1;
+        if (run > best) best = run;
+    }
+    return best * GRANULE;
+}
+
+static void task_fn(void *arg) { }
+
+/* ------------------------------- Cases ---------------------------------- */
+
+static void check_tasks(void) {
+    // Idempotent start: one creation per slot however often it is started
+    TaskHandle_t a = res_task_start(RES_TASK_HX711, 0, task_fn, NULL, NULL);
+    TaskHandle_t b = res_task_start(RES_TASK_HX711, 0, task_fn, "again", NULL);
+    CHECK(a && a == b, "second start of a running slot created another task");
+    CHECK(s_ncreated == 1, "%d tasks created for one slot", s_ncreated);
+    struct host_task *t = a;
+    CHECK(strcmp(t->name, "HX711_Task") == 0, "table name not used: %s", t->name);
+    CHECK(t->priority == RES_PRIO_SAMPLING && t->core == RES_CORE_SENSE && t->stack_bytes == 4096,
+          "HX711 task: prio %u core %d stack %u", (unsigned)t->priority, (int)t->core,
+          (unsigned)t->stack_bytes);
+    CHECK(t->stack == &s_stack_RES_TASK_HX711[0][0], "HX711 stack not its reservation");
+
+    // Every table entry and pooled instance: own stack, table placement
+    int started = 0;
+    for (int id = 0; id < RES_TASK_COUNT; id++) {
+        const res_task_desc_t *d = &s_tasks[id];
+        uint8_t *lo = (uint8_t *)d->stacks;
+        uint8_t *hi = lo + (size_t)d->count * d->stack_bytes;
+        for (int i = 0; i < d->count; i++) {
+            t = res_task_start(id, i, task_fn, NULL, NULL);
+            CHECK(t, "%s/%d not started", d->name, i);
+            if (!t) continue;
+            started++;
+            CHECK(t->stack == (StackType_t *)(lo + (size_t)i * d->stack_bytes),
+                  "%s/%d stack at offset %td", d->name, i, (uint8_t *)t->stack - lo);
+            CHECK((uint8_t *)t->stack + t->stack_bytes <= hi, "%s/%d stack past its reservation", d->name, i);
+            CHECK(t->priority == d->priority && t->core == d->core, "%s/%d placement", d->name, i);
+            CHECK(t->core == RES_CORE_NET || id == RES_TASK_HX711 || id == RES_TASK_WEIGHT_MANAGER,
+                  "%s pinned to the sensing core", d->name);
+        }
+        CHECK(!res_task_start(id, d->count, task_fn, NULL, NULL), "%s: instance past the pool", d->name);
+    }
+    CHECK(s_ncreated == started, "%d creations for %d slots", s_ncreated, started);
+    CHECK(!res_task_start(RES_TASK_COUNT, 0, task_fn, NULL, NULL), "unknown task id started");
+    CHECK(!res_task_start(RES_TASK_HUB, -1, task_fn, NULL, NULL), "negative instance started");
+    res_log_report();
+
+    // Stop frees the slot and deletes the task; the next start reuses the stack
+    t = res_task_start(RES_TASK_HUB, 3, task_fn, NULL, NULL);
+    StackType_t *stack = t->stack;
+    res_task_stop(RES_TASK_HUB, 3);
+    CHECK(!t->alive, "stopped task still alive");
+    res_task_stop(RES_TASK_HUB, 3);     // Already stopped: no second delete
+    struct host_task *t2 = res_task_start(RES_TASK_HUB, 3, task_fn, "hub_mqtt", NULL);
+    CHECK(t2 != t && t2->stack == stack && strcmp(t2->name, "hub_mqtt") == 0, "restart after stop");
+
+    // Exit from the task itself frees the slot and deletes the caller
+    t = res_task_start(RES_TASK_WIFI_SCAN, 0, task_fn, NULL, NULL);
+    res_task_exit(RES_TASK_WIFI_SCAN, 0);
+    CHECK(s_deleted_self == 1, "exit did not delete the calling task");
+    t2 = res_task_start(RES_TASK_WIFI_SCAN, 0, task_fn, NULL, NULL);
+    CHECK(t2 != t, "slot still held after exit");
+    printf("tasks        %d slots started once each, stop/exit reuse the slot\n", started);
+}
+
+static void check_queues(void) {
+    int before = s_queues_created;
+    for (int id = 0; id < RES_QUEUE_COUNT; id++) {
+        const res_queue_desc_t *d = &s_queues[id];
+        CHECK(!res_queue_create(id, 0, d->length + 1, d->item_size), "queue %d: long queue accepted", id);
+        CHECK(!res_queue_create(id, 0, d->length, d->item_size + 1), "queue %d: large item accepted", id);
+        CHECK(!res_queue_create(id, 0, 0, d->item_size), "queue %d: empty queue accepted", id);
+        CHECK(!res_queue_create(id, d->count, d->length, d->item_size), "queue %d: instance past the pool", id);
+        for (int i = 0; i < d->count; i++) {
+            QueueHandle_t q = res_queue_create(id, i, d->length, d->item_size);
+            CHECK(q == &d->qcbs[i], "queue %d/%d not in its reservation", id, i);
+            CHECK(res_queue_create(id, i, 1, 1) == q, "queue %d/%d created twice", id, i);
+        }
+    }
+    CHECK(s_queues_created - before == 1 + RES_HUB_SUBSCRIBERS + 1 + 1,
+          "%d queues created", s_queues_created - before);
+    printf("queues       oversize, empty and out-of-pool requests refused, creation idempotent\n");
+}
+
+static void check_heap(long steps, unsigned seed) {
+    res_init();
+    CHECK(s_json_hooks.malloc_fn && s_json_hooks.free_fn == res_free, "cJSON hooks not installed");
+
+    struct { void *p; res_heap_t owner; uint32_t size; } live[LIVE_MAX];
+    int nlive = 0;
+    res_heap_owner_stats_t ledger[RES_HEAP_COUNT] = { 0 };
+    uint32_t min_largest = UINT32_MAX;
+    srand(seed);
+
+    for (long n = 0; n < steps; n++) {
+        if (nlive == LIVE_MAX || (nlive && rand() % 100 < 48)) {
+            int k = rand() % nlive;
+            if (live[k].owner == RES_HEAP_TLS) {
+                esp_mbedtls_mem_free(live[k].p);
+            } else if (live[k].owner == RES_HEAP_JSON) {
+                s_json_hooks.free_fn(live[k].p);
+            } else {
+                res_free(live[k].p);
+            }
+            ledger[live[k].owner].bytes -= live[k].size;
+            live[k] = live[--nlive];
+        } else {
+            res_heap_t owner = (res_heap_t)(rand() % RES_HEAP_COUNT);
+            uint32_t size = rand() % 8 ? 1 + rand() % 512 : 1 + rand() % 8192;
+            void *p;
+            if (owner == RES_HEAP_TLS) {
+                p = esp_mbedtls_mem_calloc(1, size);
+            } else if (owner == RES_HEAP_JSON) {
+                p = s_json_hooks.malloc_fn(size);
+            } else if (rand() % 2) {
+                p = res_calloc(owner, size, 1);
+            } else {
+                p = res_malloc(owner, size);
+            }
+            if (!p) {
+                ledger[owner].failures++;
+                continue;
+            }
+            CHECK(((uintptr_t)p & 7) == 0, "block %p not 8-byte aligned", p);
+            memset(p, 0xa5, size);
+            ledger[owner].bytes += size;
+            ledger[owner].allocs++;
+            if (ledger[owner].bytes > ledger[owner].peak) ledger[owner].peak = ledger[owner].bytes;
+            live[nlive++] = (typeof(live[0])){ p, owner, size };
+        }
+        if (n % 97 == 0 || n == steps - 1) {
+            res_heap_stats_t st;
+            res_heap_snapshot(&st);
+            CHECK(memcmp(st.owner, ledger, sizeof(ledger)) == 0, "owner counters drifted at step %ld", n);
+            uint32_t largest = (uint32_t)heap_caps_get_largest_free_block(0);
+            uint32_t free_b = (uint32_t)arena_free();
+            if (largest < min_largest) min_largest = largest;
+            CHECK(st.free_bytes == free_b && st.largest_block == largest &&
+                  st.min_largest_block == min_largest, "heap totals at step %ld", n);
+            CHECK(st.fragmentation_pct == (free_b ? 100 - (uint64_t)largest * 100 / free_b : 0),
+                  "fragmentation %u%% at step %ld", (unsigned)st.fragmentation_pct, n);
+        }
+        if (s_failures > 10) break;
+    }
+
+    // Overflowing calloc is refused before it reaches the heap
+    CHECK(!res_calloc(RES_HEAP_HTTP, SIZE_MAX / 2, 3), "overflowing calloc");
+    CHECK(!esp_mbedtls_mem_calloc(SIZE_MAX / 2, 3), "overflowing mbedTLS calloc");
+    CHECK(!res_malloc(RES_HEAP_COUNT, 16), "allocation for an unknown owner");
+    res_free(NULL);
+
+    res_heap_stats_t st;
+    res_heap_snapshot(&st);
+    CHECK(memcmp(st.owner, ledger, sizeof(ledger)) == 0, "owner counters drifted");
+    printf("heap         %ld steps, allocations: ", steps);
+    for (int i = 0; i < RES_HEAP_COUNT; i++) {
+        printf("%s %u (%u failed)%s", s_owner_names[i], (unsigned)st.owner[i].allocs,
+               (unsigned)st.owner[i].failures, i + 1 < RES_HEAP_COUNT ? ", " : "\n");
+    }
+    printf("             free %u min %u largest %u (low %u) frag %u%%\n",
+           (unsigned)st.free_bytes, (unsigned)st.min_free_bytes, (unsigned)st.largest_block,
+           (unsigned)st.min_largest_block, (unsigned)st.fragmentation_pct);
+
+    while (nlive) res_free(live[--nlive].p);
+    res_heap_snapshot(&st);
+    for (int i = 0; i < RES_HEAP_COUNT; i++) {
+        CHECK(st.owner[i].bytes == 0, "%s still holds %u bytes", s_owner_names[i], (unsigned)st.owner[i].bytes);
+    }
+    CHECK(st.free_bytes == ARENA_BYTES && st.fragmentation_pct == 0, "arena not whole after freeing everything");
+}
+
+int main(int argc, char **argv) {
+    long steps = 200000;
+    unsigned seed = 1;
+    static const struct option opts[] = {
+        { "steps", required_argument, NULL, 'n' },
+        { "seed",  required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 'n': steps = atol(optarg); break;
+        case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [--steps N] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    check_tasks();
+    check_queues();
+    check_heap(steps, seed);
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
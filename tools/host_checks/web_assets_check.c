@@ -0,0 +1,429 @@
+// File: tools/host_checks/web_assets_check.c
+// ---------------------------------------------------------------------------
+// Web dashboard handler against a fake httpd
+//   - web_assets.c compiled in unchanged; the partition is a temporary
+//     directory staged like tools/www_pack.py does (files named by id, a
+//     manifest), left unsorted and with one bad line
+//   - Path resolution: clean URLs, directory index, query strings, 404s
+//   - Negotiation per stored set (bg, g, i) over real Accept-Encoding
+//     values, including ones that list nothing stored: those get gzip with
+//     Content-Encoding, never a 406
+//   - ETags per representation and If-None-Match (lists, W/, *) → 304
+//   - Bodies byte-exact in WEB_ASSETS_CHUNK pieces, large ones on a worker
+//     or inline when none is free, a missing file as a 500, counters, and
+//     every buffer returned
+//
+//   make -C tools/host_checks web_assets_check
+//   tools/host_checks/web_assets_check
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define WEB_ASSETS_BASE     "www"   // Relative to the temporary directory
+#include "web_assets.c"
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+/* ---------------------------- Fake platform ----------------------------- */
+
+static esp_err_t s_mount_result = ESP_OK;
+static bool      s_worker_free = true;
+static int       s_offloaded;
+static int       s_live;            // res_malloc blocks not yet freed
+
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "error"; }
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf) {
+    CHECK(strcmp(conf->base_path, WEB_ASSETS_BASE) == 0 && !conf->format_if_mount_failed,
+          "mounted at %s, format %d", conf->base_path, conf->format_if_mount_failed);
+    return s_mount_result;
+}
+
+void *res_malloc(res_heap_t owner, size_t size) {
+    void *p = malloc(size);
+    if (p) s_live++;
+    return p;
+}
+
+void res_free(void *ptr) {
+    if (ptr) s_live--;
+    free(ptr);
+}
+
+// A free worker runs the handler on the (detached) request right away
+esp_err_t rest_api_offload(httpd_req_t *req, esp_err_t (*fn)(httpd_req_t *req)) {
+    if (!s_worker_free) return ESP_ERR_TIMEOUT;
+    s_offloaded++;
+    fn(req);
+    return ESP_OK;
+}
+
+static const char *req_hdr(httpd_req_t *req, const char *field) {
+    if (strcasecmp(field, "Accept-Encoding") == 0) return req->accept_encoding;
+    if (strcasecmp(field, "If-None-Match") == 0) return req->if_none_match;
+    return NULL;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t len) {
+    const char *v = req_hdr(req, field);
+    if (!v) return ESP_ERR_NOT_FOUND;
+    snprintf(val, len, "%s", v);
+    return strlen(v) < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *req, const char *field) {
+    const char *v = req_hdr(req, field);
+    return v ? strlen(v) : 0;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status) {
+    req->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type) {
+    snprintf(req->type, sizeof(req->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value) {
+    size_t n = strlen(req->hdrs);
+    snprintf(req->hdrs + n, sizeof(req->hdrs) - n, "%s: %s\n", field, value);
+    return ESP_OK;
+}
+
+static void append(httpd_req_t *req, const char *buf, size_t len) {
+    CHECK(!req->done, "%s: data after the response ended", req->uri);
+    req->body = realloc(req->body, req->body_len + len + 1);
+    memcpy(req->body + req->body_len, buf, len);
+    req->body_len += len;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len) {
+    if (buf && len) append(req, buf, len < 0 ? strlen(buf) : (size_t)len);
+    req->done = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len) {
+    if (!buf || len == 0) {
+        req->done = true;
+        return ESP_OK;
+    }
+    CHECK(len <= WEB_ASSETS_CHUNK, "%s: %zd-byte chunk", req->uri, len);
+    append(req, buf, (size_t)len);
+    req->chunks++;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *req) {
+    req->status = 500;
+    req->done = true;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t err, const char *msg) {
+    req->status = err == HTTPD_404_NOT_FOUND ? 404 : err == HTTPD_400_BAD_REQUEST ? 400 : 500;
+    req->done = true;
+    return ESP_OK;
+}
+
+/* ------------------------------ Staging --------------------------------- */
+
+typedef struct {
+    const char *id;
+    const char *encs;
+    const char *cache;
+    const char *mime;
+    const char *path;
+    uint32_t    size;       // Identity size in the manifest
+    uint32_t    stored[3];  // br, gz, identity file sizes; 0 = not staged
+} staged_t;
+
+// What www_pack.py would write for a small export, in export order
+static const staged_t s_staged[] = {
+    { "0f1e2d3c4b5a6978", "bg", "i", "application/javascript",
+      "/_expo/static/js/web/entry-3f9a1c2b.js", 61000, { 15000, 19000, 0 } },
+    { "1111222233334444", "g",  "r", "text/html",  "/index.html",        3100, { 0, 1200, 0 } },
+    { "5555666677778888", "g",  "r", "text/html",  "/about.html",        2900, { 0, 1100, 0 } },
+    { "9999aaaabbbbcccc", "g",  "r", "text/html",  "/docs/index.html",   2800, { 0, 1000, 0 } },
+    { "ddddeeeeffff0000", "i",  "r", "image/x-icon", "/favicon.ico",     1150, { 0, 0, 1150 } },
+    { "abcdefabcdef0123", "g",  "r", "text/css",   "/missing.css",       900,  { 0, 0, 0 } },
+};
+#define STAGED  (sizeof(s_staged) / sizeof(s_staged[0]))
+
+static const char *const s_suffix[3] = { ".br", ".gz", "" };
+
+static uint8_t pattern(const char *id, int enc, size_t i) {
+    return (uint8_t)(id[0] * 31 + enc * 7 + i * 13 + (i >> 8));
+}
+
+static void stage(void) {
+    mkdir(WEB_ASSETS_BASE, 0755);
+    FILE *m = fopen(WEB_ASSETS_BASE "/manifest", "w");
+    // Manifest written in reverse (unsorted, as if hand-edited) plus a bad line
+    fprintf(m, "short g r 10 text/plain /x\n");
+    for (int k = (int)STAGED - 1; k >= 0; k--) {
+        const staged_t *s = &s_staged[k];
+        fprintf(m, "%s %s %s %u %s %s\n", s->id, s->encs, s->cache, (unsigned)s->size, s->mime, s->path);
+        for (int e = 0; e < 3; e++) {
+            if (!s->stored[e]) continue;
+            char name[64];
+            snprintf(name, sizeof(name), WEB_ASSETS_BASE "/%s%s", s->id, s_suffix[e]);
+            FILE *f = fopen(name, "wb");
+            for (size_t i = 0; i < s->stored[e]; i++) fputc(pattern(s->id, e, i), f);
+            fclose(f);
+        }
+    }
+    fclose(m);
+}
+
+static const staged_t *staged(const char *path) {
+    for (size_t k = 0; k < STAGED; k++) {
+        if (strcmp(s_staged[k].path, path) == 0) return &s_staged[k];
+    }
+    return NULL;
+}
+
+/* ------------------------------ Requests -------------------------------- */
+
+static httpd_req_t s_req;
+
+static httpd_req_t *get(const char *uri, const char *accept_encoding, const char *if_none_match) {
+    free(s_req.body);
+    memset(&s_req, 0, sizeof(s_req));
+    snprintf(s_req.uri, sizeof(s_req.uri), "%s", uri);
+    s_req.accept_encoding = accept_encoding;
+    s_req.if_none_match = if_none_match;
+    s_req.status = 200;
+    esp_err_t err = web_assets_handler(&s_req);
+    CHECK(s_req.done, "%s: response not finished (%d)", uri, err);
+    return &s_req;
+}
+
+// Response header value, NULL when absent
+static const char *hdr(httpd_req_t *req, const char *field) {
+    static char val[128];
+    size_t flen = strlen(field);
+    for (const char *p = req->hdrs; *p; p = strchr(p, '\n') + 1) {
+        if (strncmp(p, field, flen) == 0 && p[flen] == ':') {
+            const char *v = p + flen + 2;
+            size_t n = strcspn(v, "\n");
+            snprintf(val, sizeof(val), "%.*s", (int)n, v);
+            return val;
+        }
+    }
+    return NULL;
+}
+
+// A 200 carrying exactly the stored file for enc (0 br, 1 gz, 2 identity)
+static void expect_body(httpd_req_t *r, const staged_t *s, int enc) {
+    static const char *const coding[3] = { "br", "gzip", NULL };
+    const char *ce = hdr(r, "Content-Encoding");
+    CHECK(r->status == 200, "%s (%s): status %d", s->path, r->accept_encoding, r->status);
+    CHECK(coding[enc] ? ce && strcmp(ce, coding[enc]) == 0 : ce == NULL,
+          "%s (%s): Content-Encoding %s, want %s", s->path, r->accept_encoding, ce ? ce : "none",
+          coding[enc] ? coding[enc] : "none");
+    CHECK(hdr(r, "Vary") && strcmp(hdr(r, "Vary"), "Accept-Encoding") == 0, "%s: no Vary", s->path);
+    CHECK(strcmp(r->type, s->mime) == 0, "%s: type %s", s->path, r->type);
+
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"%s%s\"", s->id, enc == 0 ? "-br" : enc == 1 ? "-gz" : "");
+    CHECK(hdr(r, "ETag") && strcmp(hdr(r, "ETag"), etag) == 0, "%s: ETag %s, want %s",
+          s->path, hdr(r, "ETag") ? hdr(r, "ETag") : "none", etag);
+
+    bool same = r->body_len == s->stored[enc];
+    for (size_t i = 0; same && i < r->body_len; i++) same = (uint8_t)r->body[i] == pattern(s->id, enc, i);
+    CHECK(same, "%s (%s): body %zu bytes not the stored %s copy", s->path, r->accept_encoding,
+          r->body_len, s_suffix[enc][0] ? s_suffix[enc] : "identity");
+    int chunks = (int)((s->stored[enc] + WEB_ASSETS_CHUNK - 1) / WEB_ASSETS_CHUNK);
+    CHECK(r->chunks == chunks, "%s: %d chunks, want %d", s->path, r->chunks, chunks);
+}
+
+/* ------------------------------- Cases ---------------------------------- */
+
+static void check_resolve(void) {
+    static const struct { const char *uri, *path; } cases[] = {
+        { "/",                      "/index.html" },
+        { "/index.html",            "/index.html" },
+        { "/about",                 "/about.html" },
+        { "/about?tab=2",           "/about.html" },
+        { "/docs/",                 "/docs/index.html" },
+        { "/favicon.ico?v=3",       "/favicon.ico" },
+        { "/favicon.ico#top",       "/favicon.ico" },
+        { "/_expo/static/js/web/entry-3f9a1c2b.js", "/_expo/static/js/web/entry-3f9a1c2b.js" },
+        { "/nope",                  NULL },
+        { "/nope.png",              NULL },
+        { "/docs",                  NULL },     // Export has docs/index.html, not docs.html
+        { "/x",                     NULL },     // Only on the bad manifest line
+        { "?q=1",                   NULL },
+    };
+    CHECK(s_count == STAGED, "%u manifest entries, want %u", (unsigned)s_count, (unsigned)STAGED);
+    for (size_t i = 1; i < s_count; i++) {
+        CHECK(strcmp(s_assets[i - 1].path, s_assets[i].path) < 0, "manifest not sorted at %u", (unsigned)i);
+    }
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const web_asset_t *a = resolve(cases[i].uri);
+        CHECK(cases[i].path ? a && strcmp(a->path, cases[i].path) == 0 : a == NULL,
+              "%s resolved to %s", cases[i].uri, a ? a->path : "nothing");
+        if (!cases[i].path) {
+            CHECK(get(cases[i].uri, "gzip", NULL)->status == 404, "%s: status %d", cases[i].uri, s_req.status);
+        }
+    }
+    char uri[160];
+    memset(uri, 'a', sizeof(uri) - 1);
+    uri[0] = '/';
+    uri[sizeof(uri) - 1] = '\0';
+    CHECK(get(uri, NULL, NULL)->status == 404, "long URI: status %d", s_req.status);
+}
+
+static void check_negotiation(void) {
+    // 96-byte header buffer: "br" past the end is lost, "gzip" before it is kept
+    char truncated[160];
+    snprintf(truncated, sizeof(truncated), "gzip, %0120d, br", 0);
+
+    static const char *const js = "/_expo/static/js/web/entry-3f9a1c2b.js";
+    const struct { const char *uri, *ae; int enc; } cases[] = {
+        { js,              "gzip, deflate, br, zstd", 0 },
+        { js,              "br",                      0 },
+        { js,              "*",                       0 },
+        { js,              "gzip;q=0, br",            0 },
+        { js,              "gzip, deflate",           1 },
+        { js,              "BR;q=0, GZIP",            1 },
+        { js,              "br; q=0.0, gzip; q=0.5",  1 },
+        { js,              truncated,                 1 },
+        { js,              NULL,                      1 },  // Absent: no identity stored
+        { js,              "identity",                1 },  // Nothing accepted is stored
+        { js,              "deflate",                 1 },
+        { js,              "br;q=0, gzip;q=0",        1 },
+        { js,              "",                        1 },
+        { "/",             "gzip, br",                1 },
+        { "/",             "identity",                1 },  // Was a 406
+        { "/",             NULL,                      1 },
+        { "/about",        "deflate, identity;q=1",   1 },
+        { "/favicon.ico",  "gzip, br",                2 },
+        { "/favicon.ico",  NULL,                      2 },
+        { "/favicon.ico",  "identity;q=0",            2 },  // Identity is all there is
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        httpd_req_t *r = get(cases[i].uri, cases[i].ae, NULL);
+        expect_body(r, staged(resolve(cases[i].uri)->path), cases[i].enc);
+    }
+}
+
+static void check_validators(void) {
+    const staged_t *js = &s_staged[0], *page = staged("/index.html");
+    char br[32], gz[32], list[96], weak[40];
+    snprintf(br, sizeof(br), "\"%s-br\"", js->id);
+    snprintf(gz, sizeof(gz), "\"%s-gz\"", js->id);
+    snprintf(list, sizeof(list), "\"0000000000000000\", %s", br);
+    snprintf(weak, sizeof(weak), "W/%s", br);
+
+    const struct { const char *inm; int status; } cases[] = {
+        { br, 304 }, { list, 304 }, { weak, 304 }, { "*", 304 },
+        { gz, 200 },                        // Other representation
+        { "\"0f1e2d3c4b5a6978\"", 200 },    // Identity tag, not stored
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        httpd_req_t *r = get(js->path, "br, gzip", cases[i].inm);
+        CHECK(r->status == cases[i].status, "If-None-Match %s: status %d", cases[i].inm, r->status);
+        CHECK(hdr(r, "ETag") && strcmp(hdr(r, "ETag"), br) == 0, "If-None-Match %s: ETag %s",
+              cases[i].inm, hdr(r, "ETag") ? hdr(r, "ETag") : "none");
+        CHECK(hdr(r, "Vary") != NULL, "If-None-Match %s: no Vary", cases[i].inm);
+        if (r->status == 304) {
+            CHECK(r->body_len == 0, "304 with a %zu-byte body", r->body_len);
+        }
+    }
+    // The gzip fallback revalidates under its own tag
+    snprintf(gz, sizeof(gz), "\"%s-gz\"", page->id);
+    CHECK(get("/", "identity", gz)->status == 304, "gzip fallback not revalidated: %d", s_req.status);
+
+    const char *cc = hdr(get(js->path, "br", NULL), "Cache-Control");
+    CHECK(cc && strstr(cc, "immutable"), "fingerprinted asset: Cache-Control %s", cc ? cc : "none");
+    cc = hdr(get("/", "br", NULL), "Cache-Control");
+    CHECK(cc && strcmp(cc, "no-cache") == 0, "page: Cache-Control %s", cc ? cc : "none");
+    cc = hdr(get("/", "br", "*"), "Cache-Control");
+    CHECK(cc && strcmp(cc, "no-cache") == 0, "page 304: Cache-Control %s", cc ? cc : "none");
+}
+
+static void check_bodies(void) {
+    const staged_t *js = &s_staged[0];
+
+    s_offloaded = 0;
+    s_worker_free = true;
+    expect_body(get(js->path, "br", NULL), js, 0);
+    CHECK(s_offloaded == 1, "large body not offloaded to a free worker");
+    s_worker_free = false;
+    expect_body(get(js->path, "identity", NULL), js, 1);
+    CHECK(s_offloaded == 1, "large body offloaded with no worker free");
+    s_worker_free = true;
+    expect_body(get("/favicon.ico", "br", NULL), staged("/favicon.ico"), 2);
+    CHECK(s_offloaded == 1, "%u-byte body offloaded", (unsigned)staged("/favicon.ico")->size);
+
+    CHECK(get("/missing.css", "gzip", NULL)->status == 500, "missing file: status %d", s_req.status);
+}
+
+int main(int argc, char **argv) {
+    char dir[] = "/tmp/web_assets_check.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 2;
+    }
+
+    // No partition: the dashboard is absent, every path a 404
+    s_mount_result = ESP_ERR_NOT_FOUND;
+    CHECK(web_assets_init() == ESP_ERR_NOT_FOUND, "init without a partition succeeded");
+    CHECK(get("/", "gzip", NULL)->status == 404, "no partition: status %d", s_req.status);
+
+    s_mount_result = ESP_OK;
+    CHECK(web_assets_init() == ESP_ERR_NOT_FOUND, "init without a manifest succeeded");
+    stage();
+    CHECK(web_assets_init() == ESP_OK, "init failed");
+    int manifest_bufs = s_live;
+
+    check_resolve();
+    check_negotiation();
+    check_validators();
+    check_bodies();
+    CHECK(s_live == manifest_bufs, "%d file buffers not freed", s_live - manifest_bufs);
+
+    web_assets_stats_t st;
+    web_assets_get_stats(&st);
+    printf("requests %u: 200 %u (%u bytes), 304 %u, 404 %u\n", (unsigned)st.requests,
+           (unsigned)st.bodies, (unsigned)st.bytes, (unsigned)st.not_modified, (unsigned)st.not_found);
+    CHECK(st.requests == st.bodies + st.not_modified + st.not_found + 1,    // + the 500
+          "counters do not add up");
+
+    free(s_req.body);
+    for (size_t k = 0; k < STAGED; k++) {
+        for (int e = 0; e < 3; e++) {
+            char name[64];
+            snprintf(name, sizeof(name), WEB_ASSETS_BASE "/%s%s", s_staged[k].id, s_suffix[e]);
+            unlink(name);
+        }
+    }
+    unlink(WEB_ASSETS_BASE "/manifest");
+    rmdir(WEB_ASSETS_BASE);
+    rmdir(dir);
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
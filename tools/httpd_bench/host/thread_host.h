@@ -0,0 +1,21 @@
+// File: tools/httpd_bench/host/thread_host.h
+// ---------------------------------------------------------------------------
+// The host_checks layer (static tasks and queues, the fake esp_http_server
+// API) made multi-threaded for httpd_bench.c, which implements it on
+// pthreads and sockets: rest_api.c runs its httpd task, workers and
+// streams concurrently here, so critical sections are real.
+// ---------------------------------------------------------------------------
+#ifndef THREAD_HOST_H
+#define THREAD_HOST_H
+
+#include "rest_host.h"
+
+/* One lock behind every portMUX, as on a single core */
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+#undef taskENTER_CRITICAL
+#undef taskEXIT_CRITICAL
+#define taskENTER_CRITICAL(m)   host_critical_enter(m)
+#define taskEXIT_CRITICAL(m)    host_critical_exit(m)
+
+#endif // THREAD_HOST_H
@@ -0,0 +1,1084 @@
+// File: tools/httpd_bench/httpd_bench.c
+// ---------------------------------------------------------------------------
+// Concurrent-client latency of the shipped HTTP API on loopback
+//   - rest_api.c is compiled in unchanged: the route table,
+//     route_dispatch(), rest_api_offload(), the worker tasks and the
+//     /weight, /history and /stream handlers run as on the scale;
+//     resources.c creates the workers and their queue, weigh_log.c serves
+//     /history
+//   - The platform is threaded (host/thread_host.h): tasks are pthreads,
+//     queues, semaphores and task notifications block, and critical
+//     sections take a lock
+//   - esp_http_server is a socket stub of the host_checks API: one thread
+//     (the httpd task) polls up to REST_MAX_SOCKETS sessions with LRU
+//     purge, matches the registered handlers with httpd_uri_match_wildcard,
+//     writes httpd_resp_* as HTTP/1.1, and leaves a session alone from
+//     httpd_req_async_handler_begin() until _complete()
+//   - /history reads a full log of WEIGH_LOG_CAPACITY records, each
+//     storage read taking --read-us; a feeder publishes a measurement at
+//     REST_STREAM_HZ
+//   - "sync" calls each route's handler inline on the httpd thread, as
+//     the server did before the route table (a stream gets 503); "async"
+//     goes through route_dispatch()
+//   - Plain TCP: TLS record costs are not modelled
+//   - Clients: keep-alive /weight pollers (latency), /history readers
+//     (whole body checked, 503 retried after Retry-After), one /stream
+//
+//   make -C tools/httpd_bench
+//   tools/httpd_bench/httpd_bench [--seconds 3] [--read-us 2000]
+// ---------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "rest_api.c"
+#include "clock_map.h"
+#include "storage.h"
+
+#define HISTORY_CHUNKS  ((WEIGH_LOG_CAPACITY + REST_HISTORY_CHUNK - 1) / REST_HISTORY_CHUNK)
+#define MAX_CLIENTS     8
+#define MAX_SAMPLES     400000
+#define MAX_HANDLERS    16
+
+/* ------------------------------ Settings -------------------------------- */
+
+static int    s_read_us = 2000;     // One storage_read_at()
+static double s_seconds = 3.0;
+static bool   s_async;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------ Platform -------------------------------- */
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void host_critical_enter(portMUX_TYPE *mux) { pthread_mutex_lock(&s_critical); }
+void host_critical_exit(portMUX_TYPE *mux) { pthread_mutex_unlock(&s_critical); }
+
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "error"; }
+int64_t esp_timer_get_time(void) { return (int64_t)(now_ms() * 1000.0); }
+uint32_t esp_log_timestamp(void) { return (uint32_t)now_ms(); }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)now_ms(); }
+void vTaskDelay(TickType_t ticks) { usleep((useconds_t)ticks * 1000); }
+
+// Absolute deadline for a FreeRTOS wait; false for portMAX_DELAY
+static bool deadline(TickType_t wait, struct timespec *ts) {
+    if (wait == portMAX_DELAY) return false;
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += wait / 1000;
+    ts->tv_nsec += (long)(wait % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+    return true;
+}
+
+// Wait on cv; false once the deadline passed (wait 0: at once)
+static bool block(pthread_cond_t *cv, pthread_mutex_t *mu, TickType_t wait, const struct timespec *ts) {
+    if (wait == 0) return false;
+    if (wait == portMAX_DELAY) return pthread_cond_wait(cv, mu) == 0;
+    return pthread_cond_timedwait(cv, mu, ts) != ETIMEDOUT;
+}
+
+// A task: a pthread and its notification count. Threads the bench starts
+// itself (httpd, feeder) get one on first use
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    uint32_t        notified;
+    TaskFunction_t  fn;
+    void           *arg;
+} task_t;
+
+static __thread task_t *s_self;
+
+static task_t *task_new(TaskFunction_t fn, void *arg) {
+    task_t *t = calloc(1, sizeof(*t));
+    pthread_mutex_init(&t->mu, NULL);
+    pthread_cond_init(&t->cv, NULL);
+    t->fn = fn;
+    t->arg = arg;
+    return t;
+}
+
+static void *task_entry(void *arg) {
+    s_self = arg;
+    s_self->fn(s_self->arg);
+    return NULL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_bytes,
+                                           void *arg, UBaseType_t priority, StackType_t *stack,
+                                           StaticTask_t *tcb, BaseType_t core) {
+    task_t *t = task_new(fn, arg);
+    pthread_t th;
+    if (pthread_create(&th, NULL, task_entry, t) != 0) return NULL;
+    pthread_detach(th);
+    return t;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (!task || task == s_self) pthread_exit(NULL);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (!s_self) s_self = task_new(NULL, NULL);
+    return s_self;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+    task_t *t = xTaskGetCurrentTaskHandle();
+    struct timespec ts;
+    deadline(wait, &ts);
+    pthread_mutex_lock(&t->mu);
+    while (!t->notified && block(&t->cv, &t->mu, wait, &ts)) { }
+    uint32_t v = t->notified;
+    if (v) t->notified = clear ? 0 : v - 1;
+    pthread_mutex_unlock(&t->mu);
+    return v;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task_t *t = task;
+    pthread_mutex_lock(&t->mu);
+    t->notified++;
+    pthread_cond_signal(&t->cv);
+    pthread_mutex_unlock(&t->mu);
+    return pdTRUE;
+}
+
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    uint8_t        *storage;
+    UBaseType_t     length, item_size, head, count;
+} queue_t;
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *qcb) {
+    queue_t *q = calloc(1, sizeof(*q));
+    pthread_mutex_init(&q->mu, NULL);
+    pthread_cond_init(&q->cv, NULL);
+    q->storage = storage;
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t wait) {
+    queue_t *q = handle;
+    struct timespec ts;
+    deadline(wait, &ts);
+    pthread_mutex_lock(&q->mu);
+    while (q->count == q->length) {
+        if (!block(&q->cv, &q->mu, wait, &ts)) {
+            pthread_mutex_unlock(&q->mu);
+            return pdFALSE;
+        }
+    }
+    memcpy(q->storage + (q->head + q->count) % q->length * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->mu);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t wait) {
+    queue_t *q = handle;
+    struct timespec ts;
+    deadline(wait, &ts);
+    pthread_mutex_lock(&q->mu);
+    while (q->count == 0) {
+        if (!block(&q->cv, &q->mu, wait, &ts)) {
+            pthread_mutex_unlock(&q->mu);
+            return pdFALSE;
+        }
+    }
+    memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->mu);
+    return pdTRUE;
+}
+
+// Counting semaphores; a mutex is one with a single token
+typedef struct {
+    pthread_mutex_t mu;
+    pthread_cond_t  cv;
+    UBaseType_t     count, max;
+} host_sem_t;
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial,
+                                                 StaticSemaphore_t *buf) {
+    host_sem_t *s = calloc(1, sizeof(*s));
+    pthread_mutex_init(&s->mu, NULL);
+    pthread_cond_init(&s->cv, NULL);
+    s->count = initial;
+    s->max = max;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) {
+    return xSemaphoreCreateCountingStatic(1, 1, buf);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t wait) {
+    host_sem_t *s = handle;
+    struct timespec ts;
+    deadline(wait, &ts);
+    pthread_mutex_lock(&s->mu);
+    while (s->count == 0) {
+        if (!block(&s->cv, &s->mu, wait, &ts)) {
+            pthread_mutex_unlock(&s->mu);
+            return pdFALSE;
+        }
+    }
+    s->count--;
+    pthread_mutex_unlock(&s->mu);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    host_sem_t *s = handle;
+    pthread_mutex_lock(&s->mu);
+    bool ok = s->count < s->max;
+    if (ok) {
+        s->count++;
+        pthread_cond_signal(&s->cv);
+    }
+    pthread_mutex_unlock(&s->mu);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t s) { }
+
+static UBaseType_t sem_count(SemaphoreHandle_t handle) {
+    host_sem_t *s = handle;
+    pthread_mutex_lock(&s->mu);
+    UBaseType_t n = s->count;
+    pthread_mutex_unlock(&s->mu);
+    return n;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) { return calloc(n, size); }
+void heap_caps_free(void *ptr) { free(ptr); }
+size_t heap_caps_get_free_size(uint32_t caps) { return 0; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 0; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return 0; }
+
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t n = strlen(src);
+    if (size) {
+        size_t k = n < size - 1 ? n : size - 1;
+        memcpy(dst, src, k);
+        dst[k] = '\0';
+    }
+    return n;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len) {
+    crc = (uint16_t)~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+    }
+    return (uint16_t)~crc;
+}
+
+/* ---------------------------- Fake modules ------------------------------ */
+
+// weighins.bin in memory; every read costs s_read_us, as a flash read would
+static uint8_t *s_log;
+static size_t   s_log_len;
+
+time_t clock_map_to_wall(int64_t mono_us) { return (time_t)(1760000000 + mono_us / 1000000); }
+uint8_t clock_map_boot_tag(void) { return 1; }
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall) { return false; }
+
+esp_err_t storage_open(const char *name, storage_file_t *f) {
+    f->fd = 3;
+    return ESP_OK;
+}
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got) {
+    if (s_read_us) usleep((useconds_t)s_read_us);
+    *got = 0;
+    if (offset >= s_log_len) return ESP_OK;
+    *got = len < s_log_len - offset ? len : s_log_len - offset;
+    memcpy(buf, s_log + offset, *got);
+    return ESP_OK;
+}
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync) {
+    if (offset + len > s_log_len) {
+        s_log = realloc(s_log, offset + len);
+        memset(s_log + s_log_len, 0, offset + len - s_log_len);
+        s_log_len = offset + len;
+    }
+    memcpy(s_log + offset, data, len);
+    return ESP_OK;
+}
+
+void storage_get_stats(storage_stats_t *out) { memset(out, 0, sizeof(*out)); }
+
+// Routes the bench does not request: they only have to link
+const scale_config_field_t scale_config_fields[] = { { 0 } };
+const size_t scale_config_field_count = 0;
+esp_err_t scale_config_publish(const scale_config_t *cfg, bool persist, const char **why) { return ESP_ERR_NOT_SUPPORTED; }
+void scale_config_snapshot(scale_config_t *out) { memset(out, 0, sizeof(*out)); }
+bool scale_config_set_field(scale_config_t *cfg, const char *name, double value) { return false; }
+double scale_config_get_field(const scale_config_t *cfg, const scale_config_field_t *field) { return 0; }
+esp_err_t user_profiles_set(uint8_t id, const char *name, const body_input_t *body, float weight_hint_g) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t user_profiles_delete(uint8_t id) { return ESP_ERR_NOT_SUPPORTED; }
+bool user_profiles_get(uint8_t id, user_profile_t *out) { return false; }
+int user_profiles_read_history(uint8_t id, uint32_t from_seq, user_history_record_t *out, int max) { return 0; }
+void hx711_get_health_stats(hx711_health_stats_t *out) { memset(out, 0, sizeof(*out)); }
+const char *hx711_health_name(hx711_health_t state) { return "ok"; }
+void jitter_monitor_reset(void) { }
+int jitter_monitor_to_json(char *buf, size_t len) { return -1; }
+void web_assets_get_stats(web_assets_stats_t *out) { memset(out, 0, sizeof(*out)); }
+esp_err_t web_assets_handler(httpd_req_t *req) { return httpd_resp_send_404(req); }
+
+void cJSON_InitHooks(cJSON_Hooks *hooks) { }
+cJSON *cJSON_Parse(const char *value) { return NULL; }
+cJSON *cJSON_CreateObject(void) { return NULL; }
+cJSON *cJSON_AddObjectToObject(cJSON *object, const char *name) { return NULL; }
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name) { return NULL; }
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number) { return NULL; }
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string) { return NULL; }
+bool cJSON_AddItemToArray(cJSON *array, cJSON *item) { return false; }
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *name) { return NULL; }
+bool cJSON_IsNumber(const cJSON *item) { return false; }
+bool cJSON_IsString(const cJSON *item) { return false; }
+bool cJSON_IsObject(const cJSON *item) { return false; }
+char *cJSON_PrintUnformatted(const cJSON *item) { return NULL; }
+void cJSON_Delete(cJSON *item) { }
+void cJSON_free(void *object) { free(object); }
+
+/* --------------------------- esp_http_server ---------------------------- */
+
+typedef struct {
+    int          fd;            // -1: free slot
+    bool         detached;      // Between async_handler_begin and _complete
+    bool         head_sent;     // Of the current response
+    double       last_used_ms;  // LRU purge order
+    char         rx[1024];      // Request body bytes read with the head
+    size_t       rx_len;
+    httpd_req_t  req;
+} session_t;
+
+static int             s_port;
+static int             s_wake[2];           // Worker → httpd: session complete
+static httpd_uri_t     s_handlers[MAX_HANDLERS];
+static int             s_nhandlers;
+static atomic_bool     s_stop;
+static atomic_int      s_busy_503, s_purged;
+
+static bool send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        p += w;
+        len -= (size_t)w;
+    }
+    return true;
+}
+
+static const char *reason(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 503: return "Service Unavailable";
+    default:  return "Internal Server Error";
+    }
+}
+
+// Status line and headers; chunked, or with a Content-Length of len
+static bool send_head(httpd_req_t *req, bool chunked, size_t len) {
+    session_t *s = req->aux;
+    char head[768];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", req->status,
+                     reason(req->status), req->type[0] ? req->type : "text/html");
+    for (const char *h = req->hdrs; *h && n < (int)sizeof(head); ) {
+        size_t k = strcspn(h, "\n");
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "%.*s\r\n", (int)k, h);
+        h += k + (h[k] == '\n');
+    }
+    if (chunked) {
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "Content-Length: %zu\r\n\r\n", len);
+    }
+    if (n >= (int)sizeof(head)) return false;
+    if (req->status == 503) atomic_fetch_add(&s_busy_503, 1);
+    s->head_sent = true;
+    return send_all(s->fd, head, (size_t)n);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status) {
+    req->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type) {
+    snprintf(req->type, sizeof(req->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value) {
+    size_t n = strlen(req->hdrs);
+    snprintf(req->hdrs + n, sizeof(req->hdrs) - n, "%s: %s\n", field, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len) {
+    if (len == HTTPD_RESP_USE_STRLEN) len = buf ? (ssize_t)strlen(buf) : 0;
+    session_t *s = req->aux;
+    bool ok = send_head(req, false, (size_t)len) && send_all(s->fd, buf, (size_t)len);
+    req->done = true;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len) {
+    if (len == HTTPD_RESP_USE_STRLEN) len = buf ? (ssize_t)strlen(buf) : 0;
+    session_t *s = req->aux;
+    if (!s->head_sent && !send_head(req, true, 0)) return ESP_FAIL;
+    if (!buf || len == 0) {
+        req->done = true;
+        return send_all(s->fd, "0\r\n\r\n", 5) ? ESP_OK : ESP_FAIL;
+    }
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", (size_t)len);
+    req->chunks++;
+    return send_all(s->fd, size, (size_t)n) && send_all(s->fd, buf, (size_t)len) &&
+           send_all(s->fd, "\r\n", 2) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t err, const char *msg) {
+    static const int codes[] = { 400, 404, 500 };
+    req->status = codes[err];
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_send(req, msg ? msg : reason(req->status), HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *req) {
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t len) {
+    session_t *s = req->aux;
+    if (s->rx_len) {
+        size_t k = len < s->rx_len ? len : s->rx_len;
+        memcpy(buf, s->rx, k);
+        memmove(s->rx, s->rx + k, s->rx_len - k);
+        s->rx_len -= k;
+        return (int)k;
+    }
+    ssize_t r = recv(s->fd, buf, len, 0);
+    return r > 0 ? (int)r : -1;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t len) {
+    const char *q = strchr(req->uri, '?');
+    if (!q) return ESP_ERR_NOT_FOUND;
+    return (size_t)snprintf(buf, len, "%s", q + 1) < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t len) {
+    size_t klen = strlen(key);
+    for (const char *p = qry; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL) {
+        if (!strncmp(p, key, klen) && p[klen] == '=') {
+            const char *v = p + klen + 1;
+            size_t n = strcspn(v, "&");
+            snprintf(val, len, "%.*s", (int)n, v);
+            return n < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// As in esp_http_server: a trailing '*' matches any rest, a trailing '?'
+// makes the character before it optional, and "?*" does both
+bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t len) {
+    size_t n = strlen(tpl);
+    bool any = n > 0 && tpl[n - 1] == '*';
+    if (any) n--;
+    bool opt = n > 1 && tpl[n - 1] == '?';
+    if (opt) n -= 2;
+    if (len < n || strncmp(tpl, uri, n) != 0) return false;
+    if (opt && len > n && uri[n] == tpl[n]) n++;
+    return any || len == n;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri) {
+    if (s_nhandlers == MAX_HANDLERS) return ESP_ERR_NO_MEM;
+    s_handlers[s_nhandlers++] = *uri;
+    return ESP_OK;
+}
+
+// The worker gets its own copy; the session stays out of the poll set
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out) {
+    httpd_req_t *copy = malloc(sizeof(*copy));
+    if (!copy) return ESP_ERR_NO_MEM;
+    *copy = *r;
+    ((session_t *)r->aux)->detached = true;
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r) {
+    session_t *s = r->aux;
+    free(r);
+    if (write(s_wake[1], &s, sizeof(s)) < 0) return ESP_FAIL;
+    return ESP_OK;
+}
+
+static const httpd_uri_t *find_handler(int method, const char *uri) {
+    size_t len = strcspn(uri, "?");
+    for (int i = 0; i < s_nhandlers; i++) {
+        if ((int)s_handlers[i].method == method && httpd_uri_match_wildcard(s_handlers[i].uri, uri, len)) {
+            return &s_handlers[i];
+        }
+    }
+    return NULL;
+}
+
+// One request from the session's socket; false when the session closes
+static bool serve(session_t *s) {
+    char buf[1024];
+    ssize_t r = recv(s->fd, buf, sizeof(buf) - 1, 0);
+    if (r <= 0) return false;
+    buf[r] = '\0';
+    s->last_used_ms = now_ms();
+
+    char method[8];
+    httpd_req_t *req = &s->req;
+    memset(req, 0, sizeof(*req));
+    req->aux = s;
+    req->status = 200;
+    if (sscanf(buf, "%7s %512s", method, req->uri) != 2) return false;
+    req->method = !strcmp(method, "POST") ? HTTP_POST : !strcmp(method, "DELETE") ? HTTP_DELETE : HTTP_GET;
+    const char *cl = strcasestr(buf, "\r\nContent-Length:");
+    req->content_len = cl ? strtoul(cl + 17, NULL, 10) : 0;
+    const char *body = strstr(buf, "\r\n\r\n");
+    s->rx_len = body ? (size_t)(buf + r - (body + 4)) : 0;
+    if (s->rx_len) memcpy(s->rx, body + 4, s->rx_len);
+    s->head_sent = false;
+
+    const httpd_uri_t *h = find_handler(req->method, req->uri);
+    if (!h) return httpd_resp_send_404(req) == ESP_OK;
+    req->user_ctx = h->user_ctx;
+    if (!s_async) {
+        // Before the route table every handler ran here; a stream would
+        // hold the httpd task for good
+        const rest_route_t *route = h->user_ctx;
+        if (route->stream) {
+            send_busy(req);
+            return true;
+        }
+        return route->handler(req) == ESP_OK;
+    }
+    return h->handler(req) == ESP_OK;
+}
+
+static void *httpd_thread(void *arg) {
+    int ls = (int)(intptr_t)arg;
+    session_t *sess = calloc(REST_MAX_SOCKETS, sizeof(*sess));
+    for (int i = 0; i < REST_MAX_SOCKETS; i++) sess[i].fd = -1;
+    int detached = 0;
+
+    // Stop once no worker still owns a session
+    while (!atomic_load(&s_stop) || detached) {
+        struct pollfd p[REST_MAX_SOCKETS + 2] = { { ls, POLLIN, 0 }, { s_wake[0], POLLIN, 0 } };
+        int idx[REST_MAX_SOCKETS + 2], np = 2;
+        detached = 0;
+        for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+            if (sess[i].fd < 0) continue;
+            if (sess[i].detached) {
+                detached++;
+                continue;
+            }
+            idx[np] = i;
+            p[np++] = (struct pollfd){ sess[i].fd, POLLIN, 0 };
+        }
+        if (poll(p, (nfds_t)np, 50) <= 0) continue;
+
+        if (p[1].revents & POLLIN) {
+            session_t *s;
+            if (read(s_wake[0], &s, sizeof(s)) == sizeof(s)) s->detached = false;
+            continue;   // Poll set changed
+        }
+        if (p[0].revents & POLLIN) {
+            int fd = accept(ls, NULL, NULL);
+            if (fd < 0) continue;
+            int one = 1, free_slot = -1, lru = -1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+                if (sess[i].fd < 0) {
+                    if (free_slot < 0) free_slot = i;
+                } else if (!sess[i].detached && (lru < 0 || sess[i].last_used_ms < sess[lru].last_used_ms)) {
+                    lru = i;
+                }
+            }
+            if (free_slot < 0 && lru >= 0) {
+                // lru_purge_enable: close the least recently used idle session
+                close(sess[lru].fd);
+                sess[lru].fd = -1;
+                free_slot = lru;
+                atomic_fetch_add(&s_purged, 1);
+            }
+            if (free_slot < 0) {
+                close(fd);
+                continue;
+            }
+            sess[free_slot] = (session_t){ .fd = fd, .last_used_ms = now_ms() };
+            continue;
+        }
+        for (int k = 2; k < np; k++) {
+            if (!(p[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            session_t *s = &sess[idx[k]];
+            if (!serve(s) && !s->detached) {
+                close(s->fd);
+                s->fd = -1;
+            }
+        }
+    }
+    // Closing the listener resets connections still in the backlog
+    for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+        if (sess[i].fd >= 0) close(sess[i].fd);
+    }
+    free(sess);
+    close(ls);
+    return NULL;
+}
+
+// The connection manager's HTTPS subscriber, at the stream rate
+static void *feeder_thread(void *arg) {
+    for (uint32_t seq = 1;; seq++) {
+        measurement_t m = { .weight_g = 70000.0f + (float)(seq % 100), .mono_us = esp_timer_get_time(),
+                            .timestamp = 1760000000 + seq / REST_STREAM_HZ, .seq = seq, .user_id = 1,
+                            .kind = MEAS_KIND_LOCKED };
+        rest_api_set_latest_measurement(&m);
+        usleep(1000000 / REST_STREAM_HZ);
+    }
+    return NULL;
+}
+
+/* ------------------------------- Clients -------------------------------- */
+
+typedef struct {
+    int     status;             // 0 = connection lost
+    size_t  body;               // Decoded body bytes
+    int     tuples;             // "[seq," entries
+    bool    complete;
+} response_t;
+
+static int connect_server(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons((uint16_t)s_port),
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (connect(fd, (struct sockaddr *)&a, sizeof(a)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+typedef struct {
+    int    fd;
+    char   buf[16384];
+    size_t len, pos;
+} reader_t;
+
+static bool fill(reader_t *rd) {
+    if (rd->pos == rd->len) rd->pos = rd->len = 0;
+    if (rd->len == sizeof(rd->buf)) {
+        memmove(rd->buf, rd->buf + rd->pos, rd->len - rd->pos);
+        rd->len -= rd->pos;
+        rd->pos = 0;
+    }
+    ssize_t r = recv(rd->fd, rd->buf + rd->len, sizeof(rd->buf) - rd->len, 0);
+    if (r <= 0) return false;
+    rd->len += (size_t)r;
+    return true;
+}
+
+static bool read_line(reader_t *rd, char *line, size_t max) {
+    for (;;) {
+        char *nl = memchr(rd->buf + rd->pos, '\n', rd->len - rd->pos);
+        if (nl) {
+            size_t n = (size_t)(nl - (rd->buf + rd->pos)) + 1;
+            size_t k = n < max ? n : max - 1;
+            memcpy(line, rd->buf + rd->pos, k);
+            line[k] = '\0';
+            rd->pos += n;
+            return true;
+        }
+        if (!fill(rd)) return false;
+    }
+}
+
+static bool read_body(reader_t *rd, size_t n, response_t *out, char *prev) {
+    while (n) {
+        if (rd->pos == rd->len && !fill(rd)) return false;
+        size_t k = rd->len - rd->pos < n ? rd->len - rd->pos : n;
+        for (size_t i = 0; i < k; i++) {
+            char c = rd->buf[rd->pos + i];
+            if (*prev == '[' && c >= '0' && c <= '9') out->tuples++;
+            *prev = c;
+        }
+        rd->pos += k;
+        out->body += k;
+        n -= k;
+    }
+    return true;
+}
+
+static response_t read_response(reader_t *rd) {
+    response_t out = { 0 };
+    char line[256], prev = '\n';
+    size_t content_len = 0;
+    bool chunked = false;
+    if (!read_line(rd, line, sizeof(line)) || sscanf(line, "HTTP/1.1 %d", &out.status) != 1) {
+        out.status = 0;
+        return out;
+    }
+    while (read_line(rd, line, sizeof(line)) && strcmp(line, "\r\n") != 0) {
+        if (!strncasecmp(line, "Content-Length:", 15)) content_len = strtoul(line + 15, NULL, 10);
+        if (!strncasecmp(line, "Transfer-Encoding: chunked", 26)) chunked = true;
+    }
+    if (!chunked) {
+        out.complete = read_body(rd, content_len, &out, &prev);
+        if (!out.complete) out.status = 0;
+        return out;
+    }
+    for (;;) {
+        if (!read_line(rd, line, sizeof(line))) break;
+        size_t n = strtoul(line, NULL, 16);
+        if (n == 0) {
+            out.complete = read_line(rd, line, sizeof(line));
+            break;
+        }
+        if (!read_body(rd, n, &out, &prev) || !read_line(rd, line, sizeof(line))) break;
+    }
+    if (!out.complete) out.status = 0;
+    return out;
+}
+
+static double      s_lat[MAX_SAMPLES];
+static atomic_int  s_nlat;
+static atomic_int  s_hist_ok, s_hist_bad, s_reconnects, s_events;
+
+static void reconnect(reader_t *rd) {
+    if (rd->fd >= 0) close(rd->fd);
+    atomic_fetch_add(&s_reconnects, 1);
+    usleep(10000);
+    rd->fd = connect_server();
+    rd->len = rd->pos = 0;
+}
+
+static void *weight_client(void *arg) {
+    reader_t *rd = calloc(1, sizeof(*rd));
+    rd->fd = connect_server();
+    while (!atomic_load(&s_stop)) {
+        double t0 = now_ms();
+        response_t r = { 0 };
+        if (rd->fd >= 0 && send_all(rd->fd, "GET /weight HTTP/1.1\r\nHost: scale\r\n\r\n", 37)) {
+            r = read_response(rd);
+        }
+        if (r.status != 200) {
+            // Purged or refused: reconnect, the way a browser would
+            if (atomic_load(&s_stop)) break;
+            reconnect(rd);
+            continue;
+        }
+        int i = atomic_fetch_add(&s_nlat, 1);
+        if (i < MAX_SAMPLES) s_lat[i] = now_ms() - t0;
+        usleep(5000);
+    }
+    if (rd->fd >= 0) close(rd->fd);
+    free(rd);
+    return NULL;
+}
+
+static void *history_client(void *arg) {
+    static const char req[] = "GET /history HTTP/1.1\r\nHost: scale\r\n\r\n";
+    reader_t *rd = calloc(1, sizeof(*rd));
+    rd->fd = connect_server();
+    while (!atomic_load(&s_stop)) {
+        response_t r = { 0 };
+        if (rd->fd >= 0 && send_all(rd->fd, req, sizeof(req) - 1)) {
+            r = read_response(rd);
+        }
+        if (r.status == 503) {
+            usleep(1000000);        // Retry-After: 1
+            continue;
+        }
+        if (r.status == 200) {
+            if (r.tuples == WEIGH_LOG_CAPACITY) atomic_fetch_add(&s_hist_ok, 1);
+            else atomic_fetch_add(&s_hist_bad, 1);
+            continue;
+        }
+        if (atomic_load(&s_stop)) break;
+        reconnect(rd);
+    }
+    if (rd->fd >= 0) close(rd->fd);
+    free(rd);
+    return NULL;
+}
+
+// An open EventSource: counts "data:" events until the run stops, then
+// leaves (the handler notices on its next send); 503 retried
+static void *stream_client(void *arg) {
+    static const char req[] = "GET /stream HTTP/1.1\r\nHost: scale\r\n\r\n";
+    reader_t *rd = calloc(1, sizeof(*rd));
+    rd->fd = connect_server();
+    while (!atomic_load(&s_stop)) {
+        char line[256];
+        int status = 0;
+        if (rd->fd >= 0 && send_all(rd->fd, req, sizeof(req) - 1) &&
+            read_line(rd, line, sizeof(line))) {
+            sscanf(line, "HTTP/1.1 %d", &status);
+        }
+        if (status == 503) {
+            response_t skip = { 0 };
+            char prev = 0;
+            while (read_line(rd, line, sizeof(line)) && strcmp(line, "\r\n") != 0) { }
+            read_body(rd, 4, &skip, &prev);     // "Busy"
+            usleep(1000000);
+            continue;
+        }
+        if (status != 200) {
+            if (atomic_load(&s_stop)) break;
+            reconnect(rd);
+            continue;
+        }
+        struct pollfd p = { rd->fd, POLLIN, 0 };
+        while (!atomic_load(&s_stop)) {
+            if (rd->pos == rd->len && poll(&p, 1, 50) == 0) continue;
+            if (!read_line(rd, line, sizeof(line))) break;
+            if (!strncmp(line, "data: ", 6)) atomic_fetch_add(&s_events, 1);
+        }
+        break;
+    }
+    if (rd->fd >= 0) close(rd->fd);
+    free(rd);
+    return NULL;
+}
+
+/* -------------------------------- Runs ---------------------------------- */
+
+typedef struct {
+    const char *name;
+    int weight, history, stream;
+} scenario_t;
+
+typedef struct {
+    int    samples;
+    double p50, p99, max;
+    int    hist_ok, hist_bad, busy, purged, reconnects, events;
+    bool   released;            // Workers and stream slots all back afterwards
+} result_t;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Workers give s_idle back just after completing; allow them a moment
+static bool pool_released(void) {
+    for (int i = 0; i < 100; i++) {
+        if (sem_count(s_idle) == RES_HTTP_WORKERS && sem_count(s_stream_slots) == RES_HTTP_WORKERS - 1) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+static result_t run(const scenario_t *sc, bool async) {
+    s_async = async;
+    atomic_store(&s_stop, false);
+    atomic_store(&s_nlat, 0);
+    atomic_store(&s_hist_ok, 0);
+    atomic_store(&s_hist_bad, 0);
+    atomic_store(&s_reconnects, 0);
+    atomic_store(&s_events, 0);
+    atomic_store(&s_busy_503, 0);
+    atomic_store(&s_purged, 0);
+
+    int ls = socket(AF_INET, SOCK_STREAM, 0), one = 1;
+    setsockopt(ls, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t alen = sizeof(a);
+    if (bind(ls, (struct sockaddr *)&a, sizeof(a)) < 0 || listen(ls, 2) < 0 ||
+        getsockname(ls, (struct sockaddr *)&a, &alen) < 0) {
+        perror("listen");
+        exit(2);
+    }
+    s_port = ntohs(a.sin_port);
+
+    pthread_t srv, cl[MAX_CLIENTS];
+    int ncl = 0;
+    pthread_create(&srv, NULL, httpd_thread, (void *)(intptr_t)ls);
+    for (int i = 0; i < sc->stream; i++) pthread_create(&cl[ncl++], NULL, stream_client, NULL);
+    usleep(20000);      // Stream first, as a dashboard left open would be
+    for (int i = 0; i < sc->history; i++) pthread_create(&cl[ncl++], NULL, history_client, NULL);
+    for (int i = 0; i < sc->weight; i++) pthread_create(&cl[ncl++], NULL, weight_client, NULL);
+
+    usleep((useconds_t)(s_seconds * 1e6));
+    atomic_store(&s_stop, true);
+    for (int i = 0; i < ncl; i++) pthread_join(cl[i], NULL);
+    pthread_join(srv, NULL);
+
+    result_t r = { 0 };
+    r.released = pool_released();
+    r.samples = atomic_load(&s_nlat) < MAX_SAMPLES ? atomic_load(&s_nlat) : MAX_SAMPLES;
+    qsort(s_lat, (size_t)r.samples, sizeof(double), cmp_double);
+    if (r.samples) {
+        r.p50 = s_lat[r.samples / 2];
+        r.p99 = s_lat[r.samples * 99 / 100];
+        r.max = s_lat[r.samples - 1];
+    }
+    r.hist_ok = atomic_load(&s_hist_ok);
+    r.hist_bad = atomic_load(&s_hist_bad);
+    r.busy = atomic_load(&s_busy_503);
+    r.purged = atomic_load(&s_purged);
+    r.reconnects = atomic_load(&s_reconnects);
+    r.events = atomic_load(&s_events);
+    return r;
+}
+
+static void print_result(const char *mode, const result_t *r) {
+    printf("  %-5s  %6d  %7.2f  %7.2f  %7.1f  %5d  %5d  %5d  %6d  %6d\n", mode, r->samples,
+           r->p50, r->p99, r->max, r->hist_ok, r->busy, r->purged, r->reconnects, r->events);
+}
+
+static int s_failures;
+
+static void expect(bool ok, const char *what) {
+    printf("  %-68s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) s_failures++;
+}
+
+// A full log, written with no read cost
+static void fill_log(void) {
+    int read_us = s_read_us;
+    s_read_us = 0;
+    if (weigh_log_init() != ESP_OK) {
+        fprintf(stderr, "weigh_log_init failed\n");
+        exit(2);
+    }
+    for (int i = 0; i < WEIGH_LOG_CAPACITY; i++) {
+        weigh_log_append(70000.0f + (float)i, (int64_t)i * 60000000, 1, NULL);
+    }
+    s_read_us = read_us;
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        { "seconds", required_argument, NULL, 't' },
+        { "read-us", required_argument, NULL, 'r' },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 't': s_seconds = atof(optarg); break;
+        case 'r': s_read_us = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [--seconds S] [--read-us US]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (pipe(s_wake) < 0) return 1;
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    fill_log();
+    httpd_config_t cfg = { 0 };
+    rest_api_tune(&cfg);
+    if (cfg.max_open_sockets != REST_MAX_SOCKETS || rest_api_register(&cfg) != ESP_OK) {
+        fprintf(stderr, "rest_api_register failed\n");
+        return 2;
+    }
+    pthread_t feeder;
+    pthread_create(&feeder, NULL, feeder_thread, NULL);
+    pthread_detach(feeder);
+
+    static const scenario_t scenarios[] = {
+        { "3 /weight",                         3, 0, 0 },
+        { "3 /weight + 1 /history",            3, 1, 0 },
+        { "2 /weight + 2 /history",            2, 2, 0 },
+        { "2 /weight + 1 /history + 1 /stream", 2, 1, 1 },
+        { "3 /weight + 3 /history (> sockets)", 3, 3, 0 },
+    };
+    enum { NSC = sizeof(scenarios) / sizeof(scenarios[0]) };
+    result_t sync_r[NSC], async_r[NSC];
+
+    printf("%d sockets, %d workers, /history %d x %d records at %d us per read, %.1f s per run\n",
+           REST_MAX_SOCKETS, RES_HTTP_WORKERS, HISTORY_CHUNKS, REST_HISTORY_CHUNK, s_read_us, s_seconds);
+    printf("/weight latency in ms; hist = complete /history bodies, purged = LRU closes\n");
+    for (int i = 0; i < NSC; i++) {
+        printf("\n%s\n", scenarios[i].name);
+        printf("  mode   /weight     p50      p99      max   hist    503  purged  reconn  events\n");
+        sync_r[i] = run(&scenarios[i], false);
+        print_result("sync", &sync_r[i]);
+        async_r[i] = run(&scenarios[i], true);
+        print_result("async", &async_r[i]);
+    }
+
+    rest_api_stats_t st;
+    rest_api_get_stats(&st);
+    printf("\nrest_api: %u requests, %u on workers, %u busy, %u streams open\n",
+           (unsigned)st.requests, (unsigned)st.async_runs, (unsigned)st.busy, (unsigned)st.streams_open);
+
+    printf("\nChecks\n");
+    bool bodies = true, released = true;
+    for (int i = 0; i < NSC; i++) {
+        bodies &= sync_r[i].hist_bad == 0 && async_r[i].hist_bad == 0;
+        released &= sync_r[i].released && async_r[i].released;
+    }
+    expect(bodies, "every /history body complete");
+    expect(released && st.streams_open == 0, "every worker and stream slot returned after each run");
+    expect(async_r[1].p99 * 10 < sync_r[1].p99,
+           "one /history reader: async /weight p99 10x below sync");
+    expect(async_r[2].hist_ok > 0 && async_r[2].busy == 0,
+           "two /history readers fit the worker pool without a 503");
+    expect(async_r[3].events > 0 && async_r[3].hist_ok > 0,
+           "an open /stream leaves a worker for /history");
+    expect(async_r[4].busy > 0 && async_r[4].hist_ok > 0 && async_r[4].samples > 0,
+           "more readers than workers get 503 and retry, /weight still answers");
+
+    if (s_failures) {
+        printf("\n%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("\nall checks passed\n");
+    return 0;
+}
@@ -0,0 +1,226 @@
+// File: tools/hx711_sim/chip.c
+// ---------------------------------------------------------------------------
+// Simulated HX711 and the IDF/FreeRTOS calls hx711.c makes (see chip.h)
+// ---------------------------------------------------------------------------
+
+#include "chip.h"
+
+#include <math.h>
+#include <setjmp.h>
+#include <string.h>
+
+#include "resources.h"
+
+static int64_t      s_now_us;
+static int64_t      s_until_us = INT64_MAX;
+static jmp_buf      s_deadline;
+static chip_hooks_t s_hooks;
+static chip_stats_t s_stats;
+static int64_t      s_busy_since;
+static int64_t      s_hold_since = -1;
+
+static chip_mode_t  s_mode;
+static int          s_late_every;
+static double       s_load_raw;
+static double       s_noise_rms;
+static uint32_t     s_rng;
+static bool         s_sck;
+static int64_t      s_sck_high_at;
+static int64_t      s_ready_at;
+static int          s_edges;            // Rising SCK edges in this read
+static uint32_t     s_word;
+static uint32_t     s_count;            // Conversions since power-up
+
+/* ------------------------------- Chip ----------------------------------- */
+
+static double gauss(void) {
+    s_rng = s_rng * 1103515245u + 12345u;
+    double u1 = ((s_rng >> 8) & 0xFFFF) / 65536.0 + 1e-9;
+    s_rng = s_rng * 1103515245u + 12345u;
+    double u2 = ((s_rng >> 8) & 0xFFFF) / 65536.0;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void power_up(void) {
+    s_edges = 0;
+    s_count = 0;
+    s_ready_at = s_now_us + CHIP_SETTLE_US;
+    s_stats.power_ups++;
+}
+
+static void next_conversion(void) {
+    s_count++;
+    s_ready_at = s_now_us + CHIP_PERIOD_US;
+    if (s_mode == CHIP_LATE && s_late_every > 0 && s_count % s_late_every == 0) {
+        s_ready_at += CHIP_LATE_US;
+    }
+}
+
+static bool powered(void) {
+    return !(s_sck && s_now_us - s_sck_high_at > 60);
+}
+
+int gpio_get_level(gpio_num_t pin) {
+    if (pin != CHIP_DOUT) return 0;
+    switch (s_mode) {
+        case CHIP_UNPLUGGED: return 1;
+        case CHIP_DOUT_LOW:  return 0;
+        default:             break;
+    }
+    if (!powered()) return 1;
+    if (s_edges >= 1 && s_edges <= 24) return (s_word >> (24 - s_edges)) & 1;
+    if (s_edges > 24) return 1;
+    return s_now_us >= s_ready_at ? 0 : 1;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if (pin != CHIP_SCK || (bool)level == s_sck) return ESP_OK;
+    s_sck = level;
+    if (level) {
+        s_sck_high_at = s_now_us;
+        if (s_edges == 0 && s_now_us >= s_ready_at) {
+            double v = s_mode == CHIP_OVERLOAD ? 0x7FFFFF : s_load_raw + s_noise_rms * gauss();
+            v = fmin(fmax(round(v), -0x800000), 0x7FFFFF);
+            s_word = (uint32_t)(int32_t)v & 0xFFFFFF;
+            s_edges = 1;
+        } else if (s_edges > 0) {
+            s_edges++;
+        }
+    } else if (s_now_us - s_sck_high_at > 60) {
+        power_up();             // Falling edge after a power-down
+    } else if (s_edges >= 25) {
+        s_edges = 0;            // Gain pulse(s) done
+        s_stats.conversions++;
+        next_conversion();
+    }
+    return ESP_OK;
+}
+
+// The ESP32 resets SCK to an input: the pull-down takes it low
+esp_err_t gpio_reset_pin(gpio_num_t pin) {
+    return pin == CHIP_SCK ? gpio_set_level(pin, 0) : ESP_OK;
+}
+
+void chip_reset(uint32_t seed, double noise_rms) {
+    s_now_us = 0;
+    s_rng = seed;
+    s_noise_rms = noise_rms;
+    s_mode = CHIP_LIVE;
+    s_late_every = 0;
+    s_sck = false;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_busy_since = 0;
+    s_hold_since = -1;
+    power_up();
+}
+
+void chip_set_mode(chip_mode_t mode, int late_every) {
+    s_mode = mode;
+    s_late_every = late_every;
+}
+
+void chip_set_load(double raw) {
+    s_load_raw = raw;
+}
+
+void chip_sleep(int64_t us) {
+    gpio_set_level(CHIP_SCK, 1);
+    s_now_us += us;
+    s_busy_since = s_now_us;
+}
+
+int64_t chip_now_us(void) {
+    return s_now_us;
+}
+
+void chip_set_hooks(const chip_hooks_t *hooks) {
+    s_hooks = hooks ? *hooks : (chip_hooks_t){ 0 };
+}
+
+void chip_take_stats(chip_stats_t *out) {
+    *out = s_stats;
+    s_stats.max_busy_us = s_stats.max_hold_us = 0;
+}
+
+void chip_run(void (*task)(void *), void *arg, int64_t until_us) {
+    s_until_us = until_us;
+    s_busy_since = s_now_us;
+    if (!setjmp(s_deadline)) {
+        task(arg);
+    }
+    s_until_us = INT64_MAX;
+    s_hold_since = -1;          // Unwound with the mutex taken
+}
+
+/* ------------------------------ Scheduling ------------------------------ */
+
+static void yield_for(int64_t us) {
+    int64_t busy = s_now_us - s_busy_since;
+    if (busy > s_stats.max_busy_us) s_stats.max_busy_us = busy;
+    if (s_hooks.on_yield) s_hooks.on_yield(s_hooks.ctx);   // State as of the yield
+    s_now_us += us;
+    s_busy_since = s_now_us;
+    if (s_now_us >= s_until_us) longjmp(s_deadline, 1);
+}
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+uint32_t esp_log_timestamp(void) { return (uint32_t)(s_now_us / 1000); }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(s_now_us / 1000); }
+void ets_delay_us(uint32_t us) { s_now_us += us; }
+void vTaskDelay(TickType_t ticks) { yield_for((int64_t)ticks * 1000); }
+const char *esp_err_to_name(esp_err_t code) { return "error"; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return (TaskHandle_t)&s_hooks; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) { }
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+    if (s_hooks.on_sample) s_hooks.on_sample(*(const float *)item, s_hooks.ctx);
+    return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+void vSemaphoreDelete(SemaphoreHandle_t s) { }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+    s_hold_since = s_now_us;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+    if (s_hold_since >= 0 && s_now_us - s_hold_since > s_stats.max_hold_us) {
+        s_stats.max_hold_us = s_now_us - s_hold_since;
+    }
+    s_hold_since = -1;
+    return pdTRUE;
+}
+
+// The sampling task is run by chip_run(); the queue only feeds on_sample
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name, void *arg) {
+    return NULL;
+}
+
+QueueHandle_t res_queue_create(res_queue_t id, int instance, UBaseType_t length, UBaseType_t item_size) {
+    return (QueueHandle_t)&s_stats;
+}
+
+/* --------------------------------- GPIO --------------------------------- */
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) { return ESP_OK; }
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t mode) { return ESP_OK; }
+esp_err_t gpio_hold_dis(gpio_num_t pin) { return ESP_OK; }
+// No DOUT interrupt: the sampling task polls, as on a board without one
+esp_err_t gpio_install_isr_service(int flags) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t fn, void *arg) { return ESP_OK; }
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) { return ESP_OK; }
+esp_err_t gpio_intr_enable(gpio_num_t pin) { return ESP_OK; }
+esp_err_t gpio_intr_disable(gpio_num_t pin) { return ESP_OK; }
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) { return ESP_OK; }
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) { return ESP_OK; }
+
+// No NVS on the host: scale_config_init() keeps the defaults
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h) { return ESP_ERR_NOT_FOUND; }
+void nvs_close(nvs_handle_t h) { }
+esp_err_t nvs_commit(nvs_handle_t h) { return ESP_OK; }
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len) { return ESP_ERR_NOT_FOUND; }
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len) { return ESP_ERR_NOT_FOUND; }
@@ -0,0 +1,61 @@
+// File: tools/hx711_sim/chip.h
+// ---------------------------------------------------------------------------
+// Simulated HX711 on a virtual clock, shared by the hx711_sim programs
+//   - 10 SPS conversions, 400 ms settling after power-up (SCK low after
+//     more than 60 us high), 24 data bits MSB first, gain pulses after
+//   - Wiring faults: unplugged (DOUT pulled up, never ready), DOUT stuck
+//     low (every code 0), overload (saturated code), late conversions
+//   - Time moves only in ets_delay_us, vTaskDelay and the ready wait, so
+//     a firmware task runs until chip_run()'s deadline unwinds it
+//   - Samples the task queues and the longest busy/mutex stretches are
+//     reported through chip_hooks_t / chip_stats_t
+// ---------------------------------------------------------------------------
+#ifndef CHIP_H
+#define CHIP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hx711.h"
+
+#define CHIP_DOUT           GPIO_NUM_4
+#define CHIP_SCK            GPIO_NUM_22
+#define CHIP_PERIOD_US      100000      // RATE low: 10 SPS
+#define CHIP_SETTLE_US      400000      // First conversion after power-up
+#define CHIP_LATE_US        250000      // Extra delay of a late conversion
+
+typedef enum {
+    CHIP_LIVE = 0,
+    CHIP_UNPLUGGED,         // DOUT pulled up by the ESP32: never ready
+    CHIP_DOUT_LOW,          // Shorted/dead: always "ready", every bit 0
+    CHIP_OVERLOAD,          // Input out of range: 0x7FFFFF
+    CHIP_LATE,              // Every chip_late_every-th conversion late
+} chip_mode_t;
+
+typedef struct {
+    void (*on_sample)(float value, void *ctx);     // xQueueSend of the task
+    void (*on_yield)(void *ctx);                   // Every vTaskDelay
+    void  *ctx;
+} chip_hooks_t;
+
+typedef struct {
+    uint32_t conversions;       // Conversions clocked out
+    uint32_t power_ups;
+    int64_t  max_busy_us;       // Longest stretch without yielding
+    int64_t  max_hold_us;       // Longest sensor mutex hold
+} chip_stats_t;
+
+/** @brief Chip powered up at time 0 in CHIP_LIVE, seeded noise. */
+void    chip_reset(uint32_t seed, double noise_rms);
+void    chip_set_mode(chip_mode_t mode, int late_every);
+void    chip_set_load(double raw);
+/** @brief SCK held high across a sleep: chip powered down until SCK falls. */
+void    chip_sleep(int64_t us);
+int64_t chip_now_us(void);
+void    chip_set_hooks(const chip_hooks_t *hooks);
+/** @brief Stats since the last call (busy/hold maxima start over). */
+void    chip_take_stats(chip_stats_t *out);
+
+/** @brief Run a firmware task until the virtual clock reaches until_us. */
+void    chip_run(void (*task)(void *), void *arg, int64_t until_us);
+
+#endif // CHIP_H
@@ -0,0 +1,272 @@
+// File: tools/hx711_sim/health_sim.c
+// ---------------------------------------------------------------------------
+// HX711 sensor health on a simulated chip (see chip.h)
+//   - hx711.c compiled in unchanged; hx711_rtos_task runs as-is on the
+//     virtual clock through a scripted day of wiring faults:
+//     unplug/replug (with a different load), DOUT stuck low, overload,
+//     late conversions
+//   - Per phase: the state timeline, samples queued, fault counters,
+//     re-probes, and the longest busy / mutex-held stretch
+//   - Checked against hx711.h: timeouts → OFFLINE after
+//     HX711_OFFLINE_TIMEOUTS, probes on the doubling backoff, a stuck
+//     code stays OFFLINE, overload and late conversions only degrade,
+//     HX711_RECOVER_SAMPLES good samples to OK, filters reseeded on
+//     recovery, no faulted sample queued, the task never hangs
+//
+//   make -C tools/hx711_sim
+//   tools/hx711_sim/health_sim [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "chip.h"
+#include "hx711.c"
+
+#define NOISE_RMS       50.0        // Counts, a 24-bit front end at 10 SPS
+#define MAX_CHANGES     16
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+typedef struct {
+    int64_t        start_us;
+    hx711_health_t state;
+    int            changes;
+    int64_t        at_us[MAX_CHANGES];      // Since the phase start
+    hx711_health_t to[MAX_CHANGES];
+    int            samples;
+    int            samples_after_offline;
+    float          first, last;
+    float          min, max;
+} phase_log_t;
+
+static phase_log_t s_log;
+
+static void observe(void *ctx) {
+    hx711_health_t now = hx711_get_health();
+    if (now != s_log.state && s_log.changes < MAX_CHANGES) {
+        s_log.at_us[s_log.changes] = chip_now_us() - s_log.start_us;
+        s_log.to[s_log.changes++] = now;
+    }
+    s_log.state = now;
+}
+
+static void on_sample(float v, void *ctx) {
+    observe(ctx);
+    if (s_log.samples++ == 0) s_log.first = v;
+    s_log.last = v;
+    s_log.min = fminf(s_log.min, v);
+    s_log.max = fmaxf(s_log.max, v);
+    if (s_log.state == HX711_HEALTH_OFFLINE) s_log.samples_after_offline++;
+}
+
+// First time the phase entered state, -1 if it never did
+static double entered_s(hx711_health_t state) {
+    for (int i = 0; i < s_log.changes; i++) {
+        if (s_log.to[i] == state) return s_log.at_us[i] / 1e6;
+    }
+    return -1.0;
+}
+
+static bool ever(hx711_health_t state) {
+    return s_log.state == state || entered_s(state) >= 0.0;
+}
+
+typedef struct {
+    hx711_health_stats_t hs;    // Counter deltas over the phase
+    chip_stats_t         chip;
+} phase_result_t;
+
+static phase_result_t run_phase(hx711_t *scale, const char *what, chip_mode_t mode,
+                                double load_raw, double seconds) {
+    hx711_health_stats_t before, after;
+    hx711_get_health_stats(&before);
+    chip_stats_t cs;
+    chip_take_stats(&cs);
+
+    s_log = (phase_log_t){ .start_us = chip_now_us(), .state = hx711_get_health(),
+                           .min = INFINITY, .max = -INFINITY };
+    hx711_health_t from = s_log.state;
+    chip_set_mode(mode, 4);
+    chip_set_load(load_raw);
+    chip_run(hx711_rtos_task, scale, chip_now_us() + (int64_t)(seconds * 1e6));
+
+    hx711_get_health_stats(&after);
+    phase_result_t r = { .hs = after };
+    r.hs.timeouts -= before.timeouts;
+    r.hs.saturated -= before.saturated;
+    r.hs.stuck -= before.stuck;
+    r.hs.offline_events -= before.offline_events;
+    r.hs.probes -= before.probes;
+    chip_take_stats(&r.chip);
+    r.chip.conversions -= cs.conversions;
+    r.chip.power_ups -= cs.power_ups;
+
+    printf("%-22s %4.0f s  %s", what, seconds, hx711_health_name(from));
+    for (int i = 0; i < s_log.changes; i++) {
+        printf(" -> %s@%.2fs", hx711_health_name(s_log.to[i]), s_log.at_us[i] / 1e6);
+    }
+    printf("\n  queued %4d", s_log.samples);
+    if (s_log.samples) printf(" (first %.0f, %.0f..%.0f)", s_log.first, s_log.min, s_log.max);
+    printf("  timeouts %u saturated %u stuck %u offline %u probes %u backoff %u ms\n",
+           (unsigned)r.hs.timeouts, (unsigned)r.hs.saturated, (unsigned)r.hs.stuck,
+           (unsigned)r.hs.offline_events, (unsigned)r.hs.probes, (unsigned)r.hs.next_probe_ms);
+    printf("  longest busy %.2f ms, mutex held %.1f ms\n",
+           r.chip.max_busy_us / 1e3, r.chip.max_hold_us / 1e3);
+
+    CHECK(s_log.samples_after_offline == 0, "%s: %d samples queued while offline", what, s_log.samples_after_offline);
+    CHECK(r.chip.max_busy_us <= 2000, "%s: busy for %.1f ms without yielding", what, r.chip.max_busy_us / 1e3);
+    CHECK(r.chip.max_hold_us <= (HX711_READY_TIMEOUT_MS + HX711_READ_TIMEOUT_MS + 5) * 1000,
+          "%s: mutex held %.1f ms", what, r.chip.max_hold_us / 1e3);
+    return r;
+}
+
+// Longest wait for a replugged chip: the full backoff, its settling time
+// (the probe discards that conversion), the read, and one period of slack
+static const double s_probe_wait_s = HX711_PROBE_MAX_MS / 1e3 + (CHIP_SETTLE_US + 2 * CHIP_PERIOD_US) / 1e6;
+
+// Probes a silent chip gets in `seconds` of OFFLINE starting at `start_s`:
+// each one waits the backoff, then HX711_READY_TIMEOUT_MS for DOUT
+static int expected_probes(double start_s, double seconds) {
+    double t = start_s;
+    int n = 0;
+    for (uint32_t wait = HX711_PROBE_MIN_MS;; wait = wait * 2 < HX711_PROBE_MAX_MS ? wait * 2 : HX711_PROBE_MAX_MS) {
+        t += wait / 1e3;
+        if (t >= seconds) return n;
+        n++;
+        t += HX711_READY_TIMEOUT_MS / 1e3;
+    }
+}
+
+// After a fault clears: DEGRADED (or still OFFLINE until the next probe),
+// then OK after HX711_RECOVER_SAMPLES good samples. Back from OFFLINE the
+// filters are reseeded, so the first sample is already the new load;
+// otherwise the change is a step the filters follow
+static void check_recovery(const char *what, const phase_result_t *r, double load_raw, double max_wait_s,
+                           bool reseeded) {
+    double ok = entered_s(HX711_HEALTH_OK);
+    double degraded = entered_s(HX711_HEALTH_DEGRADED);
+    double from = degraded >= 0.0 ? degraded : 0.0;
+    CHECK(s_log.state == HX711_HEALTH_OK, "%s: ends %s", what, hx711_health_name(s_log.state));
+    CHECK(degraded < 0.0 || degraded <= max_wait_s, "%s: back after %.2f s", what, degraded);
+    CHECK(ok >= 0.0 && ok - from >= (HX711_RECOVER_SAMPLES - 1) * CHIP_PERIOD_US / 1e6 &&
+          ok - from <= (HX711_RECOVER_SAMPLES + 2) * CHIP_PERIOD_US / 1e6,
+          "%s: OK %.2f s after the first good sample", what, ok - from);
+    float v = reseeded ? s_log.first : s_log.last;
+    CHECK(fabs(v - load_raw) < 0.01 * fabs(load_raw) + 5 * NOISE_RMS, "%s: %s sample %.0f, load %.0f%s",
+          what, reseeded ? "first" : "last", v, load_raw, reseeded ? " (filters not reseeded)" : "");
+    CHECK(r->hs.timeouts + r->hs.saturated == 0 || degraded >= 0.0, "%s: faults while live", what);
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        { "seed", required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    uint32_t seed = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const double kg70 = 700000.0, kg50 = 500000.0, empty = 20000.0;
+    chip_reset(seed, NOISE_RMS);
+    chip_set_load(kg70);
+    chip_set_hooks(&(chip_hooks_t){ .on_sample = on_sample, .on_yield = observe });
+    scale_config_init();
+    hx711_t scale;
+    hx711_init_rtos(&scale, CHIP_DOUT, CHIP_SCK, HX711_GAIN_128, 8, true, 0.5f, 1.0f);
+    printf("timeouts %d ms, offline after %d, stuck after %d, ok after %d, probe %d..%d ms\n\n",
+           HX711_READ_TIMEOUT_MS, HX711_OFFLINE_TIMEOUTS, HX711_STUCK_SAMPLES,
+           HX711_RECOVER_SAMPLES, HX711_PROBE_MIN_MS, HX711_PROBE_MAX_MS);
+
+    phase_result_t r;
+    const char *what;
+
+    what = "connected, 70 kg";
+    r = run_phase(&scale, what, CHIP_LIVE, kg70, 10);
+    CHECK(s_log.changes == 0 && s_log.state == HX711_HEALTH_OK, "%s: left OK", what);
+    CHECK(s_log.samples >= 95, "%s: %d samples in 10 s", what, s_log.samples);
+    CHECK(r.hs.timeouts + r.hs.saturated + r.hs.stuck == 0, "%s: faults on a live chip", what);
+
+    what = "unplugged";
+    r = run_phase(&scale, what, CHIP_UNPLUGGED, kg70, 30);
+    double offline = entered_s(HX711_HEALTH_OFFLINE);
+    CHECK(entered_s(HX711_HEALTH_DEGRADED) >= 0.0 &&
+          entered_s(HX711_HEALTH_DEGRADED) <= (HX711_READ_TIMEOUT_MS + 20) / 1e3,
+          "%s: degraded at %.2f s", what, entered_s(HX711_HEALTH_DEGRADED));
+    CHECK(offline >= 0.0 && offline <= HX711_OFFLINE_TIMEOUTS * (HX711_READ_TIMEOUT_MS + 20) / 1e3,
+          "%s: offline at %.2f s", what, offline);
+    CHECK(r.hs.timeouts == HX711_OFFLINE_TIMEOUTS, "%s: %u timeouts before offline", what, (unsigned)r.hs.timeouts);
+    CHECK(r.hs.offline_events == 1, "%s: %u offline events", what, (unsigned)r.hs.offline_events);
+    CHECK((int)r.hs.probes == expected_probes(offline, 30),
+          "%s: %u probes, backoff predicts %d", what, (unsigned)r.hs.probes, expected_probes(offline, 30));
+    CHECK(r.hs.next_probe_ms == HX711_PROBE_MAX_MS, "%s: backoff %u ms", what, (unsigned)r.hs.next_probe_ms);
+    CHECK(s_log.samples == 0, "%s: %d samples queued", what, s_log.samples);
+
+    what = "replugged, 50 kg";
+    r = run_phase(&scale, what, CHIP_LIVE, kg50, 12);
+    check_recovery(what, &r, kg50, s_probe_wait_s, true);
+    CHECK(r.hs.probes == 1, "%s: %u probes to recover", what, (unsigned)r.hs.probes);
+
+    what = "DOUT stuck low";
+    r = run_phase(&scale, what, CHIP_DOUT_LOW, kg50, 20);
+    CHECK(r.hs.stuck >= 1 && s_log.state == HX711_HEALTH_OFFLINE, "%s: ends %s, stuck %u",
+          what, hx711_health_name(s_log.state), (unsigned)r.hs.stuck);
+    CHECK(entered_s(HX711_HEALTH_OFFLINE) >= 0.0 && entered_s(HX711_HEALTH_OFFLINE) < 1.0,
+          "%s: offline at %.2f s", what, entered_s(HX711_HEALTH_OFFLINE));
+    CHECK(r.hs.probes >= 3 && r.hs.offline_events == 1 && s_log.changes == 1,
+          "%s: probes brought it back (%u probes, %d changes)", what, (unsigned)r.hs.probes, s_log.changes);
+    // Code 0 is a valid reading until it repeats HX711_STUCK_SAMPLES times
+    CHECK(s_log.samples <= HX711_STUCK_SAMPLES, "%s: %d samples of the stuck code queued", what, s_log.samples);
+
+    what = "fixed, 50 kg";
+    r = run_phase(&scale, what, CHIP_LIVE, kg50, 12);
+    check_recovery(what, &r, kg50, s_probe_wait_s, true);
+
+    what = "overload";
+    r = run_phase(&scale, what, CHIP_OVERLOAD, kg50, 3);
+    CHECK(s_log.state == HX711_HEALTH_DEGRADED && !ever(HX711_HEALTH_OFFLINE), "%s: ends %s",
+          what, hx711_health_name(s_log.state));
+    CHECK(r.hs.saturated >= 28 && r.hs.saturated <= 31, "%s: %u saturated in 3 s", what, (unsigned)r.hs.saturated);
+    CHECK(s_log.samples == 0, "%s: %d saturated samples queued", what, s_log.samples);
+
+    what = "unloaded";
+    r = run_phase(&scale, what, CHIP_LIVE, empty, 5);
+    check_recovery(what, &r, empty, 0.2, false);
+
+    what = "late conversions";
+    r = run_phase(&scale, what, CHIP_LATE, kg70, 20);
+    CHECK(s_log.state == HX711_HEALTH_DEGRADED && !ever(HX711_HEALTH_OFFLINE), "%s: ends %s",
+          what, hx711_health_name(s_log.state));
+    CHECK(r.hs.timeouts >= 20 && s_log.samples >= 100, "%s: %u timeouts, %d samples",
+          what, (unsigned)r.hs.timeouts, s_log.samples);
+
+    what = "on time again";
+    r = run_phase(&scale, what, CHIP_LIVE, kg70, 5);
+    CHECK(s_log.state == HX711_HEALTH_OK && entered_s(HX711_HEALTH_OK) <= 1.2,
+          "%s: OK at %.2f s", what, entered_s(HX711_HEALTH_OK));
+
+    if (s_failures) {
+        printf("\n%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("\nall checks passed\n");
+    return 0;
+}
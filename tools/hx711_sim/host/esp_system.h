@@ -0,0 +1 @@
+#include "sleep_host.h"
@@ -0,0 +1,37 @@
+// File: tools/hx711_sim/host/sleep_host.h
+// ---------------------------------------------------------------------------
+// Deep sleep, reset reason, RTC memory and the ROM CRC on top of the
+// scale_tune host layer, for wake_sim.c (which implements them).
+// ---------------------------------------------------------------------------
+#ifndef SLEEP_HOST_H
+#define SLEEP_HOST_H
+
+#include "host_idf.h"
+
+/* esp_attr.h: RTC slow memory is ordinary memory that wake_sim keeps */
+#define RTC_DATA_ATTR
+
+/* esp_system.h */
+typedef enum { ESP_RST_UNKNOWN, ESP_RST_POWERON, ESP_RST_SW, ESP_RST_PANIC, ESP_RST_DEEPSLEEP,
+               ESP_RST_BROWNOUT } esp_reset_reason_t;
+esp_reset_reason_t esp_reset_reason(void);
+
+/* esp_sleep.h */
+typedef enum { ESP_SLEEP_WAKEUP_UNDEFINED = 0, ESP_SLEEP_WAKEUP_EXT0 = 2,
+               ESP_SLEEP_WAKEUP_TIMER = 4 } esp_sleep_wakeup_cause_t;
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void);
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us);
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level);
+void      esp_deep_sleep_start(void);      // Unwinds to the next simulated boot
+
+/* esp_rom_crc.h */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+/* driver/gpio.h, driver/rtc_io.h */
+#define GPIO_NUM_0  0
+esp_err_t gpio_hold_en(gpio_num_t pin);
+void      gpio_deep_sleep_hold_en(void);
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin);
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin);
+
+#endif
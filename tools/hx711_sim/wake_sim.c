@@ -0,0 +1,435 @@
+// File: tools/hx711_sim/wake_sim.c
+// ---------------------------------------------------------------------------
+// Deep-sleep wake latency on a simulated HX711 (see chip.h)
+//   - hx711.c and sleep_state.c compiled in unchanged; app_main's wake
+//     path (restore, timer check, sleep again or full start) and its
+//     cold-boot calibration are mirrored step for step, and
+//     esp_deep_sleep_start() unwinds to the next simulated boot with RTC
+//     memory kept and everything else reset
+//   - Latency counts from app_main: ROM/bootloader time is not modelled,
+//     Wi-Fi connects --wifi-ms after start
+//   - Scenarios: cold boot, quiet timer checks, stepping on mid-sleep,
+//     button wakes, warm vs cold filters on the check, retained state
+//     refused (wrong reset, corrupted block, changed filter layout), and
+//     a slow zero drift that auto-zero has to follow
+//
+//   make -C tools/hx711_sim
+//   tools/hx711_sim/wake_sim [--wifi-ms 2500] [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <setjmp.h>
+#include <getopt.h>
+
+#include "chip.h"
+#include "hx711.c"
+#define TAG SLEEP_TAG             // Both files have a static TAG
+#include "sleep_state.c"
+#undef TAG
+
+// main.c's sensor setup and cold-boot calibration
+#define MA_WINDOW           8
+#define USE_KF              true
+#define KF_Q_INIT           0.5f
+#define KF_R_INIT           1.0f
+#define KF_CV_ACCEL_NOISE   1.0e3f
+#define KF_CV_MEAS_NOISE    2500.0f
+#define CAL_SAMPLES         10
+#define CAL_KNOWN_WEIGHT_G  200.0f
+
+#define COUNTS_PER_G        10.0        // Load cells + HX711 at gain 128
+#define ZERO_RAW            20000.0
+#define NOISE_RMS           50.0        // Counts
+#define PERSON_G            70000.0
+#define LOCK_TOL_G          50.0        // "Locked": LOCK_RUN readings in a row
+#define LOCK_RUN            10          //  within LOCK_TOL_G of the load
+#define TRIALS              20
+#define DRIFT_CHECKS        200         // 10 minutes of timer checks
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+/* --------------------------- Simulated system --------------------------- */
+
+static esp_reset_reason_t       s_reset;
+static esp_sleep_wakeup_cause_t s_cause;
+static jmp_buf                  s_asleep;
+static int64_t                  s_boot_us;      // app_main start
+static int64_t                  s_slept_us;     // esp_deep_sleep_start, since s_boot_us
+static int                      s_deep_sleeps;
+static int64_t                  s_wifi_ms = 2500;
+static double                   s_zero_raw = ZERO_RAW;
+
+esp_reset_reason_t esp_reset_reason(void) { return s_reset; }
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause(void) { return s_cause; }
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us) { return ESP_OK; }
+esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t pin, int level) { return ESP_OK; }
+esp_err_t gpio_hold_en(gpio_num_t pin) { return ESP_OK; }
+void gpio_deep_sleep_hold_en(void) { }
+esp_err_t rtc_gpio_pullup_en(gpio_num_t pin) { return ESP_OK; }
+esp_err_t rtc_gpio_pulldown_dis(gpio_num_t pin) { return ESP_OK; }
+
+void esp_deep_sleep_start(void) {
+    s_slept_us = chip_now_us() - s_boot_us;
+    s_deep_sleeps++;
+    longjmp(s_asleep, 1);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static bool wifi_is_connected(void) {
+    return chip_now_us() - s_boot_us >= s_wifi_ms * 1000;
+}
+
+static void set_load_g(double g) {
+    chip_set_load(s_zero_raw + g * COUNTS_PER_G);
+}
+
+// What a reset clears: hx711.c's RAM state (RTC memory, s_rtc, is kept)
+static void reset_ram(void) {
+    s_health = HX711_HEALTH_OK;
+    s_timeout_run = s_good_run = s_same_run = 0;
+    s_prev_raw = s_last_good_raw = 0;
+    s_reseed = false;
+    s_calib = NULL;
+    memset(&s_cd, 0, sizeof(s_cd));
+    memset(&s_kf, 0, sizeof(s_kf));
+    s_ma_window = 0;
+    s_use_kf = false;
+}
+
+/* ------------------------------ app_main -------------------------------- */
+
+static hx711_t       g_scale;
+static calibration_t g_calib;
+static sleep_state_t s_sleep;       // What survives the next deep sleep
+static sleep_wake_t  s_wake;
+
+typedef struct {
+    sleep_wake_t wake;
+    bool         slept;             // Timer check went back to sleep
+    float        check_g;           // Weight the wake check read
+    bool         zeroed;            // Quiet check folded into the zero
+    double       decided_s;         // Check done (asleep again, or full start)
+    double       ready_s;           // Sampling started (cold: after calibration)
+    double       lock_s;            // LOCK_RUN readings within LOCK_TOL_G
+} boot_t;
+
+// app_main 1b: tare, then the known weight placed during the 5 s pause
+static void cold_calibrate(void) {
+    int32_t raw_buf[CAL_SAMPLES];
+    int32_t zero_raw, raw_at_weight;
+    hx711_init(&g_scale, CHIP_DOUT, CHIP_SCK, HX711_GAIN_128, MA_WINDOW, USE_KF, KF_Q_INIT, KF_R_INIT);
+    for (int i = 0; i < CAL_SAMPLES; i++) {
+        raw_buf[i] = hx711_read_raw(&g_scale);
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    calibration_tare(&zero_raw, raw_buf, CAL_SAMPLES);
+    set_load_g(CAL_KNOWN_WEIGHT_G);
+    vTaskDelay(pdMS_TO_TICKS(5000));
+    raw_at_weight = hx711_read_raw(&g_scale);
+    calibration_compute(&g_calib, zero_raw, raw_at_weight, CAL_KNOWN_WEIGHT_G);
+    set_load_g(0);
+    s_sleep.calib = g_calib;
+    s_sleep.zero_raw = zero_raw;
+}
+
+// One boot up to a locked weight of load_g (placed at `on_s` after start,
+// 0: already on). restore = false skips the filter restore (cold filters)
+static boot_t boot(esp_reset_reason_t reason, esp_sleep_wakeup_cause_t cause, double load_g,
+                   double on_s, bool restore) {
+    static boot_t b;            // Static: it outlives the longjmp of a sleep
+    memset(&b, 0, sizeof(b));
+    reset_ram();
+    s_reset = reason;
+    s_cause = cause;
+    s_boot_us = chip_now_us();
+    set_load_g(on_s > 0 ? 0 : load_g);
+
+    if (setjmp(s_asleep)) {
+        b.slept = true;
+        b.decided_s = s_slept_us / 1e6;
+        return b;
+    }
+
+    // 1a) Deep-sleep wake (main.c)
+    s_wake = sleep_state_restore(&s_sleep);
+    b.wake = s_wake;
+    if (s_wake != SLEEP_WAKE_COLD) {
+        hx711_init(&g_scale, CHIP_DOUT, CHIP_SCK, HX711_GAIN_128, MA_WINDOW, USE_KF, KF_Q_INIT, KF_R_INIT);
+        hx711_set_kalman_model(&g_scale, KALMAN_MODEL_CONST_VELOCITY, KF_CV_ACCEL_NOISE, KF_CV_MEAS_NOISE);
+        if (restore) hx711_restore_state(&g_scale, &s_sleep.filt);
+        g_calib = s_sleep.calib;
+
+        float w = sleep_state_check_weight(&g_scale, &g_calib, SLEEP_CHECK_SAMPLES);
+        b.check_g = w;
+        hx711_save_state(&g_scale, &s_sleep.filt);
+        if (s_wake == SLEEP_WAKE_TIMER && w < s_sleep.wake_threshold_g) {
+            b.zeroed = sleep_state_auto_zero(&s_sleep, w);
+            s_sleep.checks++;
+            sleep_state_enter(&g_scale, &s_sleep);      // Unwinds above
+        }
+        s_sleep.last_weight_g = w;
+    }
+    b.decided_s = (chip_now_us() - s_boot_us) / 1e6;
+
+    // 1b) Cold boot calibration, then the Wi-Fi wait only a cold boot does
+    if (s_wake == SLEEP_WAKE_COLD) {
+        cold_calibrate();
+    }
+    int retries = 0;
+    int max_retries = (s_wake == SLEEP_WAKE_COLD) ? 20 : 0;
+    while (!wifi_is_connected() && retries++ < max_retries) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+    }
+
+    // 4) HX711 driver (its task is replaced by reads here)
+    hx711_init_rtos(&g_scale, CHIP_DOUT, CHIP_SCK, HX711_GAIN_128, MA_WINDOW, USE_KF, KF_Q_INIT, KF_R_INIT);
+    hx711_set_calibration(&g_scale, &g_calib);
+    hx711_set_kalman_model(&g_scale, KALMAN_MODEL_CONST_VELOCITY, KF_CV_ACCEL_NOISE, KF_CV_MEAS_NOISE);
+    if (s_wake != SLEEP_WAKE_COLD && restore) {
+        hx711_restore_state(&g_scale, &s_sleep.filt);
+    }
+    b.ready_s = (chip_now_us() - s_boot_us) / 1e6;
+
+    // Locked on what the calibration makes of the load (one noisy read at
+    // the known weight leaves it a percent or two off)
+    double target_g = calibration_convert(&g_calib, (int32_t)(s_zero_raw + load_g * COUNTS_PER_G));
+    double placed_s = fmax(on_s, b.ready_s);
+    for (int run = 0, n = 0; n < 600 && run < LOCK_RUN; n++) {
+        if (on_s > 0 && chip_now_us() - s_boot_us >= (int64_t)(on_s * 1e6)) set_load_g(load_g);
+        float f = hx711_read_filtered(&g_scale);
+        if (isnan(f)) continue;
+        double w = calibration_convert(&g_calib, (int32_t)f);
+        bool on = on_s <= 0 || chip_now_us() - s_boot_us >= (int64_t)(on_s * 1e6);
+        run = on && fabs(w - target_g) < LOCK_TOL_G ? run + 1 : 0;
+        if (run == LOCK_RUN) b.lock_s = (chip_now_us() - s_boot_us) / 1e6 - placed_s;
+    }
+    return b;
+}
+
+// The main loop's idle deep sleep, with load_g on the platform
+static void idle_sleep(double load_g) {
+    scale_config_t cfg;
+    scale_config_snapshot(&cfg);
+    set_load_g(load_g);
+    hx711_read_filtered(&g_scale);
+    if (!setjmp(s_asleep)) {
+        s_sleep.wake_threshold_g = cfg.wake_threshold_g;
+        s_sleep.last_weight_g = (float)load_g;
+        s_sleep.checks = 0;
+        hx711_save_state(&g_scale, &s_sleep.filt);
+        sleep_state_enter(&g_scale, &s_sleep);
+    }
+}
+
+static void print_boot(const char *what, const boot_t *b) {
+    printf("  %-34s %-6s %s  check %7.1f g  decided %.2f s", what, sleep_state_wake_name(b->wake),
+           b->slept ? "sleeps" : "starts", b->check_g, b->decided_s);
+    if (!b->slept) printf("  ready %.2f s  lock +%.2f s", b->ready_s, b->lock_s);
+    printf("\n");
+}
+
+/* ------------------------------- Scenarios ------------------------------ */
+
+static double s_decide_budget_s;
+
+static double check_cold(void) {
+    printf("cold boot\n");
+    boot_t b = boot(ESP_RST_POWERON, ESP_SLEEP_WAKEUP_UNDEFINED, PERSON_G, 0.01, true);
+    print_boot("power-on, 70 kg after boot", &b);
+    CHECK(b.wake == SLEEP_WAKE_COLD && !b.slept, "power-on not a cold start");
+    CHECK(b.ready_s >= 5.0 + CAL_SAMPLES * 0.1, "cold start ready after %.2f s, before its calibration", b.ready_s);
+    CHECK(b.lock_s > 0.0, "cold start never locked");
+    double kg = calibration_convert(&g_calib, (int32_t)(ZERO_RAW + 1000 * COUNTS_PER_G));
+    printf("  calibrated: 1 kg reads %.1f g\n", kg);
+    CHECK(fabs(kg - 1000) < 50, "calibration off: 1 kg reads %.1f g", kg);
+    return b.ready_s + b.lock_s;
+}
+
+static void check_quiet(void) {
+    printf("\nquiet timer checks (%d, %d s apart)\n", TRIALS, SLEEP_POLL_S);
+    idle_sleep(0);
+    double worst = 0, sum = 0, err = 0;
+    int slept = 0;
+    for (int i = 0; i < TRIALS; i++) {
+        chip_sleep(SLEEP_POLL_S * 1000000LL);
+        boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER, 0, 0, true);
+        if (i == 0) print_boot("empty platform", &b);
+        slept += b.slept;
+        worst = fmax(worst, b.decided_s);
+        sum += b.decided_s;
+        err = fmax(err, fabs(b.check_g));
+    }
+    printf("  awake %.2f s mean, %.2f s worst, |check| <= %.1f g: awake %.1f%% of the time\n",
+           sum / TRIALS, worst, err, 100.0 * sum / (sum + TRIALS * SLEEP_POLL_S));
+    CHECK(slept == TRIALS, "%d of %d quiet checks slept again", slept, TRIALS);
+    CHECK(worst <= s_decide_budget_s, "timer check took %.2f s, budget %.2f s", worst, s_decide_budget_s);
+    CHECK(s_sleep.checks == (uint32_t)TRIALS, "%u checks counted", (unsigned)s_sleep.checks);
+}
+
+static void check_step_on(double cold_total_s) {
+    printf("\nstepping on mid-sleep (%d trials)\n", TRIALS);
+    double worst = 0, sum = 0;
+    uint32_t rng = 12345;
+    for (int i = 0; i < TRIALS; i++) {
+        idle_sleep(0);
+        rng = rng * 1103515245u + 12345u;
+        double at = SLEEP_POLL_S * ((rng >> 8) & 0xFFFF) / 65536.0;     // Into the sleep
+        chip_sleep((int64_t)(SLEEP_POLL_S * 1e6));
+        boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER, PERSON_G, 0, true);
+        if (i == 0) print_boot("70 kg on at the timer wake", &b);
+        CHECK(!b.slept && b.lock_s > 0.0, "trial %d: %s", i, b.slept ? "slept with 70 kg on" : "no lock");
+        double latency = SLEEP_POLL_S - at + b.ready_s + b.lock_s;
+        worst = fmax(worst, latency);
+        sum += latency;
+    }
+    printf("  step-on to lock %.2f s mean, %.2f s worst (cold boot: %.2f s)\n",
+           sum / TRIALS, worst, cold_total_s);
+    CHECK(worst <= SLEEP_POLL_S + s_decide_budget_s + 3.0, "step-on to lock %.2f s", worst);
+}
+
+static void check_button(void) {
+    printf("\nbutton wakes\n");
+    idle_sleep(0);
+    chip_sleep(1000000);
+    boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_EXT0, 0, 0, true);
+    print_boot("empty platform", &b);
+    CHECK(b.wake == SLEEP_WAKE_BUTTON && !b.slept, "button wake %s", b.slept ? "slept" : sleep_state_wake_name(b.wake));
+    CHECK(b.ready_s < 1.5, "button wake ready after %.2f s (waited for Wi-Fi?)", b.ready_s);
+
+    idle_sleep(0);
+    chip_sleep(1000000);
+    b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_EXT0, PERSON_G, 0, true);
+    print_boot("70 kg on", &b);
+    CHECK(b.lock_s > 0.0 && b.ready_s + b.lock_s < 3.0, "button wake with 70 kg: lock at %.2f s",
+          b.ready_s + b.lock_s);
+}
+
+static void check_filters(void) {
+    printf("\ntimer check, warm vs cold filters (%d wakes each)\n", TRIALS);
+    for (int warm = 1; warm >= 0; warm--) {
+        double err = 0;
+        int slept = 0;
+        for (int i = 0; i < TRIALS; i++) {
+            idle_sleep(0);
+            chip_sleep(SLEEP_POLL_S * 1000000LL);
+            boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER, 0, 0, warm);
+            err = fmax(err, fabs(b.check_g));
+            slept += b.slept;
+        }
+        printf("  %-5s |check| <= %5.1f g, %d of %d slept again\n", warm ? "warm" : "cold", err, slept, TRIALS);
+        if (warm) {
+            CHECK(slept == TRIALS, "warm filters: %d of %d slept", slept, TRIALS);
+        }
+    }
+}
+
+static void check_refused(void) {
+    printf("\nretained state refused\n");
+    idle_sleep(0);
+    chip_sleep(1000000);
+    sleep_state_t st;
+    s_reset = ESP_RST_SW;
+    CHECK(sleep_state_restore(&st) == SLEEP_WAKE_COLD, "software reset restored RTC state");
+    s_reset = ESP_RST_DEEPSLEEP;
+    s_cause = ESP_SLEEP_WAKEUP_TIMER;
+    CHECK(sleep_state_restore(&st) == SLEEP_WAKE_TIMER, "valid block refused");
+    s_rtc.st.zero_raw ^= 1;
+    CHECK(sleep_state_restore(&st) == SLEEP_WAKE_COLD, "corrupted block restored");
+    s_rtc.st.zero_raw ^= 1;
+    s_rtc.magic ^= 0x10000;
+    CHECK(sleep_state_restore(&st) == SLEEP_WAKE_COLD, "block from another layout restored");
+    s_rtc.magic ^= 0x10000;
+    hx711_init(&g_scale, CHIP_DOUT, CHIP_SCK, HX711_GAIN_128, MA_WINDOW / 2, USE_KF, KF_Q_INIT, KF_R_INIT);
+    hx711_set_kalman_model(&g_scale, KALMAN_MODEL_CONST_VELOCITY, KF_CV_ACCEL_NOISE, KF_CV_MEAS_NOISE);
+    CHECK(!hx711_restore_state(&g_scale, &s_rtc.st.filt), "snapshot of another MA window restored");
+    printf("  software reset, flipped bit, other layout, other MA window: cold\n");
+}
+
+// Zero drifting 0.5 g per check (~10 g/min): auto-zero follows it, so
+// checks keep sleeping, and a real load still wakes the scale
+static void check_drift(void) {
+    printf("\nzero drift, 0.5 g per timer check\n");
+    idle_sleep(0);
+    int slept = 0, zeroed = 0;
+    double worst = 0;
+    for (int i = 0; i < DRIFT_CHECKS; i++) {
+        s_zero_raw += 0.5 * COUNTS_PER_G;
+        chip_sleep(SLEEP_POLL_S * 1000000LL);
+        boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER, 0, 0, true);
+        slept += b.slept;
+        zeroed += b.zeroed;
+        worst = fmax(worst, fabs(b.check_g));
+    }
+    double drift = (s_zero_raw - ZERO_RAW) / COUNTS_PER_G;
+    chip_sleep(SLEEP_POLL_S * 1000000LL);
+    boot_t b = boot(ESP_RST_DEEPSLEEP, ESP_SLEEP_WAKEUP_TIMER, 2000, 0, true);
+    double want_g = g_calib.slope * 2000 * COUNTS_PER_G;     // Whatever the calibration's gain error
+    printf("  %d checks, %.0f g drift: %d slept, %d re-zeroed, |check| <= %.1f g; 2 kg then read %.0f g\n",
+           DRIFT_CHECKS, drift, slept, zeroed, worst, b.check_g);
+    CHECK(slept == DRIFT_CHECKS, "%d of %d checks slept with %.0f g of drift (threshold %.0f g)",
+          slept, DRIFT_CHECKS, drift, s_sleep.wake_threshold_g);
+    CHECK(zeroed > DRIFT_CHECKS / 2, "re-zeroed on %d of %d checks", zeroed, DRIFT_CHECKS);
+    CHECK(!b.slept && fabs(b.check_g - want_g) < 25, "2 kg after the drift: %s, %.0f g for %.0f g",
+          b.slept ? "slept" : "woke", b.check_g, want_g);
+    s_zero_raw = ZERO_RAW;
+}
+
+int main(int argc, char **argv) {
+    static const struct option opts[] = {
+        { "wifi-ms", required_argument, NULL, 'w' },
+        { "seed",    required_argument, NULL, 's' },
+        { NULL, 0, NULL, 0 }
+    };
+    uint32_t seed = 1;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", opts, NULL)) != -1) {
+        switch (opt) {
+        case 'w': s_wifi_ms = atoll(optarg); break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [--wifi-ms MS] [--seed N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    chip_reset(seed, NOISE_RMS);
+    scale_config_init();
+    // Settling, the prime read, the checked conversions and one of slack
+    s_decide_budget_s = (CHIP_SETTLE_US + (SLEEP_CHECK_SAMPLES + 2) * CHIP_PERIOD_US) / 1e6;
+    printf("poll %d s, %d check samples, decision budget %.2f s, Wi-Fi after %lld ms\n\n",
+           SLEEP_POLL_S, SLEEP_CHECK_SAMPLES, s_decide_budget_s, (long long)s_wifi_ms);
+
+    double cold = check_cold();
+    check_quiet();
+    check_step_on(cold);
+    check_button();
+    check_filters();
+    check_refused();
+    check_drift();
+
+    if (s_failures) {
+        printf("\n%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("\nall checks passed\n");
+    return 0;
+}
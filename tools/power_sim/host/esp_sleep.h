@@ -0,0 +1 @@
+#include "power_host.h"
@@ -0,0 +1,39 @@
+// File: tools/power_sim/host/power_host.h
+// ---------------------------------------------------------------------------
+// esp_pm, esp_sleep and one-shot esp_timer on top of the scale_tune host
+// layer; implemented by power_sim.c on its virtual clock
+// ---------------------------------------------------------------------------
+#ifndef POWER_HOST_H
+#define POWER_HOST_H
+
+#include "host_idf.h"
+
+/* esp_pm.h */
+typedef enum { ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX, ESP_PM_NO_LIGHT_SLEEP } esp_pm_lock_type_t;
+typedef struct host_pm_lock *esp_pm_lock_handle_t;
+typedef struct {
+    int  max_freq_mhz;
+    int  min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char *name, esp_pm_lock_handle_t *out);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t lock);
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t lock);
+esp_err_t esp_pm_configure(const void *config);
+
+/* esp_sleep.h */
+esp_err_t esp_sleep_enable_gpio_wakeup(void);
+
+/* esp_timer.h */
+typedef struct host_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct {
+    esp_timer_cb_t callback;
+    void          *arg;
+    const char    *name;
+} esp_timer_create_args_t;
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+#endif // POWER_HOST_H
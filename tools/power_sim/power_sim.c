@@ -0,0 +1,423 @@
+// File: tools/power_sim/power_sim.c
+// ---------------------------------------------------------------------------
+// Power governor state machine on a virtual clock
+//   - power_governor.c compiled in unchanged; PM locks, the linger timer
+//     and hx711_set_low_power() are host stand-ins that record their state
+//   - After every input and timer the PM locks and HX711 pacing must match
+//     the reported mode, and the time-in-mode counters must cover the
+//     elapsed time
+//   - The energy proxy (est_charge_mAs) is checked against an independent
+//     integral of the supply current implied by the locks actually held
+//   - A synthetic day (weigh-ins, app polling over HTTPS, failed
+//     handshakes from scanners) is run with and without the ClientHello
+//     boost; handshakes take HS_WORK_MS at PG_CPU_MAX_MHZ and scale with
+//     the clock below it
+//
+//   make -C tools/power_sim
+//   tools/power_sim/power_sim [--days 7] [--seed 1]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "power_governor.c"
+
+#define HS_WORK_MS          250     // ECDHE + signature at PG_CPU_MAX_MHZ
+#define HS_FAIL_FRACTION    0.3     // Scanners drop after the ServerHello
+#define REQUEST_MS          150     // GET /weight after the handshake
+#define DAY_US              (86400LL * 1000000)
+
+/* --------------------------- Host stand-ins ----------------------------- */
+
+struct host_pm_lock { esp_pm_lock_type_t type; int count; };
+struct host_timer   { esp_timer_cb_t cb; void *arg; bool armed; int64_t due_us; };
+
+static struct host_pm_lock s_locks[4];
+static int                 s_nlocks;
+static struct host_timer   s_timers[2];
+static int                 s_ntimers;
+static bool                s_hx_low_power;
+
+static int64_t s_now_us;
+static int64_t s_start_us;          // Governor init
+static double  s_charge_mA_us;      // Independent energy integral
+static int     s_failures;
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+const char *esp_err_to_name(esp_err_t code) { return code == ESP_OK ? "ESP_OK" : "ESP_FAIL"; }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t type, int arg, const char *name, esp_pm_lock_handle_t *out) {
+    if (s_nlocks == (int)(sizeof(s_locks) / sizeof(s_locks[0]))) return ESP_ERR_NO_MEM;
+    s_locks[s_nlocks] = (struct host_pm_lock){ .type = type };
+    *out = &s_locks[s_nlocks++];
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t lock) {
+    lock->count++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t lock) {
+    if (lock->count == 0) {
+        fprintf(stderr, "PM lock released more often than acquired\n");
+        s_failures++;
+        return ESP_ERR_INVALID_STATE;
+    }
+    lock->count--;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_configure(const void *config) { return ESP_OK; }
+esp_err_t esp_sleep_enable_gpio_wakeup(void) { return ESP_OK; }
+void wifi_modem_sleep(void) { }
+void hx711_set_low_power(hx711_t *scale, bool enable) { s_hx_low_power = enable; }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    if (s_ntimers == (int)(sizeof(s_timers) / sizeof(s_timers[0]))) return ESP_ERR_NO_MEM;
+    s_timers[s_ntimers] = (struct host_timer){ .cb = args->callback, .arg = args->arg };
+    *out = &s_timers[s_ntimers++];
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us) {
+    if (t->armed) return ESP_ERR_INVALID_STATE;
+    t->armed = true;
+    t->due_us = s_now_us + (int64_t)timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    if (!t->armed) return ESP_ERR_INVALID_STATE;
+    t->armed = false;
+    return ESP_OK;
+}
+
+/* --------------------------- Clock and checks ---------------------------- */
+
+static bool lock_held(esp_pm_lock_type_t type) {
+    for (int i = 0; i < s_nlocks; i++) {
+        if (s_locks[i].type == type && s_locks[i].count > 0) return true;
+    }
+    return false;
+}
+
+static bool cpu_boosted(void) {
+    return lock_held(ESP_PM_CPU_FREQ_MAX);
+}
+
+// Supply current implied by the locks, not by the governor's idea of its mode
+static int lock_current_mA(void) {
+    if (lock_held(ESP_PM_NO_LIGHT_SLEEP)) return PG_EST_MEASURING_MA;
+    if (lock_held(ESP_PM_CPU_FREQ_MAX)) return PG_EST_TLS_MA;
+    return PG_EST_IDLE_MA;
+}
+
+static void check_consistent(const char *where) {
+    pg_stats_t st;
+    power_governor_get_stats(&st);
+    bool cpu = cpu_boosted(), awake = lock_held(ESP_PM_NO_LIGHT_SLEEP);
+    uint64_t total = 0;
+    for (int m = 0; m < PG_MODE_COUNT; m++) total += st.time_us[m];
+    bool ok = cpu == (st.mode != PG_MODE_IDLE) && awake == (st.mode == PG_MODE_MEASURING) &&
+              s_hx_low_power == (st.mode == PG_MODE_IDLE) &&
+              total == (uint64_t)(s_now_us - s_start_us);
+    for (int i = 0; i < s_nlocks; i++) ok &= s_locks[i].count <= 1;
+    if (!ok && s_failures++ < 5) {
+        fprintf(stderr, "%s at %.3f s: mode %d cpu %d awake %d hx_low %d time %llu/%lld\n",
+                where, s_now_us / 1e6, st.mode, cpu, awake, s_hx_low_power,
+                (unsigned long long)total, (long long)(s_now_us - s_start_us));
+    }
+}
+
+// Earliest armed timer, or INT64_MAX
+static int64_t next_timer_us(void) {
+    int64_t due = INT64_MAX;
+    for (int i = 0; i < s_ntimers; i++) {
+        if (s_timers[i].armed && s_timers[i].due_us < due) due = s_timers[i].due_us;
+    }
+    return due;
+}
+
+static void advance_to(int64_t t) {
+    while (s_now_us < t) {
+        int64_t step = next_timer_us();
+        if (step > t) step = t;
+        s_charge_mA_us += (double)(step - s_now_us) * lock_current_mA();
+        s_now_us = step;
+        for (int i = 0; i < s_ntimers; i++) {
+            struct host_timer *tm = &s_timers[i];
+            if (tm->armed && tm->due_us <= s_now_us) {
+                tm->armed = false;
+                tm->cb(tm->arg);
+                check_consistent("timer");
+            }
+        }
+    }
+}
+
+static void expect(bool ok, const char *what) {
+    printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) s_failures++;
+}
+
+/* ------------------------------ Governor --------------------------------- */
+
+static void governor_reset(void) {
+    // Statics of power_governor.c back to their boot values
+    s_lock = NULL;
+    s_measuring = false;
+    s_tls_sessions = 0;
+    s_tls_linger = false;
+    s_mode = PG_MODE_IDLE;
+    s_mode_since_us = 0;
+    memset(s_time_us, 0, sizeof(s_time_us));
+    s_transitions = 0;
+    s_nlocks = s_ntimers = 0;
+    s_now_us = s_start_us = 1000000;
+    s_charge_mA_us = 0;
+
+    static hx711_t scale;
+    if (power_governor_init(&scale) != ESP_OK) {
+        fprintf(stderr, "power_governor_init failed\n");
+        exit(1);
+    }
+    check_consistent("init");
+}
+
+// One TLS handshake from the ClientHello on; returns its duration.
+// `hello_boost` is the wifi_comm.c cert_select hook; without it the CPU is
+// only boosted once the session exists
+static int64_t handshake(bool hello_boost, double fraction) {
+    int64_t t0 = s_now_us;
+    if (hello_boost) {
+        power_governor_tls_handshake();
+        check_consistent("hello");
+    }
+    // Work left in microseconds at PG_CPU_MAX_MHZ; progress slows down by
+    // PG_CPU_MAX_MHZ / PG_CPU_MIN_MHZ while the CPU is not boosted
+    double work = HS_WORK_MS * 1000.0 * fraction;
+    const double slow = (double)PG_CPU_MAX_MHZ / PG_CPU_MIN_MHZ;
+    while (work > 0) {
+        double rate = cpu_boosted() ? 1.0 : 1.0 / slow;
+        int64_t done = s_now_us + (int64_t)(work / rate + 0.5);
+        int64_t stop = next_timer_us() < done ? next_timer_us() : done;
+        if (stop <= s_now_us) stop = s_now_us + 1;
+        work -= (double)(stop - s_now_us) * rate;
+        advance_to(stop);
+    }
+    return s_now_us - t0;
+}
+
+/* ----------------------------- Day scenario ------------------------------ */
+
+typedef enum { EV_WEIGH_START, EV_WEIGH_END, EV_POLL, EV_SCAN } ev_kind_t;
+
+typedef struct {
+    int64_t   t_us;
+    ev_kind_t kind;
+} sim_event_t;
+
+static int cmp_event(const void *a, const void *b) {
+    const sim_event_t *x = a, *y = b;
+    return (x->t_us > y->t_us) - (x->t_us < y->t_us);
+}
+
+static uint32_t s_rng;
+
+static double rnd(void) {
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (s_rng >> 8) / 16777216.0;
+}
+
+// Mornings and evenings: a few weigh-ins with the app open and polling
+// /weight every 2 s over fresh TLS connections; scanners probe at random
+static int build_day(sim_event_t *ev, int max, int64_t day0) {
+    int n = 0;
+    static const int sessions_h[] = { 7, 19 };
+    for (size_t s = 0; s < 2; s++) {
+        int64_t open = day0 + (int64_t)((sessions_h[s] + rnd()) * 3600e6);
+        int64_t app_len = (int64_t)((180 + 240 * rnd()) * 1e6);
+        int weighins = 1 + (int)(rnd() * 3);
+        for (int w = 0; w < weighins && n + 2 <= max; w++) {
+            int64_t t = open + (int64_t)(rnd() * (double)app_len * 0.8);
+            int64_t dur = (int64_t)((8 + 10 * rnd()) * 1e6);
+            ev[n++] = (sim_event_t){ t, EV_WEIGH_START };
+            ev[n++] = (sim_event_t){ t + dur, EV_WEIGH_END };
+        }
+        for (int64_t t = open; t < open + app_len && n < max; t += 2000000) {
+            ev[n++] = (sim_event_t){ t, EV_POLL };
+        }
+    }
+    for (int i = 0; i < 40 && n < max; i++) {
+        ev[n++] = (sim_event_t){ day0 + (int64_t)(rnd() * DAY_US), EV_SCAN };
+    }
+    qsort(ev, (size_t)n, sizeof(ev[0]), cmp_event);
+    return n;
+}
+
+typedef struct {
+    pg_stats_t st;
+    double     independent_mAs;
+    int        polls;
+    double     hs_mean_ms, hs_max_ms;
+} day_result_t;
+
+static day_result_t run_days(int days, uint32_t seed, bool hello_boost) {
+    static sim_event_t ev[4096];
+    day_result_t r = { 0 };
+    double hs_sum = 0;
+
+    governor_reset();
+    s_rng = seed;
+    for (int d = 0; d < days; d++) {
+        int n = build_day(ev, (int)(sizeof(ev) / sizeof(ev[0])), s_start_us + d * DAY_US);
+        for (int i = 0; i < n; i++) {
+            if (ev[i].t_us > s_now_us) advance_to(ev[i].t_us);
+            switch (ev[i].kind) {
+            case EV_WEIGH_START: power_governor_set_measuring(true); break;
+            case EV_WEIGH_END:   power_governor_set_measuring(false); break;
+            case EV_SCAN:        handshake(hello_boost, HS_FAIL_FRACTION); break;
+            case EV_POLL: {
+                double ms = handshake(hello_boost, 1.0) / 1000.0;
+                hs_sum += ms;
+                if (ms > r.hs_max_ms) r.hs_max_ms = ms;
+                r.polls++;
+                power_governor_tls_begin();
+                check_consistent("session");
+                advance_to(s_now_us + REQUEST_MS * 1000);
+                power_governor_tls_end();
+                break;
+            }
+            }
+            check_consistent("event");
+        }
+    }
+    advance_to(s_start_us + days * DAY_US);
+    power_governor_get_stats(&r.st);
+    r.independent_mAs = s_charge_mA_us / 1e6;
+    r.hs_mean_ms = r.polls ? hs_sum / r.polls : 0;
+    return r;
+}
+
+/* --------------------------- Targeted checks ----------------------------- */
+
+static pg_mode_t mode_now(void) {
+    pg_stats_t st;
+    power_governor_get_stats(&st);
+    return st.mode;
+}
+
+static void targeted_checks(void) {
+    printf("\nState machine\n");
+
+    governor_reset();
+    handshake(true, HS_FAIL_FRACTION);
+    bool boosted = mode_now() == PG_MODE_TLS;
+    int64_t hello = s_now_us - (int64_t)(HS_WORK_MS * 1000 * HS_FAIL_FRACTION);
+    advance_to(hello + PG_TLS_LINGER_MS * 1000LL - 1);
+    bool held = mode_now() == PG_MODE_TLS;
+    advance_to(hello + PG_TLS_LINGER_MS * 1000LL);
+    expect(boosted && held && mode_now() == PG_MODE_IDLE && !cpu_boosted(),
+           "failed handshake: boosted, released PG_TLS_LINGER_MS after hello");
+
+    governor_reset();
+    int64_t fast = handshake(true, 1.0);
+    power_governor_tls_begin();
+    advance_to(s_now_us + (PG_TLS_LINGER_MS + 1000) * 1000LL);
+    bool open_held = mode_now() == PG_MODE_TLS;
+    power_governor_tls_end();
+    advance_to(s_now_us + PG_TLS_LINGER_MS * 1000LL);
+    expect(fast == HS_WORK_MS * 1000 && open_held && mode_now() == PG_MODE_IDLE,
+           "session outliving the hello linger stays boosted until closed");
+
+    governor_reset();
+    int64_t slow = handshake(false, 1.0);
+    expect(slow == (int64_t)HS_WORK_MS * 1000 * PG_CPU_MAX_MHZ / PG_CPU_MIN_MHZ,
+           "without the hello boost the handshake runs at PG_CPU_MIN_MHZ");
+
+    governor_reset();
+    power_governor_set_measuring(true);
+    handshake(true, 1.0);
+    power_governor_tls_begin();
+    bool meas = mode_now() == PG_MODE_MEASURING;
+    power_governor_set_measuring(false);
+    bool tls = mode_now() == PG_MODE_TLS;
+    power_governor_tls_end();
+    advance_to(s_now_us + PG_TLS_LINGER_MS * 1000LL);
+    expect(meas && tls && mode_now() == PG_MODE_IDLE, "measuring outranks TLS, TLS outranks idle");
+
+    governor_reset();
+    power_governor_tls_end();
+    power_governor_tls_begin();
+    power_governor_tls_end();
+    advance_to(s_now_us + PG_TLS_LINGER_MS * 1000LL);
+    expect(mode_now() == PG_MODE_IDLE && s_tls_sessions == 0, "unmatched session close does not underflow");
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: power_sim [--days N] [--seed N]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int days = 7;
+    uint32_t seed = 1;
+    static const struct option opts[] = {
+        { "days", required_argument, NULL, 'd' },
+        { "seed", required_argument, NULL, 's' },
+        { "help", no_argument, NULL, 'h' },
+        { 0 }
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "d:s:h", opts, NULL)) != -1) {
+        switch (c) {
+        case 'd': days = atoi(optarg); break;
+        case 's': seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default:  usage();
+        }
+    }
+    if (days < 1) usage();
+
+    printf("%d simulated days, handshake %d ms at %d MHz, DFS floor %d MHz, linger %d ms\n\n",
+           days, HS_WORK_MS, PG_CPU_MAX_MHZ, PG_CPU_MIN_MHZ, PG_TLS_LINGER_MS);
+    printf("  %-18s  idle h  tls s  meas s  switches  est mAs  integral mAs  mAh/day  handshake ms (mean/max)\n", "");
+
+    static const struct { const char *name; bool hello; } variants[] = {
+        { "boost on session", false },
+        { "boost on hello", true },
+    };
+    day_result_t res[2];
+    for (int v = 0; v < 2; v++) {
+        day_result_t r = run_days(days, seed, variants[v].hello);
+        res[v] = r;
+        printf("  %-18s  %6.1f  %5.0f  %6.0f  %8u  %7u  %12.0f  %7.2f  %6.0f / %.0f\n",
+               variants[v].name,
+               r.st.time_us[PG_MODE_IDLE] / 3600e6, r.st.time_us[PG_MODE_TLS] / 1e6,
+               r.st.time_us[PG_MODE_MEASURING] / 1e6, r.st.transitions,
+               r.st.est_charge_mAs, r.independent_mAs, r.independent_mAs / 3600.0 / days,
+               r.hs_mean_ms, r.hs_max_ms);
+    }
+
+    printf("\nEnergy proxy\n");
+    bool close = true;
+    for (int v = 0; v < 2; v++) {
+        // get_stats truncates each mode to whole ms and the sum to whole mAs
+        close &= res[v].st.est_charge_mAs <= res[v].independent_mAs + 0.5 &&
+                 res[v].st.est_charge_mAs + 1.0 >= res[v].independent_mAs;
+    }
+    expect(close, "est_charge_mAs matches the current integral of the PM locks");
+    expect(s_failures == 0, "locks, HX711 pacing and time counters follow the mode");
+    expect(res[1].hs_max_ms <= HS_WORK_MS + 0.5, "with the hello boost every handshake runs at full speed");
+
+    targeted_checks();
+
+    printf("\n%s\n", s_failures ? "FAILED" : "All checks passed");
+    return s_failures ? 1 : 0;
+}
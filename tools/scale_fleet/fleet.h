@@ -0,0 +1,118 @@
+// File: tools/scale_fleet/fleet.h
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+#include "app_connection_manager.h"     // measurement_t
+
+/*
+ * Simulated scale fleet (see scale_fleet.c).
+ *
+ * Every scale is a forked process running the firmware's sampling
+ * pipeline (tools/scale_tune/replay.c) in real time on a synthetic
+ * weigh-in schedule, with its own MQTT session (mqtt_uplink.c,
+ * fleet_mqtt.c) and loopback HTTP port (rest_api.c, fleet_http.c).
+ * Scales report cumulative fleet_stats_t snapshots to the coordinator
+ * over a shared pipe. The uplink's batching, window and timeouts are the
+ * MQTT_UPLINK_* build values (make UPLINK='-DMQTT_UPLINK_BATCH_MIN=4').
+ */
+
+#define FLEET_MAX_SCALES    2000
+#define FLEET_MAX_SCRIPT    256     // Weigh-ins in a --script file
+#define FLEET_HIST_BUCKETS  128     // 4 per octave of microseconds
+
+// One scripted weigh-in, relative to the scale's start
+typedef struct {
+    double at_s;
+    double grams;
+    double stand_s;             // 0: random
+} fleet_weigh_in_t;
+
+typedef struct {
+    int         scales;
+    double      duration_s;     // Simulated time per scale
+    double      speed;          // Simulated seconds per wall second
+    double      interval_s;     // Mean time between weigh-ins (random household)
+    double      stagger_s;      // Start offset drawn from [0, stagger_s)
+    double      rate_sps;       // HX711 conversion rate
+    fleet_weigh_in_t script[FLEET_MAX_SCRIPT];
+    int         script_len;     // 0: random household per scale
+    const char *broker_host;    // NULL: no MQTT
+    int         broker_port;
+    int         http_port_base; // 0: no HTTP
+    double      report_s;
+    uint64_t    seed;
+} fleet_opts_t;
+
+// Cumulative counters of one scale; one pipe write (< PIPE_BUF)
+typedef struct {
+    uint32_t scale;
+    uint32_t final;             // Last snapshot: the scale has exited
+    uint32_t samples;           // Conversions clocked out
+    uint32_t weigh_ins;         // Scheduled weigh-ins started
+    uint32_t locks;             // LOCKED records
+    uint32_t false_events;      // ADDED / REMOVED outside a weigh-in
+    uint32_t records;           // Everything the weight manager published
+    uint32_t mqtt_connects;
+    uint32_t mqtt_failures;     // Refused, reset, CONNACK error, connect timeout
+    uint32_t mqtt_msgs;         // Weigh-in PUBLISH sent (resends included)
+    uint32_t mqtt_acked_msgs;
+    uint32_t mqtt_acked_recs;   // mqtt_uplink records_acked
+    uint32_t mqtt_resent_recs;  // Records published again
+    uint32_t mqtt_resends;      // mqtt_uplink ack timeouts
+    uint32_t mqtt_lost_recs;    // Overwritten in the weigh-in log
+    uint32_t mqtt_backlog;      // Records after the uplink's cursor now
+    uint32_t http_requests;
+    uint32_t http_errors;       // 4xx / 5xx answers
+    uint32_t http_refused;      // Over REST_MAX_SOCKETS, or 503 (no stream slot)
+    uint32_t sse_open;
+    uint32_t sse_events;
+    uint32_t sse_dropped;       // Client too slow, connection closed
+    uint32_t lag_max_us;        // Worst lateness of a conversion vs. schedule
+    uint32_t rtt_hist[FLEET_HIST_BUCKETS];  // PUBLISH → PUBACK
+    uint32_t e2e_hist[FLEET_HIST_BUCKETS];  // Lock → PUBACK of its record
+} fleet_stats_t;
+
+/** @brief Histogram bucket of a duration in microseconds. */
+int fleet_hist_bucket(uint64_t us);
+
+/** @brief Upper bound of a bucket, microseconds. */
+double fleet_hist_upper_us(int bucket);
+
+/** @brief Wall clock of the node's poll loop, microseconds. */
+int64_t fleet_wall_us(void);
+
+/*
+ * Node parts (one process, one poll loop): each adds its sockets to the
+ * poll set, handles their events, and runs its timers on every pass.
+ */
+
+/**
+ * @brief Weigh-in log in RAM and mqtt_uplink_init() against
+ *        mqtt://<broker>, device f1ee0000 + @p index.
+ */
+int  fleet_mqtt_init(const fleet_opts_t *o, int index, fleet_stats_t *st);
+/** @brief A locked weight, as the hub's store and uplink subscribers see it. */
+void fleet_mqtt_record(const measurement_t *m);
+int  fleet_mqtt_fds(struct pollfd *pfd, int64_t *wake);
+void fleet_mqtt_io(const struct pollfd *pfd, int64_t now);
+/** @brief Client timers, then one uplink_step() (the uplink task's pass). */
+void fleet_mqtt_tick(int64_t now);
+/** @brief mqtt_uplink_flush(); true once nothing is left after the cursor. */
+bool fleet_mqtt_drain(void);
+
+/** @brief Listen on 127.0.0.1:@p port; rest_api.c answers the requests. */
+int  fleet_http_init(int port, fleet_stats_t *st);
+/** @brief rest_api_set_latest_measurement() (the hub's HTTPS subscriber). */
+void fleet_http_record(const measurement_t *m);
+int  fleet_http_fds(struct pollfd *pfd, int max);
+void fleet_http_io(const struct pollfd *pfd, int n, int64_t now);
+/** @brief Stream pacing; returns the next wall time it needs a pass. */
+int64_t fleet_http_tick(int64_t now);
+
+/** @brief Run scale @p index until its schedule ends or SIGTERM; never returns. */
+void fleet_node_main(const fleet_opts_t *o, int index, int report_fd) __attribute__((noreturn));
+
+#endif // FLEET_H
@@ -0,0 +1,425 @@
+// File: tools/scale_fleet/fleet_check.c
+// ---------------------------------------------------------------------------
+// scale_fleet end to end, against a loopback MQTT 3.1.1 broker
+//   - Runs the given scale_fleet with a scripted weigh-in schedule, four
+//     scales, its broker pointed here and its HTTP ports on loopback
+//   - The broker acks QoS1 PUBLISHes, except once per scale: even scales
+//     lose the connection on their first weigh-in message (the client
+//     re-sends its outbox with DUP after reconnecting), odd scales never
+//     get the first PUBACK (mqtt_uplink.c re-sends from its cursor after
+//     MQTT_UPLINK_ACK_TIMEOUT_MS)
+//   - Every scale delivered seqs 1..N with no gaps, N summing to the locks
+//     scale_fleet reports, none unacked at exit, exit status 0
+//   - rest_api.c is what answers: GET /weight is measurement_json(), GET
+//     /stream yields an SSE data line
+//
+//   make -C tools/scale_fleet check
+//   tools/scale_fleet/fleet_check tools/scale_fleet/scale_fleet
+// ---------------------------------------------------------------------------
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SCALES          4
+#define WEIGH_INS       10      // Enough for a MQTT_UPLINK_BATCH_MIN flush mid-run
+#define SPEED           "20"
+#define DURATION_S      "210"
+#define MAX_CONNS       16
+#define MAX_SEQ         1024
+#define IN_BUF          4096
+
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+/* -------------------------------- Broker --------------------------------- */
+
+typedef struct {
+    int     fd;
+    uint8_t in[IN_BUF];
+    size_t  in_len;
+} conn_t;
+
+static conn_t   s_conns[MAX_CONNS];
+static uint16_t s_seen[SCALES][MAX_SEQ + 1];    // Deliveries per seq
+static bool     s_tripped[SCALES];              // Fault injected already
+static int      s_connects, s_dups, s_bad;
+
+static void conn_close(conn_t *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    c->in_len = 0;
+}
+
+static void send_all(conn_t *c, const void *p, size_t n)
+{
+    if (send(c->fd, p, n, MSG_NOSIGNAL) != (ssize_t)n) {
+        conn_close(c);
+    }
+}
+
+// {"dev":"f1ee00NN","recs":[[seq,ts,g,user,flags],...]}; the scale index
+// or -1 when the payload is not a weigh-in batch
+static int note_batch(const char *topic, const char *payload)
+{
+    unsigned dev;
+    if (sscanf(topic, "scale/%8x/weighins", &dev) != 1 || strstr(topic, "/weighins") == NULL) {
+        return -1;
+    }
+    int scale = (int)(dev - 0xf1ee0000u);
+    const char *p = strstr(payload, "\"recs\":[");
+    if (scale < 0 || scale >= SCALES || !p) {
+        s_bad++;
+        return -1;
+    }
+    for (p += 8; (p = strchr(p, '[')) != NULL; p++) {
+        unsigned seq;
+        if (sscanf(p, "[%u,", &seq) != 1 || seq == 0 || seq > MAX_SEQ) {
+            s_bad++;
+            break;
+        }
+        s_seen[scale][seq]++;
+    }
+    return scale;
+}
+
+// One complete packet at c->in; false when the connection went away
+static bool on_packet(conn_t *c, uint8_t type, const uint8_t *body, size_t len)
+{
+    switch (type >> 4) {
+    case 1: {   // CONNECT
+        static const uint8_t connack[] = { 0x20, 2, 0, 0 };
+        s_connects++;
+        send_all(c, connack, sizeof(connack));
+        break;
+    }
+    case 3: {   // PUBLISH, QoS 1 expected
+        if ((type & 0x06) != 0x02 || len < 4) {
+            s_bad++;
+            break;
+        }
+        size_t tlen = (size_t)body[0] << 8 | body[1];
+        if (2 + tlen + 2 > len) {
+            s_bad++;
+            break;
+        }
+        char topic[64], payload[IN_BUF];
+        snprintf(topic, sizeof(topic), "%.*s", (int)tlen, (const char *)body + 2);
+        const uint8_t *id = body + 2 + tlen;
+        snprintf(payload, sizeof(payload), "%.*s", (int)(len - 4 - tlen), (const char *)id + 2);
+        if (type & 0x08) {
+            s_dups++;
+        }
+        int scale = note_batch(topic, payload);
+        if (scale >= 0 && !s_tripped[scale]) {
+            s_tripped[scale] = true;
+            if (scale % 2 == 0) {
+                conn_close(c);
+                return false;
+            }
+            break;      // No PUBACK
+        }
+        uint8_t puback[] = { 0x40, 2, id[0], id[1] };
+        send_all(c, puback, sizeof(puback));
+        break;
+    }
+    case 12: {  // PINGREQ
+        static const uint8_t pingresp[] = { 0xd0, 0 };
+        send_all(c, pingresp, sizeof(pingresp));
+        break;
+    }
+    case 14:    // DISCONNECT
+        conn_close(c);
+        return false;
+    default:
+        s_bad++;
+        break;
+    }
+    return c->fd >= 0;
+}
+
+static void conn_read(conn_t *c)
+{
+    ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - c->in_len, 0);
+    if (n <= 0) {
+        conn_close(c);
+        return;
+    }
+    c->in_len += (size_t)n;
+    for (;;) {
+        size_t rem = 0, hdr = 1;
+        int shift = 0;
+        do {
+            if (hdr >= c->in_len) {
+                return;
+            }
+            rem |= (size_t)(c->in[hdr] & 0x7f) << shift;
+            shift += 7;
+        } while (c->in[hdr++] & 0x80);
+        if (hdr + rem > c->in_len) {
+            if (hdr + rem > sizeof(c->in)) {
+                s_bad++;
+                conn_close(c);
+            }
+            return;
+        }
+        if (!on_packet(c, c->in[0], c->in + hdr, rem)) {
+            return;
+        }
+        memmove(c->in, c->in + hdr + rem, c->in_len - hdr - rem);
+        c->in_len -= hdr + rem;
+    }
+}
+
+static int listen_on(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(port),
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (fd < 0 || bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0 || listen(fd, 16) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int bound_port(int fd)
+{
+    struct sockaddr_in a;
+    socklen_t len = sizeof(a);
+    getsockname(fd, (struct sockaddr *)&a, &len);
+    return ntohs(a.sin_port);
+}
+
+// SCALES consecutive free ports for the HTTP servers
+static int free_port_range(void)
+{
+    for (int tries = 0; tries < 32; tries++) {
+        int fd[SCALES], base = 0, ok = 1;
+        fd[0] = listen_on(0);
+        if (fd[0] < 0) return -1;
+        base = bound_port(fd[0]);
+        for (int i = 1; i < SCALES; i++) {
+            fd[i] = ok && base + i < 65536 ? listen_on(base + i) : -1;
+            ok = ok && fd[i] >= 0;
+        }
+        for (int i = 0; i < SCALES; i++) {
+            if (fd[i] >= 0) close(fd[i]);
+        }
+        if (ok) return base;
+    }
+    return -1;
+}
+
+/* ------------------------------ HTTP probe ------------------------------- */
+
+static int s_http_port;
+static int s_weight_ok, s_stream_ok;
+
+// Whatever the server sends within @p ms (or until it closes), NUL-ended
+static int http_get(const char *path, char *out, size_t len, int ms)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(s_http_port),
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    if (fd < 0 || connect(fd, (struct sockaddr *)&a, sizeof(a)) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    char req[128];
+    int n = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: scale\r\n\r\n", path);
+    send(fd, req, n, MSG_NOSIGNAL);
+    size_t got = 0;
+    struct pollfd p = { .fd = fd, .events = POLLIN };
+    while (got + 1 < len && poll(&p, 1, ms) > 0) {
+        ssize_t r = recv(fd, out + got, len - 1 - got, 0);
+        if (r <= 0) break;
+        got += (size_t)r;
+        out[got] = '\0';
+        if (strstr(out, "\r\n\r\n") && !strstr(out, "text/event-stream") &&
+            strstr(out, "Content-Length")) {
+            unsigned clen;
+            const char *cl = strstr(out, "Content-Length:"), *body = strstr(out, "\r\n\r\n") + 4;
+            if (cl && sscanf(cl, "Content-Length: %u", &clen) == 1 &&
+                got - (size_t)(body - out) >= clen) {
+                break;
+            }
+        }
+        if (strstr(out, "\ndata: {")) break;
+    }
+    out[got] = '\0';
+    close(fd);
+    return (int)got;
+}
+
+// Once the first weigh-in has locked: /weight and /stream
+static void *http_probe(void *arg)
+{
+    (void)arg;
+    char buf[4096];
+    for (int i = 0; i < 100 && !s_weight_ok; i++) {
+        usleep(100000);
+        if (http_get("/weight", buf, sizeof(buf), 1000) <= 0 || !strstr(buf, " 200 ")) {
+            continue;       // 500 until the first measurement
+        }
+        const char *body = strstr(buf, "\r\n\r\n");
+        float g;
+        char stable[8];
+        unsigned seq;
+        long long ts;
+        CHECK(body && sscanf(body + 4, "{\"weight\":%f,\"stable\":%5[a-z],\"seq\":%u,\"ts\":%lld}",
+                             &g, stable, &seq, &ts) == 4,
+              "/weight: %s", buf);
+        CHECK(strstr(buf, "application/json") != NULL, "/weight type: %s", buf);
+        s_weight_ok = 1;
+    }
+    http_get("/stream", buf, sizeof(buf), 2000);
+    s_stream_ok = strstr(buf, "text/event-stream") && strstr(buf, "\ndata: {\"weight\":");
+    return NULL;
+}
+
+/* --------------------------------- Main ---------------------------------- */
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s SCALE_FLEET\n", argv[0]);
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    char script[] = "/tmp/fleet_check_XXXXXX";
+    int sfd = mkstemp(script);
+    FILE *sf = sfd >= 0 ? fdopen(sfd, "w") : NULL;
+    if (!sf) {
+        perror("script");
+        return 1;
+    }
+    for (int i = 0; i < WEIGH_INS; i++) {
+        fprintf(sf, "%d %d 12\n", 5 + 20 * i, 55000 + 1500 * i);
+    }
+    fclose(sf);
+
+    int lfd = listen_on(0);
+    s_http_port = free_port_range();
+    if (lfd < 0 || s_http_port < 0) {
+        perror("listen");
+        return 1;
+    }
+    char broker[32], http[8], out_path[] = "/tmp/fleet_check_out_XXXXXX";
+    snprintf(broker, sizeof(broker), "127.0.0.1:%d", bound_port(lfd));
+    snprintf(http, sizeof(http), "%d", s_http_port);
+    int ofd = mkstemp(out_path);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(ofd, STDOUT_FILENO);
+        execl(argv[1], argv[1], "-n", "4", "--broker", broker, "--script", script,
+              "--stagger", "0", "--duration", DURATION_S, "--speed", SPEED,
+              "--http-port", http, "--report", "100", (char *)NULL);
+        perror(argv[1]);
+        _exit(127);
+    }
+    pthread_t probe;
+    pthread_create(&probe, NULL, http_probe, NULL);
+
+    for (int i = 0; i < MAX_CONNS; i++) {
+        s_conns[i].fd = -1;
+    }
+    int status = -1;
+    time_t give_up = time(NULL) + 60;
+    while (time(NULL) < give_up) {
+        if (waitpid(pid, &status, WNOHANG) == pid) break;
+        struct pollfd pfd[MAX_CONNS + 1] = { { .fd = lfd, .events = POLLIN } };
+        for (int i = 0; i < MAX_CONNS; i++) {
+            pfd[i + 1] = (struct pollfd){ .fd = s_conns[i].fd, .events = POLLIN };
+        }
+        if (poll(pfd, MAX_CONNS + 1, 50) <= 0) continue;
+        if (pfd[0].revents & POLLIN) {
+            int fd = accept(lfd, NULL, NULL);
+            int i = 0;
+            while (i < MAX_CONNS && s_conns[i].fd >= 0) i++;
+            if (i < MAX_CONNS) s_conns[i].fd = fd;
+            else close(fd);
+        }
+        for (int i = 0; i < MAX_CONNS; i++) {
+            if (s_conns[i].fd >= 0 && pfd[i + 1].revents) conn_read(&s_conns[i]);
+        }
+    }
+    if (!WIFEXITED(status)) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    pthread_join(probe, NULL);
+
+    // Delivered records against what scale_fleet says locked
+    char out[8192] = "";
+    FILE *of = fopen(out_path, "r");
+    size_t olen = of ? fread(out, 1, sizeof(out) - 1, of) : 0;
+    out[olen] = '\0';
+    if (of) fclose(of);
+    unlink(out_path);
+    unlink(script);
+
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "scale_fleet status %d:\n%s", status, out);
+    unsigned started = 0, locked = 0, acked = 0, unacked = 0;
+    const char *w = strstr(out, "weigh-ins ");
+    const char *m = strstr(out, "\nmqtt ");
+    CHECK(w && sscanf(w, "weigh-ins %u started, %u locked", &started, &locked) == 2,
+          "no weigh-in summary:\n%s", out);
+    CHECK(m && sscanf(m, "\nmqtt %u records acked", &acked) == 1 &&
+          strstr(m, " unacked at exit") &&
+          sscanf(strstr(m, " lost, ") + 7, "%u unacked", &unacked) == 1,
+          "no mqtt summary:\n%s", out);
+    CHECK(started == SCALES * WEIGH_INS, "%u weigh-ins started", started);
+
+    unsigned delivered = 0;
+    for (int s = 0; s < SCALES; s++) {
+        int n = 0;
+        while (n < MAX_SEQ && s_seen[s][n + 1]) n++;
+        for (int q = n + 1; q <= MAX_SEQ; q++) {
+            CHECK(!s_seen[s][q], "scale %d: seq %d delivered after a gap at %d", s, q, n + 1);
+        }
+        CHECK(n >= WEIGH_INS, "scale %d: %d records for %d weigh-ins", s, n, WEIGH_INS);
+        CHECK(s_tripped[s], "scale %d: never published", s);
+        delivered += (unsigned)n;
+    }
+    CHECK(delivered == locked, "%u records delivered, %u locked", delivered, locked);
+    CHECK(acked == locked && unacked == 0, "%u acked, %u unacked of %u", acked, unacked, locked);
+    CHECK(s_connects >= SCALES + SCALES / 2, "%d connects: even scales must reconnect", s_connects);
+    CHECK(s_dups > 0, "no DUP re-send after a lost connection");
+    CHECK(strstr(out, " 0 ack timeouts") == NULL, "no ack timeout re-send:\n%s", out);
+    CHECK(s_bad == 0, "%d malformed packets", s_bad);
+    CHECK(s_weight_ok, "GET /weight never answered 200");
+    CHECK(s_stream_ok, "GET /stream sent no data line");
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("%d scales, %u records, %d connects, %d DUP re-sends\n", SCALES, delivered, s_connects,
+           s_dups);
+    printf("all checks passed\n");
+    return 0;
+}
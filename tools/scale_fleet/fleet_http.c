@@ -0,0 +1,741 @@
+// File: tools/scale_fleet/fleet_http.c
+// ---------------------------------------------------------------------------
+// HTTP of one simulated scale: rest_api.c served from the node's poll loop
+//   - rest_api.c compiled in unchanged against the host_checks fake
+//     esp_http_server (http_host.h); rest_api_tune() sizes the server
+//     (REST_MAX_SOCKETS, LRU purge) and its route table is matched with
+//     httpd_uri_match_wildcard, as rest_api_register() would set it up
+//   - Quick routes run inline as on the httpd task; async routes run
+//     inline too (the poll loop stands in for the worker pool), so
+//     /history reads the node's weigh-in log
+//   - /stream, a blocking worker loop in the firmware, is paced here with
+//     the same steps: measurement_json() events at most REST_STREAM_HZ, a
+//     comment after REST_STREAM_KEEPALIVE_S, ended after REST_STREAM_MAX_S,
+//     RES_HTTP_WORKERS - 1 at a time (503 otherwise); wall-clock paced
+//   - A small cJSON writer, so /health and /config answer as on the scale;
+//     there is no JSON parser, so POST bodies get rest_api's 400
+// ---------------------------------------------------------------------------
+
+#include "fleet.h"
+
+#include "rest_api.c"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define HTTP_IN_BUF         2048
+#define HTTP_OUT_MAX        (64 * 1024)     // Largest buffered response
+#define HTTP_STREAM_BUF     4096            // A stream client further behind is dropped
+
+/* -------------------------------- State --------------------------------- */
+
+typedef struct {
+    int         fd;             // -1: free
+    int64_t     used_us;        // LRU purge order
+    bool        close_after;    // Close once the output is flushed
+    bool        stream;
+    int64_t     stream_start_us;
+    int64_t     stream_tx_us;
+    uint32_t    stream_seq;     // Last measurement sent on the stream
+    size_t      in_len;
+    size_t      body_off;       // Request body in `in`, for httpd_req_recv
+    char        in[HTTP_IN_BUF];
+    char       *out;
+    size_t      out_len, out_cap;
+    httpd_req_t req;
+} http_client_t;
+
+static fleet_stats_t  *s_st;
+static httpd_config_t  s_cfg;
+static int             s_listen = -1;
+static http_client_t   s_http[REST_MAX_SOCKETS];
+
+/* ---------------------------- Fake platform ----------------------------- */
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t n = strlen(src);
+    if (size) {
+        size_t k = n < size - 1 ? n : size - 1;
+        memcpy(dst, src, k);
+        dst[k] = '\0';
+    }
+    return n;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t max, UBaseType_t initial,
+                                                 StaticSemaphore_t *buf)
+{
+    return buf;
+}
+
+void *res_malloc(res_heap_t owner, size_t size) { return malloc(size); }
+void res_free(void *ptr) { free(ptr); }
+
+esp_err_t user_profiles_set(uint8_t id, const char *name, const body_input_t *body, float weight_hint_g) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t user_profiles_delete(uint8_t id) { return ESP_ERR_NOT_SUPPORTED; }
+bool user_profiles_get(uint8_t id, user_profile_t *out) { return false; }
+int user_profiles_read_history(uint8_t id, uint32_t from_seq, user_history_record_t *out, int max) { return 0; }
+void web_assets_get_stats(web_assets_stats_t *out) { memset(out, 0, sizeof(*out)); }
+esp_err_t web_assets_handler(httpd_req_t *req) { return httpd_resp_send_404(req); }
+
+/* -------------------------------- cJSON --------------------------------- */
+
+#define JSON_NUMBER     8
+#define JSON_STRING     16
+#define JSON_ARRAY      32
+#define JSON_OBJECT     64
+
+typedef struct {
+    char  *buf;
+    size_t len, cap;
+    bool   failed;
+} json_out_t;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks) { }
+cJSON *cJSON_Parse(const char *value) { return NULL; }
+
+static cJSON *json_new(int type, const char *name)
+{
+    cJSON *item = calloc(1, sizeof(*item));
+    if (item) {
+        item->type = type;
+        item->string = name ? strdup(name) : NULL;
+    }
+    return item;
+}
+
+bool cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    if (!array || !item) {
+        return false;
+    }
+    cJSON **tail = &array->child;
+    cJSON *prev = NULL;
+    while (*tail) {
+        prev = *tail;
+        tail = &(*tail)->next;
+    }
+    item->prev = prev;
+    *tail = item;
+    return true;
+}
+
+static cJSON *json_add(cJSON *object, int type, const char *name)
+{
+    cJSON *item = object ? json_new(type, name) : NULL;
+    if (item && !cJSON_AddItemToArray(object, item)) {
+        cJSON_Delete(item);
+        item = NULL;
+    }
+    return item;
+}
+
+cJSON *cJSON_CreateObject(void) { return json_new(JSON_OBJECT, NULL); }
+cJSON *cJSON_AddObjectToObject(cJSON *object, const char *name) { return json_add(object, JSON_OBJECT, name); }
+cJSON *cJSON_AddArrayToObject(cJSON *object, const char *name) { return json_add(object, JSON_ARRAY, name); }
+
+cJSON *cJSON_AddNumberToObject(cJSON *object, const char *name, double number)
+{
+    cJSON *item = json_add(object, JSON_NUMBER, name);
+    if (item) {
+        item->valuedouble = number;
+        item->valueint = (int)number;
+    }
+    return item;
+}
+
+cJSON *cJSON_AddStringToObject(cJSON *object, const char *name, const char *string)
+{
+    cJSON *item = json_add(object, JSON_STRING, name);
+    if (item) {
+        item->valuestring = strdup(string ? string : "");
+    }
+    return item;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *name)
+{
+    cJSON *item;
+    cJSON_ArrayForEach(item, object) {
+        if (item->string && !strcmp(item->string, name)) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+bool cJSON_IsNumber(const cJSON *item) { return item && item->type == JSON_NUMBER; }
+bool cJSON_IsString(const cJSON *item) { return item && item->type == JSON_STRING; }
+bool cJSON_IsObject(const cJSON *item) { return item && item->type == JSON_OBJECT; }
+
+void cJSON_Delete(cJSON *item)
+{
+    while (item) {
+        cJSON *next = item->next;
+        cJSON_Delete(item->child);
+        free(item->valuestring);
+        free(item->string);
+        free(item);
+        item = next;
+    }
+}
+
+void cJSON_free(void *object) { free(object); }
+
+static void json_put(json_out_t *o, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void json_put(json_out_t *o, const char *fmt, ...)
+{
+    for (int pass = 0; pass < 2 && !o->failed; pass++) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(o->buf + o->len, o->cap - o->len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            o->failed = true;
+        } else if ((size_t)n < o->cap - o->len) {
+            o->len += (size_t)n;
+            return;
+        } else {
+            o->cap = 2 * (o->len + (size_t)n + 1);
+            char *grown = realloc(o->buf, o->cap);
+            if (!grown) {
+                o->failed = true;
+            }
+            o->buf = grown ? grown : o->buf;
+        }
+    }
+}
+
+static void json_string(json_out_t *o, const char *s)
+{
+    json_put(o, "\"");
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') json_put(o, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) json_put(o, "\\u%04x", (unsigned char)*s);
+        else json_put(o, "%c", *s);
+    }
+    json_put(o, "\"");
+}
+
+// As cJSON: integral values without a fraction, 15 significant digits
+static void json_print(json_out_t *o, const cJSON *item)
+{
+    if (item->string) {
+        json_string(o, item->string);
+        json_put(o, ":");
+    }
+    switch (item->type) {
+    case JSON_NUMBER:
+        if (item->valuedouble == (double)(long long)item->valuedouble && fabs(item->valuedouble) < 1e15) {
+            json_put(o, "%lld", (long long)item->valuedouble);
+        } else {
+            json_put(o, "%1.15g", item->valuedouble);
+        }
+        break;
+    case JSON_STRING:
+        json_string(o, item->valuestring);
+        break;
+    default: {
+        bool object = item->type == JSON_OBJECT;
+        json_put(o, object ? "{" : "[");
+        for (const cJSON *c = item->child; c; c = c->next) {
+            json_print(o, c);
+            json_put(o, c->next ? "," : "");
+        }
+        json_put(o, object ? "}" : "]");
+        break;
+    }
+    }
+}
+
+char *cJSON_PrintUnformatted(const cJSON *item)
+{
+    json_out_t o = { .buf = malloc(256), .cap = 256 };
+    if (!o.buf) {
+        return NULL;
+    }
+    o.buf[0] = '\0';
+    json_print(&o, item);
+    if (o.failed) {
+        free(o.buf);
+        return NULL;
+    }
+    return o.buf;
+}
+
+/* --------------------------- esp_http_server ---------------------------- */
+
+static bool http_put(http_client_t *c, const char *data, size_t len)
+{
+    size_t limit = c->stream ? HTTP_STREAM_BUF : HTTP_OUT_MAX;
+    if (c->out_len + len > limit) {
+        return false;
+    }
+    if (c->out_len + len > c->out_cap) {
+        size_t cap = 2 * (c->out_len + len);
+        char *grown = realloc(c->out, cap);
+        if (!grown) {
+            return false;
+        }
+        c->out = grown;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    return true;
+}
+
+static const char *reason(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 503: return "Service Unavailable";
+    default:  return "Internal Server Error";
+    }
+}
+
+// Status line and headers; chunked, or with a Content-Length of len
+static bool send_head(httpd_req_t *req, bool chunked, size_t len)
+{
+    http_client_t *c = req->aux;
+    char head[768];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", req->status,
+                     reason(req->status), req->type[0] ? req->type : "text/html");
+    for (const char *h = req->hdrs; *h && n < (int)sizeof(head); ) {
+        size_t k = strcspn(h, "\n");
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "%.*s\r\n", (int)k, h);
+        h += k + (h[k] == '\n');
+    }
+    if (chunked) {
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "Transfer-Encoding: chunked\r\n\r\n");
+    } else {
+        n += snprintf(head + n, sizeof(head) - (size_t)n, "Content-Length: %zu\r\n\r\n", len);
+    }
+    if (req->status >= 400) {
+        s_st->http_errors++;
+    }
+    if (req->status == 503) {
+        s_st->http_refused++;
+    }
+    req->chunks = 1;            // Head sent
+    return n < (int)sizeof(head) && http_put(c, head, (size_t)n);
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status)
+{
+    req->status = atoi(status);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    snprintf(req->type, sizeof(req->type), "%s", type);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value)
+{
+    size_t n = strlen(req->hdrs);
+    snprintf(req->hdrs + n, sizeof(req->hdrs) - n, "%s: %s\n", field, value);
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    if (len == HTTPD_RESP_USE_STRLEN) len = buf ? (ssize_t)strlen(buf) : 0;
+    bool ok = send_head(req, false, (size_t)len) && http_put(req->aux, buf, (size_t)len);
+    req->done = true;
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t len)
+{
+    if (len == HTTPD_RESP_USE_STRLEN) len = buf ? (ssize_t)strlen(buf) : 0;
+    http_client_t *c = req->aux;
+    if (!req->chunks && !send_head(req, true, 0)) return ESP_FAIL;
+    if (!buf || len == 0) {
+        req->done = true;
+        return http_put(c, "0\r\n\r\n", 5) ? ESP_OK : ESP_FAIL;
+    }
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", (size_t)len);
+    bool ok = http_put(c, size, (size_t)n) && http_put(c, buf, (size_t)len) && http_put(c, "\r\n", 2);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t err, const char *msg)
+{
+    req->status = err == HTTPD_404_NOT_FOUND ? 404 : err == HTTPD_400_BAD_REQUEST ? 400 : 500;
+    req->type[0] = '\0';
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, msg ? msg : reason(req->status));
+}
+
+esp_err_t httpd_resp_send_500(httpd_req_t *req)
+{
+    return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, NULL);
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t len)
+{
+    http_client_t *c = req->aux;
+    size_t n = len < req->content_len ? len : req->content_len;
+    memcpy(buf, c->in + c->body_off, n);
+    return (int)n;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t len)
+{
+    const char *q = strchr(req->uri, '?');
+    if (!q) return ESP_ERR_NOT_FOUND;
+    return (size_t)snprintf(buf, len, "%s", q + 1) < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t len)
+{
+    size_t klen = strlen(key);
+    for (const char *p = qry; p && *p; p = strchr(p, '&') ? strchr(p, '&') + 1 : NULL) {
+        if (!strncmp(p, key, klen) && p[klen] == '=') {
+            const char *v = p + klen + 1;
+            size_t n = strcspn(v, "&");
+            snprintf(val, len, "%.*s", (int)n, v);
+            return n < len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+// As in esp_http_server: a trailing '*' matches any rest, a trailing '?'
+// makes the character before it optional, and "?*" does both
+bool httpd_uri_match_wildcard(const char *tpl, const char *uri, size_t len)
+{
+    size_t n = strlen(tpl);
+    bool any = n > 0 && tpl[n - 1] == '*';
+    if (any) n--;
+    bool opt = n > 1 && tpl[n - 1] == '?';
+    if (opt) n -= 2;
+    if (len < n || strncmp(tpl, uri, n) != 0) return false;
+    if (opt && len > n && uri[n] == tpl[n]) n++;
+    return any || len == n;
+}
+
+// Routes are matched from s_routes directly, and nothing is detached:
+// the poll loop runs every handler itself
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out) { return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r) { return ESP_ERR_NOT_SUPPORTED; }
+
+/* -------------------------------- Server -------------------------------- */
+
+static void http_close(http_client_t *c)
+{
+    if (c->stream) {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.streams_open--;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    close(c->fd);
+    free(c->out);
+    *c = (http_client_t){ .fd = -1 };
+}
+
+static int streams_open(void)
+{
+    int n = 0;
+    for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+        n += s_http[i].fd >= 0 && s_http[i].stream;
+    }
+    return n;
+}
+
+// get_stream_handler's prologue; its loop is stream_tick()
+static void stream_open(http_client_t *c, int64_t now)
+{
+    httpd_req_t *req = &c->req;
+    if (streams_open() >= RES_HTTP_WORKERS - 1) {
+        stats_add(&s_stats.busy);
+        send_busy(req);
+        return;
+    }
+    c->stream = true;
+    stats_add(&s_stats.streams_open);
+    s_st->sse_open++;
+    httpd_resp_set_type(req, "text/event-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    c->stream_start_us = now;
+    c->stream_tx_us = 0;
+    c->stream_seq = 0;
+    httpd_resp_sendstr_chunk(req, "retry: 2000\n\n");
+}
+
+static void stream_end(http_client_t *c)
+{
+    httpd_resp_send_chunk(&c->req, NULL, 0);
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.streams_open--;
+    taskEXIT_CRITICAL(&s_lock);
+    c->stream = false;
+}
+
+// As route_dispatch(), with every worker being this loop
+static void dispatch(http_client_t *c, int64_t now)
+{
+    httpd_req_t *req = &c->req;
+    size_t path_len = strcspn(req->uri, "?");
+    const rest_route_t *route = NULL;
+    for (size_t i = 0; i < ROUTE_COUNT && !route; i++) {
+        if ((int)s_routes[i].method == req->method &&
+            s_cfg.uri_match_fn(s_routes[i].uri, req->uri, path_len)) {
+            route = &s_routes[i];
+        }
+    }
+    s_st->http_requests++;
+    if (!route) {
+        req->status = 405;
+        httpd_resp_sendstr(req, "Method Not Allowed");
+        return;
+    }
+    stats_add(&s_stats.requests);
+    if (route->stream) {
+        stream_open(c, now);
+        return;
+    }
+    if (route->async) {
+        stats_add(&s_stats.async_runs);
+    }
+    if (route->handler(req) != ESP_OK || !req->done) {
+        c->close_after = true;  // As esp_http_server on a failed handler
+    }
+}
+
+static int method_of(const char *m)
+{
+    static const char *const names[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (!strcmp(m, names[i])) return i;
+    }
+    return -1;
+}
+
+static void http_read(http_client_t *c, int64_t now)
+{
+    ssize_t n = recv(c->fd, c->in + c->in_len, sizeof(c->in) - 1 - c->in_len, 0);
+    if (n <= 0) {
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            http_close(c);
+        }
+        return;
+    }
+    c->used_us = now;
+    if (c->stream) {
+        return;                 // Nothing more is read from a stream
+    }
+    c->in_len += n;
+    c->in[c->in_len] = '\0';
+    char *end;
+    while (!c->stream && !c->close_after && (end = strstr(c->in, "\r\n\r\n")) != NULL) {
+        char method[8], uri[sizeof(c->req.uri)];
+        size_t head = end + 4 - c->in, body = 0;
+        const char *cl = strcasestr(c->in, "\r\nContent-Length:");
+        if (cl && cl < end) {
+            body = strtoul(cl + 17, NULL, 10);
+        }
+        if (head + body > sizeof(c->in) - 1 || sscanf(c->in, "%7s %512s", method, uri) != 2) {
+            s_st->http_requests++;
+            c->req = (httpd_req_t){ .aux = c, .status = 400 };
+            httpd_resp_sendstr(&c->req, "Bad Request");
+            c->close_after = true;
+            return;
+        }
+        if (c->in_len < head + body) {
+            return;             // Body still coming
+        }
+        c->req = (httpd_req_t){
+            .handle = &s_cfg, .method = method_of(method), .content_len = body, .aux = c, .status = 200,
+        };
+        snprintf(c->req.uri, sizeof(c->req.uri), "%s", uri);
+        c->body_off = head;
+        dispatch(c, now);
+        memmove(c->in, c->in + head + body, c->in_len - head - body + 1);
+        c->in_len -= head + body;
+    }
+    if (c->in_len == sizeof(c->in) - 1) {
+        c->req = (httpd_req_t){ .aux = c, .status = 400 };
+        httpd_resp_sendstr(&c->req, "Bad Request");
+        c->close_after = true;
+    }
+}
+
+static void http_write(http_client_t *c)
+{
+    if (c->out_len > 0) {
+        ssize_t n = send(c->fd, c->out, c->out_len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                http_close(c);
+            }
+            return;
+        }
+        memmove(c->out, c->out + n, c->out_len - n);
+        c->out_len -= n;
+    }
+    if (c->out_len == 0 && c->close_after) {
+        http_close(c);
+    }
+}
+
+// A free slot; when full, the least recently used session makes room
+// (lru_purge_enable), or the new connection is refused
+static void http_accept(int64_t now)
+{
+    int fd = accept4(s_listen, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    http_client_t *slot = NULL, *lru = NULL;
+    for (int i = 0; i < s_cfg.max_open_sockets && i < REST_MAX_SOCKETS; i++) {
+        http_client_t *c = &s_http[i];
+        if (c->fd < 0) {
+            slot = slot ? slot : c;
+        } else if (!lru || c->used_us < lru->used_us) {
+            lru = c;
+        }
+    }
+    if (!slot && s_cfg.lru_purge_enable && lru) {
+        http_close(lru);
+        slot = lru;
+        s_st->http_refused++;
+    }
+    if (!slot) {
+        s_st->http_refused++;
+        close(fd);
+        return;
+    }
+    *slot = (http_client_t){ .fd = fd, .used_us = now };
+}
+
+/* -------------------------------- Node ---------------------------------- */
+
+int fleet_http_init(int port, fleet_stats_t *st)
+{
+    s_st = st;
+    for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+        s_http[i].fd = -1;
+    }
+    rest_api_tune(&s_cfg);
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = {
+        .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    if (fd < 0 || bind(fd, (struct sockaddr *)&a, sizeof(a)) != 0 ||
+        listen(fd, s_cfg.backlog_conn + 62) != 0) {
+        fprintf(stderr, "scale %" PRIu32 ": port %d: %s\n", st->scale, port, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    s_listen = fd;
+    return 0;
+}
+
+void fleet_http_record(const measurement_t *m)
+{
+    rest_api_set_latest_measurement(m);
+}
+
+int fleet_http_fds(struct pollfd *pfd, int max)
+{
+    int n = 0;
+    if (s_listen < 0) {
+        return 0;
+    }
+    pfd[n++] = (struct pollfd){ s_listen, POLLIN, 0 };
+    for (int i = 0; i < REST_MAX_SOCKETS && n < max; i++) {
+        if (s_http[i].fd >= 0) {
+            pfd[n++] = (struct pollfd){ s_http[i].fd, POLLIN | (s_http[i].out_len ? POLLOUT : 0), 0 };
+        }
+    }
+    return n;
+}
+
+void fleet_http_io(const struct pollfd *pfd, int n, int64_t now)
+{
+    for (int k = 0; k < n; k++) {
+        if (!pfd[k].revents) {
+            continue;
+        }
+        if (pfd[k].fd == s_listen) {
+            http_accept(now);
+            continue;
+        }
+        for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+            http_client_t *c = &s_http[i];
+            if (c->fd != pfd[k].fd) {
+                continue;
+            }
+            if (pfd[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                http_read(c, now);
+            }
+            if (c->fd >= 0) {
+                http_write(c);
+            }
+            break;
+        }
+    }
+}
+
+// get_stream_handler's loop, one step per client and pass
+int64_t fleet_http_tick(int64_t now)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < REST_MAX_SOCKETS; i++) {
+        http_client_t *c = &s_http[i];
+        if (c->fd < 0 || !c->stream) {
+            continue;
+        }
+        if (now - c->stream_start_us >= (int64_t)REST_STREAM_MAX_S * 1000000) {
+            stream_end(c);
+            continue;
+        }
+        esp_err_t err = ESP_OK;
+        measurement_t m;
+        int64_t due = c->stream_tx_us + 1000000 / REST_STREAM_HZ;
+        if (latest_get(&m) && m.seq != c->stream_seq) {
+            if (now >= due) {
+                char ev[112];
+                char json[96];
+                int len = measurement_json(json, sizeof(json), &m);
+                if (len > 0) {
+                    len = snprintf(ev, sizeof(ev), "data: %s\n\n", json);
+                    err = httpd_resp_send_chunk(&c->req, ev, len);
+                    c->stream_seq = m.seq;
+                    c->stream_tx_us = now;
+                    s_st->sse_events++;
+                }
+            } else if (due < next) {
+                next = due;
+            }
+        } else if (now - c->stream_tx_us >= (int64_t)REST_STREAM_KEEPALIVE_S * 1000000) {
+            err = httpd_resp_sendstr_chunk(&c->req, ": ka\n\n");
+            c->stream_tx_us = now;
+        }
+        if (err != ESP_OK) {
+            s_st->sse_dropped++;
+            http_close(c);
+        }
+    }
+    return next;
+}
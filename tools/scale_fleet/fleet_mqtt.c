@@ -0,0 +1,626 @@
+// File: tools/scale_fleet/fleet_mqtt.c
+// ---------------------------------------------------------------------------
+// MQTT of one simulated scale: the firmware's uplink on a real socket
+//   - mqtt_uplink.c and weigh_log.c compiled in unchanged; the log file is
+//     a byte buffer, and uplink_step() runs on every pass of the node's
+//     poll loop, where the uplink task would wake
+//   - esp_mqtt_client_* (tools/host_checks/host/mqtt_host.h) over
+//     non-blocking TCP, MQTT 3.1.1: clean-session CONNECT, QoS1 PUBLISH,
+//     PUBACK, PINGREQ at the keepalive; events reach the uplink's handler
+//     as esp-mqtt's task would deliver them
+//   - As in esp-mqtt, unacknowledged QoS1 messages stay in an outbox, are
+//     sent again (DUP) after a reconnect and expire after
+//     MQTT_OUTBOX_EXPIRE_MS; reconnects back off with jitter
+//   - The uplink's own timers (record age, ack timeout, rollups) run on
+//     the replay clock: at --speed X the broker looks X times slower
+// ---------------------------------------------------------------------------
+
+#include "fleet.h"
+#include "synth.h"
+
+#include "mqtt_uplink.c"
+#include "clock_map.h"
+#include "storage.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MQTT_IN_BUF             1024
+#define MQTT_OUTBOX_SIZE        (MQTT_UPLINK_INFLIGHT + 4)     // Window + rollups
+#define MQTT_OUT_BUF            (MQTT_OUTBOX_SIZE * (MQTT_UPLINK_PAYLOAD_MAX + 128))  // All of it at CONNACK
+#define MQTT_OUTBOX_EXPIRE_MS   30000   // esp-mqtt OUTBOX_EXPIRED_TIMEOUT_MS
+#define MQTT_NETWORK_TIMEOUT_MS 10000   // esp-mqtt network_timeout_ms
+#define MQTT_BACKOFF_MAX_MS     30000
+
+/* -------------------------------- State --------------------------------- */
+
+// One unacknowledged QoS1 PUBLISH, kept whole for a resend
+typedef struct {
+    int      msg_id;            // 0: free
+    bool     weighins;          // Batch topic (rollups are not counted)
+    uint32_t first_seq, last_seq;
+    int64_t  sent_us;           // Wall time of the first send
+    size_t   len;
+    uint8_t *pkt;
+} outbox_t;
+
+typedef enum { MQ_IDLE, MQ_CONNECTING, MQ_CONNACK, MQ_UP } mq_state_t;
+
+struct esp_mqtt_client {
+    struct sockaddr_storage addr;
+    socklen_t  addr_len;
+    char       client_id[24];
+    int        keepalive_s;
+    esp_event_handler_t handler;
+    void      *handler_arg;
+    bool       started;
+
+    mq_state_t state;
+    int        fd;
+    int64_t    since_us;        // Entered the current state
+    int64_t    retry_us;
+    int        backoff_ms;
+    int64_t    tx_us;           // Last packet sent (keepalive)
+    uint16_t   next_id;
+    outbox_t   outbox[MQTT_OUTBOX_SIZE];
+    size_t     in_len, out_len;
+    uint8_t    in[MQTT_IN_BUF];
+    uint8_t    out[MQTT_OUT_BUF];
+};
+
+static struct esp_mqtt_client s_mq = { .fd = -1 };
+static fleet_stats_t *s_st;
+static synth_rng_t    s_rng;
+static int            s_index;
+static time_t         s_boot_unix;      // Wall time of replay clock 0
+
+static hub_sink_fn    s_hub_sink;       // The uplink's hub subscriber
+static void          *s_hub_ctx;
+static int64_t        s_lock_us[WEIGH_LOG_CAPACITY];   // Per seq: wall time of the lock
+static uint32_t       s_seq_max;        // Highest seq ever published
+
+static uint8_t        s_log[WEIGH_LOG_CAPACITY * sizeof(weigh_log_record_t)];
+static size_t         s_log_len;
+
+/* ---------------------------- Fake platform ----------------------------- */
+
+// Device id f1ee0000 + index (mqtt_uplink uses MAC bytes 2..5)
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    const uint8_t m[6] = { 0x24, 0x0a, 0xf1, 0xee, (uint8_t)(s_index >> 8), (uint8_t)s_index };
+    memcpy(mac, m, sizeof(m));
+    return ESP_OK;
+}
+
+// replay.c's nvs_open() fails (no NVS on the host): the cursor lives in RAM
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out) { return ESP_ERR_NOT_FOUND; }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t value) { return ESP_ERR_NOT_FOUND; }
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = (uint16_t)~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+        }
+    }
+    return (uint16_t)~crc;
+}
+
+// replay.c has no wall clock at capture (clock_map_to_wall() is 0), so the
+// log stores boot-relative stamps; reads re-base them as after SNTP
+uint8_t clock_map_boot_tag(void) { return 1; }
+
+bool clock_map_resolve(uint8_t boot_tag, int64_t mono_us, time_t *wall)
+{
+    *wall = s_boot_unix + (time_t)(mono_us / 1000000);
+    return true;
+}
+
+esp_err_t storage_open(const char *name, storage_file_t *f)
+{
+    f->fd = 3;
+    return ESP_OK;
+}
+
+esp_err_t storage_read_at(storage_file_t *f, size_t offset, void *buf, size_t len, size_t *got)
+{
+    *got = 0;
+    if (offset < s_log_len) {
+        *got = len < s_log_len - offset ? len : s_log_len - offset;
+        memcpy(buf, s_log + offset, *got);
+    }
+    return ESP_OK;
+}
+
+esp_err_t storage_write_at(storage_file_t *f, size_t offset, const void *data, size_t len,
+                           storage_sync_t sync)
+{
+    if (offset + len > sizeof(s_log)) {
+        return ESP_FAIL;
+    }
+    memcpy(s_log + offset, data, len);
+    if (offset + len > s_log_len) {
+        s_log_len = offset + len;
+    }
+    return ESP_OK;
+}
+
+// The weigh log is the scale's only file: /health reports its RAM copy
+void storage_get_stats(storage_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->backend = "ram";
+    out->total_bytes = sizeof(s_log);
+    out->used_bytes = s_log_len;
+}
+
+int app_connection_manager_subscribe(const char *name, hub_sink_fn sink, void *ctx, uint8_t depth,
+                                     hub_drop_policy_t policy, uint32_t kinds, UBaseType_t prio)
+{
+    s_hub_sink = sink;
+    s_hub_ctx = ctx;
+    return 0;
+}
+
+/* ------------------------------ esp-mqtt -------------------------------- */
+
+static void deliver(esp_mqtt_event_id_t id, int msg_id)
+{
+    esp_mqtt_error_codes_t err = { .error_type = 1 };   // MQTT_ERROR_TYPE_TCP_TRANSPORT
+    esp_mqtt_event_t ev = {
+        .event_id = id, .client = &s_mq, .msg_id = msg_id,
+        .error_handle = id == MQTT_EVENT_ERROR ? &err : NULL,
+    };
+    if (s_mq.handler) {
+        s_mq.handler(s_mq.handler_arg, "MQTT_EVENTS", id, &ev);
+    }
+}
+
+static size_t put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v >> 8;
+    p[1] = v & 0xFF;
+    return 2;
+}
+
+static size_t put_str(uint8_t *p, const char *s)
+{
+    size_t n = strlen(s);
+    put_u16(p, (uint16_t)n);
+    memcpy(p + 2, s, n);
+    return 2 + n;
+}
+
+// Fixed header for @p body_len bytes into @p hdr; returns its length
+static size_t fixed_header(uint8_t *hdr, uint8_t type, size_t body_len)
+{
+    size_t n = 0;
+    hdr[n++] = type;
+    do {
+        hdr[n] = body_len & 0x7F;
+        body_len >>= 7;
+        hdr[n++] |= body_len ? 0x80 : 0;
+    } while (body_len);
+    return n;
+}
+
+static bool mq_queue(const uint8_t *pkt, size_t len)
+{
+    if (s_mq.out_len + len > sizeof(s_mq.out)) {
+        return false;
+    }
+    memcpy(s_mq.out + s_mq.out_len, pkt, len);
+    s_mq.out_len += len;
+    s_mq.tx_us = fleet_wall_us();
+    return true;
+}
+
+static void outbox_free(outbox_t *e)
+{
+    free(e->pkt);
+    *e = (outbox_t){ 0 };
+}
+
+static void mq_fail(int64_t now)
+{
+    bool was_up = s_mq.state == MQ_UP;
+    if (s_mq.fd >= 0) {
+        close(s_mq.fd);
+        s_mq.fd = -1;
+    }
+    s_st->mqtt_failures++;
+    s_mq.state = MQ_IDLE;
+    s_mq.in_len = s_mq.out_len = 0;
+    int jitter = (int)(synth_rand(&s_rng) * s_mq.backoff_ms / 2);
+    s_mq.retry_us = now + (int64_t)(s_mq.backoff_ms + jitter) * 1000;
+    s_mq.backoff_ms = s_mq.backoff_ms * 2 > MQTT_BACKOFF_MAX_MS ? MQTT_BACKOFF_MAX_MS
+                                                               : s_mq.backoff_ms * 2;
+    deliver(was_up ? MQTT_EVENT_DISCONNECTED : MQTT_EVENT_ERROR, -1);
+}
+
+static void mq_connect(int64_t now)
+{
+    s_mq.fd = socket(s_mq.addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s_mq.fd < 0) {
+        mq_fail(now);
+        return;
+    }
+    int one = 1;
+    setsockopt(s_mq.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    s_mq.since_us = now;
+    if (connect(s_mq.fd, (struct sockaddr *)&s_mq.addr, s_mq.addr_len) == 0 || errno == EINPROGRESS) {
+        s_mq.state = MQ_CONNECTING;
+    } else {
+        mq_fail(now);
+    }
+}
+
+// TCP is up: CONNECT, clean session (the uplink's cursor is the state)
+static void mq_send_connect(int64_t now)
+{
+    uint8_t pkt[64];
+    size_t body = 10 + 2 + strlen(s_mq.client_id);
+    size_t n = fixed_header(pkt, 0x10, body);
+    n += put_str(pkt + n, "MQTT");
+    pkt[n++] = 4;               // 3.1.1
+    pkt[n++] = 0x02;            // Clean session
+    n += put_u16(pkt + n, (uint16_t)s_mq.keepalive_s);
+    n += put_str(pkt + n, s_mq.client_id);
+    mq_queue(pkt, n);
+    s_mq.state = MQ_CONNACK;
+    s_mq.since_us = now;
+}
+
+// Records of a weigh-in batch: {"dev":"..","recs":[[seq,..],[seq,..]]}
+static void batch_seqs(const char *data, outbox_t *e)
+{
+    const char *p = strstr(data, "\"recs\":[");
+    if (!p) {
+        return;
+    }
+    for (p += 8; *p == '['; ) {
+        char *end;
+        uint32_t seq = (uint32_t)strtoul(p + 1, &end, 10);
+        if (!e->first_seq) {
+            e->first_seq = seq;
+        }
+        e->last_seq = seq;
+        if (seq <= s_seq_max) {
+            s_st->mqtt_resent_recs++;
+        } else {
+            s_seq_max = seq;
+        }
+        p = strchr(end, ']');
+        if (!p) {
+            break;
+        }
+        p += (p[1] == ',') ? 2 : 1;
+    }
+}
+
+static void mq_puback(int msg_id, int64_t now)
+{
+    for (int i = 0; i < MQTT_OUTBOX_SIZE; i++) {
+        outbox_t *e = &s_mq.outbox[i];
+        if (e->msg_id != msg_id) {
+            continue;
+        }
+        if (e->weighins) {
+            s_st->mqtt_acked_msgs++;
+            s_st->rtt_hist[fleet_hist_bucket(now - e->sent_us)]++;
+            for (uint32_t seq = e->first_seq; seq && seq <= e->last_seq; seq++) {
+                int64_t *lock = &s_lock_us[seq % WEIGH_LOG_CAPACITY];
+                if (*lock) {
+                    s_st->e2e_hist[fleet_hist_bucket(now - *lock)]++;
+                    *lock = 0;
+                }
+            }
+        }
+        outbox_free(e);
+        deliver(MQTT_EVENT_PUBLISHED, msg_id);
+        return;
+    }
+}
+
+static void mq_read(int64_t now)
+{
+    ssize_t n = recv(s_mq.fd, s_mq.in + s_mq.in_len, sizeof(s_mq.in) - s_mq.in_len, 0);
+    if (n <= 0) {
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            mq_fail(now);
+        }
+        return;
+    }
+    s_mq.in_len += n;
+    while (s_mq.fd >= 0) {
+        size_t len = 0, hdr = 1;
+        int shift = 0;
+        while (hdr < s_mq.in_len && hdr < 5) {
+            len |= (size_t)(s_mq.in[hdr] & 0x7F) << shift;
+            shift += 7;
+            if (!(s_mq.in[hdr++] & 0x80)) {
+                shift = -1;
+                break;
+            }
+        }
+        if (shift != -1) {
+            if (hdr >= 5) {
+                mq_fail(now);   // Malformed length
+            }
+            return;
+        }
+        if (hdr + len > sizeof(s_mq.in)) {
+            mq_fail(now);       // Nothing is subscribed; nothing is this big
+            return;
+        }
+        if (hdr + len > s_mq.in_len) {
+            return;
+        }
+        const uint8_t *b = s_mq.in + hdr;
+        switch (s_mq.in[0] >> 4) {
+        case 2:                 // CONNACK
+            if (len < 2 || b[1] != 0) {
+                mq_fail(now);
+                return;
+            }
+            s_mq.state = MQ_UP;
+            s_mq.backoff_ms = 1000;
+            // Unacknowledged messages first, oldest first, as duplicates
+            for (int i = 0; i < MQTT_OUTBOX_SIZE; i++) {
+                outbox_t *e = &s_mq.outbox[i];
+                if (e->msg_id) {
+                    e->pkt[0] |= 0x08;
+                    if (e->weighins) {
+                        s_st->mqtt_msgs++;
+                    }
+                    mq_queue(e->pkt, e->len);
+                }
+            }
+            deliver(MQTT_EVENT_CONNECTED, 0);
+            break;
+        case 4:                 // PUBACK
+            if (len >= 2) {
+                mq_puback(b[0] << 8 | b[1], now);
+            }
+            break;
+        default:                // PINGRESP and anything unexpected
+            break;
+        }
+        memmove(s_mq.in, s_mq.in + hdr + len, s_mq.in_len - hdr - len);
+        s_mq.in_len -= hdr + len;
+    }
+}
+
+static void mq_write(int64_t now)
+{
+    if (s_mq.out_len == 0) {
+        return;
+    }
+    ssize_t n = send(s_mq.fd, s_mq.out, s_mq.out_len, MSG_NOSIGNAL);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            mq_fail(now);
+        }
+        return;
+    }
+    memmove(s_mq.out, s_mq.out + n, s_mq.out_len - n);
+    s_mq.out_len -= n;
+}
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    const char *uri = config->broker.address.uri;
+    if (strncmp(uri, "mqtt://", 7) != 0) {
+        return NULL;            // No TLS here
+    }
+    char host[256], port[8] = "1883";
+    snprintf(host, sizeof(host), "%s", uri + 7);
+    char *colon = strrchr(host, ':');
+    if (colon && !strchr(colon, ']')) {
+        *colon = '\0';
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+    struct addrinfo hints = { .ai_socktype = SOCK_STREAM }, *res;
+    int err = getaddrinfo(host, port, &hints, &res);
+    if (err != 0) {
+        fprintf(stderr, "%s: %s\n", host, gai_strerror(err));
+        return NULL;
+    }
+    memcpy(&s_mq.addr, res->ai_addr, res->ai_addrlen);
+    s_mq.addr_len = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(s_mq.client_id, sizeof(s_mq.client_id), "ESP32_%02X%02X%02X", mac[3], mac[4], mac[5]);
+    s_mq.keepalive_s = config->session.keepalive;
+    return &s_mq;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, esp_mqtt_event_id_t event,
+                                         esp_event_handler_t handler, void *arg)
+{
+    client->handler = handler;
+    client->handler_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    client->started = true;
+    client->state = MQ_IDLE;
+    client->backoff_ms = 1000;
+    client->retry_us = fleet_wall_us() + (int64_t)(synth_rand(&s_rng) * 1e6);  // No connect storm
+    return ESP_OK;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data,
+                            int len, int qos, int retain)
+{
+    outbox_t *e = NULL;
+    for (int i = 0; i < MQTT_OUTBOX_SIZE && !e; i++) {
+        if (!client->outbox[i].msg_id) {
+            e = &client->outbox[i];
+        }
+    }
+    if (client->state != MQ_UP || qos != 1 || !e) {
+        return -1;
+    }
+
+    uint8_t hdr[5];
+    size_t topic_len = strlen(topic), body = 2 + topic_len + 2 + (size_t)len;
+    size_t n = fixed_header(hdr, 0x32 | (retain ? 1 : 0), body);
+    e->pkt = malloc(n + body);
+    if (!e->pkt) {
+        return -1;
+    }
+    if (++client->next_id == 0) {
+        client->next_id = 1;
+    }
+    uint8_t *p = e->pkt;
+    memcpy(p, hdr, n);
+    p += n;
+    p += put_str(p, topic);
+    p += put_u16(p, client->next_id);
+    memcpy(p, data, len);
+    e->len = n + body;
+    if (!mq_queue(e->pkt, e->len)) {
+        outbox_free(e);
+        return -1;              // Socket backed up: the uplink retries next step
+    }
+    e->msg_id = client->next_id;
+    e->sent_us = fleet_wall_us();
+    e->weighins = strstr(topic, "/weighins") != NULL;
+    if (e->weighins) {
+        s_st->mqtt_msgs++;
+        batch_seqs(data, e);
+    }
+    return e->msg_id;
+}
+
+/* -------------------------------- Node ---------------------------------- */
+
+int fleet_mqtt_init(const fleet_opts_t *o, int index, fleet_stats_t *st)
+{
+    s_st = st;
+    s_index = index;
+    s_boot_unix = time(NULL);
+    synth_seed(&s_rng, o->seed * 7919u + index);
+    if (weigh_log_init() != ESP_OK) {
+        return -1;
+    }
+    char uri[300];
+    snprintf(uri, sizeof(uri), "mqtt://%s:%d", o->broker_host, o->broker_port);
+    return mqtt_uplink_init(&(mqtt_uplink_config_t){ .uri = uri }) == ESP_OK ? 0 : -1;
+}
+
+void fleet_mqtt_record(const measurement_t *m)
+{
+    uint32_t seq;
+    if (weigh_log_append(m->weight_g, m->mono_us, m->user_id, &seq) == ESP_OK) {
+        s_lock_us[seq % WEIGH_LOG_CAPACITY] = fleet_wall_us();
+    }
+    if (s_hub_sink) {
+        s_hub_sink(m, s_hub_ctx);
+    }
+}
+
+int fleet_mqtt_fds(struct pollfd *pfd, int64_t *wake)
+{
+    if (!s_mq.started) {
+        return 0;
+    }
+    if (s_mq.state == MQ_IDLE) {
+        if (s_mq.retry_us < *wake) *wake = s_mq.retry_us;
+        return 0;
+    }
+    int64_t ping = s_mq.tx_us + (int64_t)s_mq.keepalive_s * 1000000;
+    if (s_mq.state == MQ_UP && ping < *wake) {
+        *wake = ping;
+    }
+    short ev = POLLIN | (s_mq.out_len || s_mq.state == MQ_CONNECTING ? POLLOUT : 0);
+    *pfd = (struct pollfd){ s_mq.fd, ev, 0 };
+    return 1;
+}
+
+void fleet_mqtt_io(const struct pollfd *pfd, int64_t now)
+{
+    if (!pfd->revents || s_mq.fd != pfd->fd) {
+        return;
+    }
+    if (s_mq.state == MQ_CONNECTING) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(s_mq.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err) {
+            mq_fail(now);
+            return;
+        }
+        mq_send_connect(now);
+    }
+    if (pfd->revents & (POLLIN | POLLHUP | POLLERR)) {
+        mq_read(now);
+    }
+    if (s_mq.fd >= 0) {
+        mq_write(now);
+    }
+}
+
+void fleet_mqtt_tick(int64_t now)
+{
+    if (s_mq.started) {
+        switch (s_mq.state) {
+        case MQ_IDLE:
+            if (now >= s_mq.retry_us) {
+                mq_connect(now);
+            }
+            break;
+        case MQ_CONNECTING:
+        case MQ_CONNACK:
+            if (now - s_mq.since_us >= (int64_t)MQTT_NETWORK_TIMEOUT_MS * 1000) {
+                mq_fail(now);
+            }
+            break;
+        case MQ_UP:
+            if (now - s_mq.tx_us >= (int64_t)s_mq.keepalive_s * 1000000) {
+                uint8_t ping[2] = { 0xC0, 0 };
+                mq_queue(ping, sizeof(ping));
+            }
+            break;
+        }
+        for (int i = 0; i < MQTT_OUTBOX_SIZE; i++) {
+            outbox_t *e = &s_mq.outbox[i];
+            if (e->msg_id && now - e->sent_us >= (int64_t)MQTT_OUTBOX_EXPIRE_MS * 1000) {
+                outbox_free(e);
+            }
+        }
+    }
+
+    uplink_step();
+
+    mqtt_uplink_stats_t up;
+    mqtt_uplink_get_stats(&up);
+    s_st->mqtt_connects = up.connects;
+    s_st->mqtt_acked_recs = up.records_acked;
+    s_st->mqtt_resends = up.resends;
+    s_st->mqtt_lost_recs = up.lost;
+    s_st->mqtt_backlog = up.backlog;
+}
+
+bool fleet_mqtt_drain(void)
+{
+    mqtt_uplink_stats_t up;
+    mqtt_uplink_get_stats(&up);
+    if (up.backlog > 0) {
+        mqtt_uplink_flush();
+    }
+    return up.backlog == 0;
+}
@@ -0,0 +1,258 @@
+// File: tools/scale_fleet/fleet_node.c
+// ---------------------------------------------------------------------------
+// One simulated scale (a forked process; the firmware modules are singletons)
+//   - Weigh-in schedule → synthetic conversions (synth.h) → the firmware's
+//     hx711 + weight manager (replay.c), one conversion per period of wall
+//     time divided by --speed
+//   - Published records go where the hub sends them: every one to
+//     rest_api (fleet_http.c), locked ones to the weigh-in log and the
+//     MQTT uplink (fleet_mqtt.c)
+//   - Between conversions one poll loop serves both parts' sockets and
+//     runs their timers
+// ---------------------------------------------------------------------------
+
+#include "fleet.h"
+#include "replay.h"
+#include "synth.h"
+#include "resources.h"
+#include "mqtt_uplink.h"
+
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NODE_MAX_FDS        16
+
+/* -------------------------------- State --------------------------------- */
+
+static const fleet_opts_t *s_o;
+static fleet_stats_t s_st;
+static int           s_report_fd;
+static int64_t       s_next_report_us;
+static volatile sig_atomic_t s_stop;
+static synth_rng_t   s_rng;
+
+static trace_t       s_trace;
+static int64_t       s_t0_us;           // Wall time of conversion 0
+static time_t        s_t0_unix;
+
+int64_t fleet_wall_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void on_term(int sig)
+{
+    (void)sig;
+    s_stop = 1;
+}
+
+static void report(bool final)
+{
+    s_st.final = final;
+    // One write under PIPE_BUF: atomic with respect to the other scales
+    if (write(s_report_fd, &s_st, sizeof(s_st)) != (ssize_t)sizeof(s_st)) {
+        s_stop = 1;
+    }
+}
+
+/* ------------------------------ Host stubs ------------------------------- */
+
+// Shared by mqtt_uplink.c (rollups) and rest_api.c (/health): no heap model
+void res_heap_snapshot(res_heap_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+}
+
+// Nobody waits on a task here: the poll loop runs the uplink and streams
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+    return pdTRUE;
+}
+
+/* ------------------------------- Schedule -------------------------------- */
+
+// Adds one weigh-in starting at @p at_s; returns when the platform is empty
+static double add_weigh_in(double *load, double at_s, double grams, double stand_s)
+{
+    synth_weigh_in_t w;
+    synth_weigh_in(&w, &s_rng, grams, true);
+    if (stand_s > 0.0) {
+        w.stand_s = stand_s;
+    }
+    double rate = s_trace.rate_sps, end_s = at_s + synth_weigh_in_s(&w);
+    int first = (int)ceil(at_s * rate), last = (int)fmin(ceil(end_s * rate), s_trace.n);
+    for (int i = first < 0 ? 0 : first; i < last; i++) {
+        double since = i / rate - at_s;
+        load[i] += synth_load_g(&w, since);
+        if (since < w.on_s + w.stand_s) {
+            s_trace.truth_g[i] = (float)grams;
+        }
+    }
+    return end_s;
+}
+
+// Conversions for the whole run: the --script, or a household of 1-4
+// people stepping on at random (exponential gaps around --interval)
+static int build_trace(int index)
+{
+    const fleet_opts_t *o = s_o;
+    trace_t *t = &s_trace;
+    int32_t zero = 50000 + (int32_t)(synth_rand(&s_rng) * 150000);
+
+    snprintf(t->name, sizeof(t->name), "scale_%d", index);
+    t->rate_sps = (float)o->rate_sps;
+    t->cal = (calibration_t){ SYNTH_SLOPE, -SYNTH_SLOPE * zero };
+    t->n = (int)(o->duration_s * o->rate_sps);
+    t->raw = malloc(t->n * sizeof(*t->raw));
+    t->truth_g = calloc(t->n, sizeof(*t->truth_g));
+    double *load = calloc(t->n, sizeof(*load));
+    if (!t->raw || !t->truth_g || !load) {
+        return -1;
+    }
+
+    double offset = synth_rand(&s_rng) * o->stagger_s;
+    if (o->script_len > 0) {
+        for (int i = 0; i < o->script_len; i++) {
+            const fleet_weigh_in_t *s = &o->script[i];
+            add_weigh_in(load, offset + s->at_s, s->grams, s->stand_s);
+        }
+    } else {
+        double people[4];
+        int household = 1 + (int)(synth_rand(&s_rng) * 4);
+        for (int i = 0; i < household; i++) {
+            people[i] = 20000 + synth_rand(&s_rng) * 100000;
+        }
+        for (double at = offset; at < o->duration_s; ) {
+            double who = people[(int)(synth_rand(&s_rng) * household)];
+            double end = add_weigh_in(load, at, who + 300.0 * synth_normal(&s_rng), 0.0);
+            at = end + 3.0 - o->interval_s * log(1.0 - synth_rand(&s_rng));
+        }
+    }
+    for (int i = 0; i < t->n; i++) {
+        t->raw[i] = synth_raw(&s_rng, load[i], zero);
+    }
+    free(load);
+    return 0;
+}
+
+/* ------------------------------ Event loop ------------------------------- */
+
+// Serve sockets and timers until wall time @p until_us
+static void service(int64_t until_us)
+{
+    for (;;) {
+        int64_t now = fleet_wall_us();
+        int64_t wake = until_us;
+        if (s_o->broker_host) {
+            fleet_mqtt_tick(now);
+        }
+        int64_t next = fleet_http_tick(now);
+        if (next < wake) wake = next;
+        if (now >= s_next_report_us) {
+            report(false);
+            s_next_report_us = now + (int64_t)(s_o->report_s * 1e6);
+        }
+        if (s_next_report_us < wake) wake = s_next_report_us;
+        if (now >= until_us) {
+            return;
+        }
+
+        struct pollfd pfd[NODE_MAX_FDS];
+        int mq = s_o->broker_host ? fleet_mqtt_fds(pfd, &wake) : 0;
+        int http = fleet_http_fds(pfd + mq, NODE_MAX_FDS - mq);
+        int64_t wait = wake > now ? wake - now : 0;
+        struct timespec ts = { wait / 1000000, (wait % 1000000) * 1000 };
+        if (ppoll(pfd, mq + http, &ts, NULL) <= 0) {
+            continue;
+        }
+        now = fleet_wall_us();
+        if (mq) {
+            fleet_mqtt_io(&pfd[0], now);
+        }
+        fleet_http_io(pfd + mq, http, now);
+    }
+}
+
+/* ---------------------------- Replay hooks ------------------------------- */
+
+static bool on_sample(int sample, void *ctx)
+{
+    (void)ctx;
+    const float *truth = s_trace.truth_g;
+    if (truth[sample] > 0.0f && (sample == 0 || truth[sample - 1] != truth[sample])) {
+        s_st.weigh_ins++;
+    }
+    s_st.samples++;
+    int64_t due = s_t0_us + (int64_t)(sample / s_trace.rate_sps / s_o->speed * 1e6);
+    int64_t late = fleet_wall_us() - due;
+    if (late > (int64_t)s_st.lag_max_us) {
+        s_st.lag_max_us = late > UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+    }
+    service(due);
+    return !s_stop;
+}
+
+// The hub's part: number the record, then its HTTPS, store and uplink
+// subscribers
+static void on_record(const measurement_t *m, int sample, void *ctx)
+{
+    (void)ctx;
+    float truth = s_trace.truth_g[sample];
+    measurement_t rec = *m;
+    rec.seq = ++s_st.records;
+    rec.timestamp = s_t0_unix + (time_t)(sample / s_trace.rate_sps);
+    if (s_o->http_port_base) {
+        fleet_http_record(&rec);
+    }
+    if (m->kind == MEAS_KIND_LOCKED) {
+        s_st.locks++;
+        if (s_o->broker_host) {
+            fleet_mqtt_record(&rec);
+        }
+    } else if ((m->kind == MEAS_KIND_ADDED && truth == 0.0f) ||
+               (m->kind == MEAS_KIND_REMOVED && truth > 0.0f)) {
+        s_st.false_events++;
+    }
+}
+
+/* --------------------------------- Main ---------------------------------- */
+
+void fleet_node_main(const fleet_opts_t *o, int index, int report_fd)
+{
+    s_o = o;
+    s_report_fd = report_fd;
+    s_st.scale = index;
+    signal(SIGTERM, on_term);
+    signal(SIGINT, SIG_IGN);    // The coordinator turns ^C into SIGTERM
+    synth_seed(&s_rng, o->seed * 1000003u + index);
+
+    if (build_trace(index) != 0 || (o->broker_host && fleet_mqtt_init(o, index, &s_st) != 0) ||
+        (o->http_port_base && fleet_http_init(o->http_port_base + index, &s_st) != 0)) {
+        report(true);
+        _exit(1);
+    }
+
+    replay_set_hooks(&(replay_hooks_t){ .on_sample = on_sample, .on_record = on_record });
+    s_t0_us = fleet_wall_us();
+    s_t0_unix = time(NULL);
+    s_next_report_us = s_t0_us;
+    replay_run(&replay_default_build, &s_trace);
+
+    // Schedule over: flush what is left, wait up to one ack timeout for it
+    int64_t deadline = fleet_wall_us() + (int64_t)MQTT_UPLINK_ACK_TIMEOUT_MS * 1000;
+    while (o->broker_host && !s_stop && !fleet_mqtt_drain() && fleet_wall_us() < deadline) {
+        service(fleet_wall_us() + 100000);
+    }
+    report(true);
+    _exit(0);
+}
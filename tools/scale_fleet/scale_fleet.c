@@ -0,0 +1,454 @@
+// File: tools/scale_fleet/scale_fleet.c
+// ---------------------------------------------------------------------------
+// Simulated scale fleet for backend and client load tests
+//   - N scales, each a forked process running the firmware's hx711 and
+//     weight-manager code (tools/scale_tune/replay.c) in real time on its
+//     own weigh-in schedule: a random household, or a --script shared by
+//     all scales and staggered (--stagger 0 puts every scale in step)
+//   - Each scale runs the firmware's mqtt_uplink.c over a socket (batched
+//     QoS1 JSON on scale/<dev>/weighins, dev f1ee0000 + index) and serves
+//     rest_api.c's routes (/weight, /health, SSE /stream, ...) on
+//     127.0.0.1:<http-port + index>
+//   - Batching, window and timeouts are the MQTT_UPLINK_* values the tool
+//     is built with: make -C tools/scale_fleet UPLINK='-DMQTT_UPLINK_BATCH_MIN=4'
+//   - The coordinator merges the scales' counters: a line per --report
+//     interval, then throughput, PUBACK round trip and lock → PUBACK
+//     latency percentiles and error counts for the whole run
+//
+//   - --config NAME=VALUE sets scale_config fields on every scale, as
+//     POST /config would (e.g. values from tools/scale_tune)
+//
+// Script (one weigh-in per line, '#' comments):
+//   <start_s> <grams> [<stand_s>]
+//
+//   make -C tools/scale_fleet
+//   tools/scale_fleet/scale_fleet -n 200 --broker localhost:1883 --duration 600
+//   make -C tools/scale_fleet check      (fleet_check.c: loopback broker)
+// ---------------------------------------------------------------------------
+
+#include "fleet.h"
+#include "replay.h"
+#include "mqtt_uplink.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(fleet_stats_t) <= PIPE_BUF, "stats snapshot must be one atomic pipe write");
+
+static fleet_opts_t s_opt = {
+    .scales         = 100,
+    .duration_s     = 600.0,
+    .speed          = 1.0,
+    .interval_s     = 120.0,
+    .stagger_s      = -1.0,     // Default: one interval
+    .rate_sps       = 10.0,
+    .http_port_base = 18000,
+    .report_s       = 1.0,
+    .seed           = 1,
+};
+
+static scale_config_t s_cfg;                        // --config
+static fleet_stats_t s_last[FLEET_MAX_SCALES];      // Latest snapshot per scale
+static bool          s_done[FLEET_MAX_SCALES];
+static volatile sig_atomic_t s_interrupts;
+
+static double wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_sigint(int sig)
+{
+    (void)sig;
+    s_interrupts++;
+}
+
+/* ------------------------------ Histograms ------------------------------- */
+
+int fleet_hist_bucket(uint64_t us)
+{
+    if (us < 1) {
+        return 0;
+    }
+    int b = (int)(4.0 * log2((double)us));
+    return b >= FLEET_HIST_BUCKETS ? FLEET_HIST_BUCKETS - 1 : b;
+}
+
+double fleet_hist_upper_us(int bucket)
+{
+    return exp2((bucket + 1) / 4.0);
+}
+
+// Upper bound of the bucket holding quantile @p q, microseconds; -1 if empty
+static double hist_quantile(const uint32_t *h, double q)
+{
+    uint64_t total = 0, run = 0;
+    for (int b = 0; b < FLEET_HIST_BUCKETS; b++) {
+        total += h[b];
+    }
+    if (total == 0) {
+        return -1.0;
+    }
+    uint64_t want = (uint64_t)ceil(q * total);
+    for (int b = 0; b < FLEET_HIST_BUCKETS; b++) {
+        run += h[b];
+        if (run >= want && run > 0) {
+            return fleet_hist_upper_us(b);
+        }
+    }
+    return fleet_hist_upper_us(FLEET_HIST_BUCKETS - 1);
+}
+
+static const char *fmt_us(char *buf, size_t len, double us)
+{
+    if (us < 0) snprintf(buf, len, "-");
+    else if (us < 1000) snprintf(buf, len, "%.0fus", us);
+    else if (us < 1e6) snprintf(buf, len, "%.1fms", us / 1e3);
+    else snprintf(buf, len, "%.2fs", us / 1e6);
+    return buf;
+}
+
+/* ------------------------------ Aggregation ------------------------------ */
+
+// Counter fields of fleet_stats_t summed over the fleet (lag: maximum)
+static void sum_stats(fleet_stats_t *sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    for (int i = 0; i < s_opt.scales; i++) {
+        const fleet_stats_t *s = &s_last[i];
+        sum->samples += s->samples;
+        sum->weigh_ins += s->weigh_ins;
+        sum->locks += s->locks;
+        sum->false_events += s->false_events;
+        sum->records += s->records;
+        sum->mqtt_connects += s->mqtt_connects;
+        sum->mqtt_failures += s->mqtt_failures;
+        sum->mqtt_msgs += s->mqtt_msgs;
+        sum->mqtt_acked_msgs += s->mqtt_acked_msgs;
+        sum->mqtt_acked_recs += s->mqtt_acked_recs;
+        sum->mqtt_resent_recs += s->mqtt_resent_recs;
+        sum->mqtt_resends += s->mqtt_resends;
+        sum->mqtt_lost_recs += s->mqtt_lost_recs;
+        sum->mqtt_backlog += s->mqtt_backlog;
+        sum->http_requests += s->http_requests;
+        sum->http_errors += s->http_errors;
+        sum->http_refused += s->http_refused;
+        sum->sse_open += s->sse_open;
+        sum->sse_events += s->sse_events;
+        sum->sse_dropped += s->sse_dropped;
+        if (s->lag_max_us > sum->lag_max_us) {
+            sum->lag_max_us = s->lag_max_us;
+        }
+        for (int b = 0; b < FLEET_HIST_BUCKETS; b++) {
+            sum->rtt_hist[b] += s->rtt_hist[b];
+            sum->e2e_hist[b] += s->e2e_hist[b];
+        }
+    }
+}
+
+static void report_interval(double t, const fleet_stats_t *now, const fleet_stats_t *prev,
+                            double dt, int running)
+{
+    uint32_t rtt[FLEET_HIST_BUCKETS];
+    for (int b = 0; b < FLEET_HIST_BUCKETS; b++) {
+        rtt[b] = now->rtt_hist[b] - prev->rtt_hist[b];
+    }
+    char p50[16], p99[16], lag[16];
+    printf("%7.1f s  up %4d  weigh-ins %5u  locks %5u  acked %7.1f rec/s %6.1f msg/s"
+           "  rtt p50 %7s p99 %7s  http %7.1f/s  sse %7.1f ev/s  errors %u  lag %s\n",
+           t, running, now->weigh_ins, now->locks,
+           (now->mqtt_acked_recs - prev->mqtt_acked_recs) / dt,
+           (now->mqtt_acked_msgs - prev->mqtt_acked_msgs) / dt,
+           fmt_us(p50, sizeof(p50), hist_quantile(rtt, 0.50)),
+           fmt_us(p99, sizeof(p99), hist_quantile(rtt, 0.99)),
+           (now->http_requests - prev->http_requests) / dt,
+           (now->sse_events - prev->sse_events) / dt,
+           now->mqtt_failures + now->http_errors + now->http_refused + now->sse_dropped,
+           fmt_us(lag, sizeof(lag), now->lag_max_us));
+    fflush(stdout);
+}
+
+static void print_latency(const char *label, const uint32_t *h)
+{
+    char a[16], b[16], c[16], d[16];
+    int top = -1;
+    for (int i = 0; i < FLEET_HIST_BUCKETS; i++) {
+        if (h[i]) top = i;
+    }
+    printf("%-13s p50 %s  p95 %s  p99 %s  max %s\n", label,
+           fmt_us(a, sizeof(a), hist_quantile(h, 0.50)), fmt_us(b, sizeof(b), hist_quantile(h, 0.95)),
+           fmt_us(c, sizeof(c), hist_quantile(h, 0.99)),
+           fmt_us(d, sizeof(d), top < 0 ? -1.0 : fleet_hist_upper_us(top)));
+}
+
+static void report_final(const fleet_stats_t *s, double wall)
+{
+    double sim = s->samples / s_opt.rate_sps;
+    char lag[16];
+    printf("\nfleet: %d scales, %.0f s simulated each at %gx, %.1f s wall\n",
+           s_opt.scales, sim / s_opt.scales, s_opt.speed, wall);
+    printf("%-13s %u started, %u locked (%.1f %%), %u false ADDED/REMOVED\n", "weigh-ins",
+           s->weigh_ins, s->locks, s->weigh_ins ? 100.0 * s->locks / s->weigh_ins : 0.0,
+           s->false_events);
+    printf("%-13s %u conversions (%.0f/s), %u records published (%.0f/s)\n", "pipeline",
+           s->samples, s->samples / wall, s->records, s->records / wall);
+    if (s_opt.broker_host) {
+        printf("%-13s %u records acked in %u of %u messages (%.2f rec/s), %u resent, "
+               "%u lost, %u unacked at exit\n", "mqtt", s->mqtt_acked_recs, s->mqtt_acked_msgs,
+               s->mqtt_msgs, s->mqtt_acked_recs / wall, s->mqtt_resent_recs, s->mqtt_lost_recs,
+               s->mqtt_backlog);
+        printf("%-13s %u connects, %u failures (refused, reset, CONNACK error, timeout), "
+               "%u ack timeouts\n", "", s->mqtt_connects, s->mqtt_failures, s->mqtt_resends);
+        print_latency("puback rtt", s->rtt_hist);
+        print_latency("lock->puback", s->e2e_hist);
+    }
+    if (s_opt.http_port_base) {
+        printf("%-13s %u requests (%.1f/s), %u errors, %u refused; %u streams, %u events, "
+               "%u dropped\n", "http", s->http_requests, s->http_requests / wall, s->http_errors,
+               s->http_refused, s->sse_open, s->sse_events, s->sse_dropped);
+    }
+    printf("%-13s worst conversion %s late (period %.0f ms / speed)\n", "pacing",
+           fmt_us(lag, sizeof(lag), s->lag_max_us), 1000.0 / s_opt.rate_sps);
+}
+
+/* -------------------------------- Options -------------------------------- */
+
+static int load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        fleet_weigh_in_t w = { 0 };
+        int n = sscanf(line, "%lf %lf %lf", &w.at_s, &w.grams, &w.stand_s);
+        if (n <= 0) {
+            continue;
+        }
+        if (n < 2 || w.at_s < 0 || w.grams <= 0 || w.stand_s < 0 ||
+            s_opt.script_len == FLEET_MAX_SCRIPT) {
+            fprintf(stderr, "%s:%d: expected <start_s> <grams> [<stand_s>] (at most %d)\n",
+                    path, lineno, FLEET_MAX_SCRIPT);
+            fclose(f);
+            return -1;
+        }
+        s_opt.script[s_opt.script_len++] = w;
+    }
+    fclose(f);
+    return 0;
+}
+
+static void set_config(const char *arg)
+{
+    char name[48];
+    const char *eq = strchr(arg, '=');
+    if (!eq || eq - arg >= (ptrdiff_t)sizeof(name)) {
+        fprintf(stderr, "--config %s: expected NAME=VALUE\n", arg);
+        exit(2);
+    }
+    memcpy(name, arg, eq - arg);
+    name[eq - arg] = '\0';
+    if (!scale_config_set_field(&s_cfg, name, atof(eq + 1))) {
+        fprintf(stderr, "--config %s: unknown field; one of:", arg);
+        for (size_t i = 0; i < scale_config_field_count; i++) {
+            fprintf(stderr, " %s", scale_config_fields[i].name);
+        }
+        fprintf(stderr, "\n");
+        exit(2);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: scale_fleet [options]\n"
+        "  -n N               scales (%d, at most %d)\n"
+        "  --duration S       simulated seconds per scale (%.0f)\n"
+        "  --speed X          simulated seconds per wall second (%g)\n"
+        "  --interval S       mean gap between weigh-ins, random households (%.0f)\n"
+        "  --script FILE      weigh-ins for every scale instead: <start_s> <grams> [<stand_s>]\n"
+        "  --stagger S        scale start offsets drawn from [0, S) (one interval; 0: in step)\n"
+        "  --rate SPS         HX711 conversion rate (%.0f)\n"
+        "  --config NAME=V    scale_config field for every scale (repeatable)\n"
+        "  --broker HOST[:P]  MQTT broker, plain TCP (none)\n"
+        "  --http-port P      first scale's HTTP port, 0: no HTTP (%d)\n"
+        "  --report S         seconds between progress lines (%g)\n"
+        "  --seed N\n"
+        "uplink (build time): %d records per message, flush at %d or %d s (simulated),\n"
+        "%d messages in flight, ack timeout %d ms (simulated), keepalive %d s\n",
+        s_opt.scales, FLEET_MAX_SCALES, s_opt.duration_s, s_opt.speed, s_opt.interval_s,
+        s_opt.rate_sps, s_opt.http_port_base, s_opt.report_s, MQTT_UPLINK_BATCH_RECORDS,
+        MQTT_UPLINK_BATCH_MIN, MQTT_UPLINK_MAX_AGE_S, MQTT_UPLINK_INFLIGHT,
+        MQTT_UPLINK_ACK_TIMEOUT_MS, MQTT_UPLINK_KEEPALIVE_S);
+    exit(2);
+}
+
+static void parse_broker(char *v)
+{
+    if (!strcmp(v, "none")) {
+        s_opt.broker_host = NULL;
+        return;
+    }
+    s_opt.broker_port = 1883;
+    if (!strncmp(v, "mqtt://", 7)) {
+        v += 7;
+    }
+    char *colon = strrchr(v, ':');
+    if (colon && !strchr(colon, ']')) {
+        *colon = '\0';
+        s_opt.broker_port = atoi(colon + 1);
+    }
+    s_opt.broker_host = v;
+}
+
+/* --------------------------------- Main ---------------------------------- */
+
+int main(int argc, char **argv)
+{
+    s_cfg = *scale_config_defaults();
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!v) usage();
+        i++;
+        if (!strcmp(a, "-n")) s_opt.scales = atoi(v);
+        else if (!strcmp(a, "--duration")) s_opt.duration_s = atof(v);
+        else if (!strcmp(a, "--speed")) s_opt.speed = atof(v);
+        else if (!strcmp(a, "--interval")) s_opt.interval_s = atof(v);
+        else if (!strcmp(a, "--script")) { if (load_script(v) != 0) return 1; }
+        else if (!strcmp(a, "--stagger")) s_opt.stagger_s = atof(v);
+        else if (!strcmp(a, "--rate")) s_opt.rate_sps = atof(v);
+        else if (!strcmp(a, "--config")) set_config(v);
+        else if (!strcmp(a, "--broker")) parse_broker(v);
+        else if (!strcmp(a, "--http-port")) s_opt.http_port_base = atoi(v);
+        else if (!strcmp(a, "--report")) s_opt.report_s = atof(v);
+        else if (!strcmp(a, "--seed")) s_opt.seed = strtoull(v, NULL, 0);
+        else usage();
+    }
+    if (s_opt.stagger_s < 0) {
+        s_opt.stagger_s = s_opt.interval_s;
+    }
+    if (s_opt.scales < 1 || s_opt.scales > FLEET_MAX_SCALES || s_opt.duration_s <= 0 ||
+        s_opt.speed <= 0 || s_opt.interval_s <= 0 || s_opt.rate_sps <= 0 || s_opt.report_s <= 0 ||
+        (s_opt.http_port_base && s_opt.http_port_base + s_opt.scales > 65536)) {
+        usage();
+    }
+    const char *why = NULL;
+    if (replay_init() != ESP_OK) {
+        fprintf(stderr, "replay setup failed\n");
+        return 1;
+    }
+    if (scale_config_publish(&s_cfg, false, &why) != ESP_OK) {
+        fprintf(stderr, "--config: %s\n", why ? why : "rejected");
+        return 2;
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_sigint);
+    signal(SIGTERM, on_sigint);
+
+    static pid_t pids[FLEET_MAX_SCALES];
+    pid_t parent = getpid();
+    int started = 0;
+    for (; started < s_opt.scales; started++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() != parent) _exit(1);
+            fleet_node_main(&s_opt, started, fds[1]);
+        }
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        pids[started] = pid;
+        s_last[started].scale = started;
+    }
+    close(fds[1]);
+    if (started < s_opt.scales) {
+        for (int i = 0; i < started; i++) kill(pids[i], SIGTERM);
+    }
+    printf("%d scales, %.0f s each at %gx, broker %s:%d, http %s\n", started, s_opt.duration_s,
+           s_opt.speed, s_opt.broker_host ? s_opt.broker_host : "none",
+           s_opt.broker_host ? s_opt.broker_port : 0,
+           s_opt.http_port_base ? "127.0.0.1" : "off");
+    if (s_opt.http_port_base) {
+        printf("http ports %d-%d\n", s_opt.http_port_base, s_opt.http_port_base + started - 1);
+    }
+
+    double t0 = wall_s(), next_report = t0 + s_opt.report_s, last_t = t0;
+    fleet_stats_t prev = { 0 }, sum;
+    int finished = 0, signalled = 0;
+    static uint8_t buf[16 * sizeof(fleet_stats_t)];
+    size_t have = 0;
+    for (;;) {
+        if (s_interrupts > signalled) {
+            signalled = s_interrupts;
+            for (int i = 0; i < started; i++) {
+                if (!s_done[i]) kill(pids[i], signalled > 1 ? SIGKILL : SIGTERM);
+            }
+        }
+        double now = wall_s();
+        if (now >= next_report) {
+            sum_stats(&sum);
+            report_interval(now - t0, &sum, &prev, now - last_t, started - finished);
+            prev = sum;
+            last_t = now;
+            next_report += s_opt.report_s;
+            if (next_report < now) next_report = now + s_opt.report_s;
+        }
+        struct pollfd pfd = { fds[0], POLLIN, 0 };
+        int rc = poll(&pfd, 1, (int)ceil((next_report - now) * 1000));
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) continue;
+        ssize_t n = read(fds[0], buf + have, sizeof(buf) - have);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;                  // Every scale has closed its end
+        have += n;
+        size_t used = 0;
+        for (; have - used >= sizeof(fleet_stats_t); used += sizeof(fleet_stats_t)) {
+            fleet_stats_t s;
+            memcpy(&s, buf + used, sizeof(s));
+            if (s.scale < (uint32_t)started) {
+                s_last[s.scale] = s;
+                if (s.final && !s_done[s.scale]) {
+                    s_done[s.scale] = true;
+                    finished++;
+                }
+            }
+        }
+        memmove(buf, buf + used, have - used);
+        have -= used;
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    sum_stats(&sum);
+    report_final(&sum, wall_s() - t0);
+    return finished == started ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// File: tools/scale_tune/host/host_idf.h
+// ---------------------------------------------------------------------------
+// Just enough of ESP-IDF / FreeRTOS to compile the sampling pipeline on a
+// host. Every header under host/ includes this one; the functions are
+// implemented by replay.c. Single-threaded: locks and critical sections are
+// no-ops, time is the replay clock.
+// ---------------------------------------------------------------------------
+#ifndef HOST_IDF_H
+#define HOST_IDF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* esp_err.h */
+typedef int esp_err_t;
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NO_MEM              0x101
+#define ESP_ERR_INVALID_ARG         0x102
+#define ESP_ERR_INVALID_STATE       0x103
+#define ESP_ERR_INVALID_SIZE        0x104
+#define ESP_ERR_NOT_FOUND           0x105
+#define ESP_ERR_NOT_SUPPORTED       0x106
+#define ESP_ERR_TIMEOUT             0x107
+#define ESP_ERR_INVALID_RESPONSE    0x108
+const char *esp_err_to_name(esp_err_t code);
+
+/* FreeRTOS */
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void    *QueueHandle_t;
+typedef void    *SemaphoreHandle_t;
+typedef void    *TaskHandle_t;
+typedef void   (*TaskFunction_t)(void *);
+typedef struct { int reserved[20]; } StaticSemaphore_t;
+typedef struct { int owner; int count; } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0, 0 }
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+#define portTICK_PERIOD_MS              1
+#define portMAX_DELAY                   0xffffffffu
+#define pdTRUE                          1
+#define pdFALSE                         0
+#define configASSERT(x)                 ((void)(x))
+#define taskENTER_CRITICAL(m)           ((void)(m))
+#define taskEXIT_CRITICAL(m)            ((void)(m))
+#define portYIELD_FROM_ISR(x)           ((void)(x))
+#define IRAM_ATTR
+
+void         vTaskDelay(TickType_t ticks);
+TickType_t   xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+uint32_t     ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+void         vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+BaseType_t   xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t   xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf);
+BaseType_t   xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t   xSemaphoreGive(SemaphoreHandle_t s);
+void         vSemaphoreDelete(SemaphoreHandle_t s);
+
+/* driver/gpio.h */
+typedef int gpio_num_t;
+typedef enum { GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_ONLY, GPIO_PULLDOWN_ONLY, GPIO_FLOATING } gpio_pull_mode_t;
+typedef enum { GPIO_INTR_DISABLE, GPIO_INTR_LOW_LEVEL = 4 } gpio_int_type_t;
+typedef void (*gpio_isr_t)(void *);
+#define GPIO_NUM_4  4
+#define GPIO_NUM_22 22
+#define ESP_INTR_FLAG_IRAM  (1 << 10)
+
+esp_err_t gpio_reset_pin(gpio_num_t pin);
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode);
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t mode);
+int       gpio_get_level(gpio_num_t pin);
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level);
+esp_err_t gpio_hold_dis(gpio_num_t pin);
+esp_err_t gpio_install_isr_service(int flags);
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t fn, void *arg);
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type);
+esp_err_t gpio_intr_enable(gpio_num_t pin);
+esp_err_t gpio_intr_disable(gpio_num_t pin);
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type);
+esp_err_t gpio_wakeup_disable(gpio_num_t pin);
+
+/* rom/ets_sys.h, esp_timer.h */
+void    ets_delay_us(uint32_t us);
+int64_t esp_timer_get_time(void);
+
+/* esp_log.h: the tuner runs millions of samples, logging is compiled out */
+uint32_t esp_log_timestamp(void);
+#define ESP_LOGE(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGW(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGI(tag, fmt, ...) ((void)(tag))
+#define ESP_LOGD(tag, fmt, ...) ((void)(tag))
+
+/* nvs.h */
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h);
+void      nvs_close(nvs_handle_t h);
+esp_err_t nvs_commit(nvs_handle_t h);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len);
+
+/* esp_wifi_types.h (app_connection_manager.h) */
+typedef enum { WIFI_AUTH_OPEN = 0 } wifi_auth_mode_t;
+
+#endif // HOST_IDF_H
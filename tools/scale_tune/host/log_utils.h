@@ -0,0 +1,4 @@
+// Host build: LOG_ROW compiled out (see host_idf.h)
+#pragma once
+#include "host_idf.h"
+#define LOG_ROW(comp, fmt, ...) ((void)(comp))
@@ -0,0 +1,277 @@
+// File: tools/scale_tune/replay.c
+// ---------------------------------------------------------------------------
+// Firmware pipeline on recorded conversions
+//   - hx711.c and weight_manager.c compiled in, so their module state can
+//     be reset between traces
+//   - Simulated HX711: always ready, shifts out the next trace conversion
+//   - Replay clock: one conversion period per sample (esp_timer, ticks,
+//     clock_map all read it)
+//   - weight_manager_task runs as-is; the end of a trace unwinds it
+//   - Published records scored against the trace's ground truth, or
+//     handed to the live hooks (scale_fleet)
+// ---------------------------------------------------------------------------
+
+#include "replay.h"
+
+#include <setjmp.h>
+#include <math.h>
+#include <string.h>
+
+#include "hx711.c"
+#include "weight_manager.c"
+
+#define REPLAY_DOUT         GPIO_NUM_4
+#define REPLAY_SCK          GPIO_NUM_22
+#define REPLAY_MAX_EVENTS   256     // Per trace; LIVE records are not kept
+
+typedef struct {
+    int     sample;             // Conversion that produced it
+    uint8_t kind;
+    float   weight_g;
+} replay_event_t;
+
+static jmp_buf         s_end;           // Unwinds the weight-manager task
+static const trace_t  *s_trace;
+static int             s_next;          // Next conversion to clock out
+static int             s_cur;           // Conversion being processed
+static int64_t         s_base_us;       // Replay time of sample 0
+static int64_t         s_now_us;
+static int             s_sck_edges;     // Rising SCK edges in this read
+static uint32_t        s_word;
+static hx711_t         s_scale;
+static replay_event_t  s_events[REPLAY_MAX_EVENTS];
+static int             s_event_count;
+static replay_hooks_t  s_hooks;
+
+const tune_build_t replay_default_build = {
+    .model             = KALMAN_MODEL_CONST_VELOCITY,
+    .ma_window         = 8,
+    .kf_q_init         = 0.5f,
+    .kf_r_init         = 1.0f,
+    .kf_cv_accel_noise = 1.0e3f,
+    .kf_cv_meas_noise  = 2500.0f,
+};
+
+/* --------------------------- Simulated HX711 --------------------------- */
+
+static int64_t sample_period_us(void)
+{
+    return (int64_t)(1e6f / s_trace->rate_sps);
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    if (pin != REPLAY_DOUT || s_sck_edges < 1 || s_sck_edges > 24) {
+        return 0;               // Conversion always ready
+    }
+    return (s_word >> (24 - s_sck_edges)) & 1;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (pin != REPLAY_SCK) {
+        return ESP_OK;
+    }
+    if (level) {
+        if (s_sck_edges == 0) {
+            if (s_next >= s_trace->n ||
+                (s_hooks.on_sample && !s_hooks.on_sample(s_next, s_hooks.ctx))) {
+                longjmp(s_end, 1);
+            }
+            s_cur = s_next++;
+            s_now_us = s_base_us + s_cur * sample_period_us();
+            s_word = (uint32_t)s_trace->raw[s_cur] & 0xFFFFFF;
+        }
+        s_sck_edges++;
+    } else if (s_sck_edges >= 24 + (int)s_scale.gain) {
+        s_sck_edges = 0;        // Gain pulses done
+    }
+    return ESP_OK;
+}
+
+/* ------------------------- Weight-manager glue -------------------------- */
+
+// The HX711 task's job: one filtered conversion per queue item
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    (void)q;
+    (void)wait;
+    float w;
+    do {
+        if (s_next >= s_trace->n) {
+            longjmp(s_end, 1);
+        }
+        w = hx711_read_filtered(&s_scale);
+    } while (isnan(w));
+    memcpy(item, &w, sizeof(w));
+    return pdTRUE;
+}
+
+bool app_connection_manager_publish(const measurement_t *m)
+{
+    if (s_hooks.on_record) {
+        s_hooks.on_record(m, s_cur, s_hooks.ctx);
+    }
+    if (m->kind != MEAS_KIND_LIVE && s_event_count < REPLAY_MAX_EVENTS) {
+        s_events[s_event_count++] = (replay_event_t){
+            .sample = s_cur, .kind = m->kind, .weight_g = m->weight_g,
+        };
+    }
+    return true;
+}
+
+/* ------------------------------- Scoring -------------------------------- */
+
+static void score_trace(const trace_t *t, tune_metrics_t *m)
+{
+    int e = 0;
+    for (int start = 0, end; start < t->n; start = end) {
+        float truth = t->truth_g[start];
+        for (end = start + 1; end < t->n && t->truth_g[end] == truth; end++) {
+        }
+        bool loaded = truth > 0.0f;
+        bool locked = false;
+        if (loaded) {
+            m->weigh_ins++;
+        }
+        for (; e < s_event_count && s_events[e].sample < end; e++) {
+            const replay_event_t *ev = &s_events[e];
+            if (!loaded) {
+                m->false_events += ev->kind == MEAS_KIND_ADDED;
+            } else if (ev->kind == MEAS_KIND_REMOVED) {
+                m->false_events++;
+            } else if (ev->kind == MEAS_KIND_LOCKED && !locked) {
+                locked = true;
+                double s = (ev->sample - start) / t->rate_sps;
+                double err = fabs(ev->weight_g - truth);
+                m->locked++;
+                m->lock_s_sum += s;
+                m->lock_s_max = fmax(m->lock_s_max, s);
+                m->err_g_sum += err;
+                m->err_g_max = fmax(m->err_g_max, err);
+            }
+        }
+    }
+}
+
+/* -------------------------------- Replay -------------------------------- */
+
+esp_err_t replay_init(void)
+{
+    esp_err_t err = scale_config_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+    s_cfg_reader = scale_config_register_reader("hx711");
+    wm_cfg_reader = scale_config_register_reader("weight_manager");
+    return (s_cfg_reader < 0 || wm_cfg_reader < 0) ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+void replay_set_hooks(const replay_hooks_t *hooks)
+{
+    s_hooks = hooks ? *hooks : (replay_hooks_t){ 0 };
+}
+
+void replay_run(const tune_build_t *b, const trace_t *t)
+{
+    s_trace = t;
+    s_next = 0;
+    s_cur = 0;
+    s_sck_edges = 0;
+    s_event_count = 0;
+    s_base_us = s_now_us + 10 * sample_period_us();
+
+    // Sensor health starts over, as after a boot
+    s_health = HX711_HEALTH_OK;
+    s_timeout_run = s_good_run = s_same_run = 0;
+    s_prev_raw = 0;
+    s_reseed = false;
+
+    // Same order as app_main: init (primes on the first conversion),
+    // calibration, then the two-state model if selected
+    if (setjmp(s_end)) {
+        return;                 // Trace shorter than the prime
+    }
+    hx711_init(&s_scale, REPLAY_DOUT, REPLAY_SCK, HX711_GAIN_128,
+               b->ma_window, true, b->kf_q_init, b->kf_r_init);
+    hx711_set_calibration(&s_scale, &t->cal);
+    if (b->model == KALMAN_MODEL_CONST_VELOCITY) {
+        hx711_set_kalman_model(&s_scale, b->model, b->kf_cv_accel_noise, b->kf_cv_meas_noise);
+    }
+
+    current_state = WM_STATE_NO_WEIGHT;
+    wm_last_weight = 0.0f;
+    wm_calib = (calibration_t *)&t->cal;
+    reset_stable_lock();
+    if (!setjmp(s_end)) {
+        weight_manager_task(NULL);
+    }
+}
+
+esp_err_t replay_eval(const tune_params_t *p, const trace_t *traces, int count,
+                      tune_metrics_t *out, const char **why)
+{
+    memset(out, 0, sizeof(*out));
+    esp_err_t err = scale_config_publish(&p->cfg, false, why);
+    if (err != ESP_OK) {
+        return err;
+    }
+    for (int i = 0; i < count; i++) {
+        replay_run(&p->build, &traces[i]);
+        score_trace(&traces[i], out);
+    }
+    return ESP_OK;
+}
+
+/* ------------------------------ Host stubs ------------------------------ */
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+uint32_t esp_log_timestamp(void) { return (uint32_t)(s_now_us / 1000); }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(s_now_us / 1000); }
+int64_t clock_map_mono_us(void) { return s_now_us; }
+time_t clock_map_to_wall(int64_t mono_us) { (void)mono_us; return 0; }
+void ets_delay_us(uint32_t us) { (void)us; }
+void vTaskDelay(TickType_t ticks) { (void)ticks; }
+const char *esp_err_to_name(esp_err_t code) { (void)code; return "error"; }
+
+void power_governor_set_measuring(bool measuring) { (void)measuring; }
+uint8_t user_profiles_identify(float weight_g) { (void)weight_g; return USER_ID_UNKNOWN; }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) { return NULL; }
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { (void)clear; (void)wait; return 0; }
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) { (void)task; (void)woken; }
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) { (void)q; (void)item; (void)wait; return pdTRUE; }
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { (void)s; (void)wait; return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { (void)s; return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t s) { (void)s; }
+
+TaskHandle_t res_task_start(res_task_t id, int instance, TaskFunction_t fn, const char *name, void *arg)
+{
+    (void)id; (void)instance; (void)fn; (void)name; (void)arg;
+    return NULL;
+}
+QueueHandle_t res_queue_create(res_queue_t id, int instance, UBaseType_t length, UBaseType_t item_size)
+{
+    (void)id; (void)instance; (void)length; (void)item_size;
+    return NULL;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin) { (void)pin; return ESP_OK; }
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) { (void)pin; (void)mode; return ESP_OK; }
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t mode) { (void)pin; (void)mode; return ESP_OK; }
+esp_err_t gpio_hold_dis(gpio_num_t pin) { (void)pin; return ESP_OK; }
+esp_err_t gpio_install_isr_service(int flags) { (void)flags; return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t fn, void *arg) { (void)pin; (void)fn; (void)arg; return ESP_OK; }
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) { (void)pin; (void)type; return ESP_OK; }
+esp_err_t gpio_intr_enable(gpio_num_t pin) { (void)pin; return ESP_OK; }
+esp_err_t gpio_intr_disable(gpio_num_t pin) { (void)pin; return ESP_OK; }
+esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type) { (void)pin; (void)type; return ESP_OK; }
+esp_err_t gpio_wakeup_disable(gpio_num_t pin) { (void)pin; return ESP_OK; }
+
+// No NVS on the host: scale_config_init() keeps the defaults
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *h) { (void)ns; (void)mode; (void)h; return ESP_ERR_NOT_FOUND; }
+void nvs_close(nvs_handle_t h) { (void)h; }
+esp_err_t nvs_commit(nvs_handle_t h) { (void)h; return ESP_OK; }
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len) { (void)h; (void)key; (void)out; (void)len; return ESP_ERR_NOT_FOUND; }
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len) { (void)h; (void)key; (void)val; (void)len; return ESP_ERR_NOT_FOUND; }
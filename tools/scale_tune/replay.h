@@ -0,0 +1,97 @@
+// File: tools/scale_tune/replay.h
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "calibration.h"
+#include "kalman_filter.h"
+#include "scale_config.h"
+#include "app_connection_manager.h"
+
+/*
+ * Trace replay through the firmware's own sampling pipeline.
+ *
+ * replay.c compiles hx711.c and weight_manager.c in, clocks the recorded
+ * conversions out of a simulated HX711 (the real bit-banged read, health
+ * checks included) and runs the real weight-manager task on them, with
+ * time taken from the trace. The published ADDED / LOCKED / REMOVED
+ * records are compared with the trace's ground truth.
+ *
+ * One process replays one candidate at a time (the firmware modules keep
+ * their state in statics); scale_tune forks workers for parallelism and
+ * scale_fleet forks one process per simulated scale.
+ */
+
+// Conversions with the known load on the platform
+typedef struct {
+    char          name[64];
+    int32_t      *raw;          // Conversions, in order
+    float        *truth_g;      // Load on the platform at each one
+    int           n;
+    float         rate_sps;     // Conversion rate (10 or 80)
+    calibration_t cal;          // grams = slope * raw + intercept
+} trace_t;
+
+// Compile-time filter constants (main.c)
+typedef struct {
+    kalman_model_t model;       // KF_MODEL
+    int32_t        ma_window;   // MA_WINDOW (random-walk model only)
+    float          kf_q_init;   // KF_Q_INIT
+    float          kf_r_init;   // KF_R_INIT
+    float          kf_cv_accel_noise;   // KF_CV_ACCEL_NOISE (two-state model)
+    float          kf_cv_meas_noise;    // KF_CV_MEAS_NOISE
+} tune_build_t;
+
+// main.c's constants as shipped (KF_MODEL, MA_WINDOW, ...)
+extern const tune_build_t replay_default_build;
+
+typedef struct {
+    tune_build_t   build;
+    scale_config_t cfg;         // Runtime configuration (NVS / POST /config)
+} tune_params_t;
+
+// Outcome over a corpus; a weigh-in is a run of samples with load > 0
+typedef struct {
+    int    weigh_ins;
+    int    locked;              // Weigh-ins that produced a lock
+    int    false_events;        // ADDED with nothing on, REMOVED while loaded
+    double lock_s_sum;          // Load placed → first lock, locked weigh-ins
+    double lock_s_max;
+    double err_g_sum;           // |locked weight − truth|, locked weigh-ins
+    double err_g_max;
+} tune_metrics_t;
+
+/** @brief Set up the configuration store and readers; once per process. */
+esp_err_t replay_init(void);
+
+/**
+ * @brief Replay every trace with parameters @p p and accumulate the outcome.
+ * @param why  Receives the validation message when @p p is rejected
+ * @return ESP_ERR_INVALID_ARG when scale_config rejects p->cfg
+ */
+esp_err_t replay_eval(const tune_params_t *p, const trace_t *traces, int count,
+                      tune_metrics_t *out, const char **why);
+
+// Live replay (scale_fleet); both run on the replay task's stack
+typedef struct {
+    // Sample about to be clocked out of the simulated HX711; false ends
+    // the replay there
+    bool (*on_sample)(int sample, void *ctx);
+    // Every record the weight manager publishes, LIVE ones included
+    void (*on_record)(const measurement_t *m, int sample, void *ctx);
+    void *ctx;
+} replay_hooks_t;
+
+/** @brief Install (or clear, with NULL) the live-replay hooks. */
+void replay_set_hooks(const replay_hooks_t *hooks);
+
+/**
+ * @brief Run one trace through hx711 + weight manager with the current
+ *        configuration; returns when the trace is exhausted or a hook
+ *        stops it.
+ */
+void replay_run(const tune_build_t *b, const trace_t *t);
+
+#endif // REPLAY_H
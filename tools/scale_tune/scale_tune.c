@@ -0,0 +1,772 @@
+// File: tools/scale_tune/scale_tune.c
+// ---------------------------------------------------------------------------
+// Offline filter tuning over recorded HX711 traces
+//   - Replays every candidate through the firmware's own pipeline (replay.c)
+//   - Objective per weigh-in: seconds from load to lock + lock error
+//     (--err-scale grams count as one second) + penalties for missed
+//     locks and false ADDED / REMOVED records
+//   - Random search refined by cross-entropy rounds: sample, keep the
+//     best few percent, resample around them with a shrinking spread
+//   - One forked worker per core; each replays its share of a round
+//   - Writes main.c constants (header), scale_config fields (JSON for
+//     POST /config, NVS blob + nvs_partition_gen CSV)
+//
+// Traces (one file per recording, any of these lines, others ignored):
+//   cal <slope> <intercept>    grams = slope * raw + intercept; the boot log
+//                              line "Calibration: slope=.. intercept=.." works
+//   rate <sps>                 conversion rate, default 10
+//   load <grams> | load ?      from the next conversion on this load is on
+//                              the platform (0: empty); "?" takes the median
+//                              of the segment's second half
+//   <raw> | ... TRACE <raw>    one conversion; TRACE lines come from a
+//                              firmware built with HX711_TRACE_RAW=1
+//
+//   make -C tools/scale_tune
+//   tools/scale_tune/scale_tune traces/ -o main     (or --synth 32 to try it)
+// ---------------------------------------------------------------------------
+
+#include "replay.h"
+#include "synth.h"
+#include "hx711.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define MAX_TRACES      512
+#define MAX_WORKERS     256
+
+/* ------------------------------ Parameters ------------------------------ */
+
+typedef enum { P_F32, P_I32, P_U8 } ptype_t;
+
+#define M_RW    (1u << KALMAN_MODEL_RANDOM_WALK)
+#define M_CV    (1u << KALMAN_MODEL_CONST_VELOCITY)
+#define M_ANY   (M_RW | M_CV)
+
+typedef struct {
+    const char *name;           // main.c define or scale_config field
+    bool        build;          // Compile-time constant (header output)
+    ptype_t     type;
+    size_t      offset;         // Into tune_params_t
+    double      lo, hi;         // Search range
+    bool        log;            // Searched on a log scale
+    unsigned    models;         // Kalman models it affects
+} tune_param_t;
+
+#define BUILD(f, n, t, lo, hi, lg, m) \
+    { n, true, t, offsetof(tune_params_t, build.f), lo, hi, lg, m }
+#define CFG(f, t, lo, hi, lg, m) \
+    { #f, false, t, offsetof(tune_params_t, cfg.f), lo, hi, lg, m }
+
+// step_threshold_raw only acts without a calibration and the median
+// front end is not the default pipeline: neither is searched
+static const tune_param_t s_params[] = {
+    BUILD(ma_window,         "MA_WINDOW",         P_I32, 0, HX711_MA_WINDOW_MAX, false, M_RW),
+    BUILD(kf_q_init,         "KF_Q_INIT",         P_F32, 0.01, 10.0,  true,  M_RW),
+    BUILD(kf_r_init,         "KF_R_INIT",         P_F32, 0.1,  100.0, true,  M_RW),
+    BUILD(kf_cv_accel_noise, "KF_CV_ACCEL_NOISE", P_F32, 1.0,  1e6,   true,  M_CV),
+    BUILD(kf_cv_meas_noise,  "KF_CV_MEAS_NOISE",  P_F32, 100.0, 1e5,  true,  M_CV),
+    CFG(kf_q_normal,        P_F32, 0.01, 10.0,   true,  M_RW),
+    CFG(kf_q_boosted,       P_F32, 1.0,  1000.0, true,  M_RW),
+    CFG(boost_samples,      P_U8,  1,    30,     false, M_RW),
+    CFG(cd_k_sigma,         P_F32, 0.5,  3.0,    false, M_ANY),
+    CFG(cd_h_sigma,         P_F32, 2.0,  12.0,   false, M_ANY),
+    CFG(debounce_count,     P_U8,  1,    10,     false, M_ANY),
+    CFG(stable_count,       P_U8,  3,    SCALE_CFG_STABLE_COUNT_MAX, false, M_ANY),
+    CFG(stable_tolerance_g, P_F32, 10.0, 200.0,  false, M_ANY),
+};
+#define NPARAM  (int)(sizeof(s_params) / sizeof(s_params[0]))
+#define DIM     (NPARAM + 1)        // + Kalman model
+
+// Firmware values: main.c constants + scale_config defaults (set in main)
+static tune_params_t s_base;
+
+static bool     s_fixed[NPARAM];    // --fix
+static unsigned s_models = M_ANY;   // --model
+
+/* ------------------------------- Options -------------------------------- */
+
+static struct {
+    int         workers;
+    int         samples;            // Candidates per round
+    int         rounds;
+    double      elite_frac;
+    double      err_scale_g;        // Grams of error worth one second
+    double      miss_penalty_s;     // Weigh-in without a lock
+    double      false_penalty_s;    // Each false ADDED / REMOVED
+    int         synth;
+    const char *synth_dir;
+    const char *out_dir;
+    uint64_t    seed;
+} s_opt = {
+    .samples         = 2000,
+    .rounds          = 5,
+    .elite_frac      = 0.05,
+    .err_scale_g     = 100.0,
+    .miss_penalty_s  = 30.0,
+    .false_penalty_s = 10.0,
+    .out_dir         = ".",
+    .seed            = 1,
+};
+
+static trace_t s_traces[MAX_TRACES];
+static int     s_trace_count;
+
+/* --------------------------------- RNG ---------------------------------- */
+
+static synth_rng_t s_rng;
+
+static double rnd(void)
+{
+    return synth_rand(&s_rng);
+}
+
+static double clamp01(double v)
+{
+    return v < 0.0 ? 0.0 : v > 1.0 ? 1.0 : v;
+}
+
+/* ----------------------------- Candidates ------------------------------- */
+
+static double get_value(const tune_params_t *p, const tune_param_t *d)
+{
+    const uint8_t *f = (const uint8_t *)p + d->offset;
+    switch (d->type) {
+        case P_F32: return *(const float *)f;
+        case P_I32: return *(const int32_t *)f;
+        default:    return *f;
+    }
+}
+
+static void set_value(tune_params_t *p, const tune_param_t *d, double v)
+{
+    uint8_t *f = (uint8_t *)p + d->offset;
+    switch (d->type) {
+        case P_F32: *(float *)f = (float)v; break;
+        case P_I32: *(int32_t *)f = (int32_t)lround(v); break;
+        default:    *f = (uint8_t)lround(v); break;
+    }
+}
+
+static double to_unit(const tune_param_t *d, double v)
+{
+    if (d->log) {
+        return clamp01(log(v / d->lo) / log(d->hi / d->lo));
+    }
+    return clamp01((v - d->lo) / (d->hi - d->lo));
+}
+
+static double from_unit(const tune_param_t *d, double u)
+{
+    return d->log ? d->lo * pow(d->hi / d->lo, u) : d->lo + u * (d->hi - d->lo);
+}
+
+static bool searched(int i, kalman_model_t model)
+{
+    return !s_fixed[i] && (s_params[i].models & (1u << model));
+}
+
+// Unit-cube point → parameters; x[NPARAM] picks the model
+static void decode(const double *x, tune_params_t *p)
+{
+    *p = s_base;
+    if (s_models == M_ANY) {
+        p->build.model = x[NPARAM] < 0.5 ? KALMAN_MODEL_RANDOM_WALK : KALMAN_MODEL_CONST_VELOCITY;
+    }
+    for (int i = 0; i < NPARAM; i++) {
+        if (searched(i, p->build.model)) {
+            set_value(p, &s_params[i], from_unit(&s_params[i], x[i]));
+        }
+    }
+    // Keep the candidate inside scale_config_validate()
+    if (p->cfg.cd_h_sigma < p->cfg.cd_k_sigma + 0.5f) {
+        p->cfg.cd_h_sigma = p->cfg.cd_k_sigma + 0.5f;
+    }
+    if (p->cfg.kf_q_boosted < p->cfg.kf_q_normal) {
+        p->cfg.kf_q_boosted = p->cfg.kf_q_normal;
+    }
+}
+
+static void encode(const tune_params_t *p, double *x)
+{
+    for (int i = 0; i < NPARAM; i++) {
+        x[i] = to_unit(&s_params[i], get_value(p, &s_params[i]));
+    }
+    x[NPARAM] = p->build.model == KALMAN_MODEL_CONST_VELOCITY ? 0.75 : 0.25;
+}
+
+/* ------------------------------ Objective ------------------------------- */
+
+static double objective(const tune_metrics_t *m)
+{
+    if (m->weigh_ins == 0) {
+        return INFINITY;
+    }
+    int missed = m->weigh_ins - m->locked;
+    double cost = m->lock_s_sum + m->err_g_sum / s_opt.err_scale_g
+                + missed * s_opt.miss_penalty_s
+                + m->false_events * s_opt.false_penalty_s;
+    return cost / m->weigh_ins;
+}
+
+static void print_metrics(const char *what, const tune_metrics_t *m)
+{
+    printf("%-10s score %7.3f | locked %d/%d | lock %.2f s (max %.2f) | "
+           "error %.1f g (max %.1f) | false events %d\n",
+           what, objective(m), m->locked, m->weigh_ins,
+           m->locked ? m->lock_s_sum / m->locked : 0.0, m->lock_s_max,
+           m->locked ? m->err_g_sum / m->locked : 0.0, m->err_g_max, m->false_events);
+}
+
+/* ------------------------------- Workers -------------------------------- */
+
+typedef struct {
+    int            index;
+    double         score;
+    tune_metrics_t m;
+} tune_result_t;
+
+// Worker w replays candidates w, w + workers, ...; one result per pipe write
+static void worker(int w, const double (*x)[DIM], int count, int fd)
+{
+    for (int i = w; i < count; i += s_opt.workers) {
+        tune_params_t p;
+        tune_result_t r = { .index = i, .score = INFINITY };
+        decode(x[i], &p);
+        if (replay_eval(&p, s_traces, s_trace_count, &r.m, NULL) == ESP_OK) {
+            r.score = objective(&r.m);
+        }
+        if (write(fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+            _exit(1);
+        }
+    }
+    _exit(0);
+}
+
+// Scores x[0..count) in parallel; fills score[] and metrics[]
+static int evaluate(const double (*x)[DIM], int count, double *score, tune_metrics_t *metrics)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        return -1;
+    }
+    int started = 0;
+    for (int w = 0; w < s_opt.workers && w < count; w++, started++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            worker(w, x, count, fds[1]);
+        }
+    }
+    close(fds[1]);
+
+    int got = 0;
+    tune_result_t r;
+    while (read(fds[0], &r, sizeof(r)) == (ssize_t)sizeof(r)) {
+        score[r.index] = r.score;
+        metrics[r.index] = r.m;
+        got++;
+    }
+    close(fds[0]);
+    while (started-- > 0) {
+        wait(NULL);
+    }
+    return got == count ? 0 : -1;
+}
+
+/* -------------------------------- Search -------------------------------- */
+
+typedef struct {
+    double         x[DIM];
+    double         score;
+    tune_metrics_t m;
+} tune_cand_t;
+
+static int cmp_cand(const void *a, const void *b)
+{
+    double sa = ((const tune_cand_t *)a)->score, sb = ((const tune_cand_t *)b)->score;
+    return (sa > sb) - (sa < sb);
+}
+
+// Next round around the elites: per-dimension mean and spread (floor
+// `min_sd` so the search never collapses), model by elite frequency
+static void sample_round(double (*x)[DIM], int count, const tune_cand_t *elite, int n_elite,
+                         double min_sd)
+{
+    double mean[DIM] = { 0 }, sd[DIM] = { 0 };
+    for (int e = 0; e < n_elite; e++) {
+        for (int d = 0; d < DIM; d++) mean[d] += elite[e].x[d] / n_elite;
+    }
+    for (int e = 0; e < n_elite; e++) {
+        for (int d = 0; d < DIM; d++) sd[d] += pow(elite[e].x[d] - mean[d], 2) / n_elite;
+    }
+    double p_cv = 0.0;
+    for (int e = 0; e < n_elite; e++) p_cv += (elite[e].x[NPARAM] >= 0.5) / (double)n_elite;
+    p_cv = fmin(fmax(p_cv, 0.1), 0.9);
+
+    for (int i = 0; i < count; i++) {
+        for (int d = 0; d < NPARAM; d++) {
+            x[i][d] = clamp01(mean[d] + fmax(sqrt(sd[d]), min_sd) * synth_normal(&s_rng));
+        }
+        x[i][NPARAM] = rnd() < p_cv ? 0.75 : 0.25;
+    }
+}
+
+static int search(tune_cand_t *best, tune_metrics_t *baseline)
+{
+    int per_round = s_opt.samples;
+    int total = per_round * s_opt.rounds;
+    tune_cand_t *all = calloc(total, sizeof(*all));
+    double (*x)[DIM] = calloc(per_round, sizeof(*x));
+    double *score = calloc(per_round, sizeof(*score));
+    tune_metrics_t *metrics = calloc(per_round, sizeof(*metrics));
+    if (!all || !x || !score || !metrics) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+
+    int n = 0;
+    for (int round = 0; round < s_opt.rounds; round++) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (round == 0) {
+            encode(&s_base, x[0]);          // The firmware as it is
+            for (int i = 1; i < per_round; i++) {
+                for (int d = 0; d < DIM; d++) x[i][d] = rnd();
+            }
+        } else {
+            int n_elite = (int)fmax(8.0, ceil(s_opt.elite_frac * n));
+            sample_round(x, per_round, all, n_elite, 0.2 / (1 << round));
+        }
+        if (evaluate((const double (*)[DIM])x, per_round, score, metrics) != 0) {
+            fprintf(stderr, "worker failed\n");
+            return -1;
+        }
+        if (round == 0) {
+            *baseline = metrics[0];
+        }
+        for (int i = 0; i < per_round; i++, n++) {
+            memcpy(all[n].x, x[i], sizeof(x[i]));
+            all[n].score = score[i];
+            all[n].m = metrics[i];
+        }
+        qsort(all, n, sizeof(*all), cmp_cand);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("round %d: %d candidates in %.1f s, best score %.3f\n", round + 1, per_round,
+               (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9, all[0].score);
+    }
+    *best = all[0];
+    free(all);
+    free(x);
+    free(score);
+    free(metrics);
+    return 0;
+}
+
+/* -------------------------------- Traces -------------------------------- */
+
+typedef struct {
+    int   start;
+    float grams;                // NAN: "load ?"
+} segment_t;
+
+static int cmp_float(const void *a, const void *b)
+{
+    float fa = *(const float *)a, fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// "load ?": median of the calibrated second half of the segment
+static float segment_median(const trace_t *t, int start, int end)
+{
+    int from = start + (end - start) / 2, n = end - from;
+    if (n <= 0) {
+        return 0.0f;
+    }
+    float *w = malloc(n * sizeof(*w));
+    for (int i = 0; i < n; i++) {
+        w[i] = calibration_convert(&t->cal, t->raw[from + i]);
+    }
+    qsort(w, n, sizeof(*w), cmp_float);
+    float med = w[n / 2];
+    free(w);
+    return med;
+}
+
+static int push(void **buf, int *cap, int n, size_t size)
+{
+    if (n < *cap) {
+        return 0;
+    }
+    *cap = *cap ? *cap * 2 : 1024;
+    void *p = realloc(*buf, *cap * size);
+    if (!p) {
+        return -1;
+    }
+    *buf = p;
+    return 0;
+}
+
+static int load_trace(const char *path, trace_t *t)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    memset(t, 0, sizeof(*t));
+    snprintf(t->name, sizeof(t->name), "%s", path);
+    t->rate_sps = 10.0f;
+
+    segment_t *seg = NULL;
+    int seg_n = 1, seg_cap = 0, raw_cap = 0;
+    bool have_cal = false;
+    push((void **)&seg, &seg_cap, 0, sizeof(*seg));
+    seg[0] = (segment_t){ 0, 0.0f };
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        const char *s = line + strspn(line, " \t");
+        const char *tr = strstr(s, "TRACE ");
+        const char *sl = strstr(s, "slope=");
+        char word[16];
+        long raw;
+        float a, b;
+        char *end;
+        if (*s == '#' || *s == '\n' || *s == '\0') {
+            continue;
+        } else if (sl && sscanf(sl, "slope=%f intercept=%f", &a, &b) == 2) {
+            t->cal = (calibration_t){ a, b };
+            have_cal = true;
+        } else if (sscanf(s, "cal %f %f", &a, &b) == 2) {
+            t->cal = (calibration_t){ a, b };
+            have_cal = true;
+        } else if (sscanf(s, "rate %f", &a) == 1 && a > 0.0f) {
+            t->rate_sps = a;
+        } else if (sscanf(s, "load %15s", word) == 1) {
+            push((void **)&seg, &seg_cap, seg_n, sizeof(*seg));
+            seg[seg_n++] = (segment_t){ t->n, strcmp(word, "?") ? strtof(word, NULL) : NAN };
+        } else if ((tr && (raw = strtol(tr + 6, &end, 10), end != tr + 6)) ||
+                   (raw = strtol(s, &end, 10), end != s && strspn(end, " \t\r\n") == strlen(end))) {
+            if (push((void **)&t->raw, &raw_cap, t->n, sizeof(*t->raw)) != 0) {
+                fclose(f);
+                return -1;
+            }
+            t->raw[t->n++] = (int32_t)raw;
+        }
+    }
+    fclose(f);
+    if (!have_cal || t->n < 2) {
+        fprintf(stderr, "%s: %s\n", path, have_cal ? "no conversions" : "no cal line");
+        free(seg);
+        return -1;
+    }
+
+    t->truth_g = malloc(t->n * sizeof(*t->truth_g));
+    for (int s = 0; s < seg_n; s++) {
+        int from = seg[s].start, to = s + 1 < seg_n ? seg[s + 1].start : t->n;
+        float g = isnan(seg[s].grams) ? segment_median(t, from, to) : seg[s].grams;
+        for (int i = from; i < to; i++) t->truth_g[i] = g;
+    }
+    free(seg);
+    return 0;
+}
+
+static int load_path(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        if (s_trace_count >= MAX_TRACES) {
+            fprintf(stderr, "more than %d traces\n", MAX_TRACES);
+            return -1;
+        }
+        if (load_trace(path, &s_traces[s_trace_count]) != 0) {
+            return -1;
+        }
+        s_trace_count++;
+        return 0;
+    }
+    struct dirent **names;
+    int n = scandir(path, &names, NULL, alphasort);
+    int err = n < 0 ? -1 : 0;
+    for (int i = 0; i < n; i++) {
+        if (!err && names[i]->d_name[0] != '.') {
+            char full[PATH_MAX];
+            snprintf(full, sizeof(full), "%s/%s", path, names[i]->d_name);
+            err = load_path(full);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return err;
+}
+
+// Synthetic weigh-in (synth.h) with 2-4 s of empty platform either side
+static void synth_trace(trace_t *t, int index)
+{
+    int32_t zero = 50000 + (int32_t)(rnd() * 150000);
+    bool person = rnd() < 0.8;
+    double load = person ? 20000 + rnd() * 110000 : 500 + rnd() * 4500;
+    synth_weigh_in_t w;
+    synth_weigh_in(&w, &s_rng, load, person);
+    double empty1 = 2 + rnd() * 2, empty2 = 2 + rnd() * 2;
+
+    memset(t, 0, sizeof(*t));
+    snprintf(t->name, sizeof(t->name), "synth_%03d", index);
+    t->rate_sps = 10.0f;
+    t->cal = (calibration_t){ SYNTH_SLOPE, -SYNTH_SLOPE * zero };
+    t->n = (int)((empty1 + synth_weigh_in_s(&w) + empty2) * t->rate_sps);
+    t->raw = malloc(t->n * sizeof(*t->raw));
+    t->truth_g = malloc(t->n * sizeof(*t->truth_g));
+
+    for (int i = 0; i < t->n; i++) {
+        double since = i / t->rate_sps - empty1;
+        t->raw[i] = synth_raw(&s_rng, synth_load_g(&w, since), zero);
+        t->truth_g[i] = (since >= 0.0 && since < w.on_s + w.stand_s) ? (float)load : 0.0f;
+    }
+}
+
+static int write_trace(const char *dir, const trace_t *t)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s.trace", dir, t->name);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "# scale_tune synthetic trace\ncal %.6f %.2f\nrate %.0f\n",
+            t->cal.slope, t->cal.intercept, t->rate_sps);
+    for (int i = 0; i < t->n; i++) {
+        if (i == 0 || t->truth_g[i] != t->truth_g[i - 1]) {
+            fprintf(f, "load %.1f\n", t->truth_g[i]);
+        }
+        fprintf(f, "%d\n", (int)t->raw[i]);
+    }
+    return fclose(f);
+}
+
+/* -------------------------------- Output -------------------------------- */
+
+static FILE *open_out(const char *name)
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", s_opt.out_dir, name);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    } else {
+        printf("wrote %s\n", path);
+    }
+    return f;
+}
+
+static int write_outputs(const tune_params_t *p, const tune_metrics_t *m)
+{
+    // main.c constants
+    FILE *f = open_out("scale_tune_config.h");
+    if (!f) return -1;
+    fprintf(f, "// File: main/scale_tune_config.h\n"
+               "// Generated by tools/scale_tune (traces: %d): %d/%d locked, lock %.2f s,\n"
+               "// error %.1f g, %d false events. main.c picks it up when present.\n"
+               "#pragma once\n\n#define KF_MODEL            %s\n",
+            s_trace_count, m->locked, m->weigh_ins,
+            m->locked ? m->lock_s_sum / m->locked : 0.0,
+            m->locked ? m->err_g_sum / m->locked : 0.0, m->false_events,
+            p->build.model == KALMAN_MODEL_CONST_VELOCITY ? "KALMAN_MODEL_CONST_VELOCITY"
+                                                          : "KALMAN_MODEL_RANDOM_WALK");
+    for (int i = 0; i < NPARAM; i++) {
+        const tune_param_t *d = &s_params[i];
+        if (!d->build) continue;
+        if (d->type == P_F32) {
+            fprintf(f, "#define %-19s %#.6gf\n", d->name, get_value(p, d));
+        } else {
+            fprintf(f, "#define %-19s %d\n", d->name, (int)get_value(p, d));
+        }
+    }
+    fclose(f);
+
+    // Searched runtime fields, for POST /config
+    if (!(f = open_out("scale_config.json"))) return -1;
+    const char *sep = "{";
+    for (int i = 0; i < NPARAM; i++) {
+        if (!s_params[i].build && searched(i, p->build.model)) {
+            fprintf(f, "%s\n  \"%s\": %.6g", sep, s_params[i].name, get_value(p, &s_params[i]));
+            sep = ",";
+        }
+    }
+    fprintf(f, "\n}\n");
+    fclose(f);
+
+    // Whole object as scale_config stores it (no pointers, same layout on
+    // the ESP32), plus the CSV for nvs_partition_gen.py
+    scale_config_t blob = p->cfg;
+    blob.version = 0;
+    if (!(f = open_out("scale_config.bin"))) return -1;
+    fwrite(&blob, sizeof(blob), 1, f);
+    fclose(f);
+    if (!(f = open_out("scale_config_nvs.csv"))) return -1;
+    fprintf(f, "key,type,encoding,value\nscalecfg,namespace,,\ncfg,file,binary,scale_config.bin\n");
+    fclose(f);
+    return 0;
+}
+
+/* --------------------------------- Main --------------------------------- */
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: scale_tune [options] <trace file or directory>...\n"
+        "  -j N               workers (default: all cores)\n"
+        "  -n N               candidates per round (default %d)\n"
+        "  -r N               rounds (default %d)\n"
+        "  -o DIR             output directory (default .)\n"
+        "  --model rw|cv|any  Kalman model to search (default any)\n"
+        "  --fix NAME=VALUE   hold a parameter (repeatable)\n"
+        "  --err-scale G      grams of error worth one second (default %.0f)\n"
+        "  --miss-penalty S   seconds charged for a weigh-in without lock (default %.0f)\n"
+        "  --false-penalty S  seconds charged per false ADDED/REMOVED (default %.0f)\n"
+        "  --synth N          add N synthetic weigh-ins\n"
+        "  --write-synth DIR  also save them as trace files\n"
+        "  --seed N\n"
+        "parameters:",
+        s_opt.samples, s_opt.rounds, s_opt.err_scale_g, s_opt.miss_penalty_s,
+        s_opt.false_penalty_s);
+    for (int i = 0; i < NPARAM; i++) fprintf(stderr, " %s", s_params[i].name);
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+static void fix_param(const char *arg)
+{
+    const char *eq = strchr(arg, '=');
+    for (int i = 0; eq && i < NPARAM; i++) {
+        if (strlen(s_params[i].name) == (size_t)(eq - arg) &&
+            strncmp(s_params[i].name, arg, eq - arg) == 0) {
+            set_value(&s_base, &s_params[i], atof(eq + 1));
+            s_fixed[i] = true;
+            return;
+        }
+    }
+    fprintf(stderr, "--fix %s: unknown parameter\n", arg);
+    usage();
+}
+
+int main(int argc, char **argv)
+{
+    s_base.build = replay_default_build;
+    s_base.cfg = *scale_config_defaults();
+    s_opt.workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (a[0] != '-') {
+            argv[files++] = argv[i];
+            continue;
+        }
+        if (!v) usage();
+        i++;
+        if (!strcmp(a, "-j")) s_opt.workers = atoi(v);
+        else if (!strcmp(a, "-n")) s_opt.samples = atoi(v);
+        else if (!strcmp(a, "-r")) s_opt.rounds = atoi(v);
+        else if (!strcmp(a, "-o")) s_opt.out_dir = v;
+        else if (!strcmp(a, "--fix")) fix_param(v);
+        else if (!strcmp(a, "--err-scale")) s_opt.err_scale_g = atof(v);
+        else if (!strcmp(a, "--miss-penalty")) s_opt.miss_penalty_s = atof(v);
+        else if (!strcmp(a, "--false-penalty")) s_opt.false_penalty_s = atof(v);
+        else if (!strcmp(a, "--synth")) s_opt.synth = atoi(v);
+        else if (!strcmp(a, "--write-synth")) s_opt.synth_dir = v;
+        else if (!strcmp(a, "--seed")) s_opt.seed = strtoull(v, NULL, 0);
+        else if (!strcmp(a, "--model")) {
+            if (!strcmp(v, "rw")) s_models = M_RW;
+            else if (!strcmp(v, "cv")) s_models = M_CV;
+            else if (!strcmp(v, "any")) s_models = M_ANY;
+            else usage();
+        } else {
+            usage();
+        }
+    }
+    if (s_opt.workers < 1 || s_opt.workers > MAX_WORKERS || s_opt.samples < 16 ||
+        s_opt.rounds < 1 || s_opt.err_scale_g <= 0.0) {
+        usage();
+    }
+    if (s_models != M_ANY) {
+        s_base.build.model = s_models == M_RW ? KALMAN_MODEL_RANDOM_WALK
+                                              : KALMAN_MODEL_CONST_VELOCITY;
+    }
+    synth_seed(&s_rng, s_opt.seed);
+
+    for (int i = 0; i < files; i++) {
+        if (load_path(argv[i]) != 0) return 1;
+    }
+    for (int i = 0; i < s_opt.synth && s_trace_count < MAX_TRACES; i++) {
+        synth_trace(&s_traces[s_trace_count], i);
+        if (s_opt.synth_dir && write_trace(s_opt.synth_dir, &s_traces[s_trace_count]) != 0) {
+            return 1;
+        }
+        s_trace_count++;
+    }
+    if (s_trace_count == 0) {
+        usage();
+    }
+    if (replay_init() != ESP_OK) {
+        fprintf(stderr, "replay setup failed\n");
+        return 1;
+    }
+
+    long samples = 0;
+    for (int i = 0; i < s_trace_count; i++) samples += s_traces[i].n;
+    printf("%d traces, %ld conversions; %d workers, %d x %d candidates\n",
+           s_trace_count, samples, s_opt.workers, s_opt.rounds, s_opt.samples);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    tune_cand_t best;
+    tune_metrics_t baseline;
+    if (search(&best, &baseline) != 0) {
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    struct rusage ru;
+    getrusage(RUSAGE_CHILDREN, &ru);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+               + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+    printf("%d candidates in %.1f s wall, %.1f s CPU (%.1fx)\n",
+           s_opt.samples * s_opt.rounds, wall, cpu, cpu / wall);
+
+    tune_params_t p;
+    decode(best.x, &p);
+    print_metrics("firmware", &baseline);
+    print_metrics("tuned", &best.m);
+    printf("  KF_MODEL = %s\n", p.build.model == KALMAN_MODEL_CONST_VELOCITY ? "const velocity"
+                                                                            : "random walk");
+    for (int i = 0; i < NPARAM; i++) {
+        if (searched(i, p.build.model)) {
+            printf("  %-19s = %-10.4g (was %.4g)\n", s_params[i].name,
+                   get_value(&p, &s_params[i]), get_value(&s_base, &s_params[i]));
+        }
+    }
+    return write_outputs(&p, &best.m) == 0 ? 0 : 1;
+}
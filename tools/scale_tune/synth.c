@@ -0,0 +1,65 @@
+// File: tools/scale_tune/synth.c
+// ---------------------------------------------------------------------------
+// Synthetic weigh-ins for the host tools (see synth.h)
+// ---------------------------------------------------------------------------
+
+#include "synth.h"
+
+#include <math.h>
+
+void synth_seed(synth_rng_t *r, uint64_t seed)
+{
+    r->s = seed * 0x9E3779B97F4A7C15ull | 1;
+}
+
+double synth_rand(synth_rng_t *r)
+{
+    r->s ^= r->s << 13;
+    r->s ^= r->s >> 7;
+    r->s ^= r->s << 17;
+    return (double)(r->s >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double synth_normal(synth_rng_t *r)
+{
+    double u = synth_rand(r) + 1e-12, v = synth_rand(r);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+void synth_weigh_in(synth_weigh_in_t *w, synth_rng_t *r, double load_g, bool person)
+{
+    w->load_g     = load_g;
+    w->on_s       = 0.3 + synth_rand(r) * 0.9;
+    w->stand_s    = 6.0 + synth_rand(r) * 5.0;
+    w->off_s      = 0.3 + synth_rand(r) * 0.5;
+    w->sway_g     = person ? (0.01 + synth_rand(r) * 0.03) * load_g : 0.0;
+    w->sway_tau_s = 0.5 + synth_rand(r);
+    w->sway_hz    = 1.0 + synth_rand(r) * 2.0;
+    w->drift_g    = person ? 0.001 * load_g : 0.0;
+}
+
+double synth_weigh_in_s(const synth_weigh_in_t *w)
+{
+    return w->on_s + w->stand_s + w->off_s;
+}
+
+double synth_load_g(const synth_weigh_in_t *w, double t)
+{
+    if (t < 0.0 || t >= synth_weigh_in_s(w)) {
+        return 0.0;
+    }
+    if (t < w->on_s) {
+        return w->load_g * t / w->on_s;
+    }
+    t -= w->on_s;
+    if (t < w->stand_s) {
+        return w->load_g + w->sway_g * exp(-t / w->sway_tau_s) * sin(2 * M_PI * w->sway_hz * t)
+                         + w->drift_g * sin(2 * M_PI * 0.3 * t);
+    }
+    return w->load_g * (1.0 - (t - w->stand_s) / w->off_s);
+}
+
+int32_t synth_raw(synth_rng_t *r, double grams, int32_t zero)
+{
+    return zero + (int32_t)lround(grams / SYNTH_SLOPE + SYNTH_NOISE_COUNTS * synth_normal(r));
+}
@@ -0,0 +1,48 @@
+// File: tools/scale_tune/synth.h
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Synthetic platform signal for host tools (scale_tune, scale_fleet).
+ *
+ * A weigh-in is a ramp on, a stand and a ramp off. A person adds a
+ * decaying sway after stepping on (1-4 % of the load, 1-3 Hz) and a slow
+ * balance drift (0.1 %, 0.3 Hz); a parcel is a clean step. Conversions
+ * get SYNTH_NOISE_COUNTS rms of Gaussian noise, like a quiet HX711 at
+ * gain 128.
+ */
+
+#define SYNTH_NOISE_COUNTS  50.0
+#define SYNTH_SLOPE         0.02f       // Grams per count of the simulated cell
+
+typedef struct {
+    uint64_t s;
+} synth_rng_t;
+
+typedef struct {
+    double load_g;
+    double on_s, stand_s, off_s;        // Ramp on, time on the platform, ramp off
+    double sway_g, sway_tau_s, sway_hz;
+    double drift_g;
+} synth_weigh_in_t;
+
+void   synth_seed(synth_rng_t *r, uint64_t seed);
+double synth_rand(synth_rng_t *r);      // [0, 1)
+double synth_normal(synth_rng_t *r);
+
+/** @brief Random timing and sway for a weigh-in of @p load_g. */
+void synth_weigh_in(synth_weigh_in_t *w, synth_rng_t *r, double load_g, bool person);
+
+/** @brief Ramp on + stand + ramp off, seconds. */
+double synth_weigh_in_s(const synth_weigh_in_t *w);
+
+/** @brief Platform load @p since_s after the ramp on starts (0 outside). */
+double synth_load_g(const synth_weigh_in_t *w, double since_s);
+
+/** @brief One noisy conversion of @p grams on a cell reading @p zero empty. */
+int32_t synth_raw(synth_rng_t *r, double grams, int32_t zero);
+
+#endif // SYNTH_H
@@ -0,0 +1,705 @@
+// File: tools/storage_bench/storage_bench.c
+// ---------------------------------------------------------------------------
+// Append latency of the storage backends on a simulated flash image
+//   - The real SPIFFS and LittleFS sources (as the firmware builds them)
+//     on a NOR flash model: 4 KiB sectors erase to 0xFF, programming can
+//     only clear bits, every operation is counted and costed
+//   - Per backend and fill level: format, fill the partition with 4 KiB
+//     files, churn by rewriting random ones (old pages become garbage the
+//     way a long-lived scale's do), then time weigh-in appends: a 16 byte
+//     record and a sync each, as weigh_log does
+//   - Reports modeled flash time per append (p50 / p99 / max / mean),
+//     sector erases, write amplification and host CPU per append
+//
+// Flash model defaults follow the ESP32 module's SPI NOR datasheet
+// (typical, not worst case): 0.4 ms per 256 byte page program, 45 ms per
+// sector erase, reads at 40 MHz QIO. Tune them with --prog-us, --erase-us
+// and --read-ns.
+//
+//   make -C tools/storage_bench fetch      (pinned SPIFFS and LittleFS)
+//   make -C tools/storage_bench check
+//   make -C tools/storage_bench table      (fills 0-90 %, 256 appends)
+//   tools/storage_bench/storage_bench --fills 0,50,90 --image /tmp/storage.bin
+//
+// --self-test checks the flash model alone (NOR semantics and costing),
+// so it runs even when neither filesystem's sources were found; `check`
+// refuses to pass without both.
+//
+// --image keeps the partition in a file (the last run's content stays,
+// 0x20000 bytes, flashable at the "storage" offset).
+// ---------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#if HAVE_SPIFFS
+#include "spiffs.h"
+#endif
+#if HAVE_LITTLEFS
+#include "lfs.h"
+#endif
+
+#define SECTOR_SIZE     4096
+#define PAGE_SIZE       256         // NOR program page
+#define FILLER_SIZE     4096
+#define MAX_FILLS       16
+#define MAX_APPENDS     65536
+#define LOG_NAME        "weighins.bin"
+
+/* ------------------------------ Flash model ------------------------------ */
+
+typedef struct {
+    uint64_t reads;
+    uint64_t read_bytes;
+    uint64_t progs;
+    uint64_t prog_bytes;
+    uint64_t erases;
+    double   busy_us;               // Modeled time the chip was busy
+} flash_counters_t;
+
+static struct {
+    uint8_t *mem;
+    size_t   size;
+    int      fd;                    // --image, else -1
+    double   prog_page_us;
+    double   erase_us;
+    double   read_ns_per_byte;
+    flash_counters_t c;
+} s_flash = {
+    .size             = 0x20000,    // partitions.csv "storage"
+    .fd               = -1,
+    .prog_page_us     = 400.0,
+    .erase_us         = 45000.0,
+    .read_ns_per_byte = 50.0,       // 4 bit × 40 MHz, plus command overhead
+};
+
+static int flash_open(const char *image)
+{
+    if (image) {
+        s_flash.fd = open(image, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (s_flash.fd < 0 || ftruncate(s_flash.fd, (off_t)s_flash.size) != 0) {
+            perror(image);
+            return -1;
+        }
+        s_flash.mem = mmap(NULL, s_flash.size, PROT_READ | PROT_WRITE, MAP_SHARED, s_flash.fd, 0);
+    } else {
+        s_flash.mem = mmap(NULL, s_flash.size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (s_flash.mem == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    return 0;
+}
+
+static void flash_close(void)
+{
+    if (s_flash.fd >= 0) {
+        msync(s_flash.mem, s_flash.size, MS_SYNC);
+        close(s_flash.fd);
+    }
+    munmap(s_flash.mem, s_flash.size);
+}
+
+// A factory-fresh (fully erased) chip, counters cleared
+static void flash_blank(void)
+{
+    memset(s_flash.mem, 0xFF, s_flash.size);
+    memset(&s_flash.c, 0, sizeof(s_flash.c));
+}
+
+static bool flash_in_range(uint32_t addr, uint32_t len)
+{
+    if ((uint64_t)addr + len > s_flash.size) {
+        fprintf(stderr, "flash access out of range: 0x%x + %u\n", addr, len);
+        return false;
+    }
+    return true;
+}
+
+static int flash_read(uint32_t addr, void *dst, uint32_t len)
+{
+    if (!flash_in_range(addr, len)) {
+        return -1;
+    }
+    memcpy(dst, s_flash.mem + addr, len);
+    s_flash.c.reads++;
+    s_flash.c.read_bytes += len;
+    s_flash.c.busy_us += 1.0 + len * s_flash.read_ns_per_byte / 1000.0;
+    return 0;
+}
+
+// One program command per page touched; a partial page costs its share
+// of a full one, with a floor for the command and verify overhead
+static int flash_prog(uint32_t addr, const void *src, uint32_t len)
+{
+    if (!flash_in_range(addr, len)) {
+        return -1;
+    }
+    const uint8_t *p = src;
+    for (uint32_t i = 0; i < len; i++) {
+        s_flash.mem[addr + i] &= p[i];
+    }
+    while (len > 0) {
+        uint32_t chunk = PAGE_SIZE - addr % PAGE_SIZE;
+        if (chunk > len) {
+            chunk = len;
+        }
+        double share = (double)chunk / PAGE_SIZE;
+        s_flash.c.busy_us += s_flash.prog_page_us * (share < 0.125 ? 0.125 : share);
+        s_flash.c.progs++;
+        s_flash.c.prog_bytes += chunk;
+        addr += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+static int flash_erase(uint32_t addr, uint32_t len)
+{
+    if (addr % SECTOR_SIZE || len % SECTOR_SIZE || !flash_in_range(addr, len)) {
+        fprintf(stderr, "unaligned erase: 0x%x + %u\n", addr, len);
+        return -1;
+    }
+    memset(s_flash.mem + addr, 0xFF, len);
+    s_flash.c.erases += len / SECTOR_SIZE;
+    s_flash.c.busy_us += s_flash.erase_us * (len / SECTOR_SIZE);
+    return 0;
+}
+
+static bool near(double x, double y)
+{
+    return x - y < 1e-6 && y - x < 1e-6;
+}
+
+// Bits only clear, erases restore 0xFF, misuse is refused and every
+// operation costs what the header says. Returns the failures
+static int flash_self_test(void)
+{
+    int failures = 0;
+#define EXPECT(cond, what) do {                                         \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "FAIL %s:%d: %s\n", __FILE__, __LINE__, what); \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+    uint8_t a[PAGE_SIZE + 32], b[sizeof(a)];
+    double t;
+
+    flash_blank();
+    memset(a, 0xF0, sizeof(a));
+    memset(b, 0x3C, sizeof(b));
+    EXPECT(flash_prog(0, a, 16) == 0 && flash_prog(0, b, 16) == 0, "program");
+    EXPECT(flash_read(0, a, 16) == 0 && a[0] == 0x30 && a[15] == 0x30, "program only clears bits");
+    EXPECT(s_flash.mem[16] == 0xFF, "program past its length");
+    EXPECT(s_flash.c.progs == 2 && s_flash.c.prog_bytes == 32, "program counters");
+    EXPECT(near(s_flash.c.busy_us, 2 * s_flash.prog_page_us / 8 + 1.0 + 16 * s_flash.read_ns_per_byte / 1000.0),
+           "partial page program costs the 1/8 page floor, reads 1 us + per byte");
+
+    memset(&s_flash.c, 0, sizeof(s_flash.c));
+    t = s_flash.c.busy_us;
+    EXPECT(flash_prog(PAGE_SIZE - 16, b, PAGE_SIZE + 32) == 0, "program across pages");
+    EXPECT(s_flash.c.progs == 3, "one program command per page touched");
+    EXPECT(near(s_flash.c.busy_us - t, s_flash.prog_page_us * (0.125 + 1.0 + 0.125)), "page shares");
+
+    memset(&s_flash.c, 0, sizeof(s_flash.c));
+    EXPECT(flash_erase(0, SECTOR_SIZE) == 0 && s_flash.mem[0] == 0xFF && s_flash.mem[PAGE_SIZE] == 0xFF,
+           "erase restores 0xFF");
+    EXPECT(s_flash.c.erases == 1 && near(s_flash.c.busy_us, s_flash.erase_us), "erase cost");
+    EXPECT(flash_erase(PAGE_SIZE, SECTOR_SIZE) != 0, "unaligned erase refused");
+    EXPECT(flash_erase(0, PAGE_SIZE) != 0, "partial sector erase refused");
+    EXPECT(flash_prog((uint32_t)s_flash.size - 8, a, 16) != 0, "program past the partition refused");
+    EXPECT(flash_read((uint32_t)s_flash.size, a, 1) != 0, "read past the partition refused");
+#undef EXPECT
+    flash_blank();
+    return failures;
+}
+
+/* -------------------------------- Backends -------------------------------- */
+
+typedef struct {
+    const char *name;
+    int    (*format_mount)(void);
+    void   (*unmount)(void);
+    int    (*write_file)(const char *name, const void *data, size_t len);  // Create or truncate
+    int    (*log_open)(const char *name);
+    int    (*log_append)(const void *data, size_t len);                     // Write + sync
+    void   (*log_close)(void);
+    void   (*usage)(size_t *total, size_t *used);
+} backend_t;
+
+#if HAVE_SPIFFS
+
+// Same geometry and buffers as esp_vfs_spiffs_register() with
+// CONFIG_SPIFFS_PAGE_SIZE 256 and max_files STORAGE_MAX_FILES (8)
+#define SP_MAX_FILES    8
+
+static spiffs      s_sp;
+static u8_t        s_sp_work[2 * 256];
+static u8_t       *s_sp_fds;
+static u8_t       *s_sp_cache;
+static spiffs_file s_sp_log = -1;
+
+static s32_t sp_hal_read(u32_t addr, u32_t size, u8_t *dst)
+{
+    return flash_read(addr, dst, size) == 0 ? SPIFFS_OK : SPIFFS_ERR_INTERNAL;
+}
+
+static s32_t sp_hal_write(u32_t addr, u32_t size, u8_t *src)
+{
+    return flash_prog(addr, src, size) == 0 ? SPIFFS_OK : SPIFFS_ERR_INTERNAL;
+}
+
+static s32_t sp_hal_erase(u32_t addr, u32_t size)
+{
+    return flash_erase(addr, size) == 0 ? SPIFFS_OK : SPIFFS_ERR_INTERNAL;
+}
+
+static void sp_path(char *buf, size_t len, const char *name)
+{
+    snprintf(buf, len, "/%s", name);    // How esp_spiffs hands names down
+}
+
+static s32_t sp_mount(void)
+{
+    spiffs_config cfg = {
+        .hal_read_f       = sp_hal_read,
+        .hal_write_f      = sp_hal_write,
+        .hal_erase_f      = sp_hal_erase,
+        .phys_size        = (u32_t)s_flash.size,
+        .phys_addr        = 0,
+        .phys_erase_block = SECTOR_SIZE,
+        .log_block_size   = SECTOR_SIZE,
+        .log_page_size    = 256,
+    };
+    u32_t fds_sz = SP_MAX_FILES * sizeof(spiffs_fd);
+    u32_t cache_sz = sizeof(spiffs_cache) + SP_MAX_FILES * (sizeof(spiffs_cache_page) + 256);
+    if (!s_sp_fds) {
+        s_sp_fds = calloc(1, fds_sz);
+        s_sp_cache = calloc(1, cache_sz);
+    }
+    return SPIFFS_mount(&s_sp, &cfg, s_sp_work, s_sp_fds, fds_sz, s_sp_cache, cache_sz, NULL);
+}
+
+// esp_spiffs: mount, and on failure format and mount again
+static int sp_format_mount(void)
+{
+    if (sp_mount() == SPIFFS_OK) {
+        return 0;
+    }
+    SPIFFS_unmount(&s_sp);
+    if (SPIFFS_format(&s_sp) != SPIFFS_OK) {
+        return -1;
+    }
+    return sp_mount() == SPIFFS_OK ? 0 : -1;
+}
+
+static void sp_unmount(void)
+{
+    SPIFFS_unmount(&s_sp);
+}
+
+static int sp_write_file(const char *name, const void *data, size_t len)
+{
+    char path[SPIFFS_OBJ_NAME_LEN];
+    sp_path(path, sizeof(path), name);
+    spiffs_file f = SPIFFS_open(&s_sp, path, SPIFFS_CREAT | SPIFFS_TRUNC | SPIFFS_WRONLY, 0);
+    if (f < 0) {
+        return -1;
+    }
+    s32_t n = SPIFFS_write(&s_sp, f, (void *)data, (s32_t)len);
+    return SPIFFS_close(&s_sp, f) == SPIFFS_OK && n == (s32_t)len ? 0 : -1;
+}
+
+static int sp_log_open(const char *name)
+{
+    char path[SPIFFS_OBJ_NAME_LEN];
+    sp_path(path, sizeof(path), name);
+    s_sp_log = SPIFFS_open(&s_sp, path, SPIFFS_CREAT | SPIFFS_RDWR | SPIFFS_APPEND, 0);
+    return s_sp_log < 0 ? -1 : 0;
+}
+
+// fsync() on an esp_spiffs fd is SPIFFS_fflush
+static int sp_log_append(const void *data, size_t len)
+{
+    s32_t n = SPIFFS_write(&s_sp, s_sp_log, (void *)data, (s32_t)len);
+    return n == (s32_t)len && SPIFFS_fflush(&s_sp, s_sp_log) == SPIFFS_OK ? 0 : -1;
+}
+
+static void sp_log_close(void)
+{
+    SPIFFS_close(&s_sp, s_sp_log);
+    s_sp_log = -1;
+}
+
+static void sp_usage(size_t *total, size_t *used)
+{
+    u32_t t = 0, u = 0;
+    SPIFFS_info(&s_sp, &t, &u);
+    *total = t;
+    *used = u;
+}
+
+static const backend_t s_spiffs_backend = {
+    "spiffs", sp_format_mount, sp_unmount, sp_write_file,
+    sp_log_open, sp_log_append, sp_log_close, sp_usage,
+};
+
+#endif // HAVE_SPIFFS
+
+#if HAVE_LITTLEFS
+
+// esp_littlefs defaults (CONFIG_LITTLEFS_*): 128 byte read / program
+// units, 512 byte cache, 128 byte lookahead, 512 block cycles
+static lfs_t           s_lfs;
+static lfs_file_t      s_lfs_log;
+static struct lfs_config s_lfs_cfg;
+
+static int lfs_hal_read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                        void *buffer, lfs_size_t size)
+{
+    return flash_read(block * c->block_size + off, buffer, size) == 0 ? 0 : LFS_ERR_IO;
+}
+
+static int lfs_hal_prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                        const void *buffer, lfs_size_t size)
+{
+    return flash_prog(block * c->block_size + off, buffer, size) == 0 ? 0 : LFS_ERR_IO;
+}
+
+static int lfs_hal_erase(const struct lfs_config *c, lfs_block_t block)
+{
+    return flash_erase(block * c->block_size, c->block_size) == 0 ? 0 : LFS_ERR_IO;
+}
+
+static int lfs_hal_sync(const struct lfs_config *c)
+{
+    return 0;
+}
+
+static int lf_format_mount(void)
+{
+    s_lfs_cfg = (struct lfs_config){
+        .read           = lfs_hal_read,
+        .prog           = lfs_hal_prog,
+        .erase          = lfs_hal_erase,
+        .sync           = lfs_hal_sync,
+        .read_size      = 128,
+        .prog_size      = 128,
+        .block_size     = SECTOR_SIZE,
+        .block_count    = (lfs_size_t)(s_flash.size / SECTOR_SIZE),
+        .block_cycles   = 512,
+        .cache_size     = 512,
+        .lookahead_size = 128,
+    };
+    if (lfs_mount(&s_lfs, &s_lfs_cfg) == 0) {
+        return 0;
+    }
+    if (lfs_format(&s_lfs, &s_lfs_cfg) != 0) {
+        return -1;
+    }
+    return lfs_mount(&s_lfs, &s_lfs_cfg) == 0 ? 0 : -1;
+}
+
+static void lf_unmount(void)
+{
+    lfs_unmount(&s_lfs);
+}
+
+static int lf_write_file(const char *name, const void *data, size_t len)
+{
+    lfs_file_t f;
+    if (lfs_file_open(&s_lfs, &f, name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC) != 0) {
+        return -1;
+    }
+    lfs_ssize_t n = lfs_file_write(&s_lfs, &f, data, (lfs_size_t)len);
+    return lfs_file_close(&s_lfs, &f) == 0 && n == (lfs_ssize_t)len ? 0 : -1;
+}
+
+static int lf_log_open(const char *name)
+{
+    return lfs_file_open(&s_lfs, &s_lfs_log, name,
+                         LFS_O_RDWR | LFS_O_CREAT | LFS_O_APPEND) == 0 ? 0 : -1;
+}
+
+static int lf_log_append(const void *data, size_t len)
+{
+    lfs_ssize_t n = lfs_file_write(&s_lfs, &s_lfs_log, data, (lfs_size_t)len);
+    return n == (lfs_ssize_t)len && lfs_file_sync(&s_lfs, &s_lfs_log) == 0 ? 0 : -1;
+}
+
+static void lf_log_close(void)
+{
+    lfs_file_close(&s_lfs, &s_lfs_log);
+}
+
+static void lf_usage(size_t *total, size_t *used)
+{
+    lfs_ssize_t blocks = lfs_fs_size(&s_lfs);
+    *total = (size_t)s_lfs_cfg.block_count * s_lfs_cfg.block_size;
+    *used = blocks < 0 ? 0 : (size_t)blocks * s_lfs_cfg.block_size;
+}
+
+static const backend_t s_littlefs_backend = {
+    "littlefs", lf_format_mount, lf_unmount, lf_write_file,
+    lf_log_open, lf_log_append, lf_log_close, lf_usage,
+};
+
+#endif // HAVE_LITTLEFS
+
+static const backend_t *const s_backends[] = {
+#if HAVE_SPIFFS
+    &s_spiffs_backend,
+#endif
+#if HAVE_LITTLEFS
+    &s_littlefs_backend,
+#endif
+    NULL,
+};
+
+/* -------------------------------- Benchmark -------------------------------- */
+
+static struct {
+    const char *backend;            // NULL: all built in
+    int         fills[MAX_FILLS];   // Percent of the partition
+    int         n_fills;
+    int         churn;              // Filler rewrites before timing
+    int         appends;
+    int         record;             // Bytes per append
+    uint64_t    seed;
+    const char *image;
+} s_opt = {
+    .fills   = { 0, 25, 50, 75, 90 },
+    .n_fills = 5,
+    .churn   = 200,
+    .appends = 256,
+    .record  = 16,                  // sizeof(weigh_log_record_t)
+    .seed    = 1,
+};
+
+static uint64_t s_rng;
+
+static uint32_t rnd(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 16);
+}
+
+static double cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int n, double p)
+{
+    int i = (int)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+static int run(const backend_t *b, int fill_pct)
+{
+    static uint8_t filler[FILLER_SIZE];
+    static double  lat_ms[MAX_APPENDS];
+    uint8_t record[256];
+    char name[16];
+
+    flash_blank();
+    if (b->format_mount() != 0) {
+        fprintf(stderr, "%s: format failed\n", b->name);
+        return -1;
+    }
+    size_t total, used;
+    b->usage(&total, &used);
+    size_t target = total * (size_t)fill_pct / 100;
+
+    int files = 0;
+    while (used + FILLER_SIZE <= target) {
+        for (size_t i = 0; i < sizeof(filler); i++) {
+            filler[i] = (uint8_t)rnd();
+        }
+        snprintf(name, sizeof(name), "f%03d", files);
+        if (b->write_file(name, filler, sizeof(filler)) != 0) {
+            break;                  // Full before the target: report what was reached
+        }
+        files++;
+        b->usage(&total, &used);
+    }
+    int churn_fail = 0;
+    for (int i = 0; files > 0 && i < s_opt.churn; i++) {
+        filler[rnd() % sizeof(filler)] ^= 0x5A;
+        snprintf(name, sizeof(name), "f%03d", (int)(rnd() % (uint32_t)files));
+        churn_fail += b->write_file(name, filler, sizeof(filler)) != 0;
+    }
+    b->usage(&total, &used);
+    double used_pct = total ? 100.0 * used / total : 0.0;
+
+    if (b->log_open(LOG_NAME) != 0) {
+        fprintf(stderr, "%s: cannot open %s at %d%%\n", b->name, LOG_NAME, fill_pct);
+        b->unmount();
+        return -1;
+    }
+    flash_counters_t before = s_flash.c;
+    double cpu_total = 0.0;
+    int fails = 0;
+    for (int i = 0; i < s_opt.appends; i++) {
+        for (int k = 0; k < s_opt.record; k++) {
+            record[k] = (uint8_t)rnd();
+        }
+        double busy0 = s_flash.c.busy_us;
+        double cpu0 = cpu_us();
+        fails += b->log_append(record, (size_t)s_opt.record) != 0;
+        cpu_total += cpu_us() - cpu0;
+        lat_ms[i] = (s_flash.c.busy_us - busy0) / 1000.0;
+    }
+    b->log_close();
+    b->unmount();
+
+    uint64_t erases = s_flash.c.erases - before.erases;
+    uint64_t prog_bytes = s_flash.c.prog_bytes - before.prog_bytes;
+    double sum = 0.0;
+    for (int i = 0; i < s_opt.appends; i++) {
+        sum += lat_ms[i];
+    }
+    qsort(lat_ms, (size_t)s_opt.appends, sizeof(double), cmp_double);
+    printf("%-9s %4d%% %6.1f%% %5d %8.2f %8.2f %8.2f %8.2f %7llu %6.1f %5d %6.1f\n",
+           b->name, fill_pct, used_pct, files,
+           percentile(lat_ms, s_opt.appends, 0.50), percentile(lat_ms, s_opt.appends, 0.99),
+           lat_ms[s_opt.appends - 1], sum / s_opt.appends, (unsigned long long)erases,
+           (double)prog_bytes / ((double)s_opt.appends * s_opt.record), fails + churn_fail,
+           cpu_total / s_opt.appends);
+    return 0;
+}
+
+/* ---------------------------------- Main ---------------------------------- */
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: storage_bench [options]\n"
+        "  --backend NAME     spiffs or littlefs (every one built in)\n"
+        "  --fills P,P,...    partition fill levels in percent (0,25,50,75,90)\n"
+        "  --churn N          filler rewrites before timing (%d)\n"
+        "  --appends N        timed appends per fill level (%d, at most %d)\n"
+        "  --record B         bytes per append (%d)\n"
+        "  --size BYTES       partition size (0x%zx)\n"
+        "  --prog-us US       256 byte page program time (%.0f)\n"
+        "  --erase-us US      4 KiB sector erase time (%.0f)\n"
+        "  --read-ns NS       read time per byte (%.0f)\n"
+        "  --image FILE       keep the flash image in FILE\n"
+        "  --seed N\n"
+        "  --self-test        check the flash model only\n"
+        "built in:",
+        s_opt.churn, s_opt.appends, MAX_APPENDS, s_opt.record, s_flash.size,
+        s_flash.prog_page_us, s_flash.erase_us, s_flash.read_ns_per_byte);
+    for (int i = 0; s_backends[i]; i++) {
+        fprintf(stderr, " %s", s_backends[i]->name);
+    }
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+static void parse_fills(char *v)
+{
+    s_opt.n_fills = 0;
+    for (char *t = strtok(v, ","); t && s_opt.n_fills < MAX_FILLS; t = strtok(NULL, ",")) {
+        int p = atoi(t);
+        if (p < 0 || p > 100) {
+            usage();
+        }
+        s_opt.fills[s_opt.n_fills++] = p;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool self_test = false;
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "--self-test")) {
+            self_test = true;
+            continue;
+        }
+        char *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!v) usage();
+        i++;
+        if (!strcmp(a, "--backend")) s_opt.backend = v;
+        else if (!strcmp(a, "--fills")) parse_fills(v);
+        else if (!strcmp(a, "--churn")) s_opt.churn = atoi(v);
+        else if (!strcmp(a, "--appends")) s_opt.appends = atoi(v);
+        else if (!strcmp(a, "--record")) s_opt.record = atoi(v);
+        else if (!strcmp(a, "--size")) s_flash.size = strtoul(v, NULL, 0);
+        else if (!strcmp(a, "--prog-us")) s_flash.prog_page_us = atof(v);
+        else if (!strcmp(a, "--erase-us")) s_flash.erase_us = atof(v);
+        else if (!strcmp(a, "--read-ns")) s_flash.read_ns_per_byte = atof(v);
+        else if (!strcmp(a, "--image")) s_opt.image = v;
+        else if (!strcmp(a, "--seed")) s_opt.seed = strtoull(v, NULL, 0);
+        else usage();
+    }
+    if (s_opt.n_fills < 1 || s_opt.churn < 0 || s_opt.appends < 1 ||
+        s_opt.appends > MAX_APPENDS || s_opt.record < 1 || s_opt.record > 256 ||
+        s_flash.size < 8 * SECTOR_SIZE || s_flash.size % SECTOR_SIZE) {
+        usage();
+    }
+    if (flash_open(s_opt.image) != 0) {
+        return 1;
+    }
+    if (self_test) {
+        int failures = flash_self_test();
+        flash_close();
+        if (failures) {
+            printf("%d check(s) failed\n", failures);
+            return 1;
+        }
+        printf("flash model: all checks passed\n");
+        return 0;
+    }
+    if (!s_backends[0]) {
+        fprintf(stderr, "no filesystem built in: see the Makefile for SPIFFS_SRC / LFS_SRC\n");
+        flash_close();
+        return 2;
+    }
+
+    printf("partition 0x%zx, %d appends of %d B + sync, %d churn rewrites; "
+           "prog %.0f us/page, erase %.0f us/sector\n",
+           s_flash.size, s_opt.appends, s_opt.record, s_opt.churn,
+           s_flash.prog_page_us, s_flash.erase_us);
+    printf("%-9s %5s %7s %5s %8s %8s %8s %8s %7s %6s %5s %6s\n",
+           "backend", "fill", "used", "files", "p50 ms", "p99 ms", "max ms", "mean ms",
+           "erases", "wamp", "fail", "cpu us");
+    int rc = 0, ran = 0;
+    for (int bi = 0; s_backends[bi]; bi++) {
+        const backend_t *b = s_backends[bi];
+        if (s_opt.backend && strcmp(s_opt.backend, b->name) != 0) {
+            continue;
+        }
+        ran++;
+        for (int f = 0; f < s_opt.n_fills; f++) {
+            s_rng = s_opt.seed * 0x9E3779B97F4A7C15ull + (uint64_t)f + 1;
+            rc |= run(b, s_opt.fills[f]);
+        }
+    }
+    flash_close();
+    if (!ran) {
+        usage();
+    }
+    return rc ? 1 : 0;
+}
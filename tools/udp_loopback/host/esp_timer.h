@@ -0,0 +1 @@
+#include "udp_host.h"
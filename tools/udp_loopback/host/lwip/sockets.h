@@ -0,0 +1,5 @@
+// lwIP's BSD socket API is the host's
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
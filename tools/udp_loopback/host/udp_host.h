@@ -0,0 +1,58 @@
+// File: tools/udp_loopback/host/udp_host.h
+// ---------------------------------------------------------------------------
+// esp_event, esp_netif, esp_mac and periodic esp_timer on top of the
+// scale_tune host layer, for the UDP telemetry loopback test (which
+// implements them). Sockets are the host's own.
+// ---------------------------------------------------------------------------
+#ifndef UDP_HOST_H
+#define UDP_HOST_H
+
+#include "host_idf.h"
+
+#include <stdlib.h>
+
+/* esp_err.h */
+#define ESP_ERROR_CHECK(x) do { if ((x) != ESP_OK) abort(); } while (0)
+
+/* esp_netif.h */
+typedef struct { uint32_t addr; } esp_ip4_addr_t;
+typedef struct { esp_ip4_addr_t ip, netmask, gw; } esp_netif_ip_info_t;
+typedef struct host_netif esp_netif_t;
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key);
+esp_err_t    esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *out);
+
+/* esp_event.h */
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *arg, esp_event_base_t base, int32_t id, void *data);
+typedef struct host_handler *esp_event_handler_instance_t;
+extern esp_event_base_t const IP_EVENT;
+extern esp_event_base_t const WIFI_EVENT;
+enum { IP_EVENT_STA_GOT_IP, IP_EVENT_STA_LOST_IP };
+enum { WIFI_EVENT_STA_CONNECTED = 4, WIFI_EVENT_STA_DISCONNECTED = 5 };
+typedef struct { esp_netif_ip_info_t ip_info; } ip_event_got_ip_t;
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t fn,
+                                              void *arg, esp_event_handler_instance_t *out);
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id,
+                                                esp_event_handler_instance_t instance);
+
+/* esp_mac.h */
+typedef enum { ESP_MAC_WIFI_STA } esp_mac_type_t;
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+/* esp_timer.h (periodic) */
+typedef struct host_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct {
+    esp_timer_cb_t callback;
+    void          *arg;
+    const char    *name;
+} esp_timer_create_args_t;
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+/* string.h (newlib) */
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#endif // UDP_HOST_H
@@ -0,0 +1,457 @@
+// File: tools/udp_loopback/udp_loopback.c
+// ---------------------------------------------------------------------------
+// UDP telemetry over the host loopback
+//   - udp_telemetry.c compiled in unchanged; its frames go out through a
+//     real socket to the multicast group on 127.0.0.1 and are read back by
+//     a member socket. Event loop, hub, MAC and timers are stand-ins on a
+//     virtual clock
+//   - A weigh-in at 80 SPS (added, live, locked, live, removed, idle):
+//     every frame decoded and checked field by field, frame_seq without
+//     gaps, live frames held to the configured rate, heartbeats only
+//     while idle, counters equal to what arrived
+//   - Rate changes, disconnect/reconnect, association before init
+//   - A hub subscribe failure (with GOT_IP racing init) must leave no
+//     socket, handler or timer behind, and init must then succeed
+//
+//   make -C tools/udp_loopback
+//   tools/udp_loopback/udp_loopback
+//   (make PORT=n to use another port if UDP_TLM_PORT is taken)
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+
+#include "udp_telemetry.c"
+
+#define SPS             80
+#define LOOPBACK        "127.0.0.1"
+
+/* --------------------------- Host stand-ins ----------------------------- */
+
+struct host_handler { esp_event_base_t base; int32_t id; esp_event_handler_t fn; bool used; };
+struct host_timer   { esp_timer_create_args_t args; uint64_t period_us; bool used; };
+
+esp_event_base_t const IP_EVENT   = "IP_EVENT";
+esp_event_base_t const WIFI_EVENT = "WIFI_EVENT";
+
+static struct host_handler s_handlers[4];
+static struct host_timer   s_timers[2];
+static hub_sink_fn         s_sink;
+static bool                s_subscribe_fails;
+static bool                s_associated;        // esp_netif has an address
+static int64_t             s_now_us;
+static int                 s_failures;
+
+#define CHECK(cond, ...) do {                                       \
+        if (!(cond)) {                                              \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                           \
+            fputc('\n', stderr);                                    \
+            s_failures++;                                           \
+        }                                                           \
+    } while (0)
+
+int64_t esp_timer_get_time(void) { return s_now_us; }
+uint32_t esp_log_timestamp(void) { return (uint32_t)(s_now_us / 1000); }
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buf) { return buf; }
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) { return pdTRUE; }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) { return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t s) { }
+
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t n = strlen(src);
+    if (size) {
+        size_t k = n < size - 1 ? n : size - 1;
+        memcpy(dst, src, k);
+        dst[k] = '\0';
+    }
+    return n;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+    static const uint8_t m[6] = { 0x24, 0x6f, 0x28, 0xa1, 0xb2, 0xc3 };
+    memcpy(mac, m, 6);
+    return ESP_OK;
+}
+
+static struct host_netif { int unused; } s_netif;
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *key) { return &s_netif; }
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (s_associated) out->ip.addr = inet_addr(LOOPBACK);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t fn,
+                                              void *arg, esp_event_handler_instance_t *out) {
+    for (int i = 0; i < 4; i++) {
+        if (s_handlers[i].used) continue;
+        s_handlers[i] = (struct host_handler){ base, id, fn, true };
+        if (out) *out = &s_handlers[i];
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id,
+                                                esp_event_handler_instance_t instance) {
+    CHECK(instance && instance->used && instance->base == base && instance->id == id,
+          "unregistering a handler that is not registered");
+    if (instance) instance->used = false;
+    return ESP_OK;
+}
+
+static int handlers_registered(void) {
+    int n = 0;
+    for (int i = 0; i < 4; i++) n += s_handlers[i].used;
+    return n;
+}
+
+static void post_event(esp_event_base_t base, int32_t id, void *data) {
+    for (int i = 0; i < 4; i++) {
+        if (s_handlers[i].used && s_handlers[i].base == base && s_handlers[i].id == id) {
+            s_handlers[i].fn(NULL, base, id, data);
+        }
+    }
+}
+
+static void got_ip(void) {
+    s_associated = true;
+    ip_event_got_ip_t ev = { .ip_info.ip.addr = inet_addr(LOOPBACK) };
+    post_event(IP_EVENT, IP_EVENT_STA_GOT_IP, &ev);
+}
+
+static void disconnected(void) {
+    s_associated = false;
+    post_event(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, NULL);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+    for (int i = 0; i < 2; i++) {
+        if (s_timers[i].used) continue;
+        s_timers[i] = (struct host_timer){ .args = *args, .used = true };
+        *out = &s_timers[i];
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us) { t->period_us = period_us; return ESP_OK; }
+esp_err_t esp_timer_stop(esp_timer_handle_t t) { t->period_us = 0; return ESP_OK; }
+esp_err_t esp_timer_delete(esp_timer_handle_t t) { t->used = false; return ESP_OK; }
+
+int app_connection_manager_subscribe(const char *name, hub_sink_fn fn, void *ctx, uint8_t depth,
+                                     hub_drop_policy_t policy, uint32_t kinds, UBaseType_t priority) {
+    if (s_subscribe_fails) {
+        got_ip();           // Association completes while init is running
+        return -1;
+    }
+    s_sink = fn;
+    return 0;
+}
+
+/** Advance the clock, firing the periodic timers on the way */
+static void advance_to(int64_t t_us) {
+    for (int i = 0; i < 2; i++) {
+        struct host_timer *tm = &s_timers[i];
+        if (!tm->used || !tm->period_us) continue;
+        int64_t p = (int64_t)tm->period_us;
+        for (int64_t k = s_now_us / p + 1; k * p <= t_us; k++) {
+            s_now_us = k * p;
+            tm->args.callback(tm->args.arg);
+        }
+    }
+    s_now_us = t_us;
+}
+
+/* ----------------------------- Receiver --------------------------------- */
+
+typedef struct {
+    uint16_t magic;
+    uint8_t  version, kind;
+    uint32_t device_id, frame_seq, meas_seq;
+    int32_t  weight_cg;
+    uint32_t uptime_ms, time_s;
+    uint8_t  user_id, flags;
+    uint16_t live_hz;
+} frame_t;
+
+static uint16_t get_u16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t get_u32(const uint8_t *p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void decode(const uint8_t *b, frame_t *f) {
+    f->magic = get_u16(b);
+    f->version = b[2];
+    f->kind = b[3];
+    f->device_id = get_u32(b + 4);
+    f->frame_seq = get_u32(b + 8);
+    f->meas_seq = get_u32(b + 12);
+    f->weight_cg = (int32_t)get_u32(b + 16);
+    f->uptime_ms = get_u32(b + 20);
+    f->time_s = get_u32(b + 24);
+    f->user_id = b[28];
+    f->flags = b[29];
+    f->live_hz = get_u16(b + 30);
+}
+
+static int open_member(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+    struct ip_mreq mreq = { .imr_interface.s_addr = inet_addr(LOOPBACK) };
+    inet_aton(UDP_TLM_GROUP, &mreq.imr_multiaddr);
+    if (bind(fd, (struct sockaddr *)&a, sizeof(a)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        perror("multicast member socket");
+        exit(2);
+    }
+    struct timeval tv = { .tv_usec = 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// Per-run tallies of what arrived
+typedef struct {
+    uint32_t frames, live, state, heartbeats;
+    uint32_t next_seq;          // Expected frame_seq
+    uint32_t gaps;
+    frame_t  last;
+} rx_t;
+
+/** Read every frame sent since the last call and check it against `m` */
+static void drain(int fd, rx_t *rx, int expect, const measurement_t *m) {
+    for (int i = 0; i < expect; i++) {
+        uint8_t b[64];
+        ssize_t n = recv(fd, b, sizeof(b), 0);
+        CHECK(n == UDP_TLM_FRAME_LEN, "frame %u: got %zd bytes", (unsigned)rx->next_seq, n);
+        if (n != UDP_TLM_FRAME_LEN) return;
+        frame_t f;
+        decode(b, &f);
+        CHECK(f.magic == UDP_TLM_MAGIC && f.version == UDP_TLM_VERSION, "bad magic/version");
+        CHECK(f.device_id == 0x28a1b2c3, "device id %08x", (unsigned)f.device_id);
+        if (f.frame_seq != rx->next_seq) rx->gaps++;
+        rx->next_seq = f.frame_seq + 1;
+        if (m) {
+            uint8_t kind = f.kind == UDP_TLM_KIND_HEARTBEAT ? m->kind : f.kind;
+            CHECK(kind == m->kind, "kind %u for a kind %u measurement", f.kind, m->kind);
+            CHECK(f.meas_seq == m->seq && f.weight_cg == (int32_t)lroundf(m->weight_g * 100.0f),
+                  "seq %u weight %d cg for seq %u %.3f g", (unsigned)f.meas_seq, (int)f.weight_cg,
+                  (unsigned)m->seq, m->weight_g);
+            CHECK(f.uptime_ms == (uint32_t)(m->mono_us / 1000) && f.time_s == (uint32_t)m->timestamp &&
+                  f.user_id == m->user_id, "times/user differ");
+            uint8_t flags = (m->kind == MEAS_KIND_LOCKED ? UDP_TLM_FLAG_STABLE : 0) |
+                            (m->kind != MEAS_KIND_REMOVED ? UDP_TLM_FLAG_PRESENT : 0) |
+                            (m->timestamp > 0 ? UDP_TLM_FLAG_TIME_VALID : 0);
+            CHECK(f.flags == flags, "flags %02x, expected %02x", f.flags, flags);
+            CHECK(f.live_hz == s_live_hz, "live_hz %u", f.live_hz);
+        }
+        rx->frames++;
+        if (f.kind == UDP_TLM_KIND_HEARTBEAT) rx->heartbeats++;
+        else if (f.kind == MEAS_KIND_LIVE) rx->live++;
+        else rx->state++;
+        rx->last = f;
+    }
+}
+
+/** Frames sent since `before` */
+static int sent_since(const udp_telemetry_stats_t *before) {
+    udp_telemetry_stats_t st;
+    udp_telemetry_get_stats(&st);
+    return (int)(st.frames_sent - before->frames_sent);
+}
+
+/** Feed one measurement and read back whatever it produced */
+static void feed(int fd, rx_t *rx, measurement_t *m, uint8_t kind, float g) {
+    static uint32_t seq;
+    udp_telemetry_stats_t before;
+    udp_telemetry_get_stats(&before);
+    m->kind = kind;
+    m->weight_g = g;
+    m->seq = ++seq;
+    m->mono_us = s_now_us;
+    s_sink(m, NULL);
+    drain(fd, rx, sent_since(&before), m);
+}
+
+/** Idle until `t_us`, reading back heartbeats */
+static void idle_until(int fd, rx_t *rx, const measurement_t *last, int64_t t_us) {
+    udp_telemetry_stats_t before;
+    udp_telemetry_get_stats(&before);
+    advance_to(t_us);
+    drain(fd, rx, sent_since(&before), last);
+}
+
+/* ------------------------------- Cases ---------------------------------- */
+
+static void check_encode(void) {
+    static const uint8_t want[UDP_TLM_FRAME_LEN] = {
+        0x57, 0x53, 0x01, 0x02, 0x44, 0x33, 0x22, 0x11, 0x07, 0x00, 0x00, 0x00,
+        0x2a, 0x00, 0x00, 0x00, 0xbb, 0xe4, 0xff, 0xff, 0x39, 0x30, 0x00, 0x00,
+        0x00, 0xe1, 0xf5, 0x05, 0x03, 0x07, 0x05, 0x00,
+    };
+    measurement_t m = { .weight_g = -69.8125f, .mono_us = 12345678, .timestamp = 100000000,
+                        .seq = 42, .user_id = 3, .kind = MEAS_KIND_LOCKED };
+    uint8_t b[UDP_TLM_FRAME_LEN];
+    udp_telemetry_encode(b, &m, m.kind, 0x11223344, 7, UDP_TLM_FLAG_STABLE | UDP_TLM_FLAG_PRESENT, 5);
+    CHECK(memcmp(b, want, sizeof(b)) == 0, "encoded frame differs from the documented layout");
+    printf("encode       golden frame ok\n");
+}
+
+static void check_weigh_in(int fd) {
+    rx_t rx = { .next_seq = 1 };
+    measurement_t m = { .timestamp = 1760000000, .user_id = 0xFF };
+    const int64_t dt = 1000000 / SPS;
+
+    // Live readings before association go nowhere and count no errors
+    CHECK(udp_telemetry_init(NULL) == ESP_OK, "init");
+    CHECK(handlers_registered() == 2 && s_sink, "init did not register");
+    feed(fd, &rx, &m, MEAS_KIND_ADDED, 25.0f);
+    got_ip();
+    CHECK(s_sock >= 0, "GOT_IP did not open the socket");
+
+    // 8 s on the scale at 80 SPS, locked after 6 s
+    int64_t t0 = s_now_us;
+    feed(fd, &rx, &m, MEAS_KIND_ADDED, 25.0f);
+    long live_in = 0;
+    for (int64_t t = t0 + dt; t < t0 + 8000000; t += dt) {
+        idle_until(fd, &rx, &m, t);
+        if (t - t0 >= 6000000 && t - t0 < 6000000 + dt) {
+            feed(fd, &rx, &m, MEAS_KIND_LOCKED, 72.35f);
+        }
+        feed(fd, &rx, &m, MEAS_KIND_LIVE, 72.35f + (float)((t / dt) % 7) * 0.01f);
+        live_in++;
+    }
+    CHECK(rx.heartbeats == 0, "%u heartbeats while frames were flowing", (unsigned)rx.heartbeats);
+    uint32_t live_out = rx.live;
+    feed(fd, &rx, &m, MEAS_KIND_REMOVED, 0.2f);
+    const measurement_t removed = m;
+
+    // Idle: the last frame repeats once per UDP_TLM_HEARTBEAT_MS
+    int64_t idle_from = s_now_us;
+    idle_until(fd, &rx, &removed, idle_from + 5500000);
+    udp_telemetry_stats_t st;
+    udp_telemetry_get_stats(&st);
+
+    CHECK(rx.gaps == 0, "%u frame_seq gaps", (unsigned)rx.gaps);
+    CHECK(rx.state == 3, "%u state frames", (unsigned)rx.state);
+    CHECK(live_out >= 8 * UDP_TLM_LIVE_HZ - 1 && live_out <= 8 * UDP_TLM_LIVE_HZ + 1,
+          "%u live frames in 8 s at %d Hz", (unsigned)live_out, UDP_TLM_LIVE_HZ);
+    CHECK(rx.heartbeats == 5, "%u heartbeats in 5.5 s idle", (unsigned)rx.heartbeats);
+    CHECK(st.frames_sent == rx.frames && st.send_errors == 0, "sent %u, received %u, errors %u",
+          (unsigned)st.frames_sent, (unsigned)rx.frames, (unsigned)st.send_errors);
+    CHECK(st.live_skipped == live_in - live_out, "live_skipped %u, expected %ld",
+          (unsigned)st.live_skipped, live_in - (long)live_out);
+    CHECK(st.heartbeats == rx.heartbeats, "heartbeat counter");
+    printf("weigh-in     %ld live readings -> %u frames at %d Hz, 3 state frames, %u heartbeats idle, no gaps\n",
+           live_in, (unsigned)live_out, UDP_TLM_LIVE_HZ, (unsigned)rx.heartbeats);
+
+    // Rate changes take effect on the next reading
+    udp_telemetry_set_rate(0);
+    uint32_t before = rx.live;
+    int64_t t1 = s_now_us;
+    for (int64_t t = t1 + dt; t < t1 + 2000000; t += dt) {
+        idle_until(fd, &rx, &m, t);
+        feed(fd, &rx, &m, MEAS_KIND_LIVE, 50.0f);
+    }
+    CHECK(rx.live == before, "live frames at rate 0");
+    udp_telemetry_set_rate(20);
+    t1 = s_now_us;
+    for (int64_t t = t1 + dt; t <= t1 + 2000000; t += dt) {
+        idle_until(fd, &rx, &m, t);
+        feed(fd, &rx, &m, MEAS_KIND_LIVE, 50.0f);
+    }
+    CHECK(rx.live - before >= 39 && rx.live - before <= 41, "%u live frames in 2 s at 20 Hz",
+          (unsigned)(rx.live - before));
+    printf("rate         0 Hz: no live frames, 20 Hz: %u in 2 s\n", (unsigned)(rx.live - before));
+
+    // Disconnect closes the socket; nothing is sent or counted as an error,
+    // and frame_seq carries on without a gap after GOT_IP
+    disconnected();
+    CHECK(s_sock < 0, "socket open after disconnect");
+    udp_telemetry_get_stats(&st);
+    uint32_t sent = st.frames_sent;
+    feed(fd, &rx, &m, MEAS_KIND_ADDED, 10.0f);
+    idle_until(fd, &rx, &m, s_now_us + 3000000);
+    udp_telemetry_stats_t st2;
+    udp_telemetry_get_stats(&st2);
+    CHECK(st2.frames_sent == sent && st2.send_errors == 0, "frames sent while disconnected");
+    got_ip();
+    feed(fd, &rx, &m, MEAS_KIND_REMOVED, 0.0f);
+    CHECK(rx.gaps == 0 && rx.last.kind == MEAS_KIND_REMOVED, "reconnect");
+    udp_telemetry_set_rate(UDP_TLM_LIVE_HZ);
+    printf("reconnect    socket follows the station, frame_seq continuous\n");
+}
+
+/** Module statics back to a fresh boot (the socket stays with the caller) */
+static void reboot(void) {
+    for (int i = 0; i < 4; i++) s_handlers[i].used = false;
+    for (int i = 0; i < 2; i++) s_timers[i].used = false;
+    if (s_sock >= 0) close(s_sock);
+    s_sock = -1;
+    s_lock = NULL;
+    s_heartbeat = NULL;
+    s_ip_handler = s_disc_handler = NULL;
+    s_frame_seq = 0;
+    s_last_live_us = s_last_send_us = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_sink = NULL;
+    s_associated = false;
+}
+
+static void check_subscribe_failure(int fd) {
+    reboot();
+    s_subscribe_fails = true;
+    esp_err_t err = udp_telemetry_init(NULL);
+    s_subscribe_fails = false;
+    CHECK(err == ESP_ERR_NO_MEM, "init returned %d with no hub slot", err);
+    CHECK(s_sock < 0, "socket left open after a failed init");
+    CHECK(handlers_registered() == 0, "%d event handlers left registered", handlers_registered());
+    CHECK(!s_timers[0].used && !s_timers[1].used, "heartbeat timer left behind");
+    CHECK(s_lock == NULL, "init cannot be retried");
+    // The socket the racing GOT_IP opened must be closed, not just forgotten
+    int probe = socket(AF_INET, SOCK_DGRAM, 0);
+    close(probe);
+    int probe2 = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(probe2 == probe, "descriptors leaked");
+    close(probe2);
+
+    // Nothing reaches the group after the failure, even on a later GOT_IP
+    got_ip();
+    CHECK(s_sock < 0, "stale handler reopened the socket");
+
+    // Already associated when init runs: it opens the socket itself
+    rx_t rx = { .next_seq = 1 };
+    measurement_t m = { .user_id = 0xFF };
+    s_associated = true;
+    CHECK(udp_telemetry_init(NULL) == ESP_OK && s_sock >= 0, "retry after a failed init");
+    feed(fd, &rx, &m, MEAS_KIND_ADDED, 5.0f);
+    CHECK(rx.frames == 1 && rx.gaps == 0, "no frame after the retried init");
+    printf("init failure no socket, handler or timer left; retry sends\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    int fd = open_member(UDP_TLM_PORT);
+    s_now_us = 1000000;
+    check_encode();
+    check_weigh_in(fd);
+    check_subscribe_failure(fd);
+    close(fd);
+
+    if (s_failures) {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""www_pack.py - Stage the web dashboard for the "www" SPIFFS partition.
+
+Takes a static web export (e.g. `npx expo export --platform web` in
+app/iot-human-scale, output in dist/) and writes the partition contents:
+
+  /<id>        identity body (only when compression does not pay off)
+  /<id>.gz     gzip -9
+  /<id>.br     brotli q11 (if the `brotli` module or CLI is available)
+  /manifest    one line per URL, sorted by path:
+               <id> <encodings> <cache> <size> <mime> <path>
+
+<id> is the first 16 hex digits of the SHA-256 of the original file. It is
+the strong ETag and keeps SPIFFS names far below CONFIG_SPIFFS_OBJ_NAME_LEN,
+whatever the export's own file names look like. <encodings> is a subset of
+"bgi" (br, gzip, identity). <cache> is "i" for fingerprinted assets (served
+with Cache-Control: immutable) and "r" for pages (revalidated by ETag).
+
+The build picks the directory up when it exists (main/CMakeLists.txt):
+
+  cd app/iot-human-scale && npx expo export --platform web
+  python tools/www_pack.py app/iot-human-scale/dist www
+  idf.py build flash
+"""
+
+import argparse
+import gzip
+import hashlib
+import mimetypes
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+# Partition size from partitions.csv (www)
+DEFAULT_BUDGET = 0x50000
+
+# SPIFFS keeps roughly this fraction usable after page/block overhead
+SPIFFS_USABLE = 0.85
+
+# Compression must save at least this much to drop the identity copy
+MIN_SAVING = 0.10
+
+MIME = {
+    ".html": "text/html",
+    ".js": "application/javascript",
+    ".mjs": "application/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".map": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".ico": "image/x-icon",
+    ".ttf": "font/ttf",
+    ".woff": "font/woff",
+    ".woff2": "font/woff2",
+    ".txt": "text/plain",
+}
+
+# Expo puts content hashes in everything under /_expo/static and /assets
+FINGERPRINT = re.compile(r"(^/_expo/static/)|([-.][0-9a-f]{8,}\.[a-z0-9]+$)")
+
+
+def brotli_compress(data):
+    try:
+        import brotli
+        return brotli.compress(data, quality=11)
+    except ImportError:
+        pass
+    if shutil.which("brotli"):
+        return subprocess.run(["brotli", "-c", "-q", "11"], input=data,
+                              stdout=subprocess.PIPE, check=True).stdout
+    return None
+
+
+def gzip_compress(data):
+    return gzip.compress(data, compresslevel=9, mtime=0)   # Reproducible
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("src", help="static web export (e.g. dist/)")
+    ap.add_argument("out", help="partition staging directory (replaced)")
+    ap.add_argument("--budget", type=lambda v: int(v, 0), default=DEFAULT_BUDGET,
+                    help="partition size in bytes (default 0x%x)" % DEFAULT_BUDGET)
+    ap.add_argument("--no-br", action="store_true", help="gzip only")
+    ap.add_argument("--skip", action="append", default=[".map"],
+                    help="file suffix to leave out (default: .map)")
+    args = ap.parse_args()
+
+    if os.path.exists(args.out):
+        shutil.rmtree(args.out)
+    os.makedirs(args.out)
+
+    entries = []
+    total_src = total_out = 0
+    for root, _, files in os.walk(args.src):
+        for name in files:
+            full = os.path.join(root, name)
+            path = "/" + os.path.relpath(full, args.src).replace(os.sep, "/")
+            if any(path.endswith(s) for s in args.skip):
+                continue
+            if " " in path or "\n" in path:
+                sys.exit("unsupported file name: %r" % path)
+            with open(full, "rb") as f:
+                data = f.read()
+
+            ident = hashlib.sha256(data).hexdigest()[:16]
+            ext = os.path.splitext(name)[1].lower()
+            mime = MIME.get(ext) or mimetypes.guess_type(name)[0] or "application/octet-stream"
+            limit = len(data) * (1.0 - MIN_SAVING)
+
+            bodies = {}
+            gz = gzip_compress(data)
+            if len(gz) < limit:
+                bodies["g"] = gz
+                br = None if args.no_br else brotli_compress(data)
+                if br is not None and len(br) < len(gz):
+                    bodies["b"] = br
+            if not bodies:
+                bodies["i"] = data
+
+            suffix = {"b": ".br", "g": ".gz", "i": ""}
+            for enc, body in bodies.items():
+                dst = os.path.join(args.out, ident + suffix[enc])
+                if os.path.exists(dst):
+                    continue        # Same content under another path
+                with open(dst, "wb") as f:
+                    f.write(body)
+                total_out += len(body)
+            total_src += len(data)
+
+            cache = "i" if FINGERPRINT.search(path) else "r"
+            encs = "".join(e for e in "bgi" if e in bodies)
+            entries.append((path, ident, encs, cache, len(data), mime))
+            print("%-48s %7d -> %s" % (path, len(data),
+                  " ".join("%s:%d" % (e, len(bodies[e])) for e in encs)))
+
+    entries.sort()
+    with open(os.path.join(args.out, "manifest"), "w", newline="\n") as f:
+        for path, ident, encs, cache, size, mime in entries:
+            f.write("%s %s %s %d %s %s\n" % (ident, encs, cache, size, mime, path))
+
+    usable = int(args.budget * SPIFFS_USABLE)
+    print("%d files, %d bytes -> %d bytes stored (%.0f%%), partition usable ~%d"
+          % (len(entries), total_src, total_out,
+             100.0 * total_out / max(total_src, 1), usable))
+    if total_out > usable:
+        sys.exit("does not fit the www partition: try --no-br or trim the export")
+
+
+if __name__ == "__main__":
+    main()